@@ -246,7 +246,11 @@ public:
 	WSkeleton(Wasabi* const app, uint32_t ID = 0);
 
 	/**
-	 * Appends a keyframe to the frames of this animation.
+	 * Appends a keyframe to the frames of this animation. The first keyframe
+	 * creates the animation texture (see GetTexture()). If the engine has
+	 * not started (there is no image manager), the bone matrices are kept in
+	 * CPU memory instead, so Update() can still run (e.g. to benchmark it
+	 * without a device), but the skeleton is not valid for rendering.
 	 * @param  baseBone The root of the bone structure for this keyframe
 	 * @param  fTime    The duration of this keyframe
 	 * @return          Error code, see WError.h
@@ -429,6 +433,9 @@ private:
 
 	/** The animation texture */
 	WImage* m_boneTex;
+	/** Bone matrices of a skeleton created before the engine started (with no
+	    image manager), laid out like m_boneTex, empty if m_boneTex is used */
+	std::vector<float> m_boneData;
 	/** The object bindings to the bones */
 	vector<BONEBIND> m_bindings;
 	/** The binding scale */
@@ -26,6 +26,54 @@ enum W_PROJECTIONTYPE: uint8_t {
 	PROJECTION_ORTHOGONAL = 1,
 };
 
+/**
+ * World-space axis-aligned boxes of a batch of entities, stored as a structure
+ * of arrays for WCamera::CheckBoxesInFrustum(). Box i is centered at
+ * (centerX[i], centerY[i], centerZ[i]) and extends by extentX[i], extentY[i]
+ * and extentZ[i] from its center along each axis.
+ */
+struct W_BOUNDING_BOXES {
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+
+	void Clear() {
+		centerX.clear(); centerY.clear(); centerZ.clear();
+		extentX.clear(); extentY.clear(); extentZ.clear();
+	}
+
+	void Add(const WVector3& center, const WVector3& extent) {
+		centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+		extentX.push_back(extent.x); extentY.push_back(extent.y); extentZ.push_back(extent.z);
+	}
+
+	uint32_t Size() const {
+		return (uint32_t)centerX.size();
+	}
+};
+
+/**
+ * World-space bounding spheres of a batch of entities, stored as a structure
+ * of arrays for WCamera::CheckSpheresInFrustum().
+ */
+struct W_BOUNDING_SPHERES {
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> radius;
+
+	void Clear() {
+		centerX.clear(); centerY.clear(); centerZ.clear();
+		radius.clear();
+	}
+
+	void Add(const WVector3& center, float r) {
+		centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+		radius.push_back(r);
+	}
+
+	uint32_t Size() const {
+		return (uint32_t)centerX.size();
+	}
+};
+
 /**
  * @ingroup engineclass
  * This implements a camera in Wasabi.
@@ -226,6 +274,43 @@ public:
 	 */
 	bool CheckBoxInFrustum(WVector3 pos, WVector3 size) const;
 
+	/**
+	 * Checks a batch of boxes against the viewing frustum of the camera, four
+	 * (SIMD) boxes at a time. The result is a visibility bitmask: box i is in
+	 * the frustum if bit (i % 32) of visible[i / 32] is set.
+	 *
+	 * If planeCache is given, it remembers for every box the plane that
+	 * rejected it, and that plane is tested first in the next call. This
+	 * makes rejecting boxes that stay out of view cheap, as long as the
+	 * boxes keep their indices between calls.
+	 * @param boxes       Boxes to check
+	 * @param visible     Receives the visibility bitmask, resized to
+	 *                    (boxes.Size() + 31) / 32 words
+	 * @param planeCache  Optional per-box plane cache, resized to
+	 *                    boxes.Size() (new entries start at plane 0)
+	 */
+	void CheckBoxesInFrustum(const W_BOUNDING_BOXES& boxes, std::vector<uint32_t>& visible,
+							 std::vector<uint8_t>* planeCache = nullptr) const;
+
+	/**
+	 * Checks a batch of spheres against the viewing frustum of the camera,
+	 * see CheckBoxesInFrustum() for the format of the results.
+	 * @param spheres     Spheres to check
+	 * @param visible     Receives the visibility bitmask, resized to
+	 *                    (spheres.Size() + 31) / 32 words
+	 * @param planeCache  Optional per-sphere plane cache, resized to
+	 *                    spheres.Size() (new entries start at plane 0)
+	 */
+	void CheckSpheresInFrustum(const W_BOUNDING_SPHERES& spheres, std::vector<uint32_t>& visible,
+							   std::vector<uint8_t>* planeCache = nullptr) const;
+
+	/**
+	 * Retrieves the six planes of the viewing frustum, as of the last call to
+	 * Render(). The normals of the planes face the inside of the frustum.
+	 * @return Array of 6 planes
+	 */
+	const WPlane* GetFrustumPlanes() const;
+
 	/**
 	 * Checks if the camera is valid (always true).
 	 * @return true
@@ -266,6 +266,8 @@ public:
 		uint32_t desiredNumberOfSwapchainImages = numDesiredSwapchainImages;
 		if (desiredNumberOfSwapchainImages == std::numeric_limits<uint32_t>::max())
 			desiredNumberOfSwapchainImages = surfCaps.minImageCount + 1;
+		if (desiredNumberOfSwapchainImages < surfCaps.minImageCount)
+			desiredNumberOfSwapchainImages = surfCaps.minImageCount;
 		if ((surfCaps.maxImageCount > 0) && (desiredNumberOfSwapchainImages > surfCaps.maxImageCount))
 		{
 			desiredNumberOfSwapchainImages = surfCaps.maxImageCount;
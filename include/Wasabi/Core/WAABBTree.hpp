@@ -0,0 +1,169 @@
+/** @file WAABBTree.hpp
+ *  @brief Dynamic bounding volume tree for scene queries
+ *
+ *  A WAABBTree indexes a changing set of axis-aligned boxes (proxies) so that
+ *  the boxes intersecting a ray, a frustum, a sphere or a box can be found
+ *  without testing all of them.
+ *
+ *  @author Hasan Al-Jawaheri (hbj)
+ *  @bug No known bugs.
+ */
+
+#pragma once
+
+#include "Wasabi/Core/WMath.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+
+/**
+ * @ingroup engineclass
+ *
+ * An incrementally updated AABB tree. Every proxy is stored in a leaf with a
+ * "fat" box (the proxy's box grown by a margin relative to its size), so a
+ * proxy that moves a little stays in its leaf and does not need to be
+ * reinserted. Insertion picks the sibling that minimizes the growth in
+ * surface area, and the tree is kept balanced with AVL-style rotations, so
+ * queries cost O(log n + number of results).
+ */
+class WAABBTree {
+public:
+	/** An invalid proxy ID */
+	static const uint32_t NULL_PROXY = 0xFFFFFFFF;
+
+	/**
+	 * Called by queries for every proxy found.
+	 * @param  userData  User data of the proxy, as passed to CreateProxy()
+	 * @return           true to continue the query, false to stop it
+	 */
+	typedef std::function<bool(void* userData)> QueryCallback;
+
+	/**
+	 * @param margin  Fraction of a proxy's size by which its box is grown in
+	 *                the tree
+	 */
+	WAABBTree(float margin = 0.1f);
+	~WAABBTree();
+
+	/**
+	 * Inserts a proxy into the tree.
+	 * @param  min       Minimum point of the proxy's box
+	 * @param  max       Maximum point of the proxy's box
+	 * @param  userData  Data reported for the proxy by queries
+	 * @return           ID of the created proxy
+	 */
+	uint32_t CreateProxy(const WVector3& min, const WVector3& max, void* userData);
+
+	/**
+	 * Removes a proxy from the tree.
+	 * @param proxy  ID of the proxy, as returned by CreateProxy()
+	 */
+	void DestroyProxy(uint32_t proxy);
+
+	/**
+	 * Updates the box of a proxy. The proxy is only reinserted if its new box
+	 * is not contained in its fat box.
+	 * @param  proxy  ID of the proxy, as returned by CreateProxy()
+	 * @param  min    New minimum point of the proxy's box
+	 * @param  max    New maximum point of the proxy's box
+	 * @return        true if the proxy was reinserted, false otherwise
+	 */
+	bool MoveProxy(uint32_t proxy, const WVector3& min, const WVector3& max);
+
+	/**
+	 * Retrieves the user data of a proxy.
+	 * @param  proxy  ID of the proxy
+	 * @return        User data passed to CreateProxy()
+	 */
+	void* GetUserData(uint32_t proxy) const;
+
+	/**
+	 * Removes all proxies.
+	 */
+	void Clear();
+
+	/**
+	 * Finds all proxies whose (fat) box intersects a box.
+	 * @param min       Minimum point of the box
+	 * @param max       Maximum point of the box
+	 * @param callback  Called for every proxy found
+	 */
+	void QueryBox(const WVector3& min, const WVector3& max, const QueryCallback& callback) const;
+
+	/**
+	 * Finds all proxies whose (fat) box intersects a sphere.
+	 * @param center    Center of the sphere
+	 * @param radius    Radius of the sphere
+	 * @param callback  Called for every proxy found
+	 */
+	void QuerySphere(const WVector3& center, float radius, const QueryCallback& callback) const;
+
+	/**
+	 * Finds all proxies whose (fat) box is hit by a ray.
+	 * @param origin     Origin of the ray
+	 * @param direction  Direction of the ray (need not be normalized)
+	 * @param callback   Called for every proxy found
+	 */
+	void QueryRay(const WVector3& origin, const WVector3& direction, const QueryCallback& callback) const;
+
+	/**
+	 * Finds all proxies whose (fat) box is, at least partially, inside a
+	 * convex volume such as a camera frustum. Subtrees that are entirely
+	 * inside the volume are reported without testing their boxes.
+	 * @param planes     Planes bounding the volume, with their normals facing
+	 *                   inwards (see WCamera::GetFrustumPlanes())
+	 * @param numPlanes  Number of planes in planes
+	 * @param callback   Called for every proxy found
+	 */
+	void QueryPlanes(const WPlane* planes, uint32_t numPlanes, const QueryCallback& callback) const;
+
+	/**
+	 * @return Number of proxies in the tree
+	 */
+	uint32_t GetProxyCount() const;
+
+	/**
+	 * @return Height of the tree (0 if empty or a single leaf)
+	 */
+	uint32_t GetHeight() const;
+
+private:
+	struct NODE {
+		/** Fat box of the node */
+		WVector3 min, max;
+		/** User data (leaves only) */
+		void* userData;
+		/** Parent node, or the next free node if the node is unused */
+		uint32_t parent;
+		/** Children of the node, child1 is NULL_PROXY for leaves */
+		uint32_t child1, child2;
+		/** Height of the subtree, 0 for leaves, -1 for unused nodes */
+		int32_t height;
+
+		bool IsLeaf() const { return child1 == NULL_PROXY; }
+	};
+
+	/** Fraction of a proxy's size by which it is grown */
+	float m_margin;
+	/** Node pool, proxies are leaf node indices */
+	std::vector<NODE> m_nodes;
+	/** Root node */
+	uint32_t m_root;
+	/** Head of the free node list */
+	uint32_t m_freeList;
+	/** Number of proxies */
+	uint32_t m_proxyCount;
+
+	uint32_t _AllocateNode();
+	void _FreeNode(uint32_t node);
+	void _InsertLeaf(uint32_t leaf);
+	void _RemoveLeaf(uint32_t leaf);
+	void _RefitAncestors(uint32_t node);
+	uint32_t _Balance(uint32_t node);
+	void _SetFatBox(uint32_t leaf, const WVector3& min, const WVector3& max);
+
+	/** Walks the tree, visiting the subtrees for which test() returns true */
+	template<typename TestT>
+	void _Query(TestT test, const QueryCallback& callback) const;
+};
@@ -57,6 +57,16 @@ public:
 	 */
 	uint32_t GetID() const;
 
+	/**
+	 * Retrieves a number identifying this object that, unlike its ID (which
+	 * the application chooses) or its address (which may be reused by a
+	 * later object), is never given to another object during the lifetime
+	 * of the process. This makes it suitable for keying caches that may
+	 * outlive the object.
+	 * @return The unique ID of this object, never 0
+	 */
+	uint64_t GetUniqueID() const;
+
 	/**
 	 * Retrieves the name of this object.
 	 * @return The name of the object
@@ -96,6 +106,8 @@ protected:
 	std::string m_name;
 
 private:
+	/** Unique ID of this object, see GetUniqueID() */
+	uint64_t m_uniqueID;
 	/** The reference count, starting at 1 */
 	int m_refCount;
 };
@@ -0,0 +1,331 @@
+/** @file WCPUProfiler.hpp
+ *  @brief Scoped CPU profiler for the frame loop
+ *
+ *  The CPU profiler records named zones (scopes of code) on any thread into
+ *  per-thread ring buffers, collects them once per frame and derives frame
+ *  time and per-zone statistics from them.
+ *
+ *  @author Hasan Al-Jawaheri (hbj)
+ *  @bug No known bugs.
+ */
+
+#pragma once
+
+#include "Wasabi/Core/WError.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <cstdint>
+
+/**
+ * Profiles the enclosing scope as a zone with the given name. The name must
+ * outlive the profiler (use a string literal). Define WASABI_NO_PROFILER to
+ * compile all zones out.
+ * @param app   Wasabi application whose profiler records the zone
+ * @param name  Name of the zone
+ */
+#ifndef WASABI_NO_PROFILER
+#define W_PROFILE_ZONE(app, name) WCPUProfileZone W_PROFILE_ZONE_VAR(__LINE__)((app)->CPUProfiler, name)
+#define W_PROFILE_ZONE_VAR(line) W_PROFILE_ZONE_VAR2(line)
+#define W_PROFILE_ZONE_VAR2(line) _wProfileZone##line
+#else
+#define W_PROFILE_ZONE(app, name)
+#endif
+
+/** Statistics of the recorded frame times */
+struct W_CPU_FRAME_STATS {
+	/** Average frame time, in milliseconds */
+	double averageMs;
+	/** Minimum frame time, in milliseconds */
+	double minMs;
+	/** Median frame time, in milliseconds */
+	double medianMs;
+	/** 95th percentile of the frame time, in milliseconds */
+	double p95Ms;
+	/** 99th percentile of the frame time, in milliseconds */
+	double p99Ms;
+	/** Maximum frame time, in milliseconds */
+	double maxMs;
+	/** Number of the slowest frame (counting all frames) */
+	uint64_t slowestFrame;
+	/** Number of frames sampled (at most the "cpuProfilerWindow" engine parameter) */
+	uint32_t numFrames;
+	/** Number of zones lost because a thread's ring buffer overflowed */
+	uint64_t droppedZones;
+};
+
+/** Statistics of a profiled zone, per frame */
+struct W_CPU_ZONE_STATS {
+	/** Average time spent in the zone per frame (over all threads), in milliseconds */
+	double averageMs;
+	/** Maximum time spent in the zone in a frame, in milliseconds */
+	double maxMs;
+	/** Time spent in the zone in the last frame, in milliseconds */
+	double lastMs;
+	/** Average number of times the zone ran per frame */
+	double averageCalls;
+	/** Number of frames sampled */
+	uint32_t numFrames;
+};
+
+/**
+ * @ingroup engineclass
+ *
+ * A WCPUProfiler records the time spent in zones of code on every thread.
+ * Zones are usually recorded with the W_PROFILE_ZONE macro, which places a
+ * WCPUProfileZone on the stack. Each thread writes its zones to its own ring
+ * buffer without taking any lock, and the frame loop collects the buffers at
+ * the end of every frame (RunWasabi() calls BeginFrame() and EndFrame()).
+ *
+ * The profiler keeps rolling statistics of the frame time and of every zone
+ * and can export the last frames as a Chrome trace JSON file, which can be
+ * opened by chrome://tracing and Perfetto. Profiling is enabled with the
+ * "enableCPUProfiler" engine parameter or SetEnabled(), a disabled zone costs
+ * a single flag check.
+ */
+class WCPUProfiler {
+	friend class WCPUProfileZone;
+
+public:
+	WCPUProfiler();
+	~WCPUProfiler();
+
+	/**
+	 * Sets the sizes of the profiler's buffers.
+	 * @param threadBufferSize  Number of zones each thread can record between
+	 *                          two frames, rounded up to a power of 2
+	 * @param window            Number of frames over which statistics are
+	 *                          computed
+	 * @param traceFrames       Number of frames kept for WriteTrace()
+	 */
+	void Configure(uint32_t threadBufferSize, uint32_t window, uint32_t traceFrames);
+
+	/**
+	 * Enables or disables recording zones.
+	 * @param enable  true to enable profiling
+	 */
+	void SetEnabled(bool enable);
+
+	/**
+	 * @return true if zones are being recorded
+	 */
+	bool IsEnabled() const;
+
+	/**
+	 * Marks the beginning of a frame.
+	 */
+	void BeginFrame();
+
+	/**
+	 * Marks the end of the frame started by BeginFrame(), collecting the zones
+	 * recorded by all threads since the last frame.
+	 */
+	void EndFrame();
+
+	/**
+	 * Retrieves the statistics of the frame times.
+	 * @param  stats  Set to the frame statistics
+	 * @return        true if any frame has been recorded, false otherwise
+	 */
+	bool GetFrameStatistics(W_CPU_FRAME_STATS* stats) const;
+
+	/**
+	 * Retrieves the statistics of a zone.
+	 * @param  zoneName  Name of the zone
+	 * @param  stats     Set to the statistics of the zone
+	 * @return           true if the zone has been recorded, false otherwise
+	 */
+	bool GetZoneStatistics(const std::string& zoneName, W_CPU_ZONE_STATS* stats) const;
+
+	/**
+	 * Retrieves the statistics of all recorded zones.
+	 * @return Names of the zones and their statistics, sorted by name
+	 */
+	std::vector<std::pair<std::string, W_CPU_ZONE_STATS>> GetAllZoneStatistics() const;
+
+	/**
+	 * Clears all collected statistics and trace history.
+	 */
+	void ResetStatistics();
+
+	/**
+	 * Writes the zones of the last recorded frames (at most the
+	 * "cpuProfilerTraceFrames" engine parameter) to a file in the Chrome
+	 * trace event JSON format.
+	 * @param  filename  Name of the file to write
+	 * @return           Error code, see WError.h
+	 */
+	WError WriteTrace(std::string filename) const;
+
+	/**
+	 * @return Current time, in nanoseconds, of the clock used by the profiler
+	 */
+	static uint64_t Now();
+
+private:
+	/** A recorded zone */
+	struct ZONE_EVENT {
+		/** Name of the zone */
+		const char* name;
+		/** Start time, in nanoseconds */
+		uint64_t start;
+		/** End time, in nanoseconds */
+		uint64_t end;
+	};
+
+	/** Ring buffer of the zones recorded by one thread */
+	struct THREAD_BUFFER {
+		/** Thread writing to this buffer */
+		std::thread::id threadId;
+		/** Index of the thread in the trace */
+		uint32_t threadIndex;
+		/** Recorded zones, indexed by (zone number & (events.size() - 1)) */
+		std::vector<ZONE_EVENT> events;
+		/** Number of zones written so far, only incremented by the owning thread */
+		std::atomic<uint64_t> head;
+		/** Number of zones collected so far, only used by the collecting thread */
+		uint64_t tail;
+	};
+
+	/** A zone collected for trace export */
+	struct TRACE_EVENT {
+		/** Name of the zone */
+		const char* name;
+		/** Start time, in nanoseconds */
+		uint64_t start;
+		/** End time, in nanoseconds */
+		uint64_t end;
+		/** Index of the thread that recorded the zone */
+		uint32_t threadIndex;
+	};
+
+	/** Zones and bounds of a collected frame */
+	struct TRACE_FRAME {
+		/** Number of the frame */
+		uint64_t frameNumber;
+		/** Start time of the frame, in nanoseconds */
+		uint64_t start;
+		/** End time of the frame, in nanoseconds */
+		uint64_t end;
+		/** Zones collected at the end of the frame */
+		std::vector<TRACE_EVENT> events;
+	};
+
+	/** Rolling statistics of a zone */
+	struct ZONE_SAMPLES {
+		/** Ring of the last per-frame times, in milliseconds */
+		std::vector<double> times;
+		/** Ring of the last per-frame call counts */
+		std::vector<uint32_t> calls;
+		/** Time spent in the zone in the frame being collected, in nanoseconds */
+		uint64_t frameTime;
+		/** Calls to the zone in the frame being collected */
+		uint32_t frameCalls;
+	};
+
+	/** Unique ID of this profiler, identifies it in the threads' caches */
+	uint64_t m_id;
+	/** Whether zones are recorded */
+	std::atomic<bool> m_enabled;
+	/** Size of newly created thread buffers (a power of 2) */
+	uint32_t m_threadBufferSize;
+	/** Number of frames over which statistics are computed */
+	uint32_t m_window;
+	/** Number of frames kept for trace export */
+	uint32_t m_traceFrames;
+	/** Protects m_threads */
+	std::mutex m_threadsMutex;
+	/** Buffers of all the threads that recorded zones */
+	std::vector<THREAD_BUFFER*> m_threads;
+	/** Start time of the current frame, in nanoseconds */
+	uint64_t m_frameStart;
+	/** Number of frames recorded so far */
+	uint64_t m_frameCounter;
+	/** Number of frames recorded since the statistics were last reset */
+	uint64_t m_recordedFrames;
+	/** Ring of the last frame times, in milliseconds */
+	std::vector<double> m_frameTimes;
+	/** Numbers of the frames in m_frameTimes */
+	std::vector<uint64_t> m_frameNumbers;
+	/** Index in m_frameTimes to write the next frame time to */
+	uint32_t m_nextFrame;
+	/** Number of zones lost to ring buffer overflows */
+	uint64_t m_droppedZones;
+	/** Statistics of the zones, indexed by the values of m_zoneIndices */
+	std::vector<ZONE_SAMPLES> m_zones;
+	/** Maps zone name pointers to indices in m_zones */
+	std::unordered_map<const char*, uint32_t> m_zoneNamePointers;
+	/** Maps zone names to indices in m_zones (different pointers can share a name) */
+	std::map<std::string, uint32_t> m_zoneIndices;
+	/** The last m_traceFrames frames, oldest first */
+	std::deque<TRACE_FRAME> m_traceHistory;
+	/** Scratch buffer for the zones collected in a frame */
+	std::vector<TRACE_EVENT> m_collected;
+
+	/**
+	 * Retrieves (creating it on first use) the ring buffer of the calling
+	 * thread.
+	 * @return The calling thread's buffer
+	 */
+	THREAD_BUFFER* _GetThreadBuffer();
+
+	/**
+	 * Records a zone in the calling thread's buffer.
+	 * @param name   Name of the zone
+	 * @param start  Start time of the zone, in nanoseconds
+	 * @param end    End time of the zone, in nanoseconds
+	 */
+	void _RecordZone(const char* name, uint64_t start, uint64_t end);
+
+	/**
+	 * Retrieves the index in m_zones of a zone, adding it if it is new.
+	 * @param  name  Name of the zone
+	 * @return       Index of the zone in m_zones
+	 */
+	uint32_t _GetZoneIndex(const char* name);
+
+	/**
+	 * Frees the thread buffers.
+	 */
+	void _DestroyThreadBuffers();
+};
+
+/**
+ * A WCPUProfileZone records the time between its construction and its
+ * destruction as a zone of a WCPUProfiler, see W_PROFILE_ZONE.
+ */
+class WCPUProfileZone {
+public:
+	/**
+	 * @param profiler  Profiler to record the zone in, may be nullptr
+	 * @param name      Name of the zone, must outlive the profiler
+	 */
+	WCPUProfileZone(WCPUProfiler* profiler, const char* name) {
+		m_profiler = profiler && profiler->IsEnabled() ? profiler : nullptr;
+		if (m_profiler) {
+			m_name = name;
+			m_start = WCPUProfiler::Now();
+		}
+	}
+	~WCPUProfileZone() {
+		if (m_profiler)
+			m_profiler->_RecordZone(m_name, m_start, WCPUProfiler::Now());
+	}
+
+	WCPUProfileZone(const WCPUProfileZone&) = delete;
+	WCPUProfileZone& operator=(const WCPUProfileZone&) = delete;
+
+private:
+	/** Profiler recording the zone, nullptr if profiling is disabled */
+	WCPUProfiler* m_profiler;
+	/** Name of the zone */
+	const char* m_name;
+	/** Start time of the zone, in nanoseconds */
+	uint64_t m_start;
+};
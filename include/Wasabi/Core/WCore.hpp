@@ -19,6 +19,9 @@
 #include "Wasabi/Core/WBase.hpp"
 #include "Wasabi/Core/WOrientation.hpp"
 #include "Wasabi/Core/WUtilities.hpp"
+#include "Wasabi/Core/WCPUProfiler.hpp"
+#include "Wasabi/Core/WJobSystem.hpp"
+#include "Wasabi/Core/WTransformHierarchy.hpp"
 #include "Wasabi/Files/WFile.hpp"
 #include "Wasabi/Files/WAssimpImporter.hpp"
 #include "Wasabi/Memory/WVulkanMemoryManager.hpp"
@@ -56,6 +59,12 @@ public:
 		engineParams[paramName] = reinterpret_cast<void*>((size_t)(value));
 	}
 
+	/** Pointer to the CPU profiler, see W_PROFILE_ZONE */
+	class WCPUProfiler* CPUProfiler;
+	/** Pointer to the worker threads used to parallelize engine work */
+	class WJobSystem* JobSystem;
+	/** Pointer to the parent/child relations between WOrientations */
+	class WTransformHierarchy* TransformHierarchy;
 	/** Pointer to the vulkan memory manager */
 	class WVulkanMemoryManager* MemoryManager;
 	/** Pointer to the attached sound component */
@@ -199,12 +208,64 @@ public:
 	 */
 	VkQueue GetVulkanGraphicsQeueue() const;
 
+	/**
+	 * Retrieves the index of the queue family of the graphics queue.
+	 * @return The index of the graphics queue family
+	 */
+	uint32_t GetVulkanGraphicsQueueFamilyIndex() const;
+
+	/**
+	 * Retrieves the dedicated compute queue used for async compute (see
+	 * WRenderer::HasAsyncCompute()).
+	 * @return The Vulkan compute queue, VK_NULL_HANDLE if the device has no
+	 *         compute queue family separate from the graphics one, if its
+	 *         only queue is used for uploads (see "enableTransferQueue"), or
+	 *         if "enableAsyncCompute" is false
+	 */
+	VkQueue GetVulkanComputeQueue() const;
+
+	/**
+	 * Retrieves the index of the queue family of the compute queue.
+	 * @return The index of the compute queue family, only valid if
+	 *         GetVulkanComputeQueue() is not VK_NULL_HANDLE
+	 */
+	uint32_t GetVulkanComputeQueueFamilyIndex() const;
+
+	/**
+	 * Retrieves vkCmdDrawIndexedIndirectCountKHR, which reads the number of
+	 * indirect draws from a buffer (see WGeometry::DrawIndirect()).
+	 * @return The function, nullptr if the device doesn't support
+	 *         VK_KHR_draw_indirect_count
+	 */
+	PFN_vkCmdDrawIndexedIndirectCountKHR GetVulkanDrawIndexedIndirectCount() const;
+
 	/**
 	 * Retrieves the currently used swap chain.
 	 * @return The swap chain
 	 */
 	VulkanSwapChain* GetSwapChain();
 
+	/**
+	 * Retrieves the pipeline cache shared by all pipelines the engine creates.
+	 * The cache is seeded from the file at GetPipelineCachePath() during
+	 * StartEngine() (if the file was written by the same device and driver)
+	 * and written back to it when the engine shuts down.
+	 * @return The Vulkan pipeline cache
+	 */
+	VkPipelineCache GetPipelineCache() const;
+
+	/**
+	 * Retrieves the path of the file the pipeline cache is persisted to. A
+	 * relative "pipelineCacheFile" engine parameter is placed in the
+	 * "pipelineCacheDirectory" engine parameter, or if that is not set, in a
+	 * directory named after "appName" in the user's cache directory
+	 * (%LOCALAPPDATA% on Windows, ~/Library/Caches on macOS and
+	 * $XDG_CACHE_HOME or ~/.cache elsewhere).
+	 * @return The path of the pipeline cache file, empty if the cache is not
+	 *         persisted
+	 */
+	std::string GetPipelineCachePath();
+
 protected:
 	/**
 	 * Creates and initializes a VkInstance to use in the engine.
@@ -283,10 +344,20 @@ protected:
 	VkDevice m_vkDevice;
 	/** The used graphics queue */
 	VkQueue m_graphicsQueue;
+	/** Index of the queue family of m_graphicsQueue */
+	uint32_t m_graphicsQueueFamilyIndex;
+	/** The dedicated compute queue, VK_NULL_HANDLE if none */
+	VkQueue m_computeQueue;
+	/** Index of the queue family of m_computeQueue */
+	uint32_t m_computeQueueFamilyIndex;
+	/** vkCmdDrawIndexedIndirectCountKHR, nullptr if VK_KHR_draw_indirect_count is not supported */
+	PFN_vkCmdDrawIndexedIndirectCountKHR m_vkCmdDrawIndexedIndirectCount;
 	/** The swap chain */
 	VulkanSwapChain m_swapChain;
 	/** true if the swap chain has been initialized yet, false otherwise */
 	bool m_swapChainInitialized;
+	/** Pipeline cache shared by all pipelines */
+	VkPipelineCache m_pipelineCache;
 
 	/** Handle to the debugging callback created in debug mode */
 	VkDebugReportCallbackEXT m_debugCallback;
@@ -299,8 +370,10 @@ protected:
 	 *    while in debug mode. Default is (void*)(false).
 	 * * "bufferingCount": Buffering count, usually double (2) or triple (3) is
 	 *                     used. Buffering defines the maximum number of frames
-	 *                     that can be all in-flight (rendering) at the same time.
-	 *                     Default is 2.
+	 *                     that can be all in-flight (rendering) at the same time,
+	 *                     i.e. how far the CPU can record ahead of the GPU. It
+	 *                     is also the number of swap chain images requested,
+	 *                     the swap chain may have more. Default is 2.
 	 * * "fontBmpSize": The size of the font bitmap when a new font is created.
 	 * 		default is (void*)(512).
 	 * * "fontBmpCharHeight": The height of each character when a new font bitmap
@@ -314,6 +387,77 @@ protected:
 	 * 		attributes). Default is (void*)(false).
 	 * * "numGeneratedMips": Number of mipmaps to generate when a new image is
 	 * 		crated. Default is (void*)(1).
+	 * * "enableTransferQueue": Whether or not to upload resources on a dedicated
+	 * 		transfer queue if the device has one. Default is (void*)(true).
+	 * * "enableAsyncCompute": Whether or not to create a dedicated compute
+	 * 		queue for async compute (see WRenderer::HasAsyncCompute()) if the
+	 * 		device has a compute queue family separate from the graphics one
+	 * 		and a queue in it that is not used for uploads.
+	 * 		Default is (void*)(true).
+	 * * "uploadStagingSize": Size, in bytes, of the staging ring used to upload
+	 * 		resources. Default is (void*)(16 * 1024 * 1024).
+	 * * "frameRingSize": Initial size, in bytes, of the per-frame rings used
+	 * 		for transient host-visible memory (grows as needed). Default is
+	 * 		(void*)(4 * 1024 * 1024).
+	 * * "pipelineCacheFile": Path of the file the pipeline cache is loaded
+	 * 		from at startup and saved to at shutdown, relative to
+	 * 		"pipelineCacheDirectory" (see GetPipelineCachePath()), nullptr to
+	 * 		disable persisting the cache. Default is
+	 * 		(void*)"PipelineCache.bin".
+	 * * "pipelineCacheDirectory": Directory of a relative "pipelineCacheFile",
+	 * 		nullptr to use the application's directory in the user's cache
+	 * 		directory. Default is (void*)nullptr.
+	 * * "headless": When set to true, no window or swapchain is created and
+	 * 		frames are rendered to a ring of offscreen images and never
+	 * 		presented. Default is (void*)(false).
+	 * * "headlessReadback": When set to true (and "headless" is set), the
+	 * 		final image of every frame is copied to host memory, see
+	 * 		WRenderer::GetHeadlessFrame(). Default is (void*)(false).
+	 * * "maxFrames": When greater than 0, the engine exits after rendering this
+	 * 		many frames and prints a summary of the frame times. Default is
+	 * 		(void*)(0).
+	 * * "enableGPUProfiler": Whether or not the renderer measures the GPU time
+	 * 		of the frame, render stages and render fragments, see WGPUProfiler.
+	 * 		Default is (void*)(false).
+	 * * "gpuProfilerMaxScopes": Maximum number of scopes measured per frame by
+	 * 		the GPU profiler. Default is (void*)(128).
+	 * * "gpuProfilerWindow": Number of frames over which the GPU profiler
+	 * 		computes its statistics. Default is (void*)(120).
+	 * * "gpuProfilerTraceFrames": Number of frames the GPU profiler keeps for
+	 * 		WGPUProfiler::WriteTrace(). Default is (void*)(300).
+	 * * "enableCPUProfiler": Whether or not CPUProfiler records zones (see
+	 * 		W_PROFILE_ZONE). Default is (void*)(false).
+	 * * "cpuProfilerThreadBufferSize": Number of zones each thread can record
+	 * 		per frame before the oldest ones are lost. Default is
+	 * 		(void*)(4096).
+	 * * "cpuProfilerWindow": Number of frames over which the CPU profiler
+	 * 		computes its statistics. Default is (void*)(1000).
+	 * * "cpuProfilerTraceFrames": Number of frames the CPU profiler keeps for
+	 * 		WCPUProfiler::WriteTrace(). Default is (void*)(300).
+	 * * "numWorkerThreads": Number of worker threads JobSystem starts, -1 to
+	 * 		use one less than the number of hardware threads. Default is
+	 * 		(void*)(-1).
+	 * * "parallelRecording": Set to true to let render targets record draws
+	 * 		on the JobSystem workers (see WRenderTarget::RecordInParallel()).
+	 * 		Has no effect without workers. Default is (void*)(true).
+	 * * "indirectDrawing": Set to true to draw static objects of the default
+	 * 		renderers in batches using indirect draws (see
+	 * 		WObjectsRenderFragment::SetIndirectEffect()). Default is
+	 * 		(void*)(true).
+	 * * "gpuFrustumCulling": Set to true to frustum cull the static objects
+	 * 		drawn in batches by the default renderers on the GPU instead of
+	 * 		the CPU (see WObjectsRenderFragment::SetFrustumCuller()). Default
+	 * 		is (void*)(true).
+	 * * "occlusionCulling": Set to true to occlusion cull the static objects
+	 * 		drawn in batches by the deferred renderer on the GPU (see
+	 * 		WObjectsRenderFragment::SetOcclusionCuller()). Default is
+	 * 		(void*)(true).
+	 * * "softwareOcclusionCulling": Set to true to occlusion cull the objects
+	 * 		of the default renderers on the CPU against their occluders (see
+	 * 		WObjectsRenderFragment::GetSoftwareOcclusionCuller()). Default is
+	 * 		(void*)(false).
+	 * Setting the WASABI_HEADLESS_FRAMES environment variable to N > 0 sets
+	 * "headless" to true and "maxFrames" to N.
 	 */
 	std::map<std::string, void*> engineParams;
 
@@ -321,6 +465,20 @@ protected:
 	 * Destroys all resources of the engine.
 	 */
 	void _DestroyResources();
+
+	/**
+	 * Creates m_pipelineCache, seeding it with the contents of the
+	 * "pipelineCacheFile" file if that file is valid for the current device
+	 * and driver.
+	 * @return Error code, see WError.h
+	 */
+	WError _CreatePipelineCache();
+
+	/**
+	 * Writes the contents of m_pipelineCache to the GetPipelineCachePath()
+	 * file, creating its directory if needed.
+	 */
+	void _SavePipelineCache();
 };
 
 /**
@@ -443,6 +601,7 @@ Wasabi* WInitialize();
  * Runs a Wasabi instance. This function blocks until the instance quits.
  * This function will run the message loop and render frames and do everything
  * required to run the engine in the right environment.
+ * @return 0 on success, 1 if Wasabi::Setup() failed
  */
 int RunWasabi(Wasabi* app);
 
@@ -0,0 +1,108 @@
+/** @file WJobSystem.hpp
+ *  @brief Pool of worker threads for data-parallel engine work
+ *
+ *  The job system keeps a fixed set of worker threads alive for the lifetime
+ *  of the engine and splits loops over them, so that engine systems (and
+ *  applications) can spread independent work across cores without creating
+ *  threads every frame.
+ *
+ *  @author Hasan Al-Jawaheri (hbj)
+ *  @bug No known bugs.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @ingroup engineclass
+ *
+ * A WJobSystem owns a pool of worker threads that execute ParallelFor() loops
+ * together with the calling thread. The number of workers is set by the
+ * "numWorkerThreads" engine parameter when the engine starts (see
+ * Wasabi::StartEngine()). With no workers, or when ParallelFor() is called
+ * from inside a job, the loop simply runs on the calling thread.
+ */
+class WJobSystem {
+public:
+	WJobSystem();
+	~WJobSystem();
+
+	/**
+	 * Stops the current workers and starts a new set of workers.
+	 * @param numWorkers  Number of worker threads to start (in addition to the
+	 *                    threads calling ParallelFor())
+	 */
+	void Configure(uint32_t numWorkers);
+
+	/**
+	 * @return Number of worker threads
+	 */
+	uint32_t GetNumWorkers() const;
+
+	/**
+	 * Retrieves the index of the calling thread, which can be used to pick
+	 * per-thread resources inside ParallelFor() loops.
+	 * @return 1 to GetNumWorkers() for the worker threads, 0 for any other
+	 *         thread (such as the thread calling ParallelFor())
+	 */
+	uint32_t GetCurrentThreadIndex() const;
+
+	/**
+	 * Runs fn over the range [0, count), split into chunks of consecutive
+	 * indices that are executed in parallel by the workers and the calling
+	 * thread. The function returns once all chunks are done. fn must be safe
+	 * to call concurrently for different chunks.
+	 * @param count     Number of indices to run fn over
+	 * @param minChunk  Minimum number of indices per chunk, chunks are made
+	 *                  larger when there are many indices per thread
+	 * @param fn        Function called with the range [begin, end) of every
+	 *                  chunk
+	 */
+	void ParallelFor(uint32_t count, uint32_t minChunk, const std::function<void(uint32_t begin, uint32_t end)>& fn);
+
+private:
+	/** Parameters of the loop being executed */
+	struct JOB {
+		const std::function<void(uint32_t, uint32_t)>* fn;
+		uint32_t count;
+		uint32_t chunkSize;
+		uint32_t numChunks;
+	};
+
+	/** Worker threads */
+	std::vector<std::thread> m_workers;
+	/** Serializes ParallelFor() calls from different threads */
+	std::mutex m_submitMutex;
+	/** Protects the members below (except the atomics) */
+	std::mutex m_mutex;
+	/** Signaled when a job is submitted or the workers must stop */
+	std::condition_variable m_wakeCondition;
+	/** Signaled when a job's chunks are done or a worker goes idle */
+	std::condition_variable m_doneCondition;
+	/** Current job */
+	JOB m_job;
+	/** Incremented for every submitted job */
+	uint64_t m_generation;
+	/** Number of workers currently running chunks */
+	uint32_t m_activeWorkers;
+	/** true when the workers must exit */
+	bool m_stop;
+	/** Next chunk of m_job to be picked */
+	std::atomic<uint32_t> m_nextChunk;
+	/** Number of chunks of m_job that are done */
+	std::atomic<uint32_t> m_completedChunks;
+
+	/** Stops and joins all workers */
+	void _Stop();
+	/** Main function of a worker thread, index is its thread index (see GetCurrentThreadIndex()) */
+	void _WorkerLoop(uint32_t index);
+	/** Picks and runs chunks of job until none is left */
+	void _RunChunks(const JOB& job);
+};
@@ -18,6 +18,7 @@
 #include <iostream>
 #include <functional>
 #include <unordered_map>
+#include <cstdint>
 using std::ios;
 using std::vector;
 using std::string;
@@ -28,8 +29,23 @@ using std::unordered_map;
 #define fmax(a,b) ((a) > (b) ? (a) : (b))
 #endif
 
-#define W_HASHTABLESIZE 512
-#define W_HASH(id) id == 0 ? 0 : fmax(id % W_HASHTABLESIZE, 1)
+/**
+ * A stable handle to an entity registered in a WManager. Unlike a pointer, a
+ * handle to a removed entity is detected as stale (the manager returns nullptr
+ * for it), even if its slot got reused by another entity.
+ */
+struct WManagerHandle {
+	/** Index of the slot in the manager's slot map */
+	uint32_t index;
+	/** Generation of the slot at the time the handle was issued */
+	uint32_t generation;
+
+	WManagerHandle() : index(UINT32_MAX), generation(0) {}
+	WManagerHandle(uint32_t i, uint32_t g) : index(i), generation(g) {}
+
+	bool operator==(const WManagerHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const WManagerHandle& other) const { return !(*this == other); }
+};
 
 /**
  * @ingroup engineclass
@@ -39,12 +55,39 @@ using std::unordered_map;
  * manages, as long as the class makes sure it registers itself (usually in
  * its constructor) and removes itself upon destruction (usually in its
  * destructor).
+ *
+ * Entities are stored in a generational slot map: m_entities is a dense,
+ * unordered array of all registered entities (iterated using begin()/end()
+ * or GetEntityByIndex()), and every entity owns a slot that maps its handle
+ * to its position in the dense array. Removing an entity moves the last
+ * entity into its place, so the order of iteration is not preserved when
+ * entities are removed. Loops that may remove entities while iterating
+ * (e.g. updates that can destroy the entity being updated) should iterate
+ * backwards by index, see GetEntityByIndex().
  */
 template<typename T>
 class WManager {
 protected:
-	/** a hash table of all entities registered */
-	std::vector<T*> m_entities[W_HASHTABLESIZE];
+	/** A slot in the slot map */
+	struct SLOT {
+		/** Index of the entity in m_entities, if the slot is used */
+		uint32_t denseIndex;
+		/** Incremented every time the slot is freed, invalidating its old handles */
+		uint32_t generation;
+	};
+
+	/** All registered entities, densely packed */
+	std::vector<T*> m_entities;
+	/** Slot index of every entity in m_entities */
+	std::vector<uint32_t> m_entitySlots;
+	/** The slot map */
+	std::vector<SLOT> m_slots;
+	/** Indices of unused slots in m_slots */
+	std::vector<uint32_t> m_freeSlots;
+	/** Slot index of every registered entity */
+	std::unordered_map<T*, uint32_t> m_slotsByEntity;
+	/** Registered entities by ID (entities with ID 0 are not included) */
+	std::unordered_multimap<uint32_t, T*> m_entitiesByID;
 	std::unordered_map<std::string, T*> m_entitiesByName;
 
 	/**
@@ -55,16 +98,26 @@ protected:
 	 */
 	virtual std::string GetTypeName() const = 0;
 
+	/**
+	 * Removes a reference from every registered entity until all of them are
+	 * destroyed (and removed themselves from the manager).
+	 */
+	void _ReleaseEntities() {
+		while (m_entities.size() > 0)
+			m_entities.back()->RemoveReference();
+	}
+
 public:
+	/** Iterator over the registered entities */
+	typedef typename std::vector<T*>::const_iterator const_iterator;
+
 	/** Pointer to the Wasabi instance that made this manager */
 	class Wasabi* const m_app;
 
 	WManager(class Wasabi* const a) : m_app(a) { __bDbgDestructing = false; }
 	virtual ~WManager() {
 		__bDbgDestructing = true;
-		for (uint32_t j = 0; j < W_HASHTABLESIZE; j++)
-			for (uint32_t i = 0; i < m_entities[j].size();)
-				m_entities[j][i]->RemoveReference();
+		_ReleaseEntities();
 	}
 
 	/**
@@ -98,9 +151,25 @@ public:
 	 * @param entity Pointer to the entity to register
 	 */
 	void AddEntity(T* entity) {
-		if (!entity)
+		if (!entity || m_slotsByEntity.find(entity) != m_slotsByEntity.end())
 			return;
-		m_entities[W_HASH(entity->GetID())].push_back(entity);
+
+		uint32_t slot;
+		if (m_freeSlots.size() > 0) {
+			slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		} else {
+			slot = static_cast<uint32_t>(m_slots.size());
+			m_slots.push_back(SLOT());
+			m_slots[slot].generation = 0;
+		}
+		m_slots[slot].denseIndex = static_cast<uint32_t>(m_entities.size());
+		m_entities.push_back(entity);
+		m_entitySlots.push_back(slot);
+		m_slotsByEntity.insert(std::make_pair(entity, slot));
+		if (entity->GetID() != 0)
+			m_entitiesByID.insert(std::make_pair(entity->GetID(), entity));
+
 		std::cout << "[" << GetTypeName() << " " << entity->GetID() << "] Added to the manager.\n";
 		for (auto it = m_changeCallbacks.begin(); it != m_changeCallbacks.end(); it++)
 			it->second(entity, true);
@@ -113,25 +182,45 @@ public:
 	 *                otherwise
 	 */
 	bool RemoveEntity(T* entity) {
-		uint32_t tableIndex = W_HASH(entity->GetID());
-		for (uint32_t i = 0; i < m_entities[tableIndex].size(); i++) {
-			if (m_entities[tableIndex][i] == entity)
-			{
-				if (!__bDbgDestructing)
-					std::cout << "[" << GetTypeName() << " " << entity->GetID() << "] Removed from manager.\n";
-
-				m_entities[tableIndex].erase(m_entities[tableIndex].begin() + i);
-
-				auto entityIt = m_entitiesByName.find(entity->GetName());
-				if (entityIt != m_entitiesByName.end())
-					m_entitiesByName.erase(entityIt);
-
-				for (auto it = m_changeCallbacks.begin(); it != m_changeCallbacks.end(); it++)
-					it->second(entity, false);
-				return true;
+		auto slotIt = m_slotsByEntity.find(entity);
+		if (slotIt == m_slotsByEntity.end())
+			return false;
+
+		if (!__bDbgDestructing)
+			std::cout << "[" << GetTypeName() << " " << entity->GetID() << "] Removed from manager.\n";
+
+		// move the last entity into the removed entity's place and free its slot
+		uint32_t slot = slotIt->second;
+		uint32_t denseIndex = m_slots[slot].denseIndex;
+		uint32_t lastIndex = static_cast<uint32_t>(m_entities.size()) - 1;
+		if (denseIndex != lastIndex) {
+			m_entities[denseIndex] = m_entities[lastIndex];
+			m_entitySlots[denseIndex] = m_entitySlots[lastIndex];
+			m_slots[m_entitySlots[denseIndex]].denseIndex = denseIndex;
+		}
+		m_entities.pop_back();
+		m_entitySlots.pop_back();
+		m_slots[slot].generation++;
+		m_freeSlots.push_back(slot);
+		m_slotsByEntity.erase(slotIt);
+
+		if (entity->GetID() != 0) {
+			auto range = m_entitiesByID.equal_range(entity->GetID());
+			for (auto it = range.first; it != range.second; it++) {
+				if (it->second == entity) {
+					m_entitiesByID.erase(it);
+					break;
+				}
 			}
 		}
-		return false;
+
+		auto entityIt = m_entitiesByName.find(entity->GetName());
+		if (entityIt != m_entitiesByName.end())
+			m_entitiesByName.erase(entityIt);
+
+		for (auto it = m_changeCallbacks.begin(); it != m_changeCallbacks.end(); it++)
+			it->second(entity, false);
+		return true;
 	}
 
 	void OnEntityNameChanged(T* entity, std::string oldName) {
@@ -155,11 +244,11 @@ public:
 	 * @return    The registered object, nullptr if its not found
 	 */
 	T* GetEntity(uint32_t ID) const {
-		uint32_t tableIndex = W_HASH(ID);
-		if (tableIndex) //ID 0 is not searched for
-			for (uint32_t i = 0; i < m_entities[tableIndex].size(); i++)
-				if (m_entities[tableIndex][i]->GetID() == ID)
-					return m_entities[tableIndex][i];
+		if (ID != 0) { //ID 0 is not searched for
+			auto it = m_entitiesByID.find(ID);
+			if (it != m_entitiesByID.end())
+				return it->second;
+		}
 		return nullptr;
 	}
 
@@ -176,16 +265,49 @@ public:
 	}
 
 	/**
-	 * Retrieves a registered entity using its index into the hashtable.
+	 * Retrieves a registered entity using its handle.
+	 * @param  handle Handle of the object, as returned by GetHandle()
+	 * @return        The registered object, nullptr if the handle is stale
+	 *                (the entity was removed) or invalid
+	 */
+	T* GetEntity(WManagerHandle handle) const {
+		if (handle.index < m_slots.size() && m_slots[handle.index].generation == handle.generation)
+			return m_entities[m_slots[handle.index].denseIndex];
+		return nullptr;
+	}
+
+	/**
+	 * Retrieves a stable handle to a registered entity. The handle remains
+	 * valid until the entity is removed from the manager (which also happens
+	 * when its ID is changed).
+	 * @param  entity A registered entity
+	 * @return        The handle of entity, or an invalid handle if it is not
+	 *                registered
+	 */
+	WManagerHandle GetHandle(T* entity) const {
+		auto it = m_slotsByEntity.find(entity);
+		if (it != m_slotsByEntity.end())
+			return WManagerHandle(it->second, m_slots[it->second].generation);
+		return WManagerHandle();
+	}
+
+	/**
+	 * Retrieves a registered entity using its index in the manager. Indices
+	 * are in the range [0, GetEntitiesCount()) and may change when entities
+	 * are removed: the last entity takes the index of the removed one. A loop
+	 * going from GetEntitiesCount() - 1 down to 0 is therefore not disturbed
+	 * by removing the current entity, since only entities it already visited
+	 * move:
+	 * @code
+	 * for (uint32_t i = manager->GetEntitiesCount(); i-- > 0;)
+	 * 	manager->GetEntityByIndex(i)->Update(); // may remove itself
+	 * @endcode
 	 * @param  index Index of the object to retrieve
 	 * @return       The registered object, nullptr if its not found
 	 */
 	T* GetEntityByIndex(uint32_t index) const {
-		for (uint32_t j = 0; j < W_HASHTABLESIZE; j++) {
-			if (index < m_entities[j].size())
-				return m_entities[j][index];
-			index -= static_cast<uint32_t>(m_entities[j].size());
-		}
+		if (index < m_entities.size())
+			return m_entities[index];
 		return nullptr;
 	}
 
@@ -194,10 +316,24 @@ public:
 	 * @return  Number of registered entities
 	 */
 	uint32_t GetEntitiesCount(void) const {
-		uint32_t size = 0;
-		for (uint32_t j = 0; j < W_HASHTABLESIZE; j++)
-			size += static_cast<uint32_t>(m_entities[j].size());
-		return size;
+		return static_cast<uint32_t>(m_entities.size());
+	}
+
+	/**
+	 * Retrieves an iterator to the first registered entity. Iterators are
+	 * invalidated when entities are added or removed.
+	 * @return  Iterator to the first registered entity
+	 */
+	const_iterator begin() const {
+		return m_entities.begin();
+	}
+
+	/**
+	 * Retrieves an iterator past the last registered entity.
+	 * @return  Iterator past the last registered entity
+	 */
+	const_iterator end() const {
+		return m_entities.end();
 	}
 
 private:
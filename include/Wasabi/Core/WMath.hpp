@@ -645,6 +645,35 @@ WMatrix WMatrixTranspose(const WMatrix m);
  */
 WMatrix WMatrixInverse(const WMatrix m);
 
+/**
+ * Invert an affine matrix (a matrix whose last column is (0, 0, 0, 1), such
+ * as any combination of scaling, rotation and translation). This is cheaper
+ * than WMatrixInverse().
+ * @param  m Affine matrix to invert
+ * @return   Inverse of m
+ */
+WMatrix WMatrixInverseAffine(const WMatrix m);
+
+/**
+ * Invert a rigid transformation (a matrix whose upper 3x3 part is an
+ * orthonormal rotation and whose last column is (0, 0, 0, 1), i.e. a
+ * rotation followed by a translation). The inverse is computed with a
+ * transpose, so this is the cheapest of the inverse functions.
+ * @param  m Rigid transformation to invert
+ * @return   Inverse of m
+ */
+WMatrix WMatrixInverseOrthonormal(const WMatrix m);
+
+/**
+ * Multiplies an array of matrices by a matrix, setting out[i] to in[i] * m.
+ * This is faster than multiplying the matrices one at a time.
+ * @param out   Array to receive the count products, may be the same as in
+ * @param in    Array of count matrices to multiply
+ * @param count Number of matrices
+ * @param m     Matrix to multiply by
+ */
+void WMatrixMultiplyArray(WMatrix* out, const WMatrix* in, uint32_t count, const WMatrix& m);
+
 /**
  * Dot product of two 2D vectors.
  * @param  v1 First vector
@@ -787,6 +816,28 @@ WVector3 WVec3TransformCoord(const WVector3 v, const WMatrix m);
  */
 WVector3 WVec3TransformNormal(const WVector3 v, const WMatrix m);
 
+/**
+ * Transform an array of 3D points by a matrix, setting out[i] to
+ * WVec3TransformCoord(in[i], m).
+ * @param out   Array to receive the count transformed points, may be the same
+ *              as in
+ * @param in    Array of count points to transform
+ * @param count Number of points
+ * @param m     Matrix to transform by
+ */
+void WVec3TransformCoordArray(WVector3* out, const WVector3* in, uint32_t count, const WMatrix& m);
+
+/**
+ * Transform an array of 3D normals by a matrix, setting out[i] to
+ * WVec3TransformNormal(in[i], m).
+ * @param out   Array to receive the count transformed normals, may be the
+ *              same as in
+ * @param in    Array of count normals to transform
+ * @param count Number of normals
+ * @param m     Matrix to transform by
+ */
+void WVec3TransformNormalArray(WVector3* out, const WVector3* in, uint32_t count, const WMatrix& m);
+
 /**
  * Dot product of two 4D vectors.
  * @param  v1 First vector
@@ -833,6 +884,52 @@ WVector4 WVec4Lerp(const WVector4 v1, const WVector4 v2, const float fLerpVal);
  */
 WVector4 WVec4Transform(const WVector4 v, const WMatrix m);
 
+/**
+ * Transform an array of 4D vectors by a matrix, setting out[i] to
+ * WVec4Transform(in[i], m).
+ * @param out   Array to receive the count transformed vectors, may be the
+ *              same as in
+ * @param in    Array of count vectors to transform
+ * @param count Number of vectors
+ * @param m     Matrix to transform by
+ */
+void WVec4TransformArray(WVector4* out, const WVector4* in, uint32_t count, const WMatrix& m);
+
+/**
+ * Multiplies two quaternions. Rotating by the result is the same as rotating
+ * by q2 then by q1.
+ * @param  q1 First quaternion
+ * @param  q2 Second quaternion
+ * @return    The product q1 * q2
+ */
+WQuaternion WQuatMultiply(const WQuaternion q1, const WQuaternion q2);
+
+/**
+ * Conjugates a quaternion, which inverts the rotation of a unit quaternion.
+ * @param  q Quaternion to conjugate
+ * @return   The conjugate of q
+ */
+WQuaternion WQuatConjugate(const WQuaternion q);
+
+/**
+ * Rotates a 3D vector by a unit quaternion.
+ * @param  v Vector to rotate
+ * @param  q Unit quaternion to rotate by
+ * @return   The rotated vector
+ */
+WVector3 WVec3Rotate(const WVector3 v, const WQuaternion q);
+
+/**
+ * Rotates an array of 3D vectors by a unit quaternion, setting out[i] to
+ * WVec3Rotate(in[i], q).
+ * @param out   Array to receive the count rotated vectors, may be the same as
+ *              in
+ * @param in    Array of count vectors to rotate
+ * @param count Number of vectors
+ * @param q     Unit quaternion to rotate by
+ */
+void WVec3RotateArray(WVector3* out, const WVector3* in, uint32_t count, const WQuaternion q);
+
 /**
  * Creates a matrix that performs a rotation on the X axis.
  * @param  fAngle Angle of rotation, in radians
@@ -49,6 +49,8 @@ inline STATE_CHANGE_TYPE& operator &= (STATE_CHANGE_TYPE& lhs, STATE_CHANGE_TYPE
  * accurately represent an object's orientation without conflicts.
  */
 class WOrientation {
+	friend class WTransformHierarchy;
+
 public:
 	WOrientation();
 	virtual ~WOrientation();
@@ -228,13 +230,16 @@ public:
 	 * Binds this entity to the matrix provided. A WOrientation that is bound
 	 * to a matrix may choose to alter the final matrix it produces (multiply
 	 * it by the binding matrix) to achieve the effect of being "bound" or
-	 * "stuck" to something else as it moves.
+	 * "stuck" to something else as it moves. This will result in calling
+	 * OnStateChange(CHANGE_MOTION). The binding matrix of a WOrientation that
+	 * has a parent in the WTransformHierarchy is set by the hierarchy.
 	 * @param mtx Matrix to bind to
 	 */
 	virtual void SetBindingMatrix(WMatrix mtx);
 
 	/**
-	 * Removes or disables the current binding
+	 * Removes or disables the current binding. This will result in calling
+	 * OnStateChange(CHANGE_MOTION) if the entity was bound.
 	 */
 	void RemoveBinding();
 
@@ -260,21 +265,54 @@ public:
 	virtual void OnStateChange(STATE_CHANGE_TYPE type);
 
 	/**
-	 * This function recomputes the transformation matrix for this orientation.
-	 * Most objects inheriting from WOrientation have their own GetWorldMatrix
-	 * functions that are more efficient to use (since they cache the matrix).
-	 * @return returns a newly computed matrix corresponding to this orientation
+	 * Retrieves the transformation (world) matrix for this orientation. The
+	 * matrix is cached and only rebuilt after the orientation changes. The
+	 * binding matrix is not applied.
+	 * @return The matrix corresponding to this orientation
 	 */
 	WMatrix ComputeTransformation() const;
 
 	/**
-	 * This function recomputes the transformation matrix for this orientation.
-	 * Most objects inheriting from WOrientation have their own GetWorldMatrix
-	 * functions that are more efficient to use (since they cache the matrix).
-	 * @return returns a newly computed matrix corresponding to this orientation
+	 * Retrieves the inverse of the transformation matrix for this orientation
+	 * (the view matrix). Like ComputeTransformation(), the matrix is cached.
+	 * Since the axes are orthonormal, it is built directly rather than with
+	 * a general matrix inverse.
+	 * @return The inverse of the matrix corresponding to this orientation
 	 */
 	WMatrix ComputeInverseTransformation() const;
 
+	/**
+	 * Computes the world transformation of this orientation: the
+	 * transformation (see ComputeTransformation()) followed by the binding
+	 * matrix if the entity is bound (which includes the parent's world
+	 * transformation if the entity has a parent in the WTransformHierarchy).
+	 * @return The world transformation of this orientation
+	 */
+	WMatrix ComputeWorldTransformation() const;
+
+	/**
+	 * Retrieves the position of this orientation in world space, which is the
+	 * same as GetPosition() unless the entity is bound.
+	 * @return The world space position
+	 */
+	WVector3 GetWorldPosition() const;
+
+	/**
+	 * Retrieves the look vector of this orientation in world space, which is
+	 * the same as GetLVector() unless the entity is bound.
+	 * @return The world space look vector
+	 */
+	WVector3 GetWorldLVector() const;
+
+	/**
+	 * Retrieves the version of this orientation, a counter that changes
+	 * whenever the position, rotation or binding changes. Consumers can
+	 * remember the version they last processed and skip work if it did not
+	 * change.
+	 * @return The current version of this orientation
+	 */
+	uint32_t GetVersion() const;
+
 private:
 	/** Position of this entity */
 	WVector3 m_pos;
@@ -288,4 +326,24 @@ private:
 	bool m_bBind;
 	/** Binding matrix, should be valid is m_bBind is true */
 	WMatrix m_bindMtx;
+	/** Incremented whenever the position, rotation or binding changes */
+	uint32_t m_version;
+	/** Cached result of ComputeTransformation() */
+	mutable WMatrix m_transformation;
+	/** Cached result of ComputeInverseTransformation() */
+	mutable WMatrix m_inverseTransformation;
+	/** true if m_transformation needs to be rebuilt */
+	mutable bool m_transformationDirty;
+	/** true if m_inverseTransformation needs to be rebuilt */
+	mutable bool m_inverseTransformationDirty;
+	/** Hierarchy this entity is a node of, nullptr if it has no parent or children */
+	class WTransformHierarchy* m_hierarchy;
+
+	/**
+	 * Invalidates the cached matrices, bumps the version and calls
+	 * OnStateChange(). Called by all the functions that change the
+	 * orientation.
+	 * @param type Orientation change type
+	 */
+	void _OnChanged(STATE_CHANGE_TYPE type);
 };
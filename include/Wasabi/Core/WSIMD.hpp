@@ -0,0 +1,28 @@
+/** @file WSIMD.hpp
+ *  @brief Compile-time selection of the SIMD instruction set
+ *
+ *  Engine code with SIMD paths includes this header and checks the macros it
+ *  defines:
+ *  * W_SIMD_SSE: SSE2 is available (always the case on x86-64)
+ *  * W_SIMD_AVX: AVX is available as well (if the compiler targets it)
+ *  * W_SIMD_NEON: NEON is available (ARM)
+ *  If none is defined (or WASABI_NO_SIMD is defined), the scalar code is
+ *  used.
+ *
+ *  @author Hasan Al-Jawaheri (hbj)
+ *  @bug No known bugs.
+ */
+
+#pragma once
+
+#if !defined(WASABI_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define W_SIMD_SSE
+#include <emmintrin.h>
+#if defined(__AVX__)
+#define W_SIMD_AVX
+#include <immintrin.h>
+#endif
+#elif !defined(WASABI_NO_SIMD) && (defined(__ARM_NEON) || defined(_M_ARM64))
+#define W_SIMD_NEON
+#include <arm_neon.h>
+#endif
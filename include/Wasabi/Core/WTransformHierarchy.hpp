@@ -0,0 +1,140 @@
+/** @file WTransformHierarchy.hpp
+ *  @brief Parent/child relations between WOrientations
+ *
+ *  The transform hierarchy lets any WOrientation (objects, lights, cameras,
+ *  particle emitters, rigid bodies or plain WOrientations used to place
+ *  sounds) follow another one. World transformations are propagated once per
+ *  frame, only through the subtrees that changed.
+ *
+ *  @author Hasan Al-Jawaheri (hbj)
+ *  @bug No known bugs.
+ */
+
+#pragma once
+
+#include "Wasabi/Core/WError.hpp"
+#include "Wasabi/Core/WMath.hpp"
+
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+class WOrientation;
+
+/**
+ * @ingroup engineclass
+ *
+ * A WTransformHierarchy stores parent/child relations between WOrientations.
+ * A child's world transformation is its own transformation (see
+ * WOrientation::ComputeTransformation()) followed by its parent's world
+ * transformation. The hierarchy delivers the parent's world transformation to
+ * the child as its binding matrix (see WOrientation::SetBindingMatrix()), so
+ * the child's GetWorldMatrix() (or equivalent) includes it. The binding
+ * matrix of a node that has a parent is therefore managed by the hierarchy,
+ * while the binding matrix of a root is applied to its whole subtree. Scale
+ * that an object applies on top of its orientation is not inherited.
+ *
+ * The nodes are stored in flat arrays in depth-first order, parents before
+ * their children, so that every subtree is a contiguous range. Update(),
+ * which RunWasabi() calls every frame before rendering, walks the arrays
+ * once: a node is recomputed only if it or an ancestor changed since the last
+ * update (according to WOrientation::GetVersion()). Independent subtrees are
+ * updated in parallel on the engine's WJobSystem.
+ *
+ * A WOrientation removes itself from the hierarchy when it is destroyed, and
+ * its children become roots.
+ */
+class WTransformHierarchy {
+	friend class WOrientation;
+
+public:
+	WTransformHierarchy(class Wasabi* const app);
+	~WTransformHierarchy();
+
+	/**
+	 * Sets the parent of a WOrientation. The child's world transformation
+	 * follows the parent's from the next Update().
+	 * @param child   WOrientation to parent
+	 * @param parent  New parent of child, or nullptr to detach child from its
+	 *                current parent (and remove its binding)
+	 * @return Error code, see WError.h. W_INVALIDPARAM if child is null or if
+	 *         parent is child or one of its descendants
+	 */
+	WError SetParent(WOrientation* child, WOrientation* parent);
+
+	/**
+	 * @param child  WOrientation to query
+	 * @return The parent of child, nullptr if it has none
+	 */
+	WOrientation* GetParent(const WOrientation* child) const;
+
+	/**
+	 * Retrieves the direct children of a WOrientation.
+	 * @param parent    WOrientation to query
+	 * @param children  Set to the children of parent
+	 */
+	void GetChildren(const WOrientation* parent, std::vector<WOrientation*>& children) const;
+
+	/**
+	 * @return Number of WOrientations in the hierarchy (roots of subtrees
+	 *         included)
+	 */
+	uint32_t GetNumNodes() const;
+
+	/**
+	 * Propagates the world transformations of the nodes that changed (or whose
+	 * ancestors changed) since the last update to their descendants.
+	 */
+	void Update();
+
+private:
+	/** Index stored in m_parents for roots */
+	static const uint32_t NO_PARENT = UINT32_MAX;
+
+	/** Parent and children of a node, the source of truth for the structure */
+	struct NODE_LINKS {
+		WOrientation* parent;
+		std::vector<WOrientation*> children;
+	};
+
+	/** Application that owns this hierarchy */
+	class Wasabi* m_app;
+	/** Links of all the nodes in the hierarchy */
+	std::unordered_map<WOrientation*, NODE_LINKS> m_links;
+	/** true if the links changed since the arrays were built */
+	bool m_structureChanged;
+
+	/** Nodes in depth-first order */
+	std::vector<WOrientation*> m_nodes;
+	/** Index of the parent of every node, NO_PARENT for roots */
+	std::vector<uint32_t> m_parents;
+	/** World transformation of every node as of the last update */
+	std::vector<WMatrix> m_worldMatrices;
+	/** Version of every node as of the last update */
+	std::vector<uint32_t> m_versions;
+	/** Set for the nodes whose world transformation changed in the last update */
+	std::vector<uint8_t> m_changed;
+	/** First node of every parallel task (a run of whole root subtrees), followed by the number of nodes */
+	std::vector<uint32_t> m_taskStarts;
+
+	/**
+	 * Rebuilds the arrays from m_links.
+	 */
+	void _Rebuild();
+
+	/**
+	 * Updates the nodes in [begin, end), which must be made of whole subtrees.
+	 */
+	void _UpdateRange(uint32_t begin, uint32_t end);
+
+	/**
+	 * Removes a node from the links if it has neither a parent nor children.
+	 */
+	void _RemoveIfIsolated(WOrientation* node);
+
+	/**
+	 * Removes a node that is being destroyed, its children become roots.
+	 * Called by the WOrientation destructor.
+	 */
+	void _OnDestroyed(WOrientation* node);
+};
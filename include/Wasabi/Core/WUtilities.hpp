@@ -11,6 +11,8 @@
 
 #include "Wasabi/Core/WMath.hpp"
 
+#include <string>
+
 class Wasabi;
 
 namespace WUtil {
@@ -61,4 +63,12 @@ namespace WUtil {
 	 * Returns a linear interpolation between x and y at factor f
 	 */
 	float flerp(float x, float y, float f);
+
+	/**
+	 * Escapes a string so that it can be written inside a JSON string literal
+	 * (e.g. in trace files).
+	 * @param  str  String to escape
+	 * @return      The escaped string
+	 */
+	std::string EscapeJSON(const std::string& str);
 };
\ No newline at end of file
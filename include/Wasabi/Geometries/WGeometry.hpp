@@ -12,6 +12,7 @@
 #pragma once
 
 #include "Wasabi/Core/WCore.hpp"
+#include "Wasabi/Geometries/WGeometryBVH.hpp"
 
 #define W_ATTRIBUTE_POSITION	W_VERTEX_ATTRIBUTE("position", 3)
 #define W_ATTRIBUTE_TANGENT		W_VERTEX_ATTRIBUTE("tangent", 3)
@@ -564,7 +565,10 @@ public:
 	/**
 	 * Checks if a ray intersects the geometry. The geometry must be valid and
 	 * must have an attribute in its geometry buffer named "position". The
-	 * geometry must be dynamic and not immutable.
+	 * geometry must be CPU-readable. For larger geometries, the first call
+	 * builds a bounding volume hierarchy over the triangles (see
+	 * SetIntersectionBVH()) that is used by subsequent calls, and refit when
+	 * the vertices are modified.
 	 * @param  p1            Origin of the ray
 	 * @param  p2            A vector that points in the same direction as the
 	 *                       ray
@@ -577,9 +581,49 @@ public:
 	 *                       UV coordinates local to the triangle intersected
 	 * @param  triangleIndex A pointer to an integer to be populated with the
 	 *                       index of the triangle that was intersected, if any
+	 * @param  anyHit        If true, the first intersection found is reported
+	 *                       (which is faster), otherwise the intersection
+	 *                       closest to p1 is reported
 	 * @return               true if there was an intersection, false otherwise
 	 */
-	bool Intersect(WVector3 p1, WVector3 p2, WVector3* pt = nullptr, WVector2* uv = nullptr, uint32_t* triangleIndex = nullptr);
+	bool Intersect(WVector3 p1, WVector3 p2, WVector3* pt = nullptr, WVector2* uv = nullptr, uint32_t* triangleIndex = nullptr, bool anyHit = false);
+
+	/**
+	 * Performs the intersection of Intersect() on vertices and indices in CPU
+	 * memory, with no geometry (or device) involved.
+	 * @param  vertices       Vertices of the triangles
+	 * @param  vertexSize     Size of a vertex in bytes
+	 * @param  positionOffset Offset of the (3-component) position in a vertex
+	 * @param  uvOffset       Offset of the (2-component) UV in a vertex, or
+	 *                        std::numeric_limits<uint32_t>::max() if there is
+	 *                        none
+	 * @param  indices        Indices of the triangles
+	 * @param  numTriangles   Number of triangles
+	 * @param  bvh            Hierarchy built over the triangles, or nullptr
+	 *                        to test every triangle
+	 * @param  p1             See Intersect()
+	 * @param  p2             See Intersect()
+	 * @param  pt             See Intersect()
+	 * @param  uv             See Intersect()
+	 * @param  triangleIndex  See Intersect()
+	 * @param  anyHit         See Intersect()
+	 * @return                true if there was an intersection, false
+	 *                        otherwise
+	 */
+	static bool IntersectVertices(const void* vertices, uint32_t vertexSize, uint32_t positionOffset, uint32_t uvOffset,
+								  const uint32_t* indices, uint32_t numTriangles, const WGeometryBVH* bvh,
+								  WVector3 p1, WVector3 p2, WVector3* pt = nullptr, WVector2* uv = nullptr,
+								  uint32_t* triangleIndex = nullptr, bool anyHit = false);
+
+	/**
+	 * Sets whether Intersect() may build and use a bounding volume hierarchy
+	 * over the triangles of the geometry (enabled by default). The hierarchy
+	 * keeps a CPU-side copy of the triangles, so it can be disabled for
+	 * geometries that are rarely intersected to save memory.
+	 * @param enable  true to enable the hierarchy, false to disable it (and
+	 *                free it if it was built)
+	 */
+	void SetIntersectionBVH(bool enable);
 
 	/**
 	 * Draw the geometry to the render target. This function will bind the
@@ -599,6 +643,48 @@ public:
 	 */
 	WError Draw(class WRenderTarget* rt, uint32_t numIndices = std::numeric_limits<uint32_t>::max(), uint32_t numInstances = 1, bool bindAnimation = true);
 
+	/**
+	 * Draw the geometry to the render target, sourcing the vertices from
+	 * transient frame memory (see WVulkanMemoryManager::AllocateFrameMemory())
+	 * instead of the geometry's own vertex buffer. This is the preferred way
+	 * to draw vertices that are rewritten every frame. The geometry's index
+	 * buffer is used if it has one, and no animation buffer is bound.
+	 * @param  rt            Render target to draw to
+	 * @param  vertices      Frame memory holding the vertices, in this
+	 *                       geometry's vertex format
+	 * @param  numIndices    Number of indices (or vertices if the geometry
+	 *                       has no indices) to draw, MAX for all
+	 * @param  numInstances  Number of instances to draw
+	 * @return               Error code, see WError.h
+	 */
+	WError Draw(class WRenderTarget* rt, const WFrameAllocation& vertices, uint32_t numIndices = std::numeric_limits<uint32_t>::max(), uint32_t numInstances = 1);
+
+	/**
+	 * Draw the geometry to the render target using draw parameters read by
+	 * the GPU from a buffer (an indirect draw). This binds the geometry's
+	 * vertex and index buffers like Draw() does (without the animation
+	 * buffer), so it can only be used on geometries that have indices.
+	 * @param  rt           Render target to draw to
+	 * @param  buffer       Buffer holding the draw parameters as
+	 *                      VkDrawIndexedIndirectCommand structures, created
+	 *                      with VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+	 * @param  offset       Offset of the first command in buffer
+	 * @param  drawCount    Number of consecutive commands to draw, more than
+	 *                      one requires the multiDrawIndirect device feature
+	 * @param  countBuffer  Optional buffer holding the number of commands to
+	 *                      draw (a uint32_t, at most drawCount), created with
+	 *                      VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT. It is only
+	 *                      read if the device supports
+	 *                      VK_KHR_draw_indirect_count (see
+	 *                      Wasabi::GetVulkanDrawIndexedIndirectCount()),
+	 *                      otherwise drawCount commands are drawn, so the
+	 *                      commands past the count must draw nothing
+	 * @param  countOffset  Offset of the count in countBuffer
+	 * @return              Error code, see WError.h
+	 */
+	WError DrawIndirect(class WRenderTarget* rt, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount = 1,
+						VkBuffer countBuffer = VK_NULL_HANDLE, VkDeviceSize countOffset = 0);
+
 	/**
 	 * Retrieves the point that represents the minimum boundary of the geometry.
 	 * @return The minimum boundary for the geometry
@@ -661,11 +747,23 @@ private:
 	/** Minimum boundary */
 	WVector3 m_minPt;
 
+	/** Bounding volume hierarchy used by Intersect(), built on demand */
+	WGeometryBVH m_bvh;
+	/** Whether Intersect() is allowed to use m_bvh */
+	bool m_bvhEnabled;
+	/** Set when the vertices were modified after m_bvh was built */
+	bool m_bvhNeedsRefit;
+
 	/**
 	 * Destroys all the geometry resources.
 	 */
 	void _DestroyResources();
 
+	/**
+	 * Binds the given vertex buffers and records the draw command.
+	 */
+	void _Draw(VkCommandBuffer cmdBuf, uint32_t numBindings, VkBuffer* bindings, VkDeviceSize* offsets, uint32_t numIndices, uint32_t numInstances);
+
 	/**
 	 * Calculates m_minPt.
 	 * @param vb       Vertex buffer to calculate from
@@ -0,0 +1,141 @@
+/** @file WGeometryBVH.hpp
+ *  @brief Bounding volume hierarchy over the triangles of a geometry
+ *
+ *  A WGeometryBVH keeps a CPU-side copy of a geometry's triangles organized
+ *  in a bounding volume hierarchy, which is used by WGeometry::Intersect() to
+ *  avoid testing a ray against every triangle of the geometry.
+ *
+ *  @author Hasan Al-Jawaheri (hbj)
+ *  @bug No known bugs.
+ */
+
+#pragma once
+
+#include "Wasabi/Core/WMath.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * A bounding volume hierarchy over a triangle list. The hierarchy is built
+ * top-down using a binned surface area heuristic and stored as a flat array of
+ * 32-byte nodes, where the two children of an interior node are adjacent.
+ * Triangle positions are copied into the hierarchy (in leaf order), so
+ * queries do not need access to the vertex buffer.
+ */
+class WGeometryBVH {
+public:
+	/** Result of a ray query */
+	struct HIT {
+		/** Index of the intersected triangle in the index buffer (first index / 3) */
+		uint32_t triangle;
+		/** Distance along the ray, in multiples of the ray's direction vector */
+		float t;
+		/** First barycentric coordinate of the intersection (weight of the second vertex) */
+		float u;
+		/** Second barycentric coordinate of the intersection (weight of the third vertex) */
+		float v;
+		/** Point of intersection */
+		WVector3 point;
+	};
+
+	WGeometryBVH();
+	~WGeometryBVH();
+
+	/**
+	 * Builds the hierarchy.
+	 * @param vb            Vertex buffer
+	 * @param vtxSize       Size of a vertex in vb
+	 * @param posOffset     Offset of the (3-component) position in a vertex
+	 * @param ib            Index buffer (3 indices per triangle)
+	 * @param numTriangles  Number of triangles in ib
+	 */
+	void Build(const void* vb, uint32_t vtxSize, uint32_t posOffset, const uint32_t* ib, uint32_t numTriangles);
+
+	/**
+	 * Updates the triangle positions from the vertex buffer and recomputes the
+	 * node bounds bottom-up, keeping the tree topology. This is much cheaper
+	 * than Build() and always correct, but the tree quality degrades if the
+	 * vertices moved non-uniformly.
+	 * @param vb         Vertex buffer, with the same layout and topology as
+	 *                   the one passed to Build()
+	 * @param vtxSize    Size of a vertex in vb
+	 * @param posOffset  Offset of the position in a vertex
+	 * @return           false if the refit produced a tree much worse than a
+	 *                   fresh build would, in which case a Build() is
+	 *                   recommended
+	 */
+	bool Refit(const void* vb, uint32_t vtxSize, uint32_t posOffset);
+
+	/**
+	 * Frees the hierarchy.
+	 */
+	void Clear();
+
+	/**
+	 * Queries a ray against the triangles in the hierarchy.
+	 * @param  origin     Origin of the ray
+	 * @param  direction  Direction of the ray (need not be normalized)
+	 * @param  anyHit     If true, the query returns as soon as any
+	 *                    intersection is found, otherwise the closest
+	 *                    intersection is returned
+	 * @param  hit        Populated with the intersection found, if any
+	 * @return            true if there was an intersection, false otherwise
+	 */
+	bool Intersect(WVector3 origin, WVector3 direction, bool anyHit, HIT* hit) const;
+
+	/**
+	 * @return true if the hierarchy was built, false otherwise
+	 */
+	bool Valid() const;
+
+	/**
+	 * @return Number of bytes used by the hierarchy
+	 */
+	size_t GetMemorySize() const;
+
+	/**
+	 * Moller-Trumbore ray/triangle intersection, using the same tolerances as
+	 * the brute-force path of WGeometry::Intersect().
+	 * @param  origin     Origin of the ray
+	 * @param  direction  Direction of the ray
+	 * @param  v0         First vertex of the triangle
+	 * @param  v1         Second vertex of the triangle
+	 * @param  v2         Third vertex of the triangle
+	 * @param  t          Set to the distance along the ray
+	 * @param  u          Set to the first barycentric coordinate
+	 * @param  v          Set to the second barycentric coordinate
+	 * @return            true if the ray intersects the triangle
+	 */
+	static bool IntersectTriangle(const WVector3& origin, const WVector3& direction,
+								  const WVector3& v0, const WVector3& v1, const WVector3& v2,
+								  float* t, float* u, float* v);
+
+private:
+	/** A node of the hierarchy, children of an interior node are at firstChildOrTriangle and firstChildOrTriangle + 1 */
+	struct NODE {
+		float min[3];
+		/** Index of the first child (interior) or of the first triangle (leaf) */
+		uint32_t firstChildOrTriangle;
+		float max[3];
+		/** Number of triangles in the leaf, 0 for interior nodes */
+		uint32_t numTriangles;
+	};
+
+	/** Nodes of the hierarchy, the root is node 0 */
+	std::vector<NODE> m_nodes;
+	/** Triangle positions (3 per triangle), in leaf order */
+	std::vector<WVector3> m_positions;
+	/** Triangle vertex indices (3 per triangle), in leaf order */
+	std::vector<uint32_t> m_indices;
+	/** Original index of every triangle (in leaf order) */
+	std::vector<uint32_t> m_triangleIds;
+	/** Sum of the nodes' surface areas relative to the root's right after Build(), used to detect degraded refits */
+	float m_builtCost;
+
+	/**
+	 * Computes the sum of the nodes' surface areas relative to the root's (an
+	 * estimate of the traversal cost that does not depend on the scale).
+	 */
+	float _ComputeRelativeCost() const;
+};
@@ -18,6 +18,9 @@ enum W_IMAGE_CREATE_FLAGS: uint32_t {
 	W_IMAGE_CREATE_DYNAMIC = 2,
 	W_IMAGE_CREATE_REWRITE_EVERY_FRAME = 4,
 	W_IMAGE_CREATE_RENDER_TARGET_ATTACHMENT = 8,
+	/** The image can be written by shaders as a storage image (see
+	    W_TYPE_STORAGE_IMAGE), it is kept in VK_IMAGE_LAYOUT_GENERAL */
+	W_IMAGE_CREATE_STORAGE = 16,
 };
 
 inline W_IMAGE_CREATE_FLAGS operator | (W_IMAGE_CREATE_FLAGS lhs, W_IMAGE_CREATE_FLAGS rhs) {
@@ -12,6 +12,13 @@
  *  WRenderTarget::End() passing true (default) or explicitly call
  *  WRenderTarget::Submit() afterwards.
  *
+ *  When the engine has worker threads and the "parallelRecording" engine
+ *  parameter is set, everything a render target renders as part of the
+ *  renderer's frame (i.e. without its own command buffer) between Begin() and
+ *  End() is recorded into secondary command buffers instead, so that large batches of
+ *  draws can be recorded by multiple threads (see
+ *  WRenderTarget::RecordInParallel()).
+ *
  *  @author Hasan Al-Jawaheri (hbj)
  *  @bug No known bugs.
  */
@@ -106,9 +113,43 @@ public:
 
 	/**
 	 * Begin recording renders on this render target.
+	 * @param  clear  When set to true, the attachments are cleared (see
+	 *                SetClearColor()). Otherwise, they keep what was
+	 *                rendered to them before, which lets a render target
+	 *                that is part of the renderer's frame be ended in the
+	 *                middle of a render stage (e.g. to record compute work
+	 *                that reads its depth) and resumed with Begin(false)
 	 * @return Error code, see WError.h
 	 */
-	WError Begin();
+	WError Begin(bool clear = true);
+
+	/**
+	 * Records count items in chunks, on multiple threads if this render target
+	 * records into secondary command buffers (see the "parallelRecording"
+	 * engine parameter). Every chunk is recorded into its own secondary
+	 * command buffer (GetCommnadBuffer() returns it on the recording thread),
+	 * and the chunks are executed in order, after everything recorded before
+	 * this call and before everything recorded after it. A chunk starts with
+	 * no pipeline or descriptor sets bound, so fn must bind what it needs
+	 * (e.g. with WEffect::Bind()). fn is called concurrently for different
+	 * chunks, so it must only record commands (see WObject::RecordRender()
+	 * and WMaterial::RecordBind()). If this render target does not
+	 * record in parallel, fn is simply called once for all the items.
+	 * Must be called between Begin() and End().
+	 * @param  count     Number of items to record
+	 * @param  minChunk  Minimum number of items per chunk
+	 * @param  fn        Function called with the range [begin, end) of items
+	 *                   of every chunk
+	 * @return           Error code, see WError.h
+	 */
+	WError RecordInParallel(uint32_t count, uint32_t minChunk, const std::function<void(uint32_t begin, uint32_t end)>& fn);
+
+	/**
+	 * Checks whether the calling thread is recording a chunk of
+	 * RecordInParallel(), in which case it must only record commands.
+	 * @return true if the calling thread is recording a chunk, false otherwise
+	 */
+	static bool IsRecordingChunk();
 
 	/**
 	 * End recording renders on this render target. If bSubmit is set to false, you
@@ -157,7 +198,9 @@ public:
 	VkRenderPass GetRenderPass() const;
 
 	/**
-	 * Retrieves the pipeline cache associated with this render target.
+	 * Retrieves the pipeline cache to use when creating pipelines for this
+	 * render target. All render targets share the engine's pipeline cache
+	 * (see Wasabi::GetPipelineCache()).
 	 * @return Handle of the pipeline cache for this render target
 	 */
 	VkPipelineCache GetPipelineCache() const;
@@ -175,6 +218,16 @@ public:
 	 */
 	uint32_t GetNumColorOutputs() const;
 
+	/**
+	 * @return Width of the render target
+	 */
+	uint32_t GetWidth() const;
+
+	/**
+	 * @return Height of the render target
+	 */
+	uint32_t GetHeight() const;
+
 	/**
 	 * Checks whether or not the render target has a depth attachment.
 	 * @return True if the render target has a depth attachment, false otherwise
@@ -203,8 +256,8 @@ private:
 	vector<class WImage*> m_targets;
 	/** Render pass associated with this render target */
 	VkRenderPass m_renderPass;
-	/** A pipeline cache */
-	VkPipelineCache m_pipelineCache;
+	/** Same as m_renderPass, but loads the attachments instead of clearing them (see Begin()) */
+	VkRenderPass m_loadRenderPass;
 	/** Whether or not this render target has an independent command buffer */
 	bool m_haveCommandBuffer;
 	/** The command buffer used for rendering on this render target */
@@ -217,11 +270,48 @@ private:
 	uint32_t m_height;
 	/** The camera of this render target */
 	class WCamera* m_camera;
+	/** Frame buffer the current render pass renders to */
+	VkFramebuffer m_currentFrameBuffer;
+	/** Secondary command buffer the render pass is being recorded into by
+	    the thread that called Begin(), VK_NULL_HANDLE if the render pass is
+	    recorded inline */
+	VkCommandBuffer m_secondaryCmdBuffer;
+	/** Recorded secondary command buffers, executed in order by End() */
+	vector<VkCommandBuffer> m_recordedCmdBuffers;
 
 	/**
 	 * Free all the resources allocated by this render target.
 	 */
 	void _DestroyResources();
+
+	/**
+	 * Creates m_renderPass, and m_loadRenderPass which only differs in the
+	 * attachments' load operations.
+	 * @param  renderPassInfo  Description of m_renderPass, the attachments'
+	 *                         load operations must be
+	 *                         VK_ATTACHMENT_LOAD_OP_CLEAR
+	 * @return                 Vulkan result of the operation
+	 */
+	VkResult _CreateRenderPasses(VkRenderPassCreateInfo renderPassInfo);
+
+	/**
+	 * @return The command buffer the render pass begins and ends in
+	 */
+	VkCommandBuffer _GetPrimaryCommandBuffer() const;
+
+	/**
+	 * Sets the viewport and scissor to cover the whole render target.
+	 * @param cmdBuf  Command buffer to record into
+	 */
+	void _SetViewportAndScissor(VkCommandBuffer cmdBuf) const;
+
+	/**
+	 * Acquires a secondary command buffer for the calling thread and begins
+	 * it so it continues the current render pass.
+	 * @param  cmdBuf  Set to the begun command buffer
+	 * @return         Vulkan result of the operation
+	 */
+	VkResult _BeginSecondaryCommandBuffer(VkCommandBuffer* cmdBuf) const;
 };
 
 /**
@@ -27,6 +27,8 @@ enum W_SHADER_TYPE: uint32_t {
 	W_PIXEL_SHADER = VK_SHADER_STAGE_FRAGMENT_BIT,
 	/** Geometry shader */
 	W_GEOMETRY_SHADER = VK_SHADER_STAGE_GEOMETRY_BIT,
+	/** Compute shader, which can only be bound to an effect on its own */
+	W_COMPUTE_SHADER = VK_SHADER_STAGE_COMPUTE_BIT,
 };
 
 /**
@@ -65,6 +67,12 @@ enum W_SHADER_BOUND_RESOURCE_TYPE: uint8_t {
 	W_TYPE_TEXTURE = 1,
 	/** Bound resource is a push constant structure */
 	W_TYPE_PUSH_CONSTANT = 2,
+	/** Bound resource is a storage buffer (SSBO) holding an array of
+	    structures, its variables describe one element of the array */
+	W_TYPE_STORAGE_BUFFER = 3,
+	/** Bound resource is a storage image (an image the shader can write to,
+	    created with W_IMAGE_CREATE_STORAGE) */
+	W_TYPE_STORAGE_IMAGE = 4,
 };
 
 /**
@@ -190,11 +198,13 @@ typedef struct W_BOUND_RESOURCE {
 	uint32_t binding_set;
 	/** Name of this bound resource */
 	std::string name;
-	/** Variables of this resource (in case of a UBO), which is empty for
-		textures */
+	/** Variables of this resource (in case of a UBO, or of one element of a
+		storage buffer), which is empty for textures */
 	std::vector<W_SHADER_VARIABLE_INFO> variables;
 	/** Cached size of the variables, after automatically padding variables
-	    to be 16-byte-aligned. In case of a texture, this is the array size */
+	    to be 16-byte-aligned. In case of a texture or a storage image, this is
+	    the array size, and in case of a storage buffer, this is the stride of
+	    its elements */
 	size_t _size;
 	/** Aligned offsets of variables elements in the UBO */
 	std::vector<size_t> _offsets;
@@ -535,6 +545,26 @@ public:
  * vs->RemoveReference();
  * ps->RemoveReference();
  * @endcode
+ *
+ * An effect with a bound compute shader (W_COMPUTE_SHADER) is a compute
+ * effect: it builds a compute pipeline and is dispatched instead of drawn.
+ * Its resources are set through materials like any other effect's. Compute
+ * work cannot be recorded inside a render pass, so render stages record it in
+ * WRenderStage::RecordCompute(), and work outside of the frame can use any
+ * command buffer (e.g. WVulkanMemoryManager::BeginCopyCommandBuffer()):
+ * @code
+ * WEffect* computeFX = new WEffect(m_app);
+ * computeFX->BindShader(cs);
+ * computeFX->BuildPipeline(nullptr);
+ * WMaterial* material = computeFX->CreateMaterial();
+ * material->SetStorageBuffer("particles", &particlesBuffer);
+ * ...
+ * computeFX->Bind(cmdBuffer);
+ * material->Bind(cmdBuffer);
+ * computeFX->Dispatch(cmdBuffer, (numParticles + 63) / 64);
+ * // make the shader's writes visible to the vertex shaders of later draws
+ * WEffect::ComputeBarrier(cmdBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+ * @endcode
  */
 class WEffect : public WFileAsset {
 	friend class WMaterial;
@@ -555,7 +585,8 @@ public:
 	WEffect(class Wasabi* const app, uint32_t ID = 0);
 
 	/**
-	 * Binds a shader to this effect.
+	 * Binds a shader to this effect, replacing the bound shader of the same
+	 * type. A compute shader cannot be bound together with graphics shaders.
 	 * @param  shader New shader to bind
 	 * @return        Error code, see WError.h
 	 */
@@ -611,8 +642,10 @@ public:
 	 * with two input layouts will have two pipelines, one that only uses one
 	 * input layout and another that uses both. This is done to provide
 	 * convenience when one wishes to use the same effect without supplying all
-	 * required vertex shaders.
-	 * @param  rt Render target that the effect plans on rendering to
+	 * required vertex shaders. If a compute shader is bound, a compute
+	 * pipeline is built instead.
+	 * @param  rt Render target that the effect plans on rendering to, can be
+	 *            nullptr for a compute effect
 	 * @return    Error code, see WError.h
 	 */
 	WError BuildPipeline(class WRenderTarget* rt);
@@ -627,6 +660,65 @@ public:
 	 */
 	WError Bind(class WRenderTarget* rt);
 
+	/**
+	 * Binds the effect (pipeline) and its per-frame materials to a command
+	 * buffer. See Bind(WRenderTarget*). This is how compute effects are bound
+	 * (outside of any render pass).
+	 * @param  cmdBuffer  Command buffer to record to
+	 * @return            Error code, see WError.h
+	 */
+	WError Bind(VkCommandBuffer cmdBuffer);
+
+	/**
+	 * Records a dispatch of a compute effect, which must be bound (see
+	 * Bind(VkCommandBuffer)) along with its materials. No barrier is
+	 * recorded, so independent dispatches may run concurrently, see
+	 * ComputeBarrier().
+	 * @param  cmdBuffer    Command buffer to record to, outside of any render
+	 *                      pass
+	 * @param  groupCountX  Number of work groups in the X dimension
+	 * @param  groupCountY  Number of work groups in the Y dimension
+	 * @param  groupCountZ  Number of work groups in the Z dimension
+	 * @return              Error code, see WError.h
+	 */
+	WError Dispatch(VkCommandBuffer cmdBuffer, uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1);
+
+	/**
+	 * Records a dispatch of a compute effect whose work group counts are
+	 * read from a buffer (a VkDispatchIndirectCommand), which may have been
+	 * written by an earlier dispatch. See Dispatch().
+	 * @param  cmdBuffer  Command buffer to record to
+	 * @param  buffer     Buffer holding the command, created with
+	 *                    VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+	 * @param  offset     Offset of the command in buffer
+	 * @return            Error code, see WError.h
+	 */
+	WError DispatchIndirect(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkDeviceSize offset = 0);
+
+	/**
+	 * Records a barrier that makes the writes of the compute shaders
+	 * dispatched so far (to storage buffers and storage images) available to
+	 * later commands. Storage images stay in VK_IMAGE_LAYOUT_GENERAL, so no
+	 * layout transition is needed.
+	 * @param cmdBuffer  Command buffer to record to, outside of any render
+	 *                   pass
+	 * @param dstStages  Pipeline stages that consume the writes
+	 * @param dstAccess  Accesses of dstStages that consume the writes (e.g.
+	 *                   VK_ACCESS_INDIRECT_COMMAND_READ_BIT for a buffer of
+	 *                   draw commands)
+	 */
+	static void ComputeBarrier(VkCommandBuffer cmdBuffer,
+							   VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+							   VkAccessFlags dstAccess = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	/**
+	 * Updates the resources of the per-frame materials of this effect (see
+	 * WMaterial::UpdateResources()), so that Bind() only records commands and
+	 * may be called from multiple threads at once.
+	 * @return Error code, see WError.h
+	 */
+	WError UpdatePerFrameMaterials();
+
 	/**
 	 * Sets the render flags of this effect. Render flags is a bitfield of
 	 * type W_EFFECT_RENDER_FLAGS that specifies various preperties about
@@ -671,6 +763,11 @@ public:
 	 */
 	W_INPUT_LAYOUT GetInputLayout(uint32_t layout_index = 0) const;
 
+	/**
+	 * @return true if a compute shader is bound to this effect
+	 */
+	bool IsCompute() const;
+
 	/**
 	 * Retrieves the size of the input layout at the given index.
 	 * @param  layout_index Index of the layout requested
@@ -681,7 +778,7 @@ public:
 	/**
 	 * Checks the validity of the effect. An effect is valid if it has at least
 	 * one pipeline created and has a bound vertex shader that supplies a valid
-	 * input layout.
+	 * input layout, or a valid compute shader (alone).
 	 * @return true if the effect is valid, false otherwise
 	 */
 	virtual bool Valid() const override;
@@ -726,10 +823,17 @@ private:
 	/**
 	 * Checks the validity of the bound shaders. The bound shaders are valid if
 	 * they contain at least one vertex buffer with at least one valid input
-	 * layout.
+	 * layout, or if they are a single valid compute shader.
 	 * @return true if the bound shaders are valid, false otherwise
 	 */
 	bool _ValidShaders() const;
+
+	/**
+	 * Creates the descriptor set layouts and the pipeline layout from the
+	 * bound resources of the bound shaders.
+	 * @return Error code, see WError.h
+	 */
+	WError _CreatePipelineLayout();
 };
 
 /**
@@ -3,7 +3,8 @@
  *
  *  Materials are the way Wasabi passes parameters to effects and their
  *  shaders. Materials provide a simple, convenient interface to assign
- *  textures and shader UBO variables to shaders.
+ *  textures, storage buffers, storage images and shader UBO variables to
+ *  shaders.
  *
  *  @author Hasan Al-Jawaheri (hbj)
  *  @bug No known bugs.
@@ -13,6 +14,47 @@
 
 #include "Wasabi/Core/WCore.hpp"
 
+/**
+ * A handle to a shader variable, resolved once using
+ * WMaterial::GetVariableHandle() and then used to set the variable with no
+ * name lookup. A handle is valid for every material created for the same
+ * effect and binding set as the material that resolved it.
+ */
+struct WMaterialVariableHandle {
+	/** Maximum number of resources a variable name can be resolved to */
+	static const uint32_t MAX_LOCATIONS = 4;
+
+	/** Location of the variable in one of the material's resources */
+	struct LOCATION {
+		/** Whether the variable is in a push constant (true) or a UBO (false) */
+		bool isPushConstant;
+		/** Index of the UBO or push constant in the material */
+		uint32_t resourceIndex;
+		/** Offset of the variable inside the resource */
+		uint32_t offset;
+		/** Size of the variable */
+		uint32_t size;
+	};
+
+	/** Effect the handle was resolved for */
+	class WEffect* effect;
+	/** Unique ID of effect (see WBase::GetUniqueID()), which unlike its address is never reused by another effect */
+	uint64_t effectID;
+	/** Binding set the handle was resolved for */
+	uint32_t bindingSet;
+	/** Number of valid entries in locations */
+	uint32_t numLocations;
+	/** Resolved locations of the variable (a name may appear in multiple resources) */
+	LOCATION locations[MAX_LOCATIONS];
+
+	WMaterialVariableHandle() : effect(nullptr), effectID(0), bindingSet(0), numLocations(0) {}
+
+	/**
+	 * @return true if the handle was resolved to at least one variable
+	 */
+	bool Valid() const { return numLocations > 0; }
+};
+
 /**
  * @ingroup engineclass
  *
@@ -63,6 +105,43 @@ public:
 	 */
 	virtual WError Bind(class WRenderTarget* rt, bool bindDescSet = true, bool bindPushConsts = true);
 
+	/**
+	 * Binds the resources to the pipeline bound to a command buffer (the
+	 * compute pipeline if the material's effect is a compute effect). See
+	 * Bind(WRenderTarget*, bool, bool). On a thread recording a chunk of
+	 * WRenderTarget::RecordInParallel(), the resources are not updated (see
+	 * RecordBind()).
+	 * @param  cmdBuffer      Command buffer to record to
+	 * @param bindDescSet    Whether or not to bind the descriptor set
+	 * @param bindPushConsts Whether or not to bind push constants
+	 * @return     Error code, see WError.h
+	 */
+	WError Bind(VkCommandBuffer cmdBuffer, bool bindDescSet = true, bool bindPushConsts = true);
+
+	/**
+	 * Records the commands of Bind() without updating the resources first, so
+	 * the material must have been updated (see UpdateResources()) since it
+	 * was last changed. Since it doesn't modify the material, it may be called
+	 * from multiple threads at once, each recording into a different command
+	 * buffer (see WRenderTarget::RecordInParallel()).
+	 * @param  cmdBuffer      Command buffer to record to
+	 * @param bindDescSet    Whether or not to bind the descriptor set
+	 * @param bindPushConsts Whether or not to bind push constants
+	 * @return     Error code, see WError.h
+	 */
+	WError RecordBind(VkCommandBuffer cmdBuffer, bool bindDescSet = true, bool bindPushConsts = true) const;
+
+	/**
+	 * Copies the variables and textures that changed since the last update to
+	 * the uniform buffers and descriptor set of the current buffering index.
+	 * Bind() does this before binding the descriptor set. This writes to the
+	 * material, so it must not be called while recording a chunk of
+	 * WRenderTarget::RecordInParallel(): update the materials before, then
+	 * bind them with RecordBind().
+	 * @return Error code, see WError.h
+	 */
+	WError UpdateResources();
+
 	/**
 	 * Retrieves the Vulkan descriptor set created by this material.
 	 * @return Material's descriptor set
@@ -74,6 +153,11 @@ public:
 	 */
 	class WEffect* GetEffect() const;
 
+	/**
+	 * @return The binding set (of the effect) this material was created for.
+	 */
+	uint32_t GetBindingSet() const;
+
 	/**
 	 * Sets a variable in one of the bound effect's shaders whose name is varName
 	 * and whose type is T. If multiple variables have the same name, they
@@ -120,7 +204,53 @@ public:
 	WError SetVariableData(const char* varName, void* data, size_t len);
 
 	/**
-	 * Sets a texture in the bound effect.
+	 * Resolves a variable name to a handle that can be used to set the
+	 * variable repeatedly without looking it up by name. Resolve handles once
+	 * (e.g. at load time) and use them in per-frame code.
+	 * @param  varName  Name of the variable
+	 * @return          The handle, which is not Valid() if no variable named
+	 *                  varName exists in the material
+	 */
+	WMaterialVariableHandle GetVariableHandle(const char* varName) const;
+
+	/**
+	 * Sets a variable using a handle retrieved by GetVariableHandle().
+	 * @param  handle  Handle of the variable to set
+	 * @param  value   Value to set
+	 * @return         Error code, see WError.h
+	 */
+	template<typename T>
+	WError SetVariable(const WMaterialVariableHandle& handle, T value) {
+		return SetVariableData(handle, &value, sizeof(T));
+	}
+
+	/**
+	 * Sets an array variable using a handle retrieved by GetVariableHandle().
+	 * @param  handle       Handle of the variable to set
+	 * @param  arr          Address of the array to set
+	 * @param  numElements  Number of elements in arr
+	 * @return              Error code, see WError.h
+	 */
+	template<typename T>
+	WError SetVariableArray(const WMaterialVariableHandle& handle, T* arr, int numElements) {
+		return SetVariableData(handle, arr, sizeof(T) * numElements);
+	}
+
+	/**
+	 * Sets a variable using a handle retrieved by GetVariableHandle(). See
+	 * SetVariableData(const char*, void*, size_t).
+	 * @param  handle  Handle of the variable to set
+	 * @param  data    Address of the memory to set the variable's data to
+	 * @param  len     Length of data, in bytes
+	 * @return         Error code, see WError.h
+	 */
+	WError SetVariableData(const WMaterialVariableHandle& handle, const void* data, size_t len);
+
+	/**
+	 * Sets a texture (or a storage image) in the bound effect. Images set to
+	 * a storage image must be created with W_IMAGE_CREATE_STORAGE, and the
+	 * descriptors of a storage image are only written once all the elements
+	 * of its array are set.
 	 * @param  bindingIndex  The binding index of the texture
 	 * @param  img           The image to set the texture to, can be nullptr
 	 * @param  arrayIndex    Index into the texture array (if its an array)
@@ -129,7 +259,8 @@ public:
 	WError SetTexture(uint32_t bindingIndex, class WImage* img, uint32_t arrayIndex = 0);
 
 	/**
-	 * Sets a texture in the bound effect.
+	 * Sets a texture (or a storage image) in the bound effect. See
+	 * SetTexture(uint32_t, WImage*, uint32_t).
 	 * @param  name        Name of the texture to bind to
 	 * @param  img         The image to set the texture to, can be nullptr
 	 * @param  arrayIndex  Index into the texture array (if its an array)
@@ -137,6 +268,61 @@ public:
 	 */
 	WError SetTexture(std::string name, class WImage* img, uint32_t arrayIndex = 0);
 
+	/**
+	 * Retrieves the images set to a texture (or texture array) in the bound
+	 * effect.
+	 * @param  bindingIndex  The binding index of the texture
+	 * @param  images        Array to fill with the images
+	 * @param  maxImages     Number of elements in images
+	 * @return               Number of images written to images, 0 if the
+	 *                       material has no texture at bindingIndex
+	 */
+	uint32_t GetTextures(uint32_t bindingIndex, class WImage** images, uint32_t maxImages) const;
+
+	/**
+	 * Sets a storage buffer in the bound effect. The material does not own
+	 * the buffer, which must stay alive while the material uses it. The
+	 * buffer of the current buffering index is bound, and its descriptor is
+	 * updated when the buffer is re-created. A storage buffer must be set
+	 * before the material is bound.
+	 * @param  bindingIndex  The binding index of the storage buffer
+	 * @param  buffer        Buffer to set, created with
+	 *                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+	 * @return               Error code, see WError.h
+	 */
+	WError SetStorageBuffer(uint32_t bindingIndex, WBufferedBuffer* buffer);
+
+	/**
+	 * Sets a storage buffer in the bound effect. See
+	 * SetStorageBuffer(uint32_t, WBufferedBuffer*).
+	 * @param  name    Name of the storage buffer to bind to
+	 * @param  buffer  Buffer to set
+	 * @return         Error code, see WError.h
+	 */
+	WError SetStorageBuffer(std::string name, WBufferedBuffer* buffer);
+
+	/**
+	 * Retrieves the data of a UBO as it is set in the material (before it is
+	 * copied to GPU memory), laid out as the UBO is in the shaders.
+	 * @param  bindingIndex  The binding index of the UBO
+	 * @param  size          Set to the size of the UBO
+	 * @return               The UBO's data, nullptr if the material has no
+	 *                       UBO at bindingIndex
+	 */
+	const void* GetUniformBufferData(uint32_t bindingIndex, size_t* size) const;
+
+	/**
+	 * Finds where a variable is in the data of a UBO (see
+	 * GetUniformBufferData()).
+	 * @param  bindingIndex  The binding index of the UBO
+	 * @param  varName       Name of the variable
+	 * @param  offset        Set to the offset of the variable in the UBO's data
+	 * @param  size          Set to the size of the variable
+	 * @return               true if the UBO at bindingIndex has the variable,
+	 *                       false otherwise
+	 */
+	bool GetUniformBufferVariable(uint32_t bindingIndex, const char* varName, size_t* offset, size_t* size) const;
+
 	/**
 	 * Checks the validity of the material. A material is valid if it has a
 	 * valid effect assigned to it.
@@ -151,14 +337,14 @@ public:
 private:
 	/** Effect that this material is bound to */
 	class WEffect* m_effect;
-	/** The Vulkan descriptor pool used for the descriptor set */
+	/** The shared Vulkan descriptor pool the descriptor sets were allocated from */
 	VkDescriptorPool m_descriptorPool;
 	/** The Vulkan descriptor set objects, one per buffered frame */
 	std::vector<VkDescriptorSet> m_descriptorSets;
 	/** The set index of m_descriptorSet */
 	uint32_t m_setIndex;
 	/** An array to hold write descriptor sets (filled/initialized on every
-	    Bind() call) */
+	    UpdateResources() call) */
 	std::vector<VkWriteDescriptorSet> m_writeDescriptorSets;
 
 	struct UNIFORM_BUFFER_INFO {
@@ -183,12 +369,23 @@ private:
 		std::vector<std::vector<VkDescriptorImageInfo>> descriptors;
 		/** Array of image backing the texture array (size == 1 if its not an array) */
 		std::vector<class WImage*> images;
-		/** Pointer to the texture description in the effect */
+		/** Pointer to the texture (or storage image) description in the effect */
 		struct W_BOUND_RESOURCE* sampler_info;
 	};
-	/** List of all textures (or samplers) for the effect */
+	/** List of all textures (or samplers) and storage images for the effect */
 	std::vector<SAMPLER_INFO> m_samplers;
 
+	struct STORAGE_BUFFER_INFO {
+		/** Buffer bound to the storage buffer (not owned by the material) */
+		WBufferedBuffer* buffer;
+		/** Descriptor buffers, one per buffered frame */
+		std::vector<VkDescriptorBufferInfo> descriptorBufferInfos;
+		/** Pointer to the storage buffer description in the effect */
+		struct W_BOUND_RESOURCE* sb_info;
+	};
+	/** List of the storage buffers for the effect */
+	std::vector<STORAGE_BUFFER_INFO> m_storageBuffers;
+
 	struct PUSH_CONSTANT_INFO {
 		/** Data in the push constant buffer */
 		void* data;
@@ -203,8 +400,20 @@ private:
 	 * Frees all resources allocated for the material.
 	 */
 	void _DestroyResources();
+
+	/**
+	 * Copies data into a UBO variable, marking the UBO dirty if it changed.
+	 */
+	void _SetUBOData(UNIFORM_BUFFER_INFO& ubo, size_t offset, const void* data, size_t len);
 };
 
+/**
+ * A variable handle for a WMaterialCollection, holding the resolved handle of
+ * each material in the collection. It must be resolved again if materials
+ * are added to or removed from the collection.
+ */
+typedef std::vector<std::pair<WMaterial*, WMaterialVariableHandle>> WMaterialCollectionVariableHandle;
+
 /**
  * Helper class to deal with a collection of materials using the same interface as
  * a single one.
@@ -222,6 +431,16 @@ public:
 		return SetVariableData(varName, arr, sizeof(T) * numElements);
 	}
 	WError SetVariableData(const char* varName, void* data, size_t len);
+	WMaterialCollectionVariableHandle GetVariableHandle(const char* varName) const;
+	template<typename T>
+	WError SetVariable(const WMaterialCollectionVariableHandle& handle, T value) {
+		return SetVariableData(handle, &value, sizeof(T));
+	}
+	template<typename T>
+	WError SetVariableArray(const WMaterialCollectionVariableHandle& handle, T* arr, int numElements) {
+		return SetVariableData(handle, arr, sizeof(T) * numElements);
+	}
+	WError SetVariableData(const WMaterialCollectionVariableHandle& handle, const void* data, size_t len);
 	WError SetTexture(uint32_t bindingIndex, class WImage* img, uint32_t arrayIndex = 0);
 	WError SetTexture(std::string name, class WImage* img, uint32_t arrayIndex = 0);
 };
@@ -239,6 +458,35 @@ class WMaterialManager : public WManager<WMaterial> {
 	 */
 	virtual std::string GetTypeName() const;
 
+	/** Descriptor pool pages, allocations are attempted on the most recently successful page first */
+	std::vector<VkDescriptorPool> m_descriptorPools;
+	/** Index of the page the last allocation succeeded on */
+	uint32_t m_currentDescriptorPool;
+
+	/**
+	 * Creates a new descriptor pool page and appends it to m_descriptorPools.
+	 * @param  minSizes  Descriptor counts the page must at least be able to hold
+	 * @param  minSets   Number of sets the page must at least be able to hold
+	 * @return           Vulkan result of the operation
+	 */
+	VkResult _CreateDescriptorPoolPage(const std::vector<VkDescriptorPoolSize>& minSizes, uint32_t minSets);
+
 public:
 	WMaterialManager(class Wasabi* const app);
+	~WMaterialManager();
+
+	/**
+	 * Allocates descriptor sets from the shared descriptor pools. Pools are
+	 * created in pages as needed, and sets freed (using
+	 * WVulkanMemoryManager::ReleaseDescriptorSet() with the returned pool) are
+	 * recycled by the pool they came from.
+	 * @param  layout    Layout of the sets to allocate
+	 * @param  setSizes  Descriptor counts needed by a single set of layout
+	 * @param  numSets   Number of sets to allocate
+	 * @param  sets      Array of numSets sets to fill
+	 * @param  pool      Set to the pool the sets were allocated from
+	 * @return           Vulkan result of the operation
+	 */
+	VkResult AllocateDescriptorSets(VkDescriptorSetLayout layout, const std::vector<VkDescriptorPoolSize>& setSizes,
+									uint32_t numSets, VkDescriptorSet* sets, VkDescriptorPool* pool);
 };
@@ -24,4 +24,5 @@ private:
 
 	void* m_readOnlyMemory;
 	std::vector<WVulkanBuffer> m_buffers;
+	std::vector<void*> m_mappedData;
 };
\ No newline at end of file
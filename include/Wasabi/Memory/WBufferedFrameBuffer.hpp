@@ -7,15 +7,30 @@ class WBufferedFrameBuffer {
 public:
 	WBufferedFrameBuffer();
 
+	/**
+	 * Creates the frame buffers of the back buffer: one per buffering index
+	 * (each with its own depth buffer) and per swap chain image, since the
+	 * image acquired for a frame does not follow the buffering index.
+	 */
 	VkResult CreateForSwapchain(class Wasabi* app, uint32_t numBuffers, uint32_t width, uint32_t height, VkRenderPass renderPass, std::vector<VkImageView> swapchainViews, VkFormat depthFormat);
 	VkResult Create(class Wasabi* app, uint32_t numBuffers, uint32_t width, uint32_t height, VkRenderPass renderPass, std::vector<WBufferedImage> colorImages, WBufferedImage depthImage = WBufferedImage());
 	void Destroy(class Wasabi* app);
 
-	VkFramebuffer GetFrameBuffer(uint32_t bufferIndex);
+	/**
+	 * @param  bufferIndex      Buffering index of the frame
+	 * @param  backbufferIndex  Index of the swap chain image the frame renders
+	 *                          to (see WRenderer::GetCurrentBackbufferIndex()),
+	 *                          only used by frame buffers created with
+	 *                          CreateForSwapchain()
+	 * @return                  The frame buffer to render to
+	 */
+	VkFramebuffer GetFrameBuffer(uint32_t bufferIndex, uint32_t backbufferIndex = 0);
 
 	bool Valid() const;
 
 private:
 	std::vector<VkFramebuffer> m_frameBuffers;
+	/** Number of swap chain images per buffering index, 0 if not created with CreateForSwapchain() */
+	uint32_t m_numSwapchainImages;
 	WBufferedImage m_swapchainDepthBuffer;
 };
@@ -60,4 +60,7 @@ private:
 	std::vector<VkImageLayout> m_layouts;
 
 	VkResult CopyStagingToImage(class Wasabi* app, WVulkanBuffer& buffer, WVulkanImage& image, VkImageLayout& initialLayout);
+	VkImageLayout _GetTargetLayout() const;
+	VkImageSubresourceRange _GetSubresourceRange() const;
+	VkBufferImageCopy _GetCopyRegion() const;
 };
\ No newline at end of file
@@ -0,0 +1,132 @@
+/** @file WTLSFAllocator.hpp
+ *  @brief Two-level segregated fit (TLSF) offset allocator
+ *
+ *  The allocator manages a linear range [0, size) and hands out aligned
+ *  sub-ranges of it in O(1). It does not own any memory itself, it is used by
+ *  WVulkanMemoryManager to carve large Vulkan device memory pages into the
+ *  smaller regions that back individual buffers and images.
+ *
+ *  @author Hasan Al-Jawaheri (hbj)
+ *  @bug No known bugs.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * An offset allocator implementing the two-level segregated fit algorithm.
+ * Free regions are binned by a first level (power of two) and a second level
+ * (linear subdivision of the power of two) index, and two bitmaps are used to
+ * find a fitting bin with a couple of bit-scans. Freed regions are
+ * immediately coalesced with their free physical neighbours.
+ */
+class WTLSFAllocator {
+public:
+	/** Returned by Allocate() when the request cannot be satisfied */
+	static const uint32_t INVALID_NODE = 0xFFFFFFFF;
+
+	WTLSFAllocator();
+	~WTLSFAllocator();
+
+	/**
+	 * Resets the allocator to manage the range [0, size). All previous
+	 * allocations are discarded.
+	 * @param size Size of the managed range
+	 */
+	void Initialize(uint64_t size);
+
+	/**
+	 * Allocates an aligned region.
+	 * @param  size       Size of the region to allocate
+	 * @param  alignment  Required alignment of the region's offset, must be a
+	 *                    power of two (0 or 1 for no alignment)
+	 * @param  offset     Pointer to be filled with the region's offset
+	 * @return            A handle to the allocation, to be passed to Free(), or
+	 *                    INVALID_NODE if there is no free region big enough
+	 */
+	uint32_t Allocate(uint64_t size, uint64_t alignment, uint64_t* offset);
+
+	/**
+	 * Frees a region previously returned by Allocate().
+	 * @param node Handle returned by Allocate()
+	 */
+	void Free(uint32_t node);
+
+	/**
+	 * @return Size of the managed range
+	 */
+	uint64_t GetSize() const;
+
+	/**
+	 * @return Number of bytes currently allocated (including alignment padding)
+	 */
+	uint64_t GetUsedSize() const;
+
+	/**
+	 * @return Number of live allocations
+	 */
+	uint32_t GetNumAllocations() const;
+
+	/**
+	 * @return Number of free regions (a measure of fragmentation)
+	 */
+	uint32_t GetNumFreeRegions() const;
+
+	/**
+	 * @return true if there are no live allocations, false otherwise
+	 */
+	bool IsEmpty() const;
+
+private:
+	/** Number of bits used for the second level index */
+	static const uint32_t SL_LOG2 = 4;
+	/** Number of second level bins per first level bin */
+	static const uint32_t SL_COUNT = 1 << SL_LOG2;
+	/** Number of first level bins (enough for ranges well beyond any device heap) */
+	static const uint32_t FL_COUNT = 48;
+
+	/** A region in the managed range, either free or allocated */
+	struct NODE {
+		/** Offset of the region */
+		uint64_t offset;
+		/** Size of the region */
+		uint64_t size;
+		/** Physically preceding region */
+		uint32_t prevPhysical;
+		/** Physically succeeding region */
+		uint32_t nextPhysical;
+		/** Previous region in the same free list (free regions only) */
+		uint32_t prevFree;
+		/** Next region in the same free list (free regions only) */
+		uint32_t nextFree;
+		/** Whether or not the region is free */
+		bool free;
+	};
+
+	/** Total size of the managed range */
+	uint64_t m_size;
+	/** Allocated bytes */
+	uint64_t m_usedSize;
+	/** Live allocations count */
+	uint32_t m_numAllocations;
+	/** Free regions count */
+	uint32_t m_numFreeRegions;
+	/** Node storage, indexed by node handle */
+	std::vector<NODE> m_nodes;
+	/** Unused entries in m_nodes, available for reuse */
+	std::vector<uint32_t> m_unusedNodes;
+	/** Bit i is set if any second level list of first level i is non-empty */
+	uint64_t m_firstLevelBitmap;
+	/** Bit j of entry i is set if m_freeLists[i][j] is non-empty */
+	uint32_t m_secondLevelBitmaps[FL_COUNT];
+	/** Heads of the free lists */
+	uint32_t m_freeLists[FL_COUNT][SL_COUNT];
+
+	uint32_t _NewNode();
+	void _Mapping(uint64_t size, uint32_t* fl, uint32_t* sl) const;
+	void _InsertFree(uint32_t node);
+	void _RemoveFree(uint32_t node);
+	uint32_t _FindFree(uint64_t size) const;
+};
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "Wasabi/Core/WCommon.hpp"
+#include "Wasabi/Memory/WTLSFAllocator.hpp"
+
+#include <functional>
 
 /** A bitfield specifying the intention for a map operation */
 enum W_MAP_FLAGS: uint32_t {
@@ -34,6 +37,28 @@ enum W_MEMORY_STORAGE: uint8_t {
 	W_MEMORY_DEVICE_LOCAL_HOST_COPY = 3,
 };
 
+/**
+ * A region of Vulkan device memory allocated by WVulkanMemoryManager. Small
+ * allocations are carved out of large shared pages, so the memory object is
+ * generally shared with other allocations and offset must be respected when
+ * binding. Use WVulkanMemoryManager::MapMemory() rather than vkMapMemory()
+ * to access host-visible allocations.
+ */
+struct WVulkanMemoryAllocation {
+	/** Device memory backing the allocation (possibly shared with other allocations) */
+	VkDeviceMemory memory;
+	/** Offset of the allocation inside memory */
+	VkDeviceSize offset;
+	/** Size of the allocation */
+	VkDeviceSize size;
+	/** The page this allocation was made from */
+	struct WVulkanMemoryPage* page;
+	/** Handle of the allocation inside page */
+	uint32_t node;
+
+	WVulkanMemoryAllocation() : memory(VK_NULL_HANDLE), offset(0), size(0), page(nullptr), node(0) {}
+};
+
 /**
  * Wrapper for a Vulkan buffer an its backing memory.
  */
@@ -41,9 +66,9 @@ struct WVulkanBuffer {
 	/** Vulkan buffer */
 	VkBuffer buf;
 	/** buf's backing memory */
-	VkDeviceMemory mem;
+	WVulkanMemoryAllocation mem;
 
-	WVulkanBuffer() : buf(VK_NULL_HANDLE), mem(VK_NULL_HANDLE) {}
+	WVulkanBuffer() : buf(VK_NULL_HANDLE) {}
 
 	/**
 	 * Creates the buffer and its memory and binds the memory to it
@@ -59,6 +84,20 @@ struct WVulkanBuffer {
 	 * @param app The Vulkan device used to crate the buffer
 	 */
 	void Destroy(class Wasabi* app);
+
+	/**
+	 * Maps the buffer's memory, which must be host-visible.
+	 * @param app   Pointer to a Wasabi instance
+	 * @param data  Pointer to be filled with the address of the buffer's memory
+	 * @return      Vulkan result of the operation
+	 */
+	VkResult Map(class Wasabi* app, void** data);
+
+	/**
+	 * Unmaps memory mapped by Map().
+	 * @param app Pointer to a Wasabi instance
+	 */
+	void Unmap(class Wasabi* app);
 };
 
 /**
@@ -68,11 +107,11 @@ struct WVulkanImage {
 	/** Vulkan image */
 	VkImage img;
 	/** img's backing memory */
-	VkDeviceMemory mem;
+	WVulkanMemoryAllocation mem;
 	/** img's view */
 	VkImageView view;
 
-	WVulkanImage() : img(VK_NULL_HANDLE), mem(VK_NULL_HANDLE), view(VK_NULL_HANDLE) {}
+	WVulkanImage() : img(VK_NULL_HANDLE), view(VK_NULL_HANDLE) {}
 
 	/**
 	 * Creates the image and its memory and binds the memory to it. Optionally creates a view.
@@ -90,6 +129,79 @@ struct WVulkanImage {
 	 * @param app The Vulkan device used to crate the buffer
 	 */
 	void Destroy(class Wasabi* app);
+
+	/**
+	 * Maps the image's memory, which must be host-visible.
+	 * @param app   Pointer to a Wasabi instance
+	 * @param data  Pointer to be filled with the address of the image's memory
+	 * @return      Vulkan result of the operation
+	 */
+	VkResult Map(class Wasabi* app, void** data);
+
+	/**
+	 * Unmaps memory mapped by Map().
+	 * @param app Pointer to a Wasabi instance
+	 */
+	void Unmap(class Wasabi* app);
+};
+
+/**
+ * A large block of Vulkan device memory that allocations are carved out of.
+ * Dedicated pages hold exactly one (large) allocation.
+ */
+struct WVulkanMemoryPage {
+	/** The Vulkan memory of the page */
+	VkDeviceMemory memory;
+	/** Size of memory */
+	VkDeviceSize size;
+	/** Memory type index of memory */
+	uint32_t memoryTypeIndex;
+	/** Pool the page belongs to (see WVulkanMemoryManager::AllocateMemory) */
+	uint32_t pool;
+	/** Whether or not the page holds a single dedicated allocation */
+	bool dedicated;
+	/** Host address of memory if it has been mapped, nullptr otherwise */
+	void* mappedData;
+	/** Allocator managing the page's space (unused for dedicated pages) */
+	WTLSFAllocator allocator;
+};
+
+/**
+ * Statistics about the device memory allocated by WVulkanMemoryManager.
+ */
+struct WVulkanMemoryStats {
+	/** Number of live VkDeviceMemory objects (pages and dedicated allocations) */
+	uint32_t numDeviceMemoryObjects;
+	/** Number of live dedicated allocations */
+	uint32_t numDedicatedAllocations;
+	/** Number of live allocations, including dedicated ones */
+	uint32_t numAllocations;
+	/** Number of free regions in all pages, a measure of fragmentation */
+	uint32_t numFreeRegions;
+	/** Total size of all live VkDeviceMemory objects */
+	VkDeviceSize reservedBytes;
+	/** Total size of all live allocations */
+	VkDeviceSize usedBytes;
+	/** Number of vkAllocateMemory calls made since initialization */
+	uint64_t totalDeviceAllocations;
+	/** Number of allocations made since initialization */
+	uint64_t totalAllocations;
+};
+
+/**
+ * Transient, host-visible memory allocated from a per-frame ring (see
+ * WVulkanMemoryManager::AllocateFrameMemory()). The memory is only valid
+ * until the same buffering index is rendered again.
+ */
+struct WFrameAllocation {
+	/** Buffer the allocation lives in */
+	VkBuffer buffer;
+	/** Offset of the allocation inside buffer */
+	VkDeviceSize offset;
+	/** Host address of the allocation, always mapped */
+	void* data;
+
+	WFrameAllocation() : buffer(VK_NULL_HANDLE), offset(0), data(nullptr) {}
 };
 
 class WVulkanMemoryManager {
@@ -97,7 +209,24 @@ public:
 	WVulkanMemoryManager();
 	~WVulkanMemoryManager();
 
-	WError Initialize(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, uint32_t graphicsQueueIndex);
+	/**
+	 * Initializes the memory manager.
+	 * @param physicalDevice      Vulkan physical device
+	 * @param device              Vulkan device
+	 * @param queue               Graphics queue
+	 * @param graphicsQueueIndex  Family index of queue
+	 * @param transferQueue       Queue to perform uploads on, VK_NULL_HANDLE to
+	 *                            use the graphics queue
+	 * @param transferQueueIndex  Family index of transferQueue
+	 * @param stagingRingSize     Size of the host-visible staging ring used for
+	 *                            uploads
+	 * @param frameRingSize       Initial size of each per-frame ring (see
+	 *                            AllocateFrameMemory())
+	 * @return                    Error code, see WError.h
+	 */
+	WError Initialize(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, uint32_t graphicsQueueIndex,
+					  VkQueue transferQueue = VK_NULL_HANDLE, uint32_t transferQueueIndex = 0,
+					  VkDeviceSize stagingRingSize = 16 * 1024 * 1024, VkDeviceSize frameRingSize = 4 * 1024 * 1024);
 
 	/**
 	 * Retrieves a Vulkan command pool to be used to initialize command buffers.
@@ -124,7 +253,8 @@ public:
 
 	/**
 	 * Ends recording commands on the copy command buffer and submits it to the
-	 * graphics queue.
+	 * graphics queue. Pending uploads are submitted first so that the copy
+	 * command buffer is ordered after them.
 	 * @param waitQueue   Whether or not to wait for the queue to finish copying
 	 * @param signalFence A fence to signal when GPU finishes with the submission
 	 * @return A Vulkan result, VK_SUCCESS on success
@@ -138,6 +268,161 @@ public:
 	 */
 	VkCommandBuffer GetCopyCommandBuffer() const;
 
+	/**
+	 * Allocates device memory for a resource. Allocations smaller than half
+	 * a page are sub-allocated from shared pages of the matching memory type,
+	 * larger ones get their own dedicated memory. Linear (buffers and linear
+	 * images) and non-linear (optimal images) resources are placed in
+	 * separate pages when the device has a buffer-image granularity, so
+	 * neighbouring allocations never alias a granularity page.
+	 * @param memoryRequirements  Memory requirements of the resource
+	 * @param properties          Requested memory properties
+	 * @param linear              Whether the resource is a buffer or a linear image
+	 * @param allocation          Allocation to fill
+	 * @return                    Vulkan result of the operation
+	 */
+	VkResult AllocateMemory(VkMemoryRequirements memoryRequirements, VkMemoryPropertyFlags properties, bool linear, WVulkanMemoryAllocation* allocation);
+
+	/**
+	 * Maps a host-visible allocation. Pages are mapped once and stay mapped
+	 * for as long as they are alive, so this is cheap to call.
+	 * @param allocation  Allocation to map
+	 * @param data        Pointer to be filled with the address of the allocation
+	 * @return            Vulkan result of the operation
+	 */
+	VkResult MapMemory(const WVulkanMemoryAllocation& allocation, void** data);
+
+	/**
+	 * Unmaps an allocation mapped by MapMemory(), flushing it if its memory is
+	 * not host-coherent.
+	 * @param allocation Allocation to unmap
+	 */
+	void UnmapMemory(const WVulkanMemoryAllocation& allocation);
+
+	/**
+	 * Allocations still counted once their owners are all destroyed (e.g.
+	 * after the engine's managers are destroyed) were leaked, so these stats
+	 * can be used to find leaks before the manager frees their memory.
+	 * @return Current allocation statistics
+	 */
+	WVulkanMemoryStats GetMemoryStats() const;
+
+	/**
+	 * Queues an asynchronous upload of data into a buffer. The data is copied
+	 * into a staging ring immediately (so it can be freed by the caller once
+	 * this returns) and the copy is recorded into the current upload batch.
+	 * The batch is submitted by SubmitUploads(), which the renderer calls
+	 * before every frame submission, so the buffer can be used by any graphics
+	 * work submitted after this call.
+	 * @param buffer      Destination buffer, must have been created with
+	 *                    VK_BUFFER_USAGE_TRANSFER_DST_BIT
+	 * @param offset      Offset into buffer to upload to
+	 * @param data        Data to upload
+	 * @param size        Size of data
+	 * @param onComplete  Optional callback, called by UpdateUploads() once the
+	 *                    upload is complete on the GPU
+	 * @return            Vulkan result of the operation
+	 */
+	VkResult UploadToBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size, std::function<void()> onComplete = nullptr);
+
+	/**
+	 * Queues an asynchronous upload of data into an image, transitioning it
+	 * from oldLayout to TRANSFER_DST_OPTIMAL for the copy and then to
+	 * newLayout. See UploadToBuffer(). If the transfer queue's
+	 * minImageTransferGranularity doesn't allow copying region, the copy is
+	 * recorded on the graphics queue instead (along with the batch's
+	 * ownership acquires).
+	 * @param image             Destination image, must have been created with
+	 *                          VK_IMAGE_USAGE_TRANSFER_DST_BIT
+	 * @param subresourceRange  Subresources to transition
+	 * @param oldLayout         Current layout of image
+	 * @param newLayout         Layout to leave the image in
+	 * @param region            Copy region (bufferOffset is ignored)
+	 * @param imageExtent       Extent of the first mip level of image
+	 * @param data              Data to upload, if nullptr only the layout
+	 *                          transition is performed
+	 * @param size              Size of data
+	 * @param texelSize         Size of a texel (or block) of the image's format
+	 * @param onComplete        Optional completion callback
+	 * @return                  Vulkan result of the operation
+	 */
+	VkResult UploadToImage(VkImage image, VkImageSubresourceRange subresourceRange, VkImageLayout oldLayout, VkImageLayout newLayout,
+						   VkBufferImageCopy region, VkExtent3D imageExtent, const void* data, VkDeviceSize size, VkDeviceSize texelSize,
+						   std::function<void()> onComplete = nullptr);
+
+	/**
+	 * Submits the current upload batch, if any. On a dedicated transfer queue,
+	 * the batch ends with a queue family ownership release and a matching
+	 * acquire is submitted to the graphics queue (waiting on the transfer
+	 * through a semaphore), so graphics submissions made after this call are
+	 * ordered after the uploads.
+	 * @return Vulkan result of the operation
+	 */
+	VkResult SubmitUploads();
+
+	/**
+	 * Retires completed upload batches: recycles their staging memory and
+	 * calls their completion callbacks. Called by the renderer every frame.
+	 */
+	void UpdateUploads();
+
+	/**
+	 * Submits pending uploads and blocks until all uploads are complete.
+	 * @return Vulkan result of the operation
+	 */
+	VkResult WaitForUploads();
+
+	/**
+	 * @return true if uploads run on a dedicated transfer queue, false if
+	 *         they share the graphics queue
+	 */
+	bool HasTransferQueue() const;
+
+	/**
+	 * Allocates transient host-visible memory from the ring of a buffering
+	 * index. This is a linear allocation (a pointer bump) meant for data
+	 * that is rewritten every frame, such as dynamic vertices or indirect
+	 * draw commands. All
+	 * allocations of a ring are discarded at once by ReleaseFrameResources()
+	 * once the GPU is done with the frame, so the memory must not be used
+	 * beyond the frame it was allocated for. A ring that runs out of space
+	 * spills into a new buffer and is resized to fit the whole frame the next
+	 * time it is reset.
+	 * @param size         Size of the allocation
+	 * @param alignment    Required alignment of the allocation's offset
+	 * @param bufferIndex  Buffering index of the frame the memory is used in
+	 * @param allocation   Allocation to fill
+	 * @return             Vulkan result of the operation
+	 */
+	VkResult AllocateFrameMemory(VkDeviceSize size, VkDeviceSize alignment, uint32_t bufferIndex, WFrameAllocation* allocation);
+
+	/**
+	 * Makes sure every buffering index has a command pool for secondary
+	 * command buffers for each of numThreads threads (see
+	 * AcquireSecondaryCommandBuffer()). This must not be called while threads
+	 * are acquiring secondary command buffers.
+	 * @param numThreads  Number of threads that may record secondary command
+	 *                    buffers
+	 * @return            Vulkan result of the operation
+	 */
+	VkResult ReserveSecondaryCommandPools(uint32_t numThreads);
+
+	/**
+	 * Acquires a secondary command buffer to be recorded for the frame of a
+	 * buffering index. Like the per-frame memory, all the command buffers of
+	 * a buffering index are reset at once by ReleaseFrameResources() once the
+	 * GPU is done with the frame. Every thread acquires from its own command
+	 * pool, so this may be called from multiple threads at once as long as
+	 * they pass different thread indices.
+	 * @param bufferIndex  Buffering index of the frame the command buffer is
+	 *                     used in
+	 * @param threadIndex  Index of the calling thread, less than the number of
+	 *                     threads passed to ReserveSecondaryCommandPools()
+	 * @param cmdBuf       Set to the acquired command buffer
+	 * @return             Vulkan result of the operation
+	 */
+	VkResult AcquireSecondaryCommandBuffer(uint32_t bufferIndex, uint32_t threadIndex, VkCommandBuffer* cmdBuf);
+
 	void ReleaseAllResources(uint32_t setBufferingCount = std::numeric_limits<uint32_t>::max());
 	void ReleaseFrameResources(uint32_t bufferIndex);
 
@@ -154,12 +439,97 @@ public:
 	void ReleaseImage(VkImage& image, uint32_t bufferIndex);
 	void ReleaseImageView(VkImageView& imageView, uint32_t bufferIndex);
 	void ReleaseDeviceMemory(VkDeviceMemory& deviceMemory, uint32_t bufferIndex);
+	void ReleaseMemory(WVulkanMemoryAllocation& allocation, uint32_t bufferIndex);
 	void ReleaseSampler(VkSampler& sampler, uint32_t bufferIndex);
 	void ReleaseCommandBuffer(VkCommandBuffer& commandBuffer, uint32_t bufferIndex);
 	void ReleaseSemaphore(VkSemaphore& semaphore, uint32_t bufferIndex);
 	void ReleaseFence(VkFence& fence, uint32_t bufferIndex);
 
 private:
+	/** An image copy that the transfer queue can't perform, recorded on the graphics queue instead */
+	struct GRAPHICS_IMAGE_UPLOAD {
+		/** Destination image */
+		VkImage image;
+		/** Subresources to transition */
+		VkImageSubresourceRange subresourceRange;
+		/** Layout to transition from */
+		VkImageLayout oldLayout;
+		/** Layout to leave the image in */
+		VkImageLayout newLayout;
+		/** Staging buffer holding the data */
+		VkBuffer stagingBuffer;
+		/** Copy region (bufferOffset points into stagingBuffer) */
+		VkBufferImageCopy region;
+	};
+
+	/** A batch of uploads, submitted together */
+	struct UPLOAD_BATCH {
+		/** Command buffer (from m_uploadCmdPool) recording the copies */
+		VkCommandBuffer cmdBuf;
+		/** Command buffer (from m_cmdPool) recording the ownership acquires,
+		    only used with a dedicated transfer queue */
+		VkCommandBuffer acquireCmdBuf;
+		/** Signaled by the transfer submission and waited on by the acquire
+		    submission, only used with a dedicated transfer queue */
+		VkSemaphore semaphore;
+		/** Signaled when the whole batch is complete */
+		VkFence fence;
+		/** Number of uploads recorded in the batch */
+		uint32_t numUploads;
+		/** Position of the staging ring's head after the last allocation of the batch */
+		VkDeviceSize ringEnd;
+		/** Bytes of the staging ring consumed by the batch (including padding) */
+		VkDeviceSize ringConsumed;
+		/** Buffer barriers to record at the end of the batch */
+		std::vector<VkBufferMemoryBarrier> bufferReleases;
+		/** Image barriers to record at the end of the batch */
+		std::vector<VkImageMemoryBarrier> imageReleases;
+		/** Ownership acquire buffer barriers (dedicated transfer queue only) */
+		std::vector<VkBufferMemoryBarrier> bufferAcquires;
+		/** Ownership acquire image barriers (dedicated transfer queue only) */
+		std::vector<VkImageMemoryBarrier> imageAcquires;
+		/** Image copies recorded after the ownership acquires (dedicated transfer queue only) */
+		std::vector<GRAPHICS_IMAGE_UPLOAD> graphicsImageUploads;
+		/** Completion callbacks */
+		std::vector<std::function<void()>> callbacks;
+		/** Staging buffers for uploads too big for the staging ring */
+		std::vector<std::pair<VkBuffer, WVulkanMemoryAllocation>> tempStagingBuffers;
+	};
+
+	/** A host-visible buffer backing (part of) a per-frame ring */
+	struct FRAME_RING_CHUNK {
+		/** The buffer */
+		VkBuffer buffer;
+		/** Memory of buffer */
+		WVulkanMemoryAllocation memory;
+		/** Mapped address of buffer */
+		char* data;
+		/** Size of buffer */
+		VkDeviceSize size;
+	};
+
+	/** The linear allocator of one buffering index */
+	struct FRAME_RING {
+		/** Chunks allocated this frame, allocations are made from the last one */
+		std::vector<FRAME_RING_CHUNK> chunks;
+		/** Next free position in the last chunk */
+		VkDeviceSize head;
+		/** Bytes allocated (including padding) since the last reset */
+		VkDeviceSize used;
+
+		FRAME_RING() : head(0), used(0) {}
+	};
+
+	/** The secondary command buffers one thread records for one buffering index */
+	struct SECONDARY_COMMAND_POOL {
+		/** Pool of the command buffers, reset as a whole */
+		VkCommandPool pool;
+		/** Command buffers allocated from pool */
+		std::vector<VkCommandBuffer> buffers;
+		/** Number of buffers acquired since the last reset */
+		uint32_t numUsed;
+	};
+
 	/** A resource pending to be freed */
 	struct RESOURCE_TO_FREE {
 		/** type of the resource */
@@ -186,12 +556,84 @@ private:
 	VkCommandPool m_cmdPool;
 	/** A dummy command buffer for general use */
 	VkCommandBuffer m_copyCommandBuffer;
+	/** Family index of the graphics queue */
+	uint32_t m_graphicsQueueIndex;
+	/** Queue uploads are submitted to (may be m_graphicsQueue) */
+	VkQueue m_transferQueue;
+	/** Family index of m_transferQueue */
+	uint32_t m_transferQueueIndex;
+	/** Command pool for m_transferQueue's family */
+	VkCommandPool m_uploadCmdPool;
+	/** minImageTransferGranularity of m_transferQueue's family */
+	VkExtent3D m_transferGranularity;
+	/** The upload batch currently being recorded */
+	UPLOAD_BATCH* m_currentUpload;
+	/** Submitted upload batches, in submission order */
+	std::vector<UPLOAD_BATCH*> m_uploadsInFlight;
+	/** Retired upload batches, ready to be reused */
+	std::vector<UPLOAD_BATCH*> m_freeUploads;
+	/** The staging ring buffer */
+	VkBuffer m_stagingRing;
+	/** Memory of m_stagingRing */
+	WVulkanMemoryAllocation m_stagingRingMemory;
+	/** Mapped address of m_stagingRing */
+	char* m_stagingRingData;
+	/** Size of m_stagingRing */
+	VkDeviceSize m_stagingRingSize;
+	/** Next free position in the staging ring */
+	VkDeviceSize m_stagingRingHead;
+	/** Start of the oldest in-use region of the staging ring */
+	VkDeviceSize m_stagingRingTail;
+	/** Bytes of the staging ring in use by batches */
+	VkDeviceSize m_stagingRingUsed;
+	/** Per-frame rings, one per buffering index */
+	std::vector<FRAME_RING> m_frameRings;
+	/** Minimum size of a per-frame ring chunk */
+	VkDeviceSize m_frameRingSize;
+	/** Secondary command pools, per buffering index and per thread */
+	std::vector<std::vector<SECONDARY_COMMAND_POOL>> m_secondaryCommandPools;
 	/** An array whose size is double the buffering count. The first half is for resources to be freed on the next i'th frame
 	    while the second half is for resources to be freed on the frame after. Each element of the array is an array of
 		RESOURCE_TO_FREE.
 	 */
 	std::vector<std::vector<RESOURCE_TO_FREE>> m_resourcesToBeFreed;
+	/** Pages to sub-allocate from, per memory type and per pool (linear/non-linear) */
+	std::vector<WVulkanMemoryPage*> m_memoryPages[VK_MAX_MEMORY_TYPES][2];
+	/** Pages of the live dedicated allocations, freed (and reported) at shutdown if they are still alive */
+	std::vector<WVulkanMemoryPage*> m_dedicatedPages;
+	/** Total size of live dedicated allocations */
+	VkDeviceSize m_dedicatedBytes;
+	/** Number of vkAllocateMemory calls */
+	uint64_t m_totalDeviceAllocations;
+	/** Number of allocations made */
+	uint64_t m_totalAllocations;
 
 	/** Releases a resource from m_resourcesToBeFreed */
 	void _ReleaseResource(int type, void* resource, void* aux);
+	/** Creates a new page (or dedicated allocation) */
+	VkResult _CreatePage(VkDeviceSize size, uint32_t memoryTypeIndex, uint32_t pool, bool dedicated, WVulkanMemoryPage** page);
+	/** Frees a page and its Vulkan memory */
+	void _DestroyPage(WVulkanMemoryPage* page);
+	/** Frees an allocation made by AllocateMemory() */
+	void _FreeAllocation(WVulkanMemoryPage* page, uint32_t node);
+	/** Size of the pages to create for a memory type */
+	VkDeviceSize _GetPageSize(uint32_t memoryTypeIndex) const;
+	/** Whether the transfer queue can copy region into an image whose first mip level has imageExtent */
+	bool _IsTransferGranularityAligned(const VkBufferImageCopy& region, VkExtent3D imageExtent) const;
+	/** Makes sure m_currentUpload is ready for recording */
+	VkResult _BeginUploadBatch();
+	/** Retires a complete upload batch */
+	void _RetireUploadBatch(UPLOAD_BATCH* batch);
+	/** Destroys an upload batch's Vulkan objects */
+	void _DestroyUploadBatch(UPLOAD_BATCH* batch);
+	/** Allocates staging memory for the current upload batch, submitting or waiting for older batches if needed */
+	VkResult _GetStagingMemory(VkDeviceSize size, VkDeviceSize alignment, VkBuffer* buffer, VkDeviceSize* offset, void** data);
+	/** Tries to allocate from the staging ring */
+	bool _AllocateFromStagingRing(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset);
+	/** Creates a persistently mapped buffer for a per-frame ring */
+	VkResult _CreateFrameRingChunk(VkDeviceSize size, FRAME_RING_CHUNK* chunk);
+	/** Destroys a chunk created by _CreateFrameRingChunk() */
+	void _DestroyFrameRingChunk(FRAME_RING_CHUNK& chunk);
+	/** Discards all allocations of a per-frame ring, consolidating its chunks if it spilled */
+	void _ResetFrameRing(FRAME_RING& ring);
 };
@@ -14,6 +14,11 @@
 
 #include "Wasabi/Core/WCore.hpp"
 #include "Wasabi/Materials/WMaterialsStore.hpp"
+#include "Wasabi/Materials/WMaterial.hpp"
+#include "Wasabi/Core/WAABBTree.hpp"
+#include "Wasabi/Cameras/WCamera.hpp"
+
+#include <unordered_set>
 
 /**
  * @ingroup engineclass
@@ -136,6 +141,28 @@ public:
 	 */
 	void Render(class WRenderTarget* rt, class WMaterial* material, bool updateInstances = true);
 
+	/**
+	 * Performs the first half of Render(): updates the instances data and
+	 * fills in the material with the object data, including its GPU
+	 * resources (see WMaterial::UpdateResources()). This modifies the
+	 * material and engine resources, so it must not run concurrently with
+	 * other rendering work.
+	 * @param material        Material to fill in with object data
+	 * @param updateInstances Whether or not to update the instances data
+	 */
+	void PrepareRender(class WMaterial* material, bool updateInstances = true);
+
+	/**
+	 * Performs the second half of Render(): binds the material and records the
+	 * draw of the object. PrepareRender() must have been called first with
+	 * the same material. This only records commands into the command buffer
+	 * of rt, so it may be called for different objects from multiple threads
+	 * at once (see WRenderTarget::RecordInParallel()).
+	 * @param rt        Render target to render to.
+	 * @param material  Material to bind
+	 */
+	void RecordRender(class WRenderTarget* rt, class WMaterial* material);
+
 	/**
 	 * Sets the attached geometry.
 	 * @param  geometry Geometry to attach, or nullptr to remove the attachment
@@ -162,6 +189,24 @@ public:
 	 */
 	class WAnimation* GetAnimation() const;
 
+	/**
+	 * Sets a low-poly geometry that stands in for the object as an occluder
+	 * in software occlusion culling (see WSoftwareOcclusionCuller). The
+	 * occluder is transformed by the object's world matrix. It must be
+	 * readable by the CPU (see W_GEOMETRY_CREATE_CPU_READABLE) and lie inside
+	 * the object's geometry, otherwise objects it hides may be visible.
+	 * @param  geometry Occluder geometry, or nullptr to make the object not
+	 *                  occlude
+	 * @return          Error code, see WError.h
+	 */
+	WError SetOccluderGeometry(class WGeometry* geometry);
+
+	/**
+	 * Retrieves the occluder geometry, see SetOccluderGeometry().
+	 * @return Occluder geometry, nullptr if the object doesn't occlude
+	 */
+	class WGeometry* GetOccluderGeometry() const;
+
 	/**
 	 * Initiates geometry instancing for this object. When geometry instancing
 	 * is initiated, and at least one instance is created (via CreateInstance()),
@@ -244,6 +289,11 @@ public:
 	 */
 	void DisableFrustumCulling();
 
+	/**
+	 * @return true if frustum culling is enabled, see EnableFrustumCulling()
+	 */
+	bool IsFrustumCullingEnabled() const;
+
 	/**
 	 * Checks if the object appears anywhere in the view of the camera
 	 * @param  cam Camera to check against
@@ -252,6 +302,16 @@ public:
 	 */
 	bool InCameraView(class WCamera* cam);
 
+	/**
+	 * Computes the world-space axis-aligned bounding box of the object, which
+	 * encloses all 8 corners of its geometry's box in the world.
+	 * @param  center Set to the center of the box
+	 * @param  extent Set to the half-size of the box along each axis
+	 * @return        false if the object is not valid (and has no box), true
+	 *                otherwise
+	 */
+	bool GetWorldBoundingBox(WVector3* center, WVector3* extent);
+
 	/**
 	 * Sets the scale of this object.
 	 * @param scale Scale factor components
@@ -303,6 +363,8 @@ private:
 	class WGeometry* m_geometry;
 	/** Attached animation */
 	class WAnimation* m_animation;
+	/** Geometry standing in for the object in software occlusion culling */
+	class WGeometry* m_occluderGeometry;
 	/** true if the world matrix needs to be updated, false otherwise */
 	bool m_bAltered;
 	/** true if the object is hidden, false otherwise */
@@ -311,6 +373,8 @@ private:
 	bool m_bFrustumCull;
 	/** Local world matrix */
 	WMatrix m_WorldM;
+	/** Incremented whenever m_WorldM is rebuilt */
+	uint32_t m_worldMatrixVersion;
 	/** Scale of the object */
 	WVector3 m_scale;
 	/** Instancing texture */
@@ -321,11 +385,53 @@ private:
 	bool m_instancesDirty;
 	/** List of created instances */
 	vector<WInstance*> m_instanceV;
+	/** Proxy of the object in the manager's spatial index, WAABBTree::NULL_PROXY if not indexed */
+	uint32_t m_spatialProxy;
+	/** Index of the object in the manager's list of dirty objects, UINT32_MAX if it is not queued for a spatial index update */
+	uint32_t m_dirtySpatialIndex;
+	/** Index of the object in the manager's list of objects without frustum culling, UINT32_MAX if it is not in the list */
+	uint32_t m_unculledIndex;
+	/** Center of the world bounding box, as of the last spatial index update */
+	WVector3 m_worldBoundsCenter;
+	/** Half-size of the world bounding box, as of the last spatial index update */
+	WVector3 m_worldBoundsExtent;
+
+	/** Handles of the variables set by Render(), for one effect and binding set */
+	struct RENDER_VARIABLE_HANDLES {
+		WMaterialVariableHandle worldMatrix;
+		WMaterialVariableHandle isAnimated;
+		WMaterialVariableHandle isInstanced;
+		/** Unique ID of the own material the world matrix was last written to (0 if none), and the m_worldMatrixVersion written */
+		uint64_t worldMatrixMaterialID;
+		uint32_t worldMatrixVersion;
+	};
+	/**
+	 * Handles resolved so far, one entry per effect/binding set this object
+	 * was rendered with. Entries are keyed by the effect's unique ID (see
+	 * WBase::GetUniqueID()) so that an effect allocated where a destroyed
+	 * one used to be doesn't reuse its handles.
+	 */
+	vector<RENDER_VARIABLE_HANDLES> m_renderVariableHandles;
+
+	/**
+	 * Retrieves the handles of the variables set by Render() for a material,
+	 * resolving them if the material's effect wasn't seen before.
+	 */
+	RENDER_VARIABLE_HANDLES& _GetRenderVariableHandles(class WMaterial* material);
 
 	/**
 	 * Updates all the instances and the instance buffer.
 	 */
 	void _UpdateInstanceBuffer();
+
+	/**
+	 * Computes the world-space axis-aligned bounding box of the object (that
+	 * encloses all 8 corners of the geometry's box). The object must be
+	 * valid.
+	 * @param center Set to the center of the box
+	 * @param extent Set to the half-size of the box along each axis
+	 */
+	void _GetWorldBoundingBox(WVector3* center, WVector3* extent);
 };
 
 /**
@@ -334,6 +440,20 @@ private:
  */
 class WObjectManager : public WManager<WObject> {
 	friend class WObject;
+	friend class WGeometry;
+
+	/** Spatial index of the valid objects, by their world bounding boxes */
+	WAABBTree m_spatialIndex;
+	/** Objects whose spatial index entry needs to be updated (see WObject::m_dirtySpatialIndex) */
+	std::vector<WObject*> m_dirtySpatialObjects;
+	/** Geometries whose bounding boxes changed since the last update of the spatial index */
+	std::unordered_set<class WGeometry*> m_changedGeometries;
+	/** Objects that have frustum culling disabled (see WObject::m_unculledIndex) */
+	std::vector<WObject*> m_unculledObjects;
+	/** Scratch world boxes of the candidates of QueryFrustum() */
+	W_BOUNDING_BOXES m_frustumBoxes;
+	/** Scratch visibility bitmask of m_frustumBoxes */
+	std::vector<uint32_t> m_frustumVisibility;
 
 	/**
 	 * Returns "Object" string.
@@ -343,6 +463,7 @@ class WObjectManager : public WManager<WObject> {
 
 public:
 	WObjectManager(class Wasabi* const app);
+	~WObjectManager();
 
 	/**
 	 * Loads the manager.
@@ -373,8 +494,10 @@ public:
 	 * closest hit will be returned.
 	 * @param  x           Screen x coordinate to check for a hit
 	 * @param  y           Screen y coordinate to check for a hit
-	 * @param  bAnyHit     If set to true, the first hit will be returned,
-	 *                     otherwise the closest one will be returned
+	 * @param  bAnyHit     If set to true, the first object hit will be
+	 *                     returned, otherwise the closest one will be
+	 *                     returned. Either way, pt, uv and faceIndex are
+	 *                     those of the closest hit on the returned object
 	 * @param  iObjStartID If both iObjStartID and iObjEndID are non-zero, then
 	 *                     only objects whose ID is between iObjStartID and
 	 *                     iObjEndID (inclusive) are considered for picking
@@ -399,5 +522,83 @@ public:
 		uint32_t iObjStartID = 0,
 		uint32_t iObjEndID = 0,
 		WVector3* pt = nullptr, WVector2* uv = nullptr,
-		uint32_t* faceIndex = nullptr) const;
+		uint32_t* faceIndex = nullptr);
+
+	/**
+	 * Finds the valid objects whose bounding box is hit by a ray.
+	 * @param origin     Origin of the ray
+	 * @param direction  Direction of the ray
+	 * @param objects    Populated with the objects found (in no particular
+	 *                   order)
+	 */
+	void QueryRay(const WVector3& origin, const WVector3& direction, std::vector<WObject*>& objects);
+
+	/**
+	 * Finds the valid objects that are in the viewing frustum of a camera, as
+	 * of the camera's last WCamera::Render(). Objects that have frustum
+	 * culling disabled are always included.
+	 * @param cam      Camera to check against
+	 * @param objects  Populated with the objects found (in no particular
+	 *                 order)
+	 */
+	void QueryFrustum(class WCamera* cam, std::vector<WObject*>& objects);
+
+	/**
+	 * Finds the valid objects whose bounding box intersects a sphere.
+	 * @param center   Center of the sphere
+	 * @param radius   Radius of the sphere
+	 * @param objects  Populated with the objects found (in no particular
+	 *                 order)
+	 */
+	void QuerySphere(const WVector3& center, float radius, std::vector<WObject*>& objects);
+
+	/**
+	 * Finds the valid objects whose bounding box intersects a box.
+	 * @param min      Minimum point of the box
+	 * @param max      Maximum point of the box
+	 * @param objects  Populated with the objects found (in no particular
+	 *                 order)
+	 */
+	void QueryBox(const WVector3& min, const WVector3& max, std::vector<WObject*>& objects);
+
+private:
+	/**
+	 * Queues an object for an update of its entry in the spatial index.
+	 */
+	void _OnObjectMoved(WObject* object);
+
+	/**
+	 * Queues an update of the spatial index entries of all the objects using a
+	 * geometry whose bounding box changed.
+	 */
+	void _OnGeometryBoundsChanged(class WGeometry* geometry);
+
+	/**
+	 * Removes an object from the spatial index and the lists that track it.
+	 */
+	void _RemoveFromSpatialIndex(WObject* object);
+
+	/**
+	 * Adds an object to one of the lists that track it, storing its position
+	 * in the list in the given member of the object.
+	 * @param list    List to add to
+	 * @param index   Member of WObject holding the object's index in list
+	 * @param object  Object to add, ignored if it is already in the list
+	 */
+	void _AddToList(std::vector<WObject*>& list, uint32_t WObject::* index, WObject* object);
+
+	/**
+	 * Removes an object from one of the lists that track it in O(1), moving
+	 * the last object of the list into its place.
+	 * @param list    List to remove from
+	 * @param index   Member of WObject holding the object's index in list
+	 * @param object  Object to remove, ignored if it is not in the list
+	 */
+	void _RemoveFromList(std::vector<WObject*>& list, uint32_t WObject::* index, WObject* object);
+
+	/**
+	 * Applies the queued changes to the spatial index. Called before every
+	 * query, so the cost of moving an object is paid at most once per query.
+	 */
+	void _UpdateSpatialIndex();
 };
@@ -79,6 +79,8 @@ public:
 private:
 	/** Set to true while inside Update() */
 	bool m_isUpdating;
+	/** Set to true if the next Update() must sync the transform even if the body is not active */
+	bool m_syncPending;
 
 	/** Object bound to this rigid body */
 	WOrientation* m_boundObject;
@@ -0,0 +1,71 @@
+/** @file WFrustumCuller.hpp
+ *  @brief GPU frustum culling of indirect draws
+ *
+ *  The frustum culler tests the bounds of the objects drawn indirectly against
+ *  the planes of the view's frustum in a compute shader, which fills in the
+ *  draw commands with the objects in the view (see
+ *  WObjectsRenderFragment::SetFrustumCuller()).
+ *
+ *  @author Hasan Al-Jawaheri (hbj)
+ *  @bug No known bugs.
+ */
+
+#pragma once
+
+#include "Wasabi/Core/WCore.hpp"
+#include "Wasabi/Materials/WEffect.hpp"
+
+class WFrustumCullCS : public WShader {
+public:
+	WFrustumCullCS(class Wasabi* const app);
+	virtual void Load(bool bSaveData = false);
+	static W_SHADER_DESC GetDesc();
+};
+
+/**
+ * @ingroup engineclass
+ *
+ * A WFrustumCuller owns the compute effect that culls objects against the
+ * frustum of a view. The effect (see GetCullEffect()) is dispatched by its
+ * users with their own materials, so a culler can be shared by any number of
+ * render fragments.
+ */
+class WFrustumCuller {
+public:
+	WFrustumCuller(class Wasabi* const app);
+	~WFrustumCuller();
+
+	/**
+	 * Creates the cull effect.
+	 * @return Error code, see WError.h
+	 */
+	WError Create();
+
+	/**
+	 * Releases the cull effect.
+	 */
+	void Destroy();
+
+	/**
+	 * @return true if the cull effect is created, false otherwise
+	 */
+	bool Valid() const;
+
+	/**
+	 * Retrieves the effect that culls objects against the view's frustum. Its
+	 * material (binding set 0) has the storage buffers "cullData",
+	 * "drawCommands", "drawList" and "drawCounts", the view's
+	 * "frustumPlanes" (see WCamera::GetFrustumPlanes()) and the push
+	 * constant "numObjects" (see frustum-cull.comp.glsl for their layout).
+	 * Every object in the view is appended to the instances of its draw
+	 * command, and the command's draw count is set to 1.
+	 * @return The cull effect, nullptr if the culler is not created
+	 */
+	class WEffect* GetCullEffect() const;
+
+private:
+	/** Application that owns this culler */
+	class Wasabi* m_app;
+	/** Effect testing objects against the frustum */
+	class WEffect* m_cullFX;
+};
@@ -0,0 +1,151 @@
+/** @file WHiZCuller.hpp
+ *  @brief Hierarchical-Z occlusion culling
+ *
+ *  The Hi-Z culler reduces a render target's depth into a pyramid of
+ *  progressively smaller images that keep the farthest depth of the texels
+ *  they cover, so that the bounds of an object can be tested against the
+ *  depth drawn so far with a handful of texel fetches (see
+ *  WObjectsRenderFragment::SetOcclusionCuller()).
+ *
+ *  @author Hasan Al-Jawaheri (hbj)
+ *  @bug No known bugs.
+ */
+
+#pragma once
+
+#include "Wasabi/Core/WCore.hpp"
+#include "Wasabi/Materials/WEffect.hpp"
+
+/**
+ * Statistics of the occlusion culling of the objects of a render fragment in
+ * a frame, see WObjectsRenderFragment::GetOcclusionCullingStats()
+ */
+struct W_OCCLUSION_CULLING_STATS {
+	/** Number of objects (in the view) tested against the depth pyramid */
+	uint32_t numTested;
+	/** Number of objects that were found occluded and not drawn */
+	uint32_t numCulled;
+	/** Number of objects drawn before the depth pyramid was built (the ones visible in the previous frame) */
+	uint32_t numDrawnEarly;
+	/** Number of objects drawn after the depth pyramid was built (the ones that became visible) */
+	uint32_t numDrawnLate;
+};
+
+class WHiZDownsampleCS : public WShader {
+public:
+	WHiZDownsampleCS(class Wasabi* const app);
+	virtual void Load(bool bSaveData = false);
+	static W_SHADER_DESC GetDesc();
+};
+
+class WHiZCullCS : public WShader {
+public:
+	WHiZCullCS(class Wasabi* const app);
+	virtual void Load(bool bSaveData = false);
+	static W_SHADER_DESC GetDesc();
+};
+
+/**
+ * @ingroup engineclass
+ *
+ * A WHiZCuller owns the depth pyramid of a depth image and the compute
+ * effects that build it and test objects against it. Level 0 of the pyramid
+ * is half the size of the depth image (rounded up) and every level is half
+ * the size of the previous one, down to 1x1. Every texel holds the farthest
+ * depth of the 2x2 texels it covers in the previous level, so a box whose
+ * nearest depth is farther than the texels it covers is hidden behind what
+ * was drawn.
+ *
+ * The pyramid is built by BuildPyramid() from whatever was drawn to the depth
+ * image, so it only lives for the frame that builds it. The cull effect (see
+ * GetCullEffect()) is dispatched by the users of the pyramid with their own
+ * materials (see SetPyramidResources()).
+ */
+class WHiZCuller {
+public:
+	/** Maximum number of levels of the pyramid (enough for a 65536x65536 depth) */
+	static const uint32_t MAX_LEVELS = 16;
+
+	WHiZCuller(class Wasabi* const app);
+	~WHiZCuller();
+
+	/**
+	 * (Re)creates the pyramid for a depth image, which must be called again
+	 * when the depth image is resized. The effects are created the first time.
+	 * @param  depth  Depth image to build the pyramid of, it must be created
+	 *                with W_IMAGE_CREATE_TEXTURE
+	 * @return        Error code, see WError.h
+	 */
+	WError Create(class WImage* depth);
+
+	/**
+	 * Releases the pyramid and the effects.
+	 */
+	void Destroy();
+
+	/**
+	 * @return true if the pyramid is created, false otherwise
+	 */
+	bool Valid() const;
+
+	/**
+	 * Records the dispatches that build the pyramid from the depth image,
+	 * which must have been transitioned to
+	 * VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL (see WRenderTarget::End()).
+	 * The pyramid is ready for compute shaders once this returns.
+	 * @param  cmdBuffer  Command buffer to record to, outside of any render
+	 *                    pass
+	 * @return            Error code, see WError.h
+	 */
+	WError BuildPyramid(VkCommandBuffer cmdBuffer);
+
+	/**
+	 * Retrieves the effect that culls objects against the view's frustum and
+	 * the pyramid. Its material (binding set 0) has the storage buffers
+	 * "cullData", "visibility", "drawCommands", "drawList", "drawCounts" and
+	 * "stats", the view's "viewMatrix", "projectionMatrix" and
+	 * "frustumPlanes" and the push constants "phase", "numObjects" and
+	 * "numCommands" (see hiz-cull.comp.glsl for their layout). The pyramid is
+	 * set with SetPyramidResources().
+	 * @return The cull effect, nullptr if the culler is not created
+	 */
+	class WEffect* GetCullEffect() const;
+
+	/**
+	 * Sets the pyramid's levels (and its dimensions) to a material of the
+	 * cull effect. Must be called again after Create().
+	 * @param  material  Material of GetCullEffect()
+	 * @return           Error code, see WError.h
+	 */
+	WError SetPyramidResources(class WMaterial* material);
+
+	/**
+	 * @return Number of levels of the pyramid
+	 */
+	uint32_t GetNumLevels() const;
+
+private:
+	/** Application that owns this culler */
+	class Wasabi* m_app;
+	/** Depth image the pyramid is built from */
+	class WImage* m_depth;
+	/** Levels of the pyramid */
+	std::vector<class WImage*> m_levels;
+	/** Material of m_downsampleFX producing every level (from the previous level, or the depth for level 0) */
+	std::vector<class WMaterial*> m_downsampleMaterials;
+	/** Effect reducing an image into the next level */
+	class WEffect* m_downsampleFX;
+	/** Effect testing objects against the pyramid */
+	class WEffect* m_cullFX;
+
+	/**
+	 * Creates the effects.
+	 * @return Error code, see WError.h
+	 */
+	WError _CreateEffects();
+
+	/**
+	 * Releases the levels and their materials.
+	 */
+	void _DestroyPyramid();
+};
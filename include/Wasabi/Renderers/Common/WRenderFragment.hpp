@@ -7,6 +7,9 @@
 #include "Wasabi/Materials/WEffect.hpp"
 #include "Wasabi/Materials/WMaterialsStore.hpp"
 #include "Wasabi/Cameras/WCamera.hpp"
+#include "Wasabi/Renderers/Common/WHiZCuller.hpp"
+#include "Wasabi/Renderers/Common/WFrustumCuller.hpp"
+#include "Wasabi/Renderers/Common/WSoftwareOcclusionCuller.hpp"
 
 #include "Wasabi/Objects/WObject.hpp"
 #include "Wasabi/Terrains/WTerrain.hpp"
@@ -14,6 +17,9 @@
 #include "Wasabi/Particles/WParticles.hpp"
 
 #include <map>
+#include <unordered_map>
+#include <cstring>
+#include <algorithm>
 
 /*
  * A render fragment is a part of a render stage that renders
@@ -37,6 +43,7 @@ protected:
 			SortingKeyT key(entity);
 			m_allEntities.insert(std::make_pair(key, entity));
 		} else {
+			OnEntityRemoved(entity);
 			auto iter = m_allEntities.find(SortingKeyT(entity));
 			if (iter != m_allEntities.end())
 				m_allEntities.erase(iter);
@@ -57,6 +64,30 @@ protected:
 		return "Material-" + this->m_name + std::to_string(this->m_currentMatId++);
 	}
 
+	/**
+	 * Finds the material an entity should be rendered with: its material for
+	 * the fragment's effect, or else the first of its materials whose effect
+	 * has the required render flags.
+	 * @param  entity  Entity to render
+	 * @param  effect  Set to the effect of the returned material
+	 * @return         The material to use, nullptr if the entity has none
+	 */
+	class WMaterial* SelectMaterial(EntityT* entity, class WEffect** effect) {
+		*effect = m_renderEffect;
+		WMaterial* material = entity->GetMaterial(m_renderEffect);
+		if (!material) {
+			// see if a custom effect can be used
+			for (auto mat : entity->GetMaterials().m_materials) {
+				if (mat.first->GetEffect()->GetRenderFlags() & m_requiredRenderFlags) {
+					material = mat.first;
+					*effect = material->GetEffect();
+					break;
+				}
+			}
+		}
+		return material;
+	}
+
 public:
 	WRenderFragment(std::string fragmentName, WEffect* fx, class WManager<EntityT>* manager) {
 		m_requiredRenderFlags = EFFECT_RENDER_FLAG_NONE;
@@ -94,25 +125,38 @@ public:
 		return m_requiredRenderFlags;
 	}
 
-	virtual WError Render(class WRenderer* renderer, class WRenderTarget* rt) {
+	/**
+	 * Renders the fragment's entities, measuring the GPU time it takes as a
+	 * scope of the renderer's GPU profiler.
+	 * @param  renderer  Renderer rendering the frame
+	 * @param  rt        Render target being rendered to
+	 * @return           Error code, see WError.h
+	 */
+	WError Render(class WRenderer* renderer, class WRenderTarget* rt) {
+		WGPUProfiler* profiler = renderer->GetGPUProfiler();
+		uint32_t profilerScope = profiler->BeginScope(rt->GetCommnadBuffer(), m_name);
+		WError err = RenderEntities(renderer, rt);
+		// rt may have switched command buffers (see WRenderTarget::RecordInParallel())
+		profiler->EndScope(rt->GetCommnadBuffer(), profilerScope);
+		return err;
+	}
+
+protected:
+	/**
+	 * Renders the fragment's entities, called by Render().
+	 * @param  renderer  Renderer rendering the frame
+	 * @param  rt        Render target being rendered to
+	 * @return           Error code, see WError.h
+	 */
+	virtual WError RenderEntities(class WRenderer* renderer, class WRenderTarget* rt) {
 		UNREFERENCED_PARAMETER(renderer);
 
 		WEffect* boundFX = nullptr;
 		for (auto it = m_allEntities.begin(); it != m_allEntities.end(); it++) {
 			EntityT* entity = it->second;
 			if (ShouldRenderEntity(entity)) {
-				WEffect* effect = m_renderEffect;
-				WMaterial* material = entity->GetMaterial(effect);
-				if (!material) {
-					// see if a custom effect can be used
-					for (auto mat : entity->GetMaterials().m_materials) {
-						if (mat.first->GetEffect()->GetRenderFlags() & m_requiredRenderFlags) {
-							material = mat.first;
-							effect = material->GetEffect();
-							break;
-						}
-					}
-				}
+				WEffect* effect;
+				WMaterial* material = SelectMaterial(entity, &effect);
 				if (material && entity->WillRender(rt)) {
 					if (boundFX != effect) {
 						effect->Bind(rt);
@@ -134,6 +178,7 @@ public:
 		return WError(W_SUCCEEDED);
 	}
 
+public:
 	virtual void RenderEntity(EntityT* entity, class WRenderTarget* rt, class WMaterial* material) = 0;
 
 	virtual bool ShouldRenderEntity(EntityT*) { return true; };
@@ -151,6 +196,10 @@ public:
 			entity->GetMaterial(m_renderEffect)->SetName(GenerateMaterialName());
 		}
 	}
+
+	virtual void OnEntityRemoved(EntityT* entity) {
+		UNREFERENCED_PARAMETER(entity);
+	}
 };
 
 
@@ -171,16 +220,469 @@ struct WObjectSortingKey {
 };
 
 class WObjectsRenderFragment : public WRenderFragment<WObject, WObjectSortingKey> {
+	/** Minimum number of objects recorded by a thread, see WRenderTarget::RecordInParallel() */
+	static const uint32_t MIN_OBJECTS_PER_CHUNK = 64;
+	/** Maximum number of textures (of the texture array) that an indirect batch is keyed on */
+	static const uint32_t MAX_INDIRECT_TEXTURES = 8;
+	/** Number of frames an indirect batch is kept after it is last drawn */
+	static const uint32_t INDIRECT_BATCH_LIFETIME = 120;
+	/** Size of the work groups of the cull shaders (see WHiZCuller::GetCullEffect() and WFrustumCuller::GetCullEffect()) */
+	static const uint32_t CULL_GROUP_SIZE = 64;
+	/** CULL_DATA::flags bit of the objects drawn even when outside the frustum, see cull_utils.glsl */
+	static const uint32_t CULL_FLAG_NO_FRUSTUM_CULLING = 1;
+
+	/** Objects drawn together with a single indirect draw share a geometry and textures */
+	struct INDIRECT_BATCH_KEY {
+		class WGeometry* geometry;
+		class WImage* textures[MAX_INDIRECT_TEXTURES];
+
+		const bool operator< (const INDIRECT_BATCH_KEY& that) const {
+			if (geometry != that.geometry)
+				return (void*)geometry < (void*)that.geometry;
+			return memcmp(textures, that.textures, sizeof(textures)) < 0;
+		}
+	};
+	struct INDIRECT_BATCH {
+		/** Material of the indirect effect (binding set 0) holding the textures and the object data */
+		class WMaterial* material;
+		/** Handle of the "objectOffset" push constant of material */
+		WMaterialVariableHandle objectOffset;
+		/** Number of objects in the batch this frame */
+		uint32_t numObjects;
+		/** Index of the batch's first object in the object data this frame */
+		uint32_t firstObject;
+		/** Index of the batch's draw command this frame */
+		uint32_t command;
+		/** Number of frames since the batch last had objects */
+		uint32_t unusedFrames;
+	};
+	struct INDIRECT_OBJECT {
+		INDIRECT_BATCH* batch;
+		class WObject* object;
+		class WMaterial* material;
+	};
+	/** Element of the cull data, laid out like CullData in cull_utils.glsl */
+	struct CULL_DATA {
+		float boundsMin[4];
+		float boundsMax[4];
+		uint32_t command;
+		uint32_t firstObject;
+		uint32_t slot;
+		uint32_t flags;
+	};
+
+	class Wasabi* m_app;
 	bool m_animated;
 	bool m_addDefaultEffects;
+	/** Scratch lists reused across frames by Render() */
+	std::vector<WObject*> m_visibleObjects;
+	std::vector<std::pair<WObjectSortingKey, class WMaterial*>> m_visibleEntities;
+
+	/** Effect used for indirect draws, nullptr if they are disabled */
+	class WEffect* m_indirectEffect;
+	/** Binding index (in set 0 of the fragment's effect) of the UBO copied into the object data */
+	uint32_t m_objectUBOBinding;
+	/** Binding index of the texture (array) that batches are keyed on */
+	uint32_t m_texturesBinding;
+	/** Size of an element of the object data, 0 until the first object is drawn indirectly */
+	size_t m_objectDataStride;
+	/** Offset of the "worldMatrix" variable in an element of the object data, valid once m_objectDataStride is set */
+	size_t m_worldMatrixOffset;
+	/** Per-object data of the objects drawn indirectly, one buffer per buffered frame */
+	WBufferedBuffer m_objectData;
+	/** Number of objects that fit in m_objectData */
+	uint32_t m_objectDataCapacity;
+	/** All batches, including recently unused ones (so their materials are not re-created) */
+	std::map<INDIRECT_BATCH_KEY, INDIRECT_BATCH> m_indirectBatches;
+	/** Scratch list of the objects drawn indirectly this frame */
+	std::vector<INDIRECT_OBJECT> m_indirectObjects;
+	/** Number of objects drawn indirectly this frame */
+	uint32_t m_numIndirectObjects;
+	/** Number of draw commands (of a phase) this frame */
+	uint32_t m_numIndirectCommands;
+	/** Index (in m_objectData) of the object drawn by every instance of the draw commands, one buffer per buffered frame */
+	WBufferedBuffer m_drawList;
+	/** Number of indices that fit in m_drawList */
+	uint32_t m_drawListCapacity;
+	/** Draw commands, one buffer per buffered frame */
+	WBufferedBuffer m_indirectCommands;
+	/** Number of commands that fit in m_indirectCommands */
+	uint32_t m_indirectCommandsCapacity;
+	/** Number of draws of every draw command (0 or 1), written by the cull shaders, one buffer per buffered frame */
+	WBufferedBuffer m_drawCounts;
+	/** Number of counts that fit in m_drawCounts */
+	uint32_t m_drawCountsCapacity;
+	/** true if this frame's draws were prepared by RecordCulling() */
+	bool m_framePrepared;
+
+	/** Culler that the indirect draws are frustum culled with on the GPU, nullptr if they are not */
+	class WFrustumCuller* m_frustumCuller;
+	/** Material of the frustum culler's cull effect, set to this fragment's buffers */
+	class WMaterial* m_frustumCullMaterial;
+	/** true if this frame's indirect draws are frustum culled by m_frustumCuller */
+	bool m_frustumCulling;
+
+	/** Culler that the indirect draws are occlusion culled with, nullptr if they are not */
+	class WHiZCuller* m_occlusionCuller;
+	/** Material of the culler's cull effect, set to this fragment's buffers */
+	class WMaterial* m_cullMaterial;
+	/** true if this frame's indirect draws are occlusion culled */
+	bool m_occlusionCulling;
+	/** Bounds of the objects drawn indirectly, one buffer per buffered frame */
+	WBufferedBuffer m_cullData;
+	/** Number of objects that fit in m_cullData */
+	uint32_t m_cullDataCapacity;
+	/** Visibility of every slot as of the last culling, carried over from frame to frame by the GPU */
+	WBufferedBuffer m_visibility;
+	/** Number of slots that fit in m_visibility */
+	uint32_t m_visibilityCapacity;
+	/** Slot in m_visibility of every object that was occlusion culled */
+	std::unordered_map<WObject*, uint32_t> m_visibilitySlots;
+	/** Slots released by removed objects */
+	std::vector<uint32_t> m_freeVisibilitySlots;
+	/** Number of slots handed out so far */
+	uint32_t m_numVisibilitySlots;
+	/** W_OCCLUSION_CULLING_STATS counted by the GPU, one buffer per buffered frame */
+	WBufferedBuffer m_cullingStats;
+	/** true for the buffering indices whose m_cullingStats have yet to be read */
+	std::vector<bool> m_cullingStatsPending;
+	/** Statistics of the last frame read back */
+	W_OCCLUSION_CULLING_STATS m_lastCullingStats;
+
+	/** Culler testing the visible objects against their occluders on the CPU */
+	WSoftwareOcclusionCuller m_softwareCuller;
+	/** Number of objects the software culler found occluded this frame */
+	uint32_t m_numSoftwareOccluded;
+
+	/**
+	 * Finds the visible objects, splits them between indirect and direct
+	 * draws and prepares the indirect draws. With GPU frustum culling, every
+	 * object that can be drawn indirectly is a candidate, and only the direct
+	 * draws are frustum culled on the CPU.
+	 * @param  rt          Render target being rendered to
+	 * @param  gpuCulling  Whether to cull the indirect draws on the GPU (with
+	 *                     the cullers that are set and enabled)
+	 * @return             Error code, see WError.h
+	 */
+	WError _PrepareFrame(class WRenderTarget* rt, bool gpuCulling);
+
+	/**
+	 * Rasterizes the occluders of this frame's visible objects into the
+	 * software culler.
+	 * @param  cam  Camera of the view
+	 * @return      true if there are occluders to test the objects against
+	 */
+	bool _RasterizeOccluders(WCamera* cam);
+
+	/**
+	 * Adds an object to this frame's indirect draws if it can be drawn
+	 * indirectly.
+	 * @return true if the object was added, false if it must be drawn directly
+	 */
+	bool _AddIndirectObject(WObject* object, class WMaterial* material);
+
+	/**
+	 * Makes sure that a buffer (one per buffered frame) can hold a number of
+	 * elements, re-creating it with room to grow if it can't. The materials
+	 * pick up the new buffers when they are updated.
+	 * @return Vulkan result of the operation
+	 */
+	VkResult _ReserveBuffer(WBufferedBuffer* buffer, uint32_t* capacity, uint32_t count, size_t elementSize,
+							uint32_t numBuffers, VkBufferUsageFlags usage, W_MEMORY_STORAGE memory);
+
+	/**
+	 * Writes the object data, draw list and draw commands of this frame's
+	 * indirect draws and updates the batches' materials. With GPU culling,
+	 * the commands (of both phases with occlusion culling) are written with
+	 * no instances and no draw counts, and the draw list is left to the cull
+	 * shader, which fills them from the cull data.
+	 * @param  frustumCulling    Whether to frustum cull the draws on the GPU
+	 * @param  occlusionCulling  Whether to occlusion cull the draws
+	 * @return                   Error code, see WError.h
+	 */
+	WError _PrepareIndirectDraws(bool frustumCulling, bool occlusionCulling);
+
+	/**
+	 * Records the draws of a phase of this frame's indirect draws to rt.
+	 * @param rt     Render target to record to
+	 * @param phase  0 for the draws made before the depth pyramid is built
+	 *               (all the draws without occlusion culling), 1 for the ones
+	 *               made after
+	 */
+	void _RecordIndirectDraws(class WRenderTarget* rt, uint32_t phase);
+
+	/**
+	 * Records a dispatch of the occlusion cull shader.
+	 * @param  cmdBuffer  Command buffer to record to, outside of any render
+	 *                    pass
+	 * @param  phase      Phase of the draws that the dispatch fills
+	 * @return            Error code, see WError.h
+	 */
+	WError _RecordOcclusionCulling(VkCommandBuffer cmdBuffer, uint32_t phase);
+
+	/**
+	 * Records a dispatch of the frustum cull shader.
+	 * @param  cmdBuffer  Command buffer to record to, outside of any render
+	 *                    pass
+	 * @param  cam        Camera of the view
+	 * @return            Error code, see WError.h
+	 */
+	WError _RecordFrustumCulling(VkCommandBuffer cmdBuffer, WCamera* cam);
+
+	/**
+	 * Interrupts rt's render pass to build the depth pyramid and cull the
+	 * objects against it, then records the draws of the objects that became
+	 * visible.
+	 * @return Error code, see WError.h
+	 */
+	WError _RecordLateIndirectDraws(class WRenderer* renderer, class WRenderTarget* rt);
+
+	/**
+	 * @return The slot of an object in m_visibility, handing out a new one
+	 *         if the object has none
+	 */
+	uint32_t _GetVisibilitySlot(WObject* object);
+
+	/**
+	 * Reads the culling statistics of the frame that last used a buffering
+	 * index, if it culled any objects.
+	 */
+	void _ReadCullingStats(uint32_t bufferIndex);
+
+	/**
+	 * Releases the indirect draws' resources.
+	 */
+	void _DestroyIndirectResources();
+
+	/**
+	 * Releases the occlusion culling's resources.
+	 */
+	void _DestroyOcclusionCullingResources();
+
+	/**
+	 * Releases the GPU frustum culling's resources.
+	 */
+	void _DestroyFrustumCullingResources();
 
 public:
 	WObjectsRenderFragment(std::string fragmentName, bool animated, WEffect* fx, class Wasabi* wasabi, W_EFFECT_RENDER_FLAGS renderFlags, bool addDefaultEffects = true)
-		: WRenderFragment(fragmentName, fx, wasabi->ObjectManager) {
+		: WRenderFragment(fragmentName, fx, wasabi->ObjectManager), m_softwareCuller(wasabi->JobSystem) {
+		m_app = wasabi;
 		m_animated = animated;
 		m_addDefaultEffects = addDefaultEffects;
 		m_requiredRenderFlags = renderFlags;
 		fx->SetRenderFlags(m_requiredRenderFlags);
+		m_indirectEffect = nullptr;
+		m_objectUBOBinding = 0;
+		m_texturesBinding = 0;
+		m_objectDataStride = 0;
+		m_worldMatrixOffset = 0;
+		m_objectDataCapacity = 0;
+		m_numIndirectObjects = 0;
+		m_numIndirectCommands = 0;
+		m_drawListCapacity = 0;
+		m_indirectCommandsCapacity = 0;
+		m_drawCountsCapacity = 0;
+		m_framePrepared = false;
+		m_frustumCuller = nullptr;
+		m_frustumCullMaterial = nullptr;
+		m_frustumCulling = false;
+		m_occlusionCuller = nullptr;
+		m_cullMaterial = nullptr;
+		m_occlusionCulling = false;
+		m_cullDataCapacity = 0;
+		m_visibilityCapacity = 0;
+		m_numVisibilitySlots = 0;
+		m_lastCullingStats = {};
+		m_numSoftwareOccluded = 0;
+	}
+	virtual ~WObjectsRenderFragment() {
+		_DestroyFrustumCullingResources();
+		_DestroyOcclusionCullingResources();
+		_DestroyIndirectResources();
+	}
+
+	/**
+	 * Enables drawing objects with indirect draws (when the "indirectDrawing"
+	 * engine parameter is set). Objects rendered with the fragment's effect
+	 * that are not instanced and have an indexed geometry are then grouped
+	 * in batches of objects that have the same geometry and textures, and
+	 * every batch is drawn with a single vkCmdDrawIndexedIndirect, instead of
+	 * binding a material and drawing every object (see
+	 * SetFrustumCuller() to cull the batches on the GPU). The per-object data is
+	 * gathered in a storage buffer: the UBO of every object's material is
+	 * copied into it, with the object's world matrix written over the UBO's
+	 * "worldMatrix" variable (objects whose UBO has none are drawn directly).
+	 * fx must be built for the fragment's render target and have, in binding
+	 * set 0:
+	 * - A storage buffer named "objectData", whose elements are laid out
+	 *   like the objects' UBO.
+	 * - A texture (array) at texturesBinding (if the objects have one).
+	 * - A storage buffer named "drawList" of uint indices into
+	 *   "objectData".
+	 * - A push constant named "objectOffset" (uint) holding the index of the
+	 *   batch's first object in "drawList", such that the data of an
+	 *   instance is at drawList[objectOffset + gl_InstanceIndex].
+	 * The other binding sets of fx are per-frame materials (see
+	 * WEffect::CreateMaterial()) that the owner of the fragment updates.
+	 * @param fx                Effect to draw with, nullptr to disable
+	 *                          indirect draws
+	 * @param objectUBOBinding  Binding index of the objects' UBO (in set 0 of
+	 *                          the fragment's effect)
+	 * @param texturesBinding   Binding index of the objects' texture (array)
+	 *                          that is copied to the batches' materials
+	 */
+	void SetIndirectEffect(class WEffect* fx, uint32_t objectUBOBinding, uint32_t texturesBinding);
+
+	/**
+	 * @return The effect used for indirect draws, see SetIndirectEffect()
+	 */
+	class WEffect* GetIndirectEffect() const {
+		return m_indirectEffect;
+	}
+
+	/**
+	 * Enables frustum culling of the objects drawn indirectly on the GPU
+	 * (when the "gpuFrustumCulling" engine parameter is set). Every object
+	 * that can be drawn indirectly is then written to a storage buffer with
+	 * its world-space bounds, and before the render pass RecordCulling()
+	 * dispatches culler's compute shader, which tests the bounds against the
+	 * planes of the view's frustum and appends the objects in the view to the
+	 * instances and the draw list of their batches. The batches are drawn
+	 * with vkCmdDrawIndexedIndirectCountKHR when the device supports it (see
+	 * Wasabi::GetVulkanDrawIndexedIndirectCount()), skipping the batches left
+	 * empty, or else with vkCmdDrawIndexedIndirect, whose empty batches draw
+	 * no instances. The objects drawn directly are still frustum culled on
+	 * the CPU. With occlusion culling (see SetOcclusionCuller()), the
+	 * occlusion cull shader does the frustum test instead.
+	 * @param  culler  Culler to use, or nullptr to frustum cull on the CPU.
+	 *                 The culler must outlive the fragment (or be unset)
+	 * @return         Error code, see WError.h
+	 */
+	WError SetFrustumCuller(class WFrustumCuller* culler);
+
+	/**
+	 * Enables occlusion culling of the objects drawn indirectly (when the
+	 * "occlusionCulling" engine parameter is set) against the depth pyramid
+	 * of the fragment's render target. The culling is done in two phases
+	 * to avoid popping, without waiting for results on the CPU:
+	 * 1. Before the render pass, RecordCulling() fills the draw
+	 *    commands with the objects that were visible in the previous frame.
+	 * 2. Those objects are drawn along with the objects drawn directly, the
+	 *    render pass is ended (see WRenderTarget::End()), culler builds the
+	 *    depth pyramid from what was drawn and all the objects are tested
+	 *    against it. The render pass is resumed (see
+	 *    WRenderTarget::Begin()) to draw the objects that became visible,
+	 *    and the results are kept on the GPU for the next frame.
+	 * Objects are only tested after they pass the frustum test (done by the
+	 * cull shader, see SetFrustumCuller()), so culling statistics (see
+	 * GetOcclusionCullingStats()) only count the objects in the view.
+	 * @param  culler  Culler to use, whose pyramid is built from the depth of
+	 *                 the fragment's render target, or nullptr to disable
+	 *                 occlusion culling. The culler must outlive the fragment
+	 *                 (or be unset)
+	 * @return         Error code, see WError.h
+	 */
+	WError SetOcclusionCuller(class WHiZCuller* culler);
+
+	/**
+	 * Prepares this frame's draws and records their culling on the GPU: the
+	 * frustum culling (see SetFrustumCuller()), or the first occlusion
+	 * culling phase (see SetOcclusionCuller()). The owner of the fragment
+	 * must call this before rt's render pass begins (see
+	 * WRenderStage::RecordCompute()) for the fragment's draws to be culled on
+	 * the GPU this frame, the following Render() then records the second
+	 * occlusion culling phase. rt must not have its own command buffer.
+	 * @param  rt         Render target that Render() will render to
+	 * @param  cmdBuffer  Command buffer of the frame, outside of any render
+	 *                    pass
+	 * @return            Error code, see WError.h
+	 */
+	WError RecordCulling(class WRenderTarget* rt, VkCommandBuffer cmdBuffer);
+
+	/**
+	 * Retrieves the occlusion culling statistics of the latest frame whose
+	 * results were read back, which lags behind the frame being recorded by
+	 * the number of buffered frames (see the "bufferingCount" engine
+	 * parameter).
+	 * @return Occlusion culling statistics
+	 */
+	W_OCCLUSION_CULLING_STATS GetOcclusionCullingStats() const {
+		return m_lastCullingStats;
+	}
+
+	/**
+	 * Retrieves the culler used for software occlusion culling. When the
+	 * "softwareOcclusionCulling" engine parameter is set, the occluders (see
+	 * WObject::SetOccluderGeometry()) of the objects in the view are
+	 * rasterized on the CPU every frame, and the objects whose bounding boxes
+	 * are hidden behind them are skipped before any of their draws are
+	 * recorded. Its resolution can be changed with
+	 * WSoftwareOcclusionCuller::SetResolution().
+	 * @return The software occlusion culler
+	 */
+	WSoftwareOcclusionCuller* GetSoftwareOcclusionCuller() {
+		return &m_softwareCuller;
+	}
+
+	/**
+	 * @return Number of objects skipped by software occlusion culling in the
+	 *         last frame, see GetSoftwareOcclusionCuller()
+	 */
+	uint32_t GetNumSoftwareOccluded() const {
+		return m_numSoftwareOccluded;
+	}
+
+	/**
+	 * Renders the objects in the view of rt's camera. Instead of checking
+	 * every object, the visible ones are found using the object manager's
+	 * spatial index (see WObjectManager::QueryFrustum()), keeping only the
+	 * ones registered with this fragment that will render (see
+	 * WObject::WillRender()), then sorted by effect so every effect is bound
+	 * once. Objects that can be drawn
+	 * indirectly (see SetIndirectEffect()) are drawn first, with one draw per
+	 * batch, and are frustum culled on the GPU instead if RecordCulling() did
+	 * so (see SetFrustumCuller()). For the rest, the materials are filled in on this thread (see
+	 * WObject::PrepareRender()), then the draws are recorded in parallel
+	 * (see WRenderTarget::RecordInParallel()), every thread binding the
+	 * effects of its own chunk of objects. With occlusion culling (see
+	 * SetOcclusionCuller()), the objects that became visible are drawn last.
+	 */
+	virtual WError RenderEntities(class WRenderer* renderer, class WRenderTarget* rt) override {
+		if (!m_framePrepared) {
+			WError err = _PrepareFrame(rt, false);
+			if (!err)
+				return err;
+		}
+		m_framePrepared = false;
+
+		if (m_indirectEffect)
+			_RecordIndirectDraws(rt, 0);
+
+		WEffect* preparedFX = nullptr;
+		for (auto& entity : m_visibleEntities) {
+			if (preparedFX != entity.first.fx) {
+				entity.first.fx->UpdatePerFrameMaterials();
+				preparedFX = entity.first.fx;
+			}
+			entity.first.obj->PrepareRender(entity.second);
+		}
+
+		WError err = rt->RecordInParallel((uint32_t)m_visibleEntities.size(), MIN_OBJECTS_PER_CHUNK, [this, rt](uint32_t begin, uint32_t end) {
+			WEffect* boundFX = nullptr;
+			for (uint32_t i = begin; i < end; i++) {
+				auto& entity = m_visibleEntities[i];
+				if (boundFX != entity.first.fx) {
+					entity.first.fx->Bind(rt);
+					boundFX = entity.first.fx;
+				}
+				entity.first.obj->RecordRender(rt, entity.second);
+			}
+		});
+		if (!err || !m_occlusionCulling)
+			return err;
+
+		return _RecordLateIndirectDraws(renderer, rt);
 	}
 
 	virtual void RenderEntity(WObject* object, class WRenderTarget* rt, class WMaterial* material) override {
@@ -200,6 +702,14 @@ public:
 		if (m_addDefaultEffects)
 			WRenderFragment<WObject, WObjectSortingKey>::OnEntityAdded(object);
 	}
+
+	virtual void OnEntityRemoved(WObject* object) override {
+		auto it = m_visibilitySlots.find(object);
+		if (it != m_visibilitySlots.end()) {
+			m_freeVisibilitySlots.push_back(it->second);
+			m_visibilitySlots.erase(it);
+		}
+	}
 };
 
 struct WTerrainSortingKey {
@@ -320,11 +830,11 @@ public:
 		m_particleEffects.clear();
 	}
 
-	virtual WError Render(class WRenderer* renderer, class WRenderTarget* rt) override {
+	virtual WError RenderEntities(class WRenderer* renderer, class WRenderTarget* rt) override {
 		WError err = WError(W_SUCCEEDED);
 		for (auto renderEffect : m_particleEffects) {
 			m_renderEffect = renderEffect.second;
-			err = WRenderFragment::Render(renderer, rt);
+			err = WRenderFragment::RenderEntities(renderer, rt);
 			if (!err)
 				break;
 		}
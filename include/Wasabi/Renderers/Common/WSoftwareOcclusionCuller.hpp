@@ -0,0 +1,194 @@
+/** @file WSoftwareOcclusionCuller.hpp
+ *  @brief Occlusion culling against a depth buffer rasterized on the CPU
+ *
+ *  The software occlusion culler rasterizes a few low-poly occluders into a
+ *  small depth buffer on the CPU and tests bounding boxes against it, so that
+ *  occluded objects can be skipped before their draws are recorded, without
+ *  waiting on the GPU (see WObjectsRenderFragment and
+ *  WObject::SetOccluderGeometry()). It doesn't use the GPU at all.
+ *
+ *  @author Hasan Al-Jawaheri (hbj)
+ *  @bug No known bugs.
+ */
+
+#pragma once
+
+#include "Wasabi/Core/WMath.hpp"
+#include "Wasabi/Core/WError.hpp"
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * @ingroup engineclass
+ *
+ * A WSoftwareOcclusionCuller keeps a low-resolution depth buffer in the style
+ * of masked occlusion culling: the buffer is split into tiles of
+ * TILE_WIDTH x TILE_HEIGHT pixels, and instead of a depth per pixel every
+ * tile keeps two conservative depths (the farthest depth of the tile, and the
+ * farthest depth of the pixels covered by a coverage mask) that triangles are
+ * merged into. Depths are post-projection z/w in [0, 1] (0 being the near
+ * plane) and are always at least as far as what was actually rasterized, so a
+ * box is only reported occluded if it really is.
+ *
+ * A frame goes as follows:
+ * 1. BeginFrame() with the view-projection matrix of the view.
+ * 2. AddOccluder() for every occluder, which transforms its vertices.
+ * 3. Rasterize(), which rasterizes the occluders' triangles, splitting the
+ *    rows of tiles between the threads of the job system. Every tile is
+ *    rasterized by a single thread in the order the occluders were added, so
+ *    the result doesn't depend on the number of threads.
+ * 4. IsBoxOccluded() for the boxes to test, from any number of threads.
+ * Both faces of the triangles are rasterized, so occluders don't need a
+ * particular winding order.
+ */
+class WSoftwareOcclusionCuller {
+public:
+	/** Width of a tile in pixels (the bits of a coverage mask row) */
+	static const uint32_t TILE_WIDTH = 32;
+	/** Height of a tile in pixels */
+	static const uint32_t TILE_HEIGHT = 8;
+	/** Default width of the depth buffer */
+	static const uint32_t DEFAULT_WIDTH = 256;
+	/** Default height of the depth buffer */
+	static const uint32_t DEFAULT_HEIGHT = 128;
+
+	/**
+	 * @param jobSystem  Job system to rasterize with, or nullptr to rasterize
+	 *                   on the calling thread
+	 */
+	WSoftwareOcclusionCuller(class WJobSystem* jobSystem = nullptr);
+	~WSoftwareOcclusionCuller();
+
+	/**
+	 * Sets the resolution of the depth buffer, which is rounded up to whole
+	 * tiles. This clears the buffer.
+	 * @param width   Width of the buffer in pixels
+	 * @param height  Height of the buffer in pixels
+	 */
+	void SetResolution(uint32_t width, uint32_t height);
+
+	/**
+	 * @return Width of the depth buffer in pixels
+	 */
+	uint32_t GetWidth() const;
+
+	/**
+	 * @return Height of the depth buffer in pixels
+	 */
+	uint32_t GetHeight() const;
+
+	/**
+	 * Clears the occluders and the depth buffer to start a new frame.
+	 * @param viewProjection  View-projection matrix of the view, projecting
+	 *                        to z in [0, w] (see WCamera::GetProjectionMatrix())
+	 */
+	void BeginFrame(const WMatrix& viewProjection);
+
+	/**
+	 * Adds an occluder to be rasterized by the next Rasterize().
+	 * @param positions     Positions of the occluder's vertices, read from
+	 *                      positions + i * stride bytes for vertex i
+	 * @param stride        Size of a vertex in bytes
+	 * @param numVertices   Number of vertices
+	 * @param indices       Indices of the occluder's triangles
+	 * @param numIndices    Number of indices (3 per triangle)
+	 * @param worldMatrix   World matrix of the occluder
+	 */
+	void AddOccluder(const WVector3* positions, size_t stride, uint32_t numVertices,
+					 const uint32_t* indices, uint32_t numIndices, const WMatrix& worldMatrix);
+
+	/**
+	 * Adds an occluder with the triangles of a geometry. The geometry's
+	 * vertex and index buffers must be readable by the CPU (see
+	 * W_GEOMETRY_CREATE_CPU_READABLE).
+	 * @param  geometry     Geometry of the occluder
+	 * @param  worldMatrix  World matrix of the occluder
+	 * @return              Error code, see WError.h
+	 */
+	WError AddOccluder(class WGeometry* geometry, const WMatrix& worldMatrix);
+
+	/**
+	 * Rasterizes the triangles of the occluders added since BeginFrame().
+	 */
+	void Rasterize();
+
+	/**
+	 * Tests whether a world-space axis-aligned box is hidden behind the
+	 * rasterized occluders. Boxes that cross the near plane or lie outside
+	 * the buffer are never occluded. This may be called from multiple
+	 * threads.
+	 * @param  min  Minimum point of the box
+	 * @param  max  Maximum point of the box
+	 * @return      true if the box is occluded, false otherwise
+	 */
+	bool IsBoxOccluded(const WVector3& min, const WVector3& max) const;
+
+	/**
+	 * Retrieves the depth of a pixel of the buffer, which is at least as far
+	 * as the occluders rasterized at that pixel.
+	 * @param  x  Column of the pixel
+	 * @param  y  Row of the pixel
+	 * @return    Depth of the pixel, 1 if nothing was rasterized there
+	 */
+	float GetDepth(uint32_t x, uint32_t y) const;
+
+	/**
+	 * @return Number of occluder triangles added since BeginFrame()
+	 */
+	uint32_t GetNumOccluderTriangles() const;
+
+private:
+	/** Depth and coverage of a tile */
+	struct TILE {
+		/** Coverage mask of every row of the tile, bit i is column i */
+		uint32_t mask[TILE_HEIGHT];
+		/** Farthest depth of the whole tile */
+		float zMax0;
+		/** Farthest depth of the pixels in mask */
+		float zMax1;
+	};
+	/** A triangle set up for rasterization, in pixel coordinates */
+	struct TRIANGLE {
+		/** x of the left edges of the triangle at y is max(lowK[i] * y + lowM[i]) */
+		float lowK[3], lowM[3];
+		/** x of the right edges of the triangle at y is min(highK[i] * y + highM[i]) */
+		float highK[3], highM[3];
+		/** Depth of the triangle's plane at (x, y) is zA * x + zB * y + zC */
+		float zA, zB, zC;
+		/** Farthest depth of the triangle's vertices */
+		float zMax;
+		/** Bounds of the triangle */
+		float minX, minY, maxX, maxY;
+		/** false if the triangle was clipped away */
+		bool valid;
+	};
+
+	/** Job system to rasterize with */
+	class WJobSystem* m_jobSystem;
+	/** Size of the buffer in pixels */
+	uint32_t m_width, m_height;
+	/** Size of the buffer in tiles */
+	uint32_t m_tilesX, m_tilesY;
+	/** Tiles of the buffer, row by row */
+	std::vector<TILE> m_tiles;
+	/** View-projection matrix of the frame */
+	WMatrix m_viewProjection;
+	/** Clip-space vertices of the occluders */
+	std::vector<WVector4> m_vertices;
+	/** Indices (into m_vertices) of the occluders' triangles */
+	std::vector<uint32_t> m_indices;
+	/** Set up triangles, two per occluder triangle (for the near plane clipping) */
+	std::vector<TRIANGLE> m_triangles;
+
+	/** Clears the tiles */
+	void _Clear();
+	/** Clips triangle i of m_indices against the near plane and sets it up into m_triangles[2i] and m_triangles[2i + 1] */
+	void _SetupTriangle(uint32_t triangle);
+	/** Sets up a triangle from the screen-space (x, y, depth) of its vertices */
+	void _SetupScreenTriangle(const WVector3& v0, const WVector3& v1, const WVector3& v2, TRIANGLE* out) const;
+	/** Rasterizes the triangles into a row of tiles */
+	void _RasterizeTileRow(uint32_t tileRow);
+	/** Merges a triangle's coverage and farthest depth into a tile */
+	static void _MergeIntoTile(TILE& tile, const uint32_t* coverage, float zTri);
+};
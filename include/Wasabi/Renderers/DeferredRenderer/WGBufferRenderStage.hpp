@@ -2,6 +2,8 @@
 
 #include "Wasabi/Renderers/WRenderStage.hpp"
 #include "Wasabi/Renderers/Common/WRenderFragment.hpp"
+#include "Wasabi/Renderers/Common/WHiZCuller.hpp"
+#include "Wasabi/Renderers/Common/WFrustumCuller.hpp"
 #include "Wasabi/Materials/WEffect.hpp"
 
 class WGBufferVS : public WShader {
@@ -25,6 +27,20 @@ public:
 	static W_SHADER_DESC GetDesc();
 };
 
+class WGBufferIndirectVS : public WShader {
+public:
+	WGBufferIndirectVS(class Wasabi* const app);
+	virtual void Load(bool bSaveData = false);
+	static W_SHADER_DESC GetDesc();
+};
+
+class WGBufferIndirectPS : public WShader {
+public:
+	WGBufferIndirectPS(class Wasabi* const app);
+	virtual void Load(bool bSaveData = false);
+	static W_SHADER_DESC GetDesc();
+};
+
 /**
  * GBuffer layout:
  * Depth attachment: D16 - depth
@@ -32,6 +48,12 @@ public:
  * Color attachment 1: R16G16B16A16 - rg is packed normals, b is specular power, a is specular intensity
  * Code for packing and unpacking of normals can be found in `src/Wasabi/Renderers/Common/Shaders/utils.glsl`
  * (WasabiPackNormalSpheremapTransform and WasabiUnpackNormalSpheremapTransform)
+ *
+ * Static objects drawn in batches are frustum culled on the GPU (see
+ * WObjectsRenderFragment::SetFrustumCuller()) when the "gpuFrustumCulling"
+ * engine parameter is set, and occlusion culled against the depth (see
+ * WObjectsRenderFragment::SetOcclusionCuller()) when the "occlusionCulling"
+ * engine parameter is set.
  */
 class WGBufferRenderStage : public WRenderStage {
 	WObjectsRenderFragment* m_objectsFragment;
@@ -39,6 +61,9 @@ class WGBufferRenderStage : public WRenderStage {
 
 	WObjectsRenderFragment* m_animatedObjectsFragment;
 	class WMaterial* m_perFrameAnimatedMaterial;
+	class WMaterial* m_perFrameIndirectMaterial;
+	WHiZCuller* m_occlusionCuller;
+	WFrustumCuller* m_frustumCuller;
 
 	WGBufferVS* m_defaultVS;
 	WGBufferAnimatedVS* m_defaultAnimatedVS;
@@ -51,6 +76,7 @@ public:
 
 	virtual WError Initialize(std::vector<WRenderStage*>& previousStages, uint32_t width, uint32_t height);
 	virtual WError Render(class WRenderer* renderer, class WRenderTarget* rt, uint32_t filter);
+	virtual WError RecordCompute(class WRenderer* renderer, VkCommandBuffer cmdBuffer);
 	virtual void Cleanup();
 	virtual WError Resize(uint32_t width, uint32_t height);
 
@@ -59,4 +85,10 @@ public:
 	WGBufferPS* GetDefaultPixelShader() const;
 	WEffect* GetDefaultEffect() const;
 	WEffect* GetDefaultAnimatedEffect() const;
+
+	/**
+	 * @return Occlusion culling statistics of the static objects, see
+	 *         WObjectsRenderFragment::GetOcclusionCullingStats()
+	 */
+	W_OCCLUSION_CULLING_STATS GetOcclusionCullingStats() const;
 };
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Wasabi/Renderers/WRenderStage.hpp"
+#include "Wasabi/Materials/WMaterial.hpp"
+#include "Wasabi/Cameras/WCamera.hpp"
 
 class WShader;
 
@@ -24,6 +26,10 @@ class WLightBufferRenderStage : public WRenderStage {
 		class WMaterial* perFrameMaterial;
 		/** Render materials for all lights of this type */
 		unordered_map<class WLight*, class WMaterial*> materialMap;
+		/** Handles of the per-light variables, shared by all materials in materialMap */
+		WMaterialVariableHandle wvp, lightDir, position, lightColor, intensity, range, minCosAngle, spotRadius;
+		/** Handle of the projInv variable of perFrameMaterial */
+		WMaterialVariableHandle projInv;
 
 		LightTypeAssets() : geometry(nullptr), effect(nullptr), fullscreenSprite(nullptr), perFrameMaterial(nullptr) {}
 
@@ -32,6 +38,12 @@ class WLightBufferRenderStage : public WRenderStage {
 	};
 	/** Map of light type -> LightTypeAssets to render that light */
 	std::unordered_map<int, LightTypeAssets> m_lightRenderingAssets;
+	/** Scratch: unhidden lights of the type being rendered (and their materials), culled in one batch */
+	std::vector<std::pair<class WLight*, class WMaterial*>> m_candidateLights;
+	/** Scratch: bounding spheres of m_candidateLights */
+	W_BOUNDING_SPHERES m_candidateLightSpheres;
+	/** Scratch: visibility bitmask of m_candidateLights */
+	std::vector<uint32_t> m_candidateLightVisibility;
 
 	/** Initializes point lights assets */
 	WError LoadPointLightsAssets();
@@ -2,6 +2,7 @@
 
 #include "Wasabi/Renderers/WRenderStage.hpp"
 #include "Wasabi/Renderers/Common/WRenderFragment.hpp"
+#include "Wasabi/Renderers/Common/WFrustumCuller.hpp"
 #include "Wasabi/Materials/WEffect.hpp"
 #include "Wasabi/Materials/WMaterial.hpp"
 #include "Wasabi/Objects/WObject.hpp"
@@ -35,6 +36,20 @@ public:
 	static W_SHADER_DESC GetDesc(int maxLights);
 };
 
+class WForwardRenderStageIndirectObjectVS : public WShader {
+public:
+	WForwardRenderStageIndirectObjectVS(class Wasabi* const app);
+	virtual void Load(bool bSaveData = false);
+	static W_SHADER_DESC GetDesc(int maxLights);
+};
+
+class WForwardRenderStageIndirectObjectPS : public WShader {
+public:
+	WForwardRenderStageIndirectObjectPS(class Wasabi* const app);
+	virtual void Load(bool bSaveData = false);
+	static W_SHADER_DESC GetDesc(int maxLights);
+};
+
 class WForwardRenderStageTerrainVS : public WShader {
 public:
 	WForwardRenderStageTerrainVS(class Wasabi* const app);
@@ -53,17 +68,25 @@ public:
  * Implementation of a forward rendering stage that renders objects and terrains with simple lighting.
  * Creating this stage adds the following engine parameters:
  * * "maxLights": Maximum number of lights that can be rendered at once (Default is (void*)16)
+ * Static objects drawn in batches are frustum culled on the GPU (see
+ * WObjectsRenderFragment::SetFrustumCuller()) when the "gpuFrustumCulling"
+ * engine parameter is set.
  */
 class WForwardRenderStage : public WRenderStage {
 	WObjectsRenderFragment* m_objectsFragment;
 	class WMaterial* m_perFrameObjectsMaterial;
 	WObjectsRenderFragment* m_animatedObjectsFragment;
 	class WMaterial* m_perFrameAnimatedObjectsMaterial;
+	class WMaterial* m_perFrameIndirectObjectsMaterial;
+	WFrustumCuller* m_frustumCuller;
 
 	WTerrainRenderFragment* m_terrainsFragment;
 	class WMaterial* m_perFrameTerrainsMaterial;
 
 	std::vector<LightStruct> m_lights;
+	std::vector<class WLight*> m_candidateLights; // scratch: unhidden lights, culled in one batch
+	W_BOUNDING_SPHERES m_candidateLightSpheres; // scratch: bounding spheres of m_candidateLights
+	std::vector<uint32_t> m_candidateLightVisibility; // scratch: visibility bitmask of m_candidateLights
 
 protected:
 	bool m_addDefaultEffects; // @TODO please fix this mess
@@ -73,6 +96,7 @@ public:
 
 	virtual WError Initialize(std::vector<WRenderStage*>& previousStages, uint32_t width, uint32_t height);
 	virtual WError Render(class WRenderer* renderer, class WRenderTarget* rt, uint32_t filter);
+	virtual WError RecordCompute(class WRenderer* renderer, VkCommandBuffer cmdBuffer);
 	virtual void Cleanup();
 	virtual WError Resize(uint32_t width, uint32_t height);
 
@@ -0,0 +1,236 @@
+/** @file WGPUProfiler.hpp
+ *  @brief GPU timing of render stages and render fragments
+ *
+ *  The GPU profiler brackets parts of a frame's command buffer with timestamp
+ *  queries and reads the results back once the frame is known to be done, so
+ *  that measuring GPU time never stalls the CPU.
+ *
+ *  @author Hasan Al-Jawaheri (hbj)
+ *  @bug No known bugs.
+ */
+
+#pragma once
+
+#include "Wasabi/Core/WCore.hpp"
+
+#include <deque>
+
+/** Rolling statistics of the GPU time taken by a profiled scope */
+struct W_GPU_TIMING_STATS {
+	/** GPU time of the most recently resolved frame, in milliseconds */
+	double lastMs;
+	/** Average GPU time over the sampled frames, in milliseconds */
+	double averageMs;
+	/** Minimum GPU time over the sampled frames, in milliseconds */
+	double minMs;
+	/** Maximum GPU time over the sampled frames, in milliseconds */
+	double maxMs;
+	/** Number of frames sampled (at most the "gpuProfilerWindow" engine parameter) */
+	uint32_t numSamples;
+};
+
+/**
+ * @ingroup engineclass
+ *
+ * A WGPUProfiler is owned by the WRenderer and measures the GPU time of every
+ * frame, of every render stage and of every render fragment, using a
+ * timestamp query pool per buffering index. The queries of a frame are
+ * resolved when the renderer reuses that frame's buffering index, at which
+ * point the frame's fence has already been waited on, so the results are read
+ * without waiting on the GPU.
+ *
+ * Scopes can be nested, a scope is identified by the names of its enclosing
+ * scopes and its own name, separated by '/' (e.g. "GBuffer/GBuffer-animated").
+ * The whole frame is reported as the "Frame" scope.
+ *
+ * The profiler is enabled through the "enableGPUProfiler" engine parameter or
+ * SetEnabled() and is silently disabled if the graphics queue does not support
+ * timestamps.
+ */
+class WGPUProfiler {
+public:
+	/** Value returned by BeginScope() when the scope is not measured */
+	static const uint32_t INVALID_SCOPE = 0xFFFFFFFF;
+
+	WGPUProfiler(class Wasabi* const app);
+	~WGPUProfiler();
+
+	/**
+	 * (Re)creates the query pools, one per buffering index. Results pending in
+	 * the old pools are discarded, collected statistics are kept. The device
+	 * must be idle.
+	 * @param  numBuffers  Number of buffering indices the renderer uses
+	 * @return             Error code, see WError.h
+	 */
+	WError Initialize(uint32_t numBuffers);
+
+	/**
+	 * Destroys the query pools. The device must be idle.
+	 */
+	void Cleanup();
+
+	/**
+	 * Enables or disables profiling, taking effect on the next frame.
+	 * @param enable  true to enable profiling
+	 */
+	void SetEnabled(bool enable);
+
+	/**
+	 * @return true if profiling is enabled and supported by the device
+	 */
+	bool IsEnabled() const;
+
+	/**
+	 * Resolves the queries of the last frame that used the given buffering
+	 * index (its fence must have been waited on) and starts a new frame. This
+	 * must be called outside of a render pass, at the beginning of the frame's
+	 * command buffer.
+	 * @param cmdBuf       Command buffer of the frame
+	 * @param bufferIndex  Buffering index of the frame
+	 */
+	void BeginFrame(VkCommandBuffer cmdBuf, uint32_t bufferIndex);
+
+	/**
+	 * Ends the frame started by BeginFrame(). Its results become available
+	 * when its buffering index is used again.
+	 * @param cmdBuf  Command buffer of the frame
+	 */
+	void EndFrame(VkCommandBuffer cmdBuf);
+
+	/**
+	 * Starts measuring a scope of the current frame. Scopes must be ended in
+	 * the reverse order they were started.
+	 * @param  cmdBuf  Command buffer the scope's commands are recorded to
+	 * @param  name    Name of the scope
+	 * @return         ID of the scope to pass to EndScope(), INVALID_SCOPE if
+	 *                 the scope is not measured
+	 */
+	uint32_t BeginScope(VkCommandBuffer cmdBuf, const std::string& name);
+
+	/**
+	 * Ends a scope started by BeginScope().
+	 * @param cmdBuf  Command buffer the scope's commands are recorded to
+	 * @param scope   ID returned by BeginScope()
+	 */
+	void EndScope(VkCommandBuffer cmdBuf, uint32_t scope);
+
+	/**
+	 * Retrieves the statistics of a scope.
+	 * @param  scopeName  Full name of the scope (e.g. "Frame" or
+	 *                    "GBuffer/GBuffer-animated")
+	 * @param  stats      Set to the statistics of the scope
+	 * @return            true if the scope has been measured, false otherwise
+	 */
+	bool GetStatistics(const std::string& scopeName, W_GPU_TIMING_STATS* stats) const;
+
+	/**
+	 * Retrieves the statistics of all measured scopes.
+	 * @return Full names of the scopes and their statistics, sorted by name
+	 */
+	std::vector<std::pair<std::string, W_GPU_TIMING_STATS>> GetAllStatistics() const;
+
+	/**
+	 * Clears all collected statistics and trace history.
+	 */
+	void ResetStatistics();
+
+	/**
+	 * Writes the scopes of the most recently resolved frames (at most the
+	 * "gpuProfilerTraceFrames" engine parameter) to a file in the Chrome
+	 * trace event JSON format, which can be opened by chrome://tracing and
+	 * Perfetto.
+	 * @param  filename  Name of the file to write
+	 * @return           Error code, see WError.h
+	 */
+	WError WriteTrace(std::string filename) const;
+
+private:
+	/** A measured scope of a recorded frame */
+	struct PENDING_SCOPE {
+		/** Full name of the scope */
+		std::string name;
+		/** Index of the query written at the start of the scope */
+		uint32_t beginQuery;
+		/** Index of the query written at the end of the scope */
+		uint32_t endQuery;
+		/** Nesting depth of the scope, 0 for the whole frame */
+		uint32_t depth;
+	};
+
+	/** Queries of a frame recorded for one buffering index */
+	struct FRAME_QUERIES {
+		/** Timestamp query pool of the buffering index */
+		VkQueryPool pool;
+		/** Number of queries written in the frame */
+		uint32_t numQueries;
+		/** Whether the frame was submitted and has results to resolve */
+		bool pending;
+		/** Number of the frame (counting all frames) */
+		uint64_t frameNumber;
+		/** Scopes measured in the frame, the first is the whole frame */
+		std::vector<PENDING_SCOPE> scopes;
+	};
+
+	/** Rolling statistics of a scope */
+	struct SCOPE_SAMPLES {
+		/** Ring of the last sampled GPU times, in milliseconds */
+		std::vector<double> samples;
+		/** Index in samples to write the next sample to */
+		uint32_t next;
+		/** Last sampled GPU time, in milliseconds */
+		double last;
+	};
+
+	/** A resolved scope stored for trace export */
+	struct TRACE_EVENT {
+		/** Full name of the scope */
+		std::string name;
+		/** Number of the frame the scope belongs to */
+		uint64_t frameNumber;
+		/** Start of the scope, in microseconds since the first resolved frame */
+		double startUs;
+		/** Duration of the scope, in microseconds */
+		double durationUs;
+		/** Nesting depth of the scope, 0 for the whole frame */
+		uint32_t depth;
+	};
+
+	/** Pointer to the Wasabi application */
+	class Wasabi* m_app;
+	/** Whether profiling was requested */
+	bool m_enabled;
+	/** Whether the graphics queue supports timestamps */
+	bool m_supported;
+	/** Nanoseconds per timestamp tick */
+	double m_timestampPeriod;
+	/** Mask of the valid bits of a timestamp */
+	uint64_t m_timestampMask;
+	/** Number of queries in each pool */
+	uint32_t m_maxQueries;
+	/** Number of samples kept per scope for the rolling statistics */
+	uint32_t m_statsWindow;
+	/** Number of resolved frames kept for trace export */
+	uint32_t m_traceFrames;
+	/** Queries of the frames, one per buffering index */
+	std::vector<FRAME_QUERIES> m_frames;
+	/** Frame currently being recorded, nullptr if none */
+	FRAME_QUERIES* m_currentFrame;
+	/** Indices (in m_currentFrame->scopes) of the currently open scopes */
+	std::vector<uint32_t> m_scopeStack;
+	/** Number of frames begun so far */
+	uint64_t m_frameCounter;
+	/** Rolling statistics of the measured scopes */
+	std::map<std::string, SCOPE_SAMPLES> m_statistics;
+	/** Resolved scopes of the last m_traceFrames frames, oldest first */
+	std::deque<std::vector<TRACE_EVENT>> m_traceHistory;
+	/** Timestamp (in ticks) of the first resolved frame, trace times are relative to it */
+	uint64_t m_traceEpoch;
+	/** Scratch buffer for query results */
+	std::vector<uint64_t> m_results;
+
+	/**
+	 * Reads the results of a frame's queries and records them.
+	 * @param frame  Frame to resolve
+	 */
+	void _Resolve(FRAME_QUERIES& frame);
+};
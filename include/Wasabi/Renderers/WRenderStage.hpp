@@ -14,6 +14,7 @@ enum W_RENDER_STAGE_FLAGS: uint32_t {
 	RENDER_STAGE_FLAG_TEXTS_RENDER_STAGE = 2,
 	RENDER_STAGE_FLAG_PARTICLES_RENDER_STAGE = 4,
 	RENDER_STAGE_FLAG_PICKING_RENDER_STAGE = 8,
+	RENDER_STAGE_FLAG_ASYNC_COMPUTE_RENDER_STAGE = 16,
 };
 
 class WRenderStage {
@@ -52,6 +53,32 @@ public:
 
 	virtual WError Initialize(std::vector<WRenderStage*>& previousStages, uint32_t width, uint32_t height);
 	virtual WError Render(class WRenderer* renderer, class WRenderTarget* rt, uint32_t filter) = 0;
+	/**
+	 * Records the stage's compute work (see WEffect::Dispatch()) for the
+	 * frame. The renderer calls this before the render pass the stage renders
+	 * in begins (after the render passes of the previous render targets
+	 * ended), so the dispatches can consume the outputs of the previous
+	 * stages and produce data for this stage's Render().
+	 * @param renderer   The renderer
+	 * @param cmdBuffer  Command buffer of the frame to record to
+	 * @return           Error code, see WError.h
+	 */
+	virtual WError RecordCompute(class WRenderer* renderer, VkCommandBuffer cmdBuffer);
+	/**
+	 * Records the stage's async compute work for the frame. This is only
+	 * called for stages with the RENDER_STAGE_FLAG_ASYNC_COMPUTE_RENDER_STAGE
+	 * flag, at the beginning of the frame. With a dedicated compute queue
+	 * (see WRenderer::HasAsyncCompute()), cmdBuffer is submitted to it and
+	 * runs alongside the graphics work of the stages before the first flagged
+	 * stage's render pass, which waits for it. Otherwise, cmdBuffer is the
+	 * frame's primary command buffer and the work runs before any render
+	 * pass. Buffers the work writes for graphics to read must be handed over
+	 * with WRenderer::ReleaseAsyncComputeBuffer().
+	 * @param renderer   The renderer
+	 * @param cmdBuffer  Command buffer to record to
+	 * @return           Error code, see WError.h
+	 */
+	virtual WError RecordAsyncCompute(class WRenderer* renderer, VkCommandBuffer cmdBuffer);
 	virtual void Cleanup();
 	virtual WError Resize(uint32_t width, uint32_t height);
 };
@@ -11,6 +11,7 @@
 #pragma once
 
 #include "Wasabi/Core/WCore.hpp"
+#include "Wasabi/Renderers/WGPUProfiler.hpp"
 
 /** Specifies which components are to be rendered. The fields can be bitwise
 		OR'ed (e.g. RENDER_FILTER_OBJECTS | RENDER_FILTER_PARTICLES) to add
@@ -28,6 +29,17 @@ enum W_RENDER_FILTER: uint32_t {
 	RENDER_FILTER_TERRAIN = 16,
 };
 
+/** Statistics of the latency of the rendered frames */
+struct W_FRAME_LATENCY_STATS {
+	/** Average time from the start of a frame's recording until the GPU
+	    finished it, in milliseconds */
+	double averageMs;
+	/** Maximum latency of a frame, in milliseconds */
+	double maxMs;
+	/** Number of frames measured */
+	uint32_t numFrames;
+};
+
 /** Specifies the type of a texture sampler */
 enum W_TEXTURE_SAMPLER_TYPE: uint8_t {
 	/** Default renderer's sampler */
@@ -60,7 +72,14 @@ public:
 
 	/**
 	 * Begin rendering a frame. This function is responsible for semaphore
-	 * synchronization and swap chain presentation.
+	 * synchronization and swap chain presentation. Up to "bufferingCount"
+	 * (engine parameter) frames are in flight: the CPU only waits for the last
+	 * frame that used the next buffering index, so it records a frame while
+	 * the GPU renders the previous ones. The swap chain image is acquired
+	 * before recording, so the frame renders to (and transitions) the image
+	 * it actually presents. In headless mode (see the "headless" engine
+	 * parameter), the frame is rendered to the next image in a ring of
+	 * offscreen images and nothing is presented.
 	 */
 	void Render();
 
@@ -139,9 +158,62 @@ public:
 
 	/**
 	 * Retrieves the swap chain.
+	 * @return The swap chain, nullptr in headless mode
 	 */
 	VulkanSwapChain* GetSwapchain() const;
 
+	/**
+	 * Retrieves the views of the images the back buffer render stage renders
+	 * to. These are the swap chain images (whose number can differ from the
+	 * buffering count), or the offscreen images in headless mode (one per
+	 * buffering index).
+	 * @return Views of the back buffer images
+	 */
+	std::vector<VkImageView> GetBackbufferViews() const;
+
+	/**
+	 * Retrieves the index of the back buffer image the current frame renders
+	 * to: the swap chain image acquired for it, or the buffering index in
+	 * headless mode.
+	 * @return Index of the current back buffer in GetBackbufferViews()
+	 */
+	uint32_t GetCurrentBackbufferIndex() const;
+
+	/**
+	 * Retrieves the latency statistics of the frames finished since the last
+	 * call to ResetFrameLatencyStatistics(). A frame is seen finished when the
+	 * renderer finds its fence signaled at the beginning of a later frame, so
+	 * the latency is measured with the precision of a frame.
+	 * @param  stats  Set to the latency statistics
+	 * @return        true if any frame was measured, false otherwise
+	 */
+	bool GetFrameLatencyStatistics(W_FRAME_LATENCY_STATS* stats) const;
+
+	/**
+	 * Clears the frame latency statistics.
+	 */
+	void ResetFrameLatencyStatistics();
+
+	/**
+	 * @return true if the renderer draws to offscreen images instead of a
+	 *         swap chain (see the "headless" engine parameter)
+	 */
+	bool IsHeadless() const;
+
+	/**
+	 * Retrieves the pixels of the last rendered frame in headless mode, if
+	 * the "headlessReadback" engine parameter is set. This waits for the
+	 * frame to finish rendering.
+	 * @param  pixels  Set to the pixels of the frame, in the
+	 *                 VK_FORMAT_B8G8R8A8_UNORM format with rows of
+	 *                 (width * 4) bytes. The data is valid until the next
+	 *                 call to Render()
+	 * @param  width   Set to the width of the frame
+	 * @param  height  Set to the height of the frame
+	 * @return         Error code, see WError.h
+	 */
+	WError GetHeadlessFrame(const void** pixels, uint32_t* width, uint32_t* height);
+
 	/**
 	 * Retrieves a Vulkan image sampler of a given type
 	 * @param type  Type of the requested sampler
@@ -151,7 +223,9 @@ public:
 
 	/**
 	 * Retrieves the primary command buffer used in the current frame (should be
-	 * called within a WRenderStage's render).
+	 * called within a WRenderStage's render). A frame that waits for async
+	 * compute work is recorded to two primary command buffers, this returns
+	 * the one being recorded.
 	 * @return  Current primary command buffer for the frame
 	 */
 	VkCommandBuffer GetCurrentPrimaryCommandBuffer() const;
@@ -170,6 +244,56 @@ public:
 	 */
 	VkQueue GetQueue() const;
 
+	/**
+	 * @return true if the async compute work of the render stages (see
+	 *         WRenderStage::RecordAsyncCompute()) runs on a dedicated compute
+	 *         queue, false if it runs on the graphics queue before the frame's
+	 *         render passes (see the "enableAsyncCompute" engine parameter)
+	 */
+	bool HasAsyncCompute() const;
+
+	/**
+	 * Hands a buffer range written by the frame's async compute work over to
+	 * the graphics work that reads it. This should be called within
+	 * WRenderStage::RecordAsyncCompute(). On a dedicated compute queue, the
+	 * range is released by the compute queue at the end of the async compute
+	 * work and acquired by the graphics queue where the frame waits for that
+	 * work (a queue family ownership transfer). On the graphics queue, the
+	 * frame's barrier after the async compute work covers it.
+	 * @param buffer     Buffer written by the async compute work
+	 * @param offset     Offset of the range in buffer
+	 * @param size       Size of the range, or VK_WHOLE_SIZE
+	 * @param dstStages  Pipeline stages of the graphics work that read it
+	 * @param dstAccess  Access of the graphics work to it
+	 */
+	void ReleaseAsyncComputeBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+								   VkPipelineStageFlags dstStages, VkAccessFlags dstAccess);
+
+	/**
+	 * Hands a buffer range written by the frame's graphics work over to the
+	 * next frame's async compute work, which waits for the frame to finish.
+	 * This should be called within WRenderStage::Render() or
+	 * WRenderStage::RecordCompute(). On a dedicated compute queue, the range
+	 * is released at the end of the frame and acquired at the beginning of
+	 * the next async compute work (if the next frame records none, the
+	 * contents are not carried over). On the graphics queue, a barrier is
+	 * recorded before the next async compute work instead.
+	 * @param buffer     Buffer written by the graphics work
+	 * @param offset     Offset of the range in buffer
+	 * @param size       Size of the range, or VK_WHOLE_SIZE
+	 * @param srcStages  Pipeline stages of the graphics work that wrote it
+	 * @param srcAccess  Access of the graphics work to it
+	 */
+	void ReleaseGraphicsBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+							   VkPipelineStageFlags srcStages, VkAccessFlags srcAccess);
+
+	/**
+	 * Retrieves the GPU profiler, which measures the GPU time of the render
+	 * stages and render fragments when enabled.
+	 * @return The renderer's GPU profiler
+	 */
+	WGPUProfiler* GetGPUProfiler();
+
 private:
 	/** Pointer to the Wasabi application */
 	class Wasabi* m_app;
@@ -177,10 +301,28 @@ private:
 	VkDevice m_device;
 	/** Vulkan graphics queue */
 	VkQueue m_queue;
-	/** Vulkan swap chain */
+	/** Dedicated Vulkan compute queue for async compute, VK_NULL_HANDLE to use m_queue */
+	VkQueue m_computeQueue;
+	/** Command pool for the family of m_computeQueue */
+	VkCommandPool m_computeCommandPool;
+	/** Family index of m_queue */
+	uint32_t m_queueFamilyIndex;
+	/** Family index of m_computeQueue */
+	uint32_t m_computeQueueFamilyIndex;
+	/** Vulkan swap chain (nullptr in headless mode) */
 	VulkanSwapChain* m_swapChain;
+	/** true if rendering to offscreen images instead of the swap chain */
+	bool m_headless;
+	/** Offscreen images replacing the swap chain images in headless mode, one per buffer */
+	std::vector<WVulkanImage> m_headlessImages;
+	/** Host-visible buffers the headless images are copied to when "headlessReadback" is set, one per buffer */
+	std::vector<WVulkanBuffer> m_headlessReadbackBuffers;
+	/** Buffering index of the last frame submitted in headless mode, UINT32_MAX if none */
+	uint32_t m_lastHeadlessFrame;
 	/** Default Vulkan sampler */
 	VkSampler m_sampler;
+	/** GPU profiler measuring the render stages */
+	WGPUProfiler m_gpuProfiler;
 	/** Currently set rendering stages */
 	std::vector<class WRenderStage*> m_renderStages;
 	/** Currently set rendering stages, stored in an unordered map for quick access */
@@ -196,28 +338,74 @@ private:
 	/** Name of the currently set render stage for picking objects */
 	std::string m_pickingRenderStageName;
 
+	/** Buffer ranges handed over between the graphics and async compute work */
+	struct BUFFER_HANDOVER {
+		/** Barriers of the ranges, with the access masks of both sides */
+		std::vector<VkBufferMemoryBarrier> barriers;
+		/** Stages of the releasing side */
+		VkPipelineStageFlags srcStages;
+		/** Stages of the acquiring side */
+		VkPipelineStageFlags dstStages;
+
+		void Add(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkPipelineStageFlags src, VkAccessFlags srcAccess,
+				 VkPipelineStageFlags dst, VkAccessFlags dstAccess);
+		void Clear();
+	};
+	/** Ranges handed over from the current frame's async compute work to its graphics work */
+	BUFFER_HANDOVER m_computeToGraphics;
+	/** Ranges handed over from the current frame's graphics work to the next async compute work */
+	BUFFER_HANDOVER m_graphicsToCompute;
+	/** Ranges handed over by the last frame's graphics work, to be acquired by the current async compute work */
+	BUFFER_HANDOVER m_pendingComputeAcquires;
+	/** Semaphore the last frame signaled for the next async compute work to wait on, VK_NULL_HANDLE if none */
+	VkSemaphore m_pendingGraphicsSemaphore;
+	/** true if the current frame's async compute work was submitted to m_computeQueue */
+	bool m_waitForAsyncCompute;
+
 	// Synchronization semaphores
 	struct PerBufferResources {
 		/** Primary command buffer for rendering, one per buffer. */
 		std::vector<VkCommandBuffer> primaryCommandBuffers;
+		/** Primary command buffers for the rest of a frame after it waits for its
+		    async compute work (on a dedicated compute queue), one per buffer */
+		std::vector<VkCommandBuffer> lateCommandBuffers;
+		/** Command buffers of the async compute work, one per buffer (only used with
+		    a dedicated compute queue) */
+		std::vector<VkCommandBuffer> computeCommandBuffers;
+		/** Semaphores signaled by the async compute work for the graphics work to
+		    wait on, one per buffer */
+		std::vector<VkSemaphore> computeComplete;
+		/** Semaphores signaled by a frame for the next async compute work to wait
+		    on, one per buffer */
+		std::vector<VkSemaphore> graphicsComplete;
+		/** Pool of computeCommandBuffers */
+		VkCommandPool computeCommandPool;
+		/** Command buffer the current frame is being recorded to */
+		VkCommandBuffer recordingCommandBuffer;
 		/** Semaphores to synchronize swap chain image presentation, one per buffer.
 		    Ensures that the image is displayed before we start submitting new commands
 		    to the queue */
 		std::vector<VkSemaphore> presentComplete;
 		/** Semaphores to synchronize command buffer submission and execution, one
-		    per buffer. Ensures that the image is not presented until all commands have
-			been sumbitted and executed */
+		    per swap chain image (the presentation engine is only done with it once
+			the image is acquired again). Ensures that the image is not presented until
+			all commands have been sumbitted and executed */
 		std::vector<VkSemaphore> renderComplete;
 		/** Memory fences, one per buffer, to ensure that the next frame which uses
 		    that buffer will wait until the memory fence has been signalled (which
 			means that previous frame which used this buffer index is done with the
 			memory and it is safe to write to it) */
 		std::vector<VkFence> memoryFences;
+		/** Time (see WCPUProfiler::Now()) each buffer's frame started recording, 0
+		    if its last frame was already measured (see GetFrameLatencyStatistics()) */
+		std::vector<uint64_t> frameStartTimes;
 		/** Index currently used, this is not the same as the framebuffer returned
 		    by VkAcquireNExtImageKHR, it is independent and round-robin'd */
 		uint32_t curIndex;
+		/** Back buffer image of the current frame, see GetCurrentBackbufferIndex() */
+		uint32_t backbufferIndex;
 
-		VkResult Create(class Wasabi* app, uint32_t numBuffers);
+		VkResult Create(class Wasabi* app, uint32_t numBuffers, uint32_t numImages, VkCommandPool computePool);
 		void Destroy(class Wasabi* app);
 	} m_perBufferResources;
 
@@ -225,5 +413,82 @@ private:
 	uint32_t m_width;
 	/** Current height of the screen (window client) */
 	uint32_t m_height;
+	/** Sum of the measured frame latencies, in nanoseconds */
+	uint64_t m_totalLatency;
+	/** Maximum measured frame latency, in nanoseconds */
+	uint64_t m_maxLatency;
+	/** Number of frames whose latency was measured */
+	uint32_t m_numLatencyFrames;
+
+	/**
+	 * Measures the latency of the submitted frames whose fence is signaled.
+	 */
+	void _UpdateFrameLatencies();
+
+	/**
+	 * Submits a frame that failed to record after its swap chain image was
+	 * acquired. Nothing is rendered, but the acquire semaphore is waited on
+	 * and the frame's fence is signaled, so that the buffering index can be
+	 * reused.
+	 */
+	void _SubmitEmptyFrame();
+
+	/**
+	 * Records the async compute work of the render stages for the current
+	 * frame. On a dedicated compute queue, the work is submitted right away
+	 * (after the last frame's graphics work, which it waits for), otherwise it
+	 * is recorded to the frame's primary command buffer.
+	 * @return Error code, see WError.h
+	 */
+	WError _RecordAsyncCompute();
+
+	/**
+	 * Makes the rest of the frame wait for its async compute work: on a
+	 * dedicated compute queue, the frame continues in its late command buffer
+	 * (submitted in a batch that waits for the work), otherwise a barrier is
+	 * recorded.
+	 * @return Error code, see WError.h
+	 */
+	WError _WaitForAsyncCompute();
+
+	/** Parts of a buffer handover to record, see _RecordBufferHandover() */
+	enum HANDOVER_PART {
+		/** Queue family ownership release, on the releasing queue */
+		HANDOVER_RELEASE,
+		/** Queue family ownership acquire, on the acquiring queue */
+		HANDOVER_ACQUIRE,
+		/** Plain barrier, when both sides are on the same queue */
+		HANDOVER_BARRIER,
+	};
+
+	/**
+	 * Records a part of a buffer handover.
+	 * @param cmdBuffer  Command buffer to record to
+	 * @param handover   Handover to record
+	 * @param part       Part of the handover to record
+	 * @param srcFamily  Family index of the releasing queue
+	 * @param dstFamily  Family index of the acquiring queue
+	 */
+	void _RecordBufferHandover(VkCommandBuffer cmdBuffer, const BUFFER_HANDOVER& handover, HANDOVER_PART part,
+							   uint32_t srcFamily, uint32_t dstFamily);
+
+	/**
+	 * Drops the pending buffer handovers and semaphore waits, when the
+	 * per-buffer resources are recreated (the queues are idle).
+	 */
+	void _ResetAsyncComputeState();
+
+	/**
+	 * (Re)creates the offscreen images (and readback buffers) used in headless
+	 * mode.
+	 * @param  numBuffers  Number of images to create
+	 * @return             Vulkan result of the operation
+	 */
+	VkResult _CreateHeadlessImages(uint32_t numBuffers);
+
+	/**
+	 * Releases the offscreen images and readback buffers.
+	 */
+	void _DestroyHeadlessImages();
 };
 
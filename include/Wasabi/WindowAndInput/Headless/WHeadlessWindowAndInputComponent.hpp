@@ -0,0 +1,68 @@
+/** @file WHeadlessWindowAndInputComponent.hpp
+ *  @brief Window/input component for running without a display
+ *
+ *  @author Hasan Al-Jawaheri (hbj)
+ *  @bug No known bugs.
+ */
+
+#pragma once
+
+#include "Wasabi/WindowAndInput/WWindowAndInputComponent.hpp"
+
+/**
+ * @ingroup engineclass
+ * A window/input component that creates no window and no Vulkan surface. It
+ * is used when the "headless" engine parameter is set, in which case the
+ * renderer draws to offscreen images instead of a swap chain. The "window"
+ * size is the one given to Wasabi::StartEngine() (or SetWindowSize()), and
+ * input only comes from InsertRawInput() and SetMousePosition(), which makes
+ * it possible to script input for automated runs.
+ */
+class WHeadlessWindowAndInputComponent : public WWindowAndInputComponent {
+public:
+	WHeadlessWindowAndInputComponent(class Wasabi* const app);
+
+	virtual WError Initialize(int width, int height);
+	virtual bool Loop();
+	virtual void Cleanup();
+
+	virtual void* GetPlatformHandle() const;
+	virtual void* GetWindowHandle() const;
+	virtual VkSurfaceKHR GetVulkanSurface() const;
+	virtual void GetVulkanRequiredExtensions(std::vector<const char*>& extensions);
+
+	virtual void ShowErrorMessage(std::string error, bool warning = false);
+
+	virtual void SetWindowSize(int width, int height);
+	virtual uint32_t GetWindowWidth(bool framebuffer = true) const;
+	virtual uint32_t GetWindowHeight(bool framebuffer = true) const;
+
+	virtual bool MouseClick(W_MOUSEBUTTON button) const;
+	virtual double MouseX(W_MOUSEPOSTYPE posT = MOUSEPOS_VIEWPORT, uint32_t vpID = 0) const;
+	virtual double MouseY(W_MOUSEPOSTYPE posT = MOUSEPOS_VIEWPORT, uint32_t vpID = 0) const;
+	virtual double MouseZ() const;
+	virtual bool MouseInScreen(W_MOUSEPOSTYPE posT = MOUSEPOS_VIEWPORT, uint32_t vpID = 0) const;
+
+	virtual void SetMousePosition(double x, double y, W_MOUSEPOSTYPE posT = MOUSEPOS_VIEWPORT);
+	virtual void SetMouseZ(double value);
+	virtual void ShowCursor(bool bShow);
+	virtual void SetCursorMotionMode(bool bEnable);
+
+	virtual void SetQuitKeys(bool escape = true, bool cmdW = true);
+
+	virtual bool KeyDown(uint32_t key) const;
+
+	virtual void InsertRawInput(uint32_t key, bool state);
+
+private:
+	/** Width of the (virtual) window */
+	uint32_t m_width;
+	/** Height of the (virtual) window */
+	uint32_t m_height;
+	/** Mouse position */
+	double m_mouseX, m_mouseY;
+	/** Mouse wheel position */
+	double m_mouseZ;
+	/** Key states, mouse buttons use the W_MOUSEBUTTON values */
+	bool m_keyDown[350];
+};
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <Wasabi/Wasabi.hpp>
+#include <Wasabi/Renderers/ForwardRenderer/WForwardRenderer.hpp>
+
+#include <random>
+
+/**
+ * Measurements of a benchmark scene, taken over its measured frames.
+ */
+struct W_BENCH_RESULT {
+	/** Name of the scene */
+	std::string name;
+	/** Parameters the scene ran with */
+	std::vector<std::pair<std::string, double>> parameters;
+	/** Error that stopped the scene, succeeded if it ran */
+	WError error;
+	/** Time it took to set up the scene's renderer and load the scene, in milliseconds */
+	double loadMs;
+	/** Frame time statistics */
+	W_CPU_FRAME_STATS frameTime;
+	/** Latency of the frames, from the start of their recording until the GPU finished them */
+	W_FRAME_LATENCY_STATS frameLatency;
+	/** CPU zones (RunWasabi phases and engine zones) */
+	std::vector<std::pair<std::string, W_CPU_ZONE_STATS>> cpuZones;
+	/** GPU scopes (frame, render stages and render fragments) */
+	std::vector<std::pair<std::string, W_GPU_TIMING_STATS>> gpuScopes;
+	/** Heap allocations (operator new) made during the measured frames */
+	uint64_t heapAllocations;
+	/** Bytes allocated from the heap during the measured frames */
+	uint64_t heapAllocatedBytes;
+	/** Device memory allocations made during the measured frames */
+	uint64_t vulkanAllocations;
+	/** vkAllocateMemory calls made during the measured frames */
+	uint64_t vulkanDeviceAllocations;
+	/** Device memory in use at the end of the measured frames */
+	VkDeviceSize vulkanUsedBytes;
+	/** Device memory reserved at the end of the measured frames */
+	VkDeviceSize vulkanReservedBytes;
+};
+
+/**
+ * The benchmark application runs a list of deterministic scenes headless, each
+ * for a fixed number of warmup frames followed by a fixed number of measured
+ * frames, and writes the results to a JSON file. It is configured with the
+ * following environment variables:
+ * * WASABI_BENCH_SCENES: Comma-separated names of the scenes to run (default
+ *   is all scenes)
+ * * WASABI_BENCH_FRAMES: Number of measured frames per scene (default 300)
+ * * WASABI_BENCH_WARMUP: Number of warmup frames per scene (default 30)
+ * * WASABI_BENCH_SCALE: Multiplier of the scenes' object counts (default 1)
+ * * WASABI_BENCH_THREADS: Comma-separated numbers of threads (the main thread
+ *   and the engine's worker threads) to run every scene with, to measure how
+ *   the engine scales (default is a single run with the engine's default
+ *   "numWorkerThreads"). The number of threads is reported with every result
+ * * WASABI_BENCH_FRAMES_IN_FLIGHT: Number of frames in flight (the
+ *   "bufferingCount" engine parameter, default is the engine's default)
+ * * WASABI_BENCH_TRANSFER_QUEUE: If set to 0, uploads go through the graphics
+ *   queue even if the device has a transfer queue ("enableTransferQueue")
+ * * WASABI_BENCH_COLD_START: If set to 1, the pipeline cache file (see
+ *   Wasabi::GetPipelineCachePath()) is deleted before the engine starts, so
+ *   that every pipeline is compiled from scratch. Running once with and once
+ *   without it compares the cold and warm startup ("startupMs" and the
+ *   scenes' "loadMs" in the results)
+ * * WASABI_BENCH_OUTPUT: Name of the results file (default WasabiBench.json)
+ * * WASABI_BENCH_WINDOWED: If set to 1, renders to a window instead of
+ *   headless
+ */
+class WasabiBenchmark : public Wasabi {
+	/** Scenes to run, in order */
+	std::vector<class WBenchScene*> m_scenes;
+	/** Scenes to run with the number of threads to run them with (0 keeps the engine's workers), in order */
+	std::vector<std::pair<class WBenchScene*, uint32_t>> m_runs;
+	/** Index of the running scene in m_runs */
+	uint32_t m_currentRun;
+	/** Number of frames started by the running scene */
+	uint32_t m_sceneFrame;
+	/** Index of the current frame in the running scene */
+	uint32_t m_currentFrame;
+	/** Time the running scene took to load, in milliseconds */
+	double m_sceneLoadMs;
+	/** Warmup frames of the running scene */
+	uint32_t m_sceneWarmupFrames;
+	/** Warmup frames per scene */
+	uint32_t m_warmupFrames;
+	/** Measured frames per scene */
+	uint32_t m_measuredFrames;
+	/** Multiplier of the scenes' object counts */
+	float m_scale;
+	/** Name of the results file */
+	std::string m_outputFilename;
+	/** Name of the GPU the benchmark runs on */
+	std::string m_deviceName;
+	/** Whether a pipeline cache file was there to start the engine with */
+	bool m_warmPipelineCache;
+	/** Time StartEngine() took, in milliseconds */
+	double m_startupMs;
+	/** Heap allocations when the measurement started */
+	uint64_t m_startHeapAllocations;
+	/** Heap bytes allocated when the measurement started */
+	uint64_t m_startHeapBytes;
+	/** Device memory statistics when the measurement started */
+	WVulkanMemoryStats m_startMemoryStats;
+	/** Results of the scenes that ran */
+	std::vector<W_BENCH_RESULT> m_results;
+
+	/**
+	 * Starts the first run of m_runs, starting at the given index, whose
+	 * scene loads successfully. Scenes that fail to load are recorded with
+	 * their error.
+	 * @param  index  Index of the first run to try
+	 * @return        true if a scene was started, false if none is left
+	 */
+	bool _StartScene(uint32_t index);
+
+	/**
+	 * Resets the profilers and snapshots the allocation counters.
+	 */
+	void _BeginMeasurement();
+
+	/**
+	 * Records the results of the running scene.
+	 */
+	void _EndMeasurement();
+
+	/**
+	 * @param  scene  Scene to get the parameters of
+	 * @return        The parameters of scene, followed by the number of
+	 *                threads it runs with
+	 */
+	std::vector<std::pair<std::string, double>> _GetRunParameters(class WBenchScene* scene) const;
+
+	/**
+	 * Writes m_results to m_outputFilename.
+	 * @return Error code, see WError.h
+	 */
+	WError _WriteResults() const;
+
+public:
+	WasabiBenchmark();
+	virtual WError Setup();
+	virtual bool Loop(float fDeltaTime);
+	virtual void Cleanup();
+
+	virtual WError SetupRenderer();
+
+	/**
+	 * @return Multiplier of the scenes' object counts
+	 */
+	float GetScale() const;
+
+	/**
+	 * @return Index of the current frame in the running scene (0 is the frame
+	 *         the scene was loaded in)
+	 */
+	uint32_t GetSceneFrame() const;
+};
+
+/**
+ * Base class of the benchmark scenes. A scene must only depend on its frame
+ * index (see GetFrame()) and on random numbers from Random(), never on the
+ * frame's delta time, so that every run renders the same frames.
+ */
+class WBenchScene : public WGameState {
+	/** Generator for Random(), seeded the same on every Load() */
+	std::mt19937 m_random;
+
+protected:
+	/** First error encountered while loading, succeeded if none */
+	WError m_error;
+
+	/**
+	 * Records err as the scene's error if it is the first failure.
+	 * @param err  Error to check
+	 */
+	void CheckError(WError err) {
+		if (!err && m_error)
+			m_error = err;
+	}
+
+	/**
+	 * Restarts the random sequence, scenes call this at the beginning of Load().
+	 * @param seed  Seed of the sequence
+	 */
+	void SeedRandom(uint32_t seed) {
+		m_random.seed(seed);
+	}
+
+	/**
+	 * @param  min  Lower bound
+	 * @param  max  Upper bound
+	 * @return      A random number in [min, max], the same on every platform
+	 */
+	float Random(float min, float max) {
+		return min + (max - min) * (float)((double)m_random() / (double)std::mt19937::max());
+	}
+
+	/**
+	 * @param  count  Object count at scale 1
+	 * @return        count multiplied by the benchmark's scale, at least 1
+	 */
+	uint32_t Scaled(uint32_t count) const {
+		return std::max((uint32_t)((float)count * ((WasabiBenchmark*)m_app)->GetScale()), 1u);
+	}
+
+	/**
+	 * @return Index of the current frame of this scene
+	 */
+	uint32_t GetFrame() const {
+		return ((WasabiBenchmark*)m_app)->GetSceneFrame();
+	}
+
+	/**
+	 * Places the default camera on a circle around a point, looking at it.
+	 * The camera completes a circle every periodFrames frames.
+	 * @param center        Point to orbit
+	 * @param radius        Radius of the circle
+	 * @param height        Height of the camera above center
+	 * @param periodFrames  Number of frames per revolution
+	 */
+	void OrbitCamera(WVector3 center, float radius, float height, uint32_t periodFrames) {
+		float angle = 2.0f * W_PI * (float)(GetFrame() % periodFrames) / (float)periodFrames;
+		WCamera* cam = m_app->CameraManager->GetDefaultCamera();
+		cam->SetPosition(center + WVector3(cosf(angle) * radius, height, sinf(angle) * radius));
+		cam->Point(center);
+	}
+
+public:
+	WBenchScene(Wasabi* const app) : WGameState(app), m_error(W_SUCCEEDED) {}
+	virtual ~WBenchScene() {}
+
+	/**
+	 * @return Name of the scene, as used in WASABI_BENCH_SCENES
+	 */
+	virtual const char* GetName() const = 0;
+
+	/**
+	 * @return Parameters of the scene (e.g. object counts) to report with its
+	 *         results
+	 */
+	virtual std::vector<std::pair<std::string, double>> GetParameters() const = 0;
+
+	/**
+	 * @return Minimum number of warmup frames the scene needs to reach its
+	 *         steady state
+	 */
+	virtual uint32_t GetMinimumWarmupFrames() const {
+		return 0;
+	}
+
+	/**
+	 * Sets up the renderer the scene runs on, called before Load().
+	 * @return Error code, see WError.h
+	 */
+	virtual WError SetupRenderer() {
+		return WInitializeForwardRenderer(m_app);
+	}
+
+	/**
+	 * @return First error encountered while loading, succeeded if none
+	 */
+	WError GetError() const {
+		return m_error;
+	}
+};
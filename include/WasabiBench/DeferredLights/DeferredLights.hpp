@@ -0,0 +1,27 @@
+#pragma once
+
+#include "BenchSuite.hpp"
+#include <Wasabi/Renderers/DeferredRenderer/WDeferredRenderer.hpp>
+
+/**
+ * Hundreds of moving point and spot lights lighting a field of boxes in the deferred renderer.
+ */
+class DeferredLightsScene : public WBenchScene {
+	uint32_t m_numBoxes;
+	uint32_t m_numPointLights;
+	uint32_t m_numSpotLights;
+	WObject* m_plain;
+	std::vector<WObject*> m_boxes;
+	std::vector<WLight*> m_lights;
+	std::vector<WVector3> m_lightOrigins;
+public:
+	DeferredLightsScene(Wasabi* const app);
+
+	virtual const char* GetName() const { return "deferred_lights"; }
+	virtual std::vector<std::pair<std::string, double>> GetParameters() const;
+
+	virtual WError SetupRenderer() { return WInitializeDeferredRenderer(m_app); }
+	virtual void Load();
+	virtual void Update(float fDeltaTime);
+	virtual void Cleanup();
+};
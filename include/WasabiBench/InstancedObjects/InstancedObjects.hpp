@@ -0,0 +1,21 @@
+#pragma once
+
+#include "BenchSuite.hpp"
+
+/**
+ * Tens of thousands of instances of one object, a fraction of which move every frame.
+ */
+class InstancedObjectsScene : public WBenchScene {
+	uint32_t m_numInstances;
+	WObject* m_object;
+	std::vector<WInstance*> m_movingInstances;
+public:
+	InstancedObjectsScene(Wasabi* const app);
+
+	virtual const char* GetName() const { return "instanced_objects"; }
+	virtual std::vector<std::pair<std::string, double>> GetParameters() const;
+
+	virtual void Load();
+	virtual void Update(float fDeltaTime);
+	virtual void Cleanup();
+};
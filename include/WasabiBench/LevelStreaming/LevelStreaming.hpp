@@ -0,0 +1,31 @@
+#pragma once
+
+#include "BenchSuite.hpp"
+
+/**
+ * Loads a level of textured objects, each with its own geometry and texture, then keeps streaming new ones in
+ * (and old ones out) every frame while rendering. The load time and the frame times show how much of the uploads
+ * overlap with the CPU work, run it with WASABI_BENCH_TRANSFER_QUEUE=0 and =1 to compare the graphics queue
+ * and transfer queue upload paths.
+ */
+class LevelStreamingScene : public WBenchScene {
+	uint32_t m_numObjects;
+	uint32_t m_objectsPerFrame;
+	uint32_t m_nextObject;
+	double m_loadCpuMs;
+	double m_loadTotalMs;
+	std::vector<uint32_t> m_pixels;
+	std::vector<WObject*> m_objects;
+
+	/** Creates the i'th object, with a new geometry and a new texture */
+	WObject* _CreateObject(uint32_t i);
+public:
+	LevelStreamingScene(Wasabi* const app);
+
+	virtual const char* GetName() const { return "level_streaming"; }
+	virtual std::vector<std::pair<std::string, double>> GetParameters() const;
+
+	virtual void Load();
+	virtual void Update(float fDeltaTime);
+	virtual void Cleanup();
+};
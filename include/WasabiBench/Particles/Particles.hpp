@@ -0,0 +1,21 @@
+#pragma once
+
+#include "BenchSuite.hpp"
+
+/**
+ * Many large particle systems that fill up during the warmup and then stay full.
+ */
+class ParticlesScene : public WBenchScene {
+	uint32_t m_numSystems;
+	uint32_t m_maxParticles;
+	std::vector<WParticles*> m_particles;
+public:
+	ParticlesScene(Wasabi* const app);
+
+	virtual const char* GetName() const { return "particles"; }
+	virtual std::vector<std::pair<std::string, double>> GetParameters() const;
+	virtual uint32_t GetMinimumWarmupFrames() const;
+	virtual void Load();
+	virtual void Update(float fDeltaTime);
+	virtual void Cleanup();
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "BenchSuite.hpp"
+
+/**
+ * Many skinned characters, each playing its own copy of a skeletal animation.
+ */
+class SkinnedCharactersScene : public WBenchScene {
+	uint32_t m_numCharacters;
+	std::vector<WObject*> m_characters;
+public:
+	SkinnedCharactersScene(Wasabi* const app);
+
+	virtual const char* GetName() const { return "skinned_characters"; }
+	virtual std::vector<std::pair<std::string, double>> GetParameters() const;
+
+	virtual void Load();
+	virtual void Update(float fDeltaTime);
+	virtual void Cleanup();
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "BenchSuite.hpp"
+
+/**
+ * Thousands of individual static objects (one draw call each) on a grid, viewed from a camera circling inside the grid.
+ */
+class StaticObjectsScene : public WBenchScene {
+	uint32_t m_numObjects;
+	std::vector<WObject*> m_objects;
+public:
+	StaticObjectsScene(Wasabi* const app);
+
+	virtual const char* GetName() const { return "static_objects"; }
+	virtual std::vector<std::pair<std::string, double>> GetParameters() const;
+
+	virtual void Load();
+	virtual void Update(float fDeltaTime);
+	virtual void Cleanup();
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "BenchSuite.hpp"
+
+/**
+ * The terrain clipmap, with a viewpoint that travels across it so that the rings are updated every frame.
+ */
+class TerrainScene : public WBenchScene {
+	uint32_t m_size;
+	uint32_t m_numRings;
+	WTerrain* m_terrain;
+public:
+	TerrainScene(Wasabi* const app);
+
+	virtual const char* GetName() const { return "terrain"; }
+	virtual std::vector<std::pair<std::string, double>> GetParameters() const;
+
+	virtual void Load();
+	virtual void Update(float fDeltaTime);
+	virtual void Cleanup();
+};
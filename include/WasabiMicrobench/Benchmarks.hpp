@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Harness.hpp"
+
+/*
+ * Benchmarks that only need the CPU. The app only needs a window and input
+ * component, a camera manager and an animation manager (see
+ * WasabiMicrobenchmark::Setup()).
+ */
+void RunMathBenchmarks(WMicrobenchHarness& harness);
+void RunManagerBenchmarks(WMicrobenchHarness& harness, class Wasabi* app);
+void RunCameraBenchmarks(WMicrobenchHarness& harness, class Wasabi* app);
+void RunGeometryBVHBenchmarks(WMicrobenchHarness& harness);
+void RunGeometryIntersectBenchmarks(WMicrobenchHarness& harness);
+void RunSoftwareOcclusionBenchmarks(WMicrobenchHarness& harness);
+void RunParticlesBenchmarks(WMicrobenchHarness& harness, class Wasabi* app);
+void RunSkeletonBenchmarks(WMicrobenchHarness& harness, class Wasabi* app);
+
+/*
+ * Benchmarks that need a started engine (a Vulkan device), skipped if the
+ * engine can't start.
+ */
+void RunMemoryBenchmarks(WMicrobenchHarness& harness, class Wasabi* app);
+void RunBufferBenchmarks(WMicrobenchHarness& harness, class Wasabi* app);
+void RunGeometryBenchmarks(WMicrobenchHarness& harness, class Wasabi* app);
+void RunMaterialBenchmarks(WMicrobenchHarness& harness, class Wasabi* app);
+void RunDescriptorBenchmarks(WMicrobenchHarness& harness, class Wasabi* app);
+void RunObjectBenchmarks(WMicrobenchHarness& harness, class Wasabi* app);
+void RunAnimationBenchmarks(WMicrobenchHarness& harness, class Wasabi* app);
+void SkipDeviceBenchmarks(WMicrobenchHarness& harness, const std::string& reason);
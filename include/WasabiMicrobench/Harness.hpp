@@ -0,0 +1,156 @@
+#pragma once
+
+#include <Wasabi/Core/WError.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace WMicrobench {
+	/** Sink for DoNotOptimize() on compilers without inline assembly */
+	extern const void* volatile g_sink;
+};
+
+/**
+ * Keeps the compiler from optimizing away the computation of value.
+ * @param value  Result of the benchmarked computation
+ */
+template<typename T>
+inline void WDoNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+	WMicrobench::g_sink = &value;
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r"(&value) : "memory");
+#endif
+}
+
+/**
+ * Keeps the compiler from inlining a function, e.g. a reference implementation
+ * that should be called the same way as the engine function it is compared to.
+ */
+#if defined(_MSC_VER)
+#define W_NOINLINE __declspec(noinline)
+#else
+#define W_NOINLINE __attribute__((noinline))
+#endif
+
+/** Statistics of a microbenchmark, times are per operation */
+struct W_MICROBENCH_RESULT {
+	/** Name of the benchmark */
+	std::string name;
+	/** Whether the benchmark was skipped */
+	bool skipped;
+	/** Reason the benchmark was skipped */
+	std::string skipReason;
+	/** Number of operations timed in every sample */
+	uint64_t iterations;
+	/** Number of measured samples */
+	uint32_t numSamples;
+	/** Average time per operation, in nanoseconds */
+	double meanNs;
+	/** Minimum time per operation, in nanoseconds */
+	double minNs;
+	/** Median time per operation, in nanoseconds */
+	double medianNs;
+	/** 95th percentile of the time per operation, in nanoseconds */
+	double p95Ns;
+	/** Maximum time per operation, in nanoseconds */
+	double maxNs;
+};
+
+/**
+ * A WMicrobenchHarness runs microbenchmarks and collects their statistics.
+ * A benchmark is a function that performs a given number of operations. The
+ * harness first calibrates the number of operations so that a sample takes
+ * the requested sample time, then runs warmup samples and finally times the
+ * measured samples.
+ */
+class WMicrobenchHarness {
+public:
+	/**
+	 * @param warmupSamples  Number of untimed samples run before measuring
+	 * @param numSamples     Number of timed samples
+	 * @param sampleTimeMs   Target duration of a sample, in milliseconds
+	 * @param filter         Only benchmarks whose name contains filter are
+	 *                       run (all benchmarks if empty)
+	 */
+	WMicrobenchHarness(uint32_t warmupSamples, uint32_t numSamples, double sampleTimeMs, std::string filter);
+
+	/**
+	 * @param  name  Name of a benchmark
+	 * @return       true if the benchmark passes the filter
+	 */
+	bool IsSelected(const std::string& name) const;
+
+	/**
+	 * Runs a benchmark, unless it is filtered out.
+	 * @param  name  Name of the benchmark
+	 * @param  body  Function that performs the number of operations it is
+	 *               given
+	 * @return       true if the benchmark ran
+	 */
+	bool Run(const std::string& name, const std::function<void(uint64_t)>& body);
+
+	/**
+	 * Records a benchmark that could not run.
+	 * @param name    Name of the benchmark
+	 * @param reason  Why the benchmark was skipped
+	 */
+	void Skip(const std::string& name, const std::string& reason);
+
+	/**
+	 * Records the result of a correctness check, such as comparing an
+	 * optimized engine path to a reference implementation. Failed checks
+	 * make the microbenchmark application exit with an error, so checks
+	 * should only be made for benchmarks that pass the filter.
+	 * @param  name    Name of the check
+	 * @param  passed  Whether the check passed
+	 * @return         passed
+	 */
+	bool Check(const std::string& name, bool passed);
+
+	/**
+	 * @return Number of checks that failed so far
+	 */
+	uint32_t GetNumFailedChecks() const;
+
+	/**
+	 * @return Results of the benchmarks run or skipped so far, in order
+	 */
+	const std::vector<W_MICROBENCH_RESULT>& GetResults() const;
+
+	/**
+	 * Writes the results to a JSON file.
+	 * @param  filename  Name of the file to write
+	 * @return           Error code, see WError.h
+	 */
+	WError WriteResults(std::string filename) const;
+
+private:
+	/** Number of untimed samples run before measuring */
+	uint32_t m_warmupSamples;
+	/** Number of timed samples */
+	uint32_t m_numSamples;
+	/** Target duration of a sample, in nanoseconds */
+	double m_sampleTimeNs;
+	/** Benchmark name filter */
+	std::string m_filter;
+	/** Results so far */
+	std::vector<W_MICROBENCH_RESULT> m_results;
+	/** Number of failed checks */
+	uint32_t m_numFailedChecks;
+
+	/**
+	 * Times a call to a benchmark.
+	 * @param  body        Benchmark to run
+	 * @param  iterations  Number of operations to perform
+	 * @return             Duration of the call, in nanoseconds
+	 */
+	static double _Time(const std::function<void(uint64_t)>& body, uint64_t iterations);
+};
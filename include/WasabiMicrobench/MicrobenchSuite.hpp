@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Wasabi/Wasabi.hpp>
+#include <Wasabi/Renderers/ForwardRenderer/WForwardRenderer.hpp>
+
+/**
+ * The microbenchmark application times the engine's hot primitives in
+ * isolation and exits. Benchmarks that only need the CPU run without starting
+ * the engine, so they run on machines with no GPU. The others run if a
+ * headless engine can be started and are reported as skipped otherwise. Some
+ * benchmarks also check the results of the code they time, and the
+ * application exits with an error if any check fails. It is configured with
+ * the following environment variables:
+ * * WASABI_MICROBENCH_FILTER: Only run the benchmarks whose name contains
+ *   this string
+ * * WASABI_MICROBENCH_SAMPLES: Number of timed samples per benchmark
+ *   (default 10)
+ * * WASABI_MICROBENCH_SAMPLE_MS: Target duration of a sample, in
+ *   milliseconds (default 10)
+ * * WASABI_MICROBENCH_OUTPUT: Name of a JSON file to write the results to
+ * * WASABI_MICROBENCH_CPU_ONLY: If set to 1, never start the engine
+ */
+class WasabiMicrobenchmark : public Wasabi {
+public:
+	WasabiMicrobenchmark();
+	virtual WError Setup();
+	virtual bool Loop(float fDeltaTime);
+	virtual void Cleanup();
+
+	virtual WError SetupRenderer();
+};
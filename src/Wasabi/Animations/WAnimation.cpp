@@ -5,9 +5,12 @@ WAnimationManager::WAnimationManager(Wasabi* const app) : WManager<WAnimation>(a
 WAnimationManager::~WAnimationManager() {
 }
 void WAnimationManager::Update(float fDeltaTime) {
-	uint32_t entitiyCount = GetEntitiesCount();
-	for (uint32_t i = 0; i < entitiyCount; i++)
-		GetEntityByIndex(i)->Update(fDeltaTime);
+	W_PROFILE_ZONE(m_app, "WAnimationManager::Update");
+	// backwards, so that an animation removed during its update doesn't skip another one
+	for (uint32_t i = GetEntitiesCount(); i-- > 0;) {
+		if (i < GetEntitiesCount())
+			GetEntityByIndex(i)->Update(fDeltaTime);
+	}
 }
 std::string WAnimationManager::GetTypeName() const {
 	return "Animation";
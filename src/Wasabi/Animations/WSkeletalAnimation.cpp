@@ -123,7 +123,7 @@ bool WBone::UpdateLocals() {
 		(m_worldM)(1, 0) = _right.y; (m_worldM)(1, 1) = _up.y; (m_worldM)(1, 2) = _look.y; (m_worldM)(1, 3) = 0.0f;
 		(m_worldM)(2, 0) = _right.z; (m_worldM)(2, 1) = _up.z; (m_worldM)(2, 2) = _look.z; (m_worldM)(2, 3) = 0.0f;
 		(m_worldM)(3, 0) = x;        (m_worldM)(3, 1) = y;     (m_worldM)(3, 2) = z;       (m_worldM)(3, 3) = 1.0f;
-		m_worldM = WMatrixInverse(m_worldM);
+		m_worldM = WMatrixInverseOrthonormal(m_worldM);
 
 		//scale matrix
 		//m_worldM = WTranslationMatrix ( -GetPosition ( ) ) * m_worldM; //remove offset after rotation
@@ -250,25 +250,29 @@ WError WSkeleton::CreateKeyFrame(WBone* baseBone, float fTime) {
 
 	WError err = WError(W_SUCCEEDED);
 
-	if (!m_boneTex) { //first frame will create the texture
+	if (!m_boneTex && m_boneData.empty()) { //first frame will create the texture
 		float fExactWidth = sqrtf((float)f->boneV.size() * 4.0f);
 		uint32_t texWidth = 2;
 		while (fExactWidth > texWidth)
 			texWidth *= 2;
 
-		float* texData = new float[texWidth * texWidth * 4];
+		std::vector<float> texData(texWidth * texWidth * 4);
 		for (uint32_t i = 0; i < f->boneV.size(); i++) {
 			WMatrix mtx = f->boneV[i]->GetInvBindingPose() * f->boneV[i]->GetRelativeMatrix();
-			memcpy(&((char*)texData)[i * sizeof(WMatrix)], &mtx, sizeof(WMatrix) - 4 * sizeof(float));
+			memcpy(&((char*)texData.data())[i * sizeof(WMatrix)], &mtx, sizeof(WMatrix) - 4 * sizeof(float));
+		}
+		if (!m_app->ImageManager) {
+			// no device to create the texture on, keep the matrices on the CPU
+			m_boneData = std::move(texData);
+		} else {
+			int oldMips = m_app->GetEngineParam<int>("numGeneratedMips");
+			m_app->SetEngineParam<int>("numGeneratedMips", 1);
+			m_boneTex = m_app->ImageManager->CreateImage(texData.data(), texWidth, texWidth, VK_FORMAT_R32G32B32A32_SFLOAT, W_IMAGE_CREATE_TEXTURE | W_IMAGE_CREATE_DYNAMIC | W_IMAGE_CREATE_REWRITE_EVERY_FRAME);
+			m_app->SetEngineParam<int>("numGeneratedMips", oldMips);
+
+			if (!m_boneTex)
+				err = WError(W_OUTOFMEMORY);
 		}
-		int oldMips = m_app->GetEngineParam<int>("numGeneratedMips");
-		m_app->SetEngineParam<int>("numGeneratedMips", 1);
-		m_boneTex = m_app->ImageManager->CreateImage(texData, texWidth, texWidth, VK_FORMAT_R32G32B32A32_SFLOAT, W_IMAGE_CREATE_TEXTURE | W_IMAGE_CREATE_DYNAMIC | W_IMAGE_CREATE_REWRITE_EVERY_FRAME);
-		m_app->SetEngineParam<int>("numGeneratedMips", oldMips);
-		W_SAFE_DELETE_ARRAY(texData);
-
-		if (!m_boneTex)
-			err = WError(W_OUTOFMEMORY);
 	}
 
 	return err;
@@ -329,7 +333,10 @@ void WSkeleton::Update(float fDeltaTime) {
 
 	if (WAnimation::m_frames.size()) {
 		float* texData = nullptr;
-		m_boneTex->MapPixels((void**)&texData, W_MAP_WRITE);
+		if (m_boneTex)
+			m_boneTex->MapPixels((void**)&texData, W_MAP_WRITE);
+		else if (m_boneData.size())
+			texData = m_boneData.data();
 		if (!texData)
 			return;
 
@@ -464,7 +471,8 @@ void WSkeleton::Update(float fDeltaTime) {
 			}
 		}
 
-		m_boneTex->UnmapPixels();
+		if (m_boneTex)
+			m_boneTex->UnmapPixels();
 	}
 }
 
@@ -551,6 +559,7 @@ WError	WSkeleton::CopyFrom(const WAnimation* const from) {
 
 	//delete the bone texture and any existing frames
 	W_SAFE_REMOVEREF(m_boneTex);
+	m_boneData.clear();
 	if (WAnimation::m_bFramesOwner)
 		for (uint32_t i = 0; i < WAnimation::m_frames.size(); i++)
 			W_SAFE_DELETE(WAnimation::m_frames[i]);
@@ -584,6 +593,7 @@ WError WSkeleton::UseAnimationFrames(const WAnimation* const anim) {
 
 	//delete the bone texture and any existing frames
 	W_SAFE_REMOVEREF(m_boneTex);
+	m_boneData.clear();
 	if (WAnimation::m_bFramesOwner)
 		for (uint32_t i = 0; i < WAnimation::m_frames.size(); i++)
 			W_SAFE_DELETE(WAnimation::m_frames[i]);
@@ -659,6 +669,7 @@ WError WSkeleton::LoadFromStream(WFile* file, std::istream& inputStream, std::ve
 
 	//delete the bone texture and any existing frames
 	W_SAFE_REMOVEREF(m_boneTex);
+	m_boneData.clear();
 	if (WAnimation::m_bFramesOwner)
 		for (uint32_t i = 0; i < WAnimation::m_frames.size(); i++)
 			W_SAFE_DELETE(WAnimation::m_frames[i]);
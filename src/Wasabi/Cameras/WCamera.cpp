@@ -1,5 +1,138 @@
 #include "Wasabi/Cameras/WCamera.hpp"
 #include "Wasabi/WindowAndInput/WWindowAndInputComponent.hpp"
+#include "Wasabi/Core/WSIMD.hpp"
+
+namespace {
+	/** Frustum planes split into their components */
+	struct PLANES_SOA {
+		float a[6], b[6], c[6], d[6];
+		/** Absolute values of the components of the normals */
+		float absA[6], absB[6], absC[6];
+
+		PLANES_SOA(const WPlane* planes) {
+			for (uint32_t i = 0; i < 6; i++) {
+				a[i] = planes[i].a;
+				b[i] = planes[i].b;
+				c[i] = planes[i].c;
+				d[i] = planes[i].d;
+				absA[i] = std::abs(a[i]);
+				absB[i] = std::abs(b[i]);
+				absC[i] = std::abs(c[i]);
+			}
+		}
+	};
+
+#if defined(W_SIMD_SSE)
+	typedef __m128 VEC;
+	inline VEC Load(const float* p) { return _mm_loadu_ps(p); }
+	inline VEC Splat(float f) { return _mm_set1_ps(f); }
+	inline VEC Set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+	inline VEC Add(VEC a, VEC b) { return _mm_add_ps(a, b); }
+	inline VEC Mul(VEC a, VEC b) { return _mm_mul_ps(a, b); }
+	/** Bit i is set if lane i is negative */
+	inline uint32_t NegativeMask(VEC v) { return (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(v, _mm_setzero_ps())); }
+#elif defined(W_SIMD_NEON)
+	typedef float32x4_t VEC;
+	inline VEC Load(const float* p) { return vld1q_f32(p); }
+	inline VEC Splat(float f) { return vdupq_n_f32(f); }
+	inline VEC Set(float x, float y, float z, float w) { float v[4] = { x, y, z, w }; return vld1q_f32(v); }
+	inline VEC Add(VEC a, VEC b) { return vaddq_f32(a, b); }
+	inline VEC Mul(VEC a, VEC b) { return vmulq_f32(a, b); }
+	/** Bit i is set if lane i is negative */
+	inline uint32_t NegativeMask(VEC v) {
+		static const uint32_t laneBits[4] = { 1, 2, 4, 8 };
+		uint32x4_t bits = vandq_u32(vcltq_f32(v, vdupq_n_f32(0.0f)), vld1q_u32(laneBits));
+		uint32x2_t sum = vadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+		return vget_lane_u32(vpadd_u32(sum, sum), 0);
+	}
+#endif
+
+	/**
+	 * Culls a batch of boxes (IS_BOX) or spheres with the center/extent test:
+	 * a volume is outside a plane if the signed distance of its center to the
+	 * plane is less than -r, where r is the radius of the volume along the
+	 * plane's normal (|normal| . extent for a box, the radius for a sphere).
+	 * For spheres, ex holds the radii and ey and ez are unused.
+	 */
+	template<bool IS_BOX>
+	void CullBatch(const WPlane* planes, uint32_t count,
+				   const float* cx, const float* cy, const float* cz,
+				   const float* ex, const float* ey, const float* ez,
+				   std::vector<uint32_t>& visible, std::vector<uint8_t>* planeCache) {
+		PLANES_SOA p(planes);
+		visible.assign((count + 31) / 32, 0);
+		uint8_t* cache = nullptr;
+		if (planeCache) {
+			planeCache->resize(count, 0);
+			cache = planeCache->data();
+		}
+
+		uint32_t i = 0;
+#if defined(W_SIMD_SSE) || defined(W_SIMD_NEON)
+		for (; i + 4 <= count; i += 4) {
+			VEC x = Load(cx + i), y = Load(cy + i), z = Load(cz + i);
+			VEC rx = Load(ex + i), ry, rz;
+			if constexpr (IS_BOX) {
+				ry = Load(ey + i);
+				rz = Load(ez + i);
+			}
+
+			// bit j is set once volume i + j is found outside a plane
+			uint32_t outside = 0;
+			if (cache) {
+				const uint8_t* c = cache + i;
+				VEC dist = Add(Add(Add(Mul(x, Set(p.a[c[0]], p.a[c[1]], p.a[c[2]], p.a[c[3]])),
+					Mul(y, Set(p.b[c[0]], p.b[c[1]], p.b[c[2]], p.b[c[3]]))),
+					Mul(z, Set(p.c[c[0]], p.c[c[1]], p.c[c[2]], p.c[c[3]]))),
+					Set(p.d[c[0]], p.d[c[1]], p.d[c[2]], p.d[c[3]]));
+				VEC r = rx;
+				if constexpr (IS_BOX) {
+					r = Add(Add(Mul(rx, Set(p.absA[c[0]], p.absA[c[1]], p.absA[c[2]], p.absA[c[3]])),
+						Mul(ry, Set(p.absB[c[0]], p.absB[c[1]], p.absB[c[2]], p.absB[c[3]]))),
+						Mul(rz, Set(p.absC[c[0]], p.absC[c[1]], p.absC[c[2]], p.absC[c[3]])));
+				}
+				outside = NegativeMask(Add(dist, r));
+			}
+
+			for (uint32_t j = 0; j < 6 && outside != 0xF; j++) {
+				VEC dist = Add(Add(Add(Mul(x, Splat(p.a[j])), Mul(y, Splat(p.b[j]))), Mul(z, Splat(p.c[j]))), Splat(p.d[j]));
+				VEC r = rx;
+				if constexpr (IS_BOX)
+					r = Add(Add(Mul(rx, Splat(p.absA[j])), Mul(ry, Splat(p.absB[j]))), Mul(rz, Splat(p.absC[j])));
+				uint32_t newlyOutside = NegativeMask(Add(dist, r)) & ~outside;
+				if (cache) {
+					for (uint32_t lane = 0; lane < 4; lane++)
+						if (newlyOutside & (1 << lane))
+							cache[i + lane] = (uint8_t)j;
+				}
+				outside |= newlyOutside;
+			}
+
+			visible[i / 32] |= (~outside & 0xF) << (i % 32);
+		}
+#endif
+
+		for (; i < count; i++) {
+			uint32_t first = cache ? cache[i] : 0;
+			bool outside = false;
+			for (uint32_t k = 0; k < 6 && !outside; k++) {
+				// the cached plane is tested first, then the others in order
+				uint32_t j = k == 0 ? first : (k <= first ? k - 1 : k);
+				float dist = p.a[j] * cx[i] + p.b[j] * cy[i] + p.c[j] * cz[i] + p.d[j];
+				float r = ex[i];
+				if constexpr (IS_BOX)
+					r = p.absA[j] * ex[i] + p.absB[j] * ey[i] + p.absC[j] * ez[i];
+				if (dist + r < 0.0f) {
+					outside = true;
+					if (cache)
+						cache[i] = (uint8_t)j;
+				}
+			}
+			if (!outside)
+				visible[i / 32] |= 1u << (i % 32);
+		}
+	}
+};
 
 WCameraManager::WCameraManager(Wasabi* const app) : WManager<WCamera>(app) {
 	m_default_camera = nullptr;
@@ -146,29 +279,7 @@ bool WCamera::CheckPointInFrustum(WVector3 point) const {
 }
 
 bool WCamera::CheckCubeInFrustum(float xCenter, float yCenter, float zCenter, float radius) const {
-	// Check if any one point of the cube is in the view m_frustum.
-	for (uint32_t i = 0; i < 6; i++) {
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter - radius), (yCenter - radius), (zCenter - radius))) >= 0.0f)
-			continue;
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter + radius), (yCenter - radius), (zCenter - radius))) >= 0.0f)
-			continue;
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter - radius), (yCenter + radius), (zCenter - radius))) >= 0.0f)
-			continue;
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter + radius), (yCenter + radius), (zCenter - radius))) >= 0.0f)
-			continue;
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter - radius), (yCenter - radius), (zCenter + radius))) >= 0.0f)
-			continue;
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter + radius), (yCenter - radius), (zCenter + radius))) >= 0.0f)
-			continue;
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter - radius), (yCenter + radius), (zCenter + radius))) >= 0.0f)
-			continue;
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter + radius), (yCenter + radius), (zCenter + radius))) >= 0.0f)
-			continue;
-
-		return false;
-	}
-
-	return true;
+	return CheckBoxInFrustum(xCenter, yCenter, zCenter, radius, radius, radius);
 }
 
 bool WCamera::CheckCubeInFrustum(WVector3 center, float radius) const {
@@ -189,26 +300,13 @@ bool WCamera::CheckSphereInFrustum(WVector3 center, float radius) const {
 }
 
 bool WCamera::CheckBoxInFrustum(float xCenter, float yCenter, float zCenter, float xSize, float ySize, float zSize) const {
-	// Check if any of the 6 planes of the rectangle are inside the view m_frustum.
+	// the box is outside a plane if its center is further behind the plane
+	// than the box's extent along the plane's normal (its nearest corner)
 	for (uint32_t i = 0; i < 6; i++) {
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter - xSize), (yCenter - ySize), (zCenter - zSize))) >= 0.0f)
-			continue;
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter + xSize), (yCenter - ySize), (zCenter - zSize))) >= 0.0f)
-			continue;
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter - xSize), (yCenter + ySize), (zCenter - zSize))) >= 0.0f)
-			continue;
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter - xSize), (yCenter - ySize), (zCenter + zSize))) >= 0.0f)
-			continue;
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter + xSize), (yCenter + ySize), (zCenter - zSize))) >= 0.0f)
-			continue;
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter + xSize), (yCenter - ySize), (zCenter + zSize))) >= 0.0f)
-			continue;
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter - xSize), (yCenter + ySize), (zCenter + zSize))) >= 0.0f)
-			continue;
-		if (WPlaneDotCoord(m_frustumPlanes[i], WVector3((xCenter + xSize), (yCenter + ySize), (zCenter + zSize))) >= 0.0f)
-			continue;
-
-		return false;
+		const WPlane& p = m_frustumPlanes[i];
+		float r = std::abs(p.a) * xSize + std::abs(p.b) * ySize + std::abs(p.c) * zSize;
+		if (WPlaneDotCoord(p, WVector3(xCenter, yCenter, zCenter)) + r < 0.0f)
+			return false;
 	}
 
 	return true;
@@ -218,6 +316,24 @@ bool WCamera::CheckBoxInFrustum(WVector3 center, WVector3 size) const {
 	return CheckBoxInFrustum(center.x, center.y, center.z, size.x, size.y, size.z);
 }
 
+void WCamera::CheckBoxesInFrustum(const W_BOUNDING_BOXES& boxes, std::vector<uint32_t>& visible, std::vector<uint8_t>* planeCache) const {
+	CullBatch<true>(m_frustumPlanes, boxes.Size(),
+		boxes.centerX.data(), boxes.centerY.data(), boxes.centerZ.data(),
+		boxes.extentX.data(), boxes.extentY.data(), boxes.extentZ.data(),
+		visible, planeCache);
+}
+
+void WCamera::CheckSpheresInFrustum(const W_BOUNDING_SPHERES& spheres, std::vector<uint32_t>& visible, std::vector<uint8_t>* planeCache) const {
+	CullBatch<false>(m_frustumPlanes, spheres.Size(),
+		spheres.centerX.data(), spheres.centerY.data(), spheres.centerZ.data(),
+		spheres.radius.data(), nullptr, nullptr,
+		visible, planeCache);
+}
+
+const WPlane* WCamera::GetFrustumPlanes() const {
+	return m_frustumPlanes;
+}
+
 void WCamera::OnStateChange(STATE_CHANGE_TYPE type) {
 	WOrientation::OnStateChange(type); //do the default OnStateChange first
 	m_bAltered = true;
@@ -227,10 +343,11 @@ void WCamera::UpdateInternals() {
 	if (m_bAltered) {
 		m_bAltered = false;
 
-		m_ViewM = ComputeInverseTransformation(); // the view matrix is the inverse of the world matrix/transformation
-
+		// the view matrix is the inverse of the world matrix/transformation
 		if (IsBound())
-			m_ViewM *= GetBindingMatrix();
+			m_ViewM = WMatrixInverseAffine(ComputeWorldTransformation());
+		else
+			m_ViewM = ComputeInverseTransformation();
 
 		//build projection matrix
 		m_orthoMatrix = WOrthogonalProjMatrix((float)m_lastWidth, (float)m_lastHeight, m_minRange, m_maxRange);
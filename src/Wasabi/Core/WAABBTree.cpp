@@ -0,0 +1,382 @@
+#include "Wasabi/Core/WAABBTree.hpp"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace {
+	inline WVector3 Min(const WVector3& a, const WVector3& b) {
+		return WVector3(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
+	}
+
+	inline WVector3 Max(const WVector3& a, const WVector3& b) {
+		return WVector3(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
+	}
+
+	inline float Area(const WVector3& min, const WVector3& max) {
+		WVector3 e = max - min;
+		return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+
+	inline bool Contains(const WVector3& outerMin, const WVector3& outerMax, const WVector3& min, const WVector3& max) {
+		return outerMin.x <= min.x && outerMin.y <= min.y && outerMin.z <= min.z &&
+			max.x <= outerMax.x && max.y <= outerMax.y && max.z <= outerMax.z;
+	}
+
+	/** Size of the traversal stacks, an AVL-balanced tree of 2^32 leaves is shallower than this */
+	const uint32_t QUERY_STACK_SIZE = 64;
+};
+
+WAABBTree::WAABBTree(float margin) {
+	m_margin = margin;
+	Clear();
+}
+
+WAABBTree::~WAABBTree() {
+}
+
+uint32_t WAABBTree::CreateProxy(const WVector3& min, const WVector3& max, void* userData) {
+	uint32_t proxy = _AllocateNode();
+	_SetFatBox(proxy, min, max);
+	m_nodes[proxy].userData = userData;
+	m_nodes[proxy].height = 0;
+	_InsertLeaf(proxy);
+	m_proxyCount++;
+	return proxy;
+}
+
+void WAABBTree::DestroyProxy(uint32_t proxy) {
+	if (proxy >= m_nodes.size() || !m_nodes[proxy].IsLeaf() || m_nodes[proxy].height != 0)
+		return;
+
+	_RemoveLeaf(proxy);
+	_FreeNode(proxy);
+	m_proxyCount--;
+}
+
+bool WAABBTree::MoveProxy(uint32_t proxy, const WVector3& min, const WVector3& max) {
+	if (proxy >= m_nodes.size() || !m_nodes[proxy].IsLeaf() || m_nodes[proxy].height != 0)
+		return false;
+
+	NODE& node = m_nodes[proxy];
+	if (Contains(node.min, node.max, min, max)) {
+		// still inside the fat box, unless it shrank a lot (then the fat box would be too loose)
+		WVector3 fatSize = node.max - node.min;
+		WVector3 size = (max - min) * (1.0f + 4.0f * m_margin);
+		if (size.x >= fatSize.x * 0.5f || size.y >= fatSize.y * 0.5f || size.z >= fatSize.z * 0.5f)
+			return false;
+	}
+
+	_RemoveLeaf(proxy);
+	_SetFatBox(proxy, min, max);
+	_InsertLeaf(proxy);
+	return true;
+}
+
+void* WAABBTree::GetUserData(uint32_t proxy) const {
+	if (proxy >= m_nodes.size())
+		return nullptr;
+	return m_nodes[proxy].userData;
+}
+
+void WAABBTree::Clear() {
+	m_nodes.clear();
+	m_root = NULL_PROXY;
+	m_freeList = NULL_PROXY;
+	m_proxyCount = 0;
+}
+
+template<typename TestT>
+void WAABBTree::_Query(TestT test, const QueryCallback& callback) const {
+	if (m_root == NULL_PROXY)
+		return;
+
+	uint32_t stack[QUERY_STACK_SIZE];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = m_root;
+	while (stackSize > 0) {
+		const NODE& node = m_nodes[stack[--stackSize]];
+		if (!test(node.min, node.max))
+			continue;
+
+		if (node.IsLeaf()) {
+			if (!callback(node.userData))
+				return;
+		} else {
+			stack[stackSize++] = node.child1;
+			stack[stackSize++] = node.child2;
+		}
+	}
+}
+
+void WAABBTree::QueryBox(const WVector3& min, const WVector3& max, const QueryCallback& callback) const {
+	_Query([&min, &max](const WVector3& nodeMin, const WVector3& nodeMax) {
+		return nodeMin.x <= max.x && nodeMin.y <= max.y && nodeMin.z <= max.z &&
+			min.x <= nodeMax.x && min.y <= nodeMax.y && min.z <= nodeMax.z;
+	}, callback);
+}
+
+void WAABBTree::QuerySphere(const WVector3& center, float radius, const QueryCallback& callback) const {
+	float radiusSq = radius * radius;
+	_Query([&center, radiusSq](const WVector3& nodeMin, const WVector3& nodeMax) {
+		// distance from the center to the closest point of the box
+		WVector3 closest = Max(nodeMin, Min(center, nodeMax));
+		return WVec3LengthSq(closest - center) <= radiusSq;
+	}, callback);
+}
+
+void WAABBTree::QueryRay(const WVector3& origin, const WVector3& direction, const QueryCallback& callback) const {
+	// a tiny direction component (instead of 0) keeps the slab test free of NaNs
+	WVector3 invDir;
+	for (uint32_t i = 0; i < 3; i++) {
+		float d = direction.components[i];
+		if (std::abs(d) < 1e-20f)
+			d = d < 0.0f ? -1e-20f : 1e-20f;
+		invDir.components[i] = 1.0f / d;
+	}
+
+	_Query([&origin, &invDir](const WVector3& nodeMin, const WVector3& nodeMax) {
+		float tmin = 0.0f, tmax = FLT_MAX;
+		for (uint32_t i = 0; i < 3; i++) {
+			float t1 = (nodeMin.components[i] - origin.components[i]) * invDir.components[i];
+			float t2 = (nodeMax.components[i] - origin.components[i]) * invDir.components[i];
+			tmin = std::max(tmin, std::min(t1, t2));
+			tmax = std::min(tmax, std::max(t1, t2));
+		}
+		return tmin <= tmax;
+	}, callback);
+}
+
+void WAABBTree::QueryPlanes(const WPlane* planes, uint32_t numPlanes, const QueryCallback& callback) const {
+	if (m_root == NULL_PROXY)
+		return;
+
+	// every stack entry records whether the subtree is already known to be entirely inside
+	struct ENTRY {
+		uint32_t node;
+		bool inside;
+	} stack[QUERY_STACK_SIZE];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { m_root, false };
+	while (stackSize > 0) {
+		ENTRY entry = stack[--stackSize];
+		const NODE& node = m_nodes[entry.node];
+
+		if (!entry.inside) {
+			entry.inside = true;
+			bool outside = false;
+			for (uint32_t i = 0; i < numPlanes && !outside; i++) {
+				const WPlane& p = planes[i];
+				// the corner furthest along the plane normal decides if the box is outside,
+				// and the nearest corner decides if the box is entirely inside
+				WVector3 farCorner(p.a >= 0.0f ? node.max.x : node.min.x, p.b >= 0.0f ? node.max.y : node.min.y, p.c >= 0.0f ? node.max.z : node.min.z);
+				WVector3 nearCorner(p.a >= 0.0f ? node.min.x : node.max.x, p.b >= 0.0f ? node.min.y : node.max.y, p.c >= 0.0f ? node.min.z : node.max.z);
+				if (WPlaneDotCoord(p, farCorner) < 0.0f)
+					outside = true;
+				else if (WPlaneDotCoord(p, nearCorner) < 0.0f)
+					entry.inside = false;
+			}
+			if (outside)
+				continue;
+		}
+
+		if (node.IsLeaf()) {
+			if (!callback(node.userData))
+				return;
+		} else {
+			stack[stackSize++] = { node.child1, entry.inside };
+			stack[stackSize++] = { node.child2, entry.inside };
+		}
+	}
+}
+
+uint32_t WAABBTree::GetProxyCount() const {
+	return m_proxyCount;
+}
+
+uint32_t WAABBTree::GetHeight() const {
+	if (m_root == NULL_PROXY)
+		return 0;
+	return (uint32_t)m_nodes[m_root].height;
+}
+
+uint32_t WAABBTree::_AllocateNode() {
+	uint32_t node;
+	if (m_freeList != NULL_PROXY) {
+		node = m_freeList;
+		m_freeList = m_nodes[node].parent;
+	} else {
+		node = (uint32_t)m_nodes.size();
+		m_nodes.push_back(NODE());
+	}
+	m_nodes[node].userData = nullptr;
+	m_nodes[node].parent = NULL_PROXY;
+	m_nodes[node].child1 = NULL_PROXY;
+	m_nodes[node].child2 = NULL_PROXY;
+	m_nodes[node].height = 0;
+	return node;
+}
+
+void WAABBTree::_FreeNode(uint32_t node) {
+	m_nodes[node].parent = m_freeList;
+	m_nodes[node].child1 = NULL_PROXY;
+	m_nodes[node].height = -1;
+	m_freeList = node;
+}
+
+void WAABBTree::_SetFatBox(uint32_t leaf, const WVector3& min, const WVector3& max) {
+	WVector3 margin = (max - min) * m_margin;
+	m_nodes[leaf].min = min - margin;
+	m_nodes[leaf].max = max + margin;
+}
+
+void WAABBTree::_InsertLeaf(uint32_t leaf) {
+	if (m_root == NULL_PROXY) {
+		m_root = leaf;
+		m_nodes[leaf].parent = NULL_PROXY;
+		return;
+	}
+
+	//
+	// Descend to the sibling that minimizes the added surface area
+	//
+	WVector3 leafMin = m_nodes[leaf].min, leafMax = m_nodes[leaf].max;
+	uint32_t sibling = m_root;
+	while (!m_nodes[sibling].IsLeaf()) {
+		const NODE& node = m_nodes[sibling];
+		float area = Area(node.min, node.max);
+		float combinedArea = Area(Min(node.min, leafMin), Max(node.max, leafMax));
+
+		// cost of making a new parent for this node and the leaf, and the minimum cost of pushing the leaf further down
+		float cost = 2.0f * combinedArea;
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCosts[2];
+		uint32_t children[2] = { node.child1, node.child2 };
+		for (uint32_t i = 0; i < 2; i++) {
+			const NODE& child = m_nodes[children[i]];
+			float newArea = Area(Min(child.min, leafMin), Max(child.max, leafMax));
+			if (child.IsLeaf())
+				childCosts[i] = newArea + inheritanceCost;
+			else
+				childCosts[i] = (newArea - Area(child.min, child.max)) + inheritanceCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+			break;
+		sibling = childCosts[0] < childCosts[1] ? children[0] : children[1];
+	}
+
+	//
+	// Create a new parent for the sibling and the leaf
+	//
+	uint32_t oldParent = m_nodes[sibling].parent;
+	uint32_t newParent = _AllocateNode();
+	NODE& parent = m_nodes[newParent];
+	parent.parent = oldParent;
+	parent.min = Min(leafMin, m_nodes[sibling].min);
+	parent.max = Max(leafMax, m_nodes[sibling].max);
+	parent.height = m_nodes[sibling].height + 1;
+	parent.child1 = sibling;
+	parent.child2 = leaf;
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	if (oldParent == NULL_PROXY)
+		m_root = newParent;
+	else if (m_nodes[oldParent].child1 == sibling)
+		m_nodes[oldParent].child1 = newParent;
+	else
+		m_nodes[oldParent].child2 = newParent;
+
+	_RefitAncestors(m_nodes[leaf].parent);
+}
+
+void WAABBTree::_RemoveLeaf(uint32_t leaf) {
+	if (leaf == m_root) {
+		m_root = NULL_PROXY;
+		return;
+	}
+
+	uint32_t parent = m_nodes[leaf].parent;
+	uint32_t grandParent = m_nodes[parent].parent;
+	uint32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+	// the sibling takes the parent's place
+	if (grandParent == NULL_PROXY) {
+		m_root = sibling;
+		m_nodes[sibling].parent = NULL_PROXY;
+	} else {
+		if (m_nodes[grandParent].child1 == parent)
+			m_nodes[grandParent].child1 = sibling;
+		else
+			m_nodes[grandParent].child2 = sibling;
+		m_nodes[sibling].parent = grandParent;
+	}
+	_FreeNode(parent);
+	m_nodes[leaf].parent = NULL_PROXY;
+
+	if (grandParent != NULL_PROXY)
+		_RefitAncestors(grandParent);
+}
+
+void WAABBTree::_RefitAncestors(uint32_t node) {
+	while (node != NULL_PROXY) {
+		node = _Balance(node);
+
+		NODE& n = m_nodes[node];
+		const NODE& child1 = m_nodes[n.child1];
+		const NODE& child2 = m_nodes[n.child2];
+		n.height = 1 + std::max(child1.height, child2.height);
+		n.min = Min(child1.min, child2.min);
+		n.max = Max(child1.max, child2.max);
+
+		node = n.parent;
+	}
+}
+
+uint32_t WAABBTree::_Balance(uint32_t a) {
+	// rotates the taller child of a up if the subtree is unbalanced, returns the new root of the subtree
+	NODE& A = m_nodes[a];
+	if (A.IsLeaf() || A.height < 2)
+		return a;
+
+	uint32_t b = A.child1;
+	uint32_t c = A.child2;
+	int32_t balance = m_nodes[c].height - m_nodes[b].height;
+	if (balance >= -1 && balance <= 1)
+		return a;
+
+	// the taller child (up) takes a's place, a adopts up's shorter child
+	uint32_t up = balance > 1 ? c : b;
+	uint32_t other = balance > 1 ? b : c;
+	NODE& U = m_nodes[up];
+	uint32_t f = U.child1;
+	uint32_t g = U.child2;
+
+	U.child1 = a;
+	U.parent = A.parent;
+	A.parent = up;
+	if (U.parent == NULL_PROXY)
+		m_root = up;
+	else if (m_nodes[U.parent].child1 == a)
+		m_nodes[U.parent].child1 = up;
+	else
+		m_nodes[U.parent].child2 = up;
+
+	// keep the taller grandchild under up, give the other one to a
+	uint32_t keep = m_nodes[f].height > m_nodes[g].height ? f : g;
+	uint32_t give = keep == f ? g : f;
+	U.child2 = keep;
+	A.child1 = other;
+	A.child2 = give;
+	m_nodes[give].parent = a;
+
+	A.min = Min(m_nodes[other].min, m_nodes[give].min);
+	A.max = Max(m_nodes[other].max, m_nodes[give].max);
+	A.height = 1 + std::max(m_nodes[other].height, m_nodes[give].height);
+	U.min = Min(A.min, m_nodes[keep].min);
+	U.max = Max(A.max, m_nodes[keep].max);
+	U.height = 1 + std::max(A.height, m_nodes[keep].height);
+
+	return up;
+}
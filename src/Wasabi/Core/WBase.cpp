@@ -1,12 +1,16 @@
 #include "Wasabi/Core/WBase.hpp"
 #include "Wasabi/Core/WManager.hpp"
 
+#include <atomic>
+
 /********************************************************************************
 ***********************************WBase class**********************************
 ********************************************************************************/
 WBase::WBase(Wasabi* const app, uint32_t ID) {
 	static uint32_t generatedId = 1;
+	static std::atomic<uint64_t> nextUniqueID(1);
 	m_ID = ID;
+	m_uniqueID = nextUniqueID.fetch_add(1, std::memory_order_relaxed);
 	m_name = "object" + std::to_string(generatedId++);
 	m_app = app;
 	m_refCount = 1;
@@ -19,6 +23,10 @@ uint32_t WBase::GetID() const {
 	return m_ID;
 }
 
+uint64_t WBase::GetUniqueID() const {
+	return m_uniqueID;
+}
+
 Wasabi* WBase::GetAppPtr() const {
 	//get a pointer to the main core of the object
 	return m_app;
@@ -0,0 +1,323 @@
+#include "Wasabi/Core/WCPUProfiler.hpp"
+#include "Wasabi/Core/WUtilities.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <cfloat>
+
+namespace {
+	/** Source of the profilers' unique IDs */
+	std::atomic<uint64_t> g_nextProfilerId(1);
+
+	/** Buffer of the calling thread in the profiler that last recorded a zone on it */
+	struct THREAD_CACHE {
+		uint64_t profilerId;
+		void* buffer;
+	};
+	thread_local THREAD_CACHE t_threadCache = { 0, nullptr };
+
+	uint32_t RoundUpToPowerOf2(uint32_t v) {
+		uint32_t p = 1;
+		while (p < v && p < 0x80000000)
+			p <<= 1;
+		return p;
+	}
+};
+
+WCPUProfiler::WCPUProfiler() {
+	m_id = g_nextProfilerId++;
+	m_enabled = false;
+	m_frameStart = Now();
+	m_frameCounter = 0;
+	m_recordedFrames = 0;
+	m_nextFrame = 0;
+	m_droppedZones = 0;
+	Configure(4096, 1000, 300);
+}
+
+WCPUProfiler::~WCPUProfiler() {
+	_DestroyThreadBuffers();
+}
+
+void WCPUProfiler::Configure(uint32_t threadBufferSize, uint32_t window, uint32_t traceFrames) {
+	std::lock_guard<std::mutex> lock(m_threadsMutex);
+	m_threadBufferSize = RoundUpToPowerOf2(std::max(threadBufferSize, 2u));
+	m_window = std::max(window, 1u);
+	m_traceFrames = traceFrames;
+
+	// threads that already have a buffer keep it, the statistics restart with the new window
+	m_frameTimes.assign(m_window, 0.0);
+	m_frameNumbers.assign(m_window, 0);
+	m_nextFrame = 0;
+	m_recordedFrames = 0;
+	for (auto& zone : m_zones) {
+		zone.times.assign(m_window, 0.0);
+		zone.calls.assign(m_window, 0);
+	}
+	while (m_traceHistory.size() > m_traceFrames)
+		m_traceHistory.pop_front();
+}
+
+void WCPUProfiler::SetEnabled(bool enable) {
+	m_enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool WCPUProfiler::IsEnabled() const {
+	return m_enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t WCPUProfiler::Now() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void WCPUProfiler::BeginFrame() {
+	m_frameStart = Now();
+}
+
+void WCPUProfiler::EndFrame() {
+	if (!IsEnabled())
+		return;
+
+	uint64_t frameEnd = Now();
+	uint64_t frameNumber = m_frameCounter++;
+
+	// collect the zones written by every thread since the last frame
+	m_collected.clear();
+	{
+		std::lock_guard<std::mutex> lock(m_threadsMutex);
+		for (auto buffer : m_threads) {
+			uint64_t size = buffer->events.size();
+			uint64_t mask = size - 1;
+			uint64_t head = buffer->head.load(std::memory_order_acquire);
+			uint64_t first = std::max(buffer->tail, head > size ? head - size : 0);
+			m_droppedZones += first - buffer->tail;
+
+			size_t numCollected = m_collected.size();
+			for (uint64_t i = first; i < head; i++) {
+				const ZONE_EVENT& event = buffer->events[i & mask];
+				m_collected.push_back(TRACE_EVENT({ event.name, event.start, event.end, buffer->threadIndex }));
+			}
+
+			// the owning thread may have wrapped around the ring while it was being read
+			uint64_t newHead = buffer->head.load(std::memory_order_acquire);
+			if (newHead > size && newHead - size > first) {
+				uint64_t numOverwritten = std::min(newHead - size, head) - first;
+				m_collected.erase(m_collected.begin() + numCollected, m_collected.begin() + numCollected + (size_t)numOverwritten);
+				m_droppedZones += numOverwritten;
+			}
+			buffer->tail = head;
+		}
+	}
+
+	uint32_t slot = m_nextFrame;
+	m_nextFrame = (m_nextFrame + 1) % m_window;
+	m_recordedFrames++;
+	m_frameTimes[slot] = (double)(frameEnd - m_frameStart) / 1000000.0;
+	m_frameNumbers[slot] = frameNumber;
+
+	for (const TRACE_EVENT& event : m_collected) {
+		ZONE_SAMPLES& zone = m_zones[_GetZoneIndex(event.name)];
+		zone.frameTime += event.end - event.start;
+		zone.frameCalls++;
+	}
+	for (auto& zone : m_zones) {
+		zone.times[slot] = (double)zone.frameTime / 1000000.0;
+		zone.calls[slot] = zone.frameCalls;
+		zone.frameTime = 0;
+		zone.frameCalls = 0;
+	}
+
+	if (m_traceFrames > 0) {
+		TRACE_FRAME frame;
+		if (m_traceHistory.size() >= m_traceFrames) {
+			frame = std::move(m_traceHistory.front()); // reuse the oldest frame's memory
+			m_traceHistory.pop_front();
+		}
+		frame.frameNumber = frameNumber;
+		frame.start = m_frameStart;
+		frame.end = frameEnd;
+		frame.events.assign(m_collected.begin(), m_collected.end());
+		m_traceHistory.push_back(std::move(frame));
+	}
+}
+
+bool WCPUProfiler::GetFrameStatistics(W_CPU_FRAME_STATS* stats) const {
+	uint32_t numFrames = (uint32_t)std::min((uint64_t)m_window, m_recordedFrames);
+	if (numFrames == 0)
+		return false;
+
+	std::vector<double> sorted(numFrames);
+	double total = 0.0;
+	uint32_t slowest = 0;
+	for (uint32_t i = 0; i < numFrames; i++) {
+		sorted[i] = m_frameTimes[i];
+		total += m_frameTimes[i];
+		if (m_frameTimes[i] > m_frameTimes[slowest])
+			slowest = i;
+	}
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&sorted](double p) {
+		return sorted[std::min((size_t)(p * (double)sorted.size()), sorted.size() - 1)];
+	};
+
+	stats->averageMs = total / (double)numFrames;
+	stats->minMs = sorted.front();
+	stats->medianMs = percentile(0.5);
+	stats->p95Ms = percentile(0.95);
+	stats->p99Ms = percentile(0.99);
+	stats->maxMs = sorted.back();
+	stats->slowestFrame = m_frameNumbers[slowest];
+	stats->numFrames = numFrames;
+	stats->droppedZones = m_droppedZones;
+	return true;
+}
+
+bool WCPUProfiler::GetZoneStatistics(const std::string& zoneName, W_CPU_ZONE_STATS* stats) const {
+	auto it = m_zoneIndices.find(zoneName);
+	uint32_t numFrames = (uint32_t)std::min((uint64_t)m_window, m_recordedFrames);
+	if (it == m_zoneIndices.end() || numFrames == 0)
+		return false;
+
+	const ZONE_SAMPLES& zone = m_zones[it->second];
+	double totalTime = 0.0, totalCalls = 0.0;
+	stats->maxMs = 0.0;
+	for (uint32_t i = 0; i < numFrames; i++) {
+		totalTime += zone.times[i];
+		totalCalls += (double)zone.calls[i];
+		stats->maxMs = std::max(stats->maxMs, zone.times[i]);
+	}
+	stats->averageMs = totalTime / (double)numFrames;
+	stats->averageCalls = totalCalls / (double)numFrames;
+	stats->lastMs = zone.times[(m_nextFrame + m_window - 1) % m_window];
+	stats->numFrames = numFrames;
+	return true;
+}
+
+std::vector<std::pair<std::string, W_CPU_ZONE_STATS>> WCPUProfiler::GetAllZoneStatistics() const {
+	std::vector<std::pair<std::string, W_CPU_ZONE_STATS>> allStats;
+	allStats.reserve(m_zoneIndices.size());
+	for (auto it = m_zoneIndices.begin(); it != m_zoneIndices.end(); it++) {
+		W_CPU_ZONE_STATS stats;
+		if (GetZoneStatistics(it->first, &stats))
+			allStats.push_back(std::make_pair(it->first, stats));
+	}
+	return allStats;
+}
+
+void WCPUProfiler::ResetStatistics() {
+	m_recordedFrames = 0;
+	m_nextFrame = 0;
+	m_droppedZones = 0;
+	m_frameTimes.assign(m_window, 0.0);
+	m_frameNumbers.assign(m_window, 0);
+	m_zones.clear();
+	m_zoneNamePointers.clear();
+	m_zoneIndices.clear();
+	m_traceHistory.clear();
+}
+
+WError WCPUProfiler::WriteTrace(std::string filename) const {
+	std::ofstream file(filename, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+		return WError(W_FILENOTFOUND);
+
+	uint64_t epoch = m_traceHistory.size() > 0 ? m_traceHistory.front().start : 0;
+	uint32_t maxThreadIndex = 0;
+	for (const TRACE_FRAME& frame : m_traceHistory) {
+		for (const TRACE_EVENT& event : frame.events) {
+			maxThreadIndex = std::max(maxThreadIndex, event.threadIndex);
+			epoch = std::min(epoch, event.start);
+		}
+	}
+
+	// frames go on track 0, the zones of thread i on track i + 1
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"tid\":0,\"args\":{\"name\":\"Wasabi CPU\"}}";
+	file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":0,\"args\":{\"name\":\"Frames\"}}";
+	for (uint32_t i = 0; i <= maxThreadIndex; i++)
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":" << (i + 1) << ",\"args\":{\"name\":\"Thread " << i << "\"}}";
+
+	file.precision(3);
+	file << std::fixed;
+	for (const TRACE_FRAME& frame : m_traceHistory) {
+		file << ",\n{\"name\":\"Frame\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":2,\"tid\":0"
+			<< ",\"ts\":" << (double)(frame.start - epoch) / 1000.0 << ",\"dur\":" << (double)(frame.end - frame.start) / 1000.0
+			<< ",\"args\":{\"frame\":" << frame.frameNumber << "}}";
+		for (const TRACE_EVENT& event : frame.events) {
+			file << ",\n{\"name\":\"" << WUtil::EscapeJSON(event.name) << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":2,\"tid\":" << (event.threadIndex + 1)
+				<< ",\"ts\":" << (double)(event.start - epoch) / 1000.0 << ",\"dur\":" << (double)(event.end - event.start) / 1000.0 << "}";
+		}
+	}
+	file << "\n]}\n";
+
+	return file.good() ? WError(W_SUCCEEDED) : WError(W_ERRORUNK);
+}
+
+WCPUProfiler::THREAD_BUFFER* WCPUProfiler::_GetThreadBuffer() {
+	if (t_threadCache.profilerId == m_id)
+		return (THREAD_BUFFER*)t_threadCache.buffer;
+
+	// first zone of this thread (or the thread last recorded to another profiler)
+	std::lock_guard<std::mutex> lock(m_threadsMutex);
+	std::thread::id threadId = std::this_thread::get_id();
+	THREAD_BUFFER* buffer = nullptr;
+	for (auto b : m_threads) {
+		if (b->threadId == threadId) {
+			buffer = b;
+			break;
+		}
+	}
+	if (!buffer) {
+		buffer = new THREAD_BUFFER();
+		buffer->threadId = threadId;
+		buffer->threadIndex = (uint32_t)m_threads.size();
+		buffer->events.resize(m_threadBufferSize);
+		buffer->head = 0;
+		buffer->tail = 0;
+		m_threads.push_back(buffer);
+	}
+	t_threadCache.profilerId = m_id;
+	t_threadCache.buffer = buffer;
+	return buffer;
+}
+
+void WCPUProfiler::_RecordZone(const char* name, uint64_t start, uint64_t end) {
+	THREAD_BUFFER* buffer = _GetThreadBuffer();
+	uint64_t head = buffer->head.load(std::memory_order_relaxed);
+	ZONE_EVENT& event = buffer->events[head & (buffer->events.size() - 1)];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	buffer->head.store(head + 1, std::memory_order_release);
+}
+
+uint32_t WCPUProfiler::_GetZoneIndex(const char* name) {
+	auto it = m_zoneNamePointers.find(name);
+	if (it != m_zoneNamePointers.end())
+		return it->second;
+
+	uint32_t index;
+	auto nameIt = m_zoneIndices.find(name);
+	if (nameIt != m_zoneIndices.end())
+		index = nameIt->second;
+	else {
+		index = (uint32_t)m_zones.size();
+		ZONE_SAMPLES zone;
+		zone.times.assign(m_window, 0.0);
+		zone.calls.assign(m_window, 0);
+		zone.frameTime = 0;
+		zone.frameCalls = 0;
+		m_zones.push_back(std::move(zone));
+		m_zoneIndices.insert(std::make_pair(std::string(name), index));
+	}
+	m_zoneNamePointers.insert(std::make_pair(name, index));
+	return index;
+}
+
+void WCPUProfiler::_DestroyThreadBuffers() {
+	std::lock_guard<std::mutex> lock(m_threadsMutex);
+	for (auto buffer : m_threads)
+		delete buffer;
+	m_threads.clear();
+}
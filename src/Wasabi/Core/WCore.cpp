@@ -20,12 +20,77 @@
 #include "Wasabi/Terrains/WTerrain.hpp"
 
 #include "Wasabi/WindowAndInput/GLFW/WGLFWWindowAndInputComponent.hpp"
+#include "Wasabi/WindowAndInput/Headless/WHeadlessWindowAndInputComponent.hpp"
 
 #include <mutex>
+#include <fstream>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+namespace stdfs = std::filesystem;
 
 std::mutex gStartEngineMutex;
 static std::vector<std::function<void()>> g_cleanupCalls;
 
+/** Identifies a pipeline cache file written by the engine ("WPCF") */
+#define W_PIPELINE_CACHE_MAGIC 0x46435057
+/** Version of the pipeline cache file format */
+#define W_PIPELINE_CACHE_VERSION 1
+/** Pipeline cache files claiming a bigger size are considered corrupt */
+#define W_PIPELINE_CACHE_MAX_SIZE (256ull * 1024 * 1024)
+
+/** Header of the pipeline cache file, followed by dataSize bytes of vkGetPipelineCacheData() */
+struct PIPELINE_CACHE_FILE_HEADER {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	uint64_t dataSize;
+	uint64_t dataHash;
+};
+
+/** Layout of the header Vulkan puts at the start of pipeline cache data (VK_PIPELINE_CACHE_HEADER_VERSION_ONE) */
+struct VK_PIPELINE_CACHE_HEADER {
+	uint32_t headerSize;
+	uint32_t headerVersion;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+/** FNV-1a hash of pipeline cache data, to detect truncated or corrupted files */
+static uint64_t HashPipelineCacheData(const std::vector<char>& data) {
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : data) {
+		hash ^= (uint8_t)c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+/** Per-user directory applications cache data in, empty if the environment doesn't say */
+static stdfs::path GetUserCacheDirectory() {
+#if defined(_WIN32)
+	const char* localAppData = getenv("LOCALAPPDATA");
+	if (localAppData && localAppData[0])
+		return stdfs::path(localAppData);
+#elif defined(__APPLE__)
+	const char* home = getenv("HOME");
+	if (home && home[0])
+		return stdfs::path(home) / "Library" / "Caches";
+#else
+	const char* cacheHome = getenv("XDG_CACHE_HOME");
+	if (cacheHome && cacheHome[0])
+		return stdfs::path(cacheHome);
+	const char* home = getenv("HOME");
+	if (home && home[0])
+		return stdfs::path(home) / ".cache";
+#endif
+	return stdfs::path();
+}
+
 #ifdef _WIN32
 #include <Windows.h>
 int main();
@@ -52,10 +117,46 @@ void WRegisterGlobalCleanup(std::function<void()> fun) {
 	g_cleanupCalls.push_back(fun);
 }
 
+/**
+ * Prints a summary of the frame times (in milliseconds) recorded by a run with
+ * a "maxFrames" limit, and of the CPU and GPU profilers' zones if they are
+ * enabled.
+ */
+static void PrintFrameTimes(Wasabi* app, std::vector<double> frameTimes) {
+	if (frameTimes.size() == 0)
+		return;
+
+	double total = 0.0;
+	for (double t : frameTimes)
+		total += t;
+	std::sort(frameTimes.begin(), frameTimes.end());
+	auto percentile = [&frameTimes](double p) {
+		return frameTimes[std::min((size_t)(p * (double)frameTimes.size()), frameTimes.size() - 1)];
+	};
+
+	printf("%s: %zu frames in %.2f ms, avg %.3f ms, min %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+		app->GetEngineParam<const char*>("appName", "Wasabi"), frameTimes.size(), total, total / (double)frameTimes.size(),
+		frameTimes.front(), percentile(0.5), percentile(0.95), percentile(0.99), frameTimes.back());
+
+	if (app->CPUProfiler->IsEnabled()) {
+		for (auto zone : app->CPUProfiler->GetAllZoneStatistics())
+			printf("  CPU %s: avg %.3f ms, max %.3f ms, %.1f calls\n", zone.first.c_str(), zone.second.averageMs, zone.second.maxMs, zone.second.averageCalls);
+	}
+	if (app->Renderer && app->Renderer->GetGPUProfiler()->IsEnabled()) {
+		for (auto scope : app->Renderer->GetGPUProfiler()->GetAllStatistics())
+			printf("  GPU %s: avg %.3f ms, min %.3f ms, max %.3f ms\n", scope.first.c_str(), scope.second.averageMs, scope.second.minMs, scope.second.maxMs);
+	}
+}
+
 int RunWasabi(Wasabi* app) {
+	int ret = 0;
 	if (app) {
 		app->Timer.Start();
+		std::vector<double> frameTimes;
 		if (app->Setup()) {
+			uint32_t maxFrames = app->GetEngineParam<uint32_t>("maxFrames");
+			bool headless = app->GetEngineParam<bool>("headless");
+			frameTimes.reserve(maxFrames);
 			uint32_t numFrames = 0;
 			auto fpsTimer = std::chrono::high_resolution_clock::now();
 			float maxFPSReached = app->maxFPS > 0.001f ? app->maxFPS : 60.0f;
@@ -64,28 +165,48 @@ int RunWasabi(Wasabi* app) {
 			while (!app->__EXIT) {
 				auto tStart = std::chrono::high_resolution_clock::now();
 				app->Timer.GetElapsedTime(true); // record elapsed time
+				app->CPUProfiler->BeginFrame();
 
-				if (app->WindowAndInputComponent && !app->WindowAndInputComponent->Loop())
+				bool windowActive = true;
+				if (app->WindowAndInputComponent) {
+					W_PROFILE_ZONE(app, "Input");
+					windowActive = app->WindowAndInputComponent->Loop();
+				}
+				if (!windowActive)
 					continue;
 
 				if (deltaTime >= 0.00001f) {
-					if (!app->Loop(deltaTime))
-						break;
-					if (app->curState)
+					{
+						W_PROFILE_ZONE(app, "Loop");
+						if (!app->Loop(deltaTime))
+							break;
+					}
+					if (app->curState) {
+						W_PROFILE_ZONE(app, "StateUpdate");
 						app->curState->Update(deltaTime);
-					if (app->PhysicsComponent)
+					}
+					if (app->PhysicsComponent) {
+						W_PROFILE_ZONE(app, "PhysicsStep");
 						app->PhysicsComponent->Step(deltaTime);
+					}
 				}
 
 				if (app->AnimationManager)
 					app->AnimationManager->Update(deltaTime);
+				app->TransformHierarchy->Update();
 				if (app->Renderer)
 					app->Renderer->Render();
 
+				app->CPUProfiler->EndFrame();
 				numFrames++;
 
 				auto tEnd = std::chrono::high_resolution_clock::now();
 				auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
+				if (maxFrames > 0) {
+					frameTimes.push_back(tDiff);
+					if (frameTimes.size() >= maxFrames)
+						app->__EXIT = true;
+				}
 				deltaTime = (float)tDiff / 1000.0f;
 				maxFPSReached = fmax(maxFPSReached, 1.0f / deltaTime);
 
@@ -96,7 +217,7 @@ int RunWasabi(Wasabi* app) {
 					numFrames = 0;
 				}
 
-				if (app->maxFPS > 0.001) {
+				if (app->maxFPS > 0.001 && !headless) {
 					float maxDeltaTime = 1.0f / app->maxFPS; // delta time at max FPS
 					if (deltaTime < maxDeltaTime) {
 						auto sleepStart = std::chrono::high_resolution_clock::now();
@@ -111,11 +232,13 @@ int RunWasabi(Wasabi* app) {
 				} else
 					deltaTime = fmax(deltaTime, 1.0f / maxFPSReached); // dont let deltaTime be 0
 			}
-		}
+		} else
+			ret = 1;
+		PrintFrameTimes(app, frameTimes);
 		app->Cleanup();
 	}
 
-	return 0;
+	return ret;
 }
 
 VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDebugReportCallback(
@@ -148,9 +271,42 @@ Wasabi::Wasabi() : Timer(W_TIMER_SECONDS, true) {
 		{ "numGeneratedMips", (void*)(1) }, // int
 		{ "bufferingCount", (void*)(2) }, // int
 		{ "enableVulkanValidation", (void*)(true) }, // bool
+		{ "enableTransferQueue", (void*)(true) }, // bool
+		{ "enableAsyncCompute", (void*)(true) }, // bool
+		{ "uploadStagingSize", (void*)(16 * 1024 * 1024) }, // int
+		{ "frameRingSize", (void*)(4 * 1024 * 1024) }, // int
+		{ "pipelineCacheFile", (void*)"PipelineCache.bin" }, // LPCSTR
+		{ "pipelineCacheDirectory", (void*)nullptr }, // LPCSTR
+		{ "headless", (void*)(false) }, // bool
+		{ "headlessReadback", (void*)(false) }, // bool
+		{ "maxFrames", (void*)(0) }, // int
+		{ "enableGPUProfiler", (void*)(false) }, // bool
+		{ "gpuProfilerMaxScopes", (void*)(128) }, // int
+		{ "gpuProfilerWindow", (void*)(120) }, // int
+		{ "gpuProfilerTraceFrames", (void*)(300) }, // int
+		{ "enableCPUProfiler", (void*)(false) }, // bool
+		{ "cpuProfilerThreadBufferSize", (void*)(4096) }, // int
+		{ "cpuProfilerWindow", (void*)(1000) }, // int
+		{ "cpuProfilerTraceFrames", (void*)(300) }, // int
+		{ "numWorkerThreads", (void*)(-1) }, // int
+		{ "parallelRecording", (void*)(true) }, // bool
+		{ "indirectDrawing", (void*)(true) }, // bool
+		{ "gpuFrustumCulling", (void*)(true) }, // bool
+		{ "occlusionCulling", (void*)(true) }, // bool
+		{ "softwareOcclusionCulling", (void*)(false) }, // bool
 	};
+
+	// allows running any application headless for a fixed number of frames (e.g. on a build machine) without changing it
+	const char* headlessFrames = getenv("WASABI_HEADLESS_FRAMES");
+	if (headlessFrames && atoi(headlessFrames) > 0) {
+		SetEngineParam<bool>("headless", true);
+		SetEngineParam<int>("maxFrames", atoi(headlessFrames));
+	}
 	m_swapChainInitialized = false;
 
+	CPUProfiler = new WCPUProfiler();
+	JobSystem = new WJobSystem();
+	TransformHierarchy = new WTransformHierarchy(this);
 	MemoryManager = nullptr;
 	SoundComponent = nullptr;
 	WindowAndInputComponent = nullptr;
@@ -175,6 +331,11 @@ Wasabi::Wasabi() : Timer(W_TIMER_SECONDS, true) {
 
 	m_vkDevice = VK_NULL_HANDLE;
 	m_vkInstance = VK_NULL_HANDLE;
+	m_pipelineCache = VK_NULL_HANDLE;
+	m_graphicsQueueFamilyIndex = 0;
+	m_computeQueue = VK_NULL_HANDLE;
+	m_computeQueueFamilyIndex = 0;
+	m_vkCmdDrawIndexedIndirectCount = nullptr;
 
 	curState = nullptr;
 	__EXIT = false;
@@ -182,12 +343,17 @@ Wasabi::Wasabi() : Timer(W_TIMER_SECONDS, true) {
 }
 Wasabi::~Wasabi() {
 	_DestroyResources();
+	W_SAFE_DELETE(TransformHierarchy);
+	W_SAFE_DELETE(JobSystem);
+	W_SAFE_DELETE(CPUProfiler);
 }
 
 void Wasabi::_DestroyResources() {
 	if (m_vkDevice)
 		vkDeviceWaitIdle(m_vkDevice);
 
+	_SavePipelineCache();
+
 	if (WindowAndInputComponent)
 		WindowAndInputComponent->Cleanup();
 	if (Renderer)
@@ -218,6 +384,10 @@ void Wasabi::_DestroyResources() {
 
 	W_SAFE_DELETE(WindowAndInputComponent);
 
+	if (m_pipelineCache)
+		vkDestroyPipelineCache(m_vkDevice, m_pipelineCache, nullptr);
+	m_pipelineCache = VK_NULL_HANDLE;
+
 	if (m_swapChainInitialized)
 		m_swapChain.cleanup();
 	m_swapChainInitialized = false;
@@ -225,6 +395,8 @@ void Wasabi::_DestroyResources() {
 	if (m_vkDevice)
 		vkDestroyDevice(m_vkDevice, nullptr);
 	m_vkDevice = VK_NULL_HANDLE;
+	m_computeQueue = VK_NULL_HANDLE;
+	m_vkCmdDrawIndexedIndirectCount = nullptr;
 
 #if (defined(DEBUG) || defined(_DEBUG))
 	if (m_vkInstance) {
@@ -318,6 +490,17 @@ WError Wasabi::StartEngine(int width, int height) {
 
 	_DestroyResources();
 
+	CPUProfiler->Configure(
+		GetEngineParam<uint32_t>("cpuProfilerThreadBufferSize"),
+		GetEngineParam<uint32_t>("cpuProfilerWindow"),
+		GetEngineParam<uint32_t>("cpuProfilerTraceFrames"));
+	CPUProfiler->SetEnabled(GetEngineParam<bool>("enableCPUProfiler"));
+
+	int numWorkerThreads = GetEngineParam<int>("numWorkerThreads");
+	if (numWorkerThreads < 0)
+		numWorkerThreads = std::max((int)std::thread::hardware_concurrency() - 1, 0);
+	JobSystem->Configure((uint32_t)numWorkerThreads);
+
 	// This is created first so we can use its error message utility
 	WindowAndInputComponent = CreateWindowAndInputComponent();
 
@@ -362,24 +545,81 @@ WError Wasabi::StartEngine(int width, int height) {
 	if (graphicsQueueIndex == queueCount)
 		return WError(W_HARDWARENOTSUPPORTED);
 
+	// Find a queue family for uploads, preferring a transfer-only (DMA) family over an async compute one
+	uint32_t transferQueueIndex = queueCount;
+	if (GetEngineParam<bool>("enableTransferQueue", true)) {
+		for (uint32_t i = 0; i < queueCount; i++) {
+			VkQueueFlags flags = queueProps[i].queueFlags;
+			if (i == graphicsQueueIndex || !(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT))
+				continue;
+			if (transferQueueIndex == queueCount || !(flags & VK_QUEUE_COMPUTE_BIT))
+				transferQueueIndex = i;
+		}
+	}
+
+	// Find a queue family for async compute, preferring one that is not used for uploads. If it has to
+	// share the transfer family, it gets its own queue in it when the family has more than one, or else
+	// async compute is disabled (queues can't be submitted to from multiple threads at once)
+	uint32_t computeQueueIndex = queueCount;
+	if (GetEngineParam<bool>("enableAsyncCompute", true)) {
+		for (uint32_t i = 0; i < queueCount; i++) {
+			VkQueueFlags flags = queueProps[i].queueFlags;
+			if (i == graphicsQueueIndex || !(flags & VK_QUEUE_COMPUTE_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT))
+				continue;
+			if (computeQueueIndex == queueCount || computeQueueIndex == transferQueueIndex)
+				computeQueueIndex = i;
+		}
+	}
+	uint32_t computeQueueInFamily = 0;
+	if (computeQueueIndex != queueCount && computeQueueIndex == transferQueueIndex) {
+		if (queueProps[computeQueueIndex].queueCount > 1)
+			computeQueueInFamily = 1;
+		else
+			computeQueueIndex = queueCount;
+	}
+
 	//
 	// Create Vulkan device
 	//
-	std::array<float, 1> queuePriorities = { 0.0f };
-	VkDeviceQueueCreateInfo queueCreateInfo = {};
-	queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	queueCreateInfo.queueFamilyIndex = graphicsQueueIndex;
-	queueCreateInfo.queueCount = 1;
-	queueCreateInfo.pQueuePriorities = queuePriorities.data();
+	std::array<float, 2> queuePriorities = { 0.0f, 0.0f };
+	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos(1);
+	queueCreateInfos[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueCreateInfos[0].queueFamilyIndex = graphicsQueueIndex;
+	queueCreateInfos[0].queueCount = 1;
+	queueCreateInfos[0].pQueuePriorities = queuePriorities.data();
+	if (transferQueueIndex != queueCount) {
+		queueCreateInfos.push_back(queueCreateInfos[0]);
+		queueCreateInfos.back().queueFamilyIndex = transferQueueIndex;
+		queueCreateInfos.back().queueCount = computeQueueIndex == transferQueueIndex ? computeQueueInFamily + 1 : 1;
+	}
+	if (computeQueueIndex != queueCount && computeQueueIndex != transferQueueIndex) {
+		queueCreateInfos.push_back(queueCreateInfos[0]);
+		queueCreateInfos.back().queueFamilyIndex = computeQueueIndex;
+	}
 
-	std::vector<const char*> enabledExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	std::vector<const char*> enabledExtensions = {};
+	if (!GetEngineParam<bool>("headless"))
+		enabledExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+
+	// indirect draws can read their draw count from a buffer if the device supports it
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(m_vkPhysDev, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(m_vkPhysDev, nullptr, &extensionCount, extensions.data());
+	bool hasDrawIndirectCount = false;
+	for (auto& extension : extensions) {
+		if (strcmp(extension.extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0)
+			hasDrawIndirectCount = true;
+	}
+	if (hasDrawIndirectCount)
+		enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
 
 	VkPhysicalDeviceFeatures features = GetDeviceFeatures();
 	VkDeviceCreateInfo deviceCreateInfo = {};
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceCreateInfo.pNext = NULL;
-	deviceCreateInfo.queueCreateInfoCount = 1;
-	deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+	deviceCreateInfo.queueCreateInfoCount = (uint32_t)queueCreateInfos.size();
+	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 	deviceCreateInfo.pEnabledFeatures = &features;
 
 	if (enabledExtensions.size() > 0) {
@@ -391,11 +631,33 @@ WError Wasabi::StartEngine(int width, int height) {
 	if (err != VK_SUCCESS)
 		return WError(W_UNABLETOCREATEDEVICE);
 
+	if (hasDrawIndirectCount) {
+		m_vkCmdDrawIndexedIndirectCount =
+			reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>
+			(vkGetDeviceProcAddr(m_vkDevice, "vkCmdDrawIndexedIndirectCountKHR"));
+	}
+
 	// Get the graphics queue
 	vkGetDeviceQueue(m_vkDevice, graphicsQueueIndex, 0, &m_graphicsQueue);
+	m_graphicsQueueFamilyIndex = graphicsQueueIndex;
+	// Get the transfer queue, if any (the memory manager falls back to the graphics queue)
+	VkQueue transferQueue = VK_NULL_HANDLE;
+	if (transferQueueIndex != queueCount)
+		vkGetDeviceQueue(m_vkDevice, transferQueueIndex, 0, &transferQueue);
+	// Get the compute queue, if any (async compute falls back to the graphics queue)
+	if (computeQueueIndex != queueCount) {
+		vkGetDeviceQueue(m_vkDevice, computeQueueIndex, computeQueueInFamily, &m_computeQueue);
+		m_computeQueueFamilyIndex = computeQueueIndex;
+	}
 
 	MemoryManager = new WVulkanMemoryManager();
-	WError werr = MemoryManager->Initialize(m_vkPhysDev, m_vkDevice, m_graphicsQueue, graphicsQueueIndex);
+	WError werr = MemoryManager->Initialize(m_vkPhysDev, m_vkDevice, m_graphicsQueue, graphicsQueueIndex,
+											transferQueue, transferQueueIndex, GetEngineParam<uint32_t>("uploadStagingSize"),
+											GetEngineParam<uint32_t>("frameRingSize"));
+	if (!werr)
+		return werr;
+
+	werr = _CreatePipelineCache();
 	if (!werr)
 		return werr;
 
@@ -408,10 +670,12 @@ WError Wasabi::StartEngine(int width, int height) {
 	if (!werr)
 		return werr;
 
-	m_swapChain.connect(m_vkInstance, m_vkPhysDev, m_vkDevice);
-	if (!m_swapChain.initSurface(WindowAndInputComponent->GetVulkanSurface()))
-		return WError(W_UNABLETOCREATESWAPCHAIN);
-	m_swapChainInitialized = true;
+	if (!GetEngineParam<bool>("headless")) {
+		m_swapChain.connect(m_vkInstance, m_vkPhysDev, m_vkDevice);
+		if (!m_swapChain.initSurface(WindowAndInputComponent->GetVulkanSurface()))
+			return WError(W_UNABLETOCREATESWAPCHAIN);
+		m_swapChainInitialized = true;
+	}
 
 	FileManager = new WFileManager(this);
 	ObjectManager = new WObjectManager(this);
@@ -479,11 +743,135 @@ VkDevice Wasabi::GetVulkanDevice() const {
 VkQueue Wasabi::GetVulkanGraphicsQeueue() const {
 	return m_graphicsQueue;
 }
+uint32_t Wasabi::GetVulkanGraphicsQueueFamilyIndex() const {
+	return m_graphicsQueueFamilyIndex;
+}
+VkQueue Wasabi::GetVulkanComputeQueue() const {
+	return m_computeQueue;
+}
+uint32_t Wasabi::GetVulkanComputeQueueFamilyIndex() const {
+	return m_computeQueueFamilyIndex;
+}
+PFN_vkCmdDrawIndexedIndirectCountKHR Wasabi::GetVulkanDrawIndexedIndirectCount() const {
+	return m_vkCmdDrawIndexedIndirectCount;
+}
 
 VulkanSwapChain* Wasabi::GetSwapChain() {
 	return &m_swapChain;
 }
 
+VkPipelineCache Wasabi::GetPipelineCache() const {
+	return m_pipelineCache;
+}
+
+std::string Wasabi::GetPipelineCachePath() {
+	const char* filename = GetEngineParam<const char*>("pipelineCacheFile");
+	if (!filename || !filename[0])
+		return "";
+
+	stdfs::path path(filename);
+	if (path.is_absolute())
+		return path.string();
+
+	const char* directory = GetEngineParam<const char*>("pipelineCacheDirectory");
+	if (directory && directory[0])
+		return (stdfs::path(directory) / path).string();
+
+	// keep the caches of different applications apart, next to the working directory only as a last resort
+	stdfs::path userDirectory = GetUserCacheDirectory();
+	const char* appName = GetEngineParam<const char*>("appName");
+	if (userDirectory.empty() || !appName || !appName[0])
+		return path.string();
+	return (userDirectory / appName / path).string();
+}
+
+WError Wasabi::_CreatePipelineCache() {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_vkPhysDev, &properties);
+
+	std::vector<char> cacheData;
+	std::string filename = GetPipelineCachePath();
+	if (filename.length() > 0) {
+		std::ifstream file(filename, std::ios::in | std::ios::binary);
+		if (file.is_open()) {
+			PIPELINE_CACHE_FILE_HEADER header;
+			file.read((char*)&header, sizeof(header));
+			if (file && header.magic == W_PIPELINE_CACHE_MAGIC && header.version == W_PIPELINE_CACHE_VERSION &&
+				header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+				header.driverVersion == properties.driverVersion &&
+				memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+				header.dataSize >= sizeof(VK_PIPELINE_CACHE_HEADER) && header.dataSize <= W_PIPELINE_CACHE_MAX_SIZE) {
+				cacheData.resize((size_t)header.dataSize);
+				file.read(cacheData.data(), cacheData.size());
+
+				// the driver should reject bad data itself, but not all of them do
+				VK_PIPELINE_CACHE_HEADER vkHeader;
+				memcpy(&vkHeader, cacheData.data(), sizeof(vkHeader));
+				if (!file || HashPipelineCacheData(cacheData) != header.dataHash ||
+					vkHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+					vkHeader.vendorID != properties.vendorID || vkHeader.deviceID != properties.deviceID ||
+					memcmp(vkHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+					cacheData.clear();
+			}
+		}
+	}
+
+	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
+	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	pipelineCacheCreateInfo.initialDataSize = cacheData.size();
+	pipelineCacheCreateInfo.pInitialData = cacheData.size() > 0 ? cacheData.data() : nullptr;
+	VkResult err = vkCreatePipelineCache(m_vkDevice, &pipelineCacheCreateInfo, nullptr, &m_pipelineCache);
+	if (err != VK_SUCCESS && cacheData.size() > 0) {
+		// start over with an empty cache
+		pipelineCacheCreateInfo.initialDataSize = 0;
+		pipelineCacheCreateInfo.pInitialData = nullptr;
+		err = vkCreatePipelineCache(m_vkDevice, &pipelineCacheCreateInfo, nullptr, &m_pipelineCache);
+	}
+	if (err != VK_SUCCESS)
+		return WError(W_OUTOFMEMORY);
+
+	return WError(W_SUCCEEDED);
+}
+
+void Wasabi::_SavePipelineCache() {
+	std::string filename = GetPipelineCachePath();
+	if (!m_pipelineCache || filename.length() == 0)
+		return;
+
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(m_vkDevice, m_pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+		return;
+	std::vector<char> cacheData(dataSize);
+	if (vkGetPipelineCacheData(m_vkDevice, m_pipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS)
+		return;
+	cacheData.resize(dataSize);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_vkPhysDev, &properties);
+
+	PIPELINE_CACHE_FILE_HEADER header = {};
+	header.magic = W_PIPELINE_CACHE_MAGIC;
+	header.version = W_PIPELINE_CACHE_VERSION;
+	header.vendorID = properties.vendorID;
+	header.deviceID = properties.deviceID;
+	header.driverVersion = properties.driverVersion;
+	memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = cacheData.size();
+	header.dataHash = HashPipelineCacheData(cacheData);
+
+	// the cache is only an optimization, a directory that can't be created just means a cold start next time
+	std::error_code error;
+	stdfs::path parent = stdfs::path(filename).parent_path();
+	if (!parent.empty())
+		stdfs::create_directories(parent, error);
+
+	std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (file.is_open()) {
+		file.write((const char*)&header, sizeof(header));
+		file.write(cacheData.data(), cacheData.size());
+	}
+}
+
 uint32_t Wasabi::SelectGPU(std::vector<VkPhysicalDevice> devices) {
 	return 0;
 }
@@ -534,6 +922,8 @@ WTextComponent* Wasabi::CreateTextComponent() {
 }
 
 WWindowAndInputComponent* Wasabi::CreateWindowAndInputComponent() {
+	if (GetEngineParam<bool>("headless"))
+		return new WHeadlessWindowAndInputComponent(this);
 	return new WGLFWWindowAndInputComponent(this);
 }
 
@@ -0,0 +1,124 @@
+#include "Wasabi/Core/WJobSystem.hpp"
+
+#include <algorithm>
+
+namespace {
+	/** true on the threads of a job system, nested loops run serially there */
+	thread_local bool isJobThread = false;
+	/** Index of the current thread, see WJobSystem::GetCurrentThreadIndex() */
+	thread_local uint32_t threadIndex = 0;
+	/** Number of chunks aimed for per thread, to balance uneven chunks */
+	const uint32_t CHUNKS_PER_THREAD = 4;
+};
+
+WJobSystem::WJobSystem() {
+	m_job = {};
+	m_generation = 0;
+	m_activeWorkers = 0;
+	m_stop = false;
+	m_nextChunk = 0;
+	m_completedChunks = 0;
+}
+
+WJobSystem::~WJobSystem() {
+	_Stop();
+}
+
+void WJobSystem::Configure(uint32_t numWorkers) {
+	_Stop();
+
+	m_stop = false;
+	for (uint32_t i = 0; i < numWorkers; i++)
+		m_workers.push_back(std::thread(&WJobSystem::_WorkerLoop, this, i + 1));
+}
+
+uint32_t WJobSystem::GetNumWorkers() const {
+	return (uint32_t)m_workers.size();
+}
+
+uint32_t WJobSystem::GetCurrentThreadIndex() const {
+	return threadIndex;
+}
+
+void WJobSystem::ParallelFor(uint32_t count, uint32_t minChunk, const std::function<void(uint32_t begin, uint32_t end)>& fn) {
+	if (count == 0)
+		return;
+
+	uint32_t numThreads = (uint32_t)m_workers.size() + 1;
+	uint32_t chunkSize = std::max(std::max(minChunk, 1u), count / (numThreads * CHUNKS_PER_THREAD));
+	uint32_t numChunks = (count + chunkSize - 1) / chunkSize;
+	if (numThreads == 1 || numChunks == 1 || isJobThread) {
+		fn(0, count);
+		return;
+	}
+
+	std::lock_guard<std::mutex> submitLock(m_submitMutex);
+	JOB job = { &fn, count, chunkSize, numChunks };
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		// workers that woke up late for the previous job must be done with it
+		m_doneCondition.wait(lock, [this]() { return m_activeWorkers == 0; });
+		m_job = job;
+		m_nextChunk = 0;
+		m_completedChunks = 0;
+		m_generation++;
+	}
+	m_wakeCondition.notify_all();
+
+	isJobThread = true;
+	_RunChunks(job);
+	isJobThread = false;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this, numChunks]() { return m_completedChunks == numChunks && m_activeWorkers == 0; });
+}
+
+void WJobSystem::_Stop() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wakeCondition.notify_all();
+	for (auto& worker : m_workers)
+		worker.join();
+	m_workers.clear();
+}
+
+void WJobSystem::_WorkerLoop(uint32_t index) {
+	isJobThread = true;
+	threadIndex = index;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	uint64_t seenGeneration = m_generation;
+	while (true) {
+		m_wakeCondition.wait(lock, [this, &seenGeneration]() { return m_stop || m_generation != seenGeneration; });
+		if (m_stop)
+			return;
+		seenGeneration = m_generation;
+		JOB job = m_job;
+		m_activeWorkers++;
+		lock.unlock();
+
+		_RunChunks(job);
+
+		lock.lock();
+		m_activeWorkers--;
+		if (m_activeWorkers == 0)
+			m_doneCondition.notify_all();
+	}
+}
+
+void WJobSystem::_RunChunks(const JOB& job) {
+	while (true) {
+		uint32_t chunk = m_nextChunk.fetch_add(1);
+		if (chunk >= job.numChunks)
+			break;
+		uint32_t begin = chunk * job.chunkSize;
+		(*job.fn)(begin, std::min(begin + job.chunkSize, job.count));
+		if (m_completedChunks.fetch_add(1) + 1 == job.numChunks) {
+			// take the lock so the submitting thread can't miss the notification
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_doneCondition.notify_all();
+		}
+	}
+}
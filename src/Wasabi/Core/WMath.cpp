@@ -1,6 +1,158 @@
 #include "Wasabi/Core/WMath.hpp"
+#include "Wasabi/Core/WSIMD.hpp"
 #include <memory>
 
+/*
+ * The matrix products, transforms and quaternion operations have SIMD paths
+ * (see WSIMD.hpp), AVX is only used for the matrix products. The SIMD paths
+ * perform the same multiplications and additions, in the same order, as the
+ * scalar code so they give the same results, except for WMatrixInverse which
+ * is computed block-wise and may differ from the scalar inverse in the last
+ * bits.
+ */
+
+namespace {
+#if defined(W_SIMD_SSE)
+	/** Broadcasts component i of v to all four lanes */
+	#define W_SPLAT(v, i) _mm_shuffle_ps((v), (v), _MM_SHUFFLE((i), (i), (i), (i)))
+	/** Shuffles the lanes of v, x, y, z and w are the source lanes */
+	#define W_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps((v), (v), _MM_SHUFFLE((w), (z), (y), (x)))
+
+	/** Row-vector product v * m, where r0-r3 are the rows of m */
+	inline __m128 Transform(__m128 v, __m128 r0, __m128 r1, __m128 r2, __m128 r3) {
+		__m128 out = _mm_mul_ps(W_SPLAT(v, 0), r0);
+		out = _mm_add_ps(out, _mm_mul_ps(W_SPLAT(v, 1), r1));
+		out = _mm_add_ps(out, _mm_mul_ps(W_SPLAT(v, 2), r2));
+		return _mm_add_ps(out, _mm_mul_ps(W_SPLAT(v, 3), r3));
+	}
+
+	/** Row-vector product (v.x, v.y, v.z, 1) * m, where r0-r3 are the rows of m */
+	inline __m128 TransformPoint(const WVector3& v, __m128 r0, __m128 r1, __m128 r2, __m128 r3) {
+		__m128 out = _mm_mul_ps(_mm_set1_ps(v.x), r0);
+		out = _mm_add_ps(out, _mm_mul_ps(_mm_set1_ps(v.y), r1));
+		out = _mm_add_ps(out, _mm_mul_ps(_mm_set1_ps(v.z), r2));
+		return _mm_add_ps(out, r3);
+	}
+
+	/** Row-vector product (v.x, v.y, v.z, 0) * m, where r0-r2 are the rows of m */
+	inline __m128 TransformDirection(const WVector3& v, __m128 r0, __m128 r1, __m128 r2) {
+		__m128 out = _mm_mul_ps(_mm_set1_ps(v.x), r0);
+		out = _mm_add_ps(out, _mm_mul_ps(_mm_set1_ps(v.y), r1));
+		return _mm_add_ps(out, _mm_mul_ps(_mm_set1_ps(v.z), r2));
+	}
+
+	/**
+	 * Loads a vector passed by value. Vectors are passed in two halves in some
+	 * ABIs so they are loaded in halves, a single wide load of the two spilled
+	 * halves can't be store-forwarded and stalls.
+	 */
+	inline __m128 LoadVec4(const WVector4& v) {
+		return _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)&v.x), (const __m64*)&v.z);
+	}
+
+	/** Stores the first three lanes of v */
+	inline void StoreVec3(__m128 v, WVector3& out) {
+		_mm_storel_pi((__m64*)&out.x, v);
+		_mm_store_ss(&out.z, _mm_movehl_ps(v, v));
+	}
+
+	/** out = a * b, out may alias a or b */
+	inline void Multiply(const float* a, const float* b, float* out) {
+#if defined(W_SIMD_AVX)
+		// two rows of the product at a time
+		__m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + 4), b2 = _mm_loadu_ps(b + 8), b3 = _mm_loadu_ps(b + 12);
+		__m256 bb0 = _mm256_insertf128_ps(_mm256_castps128_ps256(b0), b0, 1);
+		__m256 bb1 = _mm256_insertf128_ps(_mm256_castps128_ps256(b1), b1, 1);
+		__m256 bb2 = _mm256_insertf128_ps(_mm256_castps128_ps256(b2), b2, 1);
+		__m256 bb3 = _mm256_insertf128_ps(_mm256_castps128_ps256(b3), b3, 1);
+		__m256 a01 = _mm256_loadu_ps(a), a23 = _mm256_loadu_ps(a + 8);
+
+		__m256 out01 = _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x00), bb0);
+		out01 = _mm256_add_ps(out01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x55), bb1));
+		out01 = _mm256_add_ps(out01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xAA), bb2));
+		out01 = _mm256_add_ps(out01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xFF), bb3));
+		__m256 out23 = _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x00), bb0);
+		out23 = _mm256_add_ps(out23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x55), bb1));
+		out23 = _mm256_add_ps(out23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xAA), bb2));
+		out23 = _mm256_add_ps(out23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xFF), bb3));
+
+		_mm256_storeu_ps(out, out01);
+		_mm256_storeu_ps(out + 8, out23);
+#else
+		__m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + 4), b2 = _mm_loadu_ps(b + 8), b3 = _mm_loadu_ps(b + 12);
+		__m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4), a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+		_mm_storeu_ps(out, Transform(a0, b0, b1, b2, b3));
+		_mm_storeu_ps(out + 4, Transform(a1, b0, b1, b2, b3));
+		_mm_storeu_ps(out + 8, Transform(a2, b0, b1, b2, b3));
+		_mm_storeu_ps(out + 12, Transform(a3, b0, b1, b2, b3));
+#endif
+	}
+
+	/** Product of 2x2 matrices a * b, each packed in a vector (row-major) */
+	inline __m128 Mat2Mul(__m128 a, __m128 b) {
+		return _mm_add_ps(_mm_mul_ps(a, W_SWIZZLE(b, 0, 3, 0, 3)),
+			_mm_mul_ps(W_SWIZZLE(a, 1, 0, 3, 2), W_SWIZZLE(b, 2, 1, 2, 1)));
+	}
+
+	/** Product of 2x2 matrices adj(a) * b */
+	inline __m128 Mat2AdjMul(__m128 a, __m128 b) {
+		return _mm_sub_ps(_mm_mul_ps(W_SWIZZLE(a, 3, 3, 0, 0), b),
+			_mm_mul_ps(W_SWIZZLE(a, 1, 1, 2, 2), W_SWIZZLE(b, 2, 3, 0, 1)));
+	}
+
+	/** Product of 2x2 matrices a * adj(b) */
+	inline __m128 Mat2MulAdj(__m128 a, __m128 b) {
+		return _mm_sub_ps(_mm_mul_ps(a, W_SWIZZLE(b, 3, 0, 3, 0)),
+			_mm_mul_ps(W_SWIZZLE(a, 1, 0, 3, 2), W_SWIZZLE(b, 2, 1, 2, 1)));
+	}
+
+	/** Cross product of the xyz components of a and b, the w component is 0 */
+	inline __m128 Cross(__m128 a, __m128 b) {
+		return _mm_sub_ps(_mm_mul_ps(W_SWIZZLE(a, 1, 2, 0, 3), W_SWIZZLE(b, 2, 0, 1, 3)),
+			_mm_mul_ps(W_SWIZZLE(a, 2, 0, 1, 3), W_SWIZZLE(b, 1, 2, 0, 3)));
+	}
+#elif defined(W_SIMD_NEON)
+	/** Row-vector product v * m, where r0-r3 are the rows of m */
+	inline float32x4_t Transform(float32x4_t v, float32x4_t r0, float32x4_t r1, float32x4_t r2, float32x4_t r3) {
+		float32x4_t out = vmulq_n_f32(r0, vgetq_lane_f32(v, 0));
+		out = vaddq_f32(out, vmulq_n_f32(r1, vgetq_lane_f32(v, 1)));
+		out = vaddq_f32(out, vmulq_n_f32(r2, vgetq_lane_f32(v, 2)));
+		return vaddq_f32(out, vmulq_n_f32(r3, vgetq_lane_f32(v, 3)));
+	}
+
+	/** Row-vector product (v.x, v.y, v.z, 1) * m, where r0-r3 are the rows of m */
+	inline float32x4_t TransformPoint(const WVector3& v, float32x4_t r0, float32x4_t r1, float32x4_t r2, float32x4_t r3) {
+		float32x4_t out = vmulq_n_f32(r0, v.x);
+		out = vaddq_f32(out, vmulq_n_f32(r1, v.y));
+		out = vaddq_f32(out, vmulq_n_f32(r2, v.z));
+		return vaddq_f32(out, r3);
+	}
+
+	/** Row-vector product (v.x, v.y, v.z, 0) * m, where r0-r2 are the rows of m */
+	inline float32x4_t TransformDirection(const WVector3& v, float32x4_t r0, float32x4_t r1, float32x4_t r2) {
+		float32x4_t out = vmulq_n_f32(r0, v.x);
+		out = vaddq_f32(out, vmulq_n_f32(r1, v.y));
+		return vaddq_f32(out, vmulq_n_f32(r2, v.z));
+	}
+
+	/** Stores the first three lanes of v */
+	inline void StoreVec3(float32x4_t v, WVector3& out) {
+		vst1_f32(&out.x, vget_low_f32(v));
+		out.z = vgetq_lane_f32(v, 2);
+	}
+
+	/** out = a * b, out may alias a or b */
+	inline void Multiply(const float* a, const float* b, float* out) {
+		float32x4_t b0 = vld1q_f32(b), b1 = vld1q_f32(b + 4), b2 = vld1q_f32(b + 8), b3 = vld1q_f32(b + 12);
+		float32x4_t a0 = vld1q_f32(a), a1 = vld1q_f32(a + 4), a2 = vld1q_f32(a + 8), a3 = vld1q_f32(a + 12);
+		vst1q_f32(out, Transform(a0, b0, b1, b2, b3));
+		vst1q_f32(out + 4, Transform(a1, b0, b1, b2, b3));
+		vst1q_f32(out + 8, Transform(a2, b0, b1, b2, b3));
+		vst1q_f32(out + 12, Transform(a3, b0, b1, b2, b3));
+	}
+#endif
+};
+
 WMatrix::WMatrix() {
 	for (int i = 0; i < 16; i++)
 		mat[i] = i % 4 == i / 4 ? 1.0f : 0.0f;
@@ -42,6 +194,9 @@ WMatrix WMatrix::operator- (const WMatrix m) const {
 }
 WMatrix WMatrix::operator* (const WMatrix m) const {
 	WMatrix out;
+#if defined(W_SIMD_SSE) || defined(W_SIMD_NEON)
+	Multiply(mat, m.mat, out.mat);
+#else
 	for (uint32_t i = 0; i < 4; i++)
 		for (uint32_t j = 0; j < 4; j++) {
 			float fSum = 0.0f;
@@ -49,6 +204,7 @@ WMatrix WMatrix::operator* (const WMatrix m) const {
 				fSum += (*this)(i, k) * m(k, j);
 			out(i, j) = fSum;
 		}
+#endif
 	return out;
 }
 WMatrix WMatrix::operator/ (const WMatrix m) const {
@@ -89,6 +245,9 @@ void WMatrix::operator-= (const WMatrix m) {
 			(*this)(i, j) -= m(i, j);
 }
 void WMatrix::operator*= (const WMatrix m) {
+#if defined(W_SIMD_SSE) || defined(W_SIMD_NEON)
+	Multiply(mat, m.mat, mat);
+#else
 	WMatrix old = (*this);
 	for (uint32_t i = 0; i < 4; i++)
 		for (uint32_t j = 0; j < 4; j++) {
@@ -97,6 +256,7 @@ void WMatrix::operator*= (const WMatrix m) {
 				fSum += old(i, k) * m(k, j);
 			(*this)(i, j) = fSum;
 		}
+#endif
 }
 void WMatrix::operator/= (const WMatrix m) {
 	WMatrix old;
@@ -133,14 +293,75 @@ float WMatrix::operator[] (const uint32_t index) const {
 
 WMatrix WMatrixTranspose(const WMatrix m) {
 	WMatrix out;
+#if defined(W_SIMD_SSE)
+	__m128 r0 = _mm_loadu_ps(m.mat), r1 = _mm_loadu_ps(m.mat + 4), r2 = _mm_loadu_ps(m.mat + 8), r3 = _mm_loadu_ps(m.mat + 12);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_storeu_ps(out.mat, r0);
+	_mm_storeu_ps(out.mat + 4, r1);
+	_mm_storeu_ps(out.mat + 8, r2);
+	_mm_storeu_ps(out.mat + 12, r3);
+#elif defined(W_SIMD_NEON)
+	// vld4q de-interleaves the rows, which loads the columns
+	float32x4x4_t cols = vld4q_f32(m.mat);
+	vst1q_f32(out.mat, cols.val[0]);
+	vst1q_f32(out.mat + 4, cols.val[1]);
+	vst1q_f32(out.mat + 8, cols.val[2]);
+	vst1q_f32(out.mat + 12, cols.val[3]);
+#else
 	for (uint32_t i = 0; i < 4; i++)
 		for (uint32_t j = 0; j < 4; j++)
 			out(i, j) = m(j, i);
+#endif
 	return out;
 }
 WMatrix WMatrixInverse(const WMatrix m) {
 	WMatrix out;
 
+#if defined(W_SIMD_SSE)
+	// block-wise inverse: m is split into the 2x2 matrices [A B; C D], each
+	// packed row-major in a vector
+	__m128 r0 = _mm_loadu_ps(m.mat), r1 = _mm_loadu_ps(m.mat + 4), r2 = _mm_loadu_ps(m.mat + 8), r3 = _mm_loadu_ps(m.mat + 12);
+	__m128 A = _mm_movelh_ps(r0, r1);
+	__m128 B = _mm_movehl_ps(r1, r0);
+	__m128 C = _mm_movelh_ps(r2, r3);
+	__m128 D = _mm_movehl_ps(r3, r2);
+
+	// (|A|, |B|, |C|, |D|)
+	__m128 detSub = _mm_sub_ps(
+		_mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(3, 1, 3, 1))),
+		_mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(2, 0, 2, 0))));
+	__m128 detA = W_SPLAT(detSub, 0);
+	__m128 detB = W_SPLAT(detSub, 1);
+	__m128 detC = W_SPLAT(detSub, 2);
+	__m128 detD = W_SPLAT(detSub, 3);
+
+	__m128 D_C = Mat2AdjMul(D, C);
+	__m128 A_B = Mat2AdjMul(A, B);
+	// adjugates of the blocks of the inverse, scaled by |m|
+	__m128 X_ = _mm_sub_ps(_mm_mul_ps(detD, A), Mat2Mul(B, D_C));
+	__m128 W_ = _mm_sub_ps(_mm_mul_ps(detA, D), Mat2Mul(C, A_B));
+	__m128 Y_ = _mm_sub_ps(_mm_mul_ps(detB, C), Mat2MulAdj(D, A_B));
+	__m128 Z_ = _mm_sub_ps(_mm_mul_ps(detC, B), Mat2MulAdj(A, D_C));
+
+	// |m| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+	__m128 tr = _mm_mul_ps(A_B, W_SWIZZLE(D_C, 0, 2, 1, 3));
+	tr = _mm_add_ps(tr, W_SWIZZLE(tr, 1, 0, 3, 2));
+	tr = _mm_add_ps(tr, W_SWIZZLE(tr, 2, 3, 0, 1));
+	__m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+	// Should check for 0 determinant
+	__m128 invdet = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+	X_ = _mm_mul_ps(X_, invdet);
+	Y_ = _mm_mul_ps(Y_, invdet);
+	Z_ = _mm_mul_ps(Z_, invdet);
+	W_ = _mm_mul_ps(W_, invdet);
+
+	// adjugate the blocks back while storing them
+	_mm_storeu_ps(out.mat, _mm_shuffle_ps(X_, Y_, _MM_SHUFFLE(1, 3, 1, 3)));
+	_mm_storeu_ps(out.mat + 4, _mm_shuffle_ps(X_, Y_, _MM_SHUFFLE(0, 2, 0, 2)));
+	_mm_storeu_ps(out.mat + 8, _mm_shuffle_ps(Z_, W_, _MM_SHUFFLE(1, 3, 1, 3)));
+	_mm_storeu_ps(out.mat + 12, _mm_shuffle_ps(Z_, W_, _MM_SHUFFLE(0, 2, 0, 2)));
+#else
 	float s0 = m(0, 0) * m(1, 1) - m(1, 0) * m(0, 1);
 	float s1 = m(0, 0) * m(1, 2) - m(1, 0) * m(0, 2);
 	float s2 = m(0, 0) * m(1, 3) - m(1, 0) * m(0, 3);
@@ -177,6 +398,86 @@ WMatrix WMatrixInverse(const WMatrix m) {
 	out(3, 1) = (m(0, 0) * c3 - m(0, 1) * c1 + m(0, 2) * c0) * invdet;
 	out(3, 2) = (-m(3, 0) * s3 + m(3, 1) * s1 - m(3, 2) * s0) * invdet;
 	out(3, 3) = (m(2, 0) * s3 - m(2, 1) * s1 + m(2, 2) * s0) * invdet;
+#endif
+
+	return out;
+}
+WMatrix WMatrixInverseAffine(const WMatrix m) {
+	WMatrix out;
+
+#if defined(W_SIMD_SSE)
+	// the inverse of the 3x3 part has the columns (r1 x r2, r2 x r0, r0 x r1) / |m|
+	__m128 r0 = _mm_loadu_ps(m.mat), r1 = _mm_loadu_ps(m.mat + 4), r2 = _mm_loadu_ps(m.mat + 8), r3 = _mm_loadu_ps(m.mat + 12);
+	__m128 c0 = Cross(r1, r2), c1 = Cross(r2, r0), c2 = Cross(r0, r1), c3 = _mm_setzero_ps();
+	__m128 det = _mm_mul_ps(r0, c0);
+	det = _mm_add_ps(_mm_add_ps(W_SPLAT(det, 0), W_SPLAT(det, 1)), W_SPLAT(det, 2));
+	// Should check for 0 determinant
+	__m128 invdet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+	c0 = _mm_mul_ps(c0, invdet);
+	c1 = _mm_mul_ps(c1, invdet);
+	c2 = _mm_mul_ps(c2, invdet);
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+	// the translation is -t * inverse(3x3 part)
+	__m128 t = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), Transform(r3, c0, c1, c2, c3));
+	_mm_storeu_ps(out.mat, c0);
+	_mm_storeu_ps(out.mat + 4, c1);
+	_mm_storeu_ps(out.mat + 8, c2);
+	_mm_storeu_ps(out.mat + 12, t);
+#else
+	// cofactors of the 3x3 part
+	float c00 = m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1);
+	float c01 = m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2);
+	float c02 = m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0);
+
+	// Should check for 0 determinant
+	float invdet = 1.0f / (m(0, 0) * c00 + m(0, 1) * c01 + m(0, 2) * c02);
+
+	out(0, 0) = c00 * invdet;
+	out(0, 1) = (m(0, 2) * m(2, 1) - m(0, 1) * m(2, 2)) * invdet;
+	out(0, 2) = (m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1)) * invdet;
+	out(0, 3) = 0.0f;
+
+	out(1, 0) = c01 * invdet;
+	out(1, 1) = (m(0, 0) * m(2, 2) - m(0, 2) * m(2, 0)) * invdet;
+	out(1, 2) = (m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2)) * invdet;
+	out(1, 3) = 0.0f;
+
+	out(2, 0) = c02 * invdet;
+	out(2, 1) = (m(0, 1) * m(2, 0) - m(0, 0) * m(2, 1)) * invdet;
+	out(2, 2) = (m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0)) * invdet;
+	out(2, 3) = 0.0f;
+
+	for (uint32_t j = 0; j < 3; j++)
+		out(3, j) = -(m(3, 0) * out(0, j) + m(3, 1) * out(1, j) + m(3, 2) * out(2, j));
+	out(3, 3) = 1.0f;
+#endif
+
+	return out;
+}
+
+WMatrix WMatrixInverseOrthonormal(const WMatrix m) {
+	WMatrix out;
+
+#if defined(W_SIMD_SSE)
+	// the inverse of a rotation is its transpose
+	__m128 r0 = _mm_loadu_ps(m.mat), r1 = _mm_loadu_ps(m.mat + 4), r2 = _mm_loadu_ps(m.mat + 8), r3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	// the translation is -t * transpose(3x3 part)
+	__m128 t = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), TransformDirection(WVector3(m.mat[12], m.mat[13], m.mat[14]), r0, r1, r2));
+	_mm_storeu_ps(out.mat, r0);
+	_mm_storeu_ps(out.mat + 4, r1);
+	_mm_storeu_ps(out.mat + 8, r2);
+	_mm_storeu_ps(out.mat + 12, t);
+#else
+	for (uint32_t i = 0; i < 3; i++) {
+		for (uint32_t j = 0; j < 3; j++)
+			out(i, j) = m(j, i);
+		out(i, 3) = 0.0f;
+	}
+	for (uint32_t j = 0; j < 3; j++)
+		out(3, j) = -(m(3, 0) * out(0, j) + m(3, 1) * out(1, j) + m(3, 2) * out(2, j));
+	out(3, 3) = 1.0f;
+#endif
 
 	return out;
 }
@@ -234,12 +535,66 @@ WVector4 WVec3Transform(const WVector3 v, const WMatrix m) {
 	return WVec4Transform(WVector4(v.x, v.y, v.z, 1), m);
 }
 WVector3 WVec3TransformCoord(const WVector3 v, const WMatrix m) {
+#if defined(W_SIMD_SSE)
+	__m128 out = TransformPoint(v, _mm_loadu_ps(m.mat), _mm_loadu_ps(m.mat + 4), _mm_loadu_ps(m.mat + 8), _mm_loadu_ps(m.mat + 12));
+	WVector3 result;
+	StoreVec3(_mm_div_ps(out, W_SPLAT(out, 3)), result);
+	return result;
+#elif defined(W_SIMD_NEON)
+	float32x4_t out = TransformPoint(v, vld1q_f32(m.mat), vld1q_f32(m.mat + 4), vld1q_f32(m.mat + 8), vld1q_f32(m.mat + 12));
+	float w = vgetq_lane_f32(out, 3);
+	return WVector3(vgetq_lane_f32(out, 0) / w, vgetq_lane_f32(out, 1) / w, vgetq_lane_f32(out, 2) / w);
+#else
 	WVector4 out = WVec4Transform(WVector4(v.x, v.y, v.z, 1), m);
 	return WVector3(out.x, out.y, out.z) / out.w;
+#endif
 }
 WVector3 WVec3TransformNormal(const WVector3 v, const WMatrix m) {
+#if defined(W_SIMD_SSE)
+	WVector3 result;
+	StoreVec3(TransformDirection(v, _mm_loadu_ps(m.mat), _mm_loadu_ps(m.mat + 4), _mm_loadu_ps(m.mat + 8)), result);
+	return result;
+#elif defined(W_SIMD_NEON)
+	WVector3 result;
+	StoreVec3(TransformDirection(v, vld1q_f32(m.mat), vld1q_f32(m.mat + 4), vld1q_f32(m.mat + 8)), result);
+	return result;
+#else
 	WVector4 out = WVec4Transform(WVector4(v.x, v.y, v.z, 0), m);
 	return WVector3(out.x, out.y, out.z);
+#endif
+}
+void WVec3TransformCoordArray(WVector3* out, const WVector3* in, uint32_t count, const WMatrix& m) {
+#if defined(W_SIMD_SSE)
+	__m128 r0 = _mm_loadu_ps(m.mat), r1 = _mm_loadu_ps(m.mat + 4), r2 = _mm_loadu_ps(m.mat + 8), r3 = _mm_loadu_ps(m.mat + 12);
+	for (uint32_t i = 0; i < count; i++) {
+		__m128 v = TransformPoint(in[i], r0, r1, r2, r3);
+		StoreVec3(_mm_div_ps(v, W_SPLAT(v, 3)), out[i]);
+	}
+#elif defined(W_SIMD_NEON)
+	float32x4_t r0 = vld1q_f32(m.mat), r1 = vld1q_f32(m.mat + 4), r2 = vld1q_f32(m.mat + 8), r3 = vld1q_f32(m.mat + 12);
+	for (uint32_t i = 0; i < count; i++) {
+		float32x4_t v = TransformPoint(in[i], r0, r1, r2, r3);
+		float w = vgetq_lane_f32(v, 3);
+		out[i] = WVector3(vgetq_lane_f32(v, 0) / w, vgetq_lane_f32(v, 1) / w, vgetq_lane_f32(v, 2) / w);
+	}
+#else
+	for (uint32_t i = 0; i < count; i++)
+		out[i] = WVec3TransformCoord(in[i], m);
+#endif
+}
+void WVec3TransformNormalArray(WVector3* out, const WVector3* in, uint32_t count, const WMatrix& m) {
+#if defined(W_SIMD_SSE)
+	__m128 r0 = _mm_loadu_ps(m.mat), r1 = _mm_loadu_ps(m.mat + 4), r2 = _mm_loadu_ps(m.mat + 8);
+	for (uint32_t i = 0; i < count; i++)
+		StoreVec3(TransformDirection(in[i], r0, r1, r2), out[i]);
+#elif defined(W_SIMD_NEON)
+	float32x4_t r0 = vld1q_f32(m.mat), r1 = vld1q_f32(m.mat + 4), r2 = vld1q_f32(m.mat + 8);
+	for (uint32_t i = 0; i < count; i++)
+		StoreVec3(TransformDirection(in[i], r0, r1, r2), out[i]);
+#else
+	for (uint32_t i = 0; i < count; i++)
+		out[i] = WVec3TransformNormal(in[i], m);
+#endif
 }
 
 float WVec4Dot(const WVector4 v1, const WVector4 v2) {
@@ -259,11 +614,103 @@ WVector4 WVec4Lerp(const WVector4 v1, const WVector4 v2, const float fLerpVal) {
 }
 WVector4 WVec4Transform(const WVector4 v, const WMatrix m) {
 	WVector4 out;
+#if defined(W_SIMD_SSE)
+	_mm_storeu_ps(out.components, Transform(LoadVec4(v),
+		_mm_loadu_ps(m.mat), _mm_loadu_ps(m.mat + 4), _mm_loadu_ps(m.mat + 8), _mm_loadu_ps(m.mat + 12)));
+#elif defined(W_SIMD_NEON)
+	vst1q_f32(out.components, Transform(vld1q_f32(v.components),
+		vld1q_f32(m.mat), vld1q_f32(m.mat + 4), vld1q_f32(m.mat + 8), vld1q_f32(m.mat + 12)));
+#else
 	out.x = v.x * m(0, 0) + v.y * m(1, 0) + v.z * m(2, 0) + v.w * m(3, 0);
 	out.y = v.x * m(0, 1) + v.y * m(1, 1) + v.z * m(2, 1) + v.w * m(3, 1);
 	out.z = v.x * m(0, 2) + v.y * m(1, 2) + v.z * m(2, 2) + v.w * m(3, 2);
 	out.w = v.x * m(0, 3) + v.y * m(1, 3) + v.z * m(2, 3) + v.w * m(3, 3);
+#endif
+	return out;
+}
+void WVec4TransformArray(WVector4* out, const WVector4* in, uint32_t count, const WMatrix& m) {
+#if defined(W_SIMD_SSE)
+	__m128 r0 = _mm_loadu_ps(m.mat), r1 = _mm_loadu_ps(m.mat + 4), r2 = _mm_loadu_ps(m.mat + 8), r3 = _mm_loadu_ps(m.mat + 12);
+	for (uint32_t i = 0; i < count; i++)
+		_mm_storeu_ps(out[i].components, Transform(_mm_loadu_ps(in[i].components), r0, r1, r2, r3));
+#elif defined(W_SIMD_NEON)
+	float32x4_t r0 = vld1q_f32(m.mat), r1 = vld1q_f32(m.mat + 4), r2 = vld1q_f32(m.mat + 8), r3 = vld1q_f32(m.mat + 12);
+	for (uint32_t i = 0; i < count; i++)
+		vst1q_f32(out[i].components, Transform(vld1q_f32(in[i].components), r0, r1, r2, r3));
+#else
+	for (uint32_t i = 0; i < count; i++)
+		out[i] = WVec4Transform(in[i], m);
+#endif
+}
+void WMatrixMultiplyArray(WMatrix* out, const WMatrix* in, uint32_t count, const WMatrix& m) {
+#if defined(W_SIMD_SSE) || defined(W_SIMD_NEON)
+	for (uint32_t i = 0; i < count; i++)
+		Multiply(in[i].mat, m.mat, out[i].mat);
+#else
+	for (uint32_t i = 0; i < count; i++)
+		out[i] = in[i] * m;
+#endif
+}
+
+WQuaternion WQuatMultiply(const WQuaternion q1, const WQuaternion q2) {
+	WQuaternion out;
+#if defined(W_SIMD_SSE)
+	__m128 a = LoadVec4(q1);
+	__m128 b = LoadVec4(q2);
+	__m128 res = _mm_mul_ps(W_SPLAT(a, 3), b);
+	res = _mm_add_ps(res, _mm_mul_ps(W_SPLAT(a, 0), _mm_mul_ps(W_SWIZZLE(b, 3, 2, 1, 0), _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f))));
+	res = _mm_add_ps(res, _mm_mul_ps(W_SPLAT(a, 1), _mm_mul_ps(W_SWIZZLE(b, 2, 3, 0, 1), _mm_setr_ps(1.0f, 1.0f, -1.0f, -1.0f))));
+	res = _mm_add_ps(res, _mm_mul_ps(W_SPLAT(a, 2), _mm_mul_ps(W_SWIZZLE(b, 1, 0, 3, 2), _mm_setr_ps(-1.0f, 1.0f, 1.0f, -1.0f))));
+	_mm_storeu_ps(out.components, res);
+#elif defined(W_SIMD_NEON)
+	static const float signs[3][4] = {
+		{1.0f, -1.0f, 1.0f, -1.0f},
+		{1.0f, 1.0f, -1.0f, -1.0f},
+		{-1.0f, 1.0f, 1.0f, -1.0f},
+	};
+	float32x4_t b = vld1q_f32(q2.components);
+	float32x4_t bwzyx = vrev64q_f32(vcombine_f32(vget_high_f32(b), vget_low_f32(b)));
+	float32x4_t bzwxy = vcombine_f32(vget_high_f32(b), vget_low_f32(b));
+	float32x4_t byxwz = vrev64q_f32(b);
+	float32x4_t res = vmulq_n_f32(b, q1.w);
+	res = vaddq_f32(res, vmulq_n_f32(vmulq_f32(bwzyx, vld1q_f32(signs[0])), q1.x));
+	res = vaddq_f32(res, vmulq_n_f32(vmulq_f32(bzwxy, vld1q_f32(signs[1])), q1.y));
+	res = vaddq_f32(res, vmulq_n_f32(vmulq_f32(byxwz, vld1q_f32(signs[2])), q1.z));
+	vst1q_f32(out.components, res);
+#else
+	out.x = q1.w * q2.x + q1.x * q2.w + q1.y * q2.z - q1.z * q2.y;
+	out.y = q1.w * q2.y - q1.x * q2.z + q1.y * q2.w + q1.z * q2.x;
+	out.z = q1.w * q2.z + q1.x * q2.y - q1.y * q2.x + q1.z * q2.w;
+	out.w = q1.w * q2.w - q1.x * q2.x - q1.y * q2.y - q1.z * q2.z;
+#endif
+	return out;
+}
+WQuaternion WQuatConjugate(const WQuaternion q) {
+	return WQuaternion(-q.x, -q.y, -q.z, q.w);
+}
+WVector3 WVec3Rotate(const WVector3 v, const WQuaternion q) {
+#if defined(W_SIMD_SSE)
+	// t = 2 * cross(q.xyz, v), out = v + q.w * t + cross(q.xyz, t)
+	__m128 qv = LoadVec4(q);
+	__m128 vv = _mm_setr_ps(v.x, v.y, v.z, 0.0f);
+	__m128 t = _mm_sub_ps(_mm_mul_ps(W_SWIZZLE(qv, 1, 2, 0, 3), W_SWIZZLE(vv, 2, 0, 1, 3)),
+		_mm_mul_ps(W_SWIZZLE(qv, 2, 0, 1, 3), W_SWIZZLE(vv, 1, 2, 0, 3)));
+	t = _mm_add_ps(t, t);
+	__m128 c = _mm_sub_ps(_mm_mul_ps(W_SWIZZLE(qv, 1, 2, 0, 3), W_SWIZZLE(t, 2, 0, 1, 3)),
+		_mm_mul_ps(W_SWIZZLE(qv, 2, 0, 1, 3), W_SWIZZLE(t, 1, 2, 0, 3)));
+	WVector3 out;
+	StoreVec3(_mm_add_ps(_mm_add_ps(vv, _mm_mul_ps(W_SPLAT(qv, 3), t)), c), out);
 	return out;
+#else
+	WVector3 axis(q.x, q.y, q.z);
+	WVector3 t = WVec3Cross(axis, v);
+	t = t + t;
+	return v + q.w * t + WVec3Cross(axis, t);
+#endif
+}
+void WVec3RotateArray(WVector3* out, const WVector3* in, uint32_t count, const WQuaternion q) {
+	for (uint32_t i = 0; i < count; i++)
+		out[i] = WVec3Rotate(in[i], q);
 }
 
 WMatrix WRotationMatrixX(const float fAngle) {
@@ -1,4 +1,5 @@
 #include "Wasabi/Core/WOrientation.hpp"
+#include "Wasabi/Core/WTransformHierarchy.hpp"
 
 WOrientation::WOrientation() {
 	//default values
@@ -8,21 +9,28 @@ WOrientation::WOrientation() {
 	m_look = WVector3(0.0f, 0.0f, 1.0f);
 
 	m_bBind = false;
+
+	m_version = 1;
+	m_transformationDirty = true;
+	m_inverseTransformationDirty = true;
+	m_hierarchy = nullptr;
 }
 
 WOrientation::~WOrientation() {
+	if (m_hierarchy)
+		m_hierarchy->_OnDestroyed(this);
 }
 
 void WOrientation::SetPosition(float x, float y, float z) {
 	m_pos = WVector3(x, y, z);
 
-	OnStateChange(CHANGE_MOTION);
+	_OnChanged(CHANGE_MOTION);
 }
 
 void WOrientation::SetPosition(const WVector3 pos) {
 	m_pos = pos;
 
-	OnStateChange(CHANGE_MOTION);
+	_OnChanged(CHANGE_MOTION);
 }
 
 void WOrientation::Point(float x, float y, float z) {
@@ -31,7 +39,7 @@ void WOrientation::Point(float x, float y, float z) {
 	m_right = WVec3Normalize(temp);
 	m_up = WVec3Cross(m_look, m_right);
 
-	OnStateChange(CHANGE_ROTATION);
+	_OnChanged(CHANGE_ROTATION);
 }
 
 void WOrientation::Point(WVector3 target) {
@@ -40,7 +48,7 @@ void WOrientation::Point(WVector3 target) {
 	m_right = WVec3Normalize(temp);
 	m_up = WVec3Cross(m_look, m_right);
 
-	OnStateChange(CHANGE_ROTATION);
+	_OnChanged(CHANGE_ROTATION);
 }
 
 void WOrientation::SetAngle(WQuaternion quat) {
@@ -61,7 +69,7 @@ void WOrientation::SetAngle(WQuaternion quat) {
 	m_look = WVector3(f(2, 0), f(2, 1), f(2, 2));
 	m_right = WVector3(f(0, 0), f(0, 1), f(0, 2));
 
-	OnStateChange(CHANGE_ROTATION);
+	_OnChanged(CHANGE_ROTATION);
 }
 
 void WOrientation::SetToRotation(const WOrientation* const device) {
@@ -70,7 +78,7 @@ void WOrientation::SetToRotation(const WOrientation* const device) {
 	m_up = device->GetUVector();
 	m_right = device->GetRVector();
 
-	OnStateChange(CHANGE_ROTATION);
+	_OnChanged(CHANGE_ROTATION);
 }
 
 void WOrientation::SetULRVectors(WVector3 up, WVector3 look, WVector3 right) {
@@ -78,7 +86,7 @@ void WOrientation::SetULRVectors(WVector3 up, WVector3 look, WVector3 right) {
 	m_look = look;
 	m_right = right;
 
-	OnStateChange(CHANGE_ROTATION);
+	_OnChanged(CHANGE_ROTATION);
 }
 
 void WOrientation::SetToTransformation(WMatrix mtx) {
@@ -88,7 +96,7 @@ void WOrientation::SetToTransformation(WMatrix mtx) {
 	m_up    = WVector3(mtx(0, 1), mtx(1, 1), mtx(2, 1));
 	m_look  = WVector3(mtx(0, 2), mtx(1, 2), mtx(2, 2));
 
-	OnStateChange(CHANGE_ROTATION | CHANGE_MOTION);
+	_OnChanged(CHANGE_ROTATION | CHANGE_MOTION);
 }
 
 void WOrientation::Yaw(float angle) {
@@ -100,7 +108,7 @@ void WOrientation::Yaw(float angle) {
 	m_right = WVec3TransformCoord(m_right, T);
 	m_look = WVec3TransformCoord(m_look, T);
 
-	OnStateChange(CHANGE_ROTATION);
+	_OnChanged(CHANGE_ROTATION);
 }
 
 void WOrientation::Roll(float angle) {
@@ -112,7 +120,7 @@ void WOrientation::Roll(float angle) {
 	m_right = WVec3TransformCoord(m_right, T);
 	m_up = WVec3TransformCoord(m_up, T);
 
-	OnStateChange(CHANGE_ROTATION);
+	_OnChanged(CHANGE_ROTATION);
 }
 
 void WOrientation::Pitch(float angle) {
@@ -124,28 +132,28 @@ void WOrientation::Pitch(float angle) {
 	m_up = WVec3TransformCoord(m_up, T);
 	m_look = WVec3TransformCoord(m_look, T);
 
-	OnStateChange(CHANGE_ROTATION);
+	_OnChanged(CHANGE_ROTATION);
 }
 
 void WOrientation::Move(float units) {
 	//increase on the forward axis to move forward
 	m_pos += m_look * units;
 
-	OnStateChange(CHANGE_MOTION);
+	_OnChanged(CHANGE_MOTION);
 }
 
 void WOrientation::Strafe(float units) {
 	//increase on the right axis to strafe
 	m_pos += m_right * units;
 
-	OnStateChange(CHANGE_MOTION);
+	_OnChanged(CHANGE_MOTION);
 }
 
 void WOrientation::Fly(float units) {
 	//increase on the forward axis to fly
 	m_pos += m_up * units;
 
-	OnStateChange(CHANGE_MOTION);
+	_OnChanged(CHANGE_MOTION);
 }
 
 float WOrientation::GetPositionX() const {
@@ -245,10 +253,18 @@ WVector3 WOrientation::GetRVector() const {
 void WOrientation::SetBindingMatrix(WMatrix mtx) {
 	m_bBind = true;
 	m_bindMtx = mtx;
+	m_version++;
+
+	OnStateChange(CHANGE_MOTION);
 }
 
 void WOrientation::RemoveBinding() {
-	m_bBind = false;
+	if (m_bBind) {
+		m_bBind = false;
+		m_version++;
+
+		OnStateChange(CHANGE_MOTION);
+	}
 }
 
 WMatrix WOrientation::GetBindingMatrix() const {
@@ -269,33 +285,71 @@ void WOrientation::OnStateChange(STATE_CHANGE_TYPE type) {
 
 		m_right = WVec3Cross(m_up, m_look);
 		m_right = WVec3Normalize(m_right);
+
+		m_transformationDirty = true;
+		m_inverseTransformationDirty = true;
 	}
 }
 
 WMatrix WOrientation::ComputeTransformation() const {
-	WMatrix worldM = ComputeInverseTransformation();
-	return WMatrixInverse(worldM);
+	if (m_transformationDirty) {
+		m_transformationDirty = false;
+
+		// the rows of the world matrix are the (orthonormal) axes followed by
+		// the position, so it is built directly without an inverse
+		WMatrix& worldM = m_transformation;
+		worldM(0, 0) = m_right.x; worldM(0, 1) = m_right.y; worldM(0, 2) = m_right.z; worldM(0, 3) = 0.0f;
+		worldM(1, 0) = m_up.x;    worldM(1, 1) = m_up.y;    worldM(1, 2) = m_up.z;    worldM(1, 3) = 0.0f;
+		worldM(2, 0) = m_look.x;  worldM(2, 1) = m_look.y;  worldM(2, 2) = m_look.z;  worldM(2, 3) = 0.0f;
+		worldM(3, 0) = m_pos.x;   worldM(3, 1) = m_pos.y;   worldM(3, 2) = m_pos.z;   worldM(3, 3) = 1.0f;
+	}
+	return m_transformation;
 }
 
 WMatrix WOrientation::ComputeInverseTransformation() const {
-	WMatrix worldM;
-	WVector3 _up = GetUVector();
-	WVector3 _look = GetLVector();
-	WVector3 _right = GetRVector();
-	WVector3 _pos = GetPosition();
-
-	//
-	//the world matrix is the view matrix's inverse
-	//so we build a normal view matrix and invert it
-	//
-
-	//build world matrix
-	float x = -WVec3Dot(_right, _pos);
-	float y = -WVec3Dot(_up, _pos);
-	float z = -WVec3Dot(_look, _pos);
-	(worldM)(0, 0) = _right.x; (worldM)(0, 1) = _up.x; (worldM)(0, 2) = _look.x; (worldM)(0, 3) = 0.0f;
-	(worldM)(1, 0) = _right.y; (worldM)(1, 1) = _up.y; (worldM)(1, 2) = _look.y; (worldM)(1, 3) = 0.0f;
-	(worldM)(2, 0) = _right.z; (worldM)(2, 1) = _up.z; (worldM)(2, 2) = _look.z; (worldM)(2, 3) = 0.0f;
-	(worldM)(3, 0) = x;        (worldM)(3, 1) = y;     (worldM)(3, 2) = z;       (worldM)(3, 3) = 1.0f;
-	return worldM;
+	if (m_inverseTransformationDirty) {
+		m_inverseTransformationDirty = false;
+
+		// the view matrix: the transpose of the axes and the position
+		// projected onto them
+		WMatrix& viewM = m_inverseTransformation;
+		viewM(0, 0) = m_right.x; viewM(0, 1) = m_up.x; viewM(0, 2) = m_look.x; viewM(0, 3) = 0.0f;
+		viewM(1, 0) = m_right.y; viewM(1, 1) = m_up.y; viewM(1, 2) = m_look.y; viewM(1, 3) = 0.0f;
+		viewM(2, 0) = m_right.z; viewM(2, 1) = m_up.z; viewM(2, 2) = m_look.z; viewM(2, 3) = 0.0f;
+		viewM(3, 0) = -WVec3Dot(m_right, m_pos);
+		viewM(3, 1) = -WVec3Dot(m_up, m_pos);
+		viewM(3, 2) = -WVec3Dot(m_look, m_pos);
+		viewM(3, 3) = 1.0f;
+	}
+	return m_inverseTransformation;
+}
+
+WMatrix WOrientation::ComputeWorldTransformation() const {
+	if (m_bBind)
+		return ComputeTransformation() * m_bindMtx;
+	return ComputeTransformation();
+}
+
+WVector3 WOrientation::GetWorldPosition() const {
+	if (!m_bBind)
+		return GetPosition();
+	return WVec3TransformCoord(GetPosition(), m_bindMtx);
+}
+
+WVector3 WOrientation::GetWorldLVector() const {
+	if (!m_bBind)
+		return GetLVector();
+	return WVec3Normalize(WVec3TransformNormal(GetLVector(), m_bindMtx));
+}
+
+uint32_t WOrientation::GetVersion() const {
+	return m_version;
+}
+
+void WOrientation::_OnChanged(STATE_CHANGE_TYPE type) {
+	m_transformationDirty = true;
+	m_inverseTransformationDirty = true;
+	m_version++;
+
+	OnStateChange(type);
 }
@@ -0,0 +1,190 @@
+#include "Wasabi/Core/WTransformHierarchy.hpp"
+#include "Wasabi/Core/WCore.hpp"
+#include "Wasabi/Core/WJobSystem.hpp"
+
+#include <algorithm>
+
+namespace {
+	/** Minimum number of nodes in a parallel task, smaller runs of subtrees are merged */
+	const uint32_t MIN_NODES_PER_TASK = 256;
+	/** Number of tasks aimed for per thread, to balance uneven subtrees */
+	const uint32_t TASKS_PER_THREAD = 4;
+};
+
+WTransformHierarchy::WTransformHierarchy(Wasabi* const app) : m_app(app) {
+	m_structureChanged = false;
+}
+
+WTransformHierarchy::~WTransformHierarchy() {
+	for (auto& it : m_links)
+		it.first->m_hierarchy = nullptr;
+}
+
+WError WTransformHierarchy::SetParent(WOrientation* child, WOrientation* parent) {
+	if (!child || child == parent)
+		return WError(W_INVALIDPARAM);
+	for (WOrientation* ancestor = GetParent(parent); ancestor; ancestor = GetParent(ancestor)) {
+		if (ancestor == child)
+			return WError(W_INVALIDPARAM);
+	}
+
+	WOrientation* oldParent = GetParent(child);
+	if (oldParent == parent)
+		return WError(W_SUCCEEDED);
+
+	if (oldParent) {
+		std::vector<WOrientation*>& siblings = m_links[oldParent].children;
+		siblings.erase(std::find(siblings.begin(), siblings.end(), child));
+		_RemoveIfIsolated(oldParent);
+	}
+
+	if (parent) {
+		NODE_LINKS& childLinks = m_links[child];
+		childLinks.parent = parent;
+		child->m_hierarchy = this;
+		auto parentLinks = m_links.find(parent);
+		if (parentLinks == m_links.end())
+			parentLinks = m_links.insert(std::make_pair(parent, NODE_LINKS({ nullptr, {} }))).first;
+		parentLinks->second.children.push_back(child);
+		parent->m_hierarchy = this;
+	} else {
+		m_links[child].parent = nullptr;
+		child->RemoveBinding();
+		_RemoveIfIsolated(child);
+	}
+
+	m_structureChanged = true;
+	return WError(W_SUCCEEDED);
+}
+
+WOrientation* WTransformHierarchy::GetParent(const WOrientation* child) const {
+	auto it = m_links.find(const_cast<WOrientation*>(child));
+	return it == m_links.end() ? nullptr : it->second.parent;
+}
+
+void WTransformHierarchy::GetChildren(const WOrientation* parent, std::vector<WOrientation*>& children) const {
+	auto it = m_links.find(const_cast<WOrientation*>(parent));
+	if (it == m_links.end())
+		children.clear();
+	else
+		children = it->second.children;
+}
+
+uint32_t WTransformHierarchy::GetNumNodes() const {
+	return (uint32_t)m_links.size();
+}
+
+void WTransformHierarchy::Update() {
+	W_PROFILE_ZONE(m_app, "TransformHierarchy::Update");
+
+	if (m_structureChanged)
+		_Rebuild();
+	if (m_nodes.size() == 0)
+		return;
+
+	m_app->JobSystem->ParallelFor((uint32_t)m_taskStarts.size() - 1, 1, [this](uint32_t begin, uint32_t end) {
+		_UpdateRange(m_taskStarts[begin], m_taskStarts[end]);
+	});
+
+	// hand the new world transformations to the children, this calls
+	// OnStateChange() on them so it is done on this thread
+	for (uint32_t i = 0; i < m_nodes.size(); i++) {
+		if (!m_changed[i])
+			continue;
+		uint32_t parent = m_parents[i];
+		if (parent != NO_PARENT && m_changed[parent])
+			m_nodes[i]->SetBindingMatrix(m_worldMatrices[parent]);
+		m_versions[i] = m_nodes[i]->GetVersion();
+	}
+}
+
+void WTransformHierarchy::_Rebuild() {
+	m_structureChanged = false;
+
+	uint32_t numThreads = m_app->JobSystem->GetNumWorkers() + 1;
+	uint32_t nodesPerTask = std::max(MIN_NODES_PER_TASK, (uint32_t)m_links.size() / (numThreads * TASKS_PER_THREAD));
+
+	m_nodes.clear();
+	m_parents.clear();
+	m_taskStarts.clear();
+	m_taskStarts.push_back(0);
+	std::vector<std::pair<WOrientation*, uint32_t>> stack;
+	for (auto& root : m_links) {
+		if (root.second.parent)
+			continue;
+
+		// depth-first walk, so the subtree of every node is contiguous
+		stack.push_back(std::make_pair(root.first, NO_PARENT));
+		while (stack.size() > 0) {
+			WOrientation* node = stack.back().first;
+			uint32_t parent = stack.back().second;
+			stack.pop_back();
+
+			uint32_t index = (uint32_t)m_nodes.size();
+			m_nodes.push_back(node);
+			m_parents.push_back(parent);
+			const std::vector<WOrientation*>& children = m_links[node].children;
+			for (auto child = children.rbegin(); child != children.rend(); child++)
+				stack.push_back(std::make_pair(*child, index));
+		}
+
+		if (m_nodes.size() - m_taskStarts.back() >= nodesPerTask)
+			m_taskStarts.push_back((uint32_t)m_nodes.size());
+	}
+	if (m_taskStarts.back() != m_nodes.size())
+		m_taskStarts.push_back((uint32_t)m_nodes.size());
+
+	// all nodes are recomputed on the next update
+	m_worldMatrices.resize(m_nodes.size());
+	m_changed.assign(m_nodes.size(), 0);
+	m_versions.resize(m_nodes.size());
+	for (uint32_t i = 0; i < m_nodes.size(); i++)
+		m_versions[i] = m_nodes[i]->GetVersion() - 1;
+}
+
+void WTransformHierarchy::_UpdateRange(uint32_t begin, uint32_t end) {
+	for (uint32_t i = begin; i < end; i++) {
+		WOrientation* node = m_nodes[i];
+		uint32_t parent = m_parents[i];
+		bool changed = node->GetVersion() != m_versions[i] || (parent != NO_PARENT && m_changed[parent]);
+		m_changed[i] = changed ? 1 : 0;
+		if (!changed)
+			continue;
+
+		if (parent == NO_PARENT)
+			m_worldMatrices[i] = node->ComputeWorldTransformation();
+		else
+			m_worldMatrices[i] = node->ComputeTransformation() * m_worldMatrices[parent];
+	}
+}
+
+void WTransformHierarchy::_RemoveIfIsolated(WOrientation* node) {
+	auto it = m_links.find(node);
+	if (it != m_links.end() && !it->second.parent && it->second.children.size() == 0) {
+		node->m_hierarchy = nullptr;
+		m_links.erase(it);
+	}
+}
+
+void WTransformHierarchy::_OnDestroyed(WOrientation* node) {
+	auto it = m_links.find(node);
+	if (it == m_links.end())
+		return;
+
+	WOrientation* parent = it->second.parent;
+	std::vector<WOrientation*> children = it->second.children;
+	m_links.erase(it);
+
+	for (auto child : children) {
+		m_links[child].parent = nullptr;
+		child->RemoveBinding();
+		_RemoveIfIsolated(child);
+	}
+	if (parent) {
+		std::vector<WOrientation*>& siblings = m_links[parent].children;
+		siblings.erase(std::find(siblings.begin(), siblings.end(), node));
+		_RemoveIfIsolated(parent);
+	}
+
+	m_structureChanged = true;
+}
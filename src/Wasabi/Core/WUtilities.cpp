@@ -225,3 +225,18 @@ float WUtil::frand_0_1() {
 float WUtil::flerp(float x, float y, float f) {
 	return x * (1 - f) + y * f;
 }
+
+std::string WUtil::EscapeJSON(const std::string& str) {
+	std::string escaped;
+	escaped.reserve(str.size());
+	for (char c : str) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+			escaped += c;
+		} else if ((unsigned char)c < 0x20)
+			escaped += ' ';
+		else
+			escaped += c;
+	}
+	return escaped;
+}
@@ -1,6 +1,7 @@
 #include "Wasabi/Geometries/WGeometry.hpp"
 #include "Wasabi/Renderers/WRenderer.hpp"
 #include "Wasabi/Images/WRenderTarget.hpp"
+#include "Wasabi/Objects/WObject.hpp"
 
 const W_VERTEX_DESCRIPTION g_defaultVertexDescriptions[] = {
 	W_VERTEX_DESCRIPTION({ // Vertex buffer
@@ -15,6 +16,9 @@ const W_VERTEX_DESCRIPTION g_defaultVertexDescriptions[] = {
 	})
 };
 
+/** Geometries with fewer triangles are intersected by brute force, without building a BVH */
+static const uint32_t g_minBVHTriangles = 64;
+
 static void ConvertVertices(void* vbFrom, void* vbTo, uint32_t numVerts, W_VERTEX_DESCRIPTION vtxFrom, W_VERTEX_DESCRIPTION vtxTo) {
 	size_t vtxSize = vtxTo.GetSize();
 	size_t fromVtxSize = vtxFrom.GetSize();
@@ -88,14 +92,11 @@ WGeometryManager::WGeometryManager(class Wasabi* const app) : WManager<WGeometry
 WGeometryManager::~WGeometryManager() {
 	// we need to perform this here because some destructed geometries will need access to m_dynamicGeometries
 	// which will be destructed by the time WManager::~WManager() destroys the geometries this way
-	for (uint32_t j = 0; j < W_HASHTABLESIZE; j++) {
-		for (uint32_t i = 0; i < m_entities[j].size();)
-			m_entities[j][i]->RemoveReference();
-		m_entities[j].clear();
-	}
+	_ReleaseEntities();
 }
 
 void WGeometryManager::UpdateDynamicGeometries(uint32_t bufferIndex) const {
+	W_PROFILE_ZONE(m_app, "WGeometryManager::UpdateDynamicGeometries");
 	for (auto it = m_dynamicGeometries.begin(); it != m_dynamicGeometries.end(); it++) {
 		it->first->_PerformPendingMaps(bufferIndex);
 	}
@@ -103,6 +104,8 @@ void WGeometryManager::UpdateDynamicGeometries(uint32_t bufferIndex) const {
 
 WGeometry::WGeometry(Wasabi* const app, uint32_t ID) : WFileAsset(app, ID) {
 	m_mappedVertexBufferForWrite = nullptr;
+	m_bvhEnabled = true;
+	m_bvhNeedsRefit = false;
 	app->GeometryManager->AddEntity(this);
 }
 
@@ -165,6 +168,8 @@ void WGeometry::_DestroyResources() {
 	m_vertices.Destroy(m_app);
 	m_indices.Destroy(m_app);
 	m_animationbuf.Destroy(m_app);
+	m_bvh.Clear();
+	m_bvhNeedsRefit = false;
 }
 
 void WGeometry::_CalcMinMax(void* vb, uint32_t numVerts) {
@@ -187,6 +192,10 @@ void WGeometry::_CalcMinMax(void* vb, uint32_t numVerts) {
 		m_maxPt.y = fmax(m_maxPt.y, v.y);
 		m_maxPt.z = fmax(m_maxPt.z, v.z);
 	}
+
+	// objects using this geometry need their bounds updated in the scene's spatial index
+	if (m_app->ObjectManager)
+		m_app->ObjectManager->_OnGeometryBoundsChanged(this);
 }
 
 void WGeometry::_CalcNormals(void* vb, uint32_t numVerts, void* ib, uint32_t numIndices) {
@@ -947,6 +956,10 @@ WError WGeometry::MapIndexBuffer(void** const ib, W_MAP_FLAGS mapFlags) {
 	if (result != VK_SUCCESS)
 		return WError(W_NOTVALID);
 
+	// the triangles may change, the BVH needs to be rebuilt
+	if (mapFlags & W_MAP_WRITE)
+		m_bvh.Clear();
+
 	_UpdatePendingMap(&m_indices, *ib, bufferIndex, mapFlags);
 
 	return WError(W_SUCCEEDED);
@@ -968,6 +981,7 @@ void WGeometry::UnmapVertexBuffer(bool recalculateBoundingBox) {
 		if (recalculateBoundingBox)
 			_CalcMinMax(m_mappedVertexBufferForWrite, m_numVertices);
 		m_mappedVertexBufferForWrite = nullptr;
+		m_bvhNeedsRefit = m_bvh.Valid();
 	}
 
 	uint32_t bufferIndex = m_app->GetCurrentBufferingIndex();
@@ -1147,16 +1161,10 @@ WError WGeometry::ApplyTransformation(WMatrix mtx) {
 	return WError(W_SUCCEEDED);
 }
 
-bool WGeometry::Intersect(WVector3 p1, WVector3 p2, WVector3* pt, WVector2* uv, uint32_t* triangleIndex) {
+bool WGeometry::Intersect(WVector3 p1, WVector3 p2, WVector3* pt, WVector2* uv, uint32_t* triangleIndex, bool anyHit) {
 	if (!Valid())
 		return false;
 
-	/*
-		Check all triangles, what is intersected will
-		be inserted into the vector intersection, then
-		the closest triangle to p1 will be returned
-	*/
-
 	uint32_t pos_offset = (uint32_t)GetVertexDescription(0).GetOffset("position");
 	uint32_t vtxSize = (uint32_t)GetVertexDescription(0).GetSize();
 	uint32_t uv_offset = (uint32_t)GetVertexDescription(0).GetOffset("uv");
@@ -1171,13 +1179,6 @@ bool WGeometry::Intersect(WVector3 p1, WVector3 p2, WVector3* pt, WVector2* uv,
 	if (uv_size < 8) // if we don't have at least 2 components, ignore UVs
 		uv_offset = std::numeric_limits<uint32_t>::max();
 
-	struct IntersectionInfo {
-		uint32_t index;
-		float u, v;
-		WVector3 point;
-	};
-	vector<IntersectionInfo> intersection;
-
 	void *vb;
 	uint* ib;
 	WError err = MapVertexBuffer(&vb, W_MAP_READ);
@@ -1189,86 +1190,86 @@ bool WGeometry::Intersect(WVector3 p1, WVector3 p2, WVector3* pt, WVector2* uv,
 		return false;
 	}
 
-	for (uint32_t i = 0; i < m_numIndices / 3; i++) {
-		WVector3 v0;
-		WVector3 v1;
-		WVector3 v2;
-		WVector2 uv0 (0, 0);
-		WVector2 uv1 (1, 0);
-		WVector2 uv2 (0, 1);
-		memcpy(&v0, &((char*)vb)[ib[i * 3 + 0] * vtxSize + pos_offset], sizeof(WVector3));
-		memcpy(&v1, &((char*)vb)[ib[i * 3 + 1] * vtxSize + pos_offset], sizeof(WVector3));
-		memcpy(&v2, &((char*)vb)[ib[i * 3 + 2] * vtxSize + pos_offset], sizeof(WVector3));
-		if (uv_offset != std::numeric_limits<uint32_t>::max()) {
-			memcpy(&uv0, &((char*)vb)[ib[i * 3 + 0] * vtxSize + uv_offset], sizeof(WVector2));
-			memcpy(&uv1, &((char*)vb)[ib[i * 3 + 1] * vtxSize + uv_offset], sizeof(WVector2));
-			memcpy(&uv2, &((char*)vb)[ib[i * 3 + 2] * vtxSize + uv_offset], sizeof(WVector2));
-		}
-
-		WVector3 e1, e2, h, s, q;
-		float a, f, u, v;
-
-		e1 = v1 - v0; //vector ( e1, v1, v0 );
-		e2 = v2 - v0; //vector ( e2, v2, v0 );
-		h = WVec3Cross(p2, e2);
-		a = WVec3Dot(e1, h);
-
-		if (a > -0.00001 && a < 0.00001)
-			continue; //no intersection
-
-		f = 1 / a;
-		s = p1 - v0; //vector ( s, p, v0 );
-		u = f * (WVec3Dot(s, h));
-
-		if (u < 0.0 || u > 1.0)
-			continue; //no intersection
-
-		q = WVec3Cross(s, e1);
-		v = f * WVec3Dot(p2, q);
-		if (v < 0.0 || u + v > 1.0)
-			continue; //no intersection
-					  // at this stage we can compute t to find out where
-					  // the intersection point is on the line
-		float t = f * WVec3Dot(e2, q);
-		if (t > 0.00001) // ray intersection
-		{
-			//add this triangle to the intersection vector
-			IntersectionInfo ii;
-			ii.index = i;
-			ii.u = uv0.x * (1-u) + uv1.x * u;
-			ii.v = uv0.y * (1-v) + uv2.y * v;
-			ii.point = v0 + u*(v1 - v0) + v*(v2 - v0);
-
-			intersection.push_back(ii);
-			continue;
-		} else // this means that there is a line intersection
-			   // but not a ray intersection
-			continue;
+	uint32_t numTriangles = m_numIndices / 3;
+	const WGeometryBVH* bvh = nullptr;
+	if (m_bvhEnabled && numTriangles >= g_minBVHTriangles) {
+		if (!m_bvh.Valid())
+			m_bvh.Build(vb, vtxSize, pos_offset, ib, numTriangles);
+		else if (m_bvhNeedsRefit && !m_bvh.Refit(vb, vtxSize, pos_offset))
+			m_bvh.Build(vb, vtxSize, pos_offset, ib, numTriangles); // refitting degraded the tree too much
+		m_bvhNeedsRefit = false;
+		bvh = &m_bvh;
 	}
 
+	bool found = IntersectVertices(vb, vtxSize, pos_offset, uv_offset, ib, numTriangles, bvh, p1, p2, pt, uv, triangleIndex, anyHit);
+
 	UnmapVertexBuffer();
 	UnmapIndexBuffer();
 
-	//no intersection
-	if (!intersection.size())
-		return false;
+	return found;
+}
 
-	//find the closest triangle to p1 and return it's info
-	uint32_t chosen = 0;
-	float ld = WVec3LengthSq(p1 - intersection[0].point);
-	for (uint32_t i = 1; i < intersection.size(); i++) {
-		float fDist = WVec3LengthSq(p1 - intersection[i].point);
-		if (fDist < ld) {
-			ld = fDist;
-			chosen = i;
+bool WGeometry::IntersectVertices(const void* vertices, uint32_t vertexSize, uint32_t positionOffset, uint32_t uvOffset,
+								  const uint32_t* indices, uint32_t numTriangles, const WGeometryBVH* bvh,
+								  WVector3 p1, WVector3 p2, WVector3* pt, WVector2* uv, uint32_t* triangleIndex, bool anyHit) {
+	const char* vb = (const char*)vertices;
+	bool found = false;
+	WGeometryBVH::HIT hit;
+
+	if (bvh)
+		found = bvh->Intersect(p1, p2, anyHit, &hit);
+	else {
+		/*
+			Check all triangles and keep the closest
+			intersection to p1
+		*/
+		hit.t = std::numeric_limits<float>::max();
+		for (uint32_t i = 0; i < numTriangles; i++) {
+			WVector3 v0;
+			WVector3 v1;
+			WVector3 v2;
+			memcpy(&v0, &vb[indices[i * 3 + 0] * vertexSize + positionOffset], sizeof(WVector3));
+			memcpy(&v1, &vb[indices[i * 3 + 1] * vertexSize + positionOffset], sizeof(WVector3));
+			memcpy(&v2, &vb[indices[i * 3 + 2] * vertexSize + positionOffset], sizeof(WVector3));
+
+			float t, u, v;
+			if (WGeometryBVH::IntersectTriangle(p1, p2, v0, v1, v2, &t, &u, &v) && t < hit.t) {
+				hit.triangle = i;
+				hit.t = t;
+				hit.u = u;
+				hit.v = v;
+				hit.point = v0 + u*(v1 - v0) + v*(v2 - v0);
+				found = true;
+				if (anyHit)
+					break;
+			}
 		}
 	}
 
-	if (uv) *uv = WVector2(intersection[chosen].u,  intersection[chosen].v);
-	if (pt) *pt = intersection[chosen].point;
-	if (triangleIndex) *triangleIndex = intersection[chosen].index;
+	if (found) {
+		WVector2 uv0 (0, 0);
+		WVector2 uv1 (1, 0);
+		WVector2 uv2 (0, 1);
+		if (uvOffset != std::numeric_limits<uint32_t>::max()) {
+			memcpy(&uv0, &vb[indices[hit.triangle * 3 + 0] * vertexSize + uvOffset], sizeof(WVector2));
+			memcpy(&uv1, &vb[indices[hit.triangle * 3 + 1] * vertexSize + uvOffset], sizeof(WVector2));
+			memcpy(&uv2, &vb[indices[hit.triangle * 3 + 2] * vertexSize + uvOffset], sizeof(WVector2));
+		}
 
-	return true;
+		if (uv) *uv = WVector2(uv0.x * (1-hit.u) + uv1.x * hit.u, uv0.y * (1-hit.v) + uv2.y * hit.v);
+		if (pt) *pt = hit.point;
+		if (triangleIndex) *triangleIndex = hit.triangle;
+	}
+
+	return found;
+}
+
+void WGeometry::SetIntersectionBVH(bool enable) {
+	m_bvhEnabled = enable;
+	if (!enable) {
+		m_bvh.Clear();
+		m_bvhNeedsRefit = false;
+	}
 }
 
 WError WGeometry::Draw(WRenderTarget* rt, uint32_t numIndices, uint32_t numInstances, bool bind_animation) {
@@ -1282,23 +1283,62 @@ WError WGeometry::Draw(WRenderTarget* rt, uint32_t numIndices, uint32_t numInsta
 	VkBuffer bindings[] = { m_vertices.GetBuffer(m_app, bufferIndex), VK_NULL_HANDLE };
 	if (bind_animation && m_animationbuf.Valid())
 		bindings[1] = m_animationbuf.GetBuffer(m_app, bufferIndex);
-	vkCmdBindVertexBuffers(renderCmdBuffer, 0, bindings[1] == VK_NULL_HANDLE ? 1 : 2, bindings, offsets);
+	_Draw(renderCmdBuffer, bindings[1] == VK_NULL_HANDLE ? 1 : 2, bindings, offsets, numIndices, numInstances);
+
+	return WError(W_SUCCEEDED);
+}
+
+WError WGeometry::Draw(WRenderTarget* rt, const WFrameAllocation& vertices, uint32_t numIndices, uint32_t numInstances) {
+	VkCommandBuffer renderCmdBuffer = rt->GetCommnadBuffer();
+	if (!renderCmdBuffer)
+		return WError(W_NORENDERTARGET);
+	if (!vertices.buffer)
+		return WError(W_INVALIDPARAM);
+
+	VkBuffer bindings[] = { vertices.buffer };
+	VkDeviceSize offsets[] = { vertices.offset };
+	_Draw(renderCmdBuffer, 1, bindings, offsets, numIndices, numInstances);
+
+	return WError(W_SUCCEEDED);
+}
+
+WError WGeometry::DrawIndirect(WRenderTarget* rt, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount,
+							   VkBuffer countBuffer, VkDeviceSize countOffset) {
+	VkCommandBuffer renderCmdBuffer = rt->GetCommnadBuffer();
+	if (!renderCmdBuffer)
+		return WError(W_NORENDERTARGET);
+	if (!buffer || !m_indices.Valid())
+		return WError(W_INVALIDPARAM);
+
+	uint32_t bufferIndex = m_app->GetCurrentBufferingIndex();
+	VkBuffer vertices = m_vertices.GetBuffer(m_app, bufferIndex);
+	VkDeviceSize verticesOffset = 0;
+	vkCmdBindVertexBuffers(renderCmdBuffer, 0, 1, &vertices, &verticesOffset);
+	vkCmdBindIndexBuffer(renderCmdBuffer, m_indices.GetBuffer(m_app, bufferIndex), 0, VK_INDEX_TYPE_UINT32);
+	PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount = m_app->GetVulkanDrawIndexedIndirectCount();
+	if (countBuffer && drawIndexedIndirectCount)
+		drawIndexedIndirectCount(renderCmdBuffer, buffer, offset, countBuffer, countOffset, drawCount, sizeof(VkDrawIndexedIndirectCommand));
+	else
+		vkCmdDrawIndexedIndirect(renderCmdBuffer, buffer, offset, drawCount, sizeof(VkDrawIndexedIndirectCommand));
+
+	return WError(W_SUCCEEDED);
+}
+
+void WGeometry::_Draw(VkCommandBuffer cmdBuf, uint32_t numBindings, VkBuffer* bindings, VkDeviceSize* offsets, uint32_t numIndices, uint32_t numInstances) {
+	vkCmdBindVertexBuffers(cmdBuf, 0, numBindings, bindings, offsets);
 
 	if (m_indices.Valid()) {
 		if (numIndices == std::numeric_limits<uint32_t>::max() || numIndices > m_numIndices)
 			numIndices = m_numIndices;
 		// Bind triangle indices & draw the indexed triangle
-		vkCmdBindIndexBuffer(renderCmdBuffer, m_indices.GetBuffer(m_app, bufferIndex), 0, VK_INDEX_TYPE_UINT32);
-		vkCmdDrawIndexed(renderCmdBuffer, numIndices, numInstances, 0, 0, 0);
+		vkCmdBindIndexBuffer(cmdBuf, m_indices.GetBuffer(m_app, m_app->GetCurrentBufferingIndex()), 0, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(cmdBuf, numIndices, numInstances, 0, 0, 0);
 	} else {
 		if (numIndices == std::numeric_limits<uint32_t>::max() || numIndices > m_numVertices)
 			numIndices = m_numVertices;
 		// render the vertices without indices
-		vkCmdDraw(renderCmdBuffer, numIndices, numInstances, 0, 0);
+		vkCmdDraw(cmdBuf, numIndices, numInstances, 0, 0);
 	}
-
-
-	return WError(W_SUCCEEDED);
 }
 
 WVector3 WGeometry::GetMaxPoint() const {
@@ -0,0 +1,363 @@
+#include "Wasabi/Geometries/WGeometryBVH.hpp"
+
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+	/** Number of bins the centroids are sorted into when looking for a split */
+	const uint32_t NUM_BINS = 12;
+	/** Leaves are never split below this many triangles */
+	const uint32_t MIN_SPLIT_TRIANGLES = 2;
+	/** Leaves larger than this are split even if the heuristic prefers not to */
+	const uint32_t MAX_LEAF_TRIANGLES = 8;
+	/** Build depth after which splits fall back to halving the triangles (bounds the traversal stack) */
+	const uint32_t MAX_SAH_DEPTH = 40;
+	/** Size of the traversal stack, must exceed the maximum tree depth (MAX_SAH_DEPTH + 32 halvings) */
+	const uint32_t TRAVERSAL_STACK_SIZE = 80;
+	/** Cost of traversing a node relative to intersecting a triangle */
+	const float TRAVERSAL_COST = 1.0f;
+	/** A refit whose relative cost exceeds the built cost by this factor is considered degraded */
+	const float REFIT_DEGRADATION_FACTOR = 2.0f;
+
+	struct AABB {
+		WVector3 min, max;
+
+		AABB() : min(FLT_MAX, FLT_MAX, FLT_MAX), max(-FLT_MAX, -FLT_MAX, -FLT_MAX) {}
+
+		void Grow(const WVector3& p) {
+			min = WVector3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+			max = WVector3(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+		}
+		void Grow(const AABB& b) {
+			if (b.min.x <= b.max.x) {
+				Grow(b.min);
+				Grow(b.max);
+			}
+		}
+		float Area() const {
+			if (min.x > max.x)
+				return 0.0f;
+			WVector3 e = max - min;
+			return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+		}
+	};
+
+	struct BUILD_TASK {
+		uint32_t node;
+		uint32_t first;
+		uint32_t count;
+		uint32_t depth;
+	};
+
+	inline float NodeArea(const float* mn, const float* mx) {
+		float ex = mx[0] - mn[0], ey = mx[1] - mn[1], ez = mx[2] - mn[2];
+		return 2.0f * (ex * ey + ey * ez + ez * ex);
+	}
+};
+
+WGeometryBVH::WGeometryBVH() {
+	m_builtCost = 0.0f;
+}
+
+WGeometryBVH::~WGeometryBVH() {
+}
+
+void WGeometryBVH::Build(const void* vb, uint32_t vtxSize, uint32_t posOffset, const uint32_t* ib, uint32_t numTriangles) {
+	Clear();
+	if (numTriangles == 0)
+		return;
+
+	//
+	// Compute the bounds and centroid of every triangle
+	//
+	std::vector<AABB> triBounds(numTriangles);
+	std::vector<WVector3> centroids(numTriangles);
+	std::vector<uint32_t> order(numTriangles);
+	for (uint32_t i = 0; i < numTriangles; i++) {
+		for (uint32_t j = 0; j < 3; j++) {
+			WVector3 p;
+			memcpy(&p, &((const char*)vb)[ib[i * 3 + j] * vtxSize + posOffset], sizeof(WVector3));
+			triBounds[i].Grow(p);
+		}
+		centroids[i] = (triBounds[i].min + triBounds[i].max) * 0.5f;
+		order[i] = i;
+	}
+
+	//
+	// Build top-down, splitting every node at the cheapest binned SAH split
+	//
+	m_nodes.reserve(numTriangles * 2);
+	m_nodes.push_back(NODE());
+	std::vector<BUILD_TASK> tasks;
+	tasks.push_back({ 0, 0, numTriangles, 0 });
+	while (tasks.size() > 0) {
+		BUILD_TASK task = tasks.back();
+		tasks.pop_back();
+
+		AABB bounds, centroidBounds;
+		for (uint32_t i = task.first; i < task.first + task.count; i++) {
+			bounds.Grow(triBounds[order[i]]);
+			centroidBounds.Grow(centroids[order[i]]);
+		}
+		NODE& node = m_nodes[task.node];
+		memcpy(node.min, &bounds.min, sizeof(node.min));
+		memcpy(node.max, &bounds.max, sizeof(node.max));
+		node.firstChildOrTriangle = task.first;
+		node.numTriangles = task.count;
+
+		if (task.count < MIN_SPLIT_TRIANGLES)
+			continue;
+
+		uint32_t mid = task.first;
+		WVector3 extent = centroidBounds.max - centroidBounds.min;
+		if (task.depth < MAX_SAH_DEPTH) {
+			// find the cheapest split over all axes
+			float bestCost = FLT_MAX;
+			int bestAxis = -1;
+			uint32_t bestSplit = 0;
+			for (int axis = 0; axis < 3; axis++) {
+				if (extent.components[axis] <= 0.0f)
+					continue;
+
+				AABB binBounds[NUM_BINS];
+				uint32_t binCounts[NUM_BINS] = { 0 };
+				float scale = (float)NUM_BINS / extent.components[axis];
+				for (uint32_t i = task.first; i < task.first + task.count; i++) {
+					uint32_t bin = std::min(NUM_BINS - 1, (uint32_t)((centroids[order[i]].components[axis] - centroidBounds.min.components[axis]) * scale));
+					binCounts[bin]++;
+					binBounds[bin].Grow(triBounds[order[i]]);
+				}
+
+				// sweep from the right to get the cost of all right sides, then from the left
+				float rightAreas[NUM_BINS];
+				uint32_t rightCounts[NUM_BINS];
+				AABB right;
+				uint32_t rightCount = 0;
+				for (uint32_t b = NUM_BINS - 1; b > 0; b--) {
+					right.Grow(binBounds[b]);
+					rightCount += binCounts[b];
+					rightAreas[b] = right.Area();
+					rightCounts[b] = rightCount;
+				}
+				AABB left;
+				uint32_t leftCount = 0;
+				for (uint32_t b = 0; b < NUM_BINS - 1; b++) {
+					left.Grow(binBounds[b]);
+					leftCount += binCounts[b];
+					if (leftCount == 0 || rightCounts[b + 1] == 0)
+						continue;
+					float cost = left.Area() * (float)leftCount + rightAreas[b + 1] * (float)rightCounts[b + 1];
+					if (cost < bestCost) {
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = b + 1;
+					}
+				}
+			}
+
+			if (bestAxis == -1)
+				continue; // all centroids coincide, splitting won't help
+
+			float leafCost = bounds.Area() * (float)task.count;
+			bestCost = TRAVERSAL_COST * bounds.Area() + bestCost;
+			if (bestCost >= leafCost && task.count <= MAX_LEAF_TRIANGLES)
+				continue;
+
+			float scale = (float)NUM_BINS / extent.components[bestAxis];
+			auto it = std::partition(order.begin() + task.first, order.begin() + task.first + task.count, [&](uint32_t tri) {
+				uint32_t bin = std::min(NUM_BINS - 1, (uint32_t)((centroids[tri].components[bestAxis] - centroidBounds.min.components[bestAxis]) * scale));
+				return bin < bestSplit;
+			});
+			mid = (uint32_t)(it - order.begin());
+		}
+
+		if (mid == task.first || mid == task.first + task.count) {
+			// too deep (or the split was degenerate), split the triangles in half along the widest axis
+			int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+			mid = task.first + task.count / 2;
+			std::nth_element(order.begin() + task.first, order.begin() + mid, order.begin() + task.first + task.count, [&](uint32_t a, uint32_t b) {
+				return centroids[a].components[axis] < centroids[b].components[axis];
+			});
+		}
+
+		uint32_t firstChild = (uint32_t)m_nodes.size();
+		m_nodes[task.node].firstChildOrTriangle = firstChild;
+		m_nodes[task.node].numTriangles = 0;
+		m_nodes.push_back(NODE());
+		m_nodes.push_back(NODE());
+		tasks.push_back({ firstChild, task.first, mid - task.first, task.depth + 1 });
+		tasks.push_back({ firstChild + 1, mid, task.first + task.count - mid, task.depth + 1 });
+	}
+	m_nodes.shrink_to_fit();
+
+	//
+	// Store the triangles in leaf order so that leaves reference contiguous ranges
+	//
+	m_positions.resize(numTriangles * 3);
+	m_indices.resize(numTriangles * 3);
+	m_triangleIds = order;
+	for (uint32_t i = 0; i < numTriangles; i++) {
+		for (uint32_t j = 0; j < 3; j++) {
+			m_indices[i * 3 + j] = ib[order[i] * 3 + j];
+			memcpy(&m_positions[i * 3 + j], &((const char*)vb)[m_indices[i * 3 + j] * vtxSize + posOffset], sizeof(WVector3));
+		}
+	}
+
+	m_builtCost = _ComputeRelativeCost();
+}
+
+bool WGeometryBVH::Refit(const void* vb, uint32_t vtxSize, uint32_t posOffset) {
+	if (!Valid())
+		return false;
+
+	for (uint32_t i = 0; i < m_indices.size(); i++)
+		memcpy(&m_positions[i], &((const char*)vb)[m_indices[i] * vtxSize + posOffset], sizeof(WVector3));
+
+	// children are always stored after their parent, so a reverse sweep is bottom-up
+	for (uint32_t n = (uint32_t)m_nodes.size(); n-- > 0;) {
+		NODE& node = m_nodes[n];
+		AABB bounds;
+		if (node.numTriangles > 0) {
+			for (uint32_t i = node.firstChildOrTriangle * 3; i < (node.firstChildOrTriangle + node.numTriangles) * 3; i++)
+				bounds.Grow(m_positions[i]);
+		} else {
+			for (uint32_t c = 0; c < 2; c++) {
+				const NODE& child = m_nodes[node.firstChildOrTriangle + c];
+				bounds.Grow(WVector3(child.min[0], child.min[1], child.min[2]));
+				bounds.Grow(WVector3(child.max[0], child.max[1], child.max[2]));
+			}
+		}
+		memcpy(node.min, &bounds.min, sizeof(node.min));
+		memcpy(node.max, &bounds.max, sizeof(node.max));
+	}
+
+	return _ComputeRelativeCost() <= m_builtCost * REFIT_DEGRADATION_FACTOR;
+}
+
+void WGeometryBVH::Clear() {
+	m_nodes.clear();
+	m_positions.clear();
+	m_indices.clear();
+	m_triangleIds.clear();
+	m_builtCost = 0.0f;
+}
+
+bool WGeometryBVH::Intersect(WVector3 origin, WVector3 direction, bool anyHit, HIT* hit) const {
+	if (!Valid())
+		return false;
+
+	// a tiny direction component (instead of 0) keeps the slab test free of NaNs
+	float invDir[3];
+	for (uint32_t i = 0; i < 3; i++) {
+		float d = direction.components[i];
+		if (std::abs(d) < 1e-20f)
+			d = d < 0.0f ? -1e-20f : 1e-20f;
+		invDir[i] = 1.0f / d;
+	}
+
+	// returns the entry distance of the ray into the node, FLT_MAX if it misses it or enters past maxT
+	auto intersectNode = [&](const NODE& node, float maxT) {
+		float tmin = 0.0f, tmax = maxT;
+		for (uint32_t i = 0; i < 3; i++) {
+			float t1 = (node.min[i] - origin.components[i]) * invDir[i];
+			float t2 = (node.max[i] - origin.components[i]) * invDir[i];
+			tmin = std::max(tmin, std::min(t1, t2));
+			tmax = std::min(tmax, std::max(t1, t2));
+		}
+		return tmin <= tmax ? tmin : FLT_MAX;
+	};
+
+	bool found = false;
+	float closestT = FLT_MAX;
+	uint32_t stack[TRAVERSAL_STACK_SIZE];
+	uint32_t stackSize = 0;
+	if (intersectNode(m_nodes[0], closestT) != FLT_MAX)
+		stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const NODE& node = m_nodes[stack[--stackSize]];
+
+		if (node.numTriangles > 0) {
+			for (uint32_t i = node.firstChildOrTriangle; i < node.firstChildOrTriangle + node.numTriangles; i++) {
+				float t, u, v;
+				const WVector3* tri = &m_positions[i * 3];
+				if (IntersectTriangle(origin, direction, tri[0], tri[1], tri[2], &t, &u, &v) && t < closestT) {
+					closestT = t;
+					found = true;
+					if (hit) {
+						hit->triangle = m_triangleIds[i];
+						hit->t = t;
+						hit->u = u;
+						hit->v = v;
+						hit->point = tri[0] + u * (tri[1] - tri[0]) + v * (tri[2] - tri[0]);
+					}
+					if (anyHit)
+						return true;
+				}
+			}
+			continue;
+		}
+
+		// visit the nearer child first (push it last)
+		uint32_t nearChild = node.firstChildOrTriangle, farChild = nearChild + 1;
+		float nearT = intersectNode(m_nodes[nearChild], closestT);
+		float farT = intersectNode(m_nodes[farChild], closestT);
+		if (farT < nearT) {
+			std::swap(nearChild, farChild);
+			std::swap(nearT, farT);
+		}
+		if (farT != FLT_MAX)
+			stack[stackSize++] = farChild;
+		if (nearT != FLT_MAX)
+			stack[stackSize++] = nearChild;
+	}
+
+	return found;
+}
+
+bool WGeometryBVH::Valid() const {
+	return m_nodes.size() > 0;
+}
+
+size_t WGeometryBVH::GetMemorySize() const {
+	return m_nodes.size() * sizeof(NODE) + m_positions.size() * sizeof(WVector3) +
+		m_indices.size() * sizeof(uint32_t) + m_triangleIds.size() * sizeof(uint32_t);
+}
+
+bool WGeometryBVH::IntersectTriangle(const WVector3& origin, const WVector3& direction,
+									 const WVector3& v0, const WVector3& v1, const WVector3& v2,
+									 float* t, float* u, float* v) {
+	WVector3 e1 = v1 - v0;
+	WVector3 e2 = v2 - v0;
+	WVector3 h = WVec3Cross(direction, e2);
+	float a = WVec3Dot(e1, h);
+	if (a > -0.00001 && a < 0.00001)
+		return false; // ray is parallel to the triangle
+
+	float f = 1 / a;
+	WVector3 s = origin - v0;
+	*u = f * WVec3Dot(s, h);
+	if (*u < 0.0 || *u > 1.0)
+		return false;
+
+	WVector3 q = WVec3Cross(s, e1);
+	*v = f * WVec3Dot(direction, q);
+	if (*v < 0.0 || *u + *v > 1.0)
+		return false;
+
+	// the line intersects the triangle, make sure it's in front of the ray's origin
+	*t = f * WVec3Dot(e2, q);
+	return *t > 0.00001;
+}
+
+float WGeometryBVH::_ComputeRelativeCost() const {
+	float rootArea = NodeArea(m_nodes[0].min, m_nodes[0].max);
+	if (rootArea <= 0.0f)
+		return 0.0f;
+
+	float totalArea = 0.0f;
+	for (auto node = m_nodes.begin(); node != m_nodes.end(); node++)
+		totalArea += NodeArea(node->min, node->max);
+	return totalArea / rootArea;
+}
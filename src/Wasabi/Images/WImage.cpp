@@ -40,11 +40,7 @@ WImageManager::~WImageManager() {
 
 	// we need to perform this here because some destructed images will need access to m_dynamicImages
 	// which will be destructed by the time WManager::~WManager() destroys the images this way
-	for (uint32_t j = 0; j < W_HASHTABLESIZE; j++) {
-		for (uint32_t i = 0; i < m_entities[j].size();)
-			m_entities[j][i]->RemoveReference();
-		m_entities[j].clear();
-	}
+	_ReleaseEntities();
 }
 
 WError WImageManager::Load() {
@@ -112,6 +108,7 @@ WImage* WImageManager::CreateImage(WImage* const image, W_IMAGE_CREATE_FLAGS fla
 }
 
 void WImageManager::UpdateDynamicImages(uint32_t bufferIndex) const {
+	W_PROFILE_ZONE(m_app, "WImageManager::UpdateDynamicImages");
 	for (auto it = m_dynamicImages.begin(); it != m_dynamicImages.end(); it++) {
 		it->first->_PerformPendingMap(bufferIndex);
 	}
@@ -184,6 +181,7 @@ WError WImage::CreateFromPixelsArray(
 	if (flags & W_IMAGE_CREATE_TEXTURE) usageFlags |= VK_IMAGE_USAGE_SAMPLED_BIT;
 	if (flags & W_IMAGE_CREATE_DYNAMIC) usageFlags |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 	if (flags & W_IMAGE_CREATE_RENDER_TARGET_ATTACHMENT) usageFlags |= (isDepth ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+	if (flags & W_IMAGE_CREATE_STORAGE) usageFlags |= VK_IMAGE_USAGE_STORAGE_BIT;
 	W_MEMORY_STORAGE memory = flags & W_IMAGE_CREATE_DYNAMIC ? W_MEMORY_HOST_VISIBLE : W_MEMORY_DEVICE_LOCAL;
 	uint32_t numBuffers = (flags & (W_IMAGE_CREATE_DYNAMIC | W_IMAGE_CREATE_RENDER_TARGET_ATTACHMENT)) ? m_app->GetEngineParam<uint32_t>("bufferingCount") : 1;
 	VkResult result = m_bufferedImage.Create(m_app, numBuffers, width, height, depth, WBufferedImageProperties(format, memory, usageFlags, arraySize), pixels);
@@ -3,6 +3,18 @@
 #include "Wasabi/Cameras/WCamera.hpp"
 #include "Wasabi/Renderers/WRenderer.hpp"
 
+#include <algorithm>
+#include <atomic>
+
+namespace {
+	/** Render target the current thread is recording a chunk of, see WRenderTarget::RecordInParallel() */
+	thread_local const WRenderTarget* threadRenderTarget = nullptr;
+	/** Secondary command buffer the current thread is recording the chunk into */
+	thread_local VkCommandBuffer threadCmdBuffer = VK_NULL_HANDLE;
+	/** Number of chunks aimed for per thread, to balance uneven chunks */
+	const uint32_t CHUNKS_PER_THREAD = 4;
+};
+
 WRenderTargetManager::WRenderTargetManager(Wasabi* const app) : WManager<WRenderTarget>(app) {
 }
 
@@ -34,7 +46,11 @@ WRenderTarget::WRenderTarget(Wasabi* const app, uint32_t ID) : WBase(app, ID) {
 	m_depthTarget = nullptr;
 	m_renderCmdBuffer = VK_NULL_HANDLE;
 	m_renderPass = VK_NULL_HANDLE;
-	m_pipelineCache = VK_NULL_HANDLE;
+	m_loadRenderPass = VK_NULL_HANDLE;
+	m_currentFrameBuffer = VK_NULL_HANDLE;
+	m_secondaryCmdBuffer = VK_NULL_HANDLE;
+	m_width = 0;
+	m_height = 0;
 
 	m_app->RenderTargetManager->AddEntity(this);
 }
@@ -70,7 +86,7 @@ bool WRenderTarget::Valid() const {
 
 void WRenderTarget::_DestroyResources() {
 	m_app->MemoryManager->ReleaseRenderPass(m_renderPass, m_app->GetCurrentBufferingIndex());
-	m_app->MemoryManager->ReleasePipelineCache(m_pipelineCache, m_app->GetCurrentBufferingIndex());
+	m_app->MemoryManager->ReleaseRenderPass(m_loadRenderPass, m_app->GetCurrentBufferingIndex());
 	m_app->MemoryManager->ReleaseCommandBuffer(m_renderCmdBuffer, m_app->GetCurrentBufferingIndex());
 	m_bufferedFrameBuffer.Destroy(m_app);
 
@@ -111,15 +127,6 @@ WError WRenderTarget::Create(uint32_t width, uint32_t height, vector<class WImag
 		}
 	}
 
-	// create pipeline cache
-	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
-	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-	err = vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &m_pipelineCache);
-	if (err != VK_SUCCESS) {
-		_DestroyResources();
-		return WError(W_OUTOFMEMORY);
-	}
-
 	//
 	// Create the render pass
 	//
@@ -183,7 +190,7 @@ WError WRenderTarget::Create(uint32_t width, uint32_t height, vector<class WImag
 	renderPassInfo.dependencyCount = 0;
 	renderPassInfo.pDependencies = NULL;
 
-	err = vkCreateRenderPass(device, &renderPassInfo, nullptr, &m_renderPass);
+	err = _CreateRenderPasses(renderPassInfo);
 	if (err != VK_SUCCESS) {
 		_DestroyResources();
 		return WError(W_OUTOFMEMORY);
@@ -244,15 +251,6 @@ WError WRenderTarget::Create(uint32_t width, uint32_t height, VkImageView* views
 		}
 	}
 
-	// create pipeline cache
-	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
-	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-	err = vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &m_pipelineCache);
-	if (err != VK_SUCCESS) {
-		_DestroyResources();
-		return WError(W_OUTOFMEMORY);
-	}
-
 	//
 	// Create the render pass
 	//
@@ -308,7 +306,7 @@ WError WRenderTarget::Create(uint32_t width, uint32_t height, VkImageView* views
 	renderPassInfo.dependencyCount = 0;
 	renderPassInfo.pDependencies = NULL;
 
-	err = vkCreateRenderPass(device, &renderPassInfo, nullptr, &m_renderPass);
+	err = _CreateRenderPasses(renderPassInfo);
 	if (err != VK_SUCCESS) {
 		_DestroyResources();
 		return WError(W_OUTOFMEMORY);
@@ -330,7 +328,22 @@ WError WRenderTarget::Create(uint32_t width, uint32_t height, VkImageView* views
 	return WError(W_SUCCEEDED);
 }
 
-WError WRenderTarget::Begin() {
+VkResult WRenderTarget::_CreateRenderPasses(VkRenderPassCreateInfo renderPassInfo) {
+	VkDevice device = m_app->GetVulkanDevice();
+	VkResult err = vkCreateRenderPass(device, &renderPassInfo, nullptr, &m_renderPass);
+	if (err != VK_SUCCESS)
+		return err;
+
+	// the frame buffers are compatible with both passes, since load operations
+	// don't affect render pass compatibility
+	vector<VkAttachmentDescription> attachmentDescs(renderPassInfo.pAttachments, renderPassInfo.pAttachments + renderPassInfo.attachmentCount);
+	for (auto& attachment : attachmentDescs)
+		attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	renderPassInfo.pAttachments = attachmentDescs.data();
+	return vkCreateRenderPass(device, &renderPassInfo, nullptr, &m_loadRenderPass);
+}
+
+WError WRenderTarget::Begin(bool clear) {
 	if (m_renderCmdBuffer != VK_NULL_HANDLE) {
 		VkResult err = vkResetCommandBuffer(m_renderCmdBuffer, 0);
 		if (err)
@@ -342,55 +355,128 @@ WError WRenderTarget::Begin() {
 			return WError(W_ERRORUNK);
 	}
 
+	VkCommandBuffer primaryCmdBuffer = _GetPrimaryCommandBuffer();
+
 	for (auto imgTarget : m_targets) {
 		if (imgTarget->GetViewLayout() != VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-			imgTarget->TransitionLayoutTo(GetCommnadBuffer(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+			imgTarget->TransitionLayoutTo(primaryCmdBuffer, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 	}
 	if (m_depthTarget && m_depthTarget->GetViewLayout() != VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-		m_depthTarget->TransitionLayoutTo(GetCommnadBuffer(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+		m_depthTarget->TransitionLayoutTo(primaryCmdBuffer, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 
 	VkRenderPassBeginInfo renderPassBeginInfo = vkTools::initializers::renderPassBeginInfo();
-	renderPassBeginInfo.renderPass = m_renderPass;
+	renderPassBeginInfo.renderPass = clear ? m_renderPass : m_loadRenderPass;
 	renderPassBeginInfo.renderArea.offset.x = 0;
 	renderPassBeginInfo.renderArea.offset.y = 0;
 	renderPassBeginInfo.renderArea.extent.width = m_width;
 	renderPassBeginInfo.renderArea.extent.height = m_height;
-	renderPassBeginInfo.clearValueCount = (uint32_t)m_clearValues.size();
-	renderPassBeginInfo.pClearValues = m_clearValues.data();
+	renderPassBeginInfo.clearValueCount = clear ? (uint32_t)m_clearValues.size() : 0;
+	renderPassBeginInfo.pClearValues = clear ? m_clearValues.data() : nullptr;
 
 	// Set target frame buffer
 	uint32_t bufferIndex = m_app->GetCurrentBufferingIndex();
-	renderPassBeginInfo.framebuffer = m_bufferedFrameBuffer.GetFrameBuffer(bufferIndex);
+	m_currentFrameBuffer = m_bufferedFrameBuffer.GetFrameBuffer(bufferIndex, m_app->Renderer->GetCurrentBackbufferIndex());
+	renderPassBeginInfo.framebuffer = m_currentFrameBuffer;
+
+	// with worker threads available, the render pass is recorded into secondary
+	// command buffers so that RecordInParallel() can split it between threads.
+	// Those are reset with the frame's resources, so this is limited to render
+	// targets that render as part of the renderer's frame
+	bool recordSecondary = m_renderCmdBuffer == VK_NULL_HANDLE && m_app->GetEngineParam<bool>("parallelRecording") && m_app->JobSystem->GetNumWorkers() > 0;
+	if (recordSecondary) {
+		VkResult err = m_app->MemoryManager->ReserveSecondaryCommandPools(m_app->JobSystem->GetNumWorkers() + 1);
+		if (err)
+			return WError(W_OUTOFMEMORY);
+	}
 
-	vkCmdBeginRenderPass(GetCommnadBuffer(), &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(primaryCmdBuffer, &renderPassBeginInfo,
+		recordSecondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
 
-	VkViewport viewport = vkTools::initializers::viewport(
-		(float)m_width,
-		(float)m_height,
-		0.0f,
-		1.0f);
-	vkCmdSetViewport(GetCommnadBuffer(), 0, 1, &viewport);
-
-	VkRect2D scissor = vkTools::initializers::rect2D(
-		m_width,
-		m_height,
-		0,
-		0);
-	vkCmdSetScissor(GetCommnadBuffer(), 0, 1, &scissor);
+	if (recordSecondary) {
+		VkResult err = _BeginSecondaryCommandBuffer(&m_secondaryCmdBuffer);
+		if (err)
+			return WError(W_OUTOFMEMORY);
+	} else
+		_SetViewportAndScissor(primaryCmdBuffer);
 
 	m_camera->Render(m_width, m_height);
 
 	return WError(W_SUCCEEDED);
 }
 
+WError WRenderTarget::RecordInParallel(uint32_t count, uint32_t minChunk, const std::function<void(uint32_t begin, uint32_t end)>& fn) {
+	uint32_t numThreads = m_app->JobSystem->GetNumWorkers() + 1;
+	uint32_t numChunks = std::min((count + std::max(minChunk, 1u) - 1) / std::max(minChunk, 1u), numThreads * CHUNKS_PER_THREAD);
+	if (m_secondaryCmdBuffer == VK_NULL_HANDLE || threadRenderTarget == this || numChunks <= 1) {
+		fn(0, count);
+		return WError(W_SUCCEEDED);
+	}
+
+	// the commands recorded so far are executed before the chunks
+	VkResult err = vkEndCommandBuffer(m_secondaryCmdBuffer);
+	m_recordedCmdBuffers.push_back(m_secondaryCmdBuffer);
+	m_secondaryCmdBuffer = VK_NULL_HANDLE;
+	if (err)
+		return WError(W_ERRORUNK);
+
+	size_t firstChunk = m_recordedCmdBuffers.size();
+	m_recordedCmdBuffers.resize(firstChunk + numChunks, VK_NULL_HANDLE);
+	std::atomic<bool> failed(false);
+	m_app->JobSystem->ParallelFor(numChunks, 1, [this, count, numChunks, firstChunk, &fn, &failed](uint32_t beginChunk, uint32_t endChunk) {
+		for (uint32_t chunk = beginChunk; chunk < endChunk; chunk++) {
+			VkCommandBuffer cmdBuf;
+			if (_BeginSecondaryCommandBuffer(&cmdBuf) != VK_SUCCESS) {
+				failed = true;
+				continue;
+			}
+
+			threadRenderTarget = this;
+			threadCmdBuffer = cmdBuf;
+			fn((uint32_t)((uint64_t)count * chunk / numChunks), (uint32_t)((uint64_t)count * (chunk + 1) / numChunks));
+			threadRenderTarget = nullptr;
+			threadCmdBuffer = VK_NULL_HANDLE;
+
+			if (vkEndCommandBuffer(cmdBuf) != VK_SUCCESS)
+				failed = true;
+			else
+				m_recordedCmdBuffers[firstChunk + chunk] = cmdBuf;
+		}
+	});
+	if (failed)
+		m_recordedCmdBuffers.erase(std::remove(m_recordedCmdBuffers.begin() + firstChunk, m_recordedCmdBuffers.end(), VK_NULL_HANDLE), m_recordedCmdBuffers.end());
+
+	// the commands recorded after this are executed after the chunks
+	err = _BeginSecondaryCommandBuffer(&m_secondaryCmdBuffer);
+	if (err || failed)
+		return WError(W_OUTOFMEMORY);
+
+	return WError(W_SUCCEEDED);
+}
+
+bool WRenderTarget::IsRecordingChunk() {
+	return threadRenderTarget != nullptr;
+}
+
 WError WRenderTarget::End(bool bSubmit) {
-	vkCmdEndRenderPass(GetCommnadBuffer());
+	VkCommandBuffer primaryCmdBuffer = _GetPrimaryCommandBuffer();
+
+	if (m_secondaryCmdBuffer != VK_NULL_HANDLE) {
+		vkEndCommandBuffer(m_secondaryCmdBuffer);
+		m_recordedCmdBuffers.push_back(m_secondaryCmdBuffer);
+		m_secondaryCmdBuffer = VK_NULL_HANDLE;
+	}
+	if (m_recordedCmdBuffers.size() > 0) {
+		vkCmdExecuteCommands(primaryCmdBuffer, (uint32_t)m_recordedCmdBuffers.size(), m_recordedCmdBuffers.data());
+		m_recordedCmdBuffers.clear();
+	}
+
+	vkCmdEndRenderPass(primaryCmdBuffer);
 
 	for (auto imgTarget : m_targets) {
-		imgTarget->TransitionLayoutTo(GetCommnadBuffer(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		imgTarget->TransitionLayoutTo(primaryCmdBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	}
 	if (m_depthTarget)
-		m_depthTarget->TransitionLayoutTo(GetCommnadBuffer(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		m_depthTarget->TransitionLayoutTo(primaryCmdBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 	if (m_renderCmdBuffer != VK_NULL_HANDLE) {
 		VkResult err = vkEndCommandBuffer(m_renderCmdBuffer);
@@ -421,8 +507,13 @@ WError WRenderTarget::Submit(VkSubmitInfo custom_info) {
 		custom_info.pCommandBuffers = &m_renderCmdBuffer;
 	}
 
+	// Submit pending uploads first so that the render target's commands are ordered after them
+	VkResult err = m_app->MemoryManager->SubmitUploads();
+	if (err)
+		return WError(W_ERRORUNK);
+
 	// Submit to queue
-	VkResult err = vkQueueSubmit(m_app->Renderer->GetQueue(), 1, &custom_info, VK_NULL_HANDLE);
+	err = vkQueueSubmit(m_app->Renderer->GetQueue(), 1, &custom_info, VK_NULL_HANDLE);
 	if (err)
 		return WError(W_ERRORUNK);
 
@@ -452,15 +543,70 @@ VkRenderPass WRenderTarget::GetRenderPass() const {
 }
 
 VkPipelineCache WRenderTarget::GetPipelineCache() const {
-	return m_pipelineCache;
+	return m_app->GetPipelineCache();
 }
 
 VkCommandBuffer WRenderTarget::GetCommnadBuffer() const {
+	if (threadRenderTarget == this)
+		return threadCmdBuffer;
+	if (m_secondaryCmdBuffer != VK_NULL_HANDLE)
+		return m_secondaryCmdBuffer;
+	return _GetPrimaryCommandBuffer();
+}
+
+VkCommandBuffer WRenderTarget::_GetPrimaryCommandBuffer() const {
 	if (m_renderCmdBuffer != VK_NULL_HANDLE)
 		return m_renderCmdBuffer;
 	return m_app->Renderer->GetCurrentPrimaryCommandBuffer();
 }
 
+void WRenderTarget::_SetViewportAndScissor(VkCommandBuffer cmdBuf) const {
+	VkViewport viewport = vkTools::initializers::viewport(
+		(float)m_width,
+		(float)m_height,
+		0.0f,
+		1.0f);
+	vkCmdSetViewport(cmdBuf, 0, 1, &viewport);
+
+	VkRect2D scissor = vkTools::initializers::rect2D(
+		m_width,
+		m_height,
+		0,
+		0);
+	vkCmdSetScissor(cmdBuf, 0, 1, &scissor);
+}
+
+VkResult WRenderTarget::_BeginSecondaryCommandBuffer(VkCommandBuffer* cmdBuf) const {
+	VkResult err = m_app->MemoryManager->AcquireSecondaryCommandBuffer(m_app->GetCurrentBufferingIndex(), m_app->JobSystem->GetCurrentThreadIndex(), cmdBuf);
+	if (err)
+		return err;
+
+	VkCommandBufferInheritanceInfo inheritanceInfo = {};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = m_renderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = m_currentFrameBuffer;
+
+	VkCommandBufferBeginInfo cmdBufInfo = vkTools::initializers::commandBufferBeginInfo();
+	cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	cmdBufInfo.pInheritanceInfo = &inheritanceInfo;
+	err = vkBeginCommandBuffer(*cmdBuf, &cmdBufInfo);
+	if (err)
+		return err;
+
+	// secondary command buffers don't inherit any state
+	_SetViewportAndScissor(*cmdBuf);
+	return VK_SUCCESS;
+}
+
+uint32_t WRenderTarget::GetWidth() const {
+	return m_width;
+}
+
+uint32_t WRenderTarget::GetHeight() const {
+	return m_height;
+}
+
 uint32_t WRenderTarget::GetNumColorOutputs() const {
 	return !Valid() ? 0 : (m_targets.size() == 0 ? 1 : (uint32_t)m_targets.size());
 }
@@ -114,7 +114,7 @@ bool WLight::InCameraView(WCamera* cam) const {
 	if (m_type == W_LIGHT_DIRECTIONAL)
 		return true;
 	// not the most efficient for point lights, but a good approximation
-	return cam->CheckSphereInFrustum(GetPosition(), m_range);
+	return cam->CheckSphereInFrustum(GetWorldPosition(), m_range);
 }
 
 WMatrix WLight::GetWorldMatrix() {
@@ -125,7 +125,7 @@ WMatrix WLight::GetWorldMatrix() {
 bool WLight::UpdateLocals() {
 	if (m_bAltered) {
 		m_bAltered = false;
-		m_WorldM = ComputeTransformation();
+		m_WorldM = ComputeWorldTransformation();
 		return true;
 	}
 
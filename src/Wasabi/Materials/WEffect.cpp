@@ -3,6 +3,7 @@
 #include "Wasabi/Images/WRenderTarget.hpp"
 #include "Wasabi/Renderers/WRenderer.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <unordered_map>
 using std::unordered_map;
@@ -145,8 +146,9 @@ W_BOUND_RESOURCE::W_BOUND_RESOURCE(
 	std::vector<W_SHADER_VARIABLE_INFO> v,
 	uint32_t textureArraySize
 ) : type(t), binding_index(index), binding_set(set), name(_name), variables(v) {
-	if (t == W_TYPE_UBO || t == W_TYPE_PUSH_CONSTANT) {
+	if (t == W_TYPE_UBO || t == W_TYPE_PUSH_CONSTANT || t == W_TYPE_STORAGE_BUFFER) {
 		size_t curOffset = 0;
+		size_t maxAlignment = 1;
 		_offsets.resize(variables.size());
 		for (uint32_t i = 0; i < variables.size(); i++) {
 			size_t varSize = variables[i].GetSize();
@@ -155,7 +157,11 @@ W_BOUND_RESOURCE::W_BOUND_RESOURCE(
 				curOffset += varAlignment - (curOffset % varAlignment); // apply alignment
 			_offsets[i] = curOffset;
 			curOffset += varSize;
+			maxAlignment = std::max(maxAlignment, varAlignment);
 		}
+		// elements of a storage buffer's array are padded to the structure's alignment
+		if (t == W_TYPE_STORAGE_BUFFER && curOffset % maxAlignment > 0)
+			curOffset += maxAlignment - (curOffset % maxAlignment);
 		_size = curOffset;
 
 		if (t == W_TYPE_PUSH_CONSTANT) {
@@ -163,7 +169,7 @@ W_BOUND_RESOURCE::W_BOUND_RESOURCE(
 				_offsets[i] += binding_index;
 			binding_index = std::numeric_limits<uint32_t>::max();
 		}
-	} else if (t == W_TYPE_TEXTURE) {
+	} else if (t == W_TYPE_TEXTURE || t == W_TYPE_STORAGE_IMAGE) {
 		_size = textureArraySize;
 	}
 }
@@ -550,6 +556,10 @@ void WEffect::SetName(std::string newName) {
 }
 
 bool WEffect::_ValidShaders() const {
+	// a compute shader is valid on its own
+	if (IsCompute())
+		return m_shaders.size() == 1 && m_shaders[0]->Valid();
+
 	// valid when at least one shader has input layout (vertex shader)
 	for (uint32_t i = 0; i < m_shaders.size(); i++)
 		if (m_shaders[i]->m_desc.type == W_VERTEX_SHADER &&
@@ -568,6 +578,13 @@ WError WEffect::BindShader(WShader* shader) {
 	if (!shader)
 		return WError(W_INVALIDPARAM);
 
+	// compute and graphics shaders cannot be mixed (a shader of the same type is replaced below)
+	for (uint32_t i = 0; i < m_shaders.size(); i++) {
+		if (m_shaders[i]->m_desc.type != shader->m_desc.type &&
+			(m_shaders[i]->m_desc.type == W_COMPUTE_SHADER || shader->m_desc.type == W_COMPUTE_SHADER))
+			return WError(W_INVALIDPARAM);
+	}
+
 	for (uint32_t i = 0; i < m_shaders.size(); i++) {
 		if (m_shaders[i]->m_desc.type == shader->m_desc.type) {
 			m_shaders[i]->RemoveReference();
@@ -631,14 +648,9 @@ void WEffect::SetRasterizationState(VkPipelineRasterizationStateCreateInfo state
 	m_rasterizationState = state;
 }
 
-WError WEffect::BuildPipeline(WRenderTarget* rt) {
+WError WEffect::_CreatePipelineLayout() {
 	VkDevice device = m_app->GetVulkanDevice();
 
-	if (!_ValidShaders())
-		return WError(W_NOTVALID);
-
-	_DestroyPipeline();
-
 	//
 	// Create descriptor set layout
 	//
@@ -648,15 +660,16 @@ WError WEffect::BuildPipeline(WRenderTarget* rt) {
 	for (uint32_t i = 0; i < m_shaders.size(); i++) {
 		for (uint32_t j = 0; j < m_shaders[i]->m_desc.bound_resources.size(); j++) {
 			W_BOUND_RESOURCE* boundResource = &m_shaders[i]->m_desc.bound_resources[j];
-			if (boundResource->type == W_TYPE_UBO || boundResource->type == W_TYPE_TEXTURE) {
+			if (boundResource->type == W_TYPE_UBO || boundResource->type == W_TYPE_TEXTURE ||
+				boundResource->type == W_TYPE_STORAGE_BUFFER || boundResource->type == W_TYPE_STORAGE_IMAGE) {
 				VkDescriptorSetLayoutBinding layoutBinding = {};
 				layoutBinding.stageFlags = (VkShaderStageFlagBits)m_shaders[i]->m_desc.type;
 				layoutBinding.pImmutableSamplers = NULL;
 
 				auto used_bindings_iter = used_bindings.find(boundResource->binding_index);
 				if (used_bindings_iter != used_bindings.end()) {
-					// repeated binding index, don't add it to the layoutBindings again and make sure it's the same UBO if it's a UBO
-					if (boundResource->type == W_TYPE_UBO && used_bindings_iter->second.type == W_TYPE_UBO) {
+					// repeated binding index, don't add it to the layoutBindings again and make sure it's the same buffer if it's a buffer
+					if ((boundResource->type == W_TYPE_UBO || boundResource->type == W_TYPE_STORAGE_BUFFER) && used_bindings_iter->second.type == boundResource->type) {
 						if (!used_bindings_iter->second.IsSimilarTo(m_shaders[i]->m_desc.bound_resources[j]))
 							return WError(W_INVALIDREPEATEDBINDINGINDEX);
 					}
@@ -677,6 +690,15 @@ WError WEffect::BuildPipeline(WRenderTarget* rt) {
 					layoutBinding.binding = boundResource->binding_index;
 					layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 					layoutBinding.descriptorCount = (uint32_t)boundResource->GetSize();
+				} else if (boundResource->type == W_TYPE_STORAGE_BUFFER) {
+					layoutBinding.binding = boundResource->binding_index;
+					layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+					layoutBinding.descriptorCount = 1;
+					used_bindings.insert(std::pair<int, W_BOUND_RESOURCE>(boundResource->binding_index, m_shaders[i]->m_desc.bound_resources[j]));
+				} else if (boundResource->type == W_TYPE_STORAGE_IMAGE) {
+					layoutBinding.binding = boundResource->binding_index;
+					layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+					layoutBinding.descriptorCount = (uint32_t)boundResource->GetSize();
 				}
 				auto iter = layoutBindingsMap.find(boundResource->binding_set);
 				if (iter == layoutBindingsMap.end()) {
@@ -725,6 +747,39 @@ WError WEffect::BuildPipeline(WRenderTarget* rt) {
 	if (err)
 		return WError(W_FAILEDTOCREATEPIPELINELAYOUT);
 
+	return WError(W_SUCCEEDED);
+}
+
+WError WEffect::BuildPipeline(WRenderTarget* rt) {
+	VkDevice device = m_app->GetVulkanDevice();
+
+	if (!_ValidShaders() || (!rt && !IsCompute()))
+		return WError(W_NOTVALID);
+
+	_DestroyPipeline();
+
+	WError status = _CreatePipelineLayout();
+	if (!status)
+		return status;
+
+	VkResult err;
+
+	if (IsCompute()) {
+		VkComputePipelineCreateInfo computePipelineCreateInfo = {};
+		computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		computePipelineCreateInfo.layout = m_pipelineLayout;
+		computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		computePipelineCreateInfo.stage.module = m_shaders[0]->m_module;
+		computePipelineCreateInfo.stage.pName = "main";
+
+		err = vkCreateComputePipelines(device, rt ? rt->GetPipelineCache() : VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &m_pipeline);
+		if (err)
+			return WError(W_FAILEDTOCREATEPIPELINE);
+
+		return WError(W_SUCCEEDED);
+	}
+
 	//IA state
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = {};
 	inputAssemblyState.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -861,17 +916,69 @@ WError WEffect::BuildPipeline(WRenderTarget* rt) {
 }
 
 WError WEffect::Bind(WRenderTarget* rt) {
-	if (!Valid())
-		return WError(W_NOTVALID);
-
 	VkCommandBuffer renderCmdBuffer = rt->GetCommnadBuffer();
 	if (!renderCmdBuffer)
 		return WError(W_NORENDERTARGET);
 
-	vkCmdBindPipeline(renderCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+	return Bind(renderCmdBuffer);
+}
+
+WError WEffect::Bind(VkCommandBuffer cmdBuffer) {
+	if (!Valid())
+		return WError(W_NOTVALID);
+
+	vkCmdBindPipeline(cmdBuffer, IsCompute() ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+
+	for (auto material : m_perFrameMaterials) {
+		WError err = material->Bind(cmdBuffer);
+		if (!err)
+			return err;
+	}
+
+	return WError(W_SUCCEEDED);
+}
+
+WError WEffect::Dispatch(VkCommandBuffer cmdBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
+	if (!Valid() || !IsCompute())
+		return WError(W_NOTVALID);
+
+	vkCmdDispatch(cmdBuffer, groupCountX, groupCountY, groupCountZ);
+
+	return WError(W_SUCCEEDED);
+}
+
+WError WEffect::DispatchIndirect(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkDeviceSize offset) {
+	if (!Valid() || !IsCompute())
+		return WError(W_NOTVALID);
+	if (buffer == VK_NULL_HANDLE)
+		return WError(W_INVALIDPARAM);
 
+	vkCmdDispatchIndirect(cmdBuffer, buffer, offset);
+
+	return WError(W_SUCCEEDED);
+}
+
+void WEffect::ComputeBarrier(VkCommandBuffer cmdBuffer, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) {
+	// a global barrier covers every buffer and image (storage images don't change layouts)
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = dstAccess;
+
+	vkCmdPipelineBarrier(
+		cmdBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		dstStages,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr
+	);
+}
+
+WError WEffect::UpdatePerFrameMaterials() {
 	for (auto material : m_perFrameMaterials) {
-		WError err = material->Bind(rt);
+		WError err = material->UpdateResources();
 		if (!err)
 			return err;
 	}
@@ -909,6 +1016,10 @@ VkDescriptorSetLayout WEffect::GetDescriptorSetLayout(uint32_t setIndex) const {
 	return it->second;
 }
 
+bool WEffect::IsCompute() const {
+	return m_shaders.size() > 0 && m_shaders[0]->m_desc.type == W_COMPUTE_SHADER;
+}
+
 W_INPUT_LAYOUT WEffect::GetInputLayout(uint32_t layout_index) const {
 	if (m_vertexShaderIndex >= 0 && layout_index < m_shaders[m_vertexShaderIndex]->m_desc.input_layouts.size())
 		return m_shaders[m_vertexShaderIndex]->m_desc.input_layouts[layout_index];
@@ -4,11 +4,97 @@
 #include "Wasabi/Images/WRenderTarget.hpp"
 #include "Wasabi/Renderers/WRenderer.hpp"
 
+#include <cassert>
+
 std::string WMaterialManager::GetTypeName() const {
 	return "Material";
 }
 
 WMaterialManager::WMaterialManager(class Wasabi* const app) : WManager<WMaterial>(app) {
+	m_currentDescriptorPool = 0;
+}
+
+WMaterialManager::~WMaterialManager() {
+	// materials need to release their descriptor sets before the pools are destroyed, which
+	// would be too late if WManager::~WManager() destroyed them
+	_ReleaseEntities();
+
+	// the device is idle at this point, flush the (deferred) frees of the sets before destroying their pools
+	m_app->MemoryManager->ReleaseAllResources();
+	for (auto pool : m_descriptorPools)
+		vkDestroyDescriptorPool(m_app->GetVulkanDevice(), pool, nullptr);
+	m_descriptorPools.clear();
+}
+
+VkResult WMaterialManager::AllocateDescriptorSets(VkDescriptorSetLayout layout, const std::vector<VkDescriptorPoolSize>& setSizes,
+												  uint32_t numSets, VkDescriptorSet* sets, VkDescriptorPool* pool) {
+	std::vector<VkDescriptorSetLayout> layouts(numSets, layout);
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorSetCount = numSets;
+	allocInfo.pSetLayouts = layouts.data();
+
+	// try the existing pages, starting from the one that worked last time
+	for (uint32_t i = 0; i < m_descriptorPools.size(); i++) {
+		uint32_t pageIndex = (m_currentDescriptorPool + i) % (uint32_t)m_descriptorPools.size();
+		allocInfo.descriptorPool = m_descriptorPools[pageIndex];
+		if (vkAllocateDescriptorSets(m_app->GetVulkanDevice(), &allocInfo, sets) == VK_SUCCESS) {
+			m_currentDescriptorPool = pageIndex;
+			*pool = allocInfo.descriptorPool;
+			return VK_SUCCESS;
+		}
+	}
+
+	// all pages are full (or fragmented), create a new one
+	std::vector<VkDescriptorPoolSize> minSizes = setSizes;
+	for (auto& size : minSizes)
+		size.descriptorCount *= numSets;
+	VkResult result = _CreateDescriptorPoolPage(minSizes, numSets);
+	if (result != VK_SUCCESS)
+		return result;
+
+	m_currentDescriptorPool = (uint32_t)m_descriptorPools.size() - 1;
+	allocInfo.descriptorPool = m_descriptorPools.back();
+	result = vkAllocateDescriptorSets(m_app->GetVulkanDevice(), &allocInfo, sets);
+	if (result == VK_SUCCESS)
+		*pool = allocInfo.descriptorPool;
+	return result;
+}
+
+VkResult WMaterialManager::_CreateDescriptorPoolPage(const std::vector<VkDescriptorPoolSize>& minSizes, uint32_t minSets) {
+	// a page holds descriptors for many materials
+	const uint32_t pageSets = 256;
+	std::vector<VkDescriptorPoolSize> sizes = {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, pageSets * 2 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, pageSets * 4 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, pageSets },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, pageSets / 4 },
+	};
+	for (auto minSize : minSizes) {
+		bool found = false;
+		for (auto& size : sizes) {
+			if (size.type == minSize.type) {
+				size.descriptorCount = std::max(size.descriptorCount, minSize.descriptorCount);
+				found = true;
+			}
+		}
+		if (!found)
+			sizes.push_back(minSize);
+	}
+
+	VkDescriptorPoolCreateInfo descriptorPoolInfo = {};
+	descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descriptorPoolInfo.poolSizeCount = (uint32_t)sizes.size();
+	descriptorPoolInfo.pPoolSizes = sizes.data();
+	descriptorPoolInfo.maxSets = std::max(pageSets, minSets);
+	// sets are freed individually when materials are destroyed, letting the pool recycle them
+	descriptorPoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+
+	VkDescriptorPool pool;
+	VkResult result = vkCreateDescriptorPool(m_app->GetVulkanDevice(), &descriptorPoolInfo, nullptr, &pool);
+	if (result == VK_SUCCESS)
+		m_descriptorPools.push_back(pool);
+	return result;
 }
 
 WMaterial::WMaterial(Wasabi* const app, uint32_t ID) : WFileAsset(app, ID) {
@@ -62,13 +148,17 @@ void WMaterial::_DestroyResources() {
 	}
 	m_samplers.clear();
 
+	m_storageBuffers.clear();
+
 	for (uint32_t i = 0; i < m_pushConstants.size(); i++)
 		W_SAFE_FREE(m_pushConstants[i].data);
 	m_pushConstants.clear();
 
+	// the descriptor pool is shared (owned by the material manager), only the sets are released
 	for (auto it = m_descriptorSets.begin(); it != m_descriptorSets.end(); it++)
 		m_app->MemoryManager->ReleaseDescriptorSet(*it, m_descriptorPool, m_app->GetCurrentBufferingIndex());
-	m_app->MemoryManager->ReleaseDescriptorPool(m_descriptorPool, m_app->GetCurrentBufferingIndex());
+	m_descriptorSets.clear();
+	m_descriptorPool = VK_NULL_HANDLE;
 
 	if (m_effect) {
 		// if this material is being destroyed and is in the parent effect's per-frame materials, remove it
@@ -135,8 +225,7 @@ WError WMaterial::CreateForEffect(WEffect* const effect, uint32_t bindingSet) {
 				}
 
 				m_uniformBuffers.push_back(ubo);
-				writeDescriptorsSize += ubo.descriptorBufferInfos.size();
-			} else if (shader->m_desc.bound_resources[j].type == W_TYPE_TEXTURE) {
+			} else if (shader->m_desc.bound_resources[j].type == W_TYPE_TEXTURE || shader->m_desc.bound_resources[j].type == W_TYPE_STORAGE_IMAGE) {
 				bool already_added = false;
 				for (uint32_t k = 0; k < m_samplers.size(); k++) {
 					if (m_samplers[k].sampler_info->binding_index == shader->m_desc.bound_resources[j].binding_index) {
@@ -148,26 +237,51 @@ WError WMaterial::CreateForEffect(WEffect* const effect, uint32_t bindingSet) {
 					continue;
 
 				uint32_t textureArraySize = (uint32_t)shader->m_desc.bound_resources[j].GetSize();
+				bool isStorageImage = shader->m_desc.bound_resources[j].type == W_TYPE_STORAGE_IMAGE;
 				SAMPLER_INFO sampler = {};
 
+				// storage images have no default image (it cannot be written to), they stay unset until SetTexture() is called
 				sampler.images.resize(textureArraySize);
 				for (uint32_t k = 0; k < textureArraySize; k++) {
-					sampler.images[k] = m_app->ImageManager->GetDefaultImage();
-					sampler.images[k]->AddReference();
+					sampler.images[k] = isStorageImage ? nullptr : m_app->ImageManager->GetDefaultImage();
+					if (sampler.images[k])
+						sampler.images[k]->AddReference();
 				}
 
 				sampler.descriptors.resize(numBuffers);
 				for (auto descriptors = sampler.descriptors.begin(); descriptors != sampler.descriptors.end(); descriptors++) {
 					descriptors->resize(textureArraySize);
 					for (auto descriptor = descriptors->begin(); descriptor != descriptors->end(); descriptor++) {
-						descriptor->sampler = m_app->Renderer->GetTextureSampler();
+						descriptor->sampler = isStorageImage ? VK_NULL_HANDLE : m_app->Renderer->GetTextureSampler();
 						descriptor->imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 						descriptor->imageView = VK_NULL_HANDLE; // // will be assigned in the Bind() function
 					}
 				}
 				sampler.sampler_info = &shader->m_desc.bound_resources[j];
 				m_samplers.push_back(sampler);
-				writeDescriptorsSize += sampler.descriptors.size() * sampler.descriptors[0].size();
+				writeDescriptorsSize++; // Bind() issues at most one write per sampler binding
+			} else if (shader->m_desc.bound_resources[j].type == W_TYPE_STORAGE_BUFFER) {
+				bool already_added = false;
+				for (uint32_t k = 0; k < m_storageBuffers.size(); k++) {
+					if (m_storageBuffers[k].sb_info->binding_index == shader->m_desc.bound_resources[j].binding_index) {
+						// two shaders have the same storage buffer binding index, skip (it is the same buffer, the WEffect::CreatePipeline ensures that)
+						already_added = true;
+					}
+				}
+				if (already_added)
+					continue;
+
+				STORAGE_BUFFER_INFO sb = {};
+				sb.buffer = nullptr;
+				sb.descriptorBufferInfos.resize(numBuffers);
+				for (uint32_t b = 0; b < numBuffers; b++) {
+					sb.descriptorBufferInfos[b].buffer = VK_NULL_HANDLE; // will be assigned in UpdateResources()
+					sb.descriptorBufferInfos[b].offset = 0;
+					sb.descriptorBufferInfos[b].range = VK_WHOLE_SIZE;
+				}
+				sb.sb_info = &shader->m_desc.bound_resources[j];
+				m_storageBuffers.push_back(sb);
+				writeDescriptorsSize++; // UpdateResources() issues at most one write per storage buffer binding
 			} else if (shader->m_desc.bound_resources[j].type == W_TYPE_PUSH_CONSTANT) {
 				bool already_added = false;
 				for (uint32_t k = 0; k < m_pushConstants.size(); k++) {
@@ -192,63 +306,67 @@ WError WMaterial::CreateForEffect(WEffect* const effect, uint32_t bindingSet) {
 	m_writeDescriptorSets.resize(writeDescriptorsSize);
 
 	//
-	// Create descriptor pool
+	// Allocate the descriptor sets (one per buffered frame) from the shared pools
 	//
-	// We need to tell the API the number of max. requested descriptors per type
-	vector<VkDescriptorPoolSize> typeCounts;
+	vector<VkDescriptorPoolSize> setSizes;
 	if (m_uniformBuffers.size() > 0) {
 		VkDescriptorPoolSize s;
 		s.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		s.descriptorCount = (uint32_t)m_uniformBuffers.size() * numBuffers;
-		typeCounts.push_back(s);
+		s.descriptorCount = (uint32_t)m_uniformBuffers.size();
+		setSizes.push_back(s);
 	}
 	if (m_samplers.size() > 0) {
+		VkDescriptorPoolSize samplers, storageImages;
+		samplers.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		samplers.descriptorCount = 0;
+		storageImages.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		storageImages.descriptorCount = 0;
+		for (uint32_t i = 0; i < m_samplers.size(); i++) {
+			if (m_samplers[i].sampler_info->type == W_TYPE_STORAGE_IMAGE)
+				storageImages.descriptorCount += (uint32_t)m_samplers[i].images.size();
+			else
+				samplers.descriptorCount += (uint32_t)m_samplers[i].images.size();
+		}
+		if (samplers.descriptorCount > 0)
+			setSizes.push_back(samplers);
+		if (storageImages.descriptorCount > 0)
+			setSizes.push_back(storageImages);
+	}
+	if (m_storageBuffers.size() > 0) {
 		VkDescriptorPoolSize s;
-		s.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		s.descriptorCount = 0;
-		for (uint32_t i = 0; i < m_samplers.size(); i++)
-			s.descriptorCount += (uint32_t)m_samplers[i].images.size() * numBuffers;
-		typeCounts.push_back(s);
-	}
-
-	if (typeCounts.size() > 0) {
-		// Create the global descriptor pool
-		// All descriptors used in this example are allocated from this pool
-		VkDescriptorPoolCreateInfo descriptorPoolInfo = {};
-		descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		descriptorPoolInfo.pNext = NULL;
-		descriptorPoolInfo.poolSizeCount = (uint32_t)typeCounts.size();
-		descriptorPoolInfo.pPoolSizes = typeCounts.data();
-		// Set the max. number of sets that can be requested
-		// Requesting descriptors beyond maxSets will result in an error
-		descriptorPoolInfo.maxSets = numBuffers;
-		descriptorPoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-
-		VkResult vkRes = vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &m_descriptorPool);
+		s.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		s.descriptorCount = (uint32_t)m_storageBuffers.size();
+		setSizes.push_back(s);
+	}
+
+	if (setSizes.size() > 0) {
+		m_descriptorSets.resize(numBuffers);
+		VkResult vkRes = m_app->MaterialManager->AllocateDescriptorSets(effect->GetDescriptorSetLayout(bindingSet), setSizes,
+																		 numBuffers, m_descriptorSets.data(), &m_descriptorPool);
 		if (vkRes) {
+			m_descriptorSets.clear();
 			_DestroyResources();
 			return WError(W_OUTOFMEMORY);
 		}
 
 		//
-		// Create descriptor set
+		// The uniform buffers never change, so their descriptors are written once here
 		//
-
-		m_descriptorSets.resize(descriptorPoolInfo.maxSets);
-		std::vector<VkDescriptorSetLayout> layouts(m_descriptorSets.size());
-		for (uint32_t i = 0; i < layouts.size(); i++)
-			layouts[i] = effect->GetDescriptorSetLayout(bindingSet);
-		VkDescriptorSetAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		allocInfo.descriptorPool = m_descriptorPool;
-		allocInfo.descriptorSetCount = (uint32_t)m_descriptorSets.size();
-		allocInfo.pSetLayouts = layouts.data();
-
-		vkRes = vkAllocateDescriptorSets(device, &allocInfo, m_descriptorSets.data());
-		if (vkRes) {
-			_DestroyResources();
-			return WError(W_OUTOFMEMORY);
+		vector<VkWriteDescriptorSet> uboWrites;
+		for (uint32_t b = 0; b < numBuffers; b++) {
+			for (auto ubo = m_uniformBuffers.begin(); ubo != m_uniformBuffers.end(); ubo++) {
+				VkWriteDescriptorSet writeDescriptorSet = {};
+				writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				writeDescriptorSet.dstSet = m_descriptorSets[b];
+				writeDescriptorSet.descriptorCount = 1;
+				writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				writeDescriptorSet.pBufferInfo = &ubo->descriptorBufferInfos[b];
+				writeDescriptorSet.dstBinding = ubo->ubo_info->binding_index;
+				uboWrites.push_back(writeDescriptorSet);
+			}
 		}
+		if (uboWrites.size() > 0)
+			vkUpdateDescriptorSets(device, (uint32_t)uboWrites.size(), uboWrites.data(), 0, nullptr);
 	}
 
 	m_effect = effect;
@@ -259,75 +377,116 @@ WError WMaterial::CreateForEffect(WEffect* const effect, uint32_t bindingSet) {
 }
 
 WError WMaterial::Bind(WRenderTarget* rt, bool bindDescSet, bool bindPushConsts) {
+	VkCommandBuffer renderCmdBuffer = rt->GetCommnadBuffer();
+	if (!renderCmdBuffer)
+		return WError(W_NORENDERTARGET);
+
+	return Bind(renderCmdBuffer, bindDescSet, bindPushConsts);
+}
+
+WError WMaterial::Bind(VkCommandBuffer cmdBuffer, bool bindDescSet, bool bindPushConsts) {
 	if (!Valid())
 		return WError(W_NOTVALID);
 
-	VkDevice device = m_app->GetVulkanDevice();
+	// chunks of RecordInParallel() only record, their materials are updated beforehand
+	if (bindDescSet && !WRenderTarget::IsRecordingChunk())
+		UpdateResources();
 
-	VkCommandBuffer renderCmdBuffer = rt->GetCommnadBuffer();
-	if (!renderCmdBuffer)
-		return WError(W_NORENDERTARGET);
+	return RecordBind(cmdBuffer, bindDescSet, bindPushConsts);
+}
+
+WError WMaterial::RecordBind(VkCommandBuffer cmdBuffer, bool bindDescSet, bool bindPushConsts) const {
+	if (!Valid())
+		return WError(W_NOTVALID);
 
 	if (bindDescSet) {
-		int numUpdateDescriptors = 0;
 		uint32_t bufferIndex = m_app->GetCurrentBufferingIndex();
+		VkPipelineBindPoint bindPoint = m_effect->IsCompute() ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS;
+		vkCmdBindDescriptorSets(cmdBuffer, bindPoint, m_effect->GetPipelineLayout(), m_setIndex, 1, &m_descriptorSets[bufferIndex], 0, nullptr);
+	}
 
-		// update UBOs that changed
-		for (auto ubo = m_uniformBuffers.begin(); ubo != m_uniformBuffers.end(); ubo++) {
-			if (ubo->dirty[bufferIndex]) {
-				void* pBufferData;
-				ubo->buffer.Map(m_app, bufferIndex, &pBufferData, W_MAP_WRITE);
-				memcpy((char*)pBufferData + ubo->descriptorBufferInfos[bufferIndex].offset, ubo->data, ubo->descriptorBufferInfos[bufferIndex].range);
-				ubo->buffer.Unmap(m_app, bufferIndex);
-				ubo->dirty[bufferIndex] = false;
-			}
+	if (bindPushConsts) {
+		for (auto pc = m_pushConstants.begin(); pc != m_pushConstants.end(); pc++)
+			vkCmdPushConstants(cmdBuffer, m_effect->GetPipelineLayout(), pc->shaderStages, (uint32_t)pc->pc_info->OffsetAtVariable(0), (uint32_t)pc->pc_info->GetSize(), pc->data);
+	}
+
+	return WError(W_SUCCEEDED);
+}
+
+WError WMaterial::UpdateResources() {
+	// other threads may be binding this material (see RecordBind())
+	assert(!WRenderTarget::IsRecordingChunk());
+	if (!Valid())
+		return WError(W_NOTVALID);
+
+	VkDevice device = m_app->GetVulkanDevice();
+	int numUpdateDescriptors = 0;
+	uint32_t bufferIndex = m_app->GetCurrentBufferingIndex();
 
+	// update UBOs that changed (their descriptors are written once by CreateForEffect())
+	for (auto ubo = m_uniformBuffers.begin(); ubo != m_uniformBuffers.end(); ubo++) {
+		if (ubo->dirty[bufferIndex]) {
+			void* pBufferData;
+			ubo->buffer.Map(m_app, bufferIndex, &pBufferData, W_MAP_WRITE);
+			memcpy((char*)pBufferData + ubo->descriptorBufferInfos[bufferIndex].offset, ubo->data, ubo->descriptorBufferInfos[bufferIndex].range);
+			ubo->buffer.Unmap(m_app, bufferIndex);
+			ubo->dirty[bufferIndex] = false;
+		}
+	}
+
+	// update textures (and storage images) that changed
+	for (auto sampler = m_samplers.begin(); sampler != m_samplers.end(); sampler++) {
+		W_BOUND_RESOURCE* info = sampler->sampler_info;
+		bool isStorageImage = info->type == W_TYPE_STORAGE_IMAGE;
+		bool bChanged = false;
+		bool bComplete = true;
+		for (uint32_t textureArrayIndex = 0; textureArrayIndex < (uint32_t)sampler->images.size(); textureArrayIndex++) {
+			if (sampler->images[textureArrayIndex] && sampler->images[textureArrayIndex]->Valid()) {
+				// storage images are always accessed in the general layout
+				VkImageLayout layout = isStorageImage ? VK_IMAGE_LAYOUT_GENERAL : sampler->images[textureArrayIndex]->GetViewLayout();
+				if (sampler->descriptors[bufferIndex][textureArrayIndex].imageView != sampler->images[textureArrayIndex]->GetView() ||
+					sampler->descriptors[bufferIndex][textureArrayIndex].imageLayout != layout) {
+					sampler->descriptors[bufferIndex][textureArrayIndex].imageView = sampler->images[textureArrayIndex]->GetView();
+					sampler->descriptors[bufferIndex][textureArrayIndex].imageLayout = layout;
+					bChanged = true;
+				}
+			} else if (sampler->descriptors[bufferIndex][textureArrayIndex].imageView == VK_NULL_HANDLE)
+				bComplete = false;
+		}
+		if (bChanged && bComplete) {
 			VkWriteDescriptorSet writeDescriptorSet = {};
 			writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 			writeDescriptorSet.dstSet = m_descriptorSets[bufferIndex];
-			writeDescriptorSet.descriptorCount = 1;
-			writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			writeDescriptorSet.pBufferInfo = &ubo->descriptorBufferInfos[bufferIndex];
-			writeDescriptorSet.dstBinding = ubo->ubo_info->binding_index;
+			writeDescriptorSet.descriptorType = isStorageImage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writeDescriptorSet.descriptorCount = (uint32_t)sampler->descriptors[bufferIndex].size();
+			writeDescriptorSet.pImageInfo = sampler->descriptors[bufferIndex].data();
+			writeDescriptorSet.dstBinding = info->binding_index;
 
 			m_writeDescriptorSets[numUpdateDescriptors++] = writeDescriptorSet;
 		}
+	}
+	// update storage buffers that were set or re-created
+	for (auto sb = m_storageBuffers.begin(); sb != m_storageBuffers.end(); sb++) {
+		if (!sb->buffer || !sb->buffer->Valid())
+			continue;
+		VkBuffer buffer = sb->buffer->GetBuffer(m_app, bufferIndex);
+		if (sb->descriptorBufferInfos[bufferIndex].buffer != buffer) {
+			sb->descriptorBufferInfos[bufferIndex].buffer = buffer;
 
-		// update textures that changed
-		for (auto sampler = m_samplers.begin(); sampler != m_samplers.end(); sampler++) {
-			W_BOUND_RESOURCE* info = sampler->sampler_info;
-			bool bChanged = false;
-			for (uint32_t textureArrayIndex = 0; textureArrayIndex < (uint32_t)sampler->images.size(); textureArrayIndex++) {
-				if (sampler->images[textureArrayIndex] && sampler->images[textureArrayIndex]->Valid()) {
-					if (sampler->descriptors[bufferIndex][textureArrayIndex].imageView != sampler->images[textureArrayIndex]->GetView()) {
-						sampler->descriptors[bufferIndex][textureArrayIndex].imageView = sampler->images[textureArrayIndex]->GetView();
-						sampler->descriptors[bufferIndex][textureArrayIndex].imageLayout = sampler->images[textureArrayIndex]->GetViewLayout();
-						bChanged = true;
-					}
-				}
-			}
-			if (bChanged) {
-				VkWriteDescriptorSet writeDescriptorSet = {};
-				writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-				writeDescriptorSet.dstSet = m_descriptorSets[bufferIndex];
-				writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-				writeDescriptorSet.descriptorCount = (uint32_t)sampler->descriptors[bufferIndex].size();
-				writeDescriptorSet.pImageInfo = sampler->descriptors[bufferIndex].data();
-				writeDescriptorSet.dstBinding = info->binding_index;
+			VkWriteDescriptorSet writeDescriptorSet = {};
+			writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSet.dstSet = m_descriptorSets[bufferIndex];
+			writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writeDescriptorSet.descriptorCount = 1;
+			writeDescriptorSet.pBufferInfo = &sb->descriptorBufferInfos[bufferIndex];
+			writeDescriptorSet.dstBinding = sb->sb_info->binding_index;
 
-				m_writeDescriptorSets[numUpdateDescriptors++] = writeDescriptorSet;
-			}
+			m_writeDescriptorSets[numUpdateDescriptors++] = writeDescriptorSet;
 		}
-		if (numUpdateDescriptors > 0)
-			vkUpdateDescriptorSets(device, numUpdateDescriptors, m_writeDescriptorSets.data(), 0, NULL);
-
-		vkCmdBindDescriptorSets(renderCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_effect->GetPipelineLayout(), m_setIndex, 1, &m_descriptorSets[bufferIndex], 0, nullptr);
 	}
 
-	if (bindPushConsts) {
-		for (auto pc = m_pushConstants.begin(); pc != m_pushConstants.end(); pc++)
-			vkCmdPushConstants(renderCmdBuffer, m_effect->GetPipelineLayout(), pc->shaderStages, (uint32_t)pc->pc_info->OffsetAtVariable(0), (uint32_t)pc->pc_info->GetSize(), pc->data);
-	}
+	if (numUpdateDescriptors > 0)
+		vkUpdateDescriptorSets(device, numUpdateDescriptors, m_writeDescriptorSets.data(), 0, NULL);
 
 	return WError(W_SUCCEEDED);
 }
@@ -341,6 +500,10 @@ WEffect* WMaterial::GetEffect() const {
 	return m_effect;
 }
 
+uint32_t WMaterial::GetBindingSet() const {
+	return m_setIndex;
+}
+
 WError WMaterial::SetVariableData(const char* varName, void* data, size_t len) {
 	uint32_t bufferIndex = m_app->GetCurrentBufferingIndex();
 	bool isFound = false;
@@ -352,11 +515,7 @@ WError WMaterial::SetVariableData(const char* varName, void* data, size_t len) {
 				size_t offset = info->OffsetAtVariable(j);
 				if (varsize < len || offset + len > ubo->descriptorBufferInfos[bufferIndex].range)
 					return WError(W_INVALIDPARAM);
-				if (memcmp((char*)ubo->data + offset, data, len) != 0) {
-					memcpy((char*)ubo->data + offset, data, len);
-					for (uint32_t d = 0; d < ubo->dirty.size(); d++)
-						ubo->dirty[d] = true;
-				}
+				_SetUBOData(*ubo, offset, data, len);
 				isFound = true;
 			}
 		}
@@ -376,6 +535,65 @@ WError WMaterial::SetVariableData(const char* varName, void* data, size_t len) {
 	return WError(isFound ? W_SUCCEEDED : W_INVALIDPARAM);
 }
 
+WMaterialVariableHandle WMaterial::GetVariableHandle(const char* varName) const {
+	WMaterialVariableHandle handle;
+	handle.effect = m_effect;
+	handle.effectID = m_effect ? m_effect->GetUniqueID() : 0;
+	handle.bindingSet = m_setIndex;
+
+	for (uint32_t i = 0; i < m_uniformBuffers.size(); i++) {
+		W_BOUND_RESOURCE* info = m_uniformBuffers[i].ubo_info;
+		for (uint32_t j = 0; j < info->variables.size() && handle.numLocations < WMaterialVariableHandle::MAX_LOCATIONS; j++) {
+			if (strcmp(info->variables[j].name.c_str(), varName) == 0) {
+				WMaterialVariableHandle::LOCATION& location = handle.locations[handle.numLocations++];
+				location.isPushConstant = false;
+				location.resourceIndex = i;
+				location.offset = (uint32_t)info->OffsetAtVariable(j);
+				location.size = (uint32_t)info->variables[j].GetSize();
+			}
+		}
+	}
+	for (uint32_t i = 0; i < m_pushConstants.size(); i++) {
+		W_BOUND_RESOURCE* info = m_pushConstants[i].pc_info;
+		for (uint32_t j = 0; j < info->variables.size() && handle.numLocations < WMaterialVariableHandle::MAX_LOCATIONS; j++) {
+			if (strcmp(info->variables[j].name.c_str(), varName) == 0) {
+				WMaterialVariableHandle::LOCATION& location = handle.locations[handle.numLocations++];
+				location.isPushConstant = true;
+				location.resourceIndex = i;
+				location.offset = (uint32_t)info->OffsetAtVariable(j);
+				location.size = (uint32_t)info->variables[j].GetSize();
+			}
+		}
+	}
+
+	return handle;
+}
+
+WError WMaterial::SetVariableData(const WMaterialVariableHandle& handle, const void* data, size_t len) {
+	if (!handle.Valid() || !m_effect || handle.effectID != m_effect->GetUniqueID() || handle.bindingSet != m_setIndex)
+		return WError(W_INVALIDPARAM);
+
+	for (uint32_t i = 0; i < handle.numLocations; i++) {
+		const WMaterialVariableHandle::LOCATION& location = handle.locations[i];
+		if (location.size < len ||
+			location.resourceIndex >= (location.isPushConstant ? m_pushConstants.size() : m_uniformBuffers.size()))
+			return WError(W_INVALIDPARAM);
+		if (location.isPushConstant)
+			memcpy((char*)m_pushConstants[location.resourceIndex].data + location.offset, data, len);
+		else
+			_SetUBOData(m_uniformBuffers[location.resourceIndex], location.offset, data, len);
+	}
+	return WError(W_SUCCEEDED);
+}
+
+void WMaterial::_SetUBOData(UNIFORM_BUFFER_INFO& ubo, size_t offset, const void* data, size_t len) {
+	if (memcmp((char*)ubo.data + offset, data, len) != 0) {
+		memcpy((char*)ubo.data + offset, data, len);
+		for (uint32_t d = 0; d < ubo.dirty.size(); d++)
+			ubo.dirty[d] = true;
+	}
+}
+
 WError WMaterial::SetTexture(uint32_t binding_index, WImage* img, uint32_t arrayIndex) {
 	bool isFound = false;
 	for (uint32_t i = 0; i < m_samplers.size(); i++) {
@@ -389,7 +607,7 @@ WError WMaterial::SetTexture(uint32_t binding_index, WImage* img, uint32_t array
 					if (img) {
 						m_samplers[i].images[arrayIndex] = img;
 						img->AddReference();
-					} else {
+					} else if (info->type == W_TYPE_TEXTURE) {
 						m_samplers[i].images[arrayIndex] = m_app->ImageManager->GetDefaultImage();
 						m_app->ImageManager->GetDefaultImage()->AddReference();
 					}
@@ -414,7 +632,7 @@ WError WMaterial::SetTexture(std::string name, WImage* img, uint32_t arrayIndex)
 					if (img) {
 						m_samplers[i].images[arrayIndex] = img;
 						img->AddReference();
-					} else {
+					} else if (info->type == W_TYPE_TEXTURE) {
 						m_samplers[i].images[arrayIndex] = m_app->ImageManager->GetDefaultImage();
 						m_app->ImageManager->GetDefaultImage()->AddReference();
 					}
@@ -426,6 +644,67 @@ WError WMaterial::SetTexture(std::string name, WImage* img, uint32_t arrayIndex)
 	return WError(isFound ? W_SUCCEEDED : W_INVALIDPARAM);
 }
 
+uint32_t WMaterial::GetTextures(uint32_t bindingIndex, WImage** images, uint32_t maxImages) const {
+	for (uint32_t i = 0; i < m_samplers.size(); i++) {
+		if (m_samplers[i].sampler_info->binding_index == bindingIndex) {
+			uint32_t numImages = std::min(maxImages, (uint32_t)m_samplers[i].images.size());
+			for (uint32_t j = 0; j < numImages; j++)
+				images[j] = m_samplers[i].images[j];
+			return numImages;
+		}
+	}
+	return 0;
+}
+
+WError WMaterial::SetStorageBuffer(uint32_t bindingIndex, WBufferedBuffer* buffer) {
+	bool isFound = false;
+	for (uint32_t i = 0; i < m_storageBuffers.size(); i++) {
+		if (m_storageBuffers[i].sb_info->binding_index == bindingIndex) {
+			m_storageBuffers[i].buffer = buffer;
+			isFound = true;
+		}
+	}
+	return WError(isFound ? W_SUCCEEDED : W_INVALIDPARAM);
+}
+
+WError WMaterial::SetStorageBuffer(std::string name, WBufferedBuffer* buffer) {
+	bool isFound = false;
+	for (uint32_t i = 0; i < m_storageBuffers.size(); i++) {
+		if (m_storageBuffers[i].sb_info->name == name) {
+			m_storageBuffers[i].buffer = buffer;
+			isFound = true;
+		}
+	}
+	return WError(isFound ? W_SUCCEEDED : W_INVALIDPARAM);
+}
+
+const void* WMaterial::GetUniformBufferData(uint32_t bindingIndex, size_t* size) const {
+	for (uint32_t i = 0; i < m_uniformBuffers.size(); i++) {
+		if (m_uniformBuffers[i].ubo_info->binding_index == bindingIndex) {
+			*size = m_uniformBuffers[i].ubo_info->GetSize();
+			return m_uniformBuffers[i].data;
+		}
+	}
+	*size = 0;
+	return nullptr;
+}
+
+bool WMaterial::GetUniformBufferVariable(uint32_t bindingIndex, const char* varName, size_t* offset, size_t* size) const {
+	for (uint32_t i = 0; i < m_uniformBuffers.size(); i++) {
+		W_BOUND_RESOURCE* info = m_uniformBuffers[i].ubo_info;
+		if (info->binding_index != bindingIndex)
+			continue;
+		for (uint32_t j = 0; j < info->variables.size(); j++) {
+			if (strcmp(info->variables[j].name.c_str(), varName) == 0) {
+				*offset = info->OffsetAtVariable(j);
+				*size = info->variables[j].GetSize();
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
 WError WMaterial::SaveToStream(WFile* file, std::ostream& outputStream) {
 	if (!Valid())
 		return WError(W_NOTVALID);
@@ -440,12 +719,16 @@ WError WMaterial::SaveToStream(WFile* file, std::ostream& outputStream) {
 		outputStream.write((char*)UBO->data, size);
 	}
 
-	// write the texture data
+	// write the texture data (storage images are not saved, they are set by their users at runtime)
 	char tmpName[W_MAX_ASSET_NAME_SIZE];
-	tmp = (uint32_t)m_samplers.size();
+	tmp = 0;
+	for (uint32_t i = 0; i < m_samplers.size(); i++)
+		tmp += m_samplers[i].sampler_info->type == W_TYPE_TEXTURE ? 1 : 0;
 	outputStream.write((char*)&tmp, sizeof(tmp));
 	for (uint32_t i = 0; i < m_samplers.size(); i++) {
 		SAMPLER_INFO* SI = &m_samplers[i];
+		if (SI->sampler_info->type != W_TYPE_TEXTURE)
+			continue;
 		outputStream.write((char*)& SI->sampler_info->binding_index, sizeof(SI->sampler_info->binding_index));
 		tmp = (uint32_t)SI->images.size();
 		outputStream.write((char*)&tmp, sizeof(tmp));
@@ -462,6 +745,8 @@ WError WMaterial::SaveToStream(WFile* file, std::ostream& outputStream) {
 	// save dependencies
 	for (uint32_t i = 0; i < m_samplers.size(); i++) {
 		SAMPLER_INFO* SI = &m_samplers[i];
+		if (SI->sampler_info->type != W_TYPE_TEXTURE)
+			continue;
 		for (uint32_t j = 0; j < SI->images.size(); j++) {
 			WError err = file->SaveAsset(SI->images[j]);
 			if (!err)
@@ -572,6 +857,26 @@ WError WMaterialCollection::SetVariableData(const char* varName, void* data, siz
 	return ret;
 }
 
+WMaterialCollectionVariableHandle WMaterialCollection::GetVariableHandle(const char* varName) const {
+	WMaterialCollectionVariableHandle handle;
+	for (auto it : m_materials) {
+		WMaterialVariableHandle materialHandle = it.first->GetVariableHandle(varName);
+		if (materialHandle.Valid())
+			handle.push_back(std::make_pair(it.first, materialHandle));
+	}
+	return handle;
+}
+
+WError WMaterialCollection::SetVariableData(const WMaterialCollectionVariableHandle& handle, const void* data, size_t len) {
+	WError ret = WError(W_NOTVALID);
+	for (auto it : handle) {
+		WError err = it.first->SetVariableData(it.second, data, len);
+		if (ret != W_SUCCEEDED)
+			ret = err;
+	}
+	return ret;
+}
+
 WError WMaterialCollection::SetTexture(uint32_t bindingIndex, class WImage* img, uint32_t arrayIndex) {
 	WError ret = WError(W_NOTVALID);
 	for (auto it : m_materials) {
@@ -7,7 +7,6 @@ WBufferedBuffer::WBufferedBuffer() {
 }
 
 VkResult WBufferedBuffer::Create(Wasabi* app, uint32_t numBuffers, size_t size, VkBufferUsageFlags usage, void* data, W_MEMORY_STORAGE memory) {
-	VkDevice device = app->GetVulkanDevice();
 	Destroy(app);
 
 	VkResult result = VK_SUCCESS;
@@ -17,7 +16,6 @@ VkResult WBufferedBuffer::Create(Wasabi* app, uint32_t numBuffers, size_t size,
 
 	m_bufferSize = size;
 
-	WVulkanBuffer stagingBuffer;
 	for (uint32_t i = 0; i < numBuffers; i++) {
 		VkMemoryPropertyFlags bufferMemoryFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT; // device local means only GPU can access it, more efficient
 		if (data && (memory == W_MEMORY_DEVICE_LOCAL || memory == W_MEMORY_DEVICE_LOCAL_HOST_COPY)) {
@@ -30,8 +28,8 @@ VkResult WBufferedBuffer::Create(Wasabi* app, uint32_t numBuffers, size_t size,
 		}
 
 		//
-		// Create the buffer as a destination of a copy, from the staging buffer to this buffer
-		// unless no staging buffer was created, then we don't need to perform any transfer.
+		// Create the buffer as a destination of a copy, from the staging memory to this buffer
+		// unless no staging is needed, then we don't need to perform any transfer.
 		//
 		VkBufferCreateInfo bufferCreateInfo = {};
 		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -44,94 +42,34 @@ VkResult WBufferedBuffer::Create(Wasabi* app, uint32_t numBuffers, size_t size,
 			break;
 		m_buffers.push_back(buffer);
 
-		//
-		// Create a host-visible staging buffer that contains the raw buffer data.
-		// we will later copy that buffer's contents into the newly created buffer.
-		// If the resource is host-visible or no initial data is provided, we won't
-		// need to perform the staging operation.
-		//
 		if (data && (memory == W_MEMORY_DEVICE_LOCAL || memory == W_MEMORY_DEVICE_LOCAL_HOST_COPY)) {
-			VkBufferCreateInfo stagingBufferCreateInfo = {};
-			stagingBufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-			stagingBufferCreateInfo.size = size;
-			stagingBufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT; // This buffer is used as a transfer source for the buffer copy
-			stagingBufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-			result = stagingBuffer.Create(app, stagingBufferCreateInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-			if (result != VK_SUCCESS)
-				break;
-
-			void* pStagingMem;
-			result = vkMapMemory(device, stagingBuffer.mem, 0, size, 0, &pStagingMem);
+			//
+			// Queue an upload of the data into the buffer. The memory manager copies
+			// the data into its staging ring and submits the copy along with other
+			// pending uploads, so this does not wait for the GPU.
+			//
+			result = app->MemoryManager->UploadToBuffer(buffer.buf, 0, data, size);
 			if (result != VK_SUCCESS)
 				break;
-			memcpy(pStagingMem, data, size);
-			vkUnmapMemory(device, stagingBuffer.mem);
-		}
 
-		//
-		// Now copy the contents of the staging buffer into the buffer memory
-		// and then delete the staging buffer.
-		//
-		if (stagingBuffer.buf) {
-			result = app->MemoryManager->BeginCopyCommandBuffer();
-			if (result != VK_SUCCESS)
-				break;
-
-			VkCommandBuffer copyCmdBuffer = app->MemoryManager->GetCopyCommandBuffer();
-
-			VkBufferCopy copyRegion = {};
-			copyRegion.size = size;
-			vkCmdCopyBuffer(
-				copyCmdBuffer,
-				stagingBuffer.buf,
-				buffer.buf,
-				1,
-				&copyRegion);
-
-			VkBufferMemoryBarrier bufferMemoryBarrier = {};
-			bufferMemoryBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-			bufferMemoryBarrier.buffer = buffer.buf;
-			bufferMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			bufferMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-			bufferMemoryBarrier.offset = 0;
-			bufferMemoryBarrier.size = size;
-
-			// Put barrier inside setup command buffer
-			vkCmdPipelineBarrier(
-				copyCmdBuffer,
-				VK_PIPELINE_STAGE_TRANSFER_BIT,
-				VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
-				0,
-				0, nullptr,
-				1, &bufferMemoryBarrier,
-				0, nullptr);
-
-			result = app->MemoryManager->EndCopyCommandBuffer(true);
-			if (result != VK_SUCCESS)
-				break;
-
-			stagingBuffer.Destroy(app);
-
-			if (memory == W_MEMORY_DEVICE_LOCAL_HOST_COPY) {
+			if (memory == W_MEMORY_DEVICE_LOCAL_HOST_COPY && !m_readOnlyMemory) {
 				m_readOnlyMemory = W_SAFE_ALLOC(size);
 				memcpy(m_readOnlyMemory, data, size);
 			}
-		} else if (data) {
-			// this is a dynamic buffer with initialization info, map/unmap to initialize
+		} else if (memory == W_MEMORY_HOST_VISIBLE) {
+			// dynamic buffers are mapped once and stay mapped for their lifetime
 			void* pMemData;
-			result = Map(app, i, &pMemData, W_MAP_WRITE);
+			result = buffer.Map(app, &pMemData);
 			if (result != VK_SUCCESS)
 				break;
-			memcpy(pMemData, data, size);
-			Unmap(app, i);
+			m_mappedData.push_back(pMemData);
+			if (data)
+				memcpy(pMemData, data, size);
 		}
 	}
 
-	if (result != VK_SUCCESS) {
-		stagingBuffer.Destroy(app);
+	if (result != VK_SUCCESS)
 		Destroy(app);
-	}
 
 	return result;
 }
@@ -140,6 +78,7 @@ void WBufferedBuffer::Destroy(Wasabi* app) {
 	for (auto it = m_buffers.begin(); it != m_buffers.end(); it++)
 		it->Destroy(app);
 	m_buffers.clear();
+	m_mappedData.clear();
 	m_bufferSize = 0;
 	W_SAFE_FREE(m_readOnlyMemory);
 }
@@ -154,8 +93,11 @@ VkResult WBufferedBuffer::Map(Wasabi* app, uint32_t bufferIndex, void** data, W_
 			return VK_SUCCESS;
 		}
 
-		VkDevice device = app->GetVulkanDevice();
-		result = vkMapMemory(device, m_buffers[bufferIndex].mem, 0, m_bufferSize, 0, data);
+		if (bufferIndex < m_mappedData.size()) {
+			*data = m_mappedData[bufferIndex];
+			result = VK_SUCCESS;
+		} else
+			result = m_buffers[bufferIndex].Map(app, data);
 		if (result == VK_SUCCESS)
 			m_lastMapFlags = flags;
 	}
@@ -164,10 +106,9 @@ VkResult WBufferedBuffer::Map(Wasabi* app, uint32_t bufferIndex, void** data, W_
 
 void WBufferedBuffer::Unmap(Wasabi* app, uint32_t bufferIndex) {
 	if (m_lastMapFlags != W_MAP_UNDEFINED) {
-		if (!m_readOnlyMemory) {
-			VkDevice device = app->GetVulkanDevice();
-			vkUnmapMemory(device, m_buffers[bufferIndex].mem);
-		}
+		// persistently mapped buffers are host-coherent, there is nothing to flush
+		if (!m_readOnlyMemory && bufferIndex >= m_mappedData.size())
+			m_buffers[bufferIndex].Unmap(app);
 
 		m_lastMapFlags = W_MAP_UNDEFINED;
 	}
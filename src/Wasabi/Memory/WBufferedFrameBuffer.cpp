@@ -2,6 +2,7 @@
 #include "Wasabi/Core/WCore.hpp"
 
 WBufferedFrameBuffer::WBufferedFrameBuffer() {
+	m_numSwapchainImages = 0;
 }
 
 VkResult WBufferedFrameBuffer::CreateForSwapchain(Wasabi* app, uint32_t numBuffers, uint32_t width, uint32_t height, VkRenderPass renderPass, std::vector<VkImageView> swapchainViews, VkFormat depthFormat) {
@@ -22,16 +23,19 @@ VkResult WBufferedFrameBuffer::CreateForSwapchain(Wasabi* app, uint32_t numBuffe
 	frameBufferCreateInfo.height = height;
 	frameBufferCreateInfo.layers = 1;
 
-	// Create the frame buffer
-	for (uint32_t i = 0; i < numBuffers; i++) {
-		attachments[0] = swapchainViews[i];
-		attachments[1] = m_swapchainDepthBuffer.GetView(app, i);
-
-		VkFramebuffer frameBuffer;
-		result = vkCreateFramebuffer(device, &frameBufferCreateInfo, nullptr, &frameBuffer);
-		if (result != VK_SUCCESS)
-			break;
-		m_frameBuffers.push_back(frameBuffer);
+	// Create the frame buffers, indexed by (buffer index * number of images + image index)
+	m_numSwapchainImages = (uint32_t)swapchainViews.size();
+	for (uint32_t i = 0; i < numBuffers && result == VK_SUCCESS; i++) {
+		for (uint32_t j = 0; j < m_numSwapchainImages; j++) {
+			attachments[0] = swapchainViews[j];
+			attachments[1] = m_swapchainDepthBuffer.GetView(app, i);
+
+			VkFramebuffer frameBuffer;
+			result = vkCreateFramebuffer(device, &frameBufferCreateInfo, nullptr, &frameBuffer);
+			if (result != VK_SUCCESS)
+				break;
+			m_frameBuffers.push_back(frameBuffer);
+		}
 	}
 
 	if (result != VK_SUCCESS)
@@ -78,11 +82,14 @@ void WBufferedFrameBuffer::Destroy(Wasabi* app) {
 	for (auto it = m_frameBuffers.begin(); it != m_frameBuffers.end(); it++)
 		app->MemoryManager->ReleaseFramebuffer(*it, app->GetCurrentBufferingIndex());
 	m_frameBuffers.clear();
+	m_numSwapchainImages = 0;
 
 	m_swapchainDepthBuffer.Destroy(app);
 }
 
-VkFramebuffer WBufferedFrameBuffer::GetFrameBuffer(uint32_t bufferIndex) {
+VkFramebuffer WBufferedFrameBuffer::GetFrameBuffer(uint32_t bufferIndex, uint32_t backbufferIndex) {
+	if (m_numSwapchainImages > 0)
+		return m_frameBuffers[bufferIndex * m_numSwapchainImages + backbufferIndex];
 	return m_frameBuffers[bufferIndex];
 }
 
@@ -11,7 +11,6 @@ WBufferedImage::WBufferedImage() {
 }
 
 VkResult WBufferedImage::Create(Wasabi* app, uint32_t numBuffers, uint32_t width, uint32_t height, uint32_t depth, WBufferedImageProperties properties, void* pixels) {
-	VkDevice device = app->GetVulkanDevice();
 	Destroy(app);
 
 	VkResult result = VK_SUCCESS;
@@ -83,6 +82,26 @@ VkResult WBufferedImage::Create(Wasabi* app, uint32_t numBuffers, uint32_t width
 		m_images.push_back(image);
 		m_layouts.push_back(imageCreateInfo.initialLayout);
 
+		if (properties.memory != W_MEMORY_HOST_VISIBLE) {
+			//
+			// Static images are uploaded asynchronously: the memory manager copies the
+			// pixels into its staging ring and submits the copy (and the layout
+			// transitions) along with other pending uploads.
+			//
+			result = app->MemoryManager->UploadToImage(
+				image.img, _GetSubresourceRange(), m_layouts.back(), _GetTargetLayout(),
+				_GetCopyRegion(), imageCreateInfo.extent, pixels, pixels ? m_bufferSize : 0, pixelSize.second / 8);
+			if (result != VK_SUCCESS)
+				break;
+			m_layouts.back() = _GetTargetLayout();
+
+			if (properties.memory == W_MEMORY_DEVICE_LOCAL_HOST_COPY && !m_readOnlyMemory && pixels) {
+				m_readOnlyMemory = W_SAFE_ALLOC(m_bufferSize);
+				memcpy(m_readOnlyMemory, pixels, m_bufferSize);
+			}
+			continue;
+		}
+
 		//
 		// Create a host-visible staging buffer that contains the raw image data.
 		// we will later copy that buffer's contents into the newly created image.
@@ -101,31 +120,23 @@ VkResult WBufferedImage::Create(Wasabi* app, uint32_t numBuffers, uint32_t width
 
 		if (pixels) {
 			void* pStagingMem;
-			result = vkMapMemory(device, stagingBuffer.mem, 0, m_bufferSize, 0, &pStagingMem);
+			result = stagingBuffer.Map(app, &pStagingMem);
 			if (result != VK_SUCCESS)
 				break;
 			memcpy(pStagingMem, pixels, m_bufferSize);
-			vkUnmapMemory(device, stagingBuffer.mem);
+			stagingBuffer.Unmap(app);
 		}
 
 		//
-		// Now copy the contents of the staging buffer into the image memory
-		// If the image is dynamic, then this staging buffer will persist for
-		// as long as the image does. Otherwise, we will need to delete it.
+		// Now copy the contents of the staging buffer into the image memory.
+		// The staging buffer will persist for as long as the image does.
 		//
 		result = CopyStagingToImage(app, stagingBuffer, image, m_layouts[m_layouts.size()-1]);
 		if (result != VK_SUCCESS)
 			break;
 
-		if (properties.memory != W_MEMORY_HOST_VISIBLE)
-			stagingBuffer.Destroy(app);
-		else
-			m_stagingBuffers.push_back(stagingBuffer);
-
-		if (properties.memory == W_MEMORY_DEVICE_LOCAL_HOST_COPY) {
-			m_readOnlyMemory = W_SAFE_ALLOC(m_bufferSize);
-			memcpy(m_readOnlyMemory, pixels, m_bufferSize);
-		}
+		m_stagingBuffers.push_back(stagingBuffer);
+		stagingBuffer = WVulkanBuffer();
 	}
 
 	if (result != VK_SUCCESS) {
@@ -136,25 +147,55 @@ VkResult WBufferedImage::Create(Wasabi* app, uint32_t numBuffers, uint32_t width
 	return result;
 }
 
-VkResult WBufferedImage::CopyStagingToImage(Wasabi* app, WVulkanBuffer& buffer, WVulkanImage& image, VkImageLayout& initialLayout) {
-	VkImageLayout targetLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+VkImageLayout WBufferedImage::_GetTargetLayout() const {
+	// storage images are written by shaders and (possibly) sampled in the same layout
+	if (m_properties.usage & VK_IMAGE_USAGE_STORAGE_BIT)
+		return VK_IMAGE_LAYOUT_GENERAL;
 	if (!(m_properties.usage & VK_IMAGE_USAGE_SAMPLED_BIT)) {
 		if (m_properties.usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
-			targetLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 		else if (m_properties.usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
-			targetLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 		else
-			targetLayout = VK_IMAGE_LAYOUT_GENERAL;
+			return VK_IMAGE_LAYOUT_GENERAL;
 	}
+	return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+}
+
+VkImageSubresourceRange WBufferedImage::_GetSubresourceRange() const {
+	VkImageSubresourceRange subresourceRange = {};
+	subresourceRange.aspectMask = m_aspect;
+	subresourceRange.levelCount = m_properties.mipLevels;
+	subresourceRange.layerCount = m_properties.arraySize;
+	return subresourceRange;
+}
+
+VkBufferImageCopy WBufferedImage::_GetCopyRegion() const {
+	// Only the first mip level is copied
+	VkBufferImageCopy bufferCopyRegion = {};
+	bufferCopyRegion.imageSubresource.aspectMask = m_aspect;
+	bufferCopyRegion.imageSubresource.mipLevel = 0;
+	bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
+	bufferCopyRegion.imageSubresource.layerCount = m_properties.arraySize;
+	bufferCopyRegion.imageExtent.width = m_width;
+	bufferCopyRegion.imageExtent.height = m_height;
+	bufferCopyRegion.imageExtent.depth = m_depth;
+	bufferCopyRegion.bufferOffset = 0;
+
+	if (m_aspect & VK_IMAGE_ASPECT_DEPTH_BIT && m_aspect & VK_IMAGE_ASPECT_STENCIL_BIT)
+		bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+	return bufferCopyRegion;
+}
+
+VkResult WBufferedImage::CopyStagingToImage(Wasabi* app, WVulkanBuffer& buffer, WVulkanImage& image, VkImageLayout& initialLayout) {
+	VkImageLayout targetLayout = _GetTargetLayout();
 
 	VkResult result = app->MemoryManager->BeginCopyCommandBuffer();
 	if (result == VK_SUCCESS) {
 		VkCommandBuffer copyCmdBuffer = app->MemoryManager->GetCopyCommandBuffer();
 
-		VkImageSubresourceRange subresourceRange = {};
-		subresourceRange.aspectMask = m_aspect;
-		subresourceRange.levelCount = m_properties.mipLevels;
-		subresourceRange.layerCount = m_properties.arraySize;
+		VkImageSubresourceRange subresourceRange = _GetSubresourceRange();
 
 		// Image barrier for optimal image (target)
 		// Optimal image will be used as destination for the copy
@@ -167,21 +208,8 @@ VkResult WBufferedImage::CopyStagingToImage(Wasabi* app, WVulkanBuffer& buffer,
 			subresourceRange
 		);
 
-		// Setup buffer copy regions for each mip level
-		VkBufferImageCopy bufferCopyRegion = {};
-		bufferCopyRegion.imageSubresource.aspectMask = m_aspect;
-		bufferCopyRegion.imageSubresource.mipLevel = 0;
-		bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
-		bufferCopyRegion.imageSubresource.layerCount = m_properties.arraySize;
-		bufferCopyRegion.imageExtent.width = m_width;
-		bufferCopyRegion.imageExtent.height = m_height;
-		bufferCopyRegion.imageExtent.depth = m_depth;
-		bufferCopyRegion.bufferOffset = 0;
-
-		if (m_aspect & VK_IMAGE_ASPECT_DEPTH_BIT && m_aspect & VK_IMAGE_ASPECT_STENCIL_BIT)
-			bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-
 		// Copy mip levels from staging buffer
+		VkBufferImageCopy bufferCopyRegion = _GetCopyRegion();
 		vkCmdCopyBufferToImage(
 			copyCmdBuffer,
 			buffer.buf,
@@ -229,13 +257,11 @@ VkResult WBufferedImage::Map(Wasabi* app, uint32_t bufferIndex, void** pixels, W
 			*pixels = m_readOnlyMemory;
 			result = VK_SUCCESS;
 		} else if (m_stagingBuffers.size() > 0) {
-			VkDevice device = app->GetVulkanDevice();
-			result = vkMapMemory(device, m_stagingBuffers[bufferIndex].mem, 0, m_bufferSize, 0, pixels);
+			result = m_stagingBuffers[bufferIndex].Map(app, pixels);
 			if (result == VK_SUCCESS)
 				m_lastMapFlags = flags;
 		} else {
-			VkDevice device = app->GetVulkanDevice();
-			result = vkMapMemory(device, m_images[bufferIndex].mem, 0, m_bufferSize, 0, pixels);
+			result = m_images[bufferIndex].Map(app, pixels);
 			if (result == VK_SUCCESS)
 				m_lastMapFlags = flags;
 		}
@@ -247,12 +273,10 @@ void WBufferedImage::Unmap(Wasabi* app, uint32_t bufferIndex) {
 	if (m_lastMapFlags != W_MAP_UNDEFINED) {
 		if (m_readOnlyMemory) {
 		} else if (m_stagingBuffers.size() > 0) {
-			VkDevice device = app->GetVulkanDevice();
-			vkUnmapMemory(device, m_stagingBuffers[bufferIndex].mem);
+			m_stagingBuffers[bufferIndex].Unmap(app);
 			CopyStagingToImage(app, m_stagingBuffers[bufferIndex], m_images[bufferIndex], m_layouts[bufferIndex]);
 		} else {
-			VkDevice device = app->GetVulkanDevice();
-			vkUnmapMemory(device, m_images[bufferIndex].mem);
+			m_images[bufferIndex].Unmap(app);
 		}
 
 		m_lastMapFlags = W_MAP_UNDEFINED;
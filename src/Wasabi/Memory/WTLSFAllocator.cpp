@@ -0,0 +1,258 @@
+#include "Wasabi/Memory/WTLSFAllocator.hpp"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+	/** Index of the least significant set bit, x must not be 0 */
+	inline uint32_t LowestBit(uint64_t x) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, x);
+		return (uint32_t)index;
+#else
+		return (uint32_t)__builtin_ctzll(x);
+#endif
+	}
+
+	/** Index of the most significant set bit, x must not be 0 */
+	inline uint32_t HighestBit(uint64_t x) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, x);
+		return (uint32_t)index;
+#else
+		return 63 - (uint32_t)__builtin_clzll(x);
+#endif
+	}
+};
+
+WTLSFAllocator::WTLSFAllocator() {
+	Initialize(0);
+}
+
+WTLSFAllocator::~WTLSFAllocator() {
+}
+
+void WTLSFAllocator::Initialize(uint64_t size) {
+	m_size = size;
+	m_usedSize = 0;
+	m_numAllocations = 0;
+	m_numFreeRegions = 0;
+	m_nodes.clear();
+	m_unusedNodes.clear();
+	m_firstLevelBitmap = 0;
+	for (uint32_t i = 0; i < FL_COUNT; i++) {
+		m_secondLevelBitmaps[i] = 0;
+		for (uint32_t j = 0; j < SL_COUNT; j++)
+			m_freeLists[i][j] = INVALID_NODE;
+	}
+
+	if (size > 0) {
+		uint32_t node = _NewNode();
+		m_nodes[node].offset = 0;
+		m_nodes[node].size = size;
+		_InsertFree(node);
+	}
+}
+
+uint32_t WTLSFAllocator::Allocate(uint64_t size, uint64_t alignment, uint64_t* offset) {
+	if (size == 0)
+		return INVALID_NODE;
+	if (alignment < 1)
+		alignment = 1;
+
+	// searching for the worst-case padding guarantees any block found can be aligned
+	uint32_t node = _FindFree(size + alignment - 1);
+	if (node == INVALID_NODE)
+		return INVALID_NODE;
+	_RemoveFree(node);
+
+	uint64_t alignedOffset = (m_nodes[node].offset + alignment - 1) & ~(alignment - 1);
+	uint64_t padding = alignedOffset - m_nodes[node].offset;
+	if (padding > 0) {
+		// return the leading padding to the free lists as its own region
+		uint32_t pad = _NewNode();
+		m_nodes[pad].offset = m_nodes[node].offset;
+		m_nodes[pad].size = padding;
+		m_nodes[pad].prevPhysical = m_nodes[node].prevPhysical;
+		m_nodes[pad].nextPhysical = node;
+		if (m_nodes[pad].prevPhysical != INVALID_NODE)
+			m_nodes[m_nodes[pad].prevPhysical].nextPhysical = pad;
+		m_nodes[node].offset = alignedOffset;
+		m_nodes[node].size -= padding;
+		m_nodes[node].prevPhysical = pad;
+		_InsertFree(pad);
+	}
+
+	if (m_nodes[node].size > size) {
+		// split the remainder into a free region
+		uint32_t rest = _NewNode();
+		m_nodes[rest].offset = alignedOffset + size;
+		m_nodes[rest].size = m_nodes[node].size - size;
+		m_nodes[rest].prevPhysical = node;
+		m_nodes[rest].nextPhysical = m_nodes[node].nextPhysical;
+		if (m_nodes[rest].nextPhysical != INVALID_NODE)
+			m_nodes[m_nodes[rest].nextPhysical].prevPhysical = rest;
+		m_nodes[node].nextPhysical = rest;
+		m_nodes[node].size = size;
+		_InsertFree(rest);
+	}
+
+	m_nodes[node].free = false;
+	m_usedSize += m_nodes[node].size;
+	m_numAllocations++;
+
+	*offset = alignedOffset;
+	return node;
+}
+
+void WTLSFAllocator::Free(uint32_t node) {
+	if (node >= m_nodes.size() || m_nodes[node].free)
+		return;
+
+	m_usedSize -= m_nodes[node].size;
+	m_numAllocations--;
+
+	// coalesce with the physically preceding region
+	uint32_t prev = m_nodes[node].prevPhysical;
+	if (prev != INVALID_NODE && m_nodes[prev].free) {
+		_RemoveFree(prev);
+		m_nodes[node].offset = m_nodes[prev].offset;
+		m_nodes[node].size += m_nodes[prev].size;
+		m_nodes[node].prevPhysical = m_nodes[prev].prevPhysical;
+		if (m_nodes[node].prevPhysical != INVALID_NODE)
+			m_nodes[m_nodes[node].prevPhysical].nextPhysical = node;
+		m_unusedNodes.push_back(prev);
+	}
+
+	// coalesce with the physically succeeding region
+	uint32_t next = m_nodes[node].nextPhysical;
+	if (next != INVALID_NODE && m_nodes[next].free) {
+		_RemoveFree(next);
+		m_nodes[node].size += m_nodes[next].size;
+		m_nodes[node].nextPhysical = m_nodes[next].nextPhysical;
+		if (m_nodes[node].nextPhysical != INVALID_NODE)
+			m_nodes[m_nodes[node].nextPhysical].prevPhysical = node;
+		m_unusedNodes.push_back(next);
+	}
+
+	_InsertFree(node);
+}
+
+uint64_t WTLSFAllocator::GetSize() const {
+	return m_size;
+}
+
+uint64_t WTLSFAllocator::GetUsedSize() const {
+	return m_usedSize;
+}
+
+uint32_t WTLSFAllocator::GetNumAllocations() const {
+	return m_numAllocations;
+}
+
+uint32_t WTLSFAllocator::GetNumFreeRegions() const {
+	return m_numFreeRegions;
+}
+
+bool WTLSFAllocator::IsEmpty() const {
+	return m_numAllocations == 0;
+}
+
+uint32_t WTLSFAllocator::_NewNode() {
+	uint32_t node;
+	if (m_unusedNodes.size() > 0) {
+		node = m_unusedNodes.back();
+		m_unusedNodes.pop_back();
+	} else {
+		node = (uint32_t)m_nodes.size();
+		m_nodes.push_back(NODE());
+	}
+	m_nodes[node].offset = 0;
+	m_nodes[node].size = 0;
+	m_nodes[node].prevPhysical = INVALID_NODE;
+	m_nodes[node].nextPhysical = INVALID_NODE;
+	m_nodes[node].prevFree = INVALID_NODE;
+	m_nodes[node].nextFree = INVALID_NODE;
+	m_nodes[node].free = false;
+	return node;
+}
+
+void WTLSFAllocator::_Mapping(uint64_t size, uint32_t* fl, uint32_t* sl) const {
+	if (size < SL_COUNT) {
+		// small sizes get an exact bin each in the first first-level bin
+		*fl = 0;
+		*sl = (uint32_t)size;
+	} else {
+		uint32_t msb = HighestBit(size);
+		*fl = msb - SL_LOG2 + 1;
+		*sl = (uint32_t)(size >> (msb - SL_LOG2)) - SL_COUNT;
+	}
+}
+
+void WTLSFAllocator::_InsertFree(uint32_t node) {
+	uint32_t fl, sl;
+	_Mapping(m_nodes[node].size, &fl, &sl);
+
+	uint32_t head = m_freeLists[fl][sl];
+	m_nodes[node].free = true;
+	m_nodes[node].prevFree = INVALID_NODE;
+	m_nodes[node].nextFree = head;
+	if (head != INVALID_NODE)
+		m_nodes[head].prevFree = node;
+	m_freeLists[fl][sl] = node;
+
+	m_firstLevelBitmap |= 1ull << fl;
+	m_secondLevelBitmaps[fl] |= 1u << sl;
+	m_numFreeRegions++;
+}
+
+void WTLSFAllocator::_RemoveFree(uint32_t node) {
+	uint32_t fl, sl;
+	_Mapping(m_nodes[node].size, &fl, &sl);
+
+	uint32_t prev = m_nodes[node].prevFree;
+	uint32_t next = m_nodes[node].nextFree;
+	if (prev != INVALID_NODE)
+		m_nodes[prev].nextFree = next;
+	if (next != INVALID_NODE)
+		m_nodes[next].prevFree = prev;
+	if (m_freeLists[fl][sl] == node) {
+		m_freeLists[fl][sl] = next;
+		if (next == INVALID_NODE) {
+			m_secondLevelBitmaps[fl] &= ~(1u << sl);
+			if (m_secondLevelBitmaps[fl] == 0)
+				m_firstLevelBitmap &= ~(1ull << fl);
+		}
+	}
+
+	m_nodes[node].free = false;
+	m_nodes[node].prevFree = INVALID_NODE;
+	m_nodes[node].nextFree = INVALID_NODE;
+	m_numFreeRegions--;
+}
+
+uint32_t WTLSFAllocator::_FindFree(uint64_t size) const {
+	// round the size up to the next bin boundary so that any region in the
+	// found bin is guaranteed to fit
+	if (size >= SL_COUNT)
+		size += (1ull << (HighestBit(size) - SL_LOG2)) - 1;
+
+	uint32_t fl, sl;
+	_Mapping(size, &fl, &sl);
+	if (fl >= FL_COUNT)
+		return INVALID_NODE;
+
+	uint32_t slMap = m_secondLevelBitmaps[fl] & (~0u << sl);
+	if (slMap == 0) {
+		uint64_t flMap = fl + 1 < 64 ? m_firstLevelBitmap & (~0ull << (fl + 1)) : 0;
+		if (flMap == 0)
+			return INVALID_NODE;
+		fl = LowestBit(flMap);
+		slMap = m_secondLevelBitmaps[fl];
+	}
+	sl = LowestBit(slMap);
+	return m_freeLists[fl][sl];
+}
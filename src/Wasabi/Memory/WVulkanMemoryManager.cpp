@@ -1,6 +1,9 @@
 #include "Wasabi/Memory/WVulkanMemoryManager.hpp"
 #include "Wasabi/Core/WCore.hpp"
 
+#include <algorithm>
+#include <numeric>
+
 enum VULKAN_RESOURCE_TYPE: uint8_t {
 	VULKAN_RESOURCE_RENDERPASS = 0,
 	VULKAN_RESOURCE_SHADERMODULE = 1,
@@ -19,8 +22,14 @@ enum VULKAN_RESOURCE_TYPE: uint8_t {
 	VULKAN_RESOURCE_SEMAPHORE = 14,
 	VULKAN_RESOURCE_FENCE = 15,
 	VULKAN_RESOURCE_DESCRIPTORSETLAYOUT = 16,
+	VULKAN_RESOURCE_MEMORYALLOCATION = 17,
 };
 
+/** Pages are never bigger than this */
+static const VkDeviceSize W_MAX_MEMORY_PAGE_SIZE = 256 * 1024 * 1024;
+/** Heaps smaller than this get pages of 1/8th of the heap size */
+static const VkDeviceSize W_SMALL_HEAP_SIZE = 1024 * 1024 * 1024;
+
 VkResult WVulkanBuffer::Create(class Wasabi* app, VkBufferCreateInfo createInfo, VkMemoryPropertyFlags memoryType) {
 	VkDevice device = app->GetVulkanDevice();
 
@@ -30,15 +39,9 @@ VkResult WVulkanBuffer::Create(class Wasabi* app, VkBufferCreateInfo createInfo,
 		VkMemoryRequirements memReqs = {};
 		vkGetBufferMemoryRequirements(device, buf, &memReqs);
 
-		VkMemoryAllocateInfo memAllocInfo = {};
-		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memAllocInfo.allocationSize = memReqs.size;
-		// Get memory type index for a host visible buffer
-		app->MemoryManager->GetMemoryType(memReqs.memoryTypeBits, memoryType, &memAllocInfo.memoryTypeIndex);
-
-		result = vkAllocateMemory(device, &memAllocInfo, nullptr, &mem);
+		result = app->MemoryManager->AllocateMemory(memReqs, memoryType, true, &mem);
 		if (result == VK_SUCCESS) {
-			result = vkBindBufferMemory(device, buf, mem, 0);
+			result = vkBindBufferMemory(device, buf, mem.memory, mem.offset);
 		}
 	}
 
@@ -50,7 +53,15 @@ VkResult WVulkanBuffer::Create(class Wasabi* app, VkBufferCreateInfo createInfo,
 
 void WVulkanBuffer::Destroy(class Wasabi* app) {
 	app->MemoryManager->ReleaseBuffer(buf, app->GetCurrentBufferingIndex());
-	app->MemoryManager->ReleaseDeviceMemory(mem, app->GetCurrentBufferingIndex());
+	app->MemoryManager->ReleaseMemory(mem, app->GetCurrentBufferingIndex());
+}
+
+VkResult WVulkanBuffer::Map(class Wasabi* app, void** data) {
+	return app->MemoryManager->MapMemory(mem, data);
+}
+
+void WVulkanBuffer::Unmap(class Wasabi* app) {
+	app->MemoryManager->UnmapMemory(mem);
 }
 
 VkResult WVulkanImage::Create(class Wasabi* app, VkImageCreateInfo createInfo, VkMemoryPropertyFlags memoryType, VkImageViewCreateInfo viewCreateInfo) {
@@ -62,15 +73,9 @@ VkResult WVulkanImage::Create(class Wasabi* app, VkImageCreateInfo createInfo, V
 		VkMemoryRequirements memReqs = {};
 		vkGetImageMemoryRequirements(device, img, &memReqs);
 
-		VkMemoryAllocateInfo memAllocInfo = {};
-		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memAllocInfo.allocationSize = memReqs.size;
-		// Get memory type index for a host visible buffer
-		app->MemoryManager->GetMemoryType(memReqs.memoryTypeBits, memoryType, &memAllocInfo.memoryTypeIndex);
-
-		result = vkAllocateMemory(device, &memAllocInfo, nullptr, &mem);
+		result = app->MemoryManager->AllocateMemory(memReqs, memoryType, createInfo.tiling == VK_IMAGE_TILING_LINEAR, &mem);
 		if (result == VK_SUCCESS) {
-			result = vkBindImageMemory(device, img, mem, 0);
+			result = vkBindImageMemory(device, img, mem.memory, mem.offset);
 			if (result == VK_SUCCESS && viewCreateInfo.sType == VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO) {
 				viewCreateInfo.image = img;
 				result = vkCreateImageView(device, &viewCreateInfo, nullptr, &view);
@@ -85,9 +90,17 @@ VkResult WVulkanImage::Create(class Wasabi* app, VkImageCreateInfo createInfo, V
 }
 
 void WVulkanImage::Destroy(class Wasabi* app) {
-	app->MemoryManager->ReleaseImage(img, app->GetCurrentBufferingIndex());
-	app->MemoryManager->ReleaseDeviceMemory(mem, app->GetCurrentBufferingIndex());
 	app->MemoryManager->ReleaseImageView(view, app->GetCurrentBufferingIndex());
+	app->MemoryManager->ReleaseImage(img, app->GetCurrentBufferingIndex());
+	app->MemoryManager->ReleaseMemory(mem, app->GetCurrentBufferingIndex());
+}
+
+VkResult WVulkanImage::Map(class Wasabi* app, void** data) {
+	return app->MemoryManager->MapMemory(mem, data);
+}
+
+void WVulkanImage::Unmap(class Wasabi* app) {
+	app->MemoryManager->UnmapMemory(mem);
 }
 
 WVulkanMemoryManager::WVulkanMemoryManager() {
@@ -100,21 +113,80 @@ WVulkanMemoryManager::WVulkanMemoryManager() {
 
 	m_copyCommandBuffer = VK_NULL_HANDLE;
 	m_cmdPool = VK_NULL_HANDLE;
+
+	m_dedicatedBytes = 0;
+	m_totalDeviceAllocations = 0;
+	m_totalAllocations = 0;
+
+	m_graphicsQueueIndex = 0;
+	m_transferQueue = VK_NULL_HANDLE;
+	m_transferQueueIndex = 0;
+	m_uploadCmdPool = VK_NULL_HANDLE;
+	m_transferGranularity = { 1, 1, 1 };
+	m_currentUpload = nullptr;
+	m_stagingRing = VK_NULL_HANDLE;
+	m_stagingRingData = nullptr;
+	m_stagingRingSize = 0;
+	m_stagingRingHead = 0;
+	m_stagingRingTail = 0;
+	m_stagingRingUsed = 0;
+	m_frameRingSize = 0;
 }
 
 WVulkanMemoryManager::~WVulkanMemoryManager() {
 	vkFreeCommandBuffers(m_device, m_cmdPool, 1, &m_copyCommandBuffer); // this is independent of the multi-buffer system
+
+	// the engine is shutting down, finish in-flight uploads but don't call back into (possibly destroyed) owners
+	for (auto batch : m_uploadsInFlight) {
+		vkWaitForFences(m_device, 1, &batch->fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		batch->callbacks.clear();
+		_RetireUploadBatch(batch);
+	}
+	m_uploadsInFlight.clear();
+	if (m_currentUpload)
+		m_freeUploads.push_back(m_currentUpload);
+	m_currentUpload = nullptr;
+	for (auto batch : m_freeUploads)
+		_DestroyUploadBatch(batch);
+	m_freeUploads.clear();
+	if (m_stagingRing)
+		vkDestroyBuffer(m_device, m_stagingRing, nullptr);
+	m_stagingRing = VK_NULL_HANDLE;
+	if (m_stagingRingMemory.page)
+		_FreeAllocation(m_stagingRingMemory.page, m_stagingRingMemory.node);
+	m_stagingRingMemory = WVulkanMemoryAllocation();
+	if (m_uploadCmdPool && m_uploadCmdPool != m_cmdPool)
+		vkDestroyCommandPool(m_device, m_uploadCmdPool, nullptr);
+	m_uploadCmdPool = VK_NULL_HANDLE;
+
 	ReleaseAllResources();
 
+	for (auto page : m_dedicatedPages)
+		_DestroyPage(page);
+	m_dedicatedPages.clear();
+	m_dedicatedBytes = 0;
+
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+		for (uint32_t j = 0; j < 2; j++) {
+			for (auto page : m_memoryPages[i][j])
+				_DestroyPage(page);
+			m_memoryPages[i][j].clear();
+		}
+	}
+
 	if (m_cmdPool)
 		vkDestroyCommandPool(m_device, m_cmdPool, nullptr);
 	m_cmdPool = VK_NULL_HANDLE;
 }
 
-WError WVulkanMemoryManager::Initialize(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, uint32_t graphicsQueueIndex) {
+WError WVulkanMemoryManager::Initialize(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, uint32_t graphicsQueueIndex,
+										VkQueue transferQueue, uint32_t transferQueueIndex, VkDeviceSize stagingRingSize, VkDeviceSize frameRingSize) {
 	m_physicalDevice = physicalDevice;
 	m_device = device;
 	m_graphicsQueue = queue;
+	m_graphicsQueueIndex = graphicsQueueIndex;
+	m_transferQueue = transferQueue ? transferQueue : queue;
+	m_transferQueueIndex = transferQueue ? transferQueueIndex : graphicsQueueIndex;
 
 	// Store properties (including limits) and features of the phyiscal device
 	vkGetPhysicalDeviceProperties(m_physicalDevice, &m_deviceProperties);
@@ -141,6 +213,48 @@ WError WVulkanMemoryManager::Initialize(VkPhysicalDevice physicalDevice, VkDevic
 	if (err)
 		return WError(W_OUTOFMEMORY);
 
+	//
+	// Setup the upload path: a command pool for the transfer queue's family and the staging ring
+	//
+	if (HasTransferQueue()) {
+		cmdPoolInfo.queueFamilyIndex = m_transferQueueIndex;
+		err = vkCreateCommandPool(m_device, &cmdPoolInfo, nullptr, &m_uploadCmdPool);
+		if (err != VK_SUCCESS)
+			return WError(W_OUTOFMEMORY);
+
+		// transfer-only families may only copy whole mip levels or aligned blocks of images
+		uint32_t numFamilies = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &numFamilies, nullptr);
+		std::vector<VkQueueFamilyProperties> families(numFamilies);
+		vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &numFamilies, families.data());
+		if (m_transferQueueIndex < numFamilies)
+			m_transferGranularity = families[m_transferQueueIndex].minImageTransferGranularity;
+	} else
+		m_uploadCmdPool = m_cmdPool;
+
+	VkBufferCreateInfo ringCreateInfo = {};
+	ringCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	ringCreateInfo.size = stagingRingSize;
+	ringCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	ringCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	err = vkCreateBuffer(m_device, &ringCreateInfo, nullptr, &m_stagingRing);
+	if (err != VK_SUCCESS)
+		return WError(W_OUTOFMEMORY);
+
+	VkMemoryRequirements memReqs = {};
+	vkGetBufferMemoryRequirements(m_device, m_stagingRing, &memReqs);
+	err = AllocateMemory(memReqs, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true, &m_stagingRingMemory);
+	if (err == VK_SUCCESS)
+		err = vkBindBufferMemory(m_device, m_stagingRing, m_stagingRingMemory.memory, m_stagingRingMemory.offset);
+	if (err == VK_SUCCESS)
+		err = MapMemory(m_stagingRingMemory, (void**)&m_stagingRingData);
+	if (err != VK_SUCCESS)
+		return WError(W_OUTOFMEMORY);
+	m_stagingRingSize = stagingRingSize;
+
+	// per-frame rings are created lazily, on their first allocation
+	m_frameRingSize = std::max(frameRingSize, (VkDeviceSize)1);
+
 	return WError(W_SUCCEEDED);
 }
 
@@ -181,6 +295,11 @@ VkResult WVulkanMemoryManager::EndCopyCommandBuffer(bool waitQueue, VkFence sign
 	if (err)
 		return err;
 
+	// the copy may use resources that still have uploads pending
+	err = SubmitUploads();
+	if (err)
+		return err;
+
 	// Submit copies to the queue
 	copySubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 	copySubmitInfo.commandBufferCount = 1;
@@ -200,6 +319,793 @@ VkCommandBuffer WVulkanMemoryManager::GetCopyCommandBuffer() const {
 	return m_copyCommandBuffer;
 }
 
+VkResult WVulkanMemoryManager::AllocateMemory(VkMemoryRequirements memoryRequirements, VkMemoryPropertyFlags properties, bool linear, WVulkanMemoryAllocation* allocation) {
+	uint32_t memoryTypeIndex = VK_MAX_MEMORY_TYPES;
+	GetMemoryType(memoryRequirements.memoryTypeBits, properties, &memoryTypeIndex);
+	if (memoryTypeIndex >= m_deviceMemoryProperties.memoryTypeCount)
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+
+	// Linear and non-linear resources only need to be kept apart if the device has a granularity
+	uint32_t pool = (linear || m_deviceProperties.limits.bufferImageGranularity <= 1) ? 0 : 1;
+	VkDeviceSize pageSize = _GetPageSize(memoryTypeIndex);
+	WVulkanMemoryPage* page = nullptr;
+	uint32_t node = WTLSFAllocator::INVALID_NODE;
+	uint64_t offset = 0;
+	VkResult result = VK_SUCCESS;
+
+	if (memoryRequirements.size <= pageSize / 2) {
+		// Try the existing pages first, most recently created last
+		std::vector<WVulkanMemoryPage*>& pages = m_memoryPages[memoryTypeIndex][pool];
+		for (auto it = pages.rbegin(); it != pages.rend() && node == WTLSFAllocator::INVALID_NODE; it++) {
+			node = (*it)->allocator.Allocate(memoryRequirements.size, memoryRequirements.alignment, &offset);
+			if (node != WTLSFAllocator::INVALID_NODE)
+				page = *it;
+		}
+
+		if (!page) {
+			result = _CreatePage(pageSize, memoryTypeIndex, pool, false, &page);
+			if (result == VK_SUCCESS) {
+				pages.push_back(page);
+				node = page->allocator.Allocate(memoryRequirements.size, memoryRequirements.alignment, &offset);
+			}
+		}
+	}
+
+	if (!page) {
+		// Too big for a page (or no more room for a new page), give it its own memory
+		result = _CreatePage(memoryRequirements.size, memoryTypeIndex, pool, true, &page);
+		if (result != VK_SUCCESS)
+			return result;
+		node = 0;
+		offset = 0;
+		m_dedicatedPages.push_back(page);
+		m_dedicatedBytes += page->size;
+	}
+
+	allocation->memory = page->memory;
+	allocation->offset = offset;
+	allocation->size = memoryRequirements.size;
+	allocation->page = page;
+	allocation->node = node;
+	m_totalAllocations++;
+
+	return VK_SUCCESS;
+}
+
+VkResult WVulkanMemoryManager::MapMemory(const WVulkanMemoryAllocation& allocation, void** data) {
+	WVulkanMemoryPage* page = allocation.page;
+	if (!page)
+		return VK_ERROR_MEMORY_MAP_FAILED;
+
+	if (!page->mappedData) {
+		// Vulkan does not allow mapping the same memory twice, so map the whole page and keep it mapped
+		VkResult result = vkMapMemory(m_device, page->memory, 0, VK_WHOLE_SIZE, 0, &page->mappedData);
+		if (result != VK_SUCCESS) {
+			page->mappedData = nullptr;
+			return result;
+		}
+	}
+
+	if (!(m_deviceMemoryProperties.memoryTypes[page->memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+		VkDeviceSize atomSize = m_deviceProperties.limits.nonCoherentAtomSize;
+		VkMappedMemoryRange range = {};
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.memory = page->memory;
+		range.offset = (allocation.offset / atomSize) * atomSize;
+		range.size = std::min(((allocation.offset + allocation.size + atomSize - 1) / atomSize) * atomSize, page->size) - range.offset;
+		vkInvalidateMappedMemoryRanges(m_device, 1, &range);
+	}
+
+	*data = (char*)page->mappedData + allocation.offset;
+	return VK_SUCCESS;
+}
+
+void WVulkanMemoryManager::UnmapMemory(const WVulkanMemoryAllocation& allocation) {
+	WVulkanMemoryPage* page = allocation.page;
+	if (!page || !page->mappedData)
+		return;
+
+	// Pages stay mapped, only make the writes visible to the device
+	if (!(m_deviceMemoryProperties.memoryTypes[page->memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+		VkDeviceSize atomSize = m_deviceProperties.limits.nonCoherentAtomSize;
+		VkMappedMemoryRange range = {};
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.memory = page->memory;
+		range.offset = (allocation.offset / atomSize) * atomSize;
+		range.size = std::min(((allocation.offset + allocation.size + atomSize - 1) / atomSize) * atomSize, page->size) - range.offset;
+		vkFlushMappedMemoryRanges(m_device, 1, &range);
+	}
+}
+
+WVulkanMemoryStats WVulkanMemoryManager::GetMemoryStats() const {
+	WVulkanMemoryStats stats = {};
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+		for (uint32_t j = 0; j < 2; j++) {
+			for (auto page : m_memoryPages[i][j]) {
+				stats.numDeviceMemoryObjects++;
+				stats.numAllocations += page->allocator.GetNumAllocations();
+				stats.numFreeRegions += page->allocator.GetNumFreeRegions();
+				stats.reservedBytes += page->size;
+				stats.usedBytes += page->allocator.GetUsedSize();
+			}
+		}
+	}
+	stats.numDeviceMemoryObjects += (uint32_t)m_dedicatedPages.size();
+	stats.numDedicatedAllocations = (uint32_t)m_dedicatedPages.size();
+	stats.numAllocations += (uint32_t)m_dedicatedPages.size();
+	stats.reservedBytes += m_dedicatedBytes;
+	stats.usedBytes += m_dedicatedBytes;
+	stats.totalDeviceAllocations = m_totalDeviceAllocations;
+	stats.totalAllocations = m_totalAllocations;
+	return stats;
+}
+
+VkResult WVulkanMemoryManager::_CreatePage(VkDeviceSize size, uint32_t memoryTypeIndex, uint32_t pool, bool dedicated, WVulkanMemoryPage** page) {
+	VkMemoryAllocateInfo memAllocInfo = {};
+	memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memAllocInfo.allocationSize = size;
+	memAllocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	VkDeviceMemory memory;
+	VkResult result = vkAllocateMemory(m_device, &memAllocInfo, nullptr, &memory);
+	if (result != VK_SUCCESS)
+		return result;
+	m_totalDeviceAllocations++;
+
+	WVulkanMemoryPage* newPage = new WVulkanMemoryPage();
+	newPage->memory = memory;
+	newPage->size = size;
+	newPage->memoryTypeIndex = memoryTypeIndex;
+	newPage->pool = pool;
+	newPage->dedicated = dedicated;
+	newPage->mappedData = nullptr;
+	if (!dedicated)
+		newPage->allocator.Initialize(size);
+
+	*page = newPage;
+	return VK_SUCCESS;
+}
+
+void WVulkanMemoryManager::_DestroyPage(WVulkanMemoryPage* page) {
+	if (page->mappedData)
+		vkUnmapMemory(m_device, page->memory);
+	vkFreeMemory(m_device, page->memory, nullptr);
+	delete page;
+}
+
+void WVulkanMemoryManager::_FreeAllocation(WVulkanMemoryPage* page, uint32_t node) {
+	if (page->dedicated) {
+		m_dedicatedPages.erase(std::find(m_dedicatedPages.begin(), m_dedicatedPages.end(), page));
+		m_dedicatedBytes -= page->size;
+		_DestroyPage(page);
+		return;
+	}
+
+	page->allocator.Free(node);
+	if (page->allocator.IsEmpty()) {
+		// Keep one empty page around per pool to avoid thrashing vkAllocateMemory
+		std::vector<WVulkanMemoryPage*>& pages = m_memoryPages[page->memoryTypeIndex][page->pool];
+		if (pages.size() > 1) {
+			pages.erase(std::find(pages.begin(), pages.end(), page));
+			_DestroyPage(page);
+		}
+	}
+}
+
+VkDeviceSize WVulkanMemoryManager::_GetPageSize(uint32_t memoryTypeIndex) const {
+	uint32_t heapIndex = m_deviceMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	VkDeviceSize heapSize = m_deviceMemoryProperties.memoryHeaps[heapIndex].size;
+	if (heapSize <= W_SMALL_HEAP_SIZE)
+		return heapSize / 8;
+	return W_MAX_MEMORY_PAGE_SIZE;
+}
+
+VkResult WVulkanMemoryManager::UploadToBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size, std::function<void()> onComplete) {
+	if (!buffer || !data || size == 0)
+		return VK_ERROR_INITIALIZATION_FAILED;
+
+	VkBuffer stagingBuffer;
+	VkDeviceSize stagingOffset;
+	void* stagingData;
+	VkResult result = _GetStagingMemory(size, 16, &stagingBuffer, &stagingOffset, &stagingData);
+	if (result != VK_SUCCESS)
+		return result;
+	memcpy(stagingData, data, size);
+
+	VkBufferCopy copyRegion = {};
+	copyRegion.srcOffset = stagingOffset;
+	copyRegion.dstOffset = offset;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(m_currentUpload->cmdBuf, stagingBuffer, buffer, 1, &copyRegion);
+
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.buffer = buffer;
+	barrier.offset = offset;
+	barrier.size = size;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	if (HasTransferQueue()) {
+		// release ownership to the graphics queue family, which then acquires it
+		barrier.dstAccessMask = 0;
+		barrier.srcQueueFamilyIndex = m_transferQueueIndex;
+		barrier.dstQueueFamilyIndex = m_graphicsQueueIndex;
+		m_currentUpload->bufferReleases.push_back(barrier);
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		m_currentUpload->bufferAcquires.push_back(barrier);
+	} else {
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		m_currentUpload->bufferReleases.push_back(barrier);
+	}
+
+	if (onComplete)
+		m_currentUpload->callbacks.push_back(onComplete);
+	m_currentUpload->numUploads++;
+
+	return VK_SUCCESS;
+}
+
+VkResult WVulkanMemoryManager::UploadToImage(VkImage image, VkImageSubresourceRange subresourceRange, VkImageLayout oldLayout, VkImageLayout newLayout,
+											  VkBufferImageCopy region, VkExtent3D imageExtent, const void* data, VkDeviceSize size, VkDeviceSize texelSize,
+											  std::function<void()> onComplete) {
+	if (!image)
+		return VK_ERROR_INITIALIZATION_FAILED;
+
+	VkResult result = _BeginUploadBatch();
+	if (result != VK_SUCCESS)
+		return result;
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.image = image;
+	barrier.subresourceRange = subresourceRange;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+	if (data && size > 0) {
+		// bufferOffset must be a multiple of both the texel size and 4
+		VkDeviceSize alignment = std::lcm(std::max(texelSize, (VkDeviceSize)1), (VkDeviceSize)4);
+		alignment = std::lcm(alignment, std::max(m_deviceProperties.limits.optimalBufferCopyOffsetAlignment, (VkDeviceSize)1));
+
+		VkBuffer stagingBuffer;
+		void* stagingData;
+		result = _GetStagingMemory(size, alignment, &stagingBuffer, &region.bufferOffset, &stagingData);
+		if (result != VK_SUCCESS)
+			return result;
+		memcpy(stagingData, data, size);
+
+		if (HasTransferQueue() && !_IsTransferGranularityAligned(region, imageExtent)) {
+			// The transfer queue can't copy this region, copy it on the graphics queue after the batch's ownership
+			// acquires. The image is only used by the graphics queue, so it needs no ownership transfer
+			GRAPHICS_IMAGE_UPLOAD upload = {};
+			upload.image = image;
+			upload.subresourceRange = subresourceRange;
+			upload.oldLayout = oldLayout == VK_IMAGE_LAYOUT_PREINITIALIZED ? oldLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+			upload.newLayout = newLayout;
+			upload.stagingBuffer = stagingBuffer;
+			upload.region = region;
+			m_currentUpload->graphicsImageUploads.push_back(upload);
+
+			if (onComplete)
+				m_currentUpload->callbacks.push_back(onComplete);
+			m_currentUpload->numUploads++;
+			return VK_SUCCESS;
+		}
+
+		// Contents are discarded, so the old layout only matters if it is PREINITIALIZED
+		barrier.oldLayout = oldLayout == VK_IMAGE_LAYOUT_PREINITIALIZED ? oldLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(m_currentUpload->cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+							 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		vkCmdCopyBufferToImage(m_currentUpload->cmdBuf, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	} else {
+		barrier.oldLayout = oldLayout == VK_IMAGE_LAYOUT_PREINITIALIZED ? oldLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.srcAccessMask = 0;
+	}
+	barrier.newLayout = newLayout;
+
+	if (HasTransferQueue()) {
+		// the layout transition happens once, as part of the release/acquire pair
+		barrier.dstAccessMask = 0;
+		barrier.srcQueueFamilyIndex = m_transferQueueIndex;
+		barrier.dstQueueFamilyIndex = m_graphicsQueueIndex;
+		m_currentUpload->imageReleases.push_back(barrier);
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		m_currentUpload->imageAcquires.push_back(barrier);
+	} else {
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		m_currentUpload->imageReleases.push_back(barrier);
+	}
+
+	if (onComplete)
+		m_currentUpload->callbacks.push_back(onComplete);
+	m_currentUpload->numUploads++;
+
+	return VK_SUCCESS;
+}
+
+VkResult WVulkanMemoryManager::SubmitUploads() {
+	if (!m_currentUpload)
+		return VK_SUCCESS;
+
+	UPLOAD_BATCH* batch = m_currentUpload;
+	m_currentUpload = nullptr;
+
+	if (batch->numUploads > 0) {
+		// all releases (or plain barriers) of the batch are recorded together
+		if (batch->bufferReleases.size() > 0 || batch->imageReleases.size() > 0) {
+			vkCmdPipelineBarrier(batch->cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT,
+								 HasTransferQueue() ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+								 0, nullptr,
+								 (uint32_t)batch->bufferReleases.size(), batch->bufferReleases.data(),
+								 (uint32_t)batch->imageReleases.size(), batch->imageReleases.data());
+		}
+	}
+
+	VkResult result = vkEndCommandBuffer(batch->cmdBuf);
+	if (result != VK_SUCCESS || batch->numUploads == 0) {
+		m_freeUploads.push_back(batch);
+		return result;
+	}
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch->cmdBuf;
+
+	if (HasTransferQueue()) {
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &batch->semaphore;
+		result = vkQueueSubmit(m_transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
+
+		if (result == VK_SUCCESS) {
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			result = vkResetCommandBuffer(batch->acquireCmdBuf, 0);
+			if (result == VK_SUCCESS)
+				result = vkBeginCommandBuffer(batch->acquireCmdBuf, &beginInfo);
+			if (result == VK_SUCCESS) {
+				if (batch->bufferAcquires.size() > 0 || batch->imageAcquires.size() > 0) {
+					vkCmdPipelineBarrier(batch->acquireCmdBuf, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+										 0, nullptr,
+										 (uint32_t)batch->bufferAcquires.size(), batch->bufferAcquires.data(),
+										 (uint32_t)batch->imageAcquires.size(), batch->imageAcquires.data());
+				}
+				for (auto& upload : batch->graphicsImageUploads) {
+					VkImageMemoryBarrier barrier = {};
+					barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+					barrier.image = upload.image;
+					barrier.subresourceRange = upload.subresourceRange;
+					barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.oldLayout = upload.oldLayout;
+					barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+					barrier.srcAccessMask = 0;
+					barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+					vkCmdPipelineBarrier(batch->acquireCmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+										 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+					vkCmdCopyBufferToImage(batch->acquireCmdBuf, upload.stagingBuffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &upload.region);
+
+					barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+					barrier.newLayout = upload.newLayout;
+					barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+					barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+					vkCmdPipelineBarrier(batch->acquireCmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+										 0, 0, nullptr, 0, nullptr, 1, &barrier);
+				}
+				result = vkEndCommandBuffer(batch->acquireCmdBuf);
+			}
+		}
+
+		if (result == VK_SUCCESS) {
+			VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			VkSubmitInfo acquireInfo = {};
+			acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			acquireInfo.waitSemaphoreCount = 1;
+			acquireInfo.pWaitSemaphores = &batch->semaphore;
+			acquireInfo.pWaitDstStageMask = &waitStage;
+			acquireInfo.commandBufferCount = 1;
+			acquireInfo.pCommandBuffers = &batch->acquireCmdBuf;
+			result = vkQueueSubmit(m_graphicsQueue, 1, &acquireInfo, batch->fence);
+		}
+	} else
+		result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, batch->fence);
+
+	if (result != VK_SUCCESS) {
+		// the batch is lost, make sure nothing references it anymore before recycling it
+		vkQueueWaitIdle(m_transferQueue);
+		vkQueueWaitIdle(m_graphicsQueue);
+		UpdateUploads();
+		batch->callbacks.clear();
+		_RetireUploadBatch(batch);
+		return result;
+	}
+
+	m_uploadsInFlight.push_back(batch);
+	return VK_SUCCESS;
+}
+
+void WVulkanMemoryManager::UpdateUploads() {
+	// batches complete in submission order
+	uint32_t numRetired = 0;
+	while (numRetired < m_uploadsInFlight.size() && vkGetFenceStatus(m_device, m_uploadsInFlight[numRetired]->fence) == VK_SUCCESS)
+		_RetireUploadBatch(m_uploadsInFlight[numRetired++]);
+	m_uploadsInFlight.erase(m_uploadsInFlight.begin(), m_uploadsInFlight.begin() + numRetired);
+}
+
+VkResult WVulkanMemoryManager::WaitForUploads() {
+	VkResult result = SubmitUploads();
+	if (result != VK_SUCCESS)
+		return result;
+
+	if (m_uploadsInFlight.size() > 0) {
+		result = vkWaitForFences(m_device, 1, &m_uploadsInFlight.back()->fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		UpdateUploads();
+	}
+
+	return result;
+}
+
+bool WVulkanMemoryManager::HasTransferQueue() const {
+	return m_transferQueueIndex != m_graphicsQueueIndex;
+}
+
+bool WVulkanMemoryManager::_IsTransferGranularityAligned(const VkBufferImageCopy& region, VkExtent3D imageExtent) const {
+	uint32_t mipLevel = region.imageSubresource.mipLevel;
+	VkExtent3D levelExtent = {
+		std::max(imageExtent.width >> mipLevel, 1u),
+		std::max(imageExtent.height >> mipLevel, 1u),
+		std::max(imageExtent.depth >> mipLevel, 1u),
+	};
+	const VkOffset3D& offset = region.imageOffset;
+	const VkExtent3D& extent = region.imageExtent;
+
+	if (m_transferGranularity.width == 0 || m_transferGranularity.height == 0 || m_transferGranularity.depth == 0) {
+		// (0, 0, 0) only allows copying whole mip levels
+		return offset.x == 0 && offset.y == 0 && offset.z == 0 &&
+			extent.width == levelExtent.width && extent.height == levelExtent.height && extent.depth == levelExtent.depth;
+	}
+
+	// otherwise the offset must be a multiple of the granularity, and so must the extent unless it reaches the
+	// edge of the mip level
+	auto isAligned = [](int32_t offset, uint32_t extent, uint32_t levelSize, uint32_t granularity) {
+		return (uint32_t)offset % granularity == 0 && (extent % granularity == 0 || (uint32_t)offset + extent == levelSize);
+	};
+	return isAligned(offset.x, extent.width, levelExtent.width, m_transferGranularity.width) &&
+		isAligned(offset.y, extent.height, levelExtent.height, m_transferGranularity.height) &&
+		isAligned(offset.z, extent.depth, levelExtent.depth, m_transferGranularity.depth);
+}
+
+VkResult WVulkanMemoryManager::_BeginUploadBatch() {
+	if (m_currentUpload)
+		return VK_SUCCESS;
+
+	UPLOAD_BATCH* batch = nullptr;
+	VkResult result = VK_SUCCESS;
+	if (m_freeUploads.size() > 0) {
+		batch = m_freeUploads.back();
+		m_freeUploads.pop_back();
+	} else {
+		batch = new UPLOAD_BATCH();
+		batch->cmdBuf = VK_NULL_HANDLE;
+		batch->acquireCmdBuf = VK_NULL_HANDLE;
+		batch->semaphore = VK_NULL_HANDLE;
+		batch->fence = VK_NULL_HANDLE;
+
+		VkCommandBufferAllocateInfo cmdBufInfo = {};
+		cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cmdBufInfo.commandPool = m_uploadCmdPool;
+		cmdBufInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cmdBufInfo.commandBufferCount = 1;
+		result = vkAllocateCommandBuffers(m_device, &cmdBufInfo, &batch->cmdBuf);
+
+		if (result == VK_SUCCESS && HasTransferQueue()) {
+			cmdBufInfo.commandPool = m_cmdPool;
+			result = vkAllocateCommandBuffers(m_device, &cmdBufInfo, &batch->acquireCmdBuf);
+			if (result == VK_SUCCESS) {
+				VkSemaphoreCreateInfo semaphoreInfo = {};
+				semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+				result = vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &batch->semaphore);
+			}
+		}
+
+		if (result == VK_SUCCESS) {
+			VkFenceCreateInfo fenceInfo = {};
+			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			result = vkCreateFence(m_device, &fenceInfo, nullptr, &batch->fence);
+		}
+
+		if (result != VK_SUCCESS) {
+			_DestroyUploadBatch(batch);
+			return result;
+		}
+	}
+
+	batch->numUploads = 0;
+	batch->ringEnd = m_stagingRingHead;
+	batch->ringConsumed = 0;
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	result = vkResetCommandBuffer(batch->cmdBuf, 0);
+	if (result == VK_SUCCESS)
+		result = vkBeginCommandBuffer(batch->cmdBuf, &beginInfo);
+	if (result != VK_SUCCESS) {
+		m_freeUploads.push_back(batch);
+		return result;
+	}
+
+	m_currentUpload = batch;
+	return VK_SUCCESS;
+}
+
+void WVulkanMemoryManager::_RetireUploadBatch(UPLOAD_BATCH* batch) {
+	if (batch->ringConsumed > 0) {
+		m_stagingRingTail = batch->ringEnd;
+		m_stagingRingUsed -= batch->ringConsumed;
+		batch->ringConsumed = 0;
+	}
+
+	for (auto it = batch->tempStagingBuffers.begin(); it != batch->tempStagingBuffers.end(); it++) {
+		vkDestroyBuffer(m_device, it->first, nullptr);
+		_FreeAllocation(it->second.page, it->second.node);
+	}
+	batch->tempStagingBuffers.clear();
+
+	std::vector<std::function<void()>> callbacks;
+	std::swap(callbacks, batch->callbacks);
+	batch->bufferReleases.clear();
+	batch->imageReleases.clear();
+	batch->bufferAcquires.clear();
+	batch->imageAcquires.clear();
+	batch->graphicsImageUploads.clear();
+	vkResetFences(m_device, 1, &batch->fence);
+	m_freeUploads.push_back(batch);
+
+	// callbacks may queue more uploads, so call them once the batch has been recycled
+	for (auto it = callbacks.begin(); it != callbacks.end(); it++)
+		(*it)();
+}
+
+void WVulkanMemoryManager::_DestroyUploadBatch(UPLOAD_BATCH* batch) {
+	if (batch->cmdBuf)
+		vkFreeCommandBuffers(m_device, m_uploadCmdPool, 1, &batch->cmdBuf);
+	if (batch->acquireCmdBuf)
+		vkFreeCommandBuffers(m_device, m_cmdPool, 1, &batch->acquireCmdBuf);
+	if (batch->semaphore)
+		vkDestroySemaphore(m_device, batch->semaphore, nullptr);
+	if (batch->fence)
+		vkDestroyFence(m_device, batch->fence, nullptr);
+	delete batch;
+}
+
+VkResult WVulkanMemoryManager::_GetStagingMemory(VkDeviceSize size, VkDeviceSize alignment, VkBuffer* buffer, VkDeviceSize* offset, void** data) {
+	VkResult result = _BeginUploadBatch();
+	if (result != VK_SUCCESS)
+		return result;
+
+	if (size > m_stagingRingSize) {
+		// Too big for the ring, use a temporary staging buffer that lives as long as the batch
+		VkBufferCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		createInfo.size = size;
+		createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		WVulkanMemoryAllocation memory;
+		VkMemoryRequirements memReqs = {};
+		result = vkCreateBuffer(m_device, &createInfo, nullptr, buffer);
+		if (result != VK_SUCCESS)
+			return result;
+		vkGetBufferMemoryRequirements(m_device, *buffer, &memReqs);
+		result = AllocateMemory(memReqs, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true, &memory);
+		if (result == VK_SUCCESS)
+			result = vkBindBufferMemory(m_device, *buffer, memory.memory, memory.offset);
+		if (result == VK_SUCCESS)
+			result = MapMemory(memory, data);
+		if (result != VK_SUCCESS) {
+			vkDestroyBuffer(m_device, *buffer, nullptr);
+			if (memory.page)
+				_FreeAllocation(memory.page, memory.node);
+			return result;
+		}
+
+		m_currentUpload->tempStagingBuffers.push_back(std::make_pair(*buffer, memory));
+		*offset = 0;
+		return VK_SUCCESS;
+	}
+
+	while (!_AllocateFromStagingRing(size, alignment, offset)) {
+		// the ring is full: submit what we have so far, or wait for the oldest batch to free its space
+		if (m_currentUpload->numUploads > 0)
+			result = SubmitUploads();
+		else if (m_uploadsInFlight.size() > 0) {
+			result = vkWaitForFences(m_device, 1, &m_uploadsInFlight.front()->fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+			UpdateUploads();
+		} else
+			result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+		if (result == VK_SUCCESS)
+			result = _BeginUploadBatch();
+		if (result != VK_SUCCESS)
+			return result;
+	}
+
+	*buffer = m_stagingRing;
+	*data = m_stagingRingData + *offset;
+	return VK_SUCCESS;
+}
+
+bool WVulkanMemoryManager::_AllocateFromStagingRing(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset) {
+	if (m_stagingRingUsed == 0) {
+		// nothing in use, start over from the beginning
+		m_stagingRingHead = m_stagingRingTail = 0;
+		m_currentUpload->ringEnd = 0;
+	} else if (m_stagingRingHead == m_stagingRingTail)
+		return false; // full
+
+	VkDeviceSize alignedHead = ((m_stagingRingHead + alignment - 1) / alignment) * alignment;
+	VkDeviceSize consumed = 0;
+	if (m_stagingRingHead >= m_stagingRingTail) {
+		// free space is [head, size) and [0, tail)
+		if (alignedHead + size <= m_stagingRingSize) {
+			*offset = alignedHead;
+			consumed = alignedHead + size - m_stagingRingHead;
+		} else if (size <= m_stagingRingTail) {
+			// wrap around, wasting the end of the ring
+			*offset = 0;
+			consumed = m_stagingRingSize - m_stagingRingHead + size;
+		} else
+			return false;
+	} else {
+		// free space is [head, tail)
+		if (alignedHead + size <= m_stagingRingTail) {
+			*offset = alignedHead;
+			consumed = alignedHead + size - m_stagingRingHead;
+		} else
+			return false;
+	}
+
+	m_stagingRingHead = *offset + size;
+	m_stagingRingUsed += consumed;
+	m_currentUpload->ringEnd = m_stagingRingHead;
+	m_currentUpload->ringConsumed += consumed;
+	return true;
+}
+
+VkResult WVulkanMemoryManager::AllocateFrameMemory(VkDeviceSize size, VkDeviceSize alignment, uint32_t bufferIndex, WFrameAllocation* allocation) {
+	if (size == 0 || bufferIndex >= m_frameRings.size())
+		return VK_ERROR_INITIALIZATION_FAILED;
+	if (alignment < 1)
+		alignment = 1;
+
+	FRAME_RING& ring = m_frameRings[bufferIndex];
+	VkDeviceSize alignedHead = 0;
+	if (ring.chunks.size() > 0)
+		alignedHead = ((ring.head + alignment - 1) / alignment) * alignment;
+	if (ring.chunks.size() == 0 || alignedHead + size > ring.chunks.back().size) {
+		// spill into a new chunk, at least as big as everything allocated so far
+		FRAME_RING_CHUNK chunk;
+		VkResult result = _CreateFrameRingChunk(std::max(std::max(m_frameRingSize, ring.used), size), &chunk);
+		if (result != VK_SUCCESS)
+			return result;
+		ring.chunks.push_back(chunk);
+		ring.head = alignedHead = 0;
+	}
+
+	FRAME_RING_CHUNK& chunk = ring.chunks.back();
+	allocation->buffer = chunk.buffer;
+	allocation->offset = alignedHead;
+	allocation->data = chunk.data + alignedHead;
+	ring.used += alignedHead + size - ring.head;
+	ring.head = alignedHead + size;
+	return VK_SUCCESS;
+}
+
+VkResult WVulkanMemoryManager::ReserveSecondaryCommandPools(uint32_t numThreads) {
+	VkCommandPoolCreateInfo cmdPoolInfo = {};
+	cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	cmdPoolInfo.queueFamilyIndex = m_graphicsQueueIndex;
+	cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	for (auto& pools : m_secondaryCommandPools) {
+		while (pools.size() < numThreads) {
+			SECONDARY_COMMAND_POOL pool;
+			pool.numUsed = 0;
+			VkResult result = vkCreateCommandPool(m_device, &cmdPoolInfo, nullptr, &pool.pool);
+			if (result != VK_SUCCESS)
+				return result;
+			pools.push_back(pool);
+		}
+	}
+	return VK_SUCCESS;
+}
+
+VkResult WVulkanMemoryManager::AcquireSecondaryCommandBuffer(uint32_t bufferIndex, uint32_t threadIndex, VkCommandBuffer* cmdBuf) {
+	if (bufferIndex >= m_secondaryCommandPools.size() || threadIndex >= m_secondaryCommandPools[bufferIndex].size())
+		return VK_ERROR_INITIALIZATION_FAILED;
+
+	SECONDARY_COMMAND_POOL& pool = m_secondaryCommandPools[bufferIndex][threadIndex];
+	if (pool.numUsed == pool.buffers.size()) {
+		VkCommandBufferAllocateInfo cmdBufInfo = {};
+		cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cmdBufInfo.commandPool = pool.pool;
+		cmdBufInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		cmdBufInfo.commandBufferCount = 1;
+		VkCommandBuffer newBuffer;
+		VkResult result = vkAllocateCommandBuffers(m_device, &cmdBufInfo, &newBuffer);
+		if (result != VK_SUCCESS)
+			return result;
+		pool.buffers.push_back(newBuffer);
+	}
+
+	*cmdBuf = pool.buffers[pool.numUsed++];
+	return VK_SUCCESS;
+}
+
+VkResult WVulkanMemoryManager::_CreateFrameRingChunk(VkDeviceSize size, FRAME_RING_CHUNK* chunk) {
+	chunk->buffer = VK_NULL_HANDLE;
+	chunk->data = nullptr;
+	chunk->size = size;
+
+	VkBufferCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	createInfo.size = size;
+	createInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+					   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	VkResult result = vkCreateBuffer(m_device, &createInfo, nullptr, &chunk->buffer);
+	if (result == VK_SUCCESS) {
+		VkMemoryRequirements memReqs = {};
+		vkGetBufferMemoryRequirements(m_device, chunk->buffer, &memReqs);
+		result = AllocateMemory(memReqs, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true, &chunk->memory);
+		if (result == VK_SUCCESS)
+			result = vkBindBufferMemory(m_device, chunk->buffer, chunk->memory.memory, chunk->memory.offset);
+		if (result == VK_SUCCESS)
+			result = MapMemory(chunk->memory, (void**)&chunk->data);
+	}
+
+	if (result != VK_SUCCESS)
+		_DestroyFrameRingChunk(*chunk);
+
+	return result;
+}
+
+void WVulkanMemoryManager::_DestroyFrameRingChunk(FRAME_RING_CHUNK& chunk) {
+	if (chunk.buffer)
+		vkDestroyBuffer(m_device, chunk.buffer, nullptr);
+	if (chunk.memory.page)
+		_FreeAllocation(chunk.memory.page, chunk.memory.node);
+	chunk.buffer = VK_NULL_HANDLE;
+	chunk.memory = WVulkanMemoryAllocation();
+	chunk.data = nullptr;
+}
+
+void WVulkanMemoryManager::_ResetFrameRing(FRAME_RING& ring) {
+	if (ring.chunks.size() > 1) {
+		// the ring spilled last time, replace its chunks with a single one big enough for the whole frame
+		for (auto& chunk : ring.chunks)
+			_DestroyFrameRingChunk(chunk);
+		ring.chunks.clear();
+		FRAME_RING_CHUNK chunk;
+		if (_CreateFrameRingChunk(std::max(m_frameRingSize, ring.used), &chunk) == VK_SUCCESS)
+			ring.chunks.push_back(chunk);
+	}
+	ring.head = 0;
+	ring.used = 0;
+}
+
 void WVulkanMemoryManager::ReleaseAllResources(uint32_t setBufferingCount) {
 	for (auto it = m_resourcesToBeFreed.begin(); it != m_resourcesToBeFreed.end(); it++) {
 		for (auto it2 = it->begin(); it2 != it->end(); it2++) {
@@ -207,8 +1113,23 @@ void WVulkanMemoryManager::ReleaseAllResources(uint32_t setBufferingCount) {
 		}
 		it->clear();
 	}
-	if (setBufferingCount != std::numeric_limits<uint32_t>::max())
+	for (auto& ring : m_frameRings) {
+		for (auto& chunk : ring.chunks)
+			_DestroyFrameRingChunk(chunk);
+		ring.chunks.clear();
+		ring.head = ring.used = 0;
+	}
+	for (auto& pools : m_secondaryCommandPools) {
+		// destroying a pool frees its command buffers
+		for (auto& pool : pools)
+			vkDestroyCommandPool(m_device, pool.pool, nullptr);
+		pools.clear();
+	}
+	if (setBufferingCount != std::numeric_limits<uint32_t>::max()) {
 		m_resourcesToBeFreed.resize(setBufferingCount * 2);
+		m_frameRings.resize(setBufferingCount);
+		m_secondaryCommandPools.resize(setBufferingCount);
+	}
 }
 
 void WVulkanMemoryManager::ReleaseFrameResources(uint32_t bufferIndex) {
@@ -216,6 +1137,17 @@ void WVulkanMemoryManager::ReleaseFrameResources(uint32_t bufferIndex) {
 		_ReleaseResource(it->type, it->resource, it->aux);
 	m_resourcesToBeFreed[bufferIndex].clear();
 	std::swap(m_resourcesToBeFreed[bufferIndex], m_resourcesToBeFreed[m_resourcesToBeFreed.size() / 2 + bufferIndex]);
+
+	// the GPU is done with the last frame that used this index, so its transient memory can be reused
+	if (bufferIndex < m_frameRings.size())
+		_ResetFrameRing(m_frameRings[bufferIndex]);
+	if (bufferIndex < m_secondaryCommandPools.size()) {
+		for (auto& pool : m_secondaryCommandPools[bufferIndex]) {
+			if (pool.numUsed > 0)
+				vkResetCommandPool(m_device, pool.pool, 0);
+			pool.numUsed = 0;
+		}
+	}
 }
 
 void WVulkanMemoryManager::_ReleaseResource(int type, void* resource, void* aux) {
@@ -274,6 +1206,9 @@ void WVulkanMemoryManager::_ReleaseResource(int type, void* resource, void* aux)
 	case VULKAN_RESOURCE_FENCE:
 		vkDestroyFence(m_device, (VkFence)resource, nullptr);
 		break;
+	case VULKAN_RESOURCE_MEMORYALLOCATION:
+		_FreeAllocation((WVulkanMemoryPage*)resource, (uint32_t)(uintptr_t)aux);
+		break;
 	}
 }
 
@@ -355,6 +1290,12 @@ void WVulkanMemoryManager::ReleaseDeviceMemory(VkDeviceMemory& obj, uint32_t buf
 	obj = VK_NULL_HANDLE;
 }
 
+void WVulkanMemoryManager::ReleaseMemory(WVulkanMemoryAllocation& obj, uint32_t bufferIndex) {
+	if (obj.page)
+		m_resourcesToBeFreed[m_resourcesToBeFreed.size() / 2 + bufferIndex].push_back({ VULKAN_RESOURCE_MEMORYALLOCATION, (void*)obj.page, (void*)(uintptr_t)obj.node });
+	obj = WVulkanMemoryAllocation();
+}
+
 void WVulkanMemoryManager::ReleaseSampler(VkSampler& obj, uint32_t bufferIndex) {
 	if (obj)
 		m_resourcesToBeFreed[m_resourcesToBeFreed.size() / 2 + bufferIndex].push_back({ VULKAN_RESOURCE_SAMPLER, (void*)obj, nullptr });
@@ -19,6 +19,11 @@ std::string WObjectManager::GetTypeName() const {
 WObjectManager::WObjectManager(class Wasabi* const app) : WManager<WObject>(app) {
 }
 
+WObjectManager::~WObjectManager() {
+	// release the objects while the spatial index still exists, they remove themselves from it
+	_ReleaseEntities();
+}
+
 WError WObjectManager::Load() {
 	return WError(W_SUCCEEDED);
 }
@@ -32,7 +37,7 @@ WObject* WObjectManager::CreateObject(WEffect* fx, uint32_t bindingSet, uint32_t
 	return object;
 }
 
-WObject* WObjectManager::PickObject(double x, double y, bool bAnyHit, uint32_t iObjStartID, uint32_t iObjEndID, WVector3* _pt, WVector2* uv, uint32_t* faceIndex) const {
+WObject* WObjectManager::PickObject(double x, double y, bool bAnyHit, uint32_t iObjStartID, uint32_t iObjEndID, WVector3* _pt, WVector2* uv, uint32_t* faceIndex) {
 	struct pickStruct {
 		WObject* obj;
 		WVector3 pos;
@@ -51,7 +56,7 @@ WObject* WObjectManager::PickObject(double x, double y, bool bAnyHit, uint32_t i
 
 	WMatrix P = cam->GetProjectionMatrix();
 	WMatrix V = cam->GetViewMatrix();
-	WMatrix inverseV = WMatrixInverse(V);
+	WMatrix inverseV = WMatrixInverseAffine(V);
 
 	// Compute picking ray in view space.
 	float vx = (+2.0f*(float)x / Width  - 1.0f) / P(0, 0);
@@ -63,44 +68,47 @@ WObject* WObjectManager::PickObject(double x, double y, bool bAnyHit, uint32_t i
 	pos = WVec3TransformCoord(pos, inverseV);
 	dir = WVec3TransformNormal(dir, inverseV);
 
-	for (uint32_t j = 0; j < W_HASHTABLESIZE; j++) {
-		for (uint32_t i = (uint32_t)m_entities[j].size() - 1; i >= 0 && i != UINT_MAX; i--) {
-			if (((m_entities[j][i]->GetID() >= iObjStartID && m_entities[j][i]->GetID() <= iObjEndID) ||
-				(!iObjStartID && !iObjEndID)) && m_entities[j][i]->Valid()) {
-				WObject* object = (WObject*)m_entities[j][i];
-				if (object->Hidden())
-					continue;
-
-				WGeometry* temp = object->GetGeometry();
-				if (temp) {
-					//these calculations are per-subset
-					WMatrix inverseW = WMatrixInverse(object->GetWorldMatrix());
-
-					WVector3 subsetPos = WVec3TransformCoord(pos, inverseW);
-					WVector3 subsetDir = WVec3TransformNormal(dir, inverseW);
-
-					WVector3 boxPos = (temp->GetMaxPoint() + temp->GetMinPoint()) / 2.0f;
-					WVector3 boxSize = (temp->GetMaxPoint() - temp->GetMinPoint()) / 2.0f;
-
-					pickStruct p;
-					p.obj = object;
-					if (WUtil::RayIntersectBox(boxSize, subsetPos, subsetDir, boxPos)) {
-						WVector3 pt;
-						bool b = temp->Intersect(subsetPos, subsetDir, &pt, &p.uv, &p.face);
-						WMatrix m = object->GetWorldMatrix();
-						p.pos.x = (pt.x * m(0, 0)) + (pt.y * m(1, 0)) + (pt.z * m(2, 0)) + (1 * m(3, 0));
-						p.pos.y = (pt.x * m(0, 1)) + (pt.y * m(1, 1)) + (pt.z * m(2, 1)) + (1 * m(3, 1));
-						p.pos.z = (pt.x * m(0, 2)) + (pt.y * m(1, 2)) + (pt.z * m(2, 2)) + (1 * m(3, 2));
-
-						if (b) {
-							if (bAnyHit) {
-								if (faceIndex) *faceIndex = p.face;
-								if (_pt) *_pt = pt;
-								if (uv) *uv = p.uv;
-								return object;
-							}
-							pickedObjects.push_back(p);
+	// only the objects whose world bounding box is hit by the ray need to be tested
+	vector<WObject*> candidates;
+	QueryRay(pos, dir, candidates);
+
+	for (uint32_t i = 0; i < candidates.size(); i++) {
+		if (((candidates[i]->GetID() >= iObjStartID && candidates[i]->GetID() <= iObjEndID) ||
+			(!iObjStartID && !iObjEndID))) {
+			WObject* object = candidates[i];
+			if (object->Hidden())
+				continue;
+
+			WGeometry* temp = object->GetGeometry();
+			if (temp) {
+				//these calculations are per-subset
+				WMatrix inverseW = WMatrixInverseAffine(object->GetWorldMatrix());
+
+				WVector3 subsetPos = WVec3TransformCoord(pos, inverseW);
+				WVector3 subsetDir = WVec3TransformNormal(dir, inverseW);
+
+				WVector3 boxPos = (temp->GetMaxPoint() + temp->GetMinPoint()) / 2.0f;
+				WVector3 boxSize = (temp->GetMaxPoint() - temp->GetMinPoint()) / 2.0f;
+
+				pickStruct p;
+				p.obj = object;
+				if (WUtil::RayIntersectBox(boxSize, subsetPos, subsetDir, boxPos)) {
+					// bAnyHit only stops at the first object hit, the point on that object is still its closest one
+					WVector3 pt;
+					bool b = temp->Intersect(subsetPos, subsetDir, &pt, &p.uv, &p.face);
+					WMatrix m = object->GetWorldMatrix();
+					p.pos.x = (pt.x * m(0, 0)) + (pt.y * m(1, 0)) + (pt.z * m(2, 0)) + (1 * m(3, 0));
+					p.pos.y = (pt.x * m(0, 1)) + (pt.y * m(1, 1)) + (pt.z * m(2, 1)) + (1 * m(3, 1));
+					p.pos.z = (pt.x * m(0, 2)) + (pt.y * m(1, 2)) + (pt.z * m(2, 2)) + (1 * m(3, 2));
+
+					if (b) {
+						if (bAnyHit) {
+							if (faceIndex) *faceIndex = p.face;
+							if (_pt) *_pt = pt;
+							if (uv) *uv = p.uv;
+							return object;
 						}
+						pickedObjects.push_back(p);
 					}
 				}
 			}
@@ -113,7 +121,7 @@ WObject* WObjectManager::PickObject(double x, double y, bool bAnyHit, uint32_t i
 	uint32_t nearest = 0;
 	float distance = std::numeric_limits<float>::max();
 	for (uint32_t i = 0; i < pickedObjects.size(); i++) {
-		float fCurDist = WVec3Length(pickedObjects[i].pos - cam->GetPosition());
+		float fCurDist = WVec3Length(pickedObjects[i].pos - cam->GetWorldPosition());
 		if (fCurDist < distance) {
 			nearest = i;
 			distance = fCurDist;
@@ -126,6 +134,136 @@ WObject* WObjectManager::PickObject(double x, double y, bool bAnyHit, uint32_t i
 	return pickedObjects[nearest].obj;
 }
 
+void WObjectManager::QueryRay(const WVector3& origin, const WVector3& direction, std::vector<WObject*>& objects) {
+	_UpdateSpatialIndex();
+	objects.clear();
+	m_spatialIndex.QueryRay(origin, direction, [&objects](void* userData) {
+		WObject* object = (WObject*)userData;
+		if (object->Valid())
+			objects.push_back(object);
+		return true;
+	});
+}
+
+void WObjectManager::QueryFrustum(WCamera* cam, std::vector<WObject*>& objects) {
+	W_PROFILE_ZONE(m_app, "WObjectManager::QueryFrustum");
+	_UpdateSpatialIndex();
+	objects.clear();
+	if (!cam)
+		return;
+
+	// the tree stores fattened boxes, so its candidates are refined against
+	// the exact world boxes in one batch
+	m_frustumBoxes.Clear();
+	m_spatialIndex.QueryPlanes(cam->GetFrustumPlanes(), 6, [this, &objects](void* userData) {
+		WObject* object = (WObject*)userData;
+		// objects without frustum culling are added below
+		if (object->m_bFrustumCull && object->Valid()) {
+			objects.push_back(object);
+			m_frustumBoxes.Add(object->m_worldBoundsCenter, object->m_worldBoundsExtent);
+		}
+		return true;
+	});
+	cam->CheckBoxesInFrustum(m_frustumBoxes, m_frustumVisibility);
+	uint32_t numVisible = 0;
+	for (uint32_t i = 0; i < objects.size(); i++) {
+		if (m_frustumVisibility[i / 32] & (1u << (i % 32)))
+			objects[numVisible++] = objects[i];
+	}
+	objects.resize(numVisible);
+
+	for (auto object : m_unculledObjects) {
+		if (object->Valid())
+			objects.push_back(object);
+	}
+}
+
+void WObjectManager::QuerySphere(const WVector3& center, float radius, std::vector<WObject*>& objects) {
+	_UpdateSpatialIndex();
+	objects.clear();
+	m_spatialIndex.QuerySphere(center, radius, [&objects](void* userData) {
+		WObject* object = (WObject*)userData;
+		if (object->Valid())
+			objects.push_back(object);
+		return true;
+	});
+}
+
+void WObjectManager::QueryBox(const WVector3& min, const WVector3& max, std::vector<WObject*>& objects) {
+	_UpdateSpatialIndex();
+	objects.clear();
+	m_spatialIndex.QueryBox(min, max, [&objects](void* userData) {
+		WObject* object = (WObject*)userData;
+		if (object->Valid())
+			objects.push_back(object);
+		return true;
+	});
+}
+
+void WObjectManager::_OnObjectMoved(WObject* object) {
+	_AddToList(m_dirtySpatialObjects, &WObject::m_dirtySpatialIndex, object);
+}
+
+void WObjectManager::_OnGeometryBoundsChanged(WGeometry* geometry) {
+	m_changedGeometries.insert(geometry);
+}
+
+void WObjectManager::_RemoveFromSpatialIndex(WObject* object) {
+	if (object->m_spatialProxy != WAABBTree::NULL_PROXY) {
+		m_spatialIndex.DestroyProxy(object->m_spatialProxy);
+		object->m_spatialProxy = WAABBTree::NULL_PROXY;
+	}
+	_RemoveFromList(m_dirtySpatialObjects, &WObject::m_dirtySpatialIndex, object);
+	_RemoveFromList(m_unculledObjects, &WObject::m_unculledIndex, object);
+}
+
+void WObjectManager::_AddToList(std::vector<WObject*>& list, uint32_t WObject::* index, WObject* object) {
+	if (object->*index != UINT32_MAX)
+		return;
+	object->*index = (uint32_t)list.size();
+	list.push_back(object);
+}
+
+void WObjectManager::_RemoveFromList(std::vector<WObject*>& list, uint32_t WObject::* index, WObject* object) {
+	uint32_t i = object->*index;
+	if (i == UINT32_MAX)
+		return;
+	WObject* last = list.back();
+	list[i] = last;
+	last->*index = i;
+	list.pop_back();
+	object->*index = UINT32_MAX;
+}
+
+void WObjectManager::_UpdateSpatialIndex() {
+	W_PROFILE_ZONE(m_app, "WObjectManager::UpdateSpatialIndex");
+	if (m_changedGeometries.size() > 0) {
+		// geometries were (re)created or rewritten since the last query, one scan covers all of them
+		for (auto object : m_entities) {
+			if (m_changedGeometries.find(object->m_geometry) != m_changedGeometries.end())
+				_OnObjectMoved(object);
+		}
+		m_changedGeometries.clear();
+	}
+
+	for (auto object : m_dirtySpatialObjects) {
+		object->m_dirtySpatialIndex = UINT32_MAX;
+		if (object->Valid()) {
+			object->_GetWorldBoundingBox(&object->m_worldBoundsCenter, &object->m_worldBoundsExtent);
+			WVector3 min = object->m_worldBoundsCenter - object->m_worldBoundsExtent;
+			WVector3 max = object->m_worldBoundsCenter + object->m_worldBoundsExtent;
+			if (object->m_spatialProxy == WAABBTree::NULL_PROXY)
+				object->m_spatialProxy = m_spatialIndex.CreateProxy(min, max, object);
+			else
+				m_spatialIndex.MoveProxy(object->m_spatialProxy, min, max);
+		} else if (object->m_spatialProxy != WAABBTree::NULL_PROXY) {
+			m_spatialIndex.DestroyProxy(object->m_spatialProxy);
+			object->m_spatialProxy = WAABBTree::NULL_PROXY;
+		}
+	}
+	m_dirtySpatialObjects.clear();
+}
+
 WInstance::WInstance() {
 	m_scale = WVector3(1.0f, 1.0f, 1.0f);
 }
@@ -187,16 +325,22 @@ WObject::WObject(Wasabi* const app, uint32_t ID) : WObject(app, nullptr, 0, ID)
 WObject::WObject(Wasabi* const app, WEffect* fx, uint32_t bindingSet, uint32_t ID) : WFileAsset(app, ID), m_instanceV(0) {
 	m_geometry = nullptr;
 	m_animation = nullptr;
+	m_occluderGeometry = nullptr;
 
 	m_hidden = false;
 	m_bAltered = true;
 	m_bFrustumCull = true;
 
 	m_WorldM = WMatrix();
+	m_worldMatrixVersion = 0;
 	m_scale = WVector3(1.0f, 1.0f, 1.0f);
 
 	m_instanceTexture = nullptr;
 
+	m_spatialProxy = WAABBTree::NULL_PROXY;
+	m_dirtySpatialIndex = UINT32_MAX;
+	m_unculledIndex = UINT32_MAX;
+
 	if (fx)
 		AddEffect(fx, bindingSet);
 
@@ -206,9 +350,11 @@ WObject::WObject(Wasabi* const app, WEffect* fx, uint32_t bindingSet, uint32_t I
 WObject::~WObject() {
 	W_SAFE_REMOVEREF(m_geometry);
 	W_SAFE_REMOVEREF(m_animation);
+	W_SAFE_REMOVEREF(m_occluderGeometry);
 
 	DestroyInstancingResources();
 
+	m_app->ObjectManager->_RemoveFromSpatialIndex(this);
 	m_app->ObjectManager->RemoveEntity(this);
 }
 
@@ -255,6 +401,11 @@ bool WObject::WillRender(WRenderTarget* rt) {
 }
 
 void WObject::Render(WRenderTarget* rt, WMaterial* material, bool updateInstances) {
+	PrepareRender(material, updateInstances);
+	RecordRender(rt, material);
+}
+
+void WObject::PrepareRender(WMaterial* material, bool updateInstances) {
 	if (updateInstances)
 		_UpdateInstanceBuffer();
 
@@ -262,11 +413,19 @@ void WObject::Render(WRenderTarget* rt, WMaterial* material, bool updateInstance
 	bool is_instanced = m_instanceV.size() > 0;
 
 	if (material) {
-		WMatrix worldM = GetWorldMatrix();
-		material->SetVariable<WMatrix>("worldMatrix", worldM);
+		RENDER_VARIABLE_HANDLES& handles = _GetRenderVariableHandles(material);
+		UpdateLocals();
+		// only this object writes to its own materials, so the world matrix
+		// doesn't need to be written again if it did not change since
+		if (handles.worldMatrixMaterialID != material->GetUniqueID() || handles.worldMatrixVersion != m_worldMatrixVersion) {
+			material->SetVariable<WMatrix>(handles.worldMatrix, m_WorldM);
+			auto ownMaterial = m_materialMap.find(material->GetEffect());
+			handles.worldMatrixMaterialID = ownMaterial != m_materialMap.end() && ownMaterial->second == material ? material->GetUniqueID() : 0;
+			handles.worldMatrixVersion = m_worldMatrixVersion;
+		}
 		// animation variables
-		material->SetVariable<int>("isAnimated", is_animated ? 1 : 0);
-		material->SetVariable<int>("isInstanced", is_instanced ? 1 : 0);
+		material->SetVariable<int>(handles.isAnimated, is_animated ? 1 : 0);
+		material->SetVariable<int>(handles.isInstanced, is_instanced ? 1 : 0);
 		if (is_animated) {
 			WImage* animTex = m_animation->GetTexture();
 			material->SetTexture("animationTexture", animTex);
@@ -275,13 +434,40 @@ void WObject::Render(WRenderTarget* rt, WMaterial* material, bool updateInstance
 		if (is_instanced) {
 			material->SetTexture("instancingTexture", m_instanceTexture);
 		}
-		material->Bind(rt);
+		material->UpdateResources();
 	}
+}
+
+void WObject::RecordRender(WRenderTarget* rt, WMaterial* material) {
+	bool is_animated = m_animation && m_animation->Valid() && m_geometry->IsRigged();
+
+	// the material was updated by PrepareRender()
+	if (material)
+		material->RecordBind(rt->GetCommnadBuffer());
 
 	WError err = m_geometry->Draw(rt, std::numeric_limits<uint32_t>::max(), std::max((uint32_t)m_instanceV.size(), (uint32_t)1), is_animated);
 	(void)err;
 }
 
+WObject::RENDER_VARIABLE_HANDLES& WObject::_GetRenderVariableHandles(WMaterial* material) {
+	// an object is rendered with very few effects (one per render stage), a linear search is enough
+	WEffect* effect = material->GetEffect();
+	uint64_t effectID = effect ? effect->GetUniqueID() : 0;
+	for (auto& handles : m_renderVariableHandles) {
+		if (handles.worldMatrix.effectID == effectID && handles.worldMatrix.bindingSet == material->GetBindingSet())
+			return handles;
+	}
+
+	RENDER_VARIABLE_HANDLES handles;
+	handles.worldMatrix = material->GetVariableHandle("worldMatrix");
+	handles.isAnimated = material->GetVariableHandle("isAnimated");
+	handles.isInstanced = material->GetVariableHandle("isInstanced");
+	handles.worldMatrixMaterialID = 0;
+	handles.worldMatrixVersion = 0;
+	m_renderVariableHandles.push_back(handles);
+	return m_renderVariableHandles.back();
+}
+
 WError WObject::SetGeometry(class WGeometry* geometry) {
 	if (m_geometry)
 		m_geometry->RemoveReference();
@@ -290,6 +476,7 @@ WError WObject::SetGeometry(class WGeometry* geometry) {
 	if (geometry) {
 		m_geometry->AddReference();
 	}
+	m_app->ObjectManager->_OnObjectMoved(this);
 
 	return WError(W_SUCCEEDED);
 }
@@ -306,6 +493,17 @@ WError WObject::SetAnimation(class WAnimation* animation) {
 	return WError(W_SUCCEEDED);
 }
 
+WError WObject::SetOccluderGeometry(WGeometry* geometry) {
+	if (m_occluderGeometry)
+		m_occluderGeometry->RemoveReference();
+
+	m_occluderGeometry = geometry;
+	if (geometry)
+		m_occluderGeometry->AddReference();
+
+	return WError(W_SUCCEEDED);
+}
+
 WError WObject::InitInstancing(uint32_t maxInstances) {
 	DestroyInstancingResources();
 
@@ -402,6 +600,10 @@ WAnimation* WObject::GetAnimation() const {
 	return m_animation;
 }
 
+WGeometry* WObject::GetOccluderGeometry() const {
+	return m_occluderGeometry;
+}
+
 bool WObject::Hidden() const {
 	return m_hidden;
 }
@@ -415,20 +617,48 @@ void WObject::Hide() {
 }
 
 void WObject::EnableFrustumCulling() {
+	WObjectManager* manager = m_app->ObjectManager;
+	manager->_RemoveFromList(manager->m_unculledObjects, &WObject::m_unculledIndex, this);
 	m_bFrustumCull = true;
 }
 
 void WObject::DisableFrustumCulling() {
+	WObjectManager* manager = m_app->ObjectManager;
+	manager->_AddToList(manager->m_unculledObjects, &WObject::m_unculledIndex, this);
 	m_bFrustumCull = false;
 }
 
+bool WObject::IsFrustumCullingEnabled() const {
+	return m_bFrustumCull;
+}
+
 bool WObject::InCameraView(class WCamera* const cam) {
+	WVector3 center, extent;
+	_GetWorldBoundingBox(&center, &extent);
+	return cam->CheckBoxInFrustum(center, extent);
+}
+
+bool WObject::GetWorldBoundingBox(WVector3* center, WVector3* extent) {
+	if (!Valid())
+		return false;
+	_GetWorldBoundingBox(center, extent);
+	return true;
+}
+
+void WObject::_GetWorldBoundingBox(WVector3* center, WVector3* extent) {
+	// transform the center of the geometry's box and project the rotated
+	// (and scaled) half-size onto the world axes, which gives the box that
+	// encloses all 8 transformed corners
 	WMatrix worldM = GetWorldMatrix();
-	WVector3 min = WVec3TransformCoord(m_geometry->GetMinPoint(), worldM);
-	WVector3 max = WVec3TransformCoord(m_geometry->GetMaxPoint(), worldM);
-	WVector3 pos = (max + min) / 2.0f;
-	WVector3 size = (max - min) / 2.0f;
-	return cam->CheckBoxInFrustum(pos, size);
+	WVector3 geometryMin = m_geometry->GetMinPoint();
+	WVector3 geometryMax = m_geometry->GetMaxPoint();
+	WVector3 localExtent = (geometryMax - geometryMin) / 2.0f;
+	*center = WVec3TransformCoord((geometryMax + geometryMin) / 2.0f, worldM);
+	*extent = WVector3(
+		std::abs(worldM(0, 0)) * localExtent.x + std::abs(worldM(1, 0)) * localExtent.y + std::abs(worldM(2, 0)) * localExtent.z,
+		std::abs(worldM(0, 1)) * localExtent.x + std::abs(worldM(1, 1)) * localExtent.y + std::abs(worldM(2, 1)) * localExtent.z,
+		std::abs(worldM(0, 2)) * localExtent.x + std::abs(worldM(1, 2)) * localExtent.y + std::abs(worldM(2, 2)) * localExtent.z
+	);
 }
 
 WVector3 WObject::GetScale() const {
@@ -438,6 +668,7 @@ WVector3 WObject::GetScale() const {
 void WObject::Scale(WVector3 scale) {
 	m_bAltered = true;
 	m_scale = scale;
+	m_app->ObjectManager->_OnObjectMoved(this);
 }
 
 WMatrix WObject::GetWorldMatrix() {
@@ -448,10 +679,11 @@ WMatrix WObject::GetWorldMatrix() {
 bool WObject::UpdateLocals() {
 	if (m_bAltered) {
 		m_bAltered = false;
-		m_WorldM = ComputeTransformation();
+		m_WorldM = ComputeWorldTransformation();
 
 		//scale matrix
 		m_WorldM = WScalingMatrix(m_scale) * m_WorldM;
+		m_worldMatrixVersion++;
 
 		return true;
 	}
@@ -462,6 +694,7 @@ bool WObject::UpdateLocals() {
 void WObject::OnStateChange(STATE_CHANGE_TYPE type) { //virtual method of the orientation device
 	WOrientation::OnStateChange(type); //do the default OnStateChange first
 	m_bAltered = true;
+	m_app->ObjectManager->_OnObjectMoved(this);
 }
 
 WError WObject::SaveToStream(WFile* file, std::ostream& outputStream) {
@@ -525,8 +758,15 @@ WError WObject::LoadFromStream(WFile* file, std::istream& inputStream, std::vect
 	DestroyInstancingResources();
 
 	inputStream.read((char*)&m_hidden, sizeof(m_hidden));
-	inputStream.read((char*)&m_bFrustumCull, sizeof(m_bFrustumCull));
-	inputStream.read((char*)&m_scale, sizeof(m_scale));
+	bool bFrustumCull;
+	inputStream.read((char*)&bFrustumCull, sizeof(bFrustumCull));
+	if (bFrustumCull)
+		EnableFrustumCulling();
+	else
+		DisableFrustumCulling();
+	WVector3 scale;
+	inputStream.read((char*)&scale, sizeof(scale));
+	Scale(scale);
 	WVector3 pos;
 	inputStream.read((char*)&pos, sizeof(pos));
 	SetPosition(pos);
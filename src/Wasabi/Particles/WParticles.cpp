@@ -429,13 +429,20 @@ void WParticles::DisableFrustumCulling() {
 bool WParticles::InCameraView(class WCamera* cam) {
 	if (!Valid())
 		return false;
-	// @TODO: this is not a good check
+	// the world box that encloses all 8 transformed corners of the
+	// behavior's box: transform its center and project its half-size onto
+	// the world axes
 	WMatrix worldM = GetWorldMatrix();
-	WVector3 min = WVec3TransformCoord(m_behavior->GetMinPoint(), worldM);
-	WVector3 max = WVec3TransformCoord(m_behavior->GetMaxPoint(), worldM);
-	WVector3 pos = (max + min) / 2.0f;
-	WVector3 size = (max - min) / 2.0f;
-	return cam->CheckBoxInFrustum(pos, size);
+	WVector3 min = m_behavior->GetMinPoint();
+	WVector3 max = m_behavior->GetMaxPoint();
+	WVector3 localExtent = (max - min) / 2.0f;
+	WVector3 center = WVec3TransformCoord((max + min) / 2.0f, worldM);
+	WVector3 extent(
+		std::abs(worldM(0, 0)) * localExtent.x + std::abs(worldM(1, 0)) * localExtent.y + std::abs(worldM(2, 0)) * localExtent.z,
+		std::abs(worldM(0, 1)) * localExtent.x + std::abs(worldM(1, 1)) * localExtent.y + std::abs(worldM(2, 1)) * localExtent.z,
+		std::abs(worldM(0, 2)) * localExtent.x + std::abs(worldM(1, 2)) * localExtent.y + std::abs(worldM(2, 2)) * localExtent.z
+	);
+	return cam->CheckBoxInFrustum(center, extent);
 }
 
 WError WParticles::Create(uint32_t maxParticles, WParticlesBehavior* behavior) {
@@ -504,7 +511,7 @@ WMatrix WParticles::GetWorldMatrix() {
 bool WParticles::UpdateLocals() {
 	if (m_bAltered) {
 		m_bAltered = false;
-		m_WorldM = ComputeTransformation();
+		m_WorldM = ComputeWorldTransformation();
 
 		return true;
 	}
@@ -19,15 +19,16 @@ std::string WBulletRigidBodyManager::GetTypeName() const {
 }
 
 void WBulletRigidBodyManager::Update(float deltaTime) {
-	for (uint32_t i = 0; i < W_HASHTABLESIZE; i++) {
-		for (uint32_t j = 0; j < m_entities[i].size(); j++) {
-			((WBulletRigidBody*)m_entities[i][j])->Update(deltaTime);
-		}
+	// backwards, so that a rigid body removed during its update doesn't skip another one
+	for (uint32_t i = GetEntitiesCount(); i-- > 0;) {
+		if (i < GetEntitiesCount())
+			((WBulletRigidBody*)GetEntityByIndex(i))->Update(deltaTime);
 	}
 }
 
 WBulletRigidBody::WBulletRigidBody(Wasabi* const app, uint32_t ID) : WRigidBody(app, ID) {
 	m_isUpdating = false;
+	m_syncPending = true;
 	m_boundObject = nullptr;
 	m_boundObjectBase = nullptr;
 	m_savedCreateInfo = nullptr;
@@ -193,6 +194,7 @@ WError WBulletRigidBody::Create(W_RIGID_BODY_CREATE_INFO createInfo, bool bSaveI
 
 	//add the body to the dynamics world
 	((btDynamicsWorld*)physics->m_dynamicsWorld)->addRigidBody(((btRigidBody*)m_rigidBody));
+	m_syncPending = true;
 
 	SetBouncingPower(0.2f);
 	SetFriction(0.2f);
@@ -211,7 +213,10 @@ void WBulletRigidBody::Update(float deltaTime) {
 	UNREFERENCED_PARAMETER(deltaTime);
 
 	m_isUpdating = true;
-	if (m_rigidBody) {
+	// sleeping and static bodies did not move, syncing them would only mark
+	// their transforms (and those of the bound objects) as changed
+	if (m_rigidBody && (((btRigidBody*)m_rigidBody)->isActive() || m_syncPending)) {
+		m_syncPending = false;
 		btQuaternion rotation = ((btRigidBody*)m_rigidBody)->getOrientation();
 		WQuaternion wRot = BTWConvertQuaternion(rotation);
 		btTransform transformation = ((btRigidBody*)m_rigidBody)->getWorldTransform();
@@ -234,6 +239,7 @@ void WBulletRigidBody::BindObject(WOrientation* obj, WBase* objBase) {
 
 	m_boundObject = obj;
 	m_boundObjectBase = objBase;
+	m_syncPending = true;
 
 	if (m_boundObjectBase)
 		m_boundObjectBase->AddReference();
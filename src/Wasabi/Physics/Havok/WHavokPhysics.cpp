@@ -248,34 +248,31 @@ WRigidBodyManager::WRigidBodyManager(Wasabi* app) : WManager<WRigidBody>(m_app)
 
 void WRigidBodyManager::SyncWithObjects() {
 	((WHavokPhysics*)m_app->PhysicsComponent)->GetWorld()->lock();
-	for (uint32_t j = 0; j < W_HASHTABLESIZE; j++) {
-		for (uint32_t i = 0; i < m_entities[j].size(); i++) {
-			if (!m_entities[j][i]->GetRigidBody())
-				continue;
-
-			//tell havok the current object's position/rotation before starting to simulate physics
-			m_entities[j][i]->GetRigidBody()->setPosition(hkVector4(m_entities[j][i]->GetPosition().x,
-																	m_entities[j][i]->GetPosition().y, m_entities[j][i]->GetPosition().z));
-			m_entities[j][i]->GetRigidBody()->setRotation(m_entities[j][i]->GetRotationQuat());
-		}
+	for (auto it = begin(); it != end(); it++) {
+		WRigidBody* rb = *it;
+		if (!rb->GetRigidBody())
+			continue;
+
+		//tell havok the current object's position/rotation before starting to simulate physics
+		rb->GetRigidBody()->setPosition(hkVector4(rb->GetPosition().x, rb->GetPosition().y, rb->GetPosition().z));
+		rb->GetRigidBody()->setRotation(rb->GetRotationQuat());
 	}
 	((WHavokPhysics*)m_app->PhysicsComponent)->GetWorld()->unlock();
 }
 
 void WRigidBodyManager::Update(float fDeltaTime) {
 	((WHavokPhysics*)m_app->PhysicsComponent)->GetWorld()->lock();
-	for (uint32_t j = 0; j < W_HASHTABLESIZE; j++) {
-		for (uint32_t i = 0; i < m_entities[j].size(); i++) {
-			if (m_entities[j][i]->GetRigidBody() && m_entities[j][i]->Enabled()) {
-				hkVector4 v = m_entities[j][i]->GetRigidBody()->getPosition(); //get position
-				hkQuaternion q = m_entities[j][i]->GetRigidBody()->getRotation(); //get rotation
+	for (auto it = begin(); it != end(); it++) {
+		WRigidBody* rb = *it;
+		if (rb->GetRigidBody() && rb->Enabled()) {
+			hkVector4 v = rb->GetRigidBody()->getPosition(); //get position
+			hkQuaternion q = rb->GetRigidBody()->getRotation(); //get rotation
 
-				m_entities[j][i]->SetPosition(v(0), v(1), v(2));
+			rb->SetPosition(v(0), v(1), v(2));
 
-				WQuaternion quat(q(0), q(1), q(2), q(3));
-				//re-build the ulr vectors of the object
-				m_entities[j][i]->SetAngle(quat);
-			}
+			WQuaternion quat(q(0), q(1), q(2), q(3));
+			//re-build the ulr vectors of the object
+			rb->SetAngle(quat);
 		}
 	}
 	((WHavokPhysics*)m_app->PhysicsComponent)->GetWorld()->unlock();
@@ -1498,9 +1495,11 @@ WPhysicsActionManager::WPhysicsActionManager(Wasabi* app) : WManager<WPhysicsAct
 
 void WPhysicsActionManager::Update(float fDeltaTime) {
 	((WHavokPhysics*)m_app->PhysicsComponent)->GetWorld()->lock();
-	for (uint32_t j = 0; j < W_HASHTABLESIZE; j++)
-		for (uint32_t i = 0; i < m_entities[j].size(); i++)
-			m_entities[j][i]->Update(fDeltaTime);
+	// backwards, so that an action removed during its update doesn't skip another one
+	for (uint32_t i = GetEntitiesCount(); i-- > 0;) {
+		if (i < GetEntitiesCount())
+			GetEntityByIndex(i)->Update(fDeltaTime);
+	}
 	((WHavokPhysics*)m_app->PhysicsComponent)->GetWorld()->unlock();
 }
 
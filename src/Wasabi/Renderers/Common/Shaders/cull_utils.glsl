@@ -0,0 +1,37 @@
+// Shared by the compute shaders that cull the objects drawn indirectly (see WObjectsRenderFragment)
+
+// CullData.flags: the object is drawn even when it is outside the frustum
+#define CULL_FLAG_NO_FRUSTUM_CULLING 1u
+
+struct CullData {
+	vec4 boundsMin; // xyz is the minimum of the object's world-space bounding box
+	vec4 boundsMax; // xyz is the maximum of the object's world-space bounding box
+	uint command; // index of the batch's draw command
+	uint firstObject; // index of the batch's first object
+	uint slot; // index of the object in the visibility buffer (occlusion culling only)
+	uint flags; // CULL_FLAG_*
+};
+
+struct DrawCommand {
+	uint indexCount;
+	uint instanceCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint firstInstance;
+};
+
+// Whether an object's bounding box is (at least partly) inside the frustum, whose planes' normals face its inside
+bool IsInFrustum(CullData object, vec4 frustumPlanes[6]) {
+	if ((object.flags & CULL_FLAG_NO_FRUSTUM_CULLING) != 0u)
+		return true;
+
+	// the box is outside a plane if its center is further behind the plane
+	// than the box's extent along the plane's normal (its nearest corner)
+	vec3 center = (object.boundsMin.xyz + object.boundsMax.xyz) * 0.5;
+	vec3 extent = (object.boundsMax.xyz - object.boundsMin.xyz) * 0.5;
+	for (int i = 0; i < 6; i++) {
+		if (dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w + dot(abs(frustumPlanes[i].xyz), extent) < 0.0)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,48 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "cull_utils.glsl"
+
+layout(local_size_x = 64) in;
+
+layout(set = 0, binding = 0) readonly buffer CullDataSBO {
+	CullData objects[];
+} cullData;
+
+layout(set = 0, binding = 1) buffer DrawCommandsSBO {
+	DrawCommand commands[];
+} drawCommands;
+
+layout(set = 0, binding = 2) writeonly buffer DrawListSBO {
+	uint indices[];
+} drawList;
+
+layout(set = 0, binding = 3) writeonly buffer DrawCountsSBO {
+	uint counts[];
+} drawCounts;
+
+layout(set = 0, binding = 4) uniform UBOPerFrame {
+	vec4 frustumPlanes[6];
+} uboPerFrame;
+
+layout(push_constant) uniform PC {
+	uint numObjects;
+} pcCull;
+
+void main() {
+	uint objectIndex = gl_GlobalInvocationID.x;
+	if (objectIndex >= pcCull.numObjects)
+		return;
+
+	CullData object = cullData.objects[objectIndex];
+	if (!IsInFrustum(object, uboPerFrame.frustumPlanes))
+		return;
+
+	// append the object to its batch's instances, the batch is drawn once it has any
+	uint instance = atomicAdd(drawCommands.commands[object.command].instanceCount, 1u);
+	drawList.indices[object.firstObject + instance] = objectIndex;
+	drawCounts.counts[object.command] = 1u;
+}
@@ -0,0 +1,150 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "cull_utils.glsl"
+
+#define MAX_PYRAMID_LEVELS 16
+// tolerance of the depth test, so that surfaces lying on their own box are not occluded by their own (quantized) depth
+#define DEPTH_EPSILON (1.0 / 32768.0)
+
+layout(local_size_x = 64) in;
+
+layout(set = 0, binding = 0) readonly buffer CullDataSBO {
+	CullData objects[];
+} cullData;
+
+layout(set = 0, binding = 1) buffer VisibilitySBO {
+	uint visible[];
+} visibility;
+
+layout(set = 0, binding = 2) buffer DrawCommandsSBO {
+	DrawCommand commands[];
+} drawCommands;
+
+layout(set = 0, binding = 3) writeonly buffer DrawListSBO {
+	uint indices[];
+} drawList;
+
+layout(set = 0, binding = 4) buffer StatsSBO {
+	uint numTested;
+	uint numCulled;
+	uint numDrawnEarly;
+	uint numDrawnLate;
+} stats;
+
+layout(set = 0, binding = 5) uniform sampler2D depthPyramid[MAX_PYRAMID_LEVELS];
+
+layout(set = 0, binding = 6) uniform UBOPerFrame {
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 frustumPlanes[6];
+	vec2 depthSize;
+	uint numLevels;
+} uboPerFrame;
+
+layout(set = 0, binding = 7) writeonly buffer DrawCountsSBO {
+	uint counts[];
+} drawCounts;
+
+layout(push_constant) uniform PC {
+	uint phase;
+	uint numObjects;
+	uint numCommands;
+} pcCull;
+
+// Adds an object to the draw command of its batch in the given phase
+void Draw(uint objectIndex, CullData object, uint phase) {
+	uint instance = atomicAdd(drawCommands.commands[phase * pcCull.numCommands + object.command].instanceCount, 1u);
+	drawList.indices[phase * pcCull.numObjects + object.firstObject + instance] = objectIndex;
+	drawCounts.counts[phase * pcCull.numCommands + object.command] = 1u;
+	if (phase == 0)
+		atomicAdd(stats.numDrawnEarly, 1u);
+	else
+		atomicAdd(stats.numDrawnLate, 1u);
+}
+
+bool IsOccluded(CullData object) {
+	mat4 viewProjection = uboPerFrame.projectionMatrix * uboPerFrame.viewMatrix;
+	vec3 boxMin = vec3(1.0);
+	vec3 boxMax = vec3(0.0);
+	for (int i = 0; i < 8; i++) {
+		vec3 corner = mix(object.boundsMin.xyz, object.boundsMax.xyz, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+		vec4 clip = viewProjection * vec4(corner, 1.0);
+		// boxes that cross the near plane are never occluded
+		if (clip.w <= 0.0 || clip.z < 0.0)
+			return false;
+		vec3 screen = vec3(clip.xy / clip.w * 0.5 + 0.5, clip.z / clip.w);
+		boxMin = min(boxMin, screen);
+		boxMax = max(boxMax, screen);
+	}
+	if (any(greaterThan(boxMin.xy, vec2(1.0))) || any(lessThan(boxMax.xy, vec2(0.0))))
+		return false; // outside the view, main() frustum culls those first
+
+	// find the finest level at which the box covers at most 2x2 texels, a
+	// texel of level L covers 2^(L+1) pixels of the depth in each dimension
+	ivec2 pixelMin = clamp(ivec2(boxMin.xy * uboPerFrame.depthSize), ivec2(0), ivec2(uboPerFrame.depthSize) - 1);
+	ivec2 pixelMax = clamp(ivec2(boxMax.xy * uboPerFrame.depthSize), ivec2(0), ivec2(uboPerFrame.depthSize) - 1);
+	uint level = 0;
+	ivec2 levelSize = (ivec2(uboPerFrame.depthSize) + 1) / 2;
+	ivec2 texelMin = pixelMin >> 1;
+	ivec2 texelMax = pixelMax >> 1;
+	while (level + 1 < uboPerFrame.numLevels && any(greaterThan(texelMax - texelMin, ivec2(1)))) {
+		level++;
+		levelSize = (levelSize + 1) / 2;
+		texelMin = pixelMin >> (level + 1);
+		texelMax = pixelMax >> (level + 1);
+	}
+	texelMin = min(texelMin, levelSize - 1);
+	texelMax = min(texelMax, levelSize - 1);
+
+	// the levels are indexed with the (uniform) loop counter rather than with
+	// the (non-uniform) level, which would need descriptor indexing
+	float farthest = 0.0;
+	for (uint i = 0; i < uboPerFrame.numLevels; i++) {
+		if (i == level) {
+			for (int y = texelMin.y; y <= texelMax.y; y++)
+				for (int x = texelMin.x; x <= texelMax.x; x++)
+					farthest = max(farthest, texelFetch(depthPyramid[i], ivec2(x, y), 0).r);
+		}
+	}
+
+	// occluded if the nearest point of the box is behind everything drawn over it
+	return boxMin.z - DEPTH_EPSILON > farthest;
+}
+
+void main() {
+	uint objectIndex = gl_GlobalInvocationID.x;
+	if (objectIndex >= pcCull.numObjects)
+		return;
+
+	CullData object = cullData.objects[objectIndex];
+	bool wasVisible = visibility.visible[object.slot] != 0;
+	bool inFrustum = IsInFrustum(object, uboPerFrame.frustumPlanes);
+	if (pcCull.phase == 0) {
+		// the objects that were visible in the previous frame are drawn first,
+		// their depth is what the pyramid is built from
+		if (wasVisible && inFrustum)
+			Draw(objectIndex, object, 0u);
+		return;
+	}
+
+	// objects outside the frustum are not tested, they are tested (and drawn
+	// late if visible) once they enter it again
+	if (!inFrustum) {
+		visibility.visible[object.slot] = 0u;
+		return;
+	}
+
+	// the second phase tests every object against the pyramid, drawing the
+	// ones that became visible and remembering the result for the next frame
+	bool isVisible = !IsOccluded(object);
+	visibility.visible[object.slot] = isVisible ? 1u : 0u;
+	atomicAdd(stats.numTested, 1u);
+	if (isVisible && !wasVisible)
+		Draw(objectIndex, object, 1u);
+	else if (!isVisible && !wasVisible)
+		atomicAdd(stats.numCulled, 1u);
+}
@@ -0,0 +1,28 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(set = 0, binding = 0) uniform sampler2D inputDepth;
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D outputDepth;
+
+void main() {
+	ivec2 outputSize = imageSize(outputDepth);
+	ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+	if (pos.x >= outputSize.x || pos.y >= outputSize.y)
+		return;
+
+	// every texel keeps the farthest depth of the 2x2 texels under it, the
+	// last row/column also covers the extra texels of an odd-sized input
+	ivec2 inputSize = textureSize(inputDepth, 0);
+	ivec2 first = pos * 2;
+	ivec2 last = min(first + 1 + ivec2(equal(pos, outputSize - 1)) * (inputSize & 1), inputSize - 1);
+	float depth = 0.0;
+	for (int y = first.y; y <= last.y; y++)
+		for (int x = first.x; x <= last.x; x++)
+			depth = max(depth, texelFetch(inputDepth, ivec2(x, y), 0).r);
+
+	imageStore(outputDepth, pos, vec4(depth));
+}
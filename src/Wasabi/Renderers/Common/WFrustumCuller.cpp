@@ -0,0 +1,86 @@
+#include "Wasabi/Renderers/Common/WFrustumCuller.hpp"
+
+WFrustumCullCS::WFrustumCullCS(Wasabi* const app) : WShader(app) {}
+
+void WFrustumCullCS::Load(bool bSaveData) {
+	m_desc = GetDesc();
+	vector<uint8_t> code {
+		#include "Shaders/frustum-cull.comp.glsl.spv"
+	};
+	LoadCodeSPIRV((char*)code.data(), (int)code.size(), bSaveData);
+}
+
+W_SHADER_DESC WFrustumCullCS::GetDesc() {
+	W_SHADER_DESC desc;
+	desc.type = W_COMPUTE_SHADER;
+	desc.bound_resources = {
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_BUFFER, 0, 0, "cullData", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_VEC_4, "boundsMin"), // minimum of the world-space bounding box
+			W_SHADER_VARIABLE_INFO(W_TYPE_VEC_4, "boundsMax"), // maximum of the world-space bounding box
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "command"), // index of the batch's draw command
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "firstObject"), // index of the batch's first object
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "slot"), // unused (occlusion culling only)
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "flags"), // see cull_utils.glsl
+		}),
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_BUFFER, 1, 0, "drawCommands", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "indexCount"), // a VkDrawIndexedIndirectCommand
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "instanceCount"),
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "firstIndex"),
+			W_SHADER_VARIABLE_INFO(W_TYPE_INT, "vertexOffset"),
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "firstInstance"),
+		}),
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_BUFFER, 2, 0, "drawList", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "objectIndex"), // index of the object drawn by an instance
+		}),
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_BUFFER, 3, 0, "drawCounts", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "count"), // number of draws of a draw command (1 once it has instances)
+		}),
+		W_BOUND_RESOURCE(W_TYPE_UBO, 4, 0, "uboPerFrame", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_VEC_4, 6, "frustumPlanes"), // planes of the view's frustum, see WCamera::GetFrustumPlanes()
+		}),
+		W_BOUND_RESOURCE(W_TYPE_PUSH_CONSTANT, 0, "pcCull", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "numObjects"), // number of objects in cullData
+		}),
+	};
+	return desc;
+}
+
+WFrustumCuller::WFrustumCuller(Wasabi* const app) {
+	m_app = app;
+	m_cullFX = nullptr;
+}
+
+WFrustumCuller::~WFrustumCuller() {
+	Destroy();
+}
+
+WError WFrustumCuller::Create() {
+	Destroy();
+
+	WFrustumCullCS* cullCS = new WFrustumCullCS(m_app);
+	cullCS->SetName("FrustumCullCS");
+	cullCS->Load();
+
+	m_cullFX = new WEffect(m_app);
+	m_cullFX->SetName("FrustumCullEffect");
+
+	WError err = m_cullFX->BindShader(cullCS);
+	if (err)
+		err = m_cullFX->BuildPipeline(nullptr);
+	W_SAFE_REMOVEREF(cullCS);
+	if (!err)
+		W_SAFE_REMOVEREF(m_cullFX);
+	return err;
+}
+
+void WFrustumCuller::Destroy() {
+	W_SAFE_REMOVEREF(m_cullFX);
+}
+
+bool WFrustumCuller::Valid() const {
+	return m_cullFX != nullptr;
+}
+
+WEffect* WFrustumCuller::GetCullEffect() const {
+	return m_cullFX;
+}
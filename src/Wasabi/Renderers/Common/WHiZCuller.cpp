@@ -0,0 +1,257 @@
+#include "Wasabi/Renderers/Common/WHiZCuller.hpp"
+#include "Wasabi/Images/WImage.hpp"
+#include "Wasabi/Materials/WMaterial.hpp"
+
+namespace {
+	/** Size of the work groups of the downsample shader, in both dimensions */
+	const uint32_t DOWNSAMPLE_GROUP_SIZE = 8;
+};
+
+WHiZDownsampleCS::WHiZDownsampleCS(Wasabi* const app) : WShader(app) {}
+
+void WHiZDownsampleCS::Load(bool bSaveData) {
+	m_desc = GetDesc();
+	vector<uint8_t> code {
+		#include "Shaders/hiz-downsample.comp.glsl.spv"
+	};
+	LoadCodeSPIRV((char*)code.data(), (int)code.size(), bSaveData);
+}
+
+W_SHADER_DESC WHiZDownsampleCS::GetDesc() {
+	W_SHADER_DESC desc;
+	desc.type = W_COMPUTE_SHADER;
+	desc.bound_resources = {
+		W_BOUND_RESOURCE(W_TYPE_TEXTURE, 0, 0, "inputDepth"),
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_IMAGE, 1, 0, "outputDepth"),
+	};
+	return desc;
+}
+
+WHiZCullCS::WHiZCullCS(Wasabi* const app) : WShader(app) {}
+
+void WHiZCullCS::Load(bool bSaveData) {
+	m_desc = GetDesc();
+	vector<uint8_t> code {
+		#include "Shaders/hiz-cull.comp.glsl.spv"
+	};
+	LoadCodeSPIRV((char*)code.data(), (int)code.size(), bSaveData);
+}
+
+W_SHADER_DESC WHiZCullCS::GetDesc() {
+	W_SHADER_DESC desc;
+	desc.type = W_COMPUTE_SHADER;
+	desc.bound_resources = {
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_BUFFER, 0, 0, "cullData", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_VEC_4, "boundsMin"), // minimum of the world-space bounding box
+			W_SHADER_VARIABLE_INFO(W_TYPE_VEC_4, "boundsMax"), // maximum of the world-space bounding box
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "command"), // index of the batch's draw command
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "firstObject"), // index of the batch's first object
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "slot"), // index of the object in visibility
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "flags"), // see cull_utils.glsl
+		}),
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_BUFFER, 1, 0, "visibility", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "visible"), // whether the object was visible in the last test
+		}),
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_BUFFER, 2, 0, "drawCommands", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "indexCount"), // a VkDrawIndexedIndirectCommand
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "instanceCount"),
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "firstIndex"),
+			W_SHADER_VARIABLE_INFO(W_TYPE_INT, "vertexOffset"),
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "firstInstance"),
+		}),
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_BUFFER, 3, 0, "drawList", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "objectIndex"), // index of the object drawn by an instance
+		}),
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_BUFFER, 4, 0, "stats", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "numTested"), // see W_OCCLUSION_CULLING_STATS
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "numCulled"),
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "numDrawnEarly"),
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "numDrawnLate"),
+		}),
+		W_BOUND_RESOURCE(W_TYPE_TEXTURE, 5, 0, "depthPyramid", {}, WHiZCuller::MAX_LEVELS),
+		W_BOUND_RESOURCE(W_TYPE_UBO, 6, 0, "uboPerFrame", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_MAT4X4, "viewMatrix"), // view
+			W_SHADER_VARIABLE_INFO(W_TYPE_MAT4X4, "projectionMatrix"), // projection
+			W_SHADER_VARIABLE_INFO(W_TYPE_VEC_4, 6, "frustumPlanes"), // planes of the view's frustum, see WCamera::GetFrustumPlanes()
+			W_SHADER_VARIABLE_INFO(W_TYPE_VEC_2, "depthSize"), // size of the depth image the pyramid is built from
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "numLevels"), // number of levels of the pyramid
+		}),
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_BUFFER, 7, 0, "drawCounts", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "count"), // number of draws of a draw command (1 once it has instances)
+		}),
+		W_BOUND_RESOURCE(W_TYPE_PUSH_CONSTANT, 0, "pcCull", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "phase"), // 0 to draw the previously visible objects, 1 to test them all
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "numObjects"), // number of objects in cullData
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "numCommands"), // number of draw commands of a phase
+		}),
+	};
+	return desc;
+}
+
+WHiZCuller::WHiZCuller(Wasabi* const app) {
+	m_app = app;
+	m_depth = nullptr;
+	m_downsampleFX = nullptr;
+	m_cullFX = nullptr;
+}
+
+WHiZCuller::~WHiZCuller() {
+	Destroy();
+}
+
+WError WHiZCuller::_CreateEffects() {
+	WHiZDownsampleCS* downsampleCS = new WHiZDownsampleCS(m_app);
+	downsampleCS->SetName("HiZDownsampleCS");
+	downsampleCS->Load();
+	WHiZCullCS* cullCS = new WHiZCullCS(m_app);
+	cullCS->SetName("HiZCullCS");
+	cullCS->Load();
+
+	m_downsampleFX = new WEffect(m_app);
+	m_downsampleFX->SetName("HiZDownsampleEffect");
+	m_cullFX = new WEffect(m_app);
+	m_cullFX->SetName("HiZCullEffect");
+
+	WError err = m_downsampleFX->BindShader(downsampleCS);
+	if (err) {
+		err = m_downsampleFX->BuildPipeline(nullptr);
+		if (err) {
+			err = m_cullFX->BindShader(cullCS);
+			if (err)
+				err = m_cullFX->BuildPipeline(nullptr);
+		}
+	}
+	W_SAFE_REMOVEREF(downsampleCS);
+	W_SAFE_REMOVEREF(cullCS);
+	if (!err) {
+		W_SAFE_REMOVEREF(m_downsampleFX);
+		W_SAFE_REMOVEREF(m_cullFX);
+	}
+	return err;
+}
+
+WError WHiZCuller::Create(WImage* depth) {
+	if (!depth || !depth->Valid())
+		return WError(W_INVALIDPARAM);
+
+	if (!m_cullFX) {
+		WError err = _CreateEffects();
+		if (!err)
+			return err;
+	}
+
+	_DestroyPyramid();
+
+	uint32_t width = depth->GetWidth();
+	uint32_t height = depth->GetHeight();
+	while (m_levels.size() < MAX_LEVELS) {
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+		WImage* level = m_app->ImageManager->CreateImage(nullptr, width, height, VK_FORMAT_R32_SFLOAT, W_IMAGE_CREATE_TEXTURE | W_IMAGE_CREATE_STORAGE);
+		WMaterial* material = m_downsampleFX->CreateMaterial(0);
+		if (!level || !material) {
+			W_SAFE_REMOVEREF(level);
+			W_SAFE_REMOVEREF(material);
+			_DestroyPyramid();
+			return WError(W_OUTOFMEMORY);
+		}
+		material->SetTexture("inputDepth", m_levels.size() > 0 ? m_levels.back() : depth);
+		material->SetTexture("outputDepth", level);
+		m_levels.push_back(level);
+		m_downsampleMaterials.push_back(material);
+		if (width == 1 && height == 1)
+			break;
+	}
+
+	m_depth = depth;
+	m_depth->AddReference();
+
+	return WError(W_SUCCEEDED);
+}
+
+void WHiZCuller::_DestroyPyramid() {
+	for (auto& material : m_downsampleMaterials)
+		W_SAFE_REMOVEREF(material);
+	m_downsampleMaterials.clear();
+	for (auto& level : m_levels)
+		W_SAFE_REMOVEREF(level);
+	m_levels.clear();
+	W_SAFE_REMOVEREF(m_depth);
+}
+
+void WHiZCuller::Destroy() {
+	_DestroyPyramid();
+	W_SAFE_REMOVEREF(m_downsampleFX);
+	W_SAFE_REMOVEREF(m_cullFX);
+}
+
+bool WHiZCuller::Valid() const {
+	return m_cullFX && m_levels.size() > 0;
+}
+
+WError WHiZCuller::BuildPyramid(VkCommandBuffer cmdBuffer) {
+	if (!Valid())
+		return WError(W_NOTVALID);
+
+	// the culling of the previous frame may still be reading the levels
+	WEffect::ComputeBarrier(cmdBuffer);
+
+	// the depth's transition out of the attachment layout (see
+	// vkTools::setImageLayout()) only waits for the graphics stages, the
+	// depth writes are made visible to the compute shader here
+	VkMemoryBarrier depthBarrier = {};
+	depthBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(
+		cmdBuffer,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		1, &depthBarrier,
+		0, nullptr,
+		0, nullptr
+	);
+
+	WError err = m_downsampleFX->Bind(cmdBuffer);
+	if (!err)
+		return err;
+	for (uint32_t i = 0; i < m_levels.size(); i++) {
+		err = m_downsampleMaterials[i]->Bind(cmdBuffer);
+		if (!err)
+			return err;
+		uint32_t width = m_levels[i]->GetWidth();
+		uint32_t height = m_levels[i]->GetHeight();
+		err = m_downsampleFX->Dispatch(cmdBuffer, (width + DOWNSAMPLE_GROUP_SIZE - 1) / DOWNSAMPLE_GROUP_SIZE, (height + DOWNSAMPLE_GROUP_SIZE - 1) / DOWNSAMPLE_GROUP_SIZE);
+		if (!err)
+			return err;
+		// the next level (or the culling) reads this one
+		WEffect::ComputeBarrier(cmdBuffer);
+	}
+
+	return WError(W_SUCCEEDED);
+}
+
+WEffect* WHiZCuller::GetCullEffect() const {
+	return m_cullFX;
+}
+
+WError WHiZCuller::SetPyramidResources(WMaterial* material) {
+	if (!Valid() || !material)
+		return WError(W_NOTVALID);
+
+	for (uint32_t i = 0; i < MAX_LEVELS; i++) {
+		// unused elements get the default image
+		WError err = material->SetTexture("depthPyramid", i < m_levels.size() ? m_levels[i] : nullptr, i);
+		if (!err)
+			return err;
+	}
+	material->SetVariable<WVector2>("depthSize", WVector2((float)m_depth->GetWidth(), (float)m_depth->GetHeight()));
+	material->SetVariable<uint32_t>("numLevels", (uint32_t)m_levels.size());
+
+	return WError(W_SUCCEEDED);
+}
+
+uint32_t WHiZCuller::GetNumLevels() const {
+	return (uint32_t)m_levels.size();
+}
@@ -0,0 +1,582 @@
+#include "Wasabi/Renderers/Common/WRenderFragment.hpp"
+#include "Wasabi/Geometries/WGeometry.hpp"
+#include "Wasabi/Images/WImage.hpp"
+#include "Wasabi/Renderers/Common/WHiZCuller.hpp"
+#include "Wasabi/Renderers/Common/WFrustumCuller.hpp"
+
+void WObjectsRenderFragment::SetIndirectEffect(WEffect* fx, uint32_t objectUBOBinding, uint32_t texturesBinding) {
+	_DestroyIndirectResources();
+
+	m_indirectEffect = fx;
+	if (m_indirectEffect)
+		m_indirectEffect->AddReference();
+	m_objectUBOBinding = objectUBOBinding;
+	m_texturesBinding = texturesBinding;
+}
+
+void WObjectsRenderFragment::_DestroyIndirectResources() {
+	for (auto& it : m_indirectBatches)
+		W_SAFE_REMOVEREF(it.second.material);
+	m_indirectBatches.clear();
+	m_indirectObjects.clear();
+	m_numIndirectObjects = 0;
+	m_numIndirectCommands = 0;
+	m_objectData.Destroy(m_app);
+	m_objectDataCapacity = 0;
+	m_objectDataStride = 0;
+	m_worldMatrixOffset = 0;
+	m_drawList.Destroy(m_app);
+	m_drawListCapacity = 0;
+	m_indirectCommands.Destroy(m_app);
+	m_indirectCommandsCapacity = 0;
+	m_cullData.Destroy(m_app);
+	m_cullDataCapacity = 0;
+	m_drawCounts.Destroy(m_app);
+	m_drawCountsCapacity = 0;
+	m_frustumCulling = false;
+	m_occlusionCulling = false;
+	W_SAFE_REMOVEREF(m_indirectEffect);
+}
+
+WError WObjectsRenderFragment::SetFrustumCuller(WFrustumCuller* culler) {
+	_DestroyFrustumCullingResources();
+
+	if (!culler)
+		return WError(W_SUCCEEDED);
+	if (!culler->GetCullEffect())
+		return WError(W_INVALIDPARAM);
+
+	m_frustumCullMaterial = culler->GetCullEffect()->CreateMaterial(0);
+	if (!m_frustumCullMaterial)
+		return WError(W_OUTOFMEMORY);
+	m_frustumCullMaterial->SetName(m_name + "-FrustumCullMaterial");
+
+	// the buffers are re-created as they grow, the material picks them up
+	// when it is updated
+	m_frustumCullMaterial->SetStorageBuffer("cullData", &m_cullData);
+	m_frustumCullMaterial->SetStorageBuffer("drawCommands", &m_indirectCommands);
+	m_frustumCullMaterial->SetStorageBuffer("drawList", &m_drawList);
+	m_frustumCullMaterial->SetStorageBuffer("drawCounts", &m_drawCounts);
+	m_frustumCuller = culler;
+
+	return WError(W_SUCCEEDED);
+}
+
+void WObjectsRenderFragment::_DestroyFrustumCullingResources() {
+	W_SAFE_REMOVEREF(m_frustumCullMaterial);
+	m_frustumCuller = nullptr;
+	m_frustumCulling = false;
+}
+
+WError WObjectsRenderFragment::SetOcclusionCuller(WHiZCuller* culler) {
+	_DestroyOcclusionCullingResources();
+
+	if (!culler)
+		return WError(W_SUCCEEDED);
+	if (!culler->GetCullEffect())
+		return WError(W_INVALIDPARAM);
+
+	m_cullMaterial = culler->GetCullEffect()->CreateMaterial(0);
+	if (!m_cullMaterial)
+		return WError(W_OUTOFMEMORY);
+	m_cullMaterial->SetName(m_name + "-CullMaterial");
+
+	uint32_t numBuffers = m_app->GetEngineParam<uint32_t>("bufferingCount");
+	VkResult result = m_cullingStats.Create(m_app, numBuffers, sizeof(W_OCCLUSION_CULLING_STATS), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, nullptr, W_MEMORY_HOST_VISIBLE);
+	if (result != VK_SUCCESS) {
+		_DestroyOcclusionCullingResources();
+		return WError(W_OUTOFMEMORY);
+	}
+	m_cullingStatsPending.assign(numBuffers, false);
+
+	// the buffers are re-created as they grow, the material picks them up
+	// when it is updated
+	m_cullMaterial->SetStorageBuffer("cullData", &m_cullData);
+	m_cullMaterial->SetStorageBuffer("visibility", &m_visibility);
+	m_cullMaterial->SetStorageBuffer("drawCommands", &m_indirectCommands);
+	m_cullMaterial->SetStorageBuffer("drawList", &m_drawList);
+	m_cullMaterial->SetStorageBuffer("stats", &m_cullingStats);
+	m_cullMaterial->SetStorageBuffer("drawCounts", &m_drawCounts);
+	m_occlusionCuller = culler;
+
+	return WError(W_SUCCEEDED);
+}
+
+void WObjectsRenderFragment::_DestroyOcclusionCullingResources() {
+	W_SAFE_REMOVEREF(m_cullMaterial);
+	m_occlusionCuller = nullptr;
+	m_occlusionCulling = false;
+	m_visibility.Destroy(m_app);
+	m_visibilityCapacity = 0;
+	m_visibilitySlots.clear();
+	m_freeVisibilitySlots.clear();
+	m_numVisibilitySlots = 0;
+	m_cullingStats.Destroy(m_app);
+	m_cullingStatsPending.clear();
+	m_lastCullingStats = {};
+}
+
+WError WObjectsRenderFragment::_PrepareFrame(WRenderTarget* rt, bool gpuCulling) {
+	m_visibleEntities.clear();
+	m_indirectObjects.clear();
+	m_frustumCulling = false;
+	m_occlusionCulling = false;
+
+	WCamera* cam = rt->GetCamera();
+	if (!cam)
+		return WError(W_SUCCEEDED);
+
+	// the occlusion cull shader does the frustum test as well
+	bool drawIndirect = m_indirectEffect && m_app->GetEngineParam<bool>("indirectDrawing");
+	bool occlusionCulling = gpuCulling && drawIndirect && m_cullMaterial && m_occlusionCuller->Valid() && m_app->GetEngineParam<bool>("occlusionCulling");
+	bool frustumCulling = gpuCulling && drawIndirect && m_app->GetEngineParam<bool>("gpuFrustumCulling") &&
+						  ((m_frustumCullMaterial && m_frustumCuller->Valid()) || occlusionCulling);
+	bool softwareCulling = m_app->GetEngineParam<bool>("softwareOcclusionCulling");
+
+	// the spatial index is only needed to frustum cull on the CPU and to find
+	// the occluders
+	if (!frustumCulling || softwareCulling)
+		((WObjectManager*)m_manager)->QueryFrustum(cam, m_visibleObjects);
+
+	softwareCulling = softwareCulling && _RasterizeOccluders(cam);
+	m_numSoftwareOccluded = 0;
+
+	auto addObject = [this, rt, drawIndirect, softwareCulling](WObject* object, bool gpuFrustumCulling) {
+		// with GPU frustum culling, the objects drawn indirectly are only
+		// frustum culled by the cull shader
+		if (!ShouldRenderEntity(object) || !object->Valid() || object->Hidden() || (!gpuFrustumCulling && !object->WillRender(rt)))
+			return;
+		if (softwareCulling && object->GetInstancesCount() == 0) {
+			// the box doesn't cover the instances
+			WVector3 center, extent;
+			if (object->GetWorldBoundingBox(&center, &extent) && m_softwareCuller.IsBoxOccluded(center - extent, center + extent)) {
+				m_numSoftwareOccluded++;
+				return;
+			}
+		}
+		WEffect* effect;
+		WMaterial* material = SelectMaterial(object, &effect);
+		if (!material)
+			return;
+		if (drawIndirect && effect == m_renderEffect && _AddIndirectObject(object, material))
+			return;
+		if (gpuFrustumCulling && !object->WillRender(rt))
+			return;
+		m_visibleEntities.push_back(std::make_pair(WObjectSortingKey(object, effect), material));
+	};
+	if (frustumCulling) {
+		for (auto& it : m_allEntities)
+			addObject(it.second, true);
+	} else {
+		for (auto object : m_visibleObjects) {
+			// the spatial index holds every object of the manager, not only the
+			// ones registered with this fragment
+			if (m_allEntities.find(WObjectSortingKey(object)) != m_allEntities.end())
+				addObject(object, false);
+		}
+	}
+	std::sort(m_visibleEntities.begin(), m_visibleEntities.end(),
+		[](const std::pair<WObjectSortingKey, WMaterial*>& a, const std::pair<WObjectSortingKey, WMaterial*>& b) {
+			return a.first < b.first;
+		}
+	);
+
+	if (!m_indirectEffect)
+		return WError(W_SUCCEEDED);
+	return _PrepareIndirectDraws(frustumCulling, occlusionCulling);
+}
+
+bool WObjectsRenderFragment::_RasterizeOccluders(WCamera* cam) {
+	// every object in the view can hide the fragment's objects, not only the
+	// ones the fragment renders
+	m_softwareCuller.BeginFrame(cam->GetViewMatrix() * cam->GetProjectionMatrix());
+	for (auto object : m_visibleObjects) {
+		WGeometry* occluder = object->GetOccluderGeometry();
+		if (object->Hidden() || !occluder)
+			continue;
+		m_softwareCuller.AddOccluder(occluder, object->GetWorldMatrix());
+	}
+	if (m_softwareCuller.GetNumOccluderTriangles() == 0)
+		return false;
+
+	m_softwareCuller.Rasterize();
+	return true;
+}
+
+bool WObjectsRenderFragment::_AddIndirectObject(WObject* object, WMaterial* material) {
+	WGeometry* geometry = object->GetGeometry();
+	if (!geometry || !geometry->Valid() || geometry->GetNumIndices() == 0 || object->GetInstancesCount() > 0)
+		return false;
+
+	// the elements of the object data are padded to 16 bytes, like the UBO's structure
+	size_t uboSize;
+	if (!material->GetUniformBufferData(m_objectUBOBinding, &uboSize))
+		return false;
+	size_t stride = (uboSize + 15) & ~(size_t)15;
+	if (m_objectDataStride == 0) {
+		// the world matrix is written into the object data (the material's copy
+		// is only set when the object is drawn directly), so it must be in the UBO
+		size_t offset, size;
+		if (!material->GetUniformBufferVariable(m_objectUBOBinding, "worldMatrix", &offset, &size) || size != sizeof(WMatrix))
+			return false;
+		m_worldMatrixOffset = offset;
+		m_objectDataStride = stride;
+	} else if (stride != m_objectDataStride)
+		return false;
+
+	INDIRECT_BATCH_KEY key;
+	memset(&key, 0, sizeof(key));
+	key.geometry = geometry;
+	material->GetTextures(m_texturesBinding, key.textures, MAX_INDIRECT_TEXTURES);
+
+	auto it = m_indirectBatches.find(key);
+	if (it == m_indirectBatches.end()) {
+		INDIRECT_BATCH batch = {};
+		batch.material = m_indirectEffect->CreateMaterial(0);
+		if (!batch.material)
+			return false;
+		batch.material->SetStorageBuffer("objectData", &m_objectData);
+		batch.material->SetStorageBuffer("drawList", &m_drawList);
+		for (uint32_t i = 0; i < MAX_INDIRECT_TEXTURES && key.textures[i]; i++)
+			batch.material->SetTexture(m_texturesBinding, key.textures[i], i);
+		batch.objectOffset = batch.material->GetVariableHandle("objectOffset");
+		it = m_indirectBatches.insert(std::make_pair(key, batch)).first;
+	}
+
+	m_indirectObjects.push_back({ &it->second, object, material });
+	return true;
+}
+
+VkResult WObjectsRenderFragment::_ReserveBuffer(WBufferedBuffer* buffer, uint32_t* capacity, uint32_t count, size_t elementSize,
+												 uint32_t numBuffers, VkBufferUsageFlags usage, W_MEMORY_STORAGE memory) {
+	if (count <= *capacity)
+		return VK_SUCCESS;
+
+	uint32_t newCapacity = std::max(count, *capacity * 2);
+	VkResult result = buffer->Create(m_app, numBuffers, newCapacity * elementSize, usage, nullptr, memory);
+	*capacity = result == VK_SUCCESS ? newCapacity : 0;
+	return result;
+}
+
+uint32_t WObjectsRenderFragment::_GetVisibilitySlot(WObject* object) {
+	auto it = m_visibilitySlots.find(object);
+	if (it != m_visibilitySlots.end())
+		return it->second;
+
+	uint32_t slot;
+	if (m_freeVisibilitySlots.size() > 0) {
+		slot = m_freeVisibilitySlots.back();
+		m_freeVisibilitySlots.pop_back();
+	} else
+		slot = m_numVisibilitySlots++;
+	m_visibilitySlots.insert(std::make_pair(object, slot));
+	return slot;
+}
+
+void WObjectsRenderFragment::_ReadCullingStats(uint32_t bufferIndex) {
+	if (bufferIndex >= m_cullingStatsPending.size() || !m_cullingStatsPending[bufferIndex])
+		return;
+
+	// the frame that last used this index is done (its fence was waited on)
+	W_OCCLUSION_CULLING_STATS* stats;
+	if (m_cullingStats.Map(m_app, bufferIndex, (void**)&stats, W_MAP_READ) == VK_SUCCESS) {
+		m_lastCullingStats = *stats;
+		m_cullingStats.Unmap(m_app, bufferIndex);
+	}
+	m_cullingStatsPending[bufferIndex] = false;
+}
+
+WError WObjectsRenderFragment::_PrepareIndirectDraws(bool frustumCulling, bool occlusionCulling) {
+	uint32_t bufferIndex = m_app->GetCurrentBufferingIndex();
+	_ReadCullingStats(bufferIndex);
+
+	for (auto& it : m_indirectBatches)
+		it.second.numObjects = 0;
+	for (auto& indirectObject : m_indirectObjects)
+		indirectObject.batch->numObjects++;
+
+	// lay the batches out one after the other in the object data and release
+	// the ones that have been unused for a while
+	uint32_t numObjects = 0;
+	uint32_t numCommands = 0;
+	for (auto it = m_indirectBatches.begin(); it != m_indirectBatches.end();) {
+		INDIRECT_BATCH& batch = it->second;
+		if (batch.numObjects == 0) {
+			if (++batch.unusedFrames > INDIRECT_BATCH_LIFETIME) {
+				W_SAFE_REMOVEREF(batch.material);
+				it = m_indirectBatches.erase(it);
+			} else
+				it++;
+			continue;
+		}
+		batch.unusedFrames = 0;
+		batch.firstObject = numObjects;
+		batch.command = numCommands++;
+		numObjects += batch.numObjects;
+		it++;
+	}
+	m_numIndirectObjects = numObjects;
+	m_numIndirectCommands = numCommands;
+	if (numObjects == 0)
+		return WError(W_SUCCEEDED);
+
+	// with occlusion culling, the draw list and the commands hold both phases
+	bool gpuCulling = frustumCulling || occlusionCulling;
+	uint32_t numPhases = occlusionCulling ? 2 : 1;
+	uint32_t numBuffers = m_app->GetEngineParam<uint32_t>("bufferingCount");
+	if (_ReserveBuffer(&m_objectData, &m_objectDataCapacity, numObjects, m_objectDataStride, numBuffers,
+					   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, W_MEMORY_HOST_VISIBLE) != VK_SUCCESS ||
+		_ReserveBuffer(&m_drawList, &m_drawListCapacity, numObjects * numPhases, sizeof(uint32_t), numBuffers,
+					   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, W_MEMORY_HOST_VISIBLE) != VK_SUCCESS ||
+		_ReserveBuffer(&m_indirectCommands, &m_indirectCommandsCapacity, numCommands * numPhases, sizeof(VkDrawIndexedIndirectCommand), numBuffers,
+					   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, W_MEMORY_HOST_VISIBLE) != VK_SUCCESS)
+		return WError(W_OUTOFMEMORY);
+	if (gpuCulling &&
+		(_ReserveBuffer(&m_cullData, &m_cullDataCapacity, numObjects, sizeof(CULL_DATA), numBuffers,
+						VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, W_MEMORY_HOST_VISIBLE) != VK_SUCCESS ||
+		 _ReserveBuffer(&m_drawCounts, &m_drawCountsCapacity, numCommands * numPhases, sizeof(uint32_t), numBuffers,
+						VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, W_MEMORY_HOST_VISIBLE) != VK_SUCCESS))
+		return WError(W_OUTOFMEMORY);
+
+	// copy the objects' data into their batches' ranges (numObjects is used
+	// to count the objects written). Without GPU culling every object is
+	// drawn, so the draw list maps the instances to their own data
+	char* objectData;
+	uint32_t* drawList;
+	CULL_DATA* cullData = nullptr;
+	if (m_objectData.Map(m_app, bufferIndex, (void**)&objectData, W_MAP_WRITE) != VK_SUCCESS)
+		return WError(W_UNABLETOMAPBUFFER);
+	if (m_drawList.Map(m_app, bufferIndex, (void**)&drawList, W_MAP_WRITE) != VK_SUCCESS) {
+		m_objectData.Unmap(m_app, bufferIndex);
+		return WError(W_UNABLETOMAPBUFFER);
+	}
+	if (gpuCulling && m_cullData.Map(m_app, bufferIndex, (void**)&cullData, W_MAP_WRITE) != VK_SUCCESS) {
+		m_drawList.Unmap(m_app, bufferIndex);
+		m_objectData.Unmap(m_app, bufferIndex);
+		return WError(W_UNABLETOMAPBUFFER);
+	}
+	for (auto& it : m_indirectBatches)
+		it.second.numObjects = 0;
+	for (auto& indirectObject : m_indirectObjects) {
+		INDIRECT_BATCH* batch = indirectObject.batch;
+		uint32_t objectIndex = batch->firstObject + batch->numObjects++;
+		char* data = objectData + objectIndex * m_objectDataStride;
+		size_t uboSize;
+		const void* ubo = indirectObject.material->GetUniformBufferData(m_objectUBOBinding, &uboSize);
+		memcpy(data, ubo, uboSize);
+		WMatrix worldMatrix = indirectObject.object->GetWorldMatrix();
+		memcpy(data + m_worldMatrixOffset, &worldMatrix, sizeof(WMatrix));
+
+		if (!cullData) {
+			drawList[objectIndex] = objectIndex;
+			continue;
+		}
+		WVector3 center, extent;
+		indirectObject.object->GetWorldBoundingBox(&center, &extent);
+		CULL_DATA& object = cullData[objectIndex];
+		object.boundsMin[0] = center.x - extent.x;
+		object.boundsMin[1] = center.y - extent.y;
+		object.boundsMin[2] = center.z - extent.z;
+		object.boundsMin[3] = 1.0f;
+		object.boundsMax[0] = center.x + extent.x;
+		object.boundsMax[1] = center.y + extent.y;
+		object.boundsMax[2] = center.z + extent.z;
+		object.boundsMax[3] = 1.0f;
+		object.command = batch->command;
+		object.firstObject = batch->firstObject;
+		object.slot = occlusionCulling ? _GetVisibilitySlot(indirectObject.object) : 0;
+		object.flags = indirectObject.object->IsFrustumCullingEnabled() ? 0 : CULL_FLAG_NO_FRUSTUM_CULLING;
+	}
+	if (cullData)
+		m_cullData.Unmap(m_app, bufferIndex);
+	m_drawList.Unmap(m_app, bufferIndex);
+	m_objectData.Unmap(m_app, bufferIndex);
+
+	if (occlusionCulling && m_numVisibilitySlots > m_visibilityCapacity) {
+		// the visibility lives on the GPU across frames, so it is a single
+		// buffer. Re-creating it forgets the visibility of the previous frame,
+		// every object is then tested (and drawn late if visible) in the
+		// second phase
+		uint32_t capacity = std::max(m_numVisibilitySlots, m_visibilityCapacity * 2);
+		std::vector<uint32_t> visibility(capacity, 0);
+		VkResult result = m_visibility.Create(m_app, 1, capacity * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, visibility.data());
+		if (result != VK_SUCCESS) {
+			m_visibilityCapacity = 0;
+			return WError(W_OUTOFMEMORY);
+		}
+		m_visibilityCapacity = capacity;
+	}
+
+	// one command per batch (and phase), drawing the objects of the batch as
+	// instances. With GPU culling, the cull shader adds the instances
+	VkDrawIndexedIndirectCommand* commands;
+	if (m_indirectCommands.Map(m_app, bufferIndex, (void**)&commands, W_MAP_WRITE) != VK_SUCCESS)
+		return WError(W_UNABLETOMAPBUFFER);
+	for (auto& it : m_indirectBatches) {
+		INDIRECT_BATCH& batch = it.second;
+		if (batch.numObjects == 0)
+			continue;
+		for (uint32_t phase = 0; phase < numPhases; phase++) {
+			VkDrawIndexedIndirectCommand& command = commands[phase * numCommands + batch.command];
+			command.indexCount = it.first.geometry->GetNumIndices();
+			command.instanceCount = gpuCulling ? 0 : batch.numObjects;
+			command.firstIndex = 0;
+			command.vertexOffset = 0;
+			command.firstInstance = 0;
+		}
+
+		batch.material->UpdateResources();
+	}
+	m_indirectCommands.Unmap(m_app, bufferIndex);
+	m_indirectEffect->UpdatePerFrameMaterials();
+
+	// the cull shader sets the count of the commands it adds instances to, so
+	// the empty batches are not drawn at all
+	if (gpuCulling) {
+		uint32_t* drawCounts;
+		if (m_drawCounts.Map(m_app, bufferIndex, (void**)&drawCounts, W_MAP_WRITE) != VK_SUCCESS)
+			return WError(W_UNABLETOMAPBUFFER);
+		memset(drawCounts, 0, numCommands * numPhases * sizeof(uint32_t));
+		m_drawCounts.Unmap(m_app, bufferIndex);
+	}
+	m_frustumCulling = frustumCulling && !occlusionCulling;
+
+	if (occlusionCulling) {
+		W_OCCLUSION_CULLING_STATS* stats;
+		if (m_cullingStats.Map(m_app, bufferIndex, (void**)&stats, W_MAP_WRITE) != VK_SUCCESS)
+			return WError(W_UNABLETOMAPBUFFER);
+		*stats = {};
+		m_cullingStats.Unmap(m_app, bufferIndex);
+		m_cullingStatsPending[bufferIndex] = true;
+		m_occlusionCulling = true;
+	}
+
+	return WError(W_SUCCEEDED);
+}
+
+void WObjectsRenderFragment::_RecordIndirectDraws(WRenderTarget* rt, uint32_t phase) {
+	if (m_numIndirectObjects == 0)
+		return;
+
+	uint32_t bufferIndex = m_app->GetCurrentBufferingIndex();
+	VkBuffer commands = m_indirectCommands.GetBuffer(m_app, bufferIndex);
+	VkBuffer counts = m_frustumCulling || m_occlusionCulling ? m_drawCounts.GetBuffer(m_app, bufferIndex) : VK_NULL_HANDLE;
+	m_indirectEffect->Bind(rt);
+	for (auto& it : m_indirectBatches) {
+		INDIRECT_BATCH& batch = it.second;
+		if (batch.numObjects == 0)
+			continue;
+		batch.material->SetVariable<uint32_t>(batch.objectOffset, phase * m_numIndirectObjects + batch.firstObject);
+		batch.material->Bind(rt);
+		uint32_t command = phase * m_numIndirectCommands + batch.command;
+		it.first.geometry->DrawIndirect(rt, commands, command * sizeof(VkDrawIndexedIndirectCommand), 1, counts, command * sizeof(uint32_t));
+	}
+}
+
+WError WObjectsRenderFragment::RecordCulling(WRenderTarget* rt, VkCommandBuffer cmdBuffer) {
+	WCamera* cam = rt->GetCamera();
+	bool frustumCulling = m_frustumCullMaterial && m_frustumCuller->Valid() && m_app->GetEngineParam<bool>("gpuFrustumCulling");
+	bool occlusionCulling = m_cullMaterial && m_occlusionCuller->Valid() && m_app->GetEngineParam<bool>("occlusionCulling");
+	if (!cam || (!frustumCulling && !occlusionCulling))
+		return WError(W_SUCCEEDED);
+
+	// the camera is updated for the render target when its render pass
+	// begins, which is after this
+	cam->Render(rt->GetWidth(), rt->GetHeight());
+
+	WError err = _PrepareFrame(rt, true);
+	if (!err)
+		return err;
+	m_framePrepared = true;
+	if (m_frustumCulling)
+		return _RecordFrustumCulling(cmdBuffer, cam);
+	if (!m_occlusionCulling)
+		return WError(W_SUCCEEDED);
+
+	// the pyramid and the matrices are set once for both phases, since the
+	// material's resources can't change after it is bound this frame
+	err = m_occlusionCuller->SetPyramidResources(m_cullMaterial);
+	if (!err)
+		return err;
+	m_cullMaterial->SetVariable<WMatrix>("viewMatrix", cam->GetViewMatrix());
+	m_cullMaterial->SetVariable<WMatrix>("projectionMatrix", cam->GetProjectionMatrix());
+	m_cullMaterial->SetVariableArray<WPlane>("frustumPlanes", const_cast<WPlane*>(cam->GetFrustumPlanes()), 6);
+
+	return _RecordOcclusionCulling(cmdBuffer, 0);
+}
+
+WError WObjectsRenderFragment::_RecordFrustumCulling(VkCommandBuffer cmdBuffer, WCamera* cam) {
+	m_frustumCullMaterial->SetVariableArray<WPlane>("frustumPlanes", const_cast<WPlane*>(cam->GetFrustumPlanes()), 6);
+	m_frustumCullMaterial->SetVariable<uint32_t>("numObjects", m_numIndirectObjects);
+
+	// the last frame's draws must be done with the buffers
+	WEffect::ComputeBarrier(cmdBuffer);
+
+	WEffect* cullFX = m_frustumCuller->GetCullEffect();
+	WError err = cullFX->Bind(cmdBuffer);
+	if (!err)
+		return err;
+	err = m_frustumCullMaterial->Bind(cmdBuffer);
+	if (!err)
+		return err;
+	err = cullFX->Dispatch(cmdBuffer, (m_numIndirectObjects + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE);
+	if (!err)
+		return err;
+
+	// the draws read the commands, the counts and the draw list
+	WEffect::ComputeBarrier(cmdBuffer,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+
+	return WError(W_SUCCEEDED);
+}
+
+WError WObjectsRenderFragment::_RecordOcclusionCulling(VkCommandBuffer cmdBuffer, uint32_t phase) {
+	m_cullMaterial->SetVariable<uint32_t>("phase", phase);
+	m_cullMaterial->SetVariable<uint32_t>("numObjects", m_numIndirectObjects);
+	m_cullMaterial->SetVariable<uint32_t>("numCommands", m_numIndirectCommands);
+
+	// the previous use of the buffers (the last frame's draws, or the first
+	// phase) must be done with them
+	WEffect::ComputeBarrier(cmdBuffer);
+
+	WEffect* cullFX = m_occlusionCuller->GetCullEffect();
+	WError err = cullFX->Bind(cmdBuffer);
+	if (!err)
+		return err;
+	err = m_cullMaterial->Bind(cmdBuffer);
+	if (!err)
+		return err;
+	err = cullFX->Dispatch(cmdBuffer, (m_numIndirectObjects + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE);
+	if (!err)
+		return err;
+
+	// the draws read the commands and the draw list, the CPU reads the stats
+	WEffect::ComputeBarrier(cmdBuffer,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT);
+
+	return WError(W_SUCCEEDED);
+}
+
+WError WObjectsRenderFragment::_RecordLateIndirectDraws(WRenderer* renderer, WRenderTarget* rt) {
+	WError err = rt->End(false);
+	if (!err)
+		return err;
+
+	VkCommandBuffer cmdBuffer = renderer->GetCurrentPrimaryCommandBuffer();
+	err = m_occlusionCuller->BuildPyramid(cmdBuffer);
+	if (err)
+		err = _RecordOcclusionCulling(cmdBuffer, 1);
+
+	// the render pass is resumed regardless, its owner ends it
+	WError beginErr = rt->Begin(false);
+	if (!err)
+		return err;
+	if (!beginErr)
+		return beginErr;
+
+	_RecordIndirectDraws(rt, 1);
+
+	return WError(W_SUCCEEDED);
+}
@@ -0,0 +1,424 @@
+#include "Wasabi/Renderers/Common/WSoftwareOcclusionCuller.hpp"
+#include "Wasabi/Core/WJobSystem.hpp"
+#include "Wasabi/Core/WSIMD.hpp"
+#include "Wasabi/Geometries/WGeometry.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <cstring>
+
+namespace {
+	/** Minimum number of triangles set up per chunk of the job system */
+	const uint32_t MIN_TRIANGLES_PER_CHUNK = 256;
+	/** Vertices with a w below this are behind the eye */
+	const float MIN_W = 1e-6f;
+	/** Bound of the edges that don't limit a side of a triangle's spans */
+	const float NO_BOUND = 1e30f;
+
+#if defined(W_SIMD_SSE)
+	typedef __m128 VEC;
+	inline VEC Load(const float* p) { return _mm_loadu_ps(p); }
+	inline VEC Splat(float f) { return _mm_set1_ps(f); }
+	inline VEC Add(VEC a, VEC b) { return _mm_add_ps(a, b); }
+	inline VEC Mul(VEC a, VEC b) { return _mm_mul_ps(a, b); }
+	inline VEC Max(VEC a, VEC b) { return _mm_max_ps(a, b); }
+	inline VEC Min(VEC a, VEC b) { return _mm_min_ps(a, b); }
+	inline void Store(float* p, VEC v) { _mm_storeu_ps(p, v); }
+#elif defined(W_SIMD_NEON)
+	typedef float32x4_t VEC;
+	inline VEC Load(const float* p) { return vld1q_f32(p); }
+	inline VEC Splat(float f) { return vdupq_n_f32(f); }
+	inline VEC Add(VEC a, VEC b) { return vaddq_f32(a, b); }
+	inline VEC Mul(VEC a, VEC b) { return vmulq_f32(a, b); }
+	inline VEC Max(VEC a, VEC b) { return vmaxq_f32(a, b); }
+	inline VEC Min(VEC a, VEC b) { return vminq_f32(a, b); }
+	inline void Store(float* p, VEC v) { vst1q_f32(p, v); }
+#endif
+
+	/**
+	 * Computes the left (max of the low edges) and right (min of the high
+	 * edges) x of a triangle's span at every y of rows, clamped to
+	 * [minX, maxX].
+	 */
+	template<uint32_t NUM_ROWS>
+	void ComputeSpans(const float* lowK, const float* lowM, const float* highK, const float* highM,
+					  const float* rows, float minX, float maxX, float* left, float* right) {
+		uint32_t i = 0;
+#if defined(W_SIMD_SSE) || defined(W_SIMD_NEON)
+		for (; i + 4 <= NUM_ROWS; i += 4) {
+			VEC y = Load(rows + i);
+			VEC l = Splat(minX), r = Splat(maxX);
+			for (uint32_t e = 0; e < 3; e++) {
+				l = Max(l, Add(Mul(Splat(lowK[e]), y), Splat(lowM[e])));
+				r = Min(r, Add(Mul(Splat(highK[e]), y), Splat(highM[e])));
+			}
+			Store(left + i, l);
+			Store(right + i, r);
+		}
+#endif
+
+		for (; i < NUM_ROWS; i++) {
+			float l = minX, r = maxX;
+			for (uint32_t e = 0; e < 3; e++) {
+				l = std::max(l, lowK[e] * rows[i] + lowM[e]);
+				r = std::min(r, highK[e] * rows[i] + highM[e]);
+			}
+			left[i] = l;
+			right[i] = r;
+		}
+	}
+
+	/** Mask with the bits [first, last] set, relative to bit offset */
+	inline uint32_t SpanMask(int first, int last, int offset) {
+		first = std::max(first, offset);
+		last = std::min(last, offset + 31);
+		if (first > last)
+			return 0;
+		uint32_t count = (uint32_t)(last - first + 1);
+		return (count == 32 ? ~0u : (1u << count) - 1) << (first - offset);
+	}
+};
+
+WSoftwareOcclusionCuller::WSoftwareOcclusionCuller(WJobSystem* jobSystem) {
+	m_jobSystem = jobSystem;
+	m_width = m_height = 0;
+	m_tilesX = m_tilesY = 0;
+	SetResolution(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+}
+
+WSoftwareOcclusionCuller::~WSoftwareOcclusionCuller() {
+}
+
+void WSoftwareOcclusionCuller::SetResolution(uint32_t width, uint32_t height) {
+	m_tilesX = std::max((width + TILE_WIDTH - 1) / TILE_WIDTH, 1u);
+	m_tilesY = std::max((height + TILE_HEIGHT - 1) / TILE_HEIGHT, 1u);
+	m_width = m_tilesX * TILE_WIDTH;
+	m_height = m_tilesY * TILE_HEIGHT;
+	m_tiles.resize(m_tilesX * m_tilesY);
+	_Clear();
+}
+
+uint32_t WSoftwareOcclusionCuller::GetWidth() const {
+	return m_width;
+}
+
+uint32_t WSoftwareOcclusionCuller::GetHeight() const {
+	return m_height;
+}
+
+void WSoftwareOcclusionCuller::_Clear() {
+	for (auto& tile : m_tiles) {
+		memset(tile.mask, 0, sizeof(tile.mask));
+		tile.zMax0 = 1.0f;
+		tile.zMax1 = 0.0f;
+	}
+}
+
+void WSoftwareOcclusionCuller::BeginFrame(const WMatrix& viewProjection) {
+	m_viewProjection = viewProjection;
+	m_vertices.clear();
+	m_indices.clear();
+	_Clear();
+}
+
+void WSoftwareOcclusionCuller::AddOccluder(const WVector3* positions, size_t stride, uint32_t numVertices,
+										   const uint32_t* indices, uint32_t numIndices, const WMatrix& worldMatrix) {
+	uint32_t firstVertex = (uint32_t)m_vertices.size();
+	m_vertices.resize(firstVertex + numVertices);
+	for (uint32_t i = 0; i < numVertices; i++) {
+		const WVector3* position = (const WVector3*)((const char*)positions + i * stride);
+		m_vertices[firstVertex + i] = WVector4(position->x, position->y, position->z, 1.0f);
+	}
+	WVec4TransformArray(m_vertices.data() + firstVertex, m_vertices.data() + firstVertex, numVertices, worldMatrix * m_viewProjection);
+
+	// triangles with indices out of the vertices are dropped
+	for (uint32_t i = 0; i + 3 <= numIndices; i += 3) {
+		if (indices[i] >= numVertices || indices[i + 1] >= numVertices || indices[i + 2] >= numVertices)
+			continue;
+		m_indices.push_back(firstVertex + indices[i]);
+		m_indices.push_back(firstVertex + indices[i + 1]);
+		m_indices.push_back(firstVertex + indices[i + 2]);
+	}
+}
+
+WError WSoftwareOcclusionCuller::AddOccluder(WGeometry* geometry, const WMatrix& worldMatrix) {
+	if (!geometry || !geometry->Valid())
+		return WError(W_INVALIDPARAM);
+
+	W_VERTEX_DESCRIPTION vertexDesc = geometry->GetVertexDescription(0);
+	uint32_t positionIndex = vertexDesc.GetIndex("position");
+	if (positionIndex == std::numeric_limits<uint32_t>::max() || vertexDesc.attributes[positionIndex].numComponents < 3)
+		return WError(W_INVALIDPARAM);
+
+	void* vb;
+	uint32_t* ib;
+	WError err = geometry->MapVertexBuffer(&vb, W_MAP_READ);
+	if (!err)
+		return err;
+	err = geometry->MapIndexBuffer((void**)&ib, W_MAP_READ);
+	if (!err) {
+		geometry->UnmapVertexBuffer(false);
+		return err;
+	}
+
+	AddOccluder((const WVector3*)((const char*)vb + vertexDesc.GetOffset(positionIndex)), vertexDesc.GetSize(),
+				geometry->GetNumVertices(), ib, geometry->GetNumIndices(), worldMatrix);
+
+	geometry->UnmapIndexBuffer();
+	geometry->UnmapVertexBuffer(false);
+
+	return WError(W_SUCCEEDED);
+}
+
+void WSoftwareOcclusionCuller::Rasterize() {
+	uint32_t numTriangles = (uint32_t)m_indices.size() / 3;
+	m_triangles.resize(numTriangles * 2);
+
+	auto setup = [this](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++)
+			_SetupTriangle(i);
+	};
+	auto rasterize = [this](uint32_t begin, uint32_t end) {
+		for (uint32_t row = begin; row < end; row++)
+			_RasterizeTileRow(row);
+	};
+	if (m_jobSystem) {
+		m_jobSystem->ParallelFor(numTriangles, MIN_TRIANGLES_PER_CHUNK, setup);
+		m_jobSystem->ParallelFor(m_tilesY, 1, rasterize);
+	} else {
+		setup(0, numTriangles);
+		rasterize(0, m_tilesY);
+	}
+}
+
+void WSoftwareOcclusionCuller::_SetupTriangle(uint32_t triangle) {
+	TRIANGLE* out = &m_triangles[triangle * 2];
+	out[0].valid = out[1].valid = false;
+
+	// clip the triangle against the near plane (z = 0), which leaves a
+	// polygon of up to 4 vertices
+	WVector4 polygon[4];
+	uint32_t numVertices = 0;
+	for (uint32_t i = 0; i < 3; i++) {
+		const WVector4& a = m_vertices[m_indices[triangle * 3 + i]];
+		const WVector4& b = m_vertices[m_indices[triangle * 3 + (i + 1) % 3]];
+		if (a.z >= 0.0f)
+			polygon[numVertices++] = a;
+		if ((a.z >= 0.0f) != (b.z >= 0.0f)) {
+			float t = a.z / (a.z - b.z);
+			polygon[numVertices++] = WVector4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t);
+		}
+	}
+	if (numVertices < 3)
+		return;
+
+	WVector3 screen[4];
+	for (uint32_t i = 0; i < numVertices; i++) {
+		if (!(polygon[i].w > MIN_W))
+			return;
+		float invW = 1.0f / polygon[i].w;
+		screen[i] = WVector3(
+			(polygon[i].x * invW * 0.5f + 0.5f) * (float)m_width,
+			(polygon[i].y * invW * 0.5f + 0.5f) * (float)m_height,
+			polygon[i].z * invW
+		);
+	}
+	_SetupScreenTriangle(screen[0], screen[1], screen[2], &out[0]);
+	if (numVertices == 4)
+		_SetupScreenTriangle(screen[0], screen[2], screen[3], &out[1]);
+}
+
+void WSoftwareOcclusionCuller::_SetupScreenTriangle(const WVector3& v0, const WVector3& v1, const WVector3& v2, TRIANGLE* out) const {
+	out->valid = false;
+
+	float area2 = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+	if (!(std::abs(area2) > 1e-8f))
+		return;
+
+	out->minX = std::min(std::min(v0.x, v1.x), v2.x);
+	out->maxX = std::max(std::max(v0.x, v1.x), v2.x);
+	out->minY = std::min(std::min(v0.y, v1.y), v2.y);
+	out->maxY = std::max(std::max(v0.y, v1.y), v2.y);
+	if (out->maxX < 0.0f || out->minX > (float)m_width || out->maxY < 0.0f || out->minY > (float)m_height)
+		return;
+
+	// every edge bounds the spans of the triangle from the left or from the
+	// right, depending on the side of the edge the triangle lies on. The rows
+	// are limited to the triangle's height, which takes care of the
+	// horizontal edges
+	const WVector3* v[3] = { &v0, &v1, &v2 };
+	float sign = area2 > 0.0f ? 1.0f : -1.0f;
+	for (uint32_t i = 0; i < 3; i++) {
+		const WVector3& p = *v[i];
+		const WVector3& q = *v[(i + 1) % 3];
+		// the triangle is where a * x + b * y + c >= 0
+		float a = (p.y - q.y) * sign;
+		float b = (q.x - p.x) * sign;
+		float c = (p.x * q.y - q.x * p.y) * sign;
+		out->lowK[i] = out->highK[i] = 0.0f;
+		out->lowM[i] = -NO_BOUND;
+		out->highM[i] = NO_BOUND;
+		if (a > 0.0f) {
+			out->lowK[i] = -b / a;
+			out->lowM[i] = -c / a;
+		} else if (a < 0.0f) {
+			out->highK[i] = -b / a;
+			out->highM[i] = -c / a;
+		}
+	}
+
+	out->zA = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area2;
+	out->zB = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area2;
+	out->zC = v0.z - out->zA * v0.x - out->zB * v0.y;
+	out->zMax = std::max(std::max(v0.z, v1.z), v2.z);
+	out->valid = true;
+}
+
+void WSoftwareOcclusionCuller::_RasterizeTileRow(uint32_t tileRow) {
+	float rowsY0 = (float)(tileRow * TILE_HEIGHT);
+	float rowsY1 = rowsY0 + (float)TILE_HEIGHT;
+	float rowCenters[TILE_HEIGHT];
+	for (uint32_t i = 0; i < TILE_HEIGHT; i++)
+		rowCenters[i] = rowsY0 + (float)i + 0.5f;
+	TILE* tiles = &m_tiles[tileRow * m_tilesX];
+
+	// the triangles are merged in the order they were added, which keeps the
+	// result independent of how the rows are split between threads
+	for (const auto& triangle : m_triangles) {
+		if (!triangle.valid || triangle.maxY < rowsY0 || triangle.minY >= rowsY1)
+			continue;
+
+		// a pixel is covered if its center is in the triangle
+		float left[TILE_HEIGHT], right[TILE_HEIGHT];
+		ComputeSpans<TILE_HEIGHT>(triangle.lowK, triangle.lowM, triangle.highK, triangle.highM,
+								  rowCenters, -1.0f, (float)m_width + 1.0f, left, right);
+		int first[TILE_HEIGHT], last[TILE_HEIGHT];
+		int minPixel = (int)m_width, maxPixel = -1;
+		for (uint32_t i = 0; i < TILE_HEIGHT; i++) {
+			first[i] = 0;
+			last[i] = -1;
+			if (rowCenters[i] < triangle.minY || rowCenters[i] > triangle.maxY)
+				continue;
+			first[i] = std::max((int)std::ceil(left[i] - 0.5f), 0);
+			last[i] = std::min((int)std::ceil(right[i] - 0.5f) - 1, (int)m_width - 1);
+			if (first[i] <= last[i]) {
+				minPixel = std::min(minPixel, first[i]);
+				maxPixel = std::max(maxPixel, last[i]);
+			}
+		}
+		if (minPixel > maxPixel)
+			continue;
+
+		for (uint32_t tileX = (uint32_t)minPixel / TILE_WIDTH; tileX <= (uint32_t)maxPixel / TILE_WIDTH; tileX++) {
+			int tileX0 = (int)(tileX * TILE_WIDTH);
+			uint32_t coverage[TILE_HEIGHT];
+			uint32_t anyCoverage = 0;
+			for (uint32_t i = 0; i < TILE_HEIGHT; i++) {
+				coverage[i] = SpanMask(first[i], last[i], tileX0);
+				anyCoverage |= coverage[i];
+			}
+			if (!anyCoverage)
+				continue;
+
+			// the depth is linear over the part of the tile that the triangle
+			// covers, so its farthest point is one of that part's corners
+			float x0 = std::max((float)tileX0, triangle.minX);
+			float x1 = std::min((float)(tileX0 + (int)TILE_WIDTH), triangle.maxX);
+			float y0 = std::max(rowsY0, triangle.minY);
+			float y1 = std::min(rowsY1, triangle.maxY);
+			float zTri = triangle.zC + std::max(triangle.zA * x0, triangle.zA * x1) + std::max(triangle.zB * y0, triangle.zB * y1);
+			_MergeIntoTile(tiles[tileX], coverage, std::min(zTri, triangle.zMax));
+		}
+	}
+}
+
+void WSoftwareOcclusionCuller::_MergeIntoTile(TILE& tile, const uint32_t* coverage, float zTri) {
+	// a triangle behind the whole tile can't bring it closer
+	if (zTri >= tile.zMax0)
+		return;
+
+	// the working layer is dropped if the triangle is closer to the tile's
+	// depth than to the working layer, merging it would push the working
+	// layer too far back to be useful
+	if (zTri - tile.zMax1 > tile.zMax0 - zTri) {
+		memset(tile.mask, 0, sizeof(tile.mask));
+		tile.zMax1 = 0.0f;
+	}
+
+	uint32_t fullMask = ~0u;
+	for (uint32_t i = 0; i < TILE_HEIGHT; i++) {
+		tile.mask[i] |= coverage[i];
+		fullMask &= tile.mask[i];
+	}
+	tile.zMax1 = std::max(tile.zMax1, zTri);
+
+	// once the working layer covers the tile, it becomes the tile's depth
+	if (fullMask == ~0u) {
+		tile.zMax0 = std::min(tile.zMax0, tile.zMax1);
+		memset(tile.mask, 0, sizeof(tile.mask));
+		tile.zMax1 = 0.0f;
+	}
+}
+
+bool WSoftwareOcclusionCuller::IsBoxOccluded(const WVector3& min, const WVector3& max) const {
+	WVector4 corners[8];
+	for (uint32_t i = 0; i < 8; i++)
+		corners[i] = WVector4(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z, 1.0f);
+	WVec4TransformArray(corners, corners, 8, m_viewProjection);
+
+	float minX = std::numeric_limits<float>::max(), minY = minX, zMin = minX;
+	float maxX = -minX, maxY = -minX;
+	for (uint32_t i = 0; i < 8; i++) {
+		// boxes that cross the near plane are never occluded
+		if (!(corners[i].w > MIN_W) || corners[i].z < 0.0f)
+			return false;
+		float invW = 1.0f / corners[i].w;
+		float x = (corners[i].x * invW * 0.5f + 0.5f) * (float)m_width;
+		float y = (corners[i].y * invW * 0.5f + 0.5f) * (float)m_height;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		zMin = std::min(zMin, corners[i].z * invW);
+	}
+	if (maxX < 0.0f || minX >= (float)m_width || maxY < 0.0f || minY >= (float)m_height)
+		return false; // outside the view, that is left to the frustum test
+
+	// every pixel the box's rectangle touches must be behind the occluders
+	int pixelX0 = std::max((int)std::floor(minX), 0);
+	int pixelX1 = std::min((int)std::floor(maxX), (int)m_width - 1);
+	int pixelY0 = std::max((int)std::floor(minY), 0);
+	int pixelY1 = std::min((int)std::floor(maxY), (int)m_height - 1);
+	for (uint32_t tileY = (uint32_t)pixelY0 / TILE_HEIGHT; tileY <= (uint32_t)pixelY1 / TILE_HEIGHT; tileY++) {
+		for (uint32_t tileX = (uint32_t)pixelX0 / TILE_WIDTH; tileX <= (uint32_t)pixelX1 / TILE_WIDTH; tileX++) {
+			const TILE& tile = m_tiles[tileY * m_tilesX + tileX];
+			if (zMin > tile.zMax0)
+				continue;
+			if (zMin <= tile.zMax1)
+				return false;
+			// the box is only behind the working layer where the mask is set
+			uint32_t rowMask = SpanMask(pixelX0, pixelX1, (int)(tileX * TILE_WIDTH));
+			for (uint32_t i = 0; i < TILE_HEIGHT; i++) {
+				int y = (int)(tileY * TILE_HEIGHT + i);
+				if (y >= pixelY0 && y <= pixelY1 && (rowMask & ~tile.mask[i]))
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+float WSoftwareOcclusionCuller::GetDepth(uint32_t x, uint32_t y) const {
+	if (x >= m_width || y >= m_height)
+		return 1.0f;
+
+	const TILE& tile = m_tiles[(y / TILE_HEIGHT) * m_tilesX + x / TILE_WIDTH];
+	if (tile.mask[y % TILE_HEIGHT] & (1u << (x % TILE_WIDTH)))
+		return std::min(tile.zMax0, tile.zMax1);
+	return tile.zMax0;
+}
+
+uint32_t WSoftwareOcclusionCuller::GetNumOccluderTriangles() const {
+	return (uint32_t)m_indices.size() / 3;
+}
@@ -0,0 +1,37 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "../../Common/Shaders/utils.glsl"
+
+struct ObjectData {
+	mat4 worldMatrix;
+	vec4 color;
+	float specularPower;
+	float specularIntensity;
+	int isInstanced;
+	int isTextured;
+};
+
+layout(set = 0, binding = 6) readonly buffer SBO {
+	ObjectData objects[];
+} objectData;
+
+layout(set = 0, binding = 4) uniform sampler2D diffuseTexture[8];
+
+layout(location = 0) in vec2 inUV;
+layout(location = 1) in vec3 inViewPos;
+layout(location = 2) in vec3 inViewNorm;
+layout(location = 3) flat in uint inTexIndex;
+layout(location = 4) flat in uint inObjectIndex;
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec4 outNormals;
+
+void main() {
+	ObjectData object = objectData.objects[inObjectIndex];
+	outColor = texture(diffuseTexture[inTexIndex], inUV) * object.isTextured + object.color;
+    outNormals.rg = WasabiPackNormalSpheremapTransform(inViewNorm);
+	outNormals.ba = vec2(object.specularPower, object.specularIntensity);
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+#extension GL_GOOGLE_include_directive : enable
+
+layout(location = 0) in vec3 inPos;
+layout(location = 1) in vec3 inTang;
+layout(location = 2) in vec3 inNorm;
+layout(location = 3) in vec2 inUV;
+layout(location = 4) in uint inTexIndex;
+
+struct ObjectData {
+	mat4 worldMatrix;
+	vec4 color;
+	float specularPower;
+	float specularIntensity;
+	int isInstanced;
+	int isTextured;
+};
+
+layout(set = 0, binding = 6) readonly buffer SBO {
+	ObjectData objects[];
+} objectData;
+
+layout(set = 0, binding = 7) readonly buffer DrawListSBO {
+	uint indices[];
+} drawList;
+
+layout(set = 1, binding = 1) uniform UBOPerFrame {
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+} uboPerFrame;
+
+layout(push_constant) uniform PC {
+	uint objectOffset;
+} pcPerBatch;
+
+layout(location = 0) out vec2 outUV;
+layout(location = 1) out vec3 outViewPos;
+layout(location = 2) out vec3 outViewNorm;
+layout(location = 3) flat out uint outTexIndex;
+layout(location = 4) flat out uint outObjectIndex;
+
+void main() {
+	// every instance of the indirect draw is one object of the batch, the
+	// draw list holds the objects that survived culling
+	uint objectIndex = drawList.indices[pcPerBatch.objectOffset + gl_InstanceIndex];
+	mat4x4 worldMatrix = objectData.objects[objectIndex].worldMatrix;
+
+	outViewPos = (uboPerFrame.viewMatrix * worldMatrix * vec4(inPos.xyz, 1.0)).xyz;
+	outViewNorm = (uboPerFrame.viewMatrix * worldMatrix * vec4(inNorm.xyz, 0.0)).xyz;
+	outUV = inUV;
+	outTexIndex = inTexIndex;
+	outObjectIndex = objectIndex;
+	gl_Position = uboPerFrame.projectionMatrix * vec4(outViewPos, 1.0);
+}
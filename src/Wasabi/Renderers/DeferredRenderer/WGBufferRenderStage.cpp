@@ -91,6 +91,55 @@ W_SHADER_DESC WGBufferPS::GetDesc() {
 	return desc;
 }
 
+WGBufferIndirectVS::WGBufferIndirectVS(Wasabi* const app) : WShader(app) {}
+
+void WGBufferIndirectVS::Load(bool bSaveData) {
+	m_desc = GetDesc();
+	vector<uint8_t> code {
+		#include "Shaders/gbuffer-indirect.vert.glsl.spv"
+	};
+	LoadCodeSPIRV((char*)code.data(), (int)code.size(), bSaveData);
+}
+
+W_SHADER_DESC WGBufferIndirectVS::GetDesc() {
+	W_SHADER_DESC desc;
+	desc.type = W_VERTEX_SHADER;
+	desc.bound_resources = {
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_BUFFER, 6, 0, "objectData",
+			WGBufferVS::GetDesc().bound_resources[0].variables // one uboPerObject per object
+		),
+		WGBufferVS::GetDesc().bound_resources[1],
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_BUFFER, 7, 0, "drawList", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "objectIndex"), // index of the object in objectData
+		}),
+		W_BOUND_RESOURCE(W_TYPE_PUSH_CONSTANT, 0, "pcPerBatch", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "objectOffset"), // index of the batch's first object in drawList
+		}),
+	};
+	desc.input_layouts = WGBufferVS::GetDesc().input_layouts;
+	return desc;
+}
+
+WGBufferIndirectPS::WGBufferIndirectPS(Wasabi* const app) : WShader(app) {}
+
+void WGBufferIndirectPS::Load(bool bSaveData) {
+	m_desc = WGBufferIndirectPS::GetDesc();
+	vector<uint8_t> code {
+		#include "Shaders/gbuffer-indirect.frag.glsl.spv"
+	};
+	LoadCodeSPIRV((char*)code.data(), (int)code.size(), bSaveData);
+}
+
+W_SHADER_DESC WGBufferIndirectPS::GetDesc() {
+	W_SHADER_DESC desc;
+	desc.type = W_FRAGMENT_SHADER;
+	desc.bound_resources = {
+		WGBufferIndirectVS::GetDesc().bound_resources[0],
+		WGBufferPS::GetDesc().bound_resources[1],
+	};
+	return desc;
+}
+
 WGBufferRenderStage::WGBufferRenderStage(Wasabi* const app) : WRenderStage(app) {
 	m_stageDescription.name = __func__;
 	m_stageDescription.target = RENDER_STAGE_TARGET_BUFFER;
@@ -105,6 +154,9 @@ WGBufferRenderStage::WGBufferRenderStage(Wasabi* const app) : WRenderStage(app)
 	m_animatedObjectsFragment = nullptr;
 	m_perFrameMaterial = nullptr;
 	m_perFrameAnimatedMaterial = nullptr;
+	m_perFrameIndirectMaterial = nullptr;
+	m_occlusionCuller = nullptr;
+	m_frustumCuller = nullptr;
 
 	m_defaultVS = nullptr;
 	m_defaultAnimatedVS = nullptr;
@@ -175,15 +227,67 @@ WError WGBufferRenderStage::Initialize(std::vector<WRenderStage*>& previousStage
 	m_perFrameAnimatedMaterial->SetName("GBufferPerFrameAnimatedMaterial");
 	m_app->FileManager->AddDefaultAsset(m_perFrameAnimatedMaterial->GetName(), m_perFrameAnimatedMaterial);
 
-	return WError(W_SUCCEEDED);
+	WGBufferIndirectVS* indirectVS = new WGBufferIndirectVS(m_app);
+	indirectVS->SetName("GBufferDefaultIndirectVS");
+	m_app->FileManager->AddDefaultAsset(indirectVS->GetName(), indirectVS);
+	indirectVS->Load();
+
+	WGBufferIndirectPS* indirectPS = new WGBufferIndirectPS(m_app);
+	indirectPS->SetName("GBufferDefaultIndirectPS");
+	m_app->FileManager->AddDefaultAsset(indirectPS->GetName(), indirectPS);
+	indirectPS->Load();
+
+	WEffect* indirectFX = new WEffect(m_app);
+	indirectFX->SetName("GBufferDefaultIndirectEffect");
+	m_app->FileManager->AddDefaultAsset(indirectFX->GetName(), indirectFX);
+	err = indirectFX->BindShader(indirectVS);
+	if (err) {
+		err = indirectFX->BindShader(indirectPS);
+		if (err)
+			err = indirectFX->BuildPipeline(m_renderTarget);
+	}
+	W_SAFE_REMOVEREF(indirectVS);
+	W_SAFE_REMOVEREF(indirectPS);
+	if (!err) {
+		W_SAFE_REMOVEREF(indirectFX);
+		return err;
+	}
+
+	// objects using the default effect are drawn in batches by the indirect effect
+	m_objectsFragment->SetIndirectEffect(indirectFX, 0, 4);
+	W_SAFE_REMOVEREF(indirectFX);
+
+	m_perFrameIndirectMaterial = m_objectsFragment->GetIndirectEffect()->CreateMaterial(1, true);
+	if (!m_perFrameIndirectMaterial)
+		return WError(W_ERRORUNK);
+	m_perFrameIndirectMaterial->SetName("GBufferPerFrameIndirectMaterial");
+	m_app->FileManager->AddDefaultAsset(m_perFrameIndirectMaterial->GetName(), m_perFrameIndirectMaterial);
+
+	m_frustumCuller = new WFrustumCuller(m_app);
+	err = m_frustumCuller->Create();
+	if (!err)
+		return err;
+	err = m_objectsFragment->SetFrustumCuller(m_frustumCuller);
+	if (!err)
+		return err;
+
+	// the batches are occlusion culled against the depth of the G-buffer
+	m_occlusionCuller = new WHiZCuller(m_app);
+	err = m_occlusionCuller->Create(m_depthOutput);
+	if (!err)
+		return err;
+	return m_objectsFragment->SetOcclusionCuller(m_occlusionCuller);
 }
 
 void WGBufferRenderStage::Cleanup() {
 	WRenderStage::Cleanup();
 	W_SAFE_REMOVEREF(m_perFrameMaterial);
 	W_SAFE_REMOVEREF(m_perFrameAnimatedMaterial);
+	W_SAFE_REMOVEREF(m_perFrameIndirectMaterial);
 	W_SAFE_DELETE(m_objectsFragment);
 	W_SAFE_DELETE(m_animatedObjectsFragment);
+	W_SAFE_DELETE(m_occlusionCuller);
+	W_SAFE_DELETE(m_frustumCuller);
 	W_SAFE_REMOVEREF(m_defaultVS);
 	W_SAFE_REMOVEREF(m_defaultAnimatedVS);
 	W_SAFE_REMOVEREF(m_defaultPS);
@@ -199,6 +303,9 @@ WError WGBufferRenderStage::Render(WRenderer* renderer, WRenderTarget* rt, uint3
 		m_perFrameAnimatedMaterial->SetVariable<WMatrix>("viewMatrix", cam->GetViewMatrix());
 		m_perFrameAnimatedMaterial->SetVariable<WMatrix>("projectionMatrix", cam->GetProjectionMatrix());
 
+		m_perFrameIndirectMaterial->SetVariable<WMatrix>("viewMatrix", cam->GetViewMatrix());
+		m_perFrameIndirectMaterial->SetVariable<WMatrix>("projectionMatrix", cam->GetProjectionMatrix());
+
 		m_objectsFragment->Render(renderer, rt);
 
 		m_animatedObjectsFragment->Render(renderer, rt);
@@ -207,8 +314,21 @@ WError WGBufferRenderStage::Render(WRenderer* renderer, WRenderTarget* rt, uint3
 	return WError(W_SUCCEEDED);
 }
 
+WError WGBufferRenderStage::RecordCompute(WRenderer* renderer, VkCommandBuffer cmdBuffer) {
+	UNREFERENCED_PARAMETER(renderer);
+
+	return m_objectsFragment->RecordCulling(m_renderTarget, cmdBuffer);
+}
+
 WError WGBufferRenderStage::Resize(uint32_t width, uint32_t height) {
-	return WRenderStage::Resize(width, height);
+	WError err = WRenderStage::Resize(width, height);
+	if (!err)
+		return err;
+
+	// the pyramid is sized after the depth
+	if (m_occlusionCuller)
+		err = m_occlusionCuller->Create(m_depthOutput);
+	return err;
 }
 
 WGBufferVS* WGBufferRenderStage::GetDefaultVertexShader() const {
@@ -230,3 +350,9 @@ WEffect* WGBufferRenderStage::GetDefaultEffect() const {
 WEffect* WGBufferRenderStage::GetDefaultAnimatedEffect() const {
 	return m_defaultAnimatedFX;
 }
+
+W_OCCLUSION_CULLING_STATS WGBufferRenderStage::GetOcclusionCullingStats() const {
+	if (!m_objectsFragment)
+		return W_OCCLUSION_CULLING_STATS();
+	return m_objectsFragment->GetOcclusionCullingStats();
+}
@@ -228,40 +228,54 @@ WError WLightBufferRenderStage::Render(WRenderer* renderer, WRenderTarget* rt, u
 
 	if (filter & RENDER_FILTER_OBJECTS) {
 		WCamera* cam = rt->GetCamera();
+		WMatrix viewM = cam->GetViewMatrix();
+		WMatrix viewProjM = viewM * cam->GetProjectionMatrix();
 
 		for (auto it = m_lightRenderingAssets.begin(); it != m_lightRenderingAssets.end(); it++) {
-			LightTypeAssets lightTypeAssets = it->second;
+			LightTypeAssets& lightTypeAssets = it->second;
 			if (lightTypeAssets.materialMap.size()) {
 				lightTypeAssets.effect->Bind(rt);
-				lightTypeAssets.perFrameMaterial->SetVariable<WMatrix>("projInv", WMatrixInverse(cam->GetProjectionMatrix()));
+				if (!lightTypeAssets.projInv.effect)
+					lightTypeAssets.projInv = lightTypeAssets.perFrameMaterial->GetVariableHandle("projInv");
+				lightTypeAssets.perFrameMaterial->SetVariable<WMatrix>(lightTypeAssets.projInv, WMatrixInverse(cam->GetProjectionMatrix()));
 				lightTypeAssets.perFrameMaterial->Bind(rt);
 
+				// cull all the lights of this type against the frustum in one batch
+				m_candidateLights.clear();
+				m_candidateLightSpheres.Clear();
 				for (auto materialIt = lightTypeAssets.materialMap.begin(); materialIt != lightTypeAssets.materialMap.end(); materialIt++) {
 					WLight* light = materialIt->first;
-					WMaterial* material = materialIt->second;
 					int lightType = (int)light->GetType();
 
 					if (light->Hidden())
 						continue;
-					if (lightType == W_LIGHT_SPOT) {
-						if (!cam->CheckSphereInFrustum(light->GetPosition() + (light->GetLVector() * (light->GetRange() / 2.0f)), light->GetRange() / 2.0f))
-							continue;
-					} else if (lightType == W_LIGHT_POINT) {
-						if (!cam->CheckSphereInFrustum(light->GetPosition(), light->GetRange()))
-							continue;
-					}
+					m_candidateLights.push_back(*materialIt);
+					if (lightType == W_LIGHT_SPOT)
+						m_candidateLightSpheres.Add(light->GetWorldPosition() + (light->GetWorldLVector() * (light->GetRange() / 2.0f)), light->GetRange() / 2.0f);
+					else if (lightType == W_LIGHT_POINT)
+						m_candidateLightSpheres.Add(light->GetWorldPosition(), light->GetRange());
+					else
+						m_candidateLightSpheres.Add(light->GetWorldPosition(), FLT_MAX);
+				}
+				cam->CheckSpheresInFrustum(m_candidateLightSpheres, m_candidateLightVisibility);
+
+				for (uint32_t i = 0; i < m_candidateLights.size(); i++) {
+					if (!(m_candidateLightVisibility[i / 32] & (1u << (i % 32))))
+						continue;
+					WLight* light = m_candidateLights[i].first;
+					WMaterial* material = m_candidateLights[i].second;
 
 					WColor lightColor = light->GetColor();
-					material->SetVariable<WMatrix>("wvp", light->GetWorldMatrix() * cam->GetViewMatrix() * cam->GetProjectionMatrix());
-					material->SetVariable<WVector3>("lightDir", WVec3TransformNormal(light->GetLVector(), cam->GetViewMatrix()));
-					material->SetVariable<WVector3>("position", WVec3TransformCoord(light->GetPosition(), cam->GetViewMatrix()));
-					material->SetVariable<WVector3>("lightColor", WVector3(lightColor.r, lightColor.g, lightColor.b));
-					material->SetVariable<float>("intensity", light->GetIntensity());
-					material->SetVariable<float>("range", light->GetRange());
-					material->SetVariable<float>("minCosAngle", light->GetMinCosAngle());
+					material->SetVariable<WMatrix>(lightTypeAssets.wvp, light->GetWorldMatrix() * viewProjM);
+					material->SetVariable<WVector3>(lightTypeAssets.lightDir, WVec3TransformNormal(light->GetWorldLVector(), viewM));
+					material->SetVariable<WVector3>(lightTypeAssets.position, WVec3TransformCoord(light->GetWorldPosition(), viewM));
+					material->SetVariable<WVector3>(lightTypeAssets.lightColor, WVector3(lightColor.r, lightColor.g, lightColor.b));
+					material->SetVariable<float>(lightTypeAssets.intensity, light->GetIntensity());
+					material->SetVariable<float>(lightTypeAssets.range, light->GetRange());
+					material->SetVariable<float>(lightTypeAssets.minCosAngle, light->GetMinCosAngle());
 					float emittingHalfAngle = acosf(light->GetMinCosAngle());
 					float spotRadius = tanf(emittingHalfAngle) * light->GetRange();
-					material->SetVariable<float>("spotRadius", spotRadius);
+					material->SetVariable<float>(lightTypeAssets.spotRadius, spotRadius);
 					material->Bind(rt);
 
 					if (lightTypeAssets.fullscreenSprite)
@@ -295,16 +309,27 @@ void WLightBufferRenderStage::OnLightsChange(WLight* light, bool is_added) {
 	auto iter = m_lightRenderingAssets.find(light->GetType());
 	if (iter == m_lightRenderingAssets.end())
 		return;
-	LightTypeAssets assets = iter->second;
+	LightTypeAssets& assets = iter->second;
 
 	if (is_added) {
 		WMaterial* material = assets.effect->CreateMaterial(0);
-		iter->second.materialMap.insert(std::pair<class WLight*, class WMaterial*>(light, material));
+		if (material && !assets.wvp.effect) {
+			// all light materials of this type share the same effect, resolve the handles once
+			assets.wvp = material->GetVariableHandle("wvp");
+			assets.lightDir = material->GetVariableHandle("lightDir");
+			assets.position = material->GetVariableHandle("position");
+			assets.lightColor = material->GetVariableHandle("lightColor");
+			assets.intensity = material->GetVariableHandle("intensity");
+			assets.range = material->GetVariableHandle("range");
+			assets.minCosAngle = material->GetVariableHandle("minCosAngle");
+			assets.spotRadius = material->GetVariableHandle("spotRadius");
+		}
+		assets.materialMap.insert(std::pair<class WLight*, class WMaterial*>(light, material));
 	} else {
 		auto it = assets.materialMap.find(light);
 		if (it != assets.materialMap.end()) {
 			W_SAFE_REMOVEREF(it->second);
-			iter->second.materialMap.erase(light);
+			assets.materialMap.erase(light);
 		}
 	}
 }
@@ -102,6 +102,59 @@ W_SHADER_DESC WForwardRenderStageObjectPS::GetDesc(int maxLights) {
 	return desc;
 }
 
+WForwardRenderStageIndirectObjectVS::WForwardRenderStageIndirectObjectVS(Wasabi* const app) : WShader(app) {}
+
+void WForwardRenderStageIndirectObjectVS::Load(bool bSaveData) {
+	int maxLights = m_app->GetEngineParam<int>("maxLights", 0);
+	m_desc = GetDesc(maxLights);
+	vector<uint8_t> code {
+		#include "Shaders/forward-indirect.vert.glsl.spv"
+	};
+	LoadCodeSPIRV((char*)code.data(), (int)code.size(), bSaveData);
+}
+
+W_SHADER_DESC WForwardRenderStageIndirectObjectVS::GetDesc(int maxLights) {
+	W_SHADER_DESC desc;
+	desc.type = W_VERTEX_SHADER;
+	desc.bound_resources = {
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_BUFFER, 6, 0, "objectData",
+			WForwardRenderStageObjectVS::GetDesc(maxLights).bound_resources[0].variables // one uboPerObject per object
+		),
+		WForwardRenderStageObjectVS::GetDesc(maxLights).bound_resources[1],
+		W_BOUND_RESOURCE(W_TYPE_STORAGE_BUFFER, 7, 0, "drawList", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "objectIndex"), // index of the object in objectData
+		}),
+		W_BOUND_RESOURCE(W_TYPE_PUSH_CONSTANT, 0, "pcPerBatch", {
+			W_SHADER_VARIABLE_INFO(W_TYPE_UINT, "objectOffset"), // index of the batch's first object in drawList
+		}),
+	};
+	desc.input_layouts = WForwardRenderStageObjectVS::GetDesc(maxLights).input_layouts;
+	return desc;
+}
+
+WForwardRenderStageIndirectObjectPS::WForwardRenderStageIndirectObjectPS(Wasabi* const app) : WShader(app) {}
+
+void WForwardRenderStageIndirectObjectPS::Load(bool bSaveData) {
+	int maxLights = m_app->GetEngineParam<int>("maxLights", 0);
+	m_desc = GetDesc(maxLights);
+	vector<uint8_t> code {
+		#include "Shaders/forward-indirect.frag.glsl.spv"
+	};
+	LoadCodeSPIRV((char*)code.data(), (int)code.size(), bSaveData);
+}
+
+W_SHADER_DESC WForwardRenderStageIndirectObjectPS::GetDesc(int maxLights) {
+	W_SHADER_DESC desc;
+	desc.type = W_FRAGMENT_SHADER;
+	desc.bound_resources = {
+		WForwardRenderStageIndirectObjectVS::GetDesc(maxLights).bound_resources[0],
+		WForwardRenderStageObjectPS::GetDesc(maxLights).bound_resources[1],
+		WForwardRenderStageObjectPS::GetDesc(maxLights).bound_resources[2],
+		WForwardRenderStageObjectPS::GetDesc(maxLights).bound_resources[3],
+	};
+	return desc;
+}
+
 WForwardRenderStageTerrainVS::WForwardRenderStageTerrainVS(Wasabi* const app) : WShader(app) {}
 
 void WForwardRenderStageTerrainVS::Load(bool bSaveData) {
@@ -181,6 +234,8 @@ WForwardRenderStage::WForwardRenderStage(Wasabi* const app) : WRenderStage(app)
 	m_terrainsFragment = nullptr;
 	m_perFrameObjectsMaterial = nullptr;
 	m_perFrameAnimatedObjectsMaterial = nullptr;
+	m_perFrameIndirectObjectsMaterial = nullptr;
+	m_frustumCuller = nullptr;
 	m_perFrameTerrainsMaterial = nullptr;
 	m_addDefaultEffects = true;
 }
@@ -280,6 +335,41 @@ WError WForwardRenderStage::Initialize(std::vector<WRenderStage*>& previousStage
 
 	m_terrainsFragment = new WTerrainRenderFragment(m_stageDescription.name, terrainFX, m_app, EFFECT_RENDER_FLAG_RENDER_FORWARD);
 
+	WForwardRenderStageIndirectObjectVS* indirectVS = new WForwardRenderStageIndirectObjectVS(m_app);
+	indirectVS->SetName("DefaultForwardIndirectVS");
+	m_app->FileManager->AddDefaultAsset(indirectVS->GetName(), indirectVS);
+	indirectVS->Load();
+
+	WForwardRenderStageIndirectObjectPS* indirectPS = new WForwardRenderStageIndirectObjectPS(m_app);
+	indirectPS->SetName("DefaultForwardIndirectPS");
+	m_app->FileManager->AddDefaultAsset(indirectPS->GetName(), indirectPS);
+	indirectPS->Load();
+
+	WEffect* indirectFX = new WEffect(m_app);
+	indirectFX->SetName("DefaultForwardIndirectEffect");
+	m_app->FileManager->AddDefaultAsset(indirectFX->GetName(), indirectFX);
+	err = indirectFX->BindShader(indirectVS);
+	if (err) {
+		err = indirectFX->BindShader(indirectPS);
+		if (err)
+			err = indirectFX->BuildPipeline(m_renderTarget);
+	}
+	W_SAFE_REMOVEREF(indirectVS);
+	W_SAFE_REMOVEREF(indirectPS);
+	if (!err) {
+		W_SAFE_REMOVEREF(indirectFX);
+		return err;
+	}
+	m_objectsFragment->SetIndirectEffect(indirectFX, 0, 4);
+	W_SAFE_REMOVEREF(indirectFX);
+
+	m_frustumCuller = new WFrustumCuller(m_app);
+	err = m_frustumCuller->Create();
+	if (err)
+		err = m_objectsFragment->SetFrustumCuller(m_frustumCuller);
+	if (!err)
+		return err;
+
 	m_perFrameObjectsMaterial = m_objectsFragment->GetEffect()->CreateMaterial(1, true);
 	if (!m_perFrameObjectsMaterial) {
 		err = WError(W_ERRORUNK);
@@ -296,6 +386,14 @@ WError WForwardRenderStage::Initialize(std::vector<WRenderStage*>& previousStage
 		m_app->FileManager->AddDefaultAsset(m_perFrameAnimatedObjectsMaterial->GetName(), m_perFrameAnimatedObjectsMaterial);
 	}
 
+	m_perFrameIndirectObjectsMaterial = m_objectsFragment->GetIndirectEffect()->CreateMaterial(1, true);
+	if (!m_perFrameIndirectObjectsMaterial) {
+		err = WError(W_ERRORUNK);
+	} else {
+		m_perFrameIndirectObjectsMaterial->SetName("PerFrameForwardIndirectMaterial");
+		m_app->FileManager->AddDefaultAsset(m_perFrameIndirectObjectsMaterial->GetName(), m_perFrameIndirectObjectsMaterial);
+	}
+
 	m_perFrameTerrainsMaterial = m_terrainsFragment->GetEffect()->CreateMaterial(1, true);
 	if (!m_perFrameTerrainsMaterial) {
 		err = WError(W_ERRORUNK);
@@ -313,24 +411,39 @@ void WForwardRenderStage::Cleanup() {
 	WRenderStage::Cleanup();
 	W_SAFE_REMOVEREF(m_perFrameObjectsMaterial);
 	W_SAFE_REMOVEREF(m_perFrameAnimatedObjectsMaterial);
+	W_SAFE_REMOVEREF(m_perFrameIndirectObjectsMaterial);
 	W_SAFE_REMOVEREF(m_perFrameTerrainsMaterial);
 	W_SAFE_DELETE(m_objectsFragment);
 	W_SAFE_DELETE(m_animatedObjectsFragment);
 	W_SAFE_DELETE(m_terrainsFragment);
+	W_SAFE_DELETE(m_frustumCuller);
 }
 
 WError WForwardRenderStage::Render(WRenderer* renderer, WRenderTarget* rt, uint32_t filter) {
 	WCamera* cam = rt->GetCamera();
 
-	int numLights = 0;
-	for (uint32_t i = 0; (size_t)numLights < m_lights.size(); i++) {
+	// cull all the lights against the frustum in one batch (directional
+	// lights get an infinite sphere so they are never culled)
+	m_candidateLights.clear();
+	m_candidateLightSpheres.Clear();
+	for (uint32_t i = 0; ; i++) {
 		WLight* light = m_app->LightManager->GetEntityByIndex(i);
 		if (!light)
 			break;
-		if (!light->Hidden() && light->InCameraView(cam)) {
+		if (!light->Hidden()) {
+			m_candidateLights.push_back(light);
+			m_candidateLightSpheres.Add(light->GetWorldPosition(), light->GetType() == W_LIGHT_DIRECTIONAL ? FLT_MAX : light->GetRange());
+		}
+	}
+	cam->CheckSpheresInFrustum(m_candidateLightSpheres, m_candidateLightVisibility);
+
+	int numLights = 0;
+	for (uint32_t i = 0; i < m_candidateLights.size() && (size_t)numLights < m_lights.size(); i++) {
+		WLight* light = m_candidateLights[i];
+		if (m_candidateLightVisibility[i / 32] & (1u << (i % 32))) {
 			WColor c = light->GetColor();
-			WVector3 l = light->GetLVector();
-			WVector3 p = light->GetPosition();
+			WVector3 l = light->GetWorldLVector();
+			WVector3 p = light->GetWorldPosition();
 			m_lights[numLights].color = WVector4(c.r, c.g, c.b, light->GetIntensity());
 			m_lights[numLights].dir = WVector4(l.x, l.y, l.z, light->GetRange());
 			m_lights[numLights].pos = WVector4(p.x, p.y, p.z, light->GetMinCosAngle());
@@ -343,7 +456,7 @@ WError WForwardRenderStage::Render(WRenderer* renderer, WRenderTarget* rt, uint3
 		// create the per-frame UBO data
 		m_perFrameTerrainsMaterial->SetVariable<WMatrix>("viewMatrix", cam->GetViewMatrix());
 		m_perFrameTerrainsMaterial->SetVariable<WMatrix>("projectionMatrix", cam->GetProjectionMatrix());
-		m_perFrameTerrainsMaterial->SetVariable<WVector3>("camDirW", cam->GetLVector());
+		m_perFrameTerrainsMaterial->SetVariable<WVector3>("camDirW", cam->GetWorldLVector());
 		m_perFrameTerrainsMaterial->SetVariable<int>("numLights", numLights);
 		m_perFrameTerrainsMaterial->SetVariableData("lights", m_lights.data(), sizeof(LightStruct) * numLights);
 
@@ -354,16 +467,22 @@ WError WForwardRenderStage::Render(WRenderer* renderer, WRenderTarget* rt, uint3
 		// create the per-frame UBO data
 		m_perFrameObjectsMaterial->SetVariable<WMatrix>("viewMatrix", cam->GetViewMatrix());
 		m_perFrameObjectsMaterial->SetVariable<WMatrix>("projectionMatrix", cam->GetProjectionMatrix());
-		m_perFrameObjectsMaterial->SetVariable<WVector3>("camDirW", cam->GetLVector());
+		m_perFrameObjectsMaterial->SetVariable<WVector3>("camDirW", cam->GetWorldLVector());
 		m_perFrameObjectsMaterial->SetVariable<int>("numLights", numLights);
 		m_perFrameObjectsMaterial->SetVariableData("lights", m_lights.data(), sizeof(LightStruct) * numLights);
 
 		m_perFrameAnimatedObjectsMaterial->SetVariable<WMatrix>("viewMatrix", cam->GetViewMatrix());
 		m_perFrameAnimatedObjectsMaterial->SetVariable<WMatrix>("projectionMatrix", cam->GetProjectionMatrix());
-		m_perFrameAnimatedObjectsMaterial->SetVariable<WVector3>("camDirW", cam->GetLVector());
+		m_perFrameAnimatedObjectsMaterial->SetVariable<WVector3>("camDirW", cam->GetWorldLVector());
 		m_perFrameAnimatedObjectsMaterial->SetVariable<int>("numLights", numLights);
 		m_perFrameAnimatedObjectsMaterial->SetVariableData("lights", m_lights.data(), sizeof(LightStruct) * numLights);
 
+		m_perFrameIndirectObjectsMaterial->SetVariable<WMatrix>("viewMatrix", cam->GetViewMatrix());
+		m_perFrameIndirectObjectsMaterial->SetVariable<WMatrix>("projectionMatrix", cam->GetProjectionMatrix());
+		m_perFrameIndirectObjectsMaterial->SetVariable<WVector3>("camDirW", cam->GetWorldLVector());
+		m_perFrameIndirectObjectsMaterial->SetVariable<int>("numLights", numLights);
+		m_perFrameIndirectObjectsMaterial->SetVariableData("lights", m_lights.data(), sizeof(LightStruct) * numLights);
+
 		m_objectsFragment->Render(renderer, rt);
 
 		m_animatedObjectsFragment->Render(renderer, rt);
@@ -372,6 +491,12 @@ WError WForwardRenderStage::Render(WRenderer* renderer, WRenderTarget* rt, uint3
 	return WError(W_SUCCEEDED);
 }
 
+WError WForwardRenderStage::RecordCompute(WRenderer* renderer, VkCommandBuffer cmdBuffer) {
+	UNREFERENCED_PARAMETER(renderer);
+
+	return m_objectsFragment->RecordCulling(m_renderTarget, cmdBuffer);
+}
+
 WError WForwardRenderStage::Resize(uint32_t width, uint32_t height) {
 	return WRenderStage::Resize(width, height);
 }
@@ -379,4 +504,5 @@ WError WForwardRenderStage::Resize(uint32_t width, uint32_t height) {
 void WForwardRenderStage::SetAmbientLight(WColor color) {
 	m_perFrameObjectsMaterial->SetVariable<WColor>("ambient", color);
 	m_perFrameAnimatedObjectsMaterial->SetVariable<WColor>("ambient", color);
+	m_perFrameIndirectObjectsMaterial->SetVariable<WColor>("ambient", color);
 }
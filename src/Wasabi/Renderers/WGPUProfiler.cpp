@@ -0,0 +1,275 @@
+#include "Wasabi/Renderers/WGPUProfiler.hpp"
+
+#include <fstream>
+#include <algorithm>
+#include <cfloat>
+
+namespace {
+	/** Name of the scope covering the whole frame */
+	const char* FRAME_SCOPE_NAME = "Frame";
+};
+
+WGPUProfiler::WGPUProfiler(Wasabi* const app) : m_app(app) {
+	m_enabled = m_app->GetEngineParam<bool>("enableGPUProfiler");
+	m_supported = false;
+	m_timestampPeriod = 1.0;
+	m_timestampMask = 0xFFFFFFFFFFFFFFFFull;
+	m_maxQueries = 0;
+	m_statsWindow = 1;
+	m_traceFrames = 0;
+	m_currentFrame = nullptr;
+	m_frameCounter = 0;
+	m_traceEpoch = 0;
+}
+
+WGPUProfiler::~WGPUProfiler() {
+	Cleanup();
+}
+
+WError WGPUProfiler::Initialize(uint32_t numBuffers) {
+	Cleanup();
+
+	m_maxQueries = 2 * (m_app->GetEngineParam<uint32_t>("gpuProfilerMaxScopes", 128) + 1); // +1 for the frame scope
+	m_statsWindow = std::max(m_app->GetEngineParam<uint32_t>("gpuProfilerWindow", 120), 1u);
+	m_traceFrames = m_app->GetEngineParam<uint32_t>("gpuProfilerTraceFrames", 300);
+	m_results.resize(m_maxQueries);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_app->GetVulkanPhysicalDevice(), &properties);
+	uint32_t queueCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(m_app->GetVulkanPhysicalDevice(), &queueCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueProps(queueCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(m_app->GetVulkanPhysicalDevice(), &queueCount, queueProps.data());
+
+	uint32_t queueFamilyIndex = m_app->GetVulkanGraphicsQueueFamilyIndex();
+	uint32_t validBits = queueFamilyIndex < queueCount ? queueProps[queueFamilyIndex].timestampValidBits : 0;
+	m_supported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+	if (!m_supported)
+		return WError(W_SUCCEEDED); // profiling silently stays off
+	m_timestampPeriod = (double)properties.limits.timestampPeriod;
+	m_timestampMask = validBits >= 64 ? 0xFFFFFFFFFFFFFFFFull : ((1ull << validBits) - 1);
+
+	VkQueryPoolCreateInfo queryPoolInfo = {};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = m_maxQueries;
+
+	m_frames.resize(numBuffers);
+	for (uint32_t i = 0; i < numBuffers; i++) {
+		m_frames[i].pool = VK_NULL_HANDLE;
+		m_frames[i].numQueries = 0;
+		m_frames[i].pending = false;
+		m_frames[i].frameNumber = 0;
+		if (vkCreateQueryPool(m_app->GetVulkanDevice(), &queryPoolInfo, nullptr, &m_frames[i].pool) != VK_SUCCESS) {
+			Cleanup();
+			m_supported = false;
+			return WError(W_OUTOFMEMORY);
+		}
+	}
+
+	return WError(W_SUCCEEDED);
+}
+
+void WGPUProfiler::Cleanup() {
+	for (auto& frame : m_frames) {
+		if (frame.pool)
+			vkDestroyQueryPool(m_app->GetVulkanDevice(), frame.pool, nullptr);
+	}
+	m_frames.clear();
+	m_currentFrame = nullptr;
+	m_scopeStack.clear();
+}
+
+void WGPUProfiler::SetEnabled(bool enable) {
+	m_enabled = enable;
+}
+
+bool WGPUProfiler::IsEnabled() const {
+	return m_enabled && m_supported;
+}
+
+void WGPUProfiler::BeginFrame(VkCommandBuffer cmdBuf, uint32_t bufferIndex) {
+	m_currentFrame = nullptr;
+	m_scopeStack.clear();
+	if (bufferIndex >= m_frames.size())
+		return;
+
+	FRAME_QUERIES& frame = m_frames[bufferIndex];
+	if (frame.pending)
+		_Resolve(frame);
+	frame.pending = false;
+
+	if (!IsEnabled())
+		return;
+
+	vkCmdResetQueryPool(cmdBuf, frame.pool, 0, m_maxQueries);
+
+	frame.frameNumber = m_frameCounter++;
+	frame.numQueries = 2;
+	frame.scopes.clear();
+	frame.scopes.push_back(PENDING_SCOPE({ FRAME_SCOPE_NAME, 0, 1, 0 }));
+	vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, 0);
+	m_currentFrame = &frame;
+}
+
+void WGPUProfiler::EndFrame(VkCommandBuffer cmdBuf) {
+	if (!m_currentFrame)
+		return;
+
+	vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_currentFrame->pool, 1);
+	m_currentFrame->pending = true;
+	m_currentFrame = nullptr;
+	m_scopeStack.clear();
+}
+
+uint32_t WGPUProfiler::BeginScope(VkCommandBuffer cmdBuf, const std::string& name) {
+	if (!m_currentFrame || m_currentFrame->numQueries + 2 > m_maxQueries)
+		return INVALID_SCOPE;
+
+	PENDING_SCOPE scope;
+	scope.name = m_scopeStack.size() > 0 ? m_currentFrame->scopes[m_scopeStack.back()].name + "/" + name : name;
+	scope.beginQuery = m_currentFrame->numQueries++;
+	scope.endQuery = m_currentFrame->numQueries++;
+	scope.depth = (uint32_t)m_scopeStack.size() + 1;
+
+	uint32_t id = (uint32_t)m_currentFrame->scopes.size();
+	m_currentFrame->scopes.push_back(std::move(scope));
+	m_scopeStack.push_back(id);
+	vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_currentFrame->pool, m_currentFrame->scopes[id].beginQuery);
+	return id;
+}
+
+void WGPUProfiler::EndScope(VkCommandBuffer cmdBuf, uint32_t scope) {
+	if (!m_currentFrame || scope == INVALID_SCOPE || scope >= m_currentFrame->scopes.size())
+		return;
+
+	// close any scope left open inside this one
+	while (m_scopeStack.size() > 0) {
+		uint32_t top = m_scopeStack.back();
+		m_scopeStack.pop_back();
+		if (top == scope)
+			break;
+		vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_currentFrame->pool, m_currentFrame->scopes[top].endQuery);
+	}
+	vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_currentFrame->pool, m_currentFrame->scopes[scope].endQuery);
+}
+
+void WGPUProfiler::_Resolve(FRAME_QUERIES& frame) {
+	// the frame's fence has been waited on, so this does not block
+	VkResult err = vkGetQueryPoolResults(m_app->GetVulkanDevice(), frame.pool, 0, frame.numQueries,
+		frame.numQueries * sizeof(uint64_t), m_results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (err != VK_SUCCESS)
+		return;
+
+	uint64_t frameStart = m_results[0] & m_timestampMask;
+	if (m_traceHistory.size() == 0 && m_traceEpoch == 0)
+		m_traceEpoch = frameStart;
+
+	std::vector<TRACE_EVENT> events;
+	if (m_traceFrames > 0)
+		events.reserve(frame.scopes.size());
+
+	for (const PENDING_SCOPE& scope : frame.scopes) {
+		uint64_t begin = m_results[scope.beginQuery] & m_timestampMask;
+		uint64_t end = m_results[scope.endQuery] & m_timestampMask;
+		double durationMs = (double)((end - begin) & m_timestampMask) * m_timestampPeriod / 1000000.0;
+
+		SCOPE_SAMPLES& stats = m_statistics[scope.name];
+		if (stats.samples.size() < m_statsWindow) {
+			stats.samples.push_back(durationMs);
+			stats.next = (uint32_t)stats.samples.size() % m_statsWindow;
+		} else {
+			stats.samples[stats.next % stats.samples.size()] = durationMs;
+			stats.next = (stats.next + 1) % (uint32_t)stats.samples.size();
+		}
+		stats.last = durationMs;
+
+		if (m_traceFrames > 0) {
+			TRACE_EVENT event;
+			event.name = scope.name;
+			event.frameNumber = frame.frameNumber;
+			event.startUs = (double)((begin - m_traceEpoch) & m_timestampMask) * m_timestampPeriod / 1000.0;
+			event.durationUs = durationMs * 1000.0;
+			event.depth = scope.depth;
+			events.push_back(std::move(event));
+		}
+	}
+
+	if (m_traceFrames > 0) {
+		m_traceHistory.push_back(std::move(events));
+		while (m_traceHistory.size() > m_traceFrames)
+			m_traceHistory.pop_front();
+	}
+}
+
+bool WGPUProfiler::GetStatistics(const std::string& scopeName, W_GPU_TIMING_STATS* stats) const {
+	auto it = m_statistics.find(scopeName);
+	if (it == m_statistics.end() || it->second.samples.size() == 0)
+		return false;
+
+	const std::vector<double>& samples = it->second.samples;
+	double total = 0.0;
+	stats->minMs = DBL_MAX;
+	stats->maxMs = 0.0;
+	for (double sample : samples) {
+		total += sample;
+		stats->minMs = std::min(stats->minMs, sample);
+		stats->maxMs = std::max(stats->maxMs, sample);
+	}
+	stats->lastMs = it->second.last;
+	stats->averageMs = total / (double)samples.size();
+	stats->numSamples = (uint32_t)samples.size();
+	return true;
+}
+
+std::vector<std::pair<std::string, W_GPU_TIMING_STATS>> WGPUProfiler::GetAllStatistics() const {
+	std::vector<std::pair<std::string, W_GPU_TIMING_STATS>> allStats;
+	allStats.reserve(m_statistics.size());
+	for (auto it = m_statistics.begin(); it != m_statistics.end(); it++) {
+		W_GPU_TIMING_STATS stats;
+		if (GetStatistics(it->first, &stats))
+			allStats.push_back(std::make_pair(it->first, stats));
+	}
+	return allStats;
+}
+
+void WGPUProfiler::ResetStatistics() {
+	m_statistics.clear();
+	m_traceHistory.clear();
+	m_traceEpoch = 0;
+}
+
+WError WGPUProfiler::WriteTrace(std::string filename) const {
+	std::ofstream file(filename, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+		return WError(W_FILENOTFOUND);
+
+	// one thread (track) per nesting depth, so that overlapping GPU work of consecutive scopes still displays
+	uint32_t maxDepth = 0;
+	for (const auto& events : m_traceHistory)
+		for (const TRACE_EVENT& event : events)
+			maxDepth = std::max(maxDepth, event.depth);
+
+	const char* appName = m_app->GetEngineParam<const char*>("appName", "Wasabi");
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"" << WUtil::EscapeJSON(appName) << " GPU\"}}";
+	for (uint32_t depth = 0; depth <= maxDepth; depth++) {
+		std::string trackName = depth == 0 ? std::string("Frames") : "Depth " + std::to_string(depth);
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << depth << ",\"args\":{\"name\":\"" << trackName << "\"}}";
+	}
+
+	file.precision(3);
+	file << std::fixed;
+	for (const auto& events : m_traceHistory) {
+		for (const TRACE_EVENT& event : events) {
+			size_t leaf = event.name.find_last_of('/');
+			std::string shortName = leaf == std::string::npos ? event.name : event.name.substr(leaf + 1);
+			file << ",\n{\"name\":\"" << WUtil::EscapeJSON(shortName) << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.depth
+				<< ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs
+				<< ",\"args\":{\"frame\":" << event.frameNumber << ",\"scope\":\"" << WUtil::EscapeJSON(event.name) << "\"}}";
+		}
+	}
+	file << "\n]}\n";
+
+	return file.good() ? WError(W_SUCCEEDED) : WError(W_ERRORUNK);
+}
@@ -102,6 +102,20 @@ void WRenderStage::Cleanup() {
 	W_SAFE_REMOVEREF(m_depthOutput);
 }
 
+WError WRenderStage::RecordCompute(WRenderer* renderer, VkCommandBuffer cmdBuffer) {
+	UNREFERENCED_PARAMETER(renderer);
+	UNREFERENCED_PARAMETER(cmdBuffer);
+
+	return WError(W_SUCCEEDED);
+}
+
+WError WRenderStage::RecordAsyncCompute(WRenderer* renderer, VkCommandBuffer cmdBuffer) {
+	UNREFERENCED_PARAMETER(renderer);
+	UNREFERENCED_PARAMETER(cmdBuffer);
+
+	return WError(W_SUCCEEDED);
+}
+
 WError WRenderStage::Resize(uint32_t width, uint32_t height) {
 	if (m_stageDescription.target == RENDER_STAGE_TARGET_BUFFER) {
 		OUTPUT_IMAGE desc;
@@ -143,10 +157,8 @@ WError WRenderStage::Resize(uint32_t width, uint32_t height) {
 		if (!validDepthFormat)
 			return WError(W_HARDWARENOTSUPPORTED);
 
-		vector<VkImageView> swapchainViews;
-		for (uint32_t i = 0; i < m_app->Renderer->GetSwapchain()->imageCount; i++)
-			swapchainViews.push_back(m_app->Renderer->GetSwapchain()->buffers[i].view);
-		WError status = m_renderTarget->Create(width, height, swapchainViews.data(), (uint32_t)swapchainViews.size(), colorFormat, depthFormat);
+		vector<VkImageView> backbufferViews = m_app->Renderer->GetBackbufferViews();
+		WError status = m_renderTarget->Create(width, height, backbufferViews.data(), (uint32_t)backbufferViews.size(), colorFormat, depthFormat);
 		if (!status)
 			return status;
 	}
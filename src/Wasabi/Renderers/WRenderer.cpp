@@ -5,25 +5,48 @@
 #include "Wasabi/Geometries/WGeometry.hpp"
 #include "Wasabi/WindowAndInput/WWindowAndInputComponent.hpp"
 
-WRenderer::WRenderer(Wasabi* const app) : m_app(app) {
+#include <algorithm>
+
+WRenderer::WRenderer(Wasabi* const app) : m_app(app), m_gpuProfiler(app) {
 	m_queue = VK_NULL_HANDLE;
+	m_computeQueue = VK_NULL_HANDLE;
+	m_computeCommandPool = VK_NULL_HANDLE;
+	m_queueFamilyIndex = 0;
+	m_computeQueueFamilyIndex = 0;
+	_ResetAsyncComputeState();
+	m_perBufferResources.computeCommandPool = VK_NULL_HANDLE;
+	m_perBufferResources.recordingCommandBuffer = VK_NULL_HANDLE;
 	m_sampler = VK_NULL_HANDLE;
+	m_swapChain = nullptr;
+	m_headless = false;
+	m_lastHeadlessFrame = std::numeric_limits<uint32_t>::max();
+	ResetFrameLatencyStatistics();
 }
 
 void WRenderer::Cleanup() {
 	m_app->MemoryManager->ReleaseSampler(m_sampler, m_app->GetCurrentBufferingIndex());
 	if (m_queue)
 		vkQueueWaitIdle(m_queue);
+	if (m_computeQueue)
+		vkQueueWaitIdle(m_computeQueue);
 	m_perBufferResources.Destroy(m_app);
+	if (m_computeCommandPool)
+		vkDestroyCommandPool(m_app->GetVulkanDevice(), m_computeCommandPool, nullptr);
+	m_computeCommandPool = VK_NULL_HANDLE;
+	m_computeQueue = VK_NULL_HANDLE;
+	m_gpuProfiler.Cleanup();
+	_DestroyHeadlessImages();
 	SetRenderingStages(std::vector<WRenderStage*>({}));
 }
 
-VkResult WRenderer::PerBufferResources::Create(Wasabi* app, uint32_t numBuffers) {
+VkResult WRenderer::PerBufferResources::Create(Wasabi* app, uint32_t numBuffers, uint32_t numImages, VkCommandPool computePool) {
 	Destroy(app);
 	VkDevice device = app->GetVulkanDevice();
 	VkResult err = VK_SUCCESS;
 
 	curIndex = 0;
+	backbufferIndex = 0;
+	frameStartTimes.assign(numBuffers, 0);
 
 	VkCommandBufferAllocateInfo cmdBufAllocateInfo =
 		vkTools::initializers::commandBufferAllocateInfo(
@@ -35,6 +58,22 @@ VkResult WRenderer::PerBufferResources::Create(Wasabi* app, uint32_t numBuffers)
 	err = vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, primaryCommandBuffers.data());
 	if (err)
 		return err;
+	recordingCommandBuffer = primaryCommandBuffers[0];
+
+	// resources of async compute on a dedicated compute queue
+	computeCommandPool = computePool;
+	if (computeCommandPool) {
+		lateCommandBuffers.resize(numBuffers);
+		err = vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, lateCommandBuffers.data());
+		if (err)
+			return err;
+
+		cmdBufAllocateInfo.commandPool = computeCommandPool;
+		computeCommandBuffers.resize(numBuffers);
+		err = vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, computeCommandBuffers.data());
+		if (err)
+			return err;
+	}
 
 	VkSemaphoreCreateInfo semaphoreCreateInfo = vkTools::initializers::semaphoreCreateInfo();
 	VkFenceCreateInfo fenceCreateInfo = vkTools::initializers::fenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
@@ -46,15 +85,28 @@ VkResult WRenderer::PerBufferResources::Create(Wasabi* app, uint32_t numBuffers)
 			break;
 		presentComplete.push_back(sem);
 
-		err = vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &sem);
+		err = vkCreateFence(device, &fenceCreateInfo, nullptr, &fence);
 		if (err)
 			break;
-		renderComplete.push_back(sem);
+		memoryFences.push_back(fence);
 
-		err = vkCreateFence(device, &fenceCreateInfo, nullptr, &fence);
+		if (computeCommandPool) {
+			err = vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &sem);
+			if (err)
+				break;
+			computeComplete.push_back(sem);
+
+			err = vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &sem);
+			if (err)
+				break;
+			graphicsComplete.push_back(sem);
+		}
+	}
+	for (uint32_t i = 0; i < numImages && !err; i++) {
+		err = vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &sem);
 		if (err)
 			break;
-		memoryFences.push_back(fence);
+		renderComplete.push_back(sem);
 	}
 	return err;
 }
@@ -63,15 +115,30 @@ void WRenderer::PerBufferResources::Destroy(Wasabi* app) {
 	for (auto it = primaryCommandBuffers.begin(); it != primaryCommandBuffers.end(); it++)
 		app->MemoryManager->ReleaseCommandBuffer(*it, app->GetCurrentBufferingIndex());
 	primaryCommandBuffers.clear();
+	for (auto it = lateCommandBuffers.begin(); it != lateCommandBuffers.end(); it++)
+		app->MemoryManager->ReleaseCommandBuffer(*it, app->GetCurrentBufferingIndex());
+	lateCommandBuffers.clear();
+	// the compute command buffers are not from the memory manager's pool, the queues are idle here
+	if (computeCommandBuffers.size() > 0)
+		vkFreeCommandBuffers(app->GetVulkanDevice(), computeCommandPool, (uint32_t)computeCommandBuffers.size(), computeCommandBuffers.data());
+	computeCommandBuffers.clear();
+	recordingCommandBuffer = VK_NULL_HANDLE;
 	for (auto it = presentComplete.begin(); it != presentComplete.end(); it++)
 		app->MemoryManager->ReleaseSemaphore(*it, app->GetCurrentBufferingIndex());
 	presentComplete.clear();
 	for (auto it = renderComplete.begin(); it != renderComplete.end(); it++)
 		app->MemoryManager->ReleaseSemaphore(*it, app->GetCurrentBufferingIndex());
 	renderComplete.clear();
+	for (auto it = computeComplete.begin(); it != computeComplete.end(); it++)
+		app->MemoryManager->ReleaseSemaphore(*it, app->GetCurrentBufferingIndex());
+	computeComplete.clear();
+	for (auto it = graphicsComplete.begin(); it != graphicsComplete.end(); it++)
+		app->MemoryManager->ReleaseSemaphore(*it, app->GetCurrentBufferingIndex());
+	graphicsComplete.clear();
 	for (auto it = memoryFences.begin(); it != memoryFences.end(); it++)
 		app->MemoryManager->ReleaseFence(*it, app->GetCurrentBufferingIndex());
 	memoryFences.clear();
+	frameStartTimes.clear();
 }
 
 WError WRenderer::Initialize() {
@@ -79,7 +146,11 @@ WError WRenderer::Initialize() {
 
 	m_device = m_app->GetVulkanDevice();
 	m_queue = m_app->GetVulkanGraphicsQeueue();
-	m_swapChain = m_app->GetSwapChain();
+	m_queueFamilyIndex = m_app->GetVulkanGraphicsQueueFamilyIndex();
+	m_computeQueue = m_app->GetVulkanComputeQueue();
+	m_computeQueueFamilyIndex = m_app->GetVulkanComputeQueueFamilyIndex();
+	m_headless = m_app->GetEngineParam<bool>("headless");
+	m_swapChain = m_headless ? nullptr : m_app->GetSwapChain();
 
 	//
 	// Create the texture sampler
@@ -104,6 +175,19 @@ WError WRenderer::Initialize() {
 	if (err != VK_SUCCESS)
 		return WError(W_OUTOFMEMORY);
 
+	//
+	// Create the command pool for async compute on a dedicated compute queue
+	//
+	if (m_computeQueue) {
+		VkCommandPoolCreateInfo cmdPoolInfo = {};
+		cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		cmdPoolInfo.queueFamilyIndex = m_computeQueueFamilyIndex;
+		cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		err = vkCreateCommandPool(m_device, &cmdPoolInfo, nullptr, &m_computeCommandPool);
+		if (err != VK_SUCCESS)
+			return WError(W_OUTOFMEMORY);
+	}
+
 	//
 	// Setup swap chain and render target
 	//
@@ -111,28 +195,65 @@ WError WRenderer::Initialize() {
 }
 
 void WRenderer::Render() {
-	// wait for the fence to be signalled (by vkQueueSubmit of the last frame that used this buffer index (m_perBufferResources.curIndex))
-	VkResult err = vkWaitForFences(m_device, 1, &m_perBufferResources.memoryFences[m_perBufferResources.curIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
-	if (err == VK_SUCCESS) {
-		err = vkResetFences(m_device, 1, &m_perBufferResources.memoryFences[m_perBufferResources.curIndex]);
+	W_PROFILE_ZONE(m_app, "WRenderer::Render");
+
+	uint64_t frameStartTime = WCPUProfiler::Now();
+	_UpdateFrameLatencies();
+
+	// wait for the fence to be signalled (by vkQueueSubmit of the last frame that used this buffer index (m_perBufferResources.curIndex)),
+	// the frames of the other buffer indices may still be rendering
+	VkResult err;
+	{
+		W_PROFILE_ZONE(m_app, "WRenderer::WaitForFrame");
+		err = vkWaitForFences(m_device, 1, &m_perBufferResources.memoryFences[m_perBufferResources.curIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
 	}
 	if (err != VK_SUCCESS)
-		return; // fence is not ready yet or can't be reset
-
-	// allow the memory manager to free any resources pending on this frame, now that the fence is signalled
-	m_app->MemoryManager->ReleaseFrameResources(m_perBufferResources.curIndex);
+		return; // fence is not ready yet
+	_UpdateFrameLatencies();
+	if (m_lastHeadlessFrame == m_perBufferResources.curIndex)
+		m_lastHeadlessFrame = std::numeric_limits<uint32_t>::max(); // its fence is no longer going to be signalled
+
+	{
+		W_PROFILE_ZONE(m_app, "WVulkanMemoryManager::Update");
+		// allow the memory manager to free any resources pending on this frame, now that the fence is signalled
+		m_app->MemoryManager->ReleaseFrameResources(m_perBufferResources.curIndex);
+		// retire finished uploads (recycling their staging memory and calling their callbacks)
+		m_app->MemoryManager->UpdateUploads();
+	}
 
 	m_app->ImageManager->UpdateDynamicImages(m_perBufferResources.curIndex);
 	m_app->GeometryManager->UpdateDynamicGeometries(m_perBufferResources.curIndex);
 
+	// Get next image in the swap chain (back/front buffer) before recording, the frame's commands (and
+	// the back buffer's frame buffer) depend on it. The index does not follow m_perBufferResources.curIndex
+	if (m_headless)
+		m_perBufferResources.backbufferIndex = m_perBufferResources.curIndex;
+	else {
+		W_PROFILE_ZONE(m_app, "WRenderer::AcquireImage");
+		err = m_swapChain->acquireNextImage(m_perBufferResources.presentComplete[m_perBufferResources.curIndex], &m_perBufferResources.backbufferIndex);
+		if (err != VK_SUCCESS && err != VK_SUBOPTIMAL_KHR)
+			return; // the semaphore is not going to be signalled, the fence is still signalled so this index can be retried
+	}
+
+	m_perBufferResources.recordingCommandBuffer = m_perBufferResources.primaryCommandBuffers[m_perBufferResources.curIndex];
+	m_waitForAsyncCompute = false;
+	m_computeToGraphics.Clear();
+	m_graphicsToCompute.Clear();
 	err = vkResetCommandBuffer(m_perBufferResources.primaryCommandBuffers[m_perBufferResources.curIndex], 0);
-	if (err)
+	if (err) {
+		_SubmitEmptyFrame();
 		return;
+	}
 
 	VkCommandBufferBeginInfo cmdBufInfo = vkTools::initializers::commandBufferBeginInfo();
 	err = vkBeginCommandBuffer(m_perBufferResources.primaryCommandBuffers[m_perBufferResources.curIndex], &cmdBufInfo);
-	if (err)
+	if (err) {
+		_SubmitEmptyFrame();
 		return;
+	}
+
+	// resolves the timings of the last frame that used this buffer index (its fence was waited on above)
+	m_gpuProfiler.BeginFrame(m_perBufferResources.primaryCommandBuffers[m_perBufferResources.curIndex], m_perBufferResources.curIndex);
 
 	VkImageSubresourceRange subresourceRange = {};
 	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -142,7 +263,7 @@ void WRenderer::Render() {
 	subresourceRange.levelCount = 1;
 	VkImageMemoryBarrier presentImageBarrier = {};
 	presentImageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	presentImageBarrier.image = m_swapChain->buffers[m_perBufferResources.curIndex].image;
+	presentImageBarrier.image = m_headless ? m_headlessImages[m_perBufferResources.curIndex].img : m_swapChain->buffers[m_perBufferResources.backbufferIndex].image;
 	presentImageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 	presentImageBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 	presentImageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -161,64 +282,393 @@ void WRenderer::Render() {
 		1, &presentImageBarrier
 	);
 
+	// the async compute work goes first, so that it runs alongside as much of the frame as possible
+	bool hasAsyncCompute = false;
+	for (auto it = m_renderStages.begin(); it != m_renderStages.end(); it++)
+		hasAsyncCompute |= ((*it)->m_stageDescription.flags & RENDER_STAGE_FLAG_ASYNC_COMPUTE_RENDER_STAGE) != 0;
+	if (hasAsyncCompute) {
+		WError status = _RecordAsyncCompute();
+		if (!status) {
+			_SubmitEmptyFrame();
+			return;
+		}
+	} else
+		m_pendingComputeAcquires.Clear(); // nothing acquires them, their contents are not carried over
+
+	bool waitedForAsyncCompute = false;
 	WRenderTarget* currentRT = nullptr;
 	for (auto it = m_renderStages.begin(); it != m_renderStages.end(); it++) {
 		WRenderStage* stage = *it;
 		if (stage->m_stageDescription.target != RENDER_STAGE_TARGET_PREVIOUS) {
 			if (currentRT)
 				currentRT->End();
+			// the first render target with a stage that has async compute work waits for it
+			bool waitsForAsyncCompute = false;
+			for (auto groupIt = it; groupIt != m_renderStages.end() && hasAsyncCompute && !waitedForAsyncCompute; groupIt++) {
+				if (groupIt != it && (*groupIt)->m_stageDescription.target != RENDER_STAGE_TARGET_PREVIOUS)
+					break;
+				waitsForAsyncCompute |= ((*groupIt)->m_stageDescription.flags & RENDER_STAGE_FLAG_ASYNC_COMPUTE_RENDER_STAGE) != 0;
+			}
+			if (waitsForAsyncCompute) {
+				waitedForAsyncCompute = true;
+				WError status = _WaitForAsyncCompute();
+				if (!status) {
+					_SubmitEmptyFrame();
+					return;
+				}
+			}
+			// compute work can't be recorded in a render pass, so it is recorded for all the stages sharing
+			// this render target before it begins
+			for (auto computeIt = it; computeIt != m_renderStages.end(); computeIt++) {
+				if (computeIt != it && (*computeIt)->m_stageDescription.target != RENDER_STAGE_TARGET_PREVIOUS)
+					break;
+				W_PROFILE_ZONE(m_app, "WRenderStage::RecordCompute");
+				WError status = (*computeIt)->RecordCompute(this, m_perBufferResources.recordingCommandBuffer);
+				if (!status) {
+					_SubmitEmptyFrame();
+					return;
+				}
+			}
 			currentRT = stage->m_renderTarget;
 			WError status = currentRT->Begin();
-			if (!status)
+			if (!status) {
+				_SubmitEmptyFrame();
 				return;
+			}
 		}
+		W_PROFILE_ZONE(m_app, "WRenderStage::Render");
+		// the render pass may be recorded in secondary command buffers (see
+		// WRenderTarget::RecordInParallel()), so the timestamps go in the render
+		// target's current command buffer
+		uint32_t profilerScope = m_gpuProfiler.BeginScope(currentRT->GetCommnadBuffer(), stage->m_stageDescription.name);
 		WError status = stage->Render(this, currentRT, std::numeric_limits<uint32_t>::max());
-		if (!status)
+		m_gpuProfiler.EndScope(currentRT->GetCommnadBuffer(), profilerScope);
+		if (!status) {
+			_SubmitEmptyFrame();
 			return;
+		}
 	}
 	currentRT->End();
 
-	presentImageBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	presentImageBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	// hand the buffers written by the frame over to the next async compute work (acquired once the frame is submitted)
+	if (m_computeQueue && m_graphicsToCompute.barriers.size() > 0)
+		_RecordBufferHandover(m_perBufferResources.recordingCommandBuffer, m_graphicsToCompute, HANDOVER_RELEASE, m_queueFamilyIndex, m_computeQueueFamilyIndex);
+
+	if (!m_headless) {
+		presentImageBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		presentImageBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+		vkCmdPipelineBarrier(
+			m_perBufferResources.recordingCommandBuffer,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &presentImageBarrier
+		);
+	} else if (m_headlessReadbackBuffers.size() > 0) {
+		// copy the frame to the readback buffer of this buffer index
+		presentImageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		presentImageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		presentImageBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		presentImageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+		vkCmdPipelineBarrier(
+			m_perBufferResources.recordingCommandBuffer,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &presentImageBarrier
+		);
+
+		VkBufferImageCopy region = {};
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = { m_width, m_height, 1 };
+		vkCmdCopyImageToBuffer(
+			m_perBufferResources.recordingCommandBuffer,
+			m_headlessImages[m_perBufferResources.curIndex].img,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			m_headlessReadbackBuffers[m_perBufferResources.curIndex].buf,
+			1, &region
+		);
+
+		VkBufferMemoryBarrier readbackBarrier = {};
+		readbackBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		readbackBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		readbackBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		readbackBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		readbackBarrier.buffer = m_headlessReadbackBuffers[m_perBufferResources.curIndex].buf;
+		readbackBarrier.offset = 0;
+		readbackBarrier.size = VK_WHOLE_SIZE;
+
+		vkCmdPipelineBarrier(
+			m_perBufferResources.recordingCommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_HOST_BIT,
+			0,
+			0, nullptr,
+			1, &readbackBarrier,
+			0, nullptr
+		);
+	}
 
-	vkCmdPipelineBarrier(
-		m_perBufferResources.primaryCommandBuffers[m_perBufferResources.curIndex],
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		0,
-		0, nullptr,
-		0, nullptr,
-		1, &presentImageBarrier
-	);
+	m_gpuProfiler.EndFrame(m_perBufferResources.recordingCommandBuffer);
 
-	err = vkEndCommandBuffer(m_perBufferResources.primaryCommandBuffers[m_perBufferResources.curIndex]);
-	if (err)
+	err = vkEndCommandBuffer(m_perBufferResources.recordingCommandBuffer);
+	if (err) {
+		_SubmitEmptyFrame();
 		return;
+	}
 
-	// Get next image in the swap chain (back/front buffer)
-	uint32_t currentSwapchainIndex;
-	err = m_swapChain->acquireNextImage(m_perBufferResources.presentComplete[m_perBufferResources.curIndex], &currentSwapchainIndex);
-	if (err)
-		return;
+	// Command buffers to be sumitted to the queue. The commands that write to the swap chain image wait for
+	// the presentation engine to release it, the commands before them (and the frame's recording) don't. A
+	// frame that waits for its async compute work is submitted in two batches, only the second one waits
+	VkPipelineStageFlags submitPipelineStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
+	VkPipelineStageFlags computeWaitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	VkSemaphore waitSemaphores[2];
+	VkSemaphore signalSemaphores[2];
+	VkSubmitInfo submitInfos[2] = {};
+	uint32_t numSubmitInfos = 1;
+	submitInfos[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfos[0].commandBufferCount = 1;
+	submitInfos[0].pCommandBuffers = &m_perBufferResources.primaryCommandBuffers[m_perBufferResources.curIndex];
+	submitInfos[0].pWaitDstStageMask = m_headless ? &submitPipelineStages[1] : submitPipelineStages;
+	submitInfos[0].pWaitSemaphores = waitSemaphores;
+	if (!m_headless)
+		waitSemaphores[submitInfos[0].waitSemaphoreCount++] = m_perBufferResources.presentComplete[m_perBufferResources.curIndex];
+	if (m_pendingGraphicsSemaphore && !m_waitForAsyncCompute) {
+		// the last frame signaled it for async compute work this frame doesn't have
+		waitSemaphores[submitInfos[0].waitSemaphoreCount++] = m_pendingGraphicsSemaphore;
+		m_pendingGraphicsSemaphore = VK_NULL_HANDLE;
+	}
+	if (m_waitForAsyncCompute) {
+		submitInfos[1].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfos[1].commandBufferCount = 1;
+		submitInfos[1].pCommandBuffers = &m_perBufferResources.lateCommandBuffers[m_perBufferResources.curIndex];
+		submitInfos[1].waitSemaphoreCount = 1;
+		submitInfos[1].pWaitSemaphores = &m_perBufferResources.computeComplete[m_perBufferResources.curIndex];
+		submitInfos[1].pWaitDstStageMask = &computeWaitStage;
+		numSubmitInfos = 2;
+	}
+	VkSubmitInfo& lastSubmitInfo = submitInfos[numSubmitInfos - 1];
+	lastSubmitInfo.pSignalSemaphores = signalSemaphores;
+	if (!m_headless)
+		signalSemaphores[lastSubmitInfo.signalSemaphoreCount++] = m_perBufferResources.renderComplete[m_perBufferResources.backbufferIndex];
+	if (m_computeQueue && hasAsyncCompute)
+		signalSemaphores[lastSubmitInfo.signalSemaphoreCount++] = m_perBufferResources.graphicsComplete[m_perBufferResources.curIndex];
 
-	// Command buffer to be sumitted to the queue
-	VkPipelineStageFlags submitPipelineStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	{
+		W_PROFILE_ZONE(m_app, "WRenderer::SubmitAndPresent");
+
+		// Submit uploads made during this frame first, so that the frame's commands are ordered after them
+		m_app->MemoryManager->SubmitUploads();
+
+		// the fence is only reset once the frame is sure to be submitted, so that a frame that is not leaves it signalled
+		err = vkResetFences(m_device, 1, &m_perBufferResources.memoryFences[m_perBufferResources.curIndex]);
+		if (err == VK_SUCCESS)
+			err = vkQueueSubmit(m_queue, numSubmitInfos, submitInfos, m_perBufferResources.memoryFences[m_perBufferResources.curIndex]);
+		if (err == VK_SUCCESS) {
+			m_perBufferResources.frameStartTimes[m_perBufferResources.curIndex] = frameStartTime;
+			if (m_computeQueue && hasAsyncCompute)
+				m_pendingGraphicsSemaphore = m_perBufferResources.graphicsComplete[m_perBufferResources.curIndex];
+			if (m_graphicsToCompute.barriers.size() > 0)
+				m_pendingComputeAcquires = m_graphicsToCompute;
+			if (m_headless)
+				m_lastHeadlessFrame = m_perBufferResources.curIndex;
+			else
+				err = m_swapChain->queuePresent(m_queue, m_perBufferResources.backbufferIndex, m_perBufferResources.renderComplete[m_perBufferResources.backbufferIndex]);
+		}
+	}
+
+	// increment the current semaphores index (round-robin) for the next frame
+	m_perBufferResources.curIndex = (m_perBufferResources.curIndex + 1) % m_perBufferResources.presentComplete.size();
+}
+
+void WRenderer::_UpdateFrameLatencies() {
+	for (uint32_t i = 0; i < m_perBufferResources.frameStartTimes.size(); i++) {
+		uint64_t startTime = m_perBufferResources.frameStartTimes[i];
+		if (startTime == 0 || vkGetFenceStatus(m_device, m_perBufferResources.memoryFences[i]) != VK_SUCCESS)
+			continue;
+
+		uint64_t latency = WCPUProfiler::Now() - startTime;
+		m_totalLatency += latency;
+		m_maxLatency = std::max(m_maxLatency, latency);
+		m_numLatencyFrames++;
+		m_perBufferResources.frameStartTimes[i] = 0;
+	}
+}
+
+void WRenderer::_SubmitEmptyFrame() {
+	// the semaphores the frame was going to wait on are waited on (and nothing is signaled for the next async compute work)
+	VkPipelineStageFlags submitPipelineStages[] = { VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
+	VkSemaphore waitSemaphores[3];
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pWaitDstStageMask = submitPipelineStages;
+	submitInfo.pWaitSemaphores = waitSemaphores;
+	if (!m_headless)
+		waitSemaphores[submitInfo.waitSemaphoreCount++] = m_perBufferResources.presentComplete[m_perBufferResources.curIndex];
+	if (m_waitForAsyncCompute)
+		waitSemaphores[submitInfo.waitSemaphoreCount++] = m_perBufferResources.computeComplete[m_perBufferResources.curIndex];
+	if (m_pendingGraphicsSemaphore)
+		waitSemaphores[submitInfo.waitSemaphoreCount++] = m_pendingGraphicsSemaphore;
+	m_waitForAsyncCompute = false;
+	m_pendingGraphicsSemaphore = VK_NULL_HANDLE;
+
+	if (vkResetFences(m_device, 1, &m_perBufferResources.memoryFences[m_perBufferResources.curIndex]) == VK_SUCCESS)
+		vkQueueSubmit(m_queue, 1, &submitInfo, m_perBufferResources.memoryFences[m_perBufferResources.curIndex]);
+}
+
+WError WRenderer::_RecordAsyncCompute() {
+	W_PROFILE_ZONE(m_app, "WRenderer::RecordAsyncCompute");
+
+	VkCommandBuffer cmdBuffer = m_perBufferResources.primaryCommandBuffers[m_perBufferResources.curIndex];
+	if (m_computeQueue) {
+		cmdBuffer = m_perBufferResources.computeCommandBuffers[m_perBufferResources.curIndex];
+		VkCommandBufferBeginInfo cmdBufInfo = vkTools::initializers::commandBufferBeginInfo();
+		cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VkResult err = vkResetCommandBuffer(cmdBuffer, 0);
+		if (err == VK_SUCCESS)
+			err = vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo);
+		if (err != VK_SUCCESS)
+			return WError(W_ERRORUNK);
+	}
+
+	// the buffers handed over by the last frame's graphics work
+	if (m_pendingComputeAcquires.barriers.size() > 0) {
+		_RecordBufferHandover(cmdBuffer, m_pendingComputeAcquires, m_computeQueue ? HANDOVER_ACQUIRE : HANDOVER_BARRIER, m_queueFamilyIndex, m_computeQueueFamilyIndex);
+		m_pendingComputeAcquires.Clear();
+	}
+
+	for (auto it = m_renderStages.begin(); it != m_renderStages.end(); it++) {
+		if (!((*it)->m_stageDescription.flags & RENDER_STAGE_FLAG_ASYNC_COMPUTE_RENDER_STAGE))
+			continue;
+		WError status = (*it)->RecordAsyncCompute(this, cmdBuffer);
+		if (!status)
+			return status;
+	}
+
+	if (!m_computeQueue)
+		return WError(W_SUCCEEDED);
+
+	if (m_computeToGraphics.barriers.size() > 0)
+		_RecordBufferHandover(cmdBuffer, m_computeToGraphics, HANDOVER_RELEASE, m_computeQueueFamilyIndex, m_queueFamilyIndex);
+	if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS)
+		return WError(W_ERRORUNK);
+
+	// the work starts once the last frame's graphics work is done (it may have written what the work reads)
+	VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.pWaitDstStageMask = &submitPipelineStages;
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = &m_perBufferResources.presentComplete[m_perBufferResources.curIndex];
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = &m_perBufferResources.renderComplete[m_perBufferResources.curIndex];
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &m_perBufferResources.primaryCommandBuffers[m_perBufferResources.curIndex];
+	submitInfo.pCommandBuffers = &cmdBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &m_perBufferResources.computeComplete[m_perBufferResources.curIndex];
+	if (m_pendingGraphicsSemaphore) {
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = &m_pendingGraphicsSemaphore;
+		submitInfo.pWaitDstStageMask = &waitStage;
+	}
+	if (vkQueueSubmit(m_computeQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		return WError(W_ERRORUNK);
+	m_pendingGraphicsSemaphore = VK_NULL_HANDLE;
+	m_waitForAsyncCompute = true;
 
-	// Submit to queue
-	if (vkQueueSubmit(m_queue, 1, &submitInfo, m_perBufferResources.memoryFences[m_perBufferResources.curIndex]) == VK_SUCCESS)
-		err = m_swapChain->queuePresent(m_queue, currentSwapchainIndex, m_perBufferResources.renderComplete[m_perBufferResources.curIndex]);
+	return WError(W_SUCCEEDED);
+}
 
-	// increment the current semaphores index (round-robin) for the next frame
-	m_perBufferResources.curIndex = (m_perBufferResources.curIndex + 1) % m_perBufferResources.presentComplete.size();
+WError WRenderer::_WaitForAsyncCompute() {
+	if (!m_waitForAsyncCompute) {
+		// same queue, the work's writes only need to be made visible
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		vkCmdPipelineBarrier(m_perBufferResources.recordingCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+							 1, &memoryBarrier,
+							 0, nullptr,
+							 0, nullptr);
+		return WError(W_SUCCEEDED);
+	}
+
+	// the commands so far are submitted in a batch that doesn't wait for the work, the rest in one that does
+	VkCommandBuffer lateCmdBuffer = m_perBufferResources.lateCommandBuffers[m_perBufferResources.curIndex];
+	VkCommandBufferBeginInfo cmdBufInfo = vkTools::initializers::commandBufferBeginInfo();
+	VkResult err = vkEndCommandBuffer(m_perBufferResources.recordingCommandBuffer);
+	if (err == VK_SUCCESS)
+		err = vkResetCommandBuffer(lateCmdBuffer, 0);
+	if (err == VK_SUCCESS)
+		err = vkBeginCommandBuffer(lateCmdBuffer, &cmdBufInfo);
+	if (err != VK_SUCCESS)
+		return WError(W_ERRORUNK);
+	m_perBufferResources.recordingCommandBuffer = lateCmdBuffer;
+
+	if (m_computeToGraphics.barriers.size() > 0)
+		_RecordBufferHandover(lateCmdBuffer, m_computeToGraphics, HANDOVER_ACQUIRE, m_computeQueueFamilyIndex, m_queueFamilyIndex);
+
+	return WError(W_SUCCEEDED);
+}
+
+void WRenderer::_RecordBufferHandover(VkCommandBuffer cmdBuffer, const BUFFER_HANDOVER& handover, HANDOVER_PART part, uint32_t srcFamily, uint32_t dstFamily) {
+	// a release only makes the writes available and an acquire only makes them visible, the
+	// semaphore between the two queues orders them
+	std::vector<VkBufferMemoryBarrier> barriers = handover.barriers;
+	VkPipelineStageFlags srcStages = handover.srcStages;
+	VkPipelineStageFlags dstStages = handover.dstStages;
+	for (auto& barrier : barriers) {
+		if (part != HANDOVER_BARRIER) {
+			barrier.srcQueueFamilyIndex = srcFamily;
+			barrier.dstQueueFamilyIndex = dstFamily;
+		}
+		if (part == HANDOVER_RELEASE)
+			barrier.dstAccessMask = 0;
+		else if (part == HANDOVER_ACQUIRE)
+			barrier.srcAccessMask = 0;
+	}
+	if (part == HANDOVER_RELEASE)
+		dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	else if (part == HANDOVER_ACQUIRE)
+		srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+	vkCmdPipelineBarrier(cmdBuffer, srcStages, dstStages, 0,
+						 0, nullptr,
+						 (uint32_t)barriers.size(), barriers.data(),
+						 0, nullptr);
+}
+
+void WRenderer::_ResetAsyncComputeState() {
+	m_computeToGraphics.Clear();
+	m_graphicsToCompute.Clear();
+	m_pendingComputeAcquires.Clear();
+	m_pendingGraphicsSemaphore = VK_NULL_HANDLE;
+	m_waitForAsyncCompute = false;
+}
+
+void WRenderer::BUFFER_HANDOVER::Add(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkPipelineStageFlags src, VkAccessFlags srcAccess,
+									 VkPipelineStageFlags dst, VkAccessFlags dstAccess) {
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = buffer;
+	barrier.offset = offset;
+	barrier.size = size;
+	barriers.push_back(barrier);
+	srcStages |= src;
+	dstStages |= dst;
+}
+
+void WRenderer::BUFFER_HANDOVER::Clear() {
+	barriers.clear();
+	srcStages = 0;
+	dstStages = 0;
 }
 
 WError WRenderer::Resize(uint32_t width, uint32_t height) {
@@ -228,6 +678,32 @@ WError WRenderer::Resize(uint32_t width, uint32_t height) {
 	m_width = width;
 	m_height = height;
 
+	if (m_headless) {
+		vkDeviceWaitIdle(m_device);
+
+		uint32_t numBuffers = m_app->GetEngineParam<uint32_t>("bufferingCount");
+		_DestroyHeadlessImages();
+		m_app->MemoryManager->ReleaseAllResources(numBuffers); // reset the buffering count and release all resources
+		if (_CreateHeadlessImages(numBuffers) != VK_SUCCESS)
+			return WError(W_OUTOFMEMORY);
+
+		_ResetAsyncComputeState();
+		if (m_perBufferResources.Create(m_app, numBuffers, numBuffers, m_computeCommandPool))
+			return WError(W_ERRORUNK);
+		WError status = m_gpuProfiler.Initialize(numBuffers);
+		if (!status)
+			return status;
+
+		for (auto it = m_renderStages.begin(); it != m_renderStages.end(); it++) {
+			WError werr = (*it)->Resize(m_width, m_height);
+			vkDeviceWaitIdle(m_device);
+			if (!werr)
+				return werr;
+		}
+
+		return WError(W_SUCCEEDED);
+	}
+
 	//
 	// Setup the swap chain
 	// Allocate a command buffer and record the creation of the swap chain
@@ -244,6 +720,9 @@ WError WRenderer::Resize(uint32_t width, uint32_t height) {
 	if (err)
 		return WError(W_OUTOFMEMORY);
 
+	// the number of frames in flight, the swap chain may have more images than that
+	uint32_t numBuffers = m_app->GetEngineParam<uint32_t>("bufferingCount");
+
 	vkDeviceWaitIdle(m_device);
 
 	// begin command buffer
@@ -252,7 +731,7 @@ WError WRenderer::Resize(uint32_t width, uint32_t height) {
 	err = vkBeginCommandBuffer(cmdBuf, &cmdBufInfo);
 	if (!err) {
 		// record swapchain creation commands
-		m_swapChain->create(cmdBuf, &m_width, &m_height, m_app->GetEngineParam<uint32_t>("bufferingCount"));
+		m_swapChain->create(cmdBuf, &m_width, &m_height, numBuffers);
 
 		// end command buffer
 		err = vkEndCommandBuffer(cmdBuf);
@@ -267,7 +746,7 @@ WError WRenderer::Resize(uint32_t width, uint32_t height) {
 			vkQueueWaitIdle(m_queue);
 		}
 	}
-	m_app->MemoryManager->ReleaseAllResources(m_swapChain->imageCount); // reset the buffering count and release all resources
+	m_app->MemoryManager->ReleaseAllResources(numBuffers); // reset the buffering count and release all resources
 	m_app->MemoryManager->ReleaseCommandBuffer(cmdBuf, 0);
 	if (err)
 		return WError(W_ERRORUNK);
@@ -275,8 +754,12 @@ WError WRenderer::Resize(uint32_t width, uint32_t height) {
 	vkDeviceWaitIdle(m_device);
 
 	// remake our semaphores
-	if (m_perBufferResources.Create(m_app, m_swapChain->imageCount))
+	_ResetAsyncComputeState();
+	if (m_perBufferResources.Create(m_app, numBuffers, m_swapChain->imageCount, m_computeCommandPool))
 		return WError(W_ERRORUNK);
+	WError status = m_gpuProfiler.Initialize(numBuffers);
+	if (!status)
+		return status;
 
 	for (auto it = m_renderStages.begin(); it != m_renderStages.end(); it++) {
 		WError werr = (*it)->Resize(m_width, m_height);
@@ -392,18 +875,144 @@ VulkanSwapChain* WRenderer::GetSwapchain() const {
 	return m_swapChain;
 }
 
+std::vector<VkImageView> WRenderer::GetBackbufferViews() const {
+	std::vector<VkImageView> views;
+	if (m_headless) {
+		for (auto& image : m_headlessImages)
+			views.push_back(image.view);
+	} else {
+		for (uint32_t i = 0; i < m_swapChain->imageCount; i++)
+			views.push_back(m_swapChain->buffers[i].view);
+	}
+	return views;
+}
+
+bool WRenderer::IsHeadless() const {
+	return m_headless;
+}
+
+WError WRenderer::GetHeadlessFrame(const void** pixels, uint32_t* width, uint32_t* height) {
+	if (m_headlessReadbackBuffers.size() == 0 || m_lastHeadlessFrame == std::numeric_limits<uint32_t>::max())
+		return WError(W_NOTVALID);
+
+	VkResult err = vkWaitForFences(m_device, 1, &m_perBufferResources.memoryFences[m_lastHeadlessFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	if (err != VK_SUCCESS)
+		return WError(W_ERRORUNK);
+
+	void* data;
+	err = m_headlessReadbackBuffers[m_lastHeadlessFrame].Map(m_app, &data);
+	if (err != VK_SUCCESS)
+		return WError(W_ERRORUNK);
+	m_headlessReadbackBuffers[m_lastHeadlessFrame].Unmap(m_app); // the memory stays mapped
+
+	*pixels = data;
+	*width = m_width;
+	*height = m_height;
+	return WError(W_SUCCEEDED);
+}
+
+VkResult WRenderer::_CreateHeadlessImages(uint32_t numBuffers) {
+	// same format the back buffer render stage uses for the swap chain images
+	VkFormat format = VK_FORMAT_B8G8R8A8_UNORM;
+	bool readback = m_app->GetEngineParam<bool>("headlessReadback");
+
+	VkImageCreateInfo imageCreateInfo = vkTools::initializers::imageCreateInfo();
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = format;
+	imageCreateInfo.extent = { m_width, m_height, 1 };
+	imageCreateInfo.mipLevels = 1;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VkImageViewCreateInfo viewCreateInfo = vkTools::initializers::imageViewCreateInfo();
+	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewCreateInfo.format = format;
+	viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+	viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	VkBufferCreateInfo bufferCreateInfo = vkTools::initializers::bufferCreateInfo(VK_BUFFER_USAGE_TRANSFER_DST_BIT, (VkDeviceSize)m_width * m_height * 4);
+
+	m_headlessImages.resize(numBuffers);
+	if (readback)
+		m_headlessReadbackBuffers.resize(numBuffers);
+	for (uint32_t i = 0; i < numBuffers; i++) {
+		VkResult err = m_headlessImages[i].Create(m_app, imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, viewCreateInfo);
+		if (err == VK_SUCCESS && readback)
+			err = m_headlessReadbackBuffers[i].Create(m_app, bufferCreateInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (err != VK_SUCCESS) {
+			_DestroyHeadlessImages();
+			return err;
+		}
+	}
+	return VK_SUCCESS;
+}
+
+void WRenderer::_DestroyHeadlessImages() {
+	for (auto& image : m_headlessImages)
+		image.Destroy(m_app);
+	m_headlessImages.clear();
+	for (auto& buffer : m_headlessReadbackBuffers)
+		buffer.Destroy(m_app);
+	m_headlessReadbackBuffers.clear();
+	m_lastHeadlessFrame = std::numeric_limits<uint32_t>::max();
+}
+
+uint32_t WRenderer::GetCurrentBackbufferIndex() const {
+	return m_perBufferResources.backbufferIndex;
+}
+
+bool WRenderer::GetFrameLatencyStatistics(W_FRAME_LATENCY_STATS* stats) const {
+	if (m_numLatencyFrames == 0)
+		return false;
+
+	stats->averageMs = (double)m_totalLatency / (double)m_numLatencyFrames / 1000000.0;
+	stats->maxMs = (double)m_maxLatency / 1000000.0;
+	stats->numFrames = m_numLatencyFrames;
+	return true;
+}
+
+void WRenderer::ResetFrameLatencyStatistics() {
+	m_totalLatency = 0;
+	m_maxLatency = 0;
+	m_numLatencyFrames = 0;
+}
+
 VkCommandBuffer WRenderer::GetCurrentPrimaryCommandBuffer() const {
-	return m_perBufferResources.primaryCommandBuffers[m_perBufferResources.curIndex];
+	return m_perBufferResources.recordingCommandBuffer;
 }
 
 uint32_t WRenderer::GetCurrentBufferingIndex() const {
 	return m_perBufferResources.curIndex;
 }
 
+WGPUProfiler* WRenderer::GetGPUProfiler() {
+	return &m_gpuProfiler;
+}
+
 VkQueue WRenderer::GetQueue() const {
 	return m_queue;
 }
 
+bool WRenderer::HasAsyncCompute() const {
+	return m_computeQueue != VK_NULL_HANDLE;
+}
+
+void WRenderer::ReleaseAsyncComputeBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+										  VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) {
+	// on the graphics queue, the barrier of _WaitForAsyncCompute() covers it
+	if (m_computeQueue)
+		m_computeToGraphics.Add(buffer, offset, size, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, dstStages, dstAccess);
+}
+
+void WRenderer::ReleaseGraphicsBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+									  VkPipelineStageFlags srcStages, VkAccessFlags srcAccess) {
+	m_graphicsToCompute.Add(buffer, offset, size, srcStages, srcAccess, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
 VkSampler WRenderer::GetTextureSampler(W_TEXTURE_SAMPLER_TYPE type) const {
 	UNREFERENCED_PARAMETER(type);
 	return m_sampler;
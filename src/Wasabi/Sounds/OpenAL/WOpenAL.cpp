@@ -89,7 +89,8 @@ void WOpenALSoundComponent::SetListenerPosition(WVector3 pos) {
 }
 
 void WOpenALSoundComponent::SetListenerPosition(WOrientation* pos) {
-	alListener3f(AL_POSITION, pos->GetPositionX(), pos->GetPositionY(), pos->GetPositionZ());
+	WVector3 position = pos->GetWorldPosition();
+	alListener3f(AL_POSITION, position.x, position.y, position.z);
 }
 
 void WOpenALSoundComponent::SetListenerVelocity(float x, float y, float z) {
@@ -112,26 +113,16 @@ void WOpenALSoundComponent::SetListenerOrientation(WVector3 look, WVector3 up) {
 }
 
 void WOpenALSoundComponent::SetListenerOrientation(WOrientation* ori) {
-	float fVals[6];
-	for (uint32_t i = 0; i < 6; i++) {
-		if (i < 3)
-			fVals[i] = ori->GetLVector()[i];
-		else
-			fVals[i] = ori->GetUVector()[i - 3];
-	}
-	alListenerfv(AL_ORIENTATION, fVals);
+	// rows 1 and 2 of the world transformation are the up and look vectors
+	WMatrix world = ori->ComputeWorldTransformation();
+	WVector3 look = WVec3Normalize(WVector3(world(2, 0), world(2, 1), world(2, 2)));
+	WVector3 up = WVec3Normalize(WVector3(world(1, 0), world(1, 1), world(1, 2)));
+	SetListenerOrientation(look, up);
 }
 
 void WOpenALSoundComponent::SetListenerToOrientation(WOrientation* ori) {
-	float fVals[6];
-	for (uint32_t i = 0; i < 6; i++) {
-		if (i < 3)
-			fVals[i] = ori->GetLVector()[i];
-		else
-			fVals[i] = ori->GetUVector()[i - 3];
-	}
-	alListenerfv(AL_ORIENTATION, fVals);
-	alListener3f(AL_POSITION, ori->GetPositionX(), ori->GetPositionY(), ori->GetPositionZ());
+	SetListenerOrientation(ori);
+	SetListenerPosition(ori);
 }
 
 WOpenALSoundManager::WOpenALSoundManager(class Wasabi* const app)
@@ -434,7 +425,8 @@ void WOpenALSound::SetPosition(WVector3 pos) {
 void WOpenALSound::SetPosition(WOrientation* pos) {
 	if (!m_bCheck()) return;
 
-	alSource3f(m_source, AL_POSITION, pos->GetPositionX(), pos->GetPositionY(), pos->GetPositionX());
+	WVector3 position = pos->GetWorldPosition();
+	alSource3f(m_source, AL_POSITION, position.x, position.y, position.z);
 }
 
 void WOpenALSound::SetVelocity(float x, float y, float z) {
@@ -458,14 +450,17 @@ void WOpenALSound::SetDirection(WVector3 look) {
 void WOpenALSound::SetDirection(WOrientation* look) {
 	if (!m_bCheck()) return;
 
-	alSource3f(m_source, AL_DIRECTION, look->GetLVector()[0], look->GetLVector()[1], look->GetLVector()[2]);
+	WVector3 direction = look->GetWorldLVector();
+	alSource3f(m_source, AL_DIRECTION, direction.x, direction.y, direction.z);
 }
 
 void WOpenALSound::SetToOrientation(WOrientation* oriDev) {
 	if (!m_bCheck()) return;
 
-	alSource3f(m_source, AL_POSITION, oriDev->GetPositionX(), oriDev->GetPositionY(), oriDev->GetPositionX());
-	alSource3f(m_source, AL_DIRECTION, oriDev->GetLVector()[0], oriDev->GetLVector()[1], oriDev->GetLVector()[2]);
+	WVector3 position = oriDev->GetWorldPosition();
+	WVector3 direction = oriDev->GetWorldLVector();
+	alSource3f(m_source, AL_POSITION, position.x, position.y, position.z);
+	alSource3f(m_source, AL_DIRECTION, direction.x, direction.y, direction.z);
 }
 
 bool WOpenALSound::Valid() const {
@@ -566,7 +566,7 @@ WMatrix WTerrain::GetWorldMatrix() {
 bool WTerrain::UpdateLocals() {
 	if (m_bAltered) {
 		m_bAltered = false;
-		m_WorldM = ComputeTransformation();
+		m_WorldM = ComputeWorldTransformation();
 
 		return true;
 	}
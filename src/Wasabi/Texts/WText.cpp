@@ -253,8 +253,10 @@ WError WTextComponent::CreateTextFont(uint32_t ID, std::string fontName) {
 		ib[i * 6 + 5] = i * 4 + 2;
 	}
 
+	// the vertices are streamed through frame memory every frame (see Render()),
+	// the geometry only provides the index buffer and vertex layout
 	f.textGeometry = new TextGeometry(m_app);
-	err = f.textGeometry->CreateFromData(vb, num_verts, ib, num_indices, W_GEOMETRY_CREATE_VB_DYNAMIC | W_GEOMETRY_CREATE_VB_REWRITE_EVERY_FRAME);
+	err = f.textGeometry->CreateFromData(vb, num_verts, ib, num_indices, 0);
 	delete[] vb;
 	delete[] ib;
 
@@ -336,12 +338,22 @@ void WTextComponent::Render(WRenderTarget* rt) {
 		W_FONT_OBJECT* font = &m_fonts[f];
 		TextVertex* vb = nullptr;
 		int curvert = 0;
+		WFrameAllocation vertices;
 		if (font->texts.size()) {
+			size_t numChars = 0;
+			for (auto text : font->texts)
+				numChars += text.str.length();
+			if (m_app->MemoryManager->AllocateFrameMemory(numChars * 4 * sizeof(TextVertex), sizeof(float),
+														  m_app->GetCurrentBufferingIndex(), &vertices) != VK_SUCCESS) {
+				font->texts.clear();
+				continue;
+			}
+			vb = (TextVertex*)vertices.data;
+
 			if (!isEffectBound)
 				m_textEffect->Bind(rt);
 			font->textMaterial->Bind(rt);
 			isEffectBound = true;
-			font->textGeometry->MapVertexBuffer((void**)&vb, W_MAP_WRITE);
 		}
 		for (auto text : font->texts) {
 			float x = text.x * 2.0f / scrWidth - 1.0f;
@@ -389,8 +401,7 @@ void WTextComponent::Render(WRenderTarget* rt) {
 			}
 		}
 		if (font->texts.size()) {
-			font->textGeometry->UnmapVertexBuffer(false);
-			font->textGeometry->Draw(rt, (curvert / 4) * 2 * 3);
+			font->textGeometry->Draw(rt, vertices, (curvert / 4) * 2 * 3);
 			font->texts.clear();
 		}
 	}
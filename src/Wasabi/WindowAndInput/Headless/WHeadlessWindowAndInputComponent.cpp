@@ -0,0 +1,125 @@
+#include "Wasabi/WindowAndInput/Headless/WHeadlessWindowAndInputComponent.hpp"
+
+WHeadlessWindowAndInputComponent::WHeadlessWindowAndInputComponent(Wasabi* const app) : WWindowAndInputComponent(app) {
+	m_width = m_height = 0;
+	m_mouseX = m_mouseY = 0.0;
+	m_mouseZ = 0.0;
+	for (uint32_t i = 0; i < sizeof(m_keyDown) / sizeof(m_keyDown[0]); i++)
+		m_keyDown[i] = false;
+}
+
+WError WHeadlessWindowAndInputComponent::Initialize(int width, int height) {
+	if (width <= 0 || height <= 0)
+		return WError(W_INVALIDPARAM);
+
+	m_width = (uint32_t)width;
+	m_height = (uint32_t)height;
+	return WError(W_SUCCEEDED);
+}
+
+bool WHeadlessWindowAndInputComponent::Loop() {
+	return true;
+}
+
+void WHeadlessWindowAndInputComponent::Cleanup() {
+}
+
+void* WHeadlessWindowAndInputComponent::GetPlatformHandle() const {
+	return nullptr;
+}
+
+void* WHeadlessWindowAndInputComponent::GetWindowHandle() const {
+	return nullptr;
+}
+
+VkSurfaceKHR WHeadlessWindowAndInputComponent::GetVulkanSurface() const {
+	return VK_NULL_HANDLE;
+}
+
+void WHeadlessWindowAndInputComponent::GetVulkanRequiredExtensions(std::vector<const char*>& extensions) {
+	UNREFERENCED_PARAMETER(extensions);
+}
+
+void WHeadlessWindowAndInputComponent::ShowErrorMessage(std::string error, bool warning) {
+	std::cerr << m_app->GetEngineParam<const char*>("appName", "Wasabi") << (warning ? " warning: " : " error: ") << error << std::endl;
+}
+
+void WHeadlessWindowAndInputComponent::SetWindowSize(int width, int height) {
+	if (width <= 0 || height <= 0 || ((uint32_t)width == m_width && (uint32_t)height == m_height))
+		return;
+
+	m_width = (uint32_t)width;
+	m_height = (uint32_t)height;
+	if (m_app->Renderer)
+		m_app->Resize(m_width, m_height);
+}
+
+uint32_t WHeadlessWindowAndInputComponent::GetWindowWidth(bool framebuffer) const {
+	UNREFERENCED_PARAMETER(framebuffer);
+	return m_width;
+}
+
+uint32_t WHeadlessWindowAndInputComponent::GetWindowHeight(bool framebuffer) const {
+	UNREFERENCED_PARAMETER(framebuffer);
+	return m_height;
+}
+
+bool WHeadlessWindowAndInputComponent::MouseClick(W_MOUSEBUTTON button) const {
+	return KeyDown((uint32_t)button);
+}
+
+double WHeadlessWindowAndInputComponent::MouseX(W_MOUSEPOSTYPE posT, uint32_t vpID) const {
+	UNREFERENCED_PARAMETER(posT);
+	UNREFERENCED_PARAMETER(vpID);
+	return m_mouseX;
+}
+
+double WHeadlessWindowAndInputComponent::MouseY(W_MOUSEPOSTYPE posT, uint32_t vpID) const {
+	UNREFERENCED_PARAMETER(posT);
+	UNREFERENCED_PARAMETER(vpID);
+	return m_mouseY;
+}
+
+double WHeadlessWindowAndInputComponent::MouseZ() const {
+	return m_mouseZ;
+}
+
+bool WHeadlessWindowAndInputComponent::MouseInScreen(W_MOUSEPOSTYPE posT, uint32_t vpID) const {
+	UNREFERENCED_PARAMETER(posT);
+	UNREFERENCED_PARAMETER(vpID);
+	return m_mouseX >= 0.0 && m_mouseY >= 0.0 && m_mouseX < (double)m_width && m_mouseY < (double)m_height;
+}
+
+void WHeadlessWindowAndInputComponent::SetMousePosition(double x, double y, W_MOUSEPOSTYPE posT) {
+	UNREFERENCED_PARAMETER(posT);
+	m_mouseX = x;
+	m_mouseY = y;
+}
+
+void WHeadlessWindowAndInputComponent::SetMouseZ(double value) {
+	m_mouseZ = value;
+}
+
+void WHeadlessWindowAndInputComponent::ShowCursor(bool bShow) {
+	UNREFERENCED_PARAMETER(bShow);
+}
+
+void WHeadlessWindowAndInputComponent::SetCursorMotionMode(bool bEnable) {
+	UNREFERENCED_PARAMETER(bEnable);
+}
+
+void WHeadlessWindowAndInputComponent::SetQuitKeys(bool escape, bool cmdW) {
+	UNREFERENCED_PARAMETER(escape);
+	UNREFERENCED_PARAMETER(cmdW);
+}
+
+bool WHeadlessWindowAndInputComponent::KeyDown(uint32_t key) const {
+	if (key >= 350)
+		return false;
+	return m_keyDown[key];
+}
+
+void WHeadlessWindowAndInputComponent::InsertRawInput(uint32_t key, bool state) {
+	if (key < 350)
+		m_keyDown[key] = state;
+}
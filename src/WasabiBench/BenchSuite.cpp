@@ -0,0 +1,355 @@
+#include "BenchSuite.hpp"
+
+#include "StaticObjects/StaticObjects.hpp"
+#include "InstancedObjects/InstancedObjects.hpp"
+#include "DeferredLights/DeferredLights.hpp"
+#include "Particles/Particles.hpp"
+#include "Terrain/Terrain.hpp"
+#include "SkinnedCharacters/SkinnedCharacters.hpp"
+#include "LevelStreaming/LevelStreaming.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <new>
+
+namespace {
+	/** Resolution the scenes are rendered at */
+	const uint32_t BENCH_WIDTH = 1280;
+	const uint32_t BENCH_HEIGHT = 720;
+
+	/** Heap allocations made by the process so far, counted by operator new */
+	std::atomic<uint64_t> g_heapAllocations(0);
+	/** Bytes allocated from the heap by the process so far */
+	std::atomic<uint64_t> g_heapAllocatedBytes(0);
+
+	uint32_t GetEnvironmentInt(const char* name, uint32_t fallback) {
+		const char* value = getenv(name);
+		if (!value || atoi(value) < 0)
+			return fallback;
+		return (uint32_t)atoi(value);
+	}
+
+	float GetEnvironmentFloat(const char* name, float fallback) {
+		const char* value = getenv(name);
+		if (!value || atof(value) <= 0.0)
+			return fallback;
+		return (float)atof(value);
+	}
+
+	std::vector<std::string> GetEnvironmentList(const char* name) {
+		std::vector<std::string> list;
+		const char* value = getenv(name);
+		if (value) {
+			std::stringstream stream(value);
+			std::string item;
+			while (std::getline(stream, item, ','))
+				if (item.length() > 0)
+					list.push_back(item);
+		}
+		return list;
+	}
+};
+
+// count every heap allocation of the process (engine included) so that the
+// scenes can report their per-frame allocations
+void* operator new(size_t size) {
+	g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	g_heapAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	void* memory = malloc(size > 0 ? size : 1);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void operator delete(void* memory) noexcept {
+	free(memory);
+}
+
+void operator delete(void* memory, size_t size) noexcept {
+	UNREFERENCED_PARAMETER(size);
+	free(memory);
+}
+
+WasabiBenchmark::WasabiBenchmark() : Wasabi() {
+	m_currentRun = 0;
+	m_sceneFrame = 0;
+	m_currentFrame = 0;
+	m_sceneLoadMs = 0.0;
+	m_sceneWarmupFrames = 0;
+	m_warmupFrames = GetEnvironmentInt("WASABI_BENCH_WARMUP", 30);
+	m_measuredFrames = std::max(GetEnvironmentInt("WASABI_BENCH_FRAMES", 300), 1u);
+	m_scale = GetEnvironmentFloat("WASABI_BENCH_SCALE", 1.0f);
+	const char* output = getenv("WASABI_BENCH_OUTPUT");
+	m_outputFilename = output ? output : "WasabiBench.json";
+	m_warmPipelineCache = false;
+	m_startupMs = 0.0;
+	m_startHeapAllocations = 0;
+	m_startHeapBytes = 0;
+	m_startMemoryStats = {};
+
+	SetEngineParam<const char*>("appName", "WasabiBench");
+	SetEngineParam<bool>("headless", GetEnvironmentInt("WASABI_BENCH_WINDOWED", 0) == 0);
+	SetEngineParam<bool>("enableVulkanValidation", false);
+	SetEngineParam<bool>("enableCPUProfiler", true);
+	SetEngineParam<int>("cpuProfilerWindow", (int)m_measuredFrames);
+	SetEngineParam<bool>("enableGPUProfiler", true);
+	SetEngineParam<int>("gpuProfilerWindow", (int)m_measuredFrames);
+	if (GetEnvironmentInt("WASABI_BENCH_FRAMES_IN_FLIGHT", 0) > 0)
+		SetEngineParam<int>("bufferingCount", (int)GetEnvironmentInt("WASABI_BENCH_FRAMES_IN_FLIGHT", 0));
+	SetEngineParam<bool>("enableTransferQueue", GetEnvironmentInt("WASABI_BENCH_TRANSFER_QUEUE", 1) != 0);
+}
+
+WError WasabiBenchmark::Setup() {
+	this->maxFPS = 0;
+
+	std::vector<WBenchScene*> scenes = {
+		new StaticObjectsScene(this),
+		new InstancedObjectsScene(this),
+		new DeferredLightsScene(this),
+		new ParticlesScene(this),
+		new TerrainScene(this),
+		new SkinnedCharactersScene(this),
+		new LevelStreamingScene(this),
+	};
+	std::vector<std::string> selected = GetEnvironmentList("WASABI_BENCH_SCENES");
+	for (auto scene : scenes) {
+		if (selected.size() == 0 || std::find(selected.begin(), selected.end(), scene->GetName()) != selected.end())
+			m_scenes.push_back(scene);
+		else
+			delete scene;
+	}
+
+	std::vector<uint32_t> threadCounts;
+	for (auto threads : GetEnvironmentList("WASABI_BENCH_THREADS"))
+		if (atoi(threads.c_str()) > 0)
+			threadCounts.push_back((uint32_t)atoi(threads.c_str()));
+	if (threadCounts.size() == 0)
+		threadCounts.push_back(0);
+	for (auto scene : m_scenes)
+		for (auto threads : threadCounts)
+			m_runs.push_back(std::make_pair(scene, threads));
+
+	std::error_code fileError;
+	std::string pipelineCachePath = GetPipelineCachePath();
+	if (GetEnvironmentInt("WASABI_BENCH_COLD_START", 0) != 0 && pipelineCachePath.length() > 0)
+		std::filesystem::remove(pipelineCachePath, fileError);
+	m_warmPipelineCache = pipelineCachePath.length() > 0 && std::filesystem::exists(pipelineCachePath, fileError);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	WError err = StartEngine(BENCH_WIDTH, BENCH_HEIGHT);
+	if (!err)
+		return err;
+	m_startupMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	printf("Engine started in %.3f ms (%s pipeline cache)\n", m_startupMs, m_warmPipelineCache ? "warm" : "cold");
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(GetVulkanPhysicalDevice(), &deviceProperties);
+	m_deviceName = deviceProperties.deviceName;
+
+	LightManager->GetDefaultLight()->Point(0, -1, -1);
+
+	_StartScene(0);
+
+	return WError(W_SUCCEEDED);
+}
+
+bool WasabiBenchmark::Loop(float fDeltaTime) {
+	UNREFERENCED_PARAMETER(fDeltaTime);
+
+	if (m_currentRun >= m_runs.size())
+		return false;
+
+	// Loop() runs before the frame is rendered, so all the frames before this one are complete
+	if (m_sceneFrame == m_sceneWarmupFrames + m_measuredFrames) {
+		_EndMeasurement();
+		if (!_StartScene(m_currentRun + 1))
+			return false;
+	}
+	if (m_sceneFrame == m_sceneWarmupFrames)
+		_BeginMeasurement();
+
+	m_currentFrame = m_sceneFrame++;
+	return true;
+}
+
+void WasabiBenchmark::Cleanup() {
+	SwitchState(nullptr);
+	for (auto scene : m_scenes)
+		delete scene;
+	m_scenes.clear();
+
+	WError err = _WriteResults();
+	if (!err)
+		printf("Failed to write %s: %s\n", m_outputFilename.c_str(), err.AsString().c_str());
+	else
+		printf("Results written to %s\n", m_outputFilename.c_str());
+}
+
+WError WasabiBenchmark::SetupRenderer() {
+	return WInitializeForwardRenderer(this);
+}
+
+float WasabiBenchmark::GetScale() const {
+	return m_scale;
+}
+
+uint32_t WasabiBenchmark::GetSceneFrame() const {
+	return m_currentFrame;
+}
+
+bool WasabiBenchmark::_StartScene(uint32_t index) {
+	SwitchState(nullptr);
+
+	for (m_currentRun = index; m_currentRun < m_runs.size(); m_currentRun++) {
+		WBenchScene* scene = m_runs[m_currentRun].first;
+		uint32_t threads = m_runs[m_currentRun].second;
+		if (threads > 0)
+			JobSystem->Configure(threads - 1);
+		m_sceneFrame = 0;
+		m_currentFrame = 0;
+		m_sceneWarmupFrames = std::max(m_warmupFrames, scene->GetMinimumWarmupFrames());
+
+		// the load time includes compiling the pipelines of the scene's renderer and effects
+		auto start = std::chrono::high_resolution_clock::now();
+		WError err = scene->SetupRenderer();
+		if (err) {
+			SwitchState(scene);
+			err = scene->GetError();
+		}
+		m_sceneLoadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		if (err)
+			return true;
+
+		printf("%s: failed to load: %s\n", scene->GetName(), err.AsString().c_str());
+		W_BENCH_RESULT result = {};
+		result.name = scene->GetName();
+		result.parameters = _GetRunParameters(scene);
+		result.error = err;
+		result.loadMs = m_sceneLoadMs;
+		m_results.push_back(result);
+		SwitchState(nullptr);
+	}
+
+	return false;
+}
+
+void WasabiBenchmark::_BeginMeasurement() {
+	CPUProfiler->ResetStatistics();
+	Renderer->GetGPUProfiler()->ResetStatistics();
+	Renderer->ResetFrameLatencyStatistics();
+	m_startHeapAllocations = g_heapAllocations.load(std::memory_order_relaxed);
+	m_startHeapBytes = g_heapAllocatedBytes.load(std::memory_order_relaxed);
+	m_startMemoryStats = MemoryManager->GetMemoryStats();
+}
+
+void WasabiBenchmark::_EndMeasurement() {
+	WBenchScene* scene = m_runs[m_currentRun].first;
+	WVulkanMemoryStats memoryStats = MemoryManager->GetMemoryStats();
+
+	W_BENCH_RESULT result = {};
+	result.name = scene->GetName();
+	result.parameters = _GetRunParameters(scene);
+	result.error = WError(W_SUCCEEDED);
+	result.loadMs = m_sceneLoadMs;
+	CPUProfiler->GetFrameStatistics(&result.frameTime);
+	Renderer->GetFrameLatencyStatistics(&result.frameLatency);
+	result.cpuZones = CPUProfiler->GetAllZoneStatistics();
+	result.gpuScopes = Renderer->GetGPUProfiler()->GetAllStatistics();
+	result.heapAllocations = g_heapAllocations.load(std::memory_order_relaxed) - m_startHeapAllocations;
+	result.heapAllocatedBytes = g_heapAllocatedBytes.load(std::memory_order_relaxed) - m_startHeapBytes;
+	result.vulkanAllocations = memoryStats.totalAllocations - m_startMemoryStats.totalAllocations;
+	result.vulkanDeviceAllocations = memoryStats.totalDeviceAllocations - m_startMemoryStats.totalDeviceAllocations;
+	result.vulkanUsedBytes = memoryStats.usedBytes;
+	result.vulkanReservedBytes = memoryStats.reservedBytes;
+	m_results.push_back(result);
+
+	printf("%s (%u threads): loaded in %.3f ms, %u frames, avg %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, latency %.3f ms, %.1f allocations/frame\n",
+		result.name.c_str(), JobSystem->GetNumWorkers() + 1, result.loadMs, result.frameTime.numFrames, result.frameTime.averageMs, result.frameTime.medianMs,
+		result.frameTime.p95Ms, result.frameTime.p99Ms, result.frameLatency.averageMs, (double)result.heapAllocations / (double)m_measuredFrames);
+}
+
+std::vector<std::pair<std::string, double>> WasabiBenchmark::_GetRunParameters(WBenchScene* scene) const {
+	std::vector<std::pair<std::string, double>> parameters = scene->GetParameters();
+	parameters.push_back(std::make_pair("threads", (double)(JobSystem->GetNumWorkers() + 1)));
+	return parameters;
+}
+
+WError WasabiBenchmark::_WriteResults() const {
+	std::ofstream file(m_outputFilename, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+		return WError(W_FILENOTFOUND);
+
+	file.precision(4);
+	file << std::fixed;
+	file << "{\n";
+	file << "\t\"device\": \"" << WUtil::EscapeJSON(m_deviceName) << "\",\n";
+	file << "\t\"resolution\": [" << BENCH_WIDTH << ", " << BENCH_HEIGHT << "],\n";
+	file << "\t\"headless\": " << (GetEngineParam<bool>("headless") ? "true" : "false") << ",\n";
+	file << "\t\"warmupFrames\": " << m_warmupFrames << ",\n";
+	file << "\t\"measuredFrames\": " << m_measuredFrames << ",\n";
+	file << "\t\"scale\": " << m_scale << ",\n";
+	file << "\t\"framesInFlight\": " << GetEngineParam<int>("bufferingCount") << ",\n";
+	file << "\t\"transferQueue\": " << (MemoryManager && MemoryManager->HasTransferQueue() ? "true" : "false") << ",\n";
+	file << "\t\"pipelineCache\": \"" << (m_warmPipelineCache ? "warm" : "cold") << "\",\n";
+	file << "\t\"startupMs\": " << m_startupMs << ",\n";
+	file << "\t\"scenes\": [";
+	for (uint32_t i = 0; i < m_results.size(); i++) {
+		const W_BENCH_RESULT& result = m_results[i];
+		file << (i > 0 ? ",\n" : "\n") << "\t\t{\n";
+		file << "\t\t\t\"name\": \"" << WUtil::EscapeJSON(result.name) << "\",\n";
+		file << "\t\t\t\"parameters\": {";
+		for (uint32_t p = 0; p < result.parameters.size(); p++)
+			file << (p > 0 ? ", " : "") << "\"" << WUtil::EscapeJSON(result.parameters[p].first) << "\": " << result.parameters[p].second;
+		file << "},\n";
+		file << "\t\t\t\"loadMs\": " << result.loadMs << ",\n";
+		WError error = result.error;
+		if (!error) {
+			file << "\t\t\t\"error\": \"" << WUtil::EscapeJSON(error.AsString()) << "\"\n";
+			file << "\t\t}";
+			continue;
+		}
+		file << "\t\t\t\"error\": null,\n";
+		file << "\t\t\t\"frames\": " << result.frameTime.numFrames << ",\n";
+		file << "\t\t\t\"droppedZones\": " << result.frameTime.droppedZones << ",\n";
+		file << "\t\t\t\"frameTimeMs\": {"
+			<< "\"mean\": " << result.frameTime.averageMs << ", \"min\": " << result.frameTime.minMs
+			<< ", \"p50\": " << result.frameTime.medianMs << ", \"p95\": " << result.frameTime.p95Ms
+			<< ", \"p99\": " << result.frameTime.p99Ms << ", \"max\": " << result.frameTime.maxMs << "},\n";
+		file << "\t\t\t\"frameLatencyMs\": {"
+			<< "\"mean\": " << result.frameLatency.averageMs << ", \"max\": " << result.frameLatency.maxMs << "},\n";
+		file << "\t\t\t\"cpuZonesMs\": {";
+		for (uint32_t z = 0; z < result.cpuZones.size(); z++) {
+			const W_CPU_ZONE_STATS& zone = result.cpuZones[z].second;
+			file << (z > 0 ? "," : "") << "\n\t\t\t\t\"" << WUtil::EscapeJSON(result.cpuZones[z].first) << "\": {"
+				<< "\"mean\": " << zone.averageMs << ", \"max\": " << zone.maxMs << ", \"callsPerFrame\": " << zone.averageCalls << "}";
+		}
+		file << "\n\t\t\t},\n";
+		file << "\t\t\t\"gpuScopesMs\": {";
+		for (uint32_t s = 0; s < result.gpuScopes.size(); s++) {
+			const W_GPU_TIMING_STATS& scope = result.gpuScopes[s].second;
+			file << (s > 0 ? "," : "") << "\n\t\t\t\t\"" << WUtil::EscapeJSON(result.gpuScopes[s].first) << "\": {"
+				<< "\"mean\": " << scope.averageMs << ", \"min\": " << scope.minMs << ", \"max\": " << scope.maxMs << "}";
+		}
+		file << "\n\t\t\t},\n";
+		file << "\t\t\t\"allocations\": {"
+			<< "\"heapPerFrame\": " << (double)result.heapAllocations / (double)m_measuredFrames
+			<< ", \"heapBytesPerFrame\": " << (double)result.heapAllocatedBytes / (double)m_measuredFrames
+			<< ", \"heapTotal\": " << result.heapAllocations
+			<< ", \"vulkanTotal\": " << result.vulkanAllocations
+			<< ", \"vulkanDeviceTotal\": " << result.vulkanDeviceAllocations
+			<< ", \"vulkanUsedBytes\": " << result.vulkanUsedBytes
+			<< ", \"vulkanReservedBytes\": " << result.vulkanReservedBytes << "}\n";
+		file << "\t\t}";
+	}
+	file << "\n\t]\n}\n";
+
+	return file.good() ? WError(W_SUCCEEDED) : WError(W_ERRORUNK);
+}
+
+Wasabi* WInitialize() {
+	return new WasabiBenchmark();
+}
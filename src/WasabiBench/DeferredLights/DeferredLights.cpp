@@ -0,0 +1,100 @@
+#include "DeferredLights/DeferredLights.hpp"
+
+DeferredLightsScene::DeferredLightsScene(Wasabi* const app) : WBenchScene(app) {
+	m_numBoxes = Scaled(400);
+	m_numPointLights = Scaled(256);
+	m_numSpotLights = Scaled(64);
+	m_plain = nullptr;
+}
+
+std::vector<std::pair<std::string, double>> DeferredLightsScene::GetParameters() const {
+	return {
+		std::make_pair("boxes", (double)m_numBoxes),
+		std::make_pair("pointLights", (double)m_numPointLights),
+		std::make_pair("spotLights", (double)m_numSpotLights),
+	};
+}
+
+void DeferredLightsScene::Load() {
+	SeedRandom(3);
+
+	float extent = 4.0f * ceilf(sqrtf((float)m_numBoxes));
+
+	m_plain = m_app->ObjectManager->CreateObject();
+	if (m_plain) {
+		WGeometry* plainGeometry = new WGeometry(m_app);
+		CheckError(plainGeometry->CreatePlain(extent * 1.2f, 0, 0));
+		CheckError(m_plain->SetGeometry(plainGeometry));
+		plainGeometry->RemoveReference();
+		m_plain->GetMaterials().SetVariable<WColor>("color", WColor(0.4f, 0.4f, 0.4f));
+		m_plain->GetMaterials().SetVariable<int>("isTextured", 0);
+	} else
+		CheckError(WError(W_OUTOFMEMORY));
+
+	WGeometry* boxGeometry = new WGeometry(m_app);
+	CheckError(boxGeometry->CreateCube(2.0f));
+	for (uint32_t i = 0; i < m_numBoxes; i++) {
+		WObject* box = m_app->ObjectManager->CreateObject();
+		if (!box) {
+			CheckError(WError(W_OUTOFMEMORY));
+			break;
+		}
+		CheckError(box->SetGeometry(boxGeometry));
+		box->SetPosition(Random(-0.5f, 0.5f) * extent, Random(0.0f, 2.0f), Random(-0.5f, 0.5f) * extent);
+		box->GetMaterials().SetVariable<WColor>("color", WColor(0.7f, 0.7f, 0.7f));
+		box->GetMaterials().SetVariable<int>("isTextured", 0);
+		m_boxes.push_back(box);
+	}
+	boxGeometry->RemoveReference();
+
+	m_app->LightManager->GetDefaultLight()->Hide();
+
+	for (uint32_t i = 0; i < m_numPointLights + m_numSpotLights; i++) {
+		WLight* light;
+		WVector3 origin(Random(-0.5f, 0.5f) * extent, 0.0f, Random(-0.5f, 0.5f) * extent);
+		if (i < m_numPointLights) {
+			light = new WPointLight(m_app);
+			light->SetRange(Random(4.0f, 8.0f));
+			origin.y = 3.0f;
+		} else {
+			light = new WSpotLight(m_app);
+			light->SetIntensity(2.0f);
+			light->SetRange(Random(15.0f, 30.0f));
+			origin.y = 6.0f;
+		}
+		light->SetColor(WColor(Random(0.2f, 1.0f), Random(0.2f, 1.0f), Random(0.2f, 1.0f)));
+		light->SetPosition(origin);
+		m_lights.push_back(light);
+		m_lightOrigins.push_back(origin);
+	}
+}
+
+void DeferredLightsScene::Update(float fDeltaTime) {
+	UNREFERENCED_PARAMETER(fDeltaTime);
+
+	// every light moves on its own small circle
+	uint32_t frame = GetFrame();
+	for (uint32_t i = 0; i < m_lights.size(); i++) {
+		float angle = (float)frame * 0.02f + (float)i;
+		WVector3 pos = m_lightOrigins[i] + WVector3(cosf(angle), 0.0f, sinf(angle)) * 3.0f;
+		m_lights[i]->SetPosition(pos);
+		if (i >= m_numPointLights)
+			m_lights[i]->Point(WVector3(pos.x, 0.0f, pos.z) + WVector3(sinf(angle), 0.0f, cosf(angle)));
+	}
+
+	float extent = 4.0f * ceilf(sqrtf((float)m_numBoxes));
+	OrbitCamera(WVector3(0, 0, 0), extent * 0.5f, extent * 0.25f, 600);
+}
+
+void DeferredLightsScene::Cleanup() {
+	W_SAFE_REMOVEREF(m_plain);
+	for (auto box : m_boxes)
+		box->RemoveReference();
+	m_boxes.clear();
+	for (auto light : m_lights)
+		light->RemoveReference();
+	m_lights.clear();
+	m_lightOrigins.clear();
+
+	m_app->LightManager->GetDefaultLight()->Show();
+}
@@ -0,0 +1,66 @@
+#include "InstancedObjects/InstancedObjects.hpp"
+
+InstancedObjectsScene::InstancedObjectsScene(Wasabi* const app) : WBenchScene(app) {
+	m_numInstances = Scaled(20000);
+	m_object = nullptr;
+}
+
+std::vector<std::pair<std::string, double>> InstancedObjectsScene::GetParameters() const {
+	return {
+		std::make_pair("instances", (double)m_numInstances),
+		std::make_pair("movingInstances", (double)((m_numInstances + 15) / 16)),
+	};
+}
+
+void InstancedObjectsScene::Load() {
+	SeedRandom(2);
+
+	WGeometry* cube = new WGeometry(m_app);
+	CheckError(cube->CreateCube(1.0f));
+
+	m_object = m_app->ObjectManager->CreateObject();
+	if (!m_object) {
+		CheckError(WError(W_OUTOFMEMORY));
+		cube->RemoveReference();
+		return;
+	}
+	CheckError(m_object->SetGeometry(cube));
+	cube->RemoveReference();
+	CheckError(m_object->InitInstancing(m_numInstances));
+
+	uint32_t side = (uint32_t)ceilf(sqrtf((float)m_numInstances));
+	float extent = 2.0f * (float)side;
+	for (uint32_t i = 0; i < m_numInstances; i++) {
+		WInstance* instance = m_object->CreateInstance();
+		if (!instance) {
+			CheckError(WError(W_OUTOFMEMORY));
+			break;
+		}
+		instance->SetPosition(
+			((float)(i % side) / (float)side - 0.5f) * extent,
+			Random(0.0f, 4.0f),
+			((float)(i / side) / (float)side - 0.5f) * extent);
+		instance->Yaw(Random(0.0f, 360.0f));
+		if (i % 16 == 0)
+			m_movingInstances.push_back(instance);
+	}
+}
+
+void InstancedObjectsScene::Update(float fDeltaTime) {
+	UNREFERENCED_PARAMETER(fDeltaTime);
+
+	// moving instances force the instance data to be re-uploaded every frame
+	uint32_t frame = GetFrame();
+	for (uint32_t i = 0; i < m_movingInstances.size(); i++) {
+		WVector3 pos = m_movingInstances[i]->GetPosition();
+		m_movingInstances[i]->SetPosition(pos.x, 2.0f + 2.0f * sinf((float)(frame + i) * 0.05f), pos.z);
+	}
+
+	float extent = 2.0f * ceilf(sqrtf((float)m_numInstances));
+	OrbitCamera(WVector3(0, 0, 0), extent * 0.25f, 15.0f, 600);
+}
+
+void InstancedObjectsScene::Cleanup() {
+	m_movingInstances.clear();
+	W_SAFE_REMOVEREF(m_object);
+}
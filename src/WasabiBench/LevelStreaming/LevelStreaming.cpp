@@ -0,0 +1,101 @@
+#include "LevelStreaming/LevelStreaming.hpp"
+
+#include <chrono>
+
+namespace {
+	/** Size of the objects' textures */
+	const uint32_t TEXTURE_SIZE = 256;
+	/** Resolution of the objects' spheres */
+	const uint32_t SPHERE_RESOLUTION = 32;
+	/** Spacing of the objects on their grid */
+	const float SPACING = 3.0f;
+};
+
+LevelStreamingScene::LevelStreamingScene(Wasabi* const app) : WBenchScene(app) {
+	m_numObjects = Scaled(500);
+	m_objectsPerFrame = Scaled(4);
+	m_nextObject = 0;
+	m_loadCpuMs = 0.0;
+	m_loadTotalMs = 0.0;
+}
+
+std::vector<std::pair<std::string, double>> LevelStreamingScene::GetParameters() const {
+	return {
+		std::make_pair("objects", (double)m_numObjects),
+		std::make_pair("objectsPerFrame", (double)m_objectsPerFrame),
+		std::make_pair("transferQueue", m_app->MemoryManager->HasTransferQueue() ? 1.0 : 0.0),
+		std::make_pair("loadCpuMs", m_loadCpuMs),
+		std::make_pair("loadTotalMs", m_loadTotalMs),
+	};
+}
+
+WObject* LevelStreamingScene::_CreateObject(uint32_t i) {
+	W_PROFILE_ZONE(m_app, "LevelStreaming");
+
+	// every texture gets its own pixels (a different offset into m_pixels) so that no upload is skipped
+	uint32_t offset = (i * 7919) % (TEXTURE_SIZE * TEXTURE_SIZE);
+	WImage* texture = m_app->ImageManager->CreateImage(&m_pixels[offset], TEXTURE_SIZE, TEXTURE_SIZE, VK_FORMAT_R8G8B8A8_UNORM);
+	WGeometry* sphere = new WGeometry(m_app);
+	CheckError(sphere->CreateSphere(1.0f, SPHERE_RESOLUTION, SPHERE_RESOLUTION, W_GEOMETRY_CREATE_STATIC));
+	WObject* object = m_app->ObjectManager->CreateObject();
+	if (!texture || !object) {
+		CheckError(WError(W_OUTOFMEMORY));
+		W_SAFE_REMOVEREF(texture);
+		W_SAFE_REMOVEREF(object);
+		sphere->RemoveReference();
+		return nullptr;
+	}
+
+	CheckError(object->SetGeometry(sphere));
+	CheckError(object->GetMaterials().SetTexture("diffuseTexture", texture));
+	uint32_t side = (uint32_t)ceilf(sqrtf((float)m_numObjects));
+	uint32_t cell = i % m_numObjects;
+	object->SetPosition(((float)(cell % side) - (float)side / 2.0f) * SPACING, 0.0f, ((float)(cell / side) - (float)side / 2.0f) * SPACING);
+	sphere->RemoveReference();
+	texture->RemoveReference();
+	return object;
+}
+
+void LevelStreamingScene::Load() {
+	SeedRandom(7);
+
+	// twice the texels of a texture, so that textures can start anywhere in the first half
+	m_pixels.resize(TEXTURE_SIZE * TEXTURE_SIZE * 2);
+	for (auto& pixel : m_pixels)
+		pixel = (uint32_t)Random(0.0f, 16777215.0f) | 0xFF000000;
+
+	// the level load: creating the objects (CPU work that overlaps with the uploads on a transfer queue), then
+	// waiting for the uploads that are still in flight
+	auto start = std::chrono::high_resolution_clock::now();
+	for (m_nextObject = 0; m_nextObject < m_numObjects; m_nextObject++)
+		m_objects.push_back(_CreateObject(m_nextObject));
+	auto loaded = std::chrono::high_resolution_clock::now();
+	if (m_app->MemoryManager->WaitForUploads() != VK_SUCCESS)
+		CheckError(WError(W_ERRORUNK));
+	auto uploaded = std::chrono::high_resolution_clock::now();
+	m_loadCpuMs = std::chrono::duration<double, std::milli>(loaded - start).count();
+	m_loadTotalMs = std::chrono::duration<double, std::milli>(uploaded - start).count();
+	printf("%s: loaded %u objects in %.3f ms, uploads done after %.3f ms (%s)\n", GetName(), m_numObjects, m_loadCpuMs, m_loadTotalMs,
+		m_app->MemoryManager->HasTransferQueue() ? "transfer queue" : "graphics queue");
+}
+
+void LevelStreamingScene::Update(float fDeltaTime) {
+	UNREFERENCED_PARAMETER(fDeltaTime);
+
+	// replace the oldest objects, the frame times show the cost of the uploads that don't overlap with rendering
+	for (uint32_t i = 0; i < m_objectsPerFrame; i++, m_nextObject++) {
+		WObject*& object = m_objects[m_nextObject % m_numObjects];
+		W_SAFE_REMOVEREF(object);
+		object = _CreateObject(m_nextObject);
+	}
+
+	float extent = SPACING * ceilf(sqrtf((float)m_numObjects));
+	OrbitCamera(WVector3(0, 0, 0), extent * 0.75f, extent * 0.25f, 600);
+}
+
+void LevelStreamingScene::Cleanup() {
+	for (auto object : m_objects)
+		W_SAFE_REMOVEREF(object);
+	m_objects.clear();
+	m_pixels.clear();
+}
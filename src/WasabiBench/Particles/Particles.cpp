@@ -0,0 +1,73 @@
+#include "Particles/Particles.hpp"
+
+namespace {
+	/** Maximum number of particles a WDefaultParticleBehavior emits per frame */
+	const uint32_t PARTICLES_EMITTED_PER_FRAME = 10;
+};
+
+ParticlesScene::ParticlesScene(Wasabi* const app) : WBenchScene(app) {
+	m_numSystems = Scaled(32);
+	m_maxParticles = 2000;
+}
+
+std::vector<std::pair<std::string, double>> ParticlesScene::GetParameters() const {
+	return {
+		std::make_pair("systems", (double)m_numSystems),
+		std::make_pair("particlesPerSystem", (double)m_maxParticles),
+	};
+}
+
+uint32_t ParticlesScene::GetMinimumWarmupFrames() const {
+	// the systems emit at the per-frame cap until they are full
+	return m_maxParticles / PARTICLES_EMITTED_PER_FRAME + 1;
+}
+
+void ParticlesScene::Load() {
+	SeedRandom(4);
+	std::srand(4);
+
+	WImage* texture = m_app->ImageManager->CreateImage("media/glow.png");
+	if (!texture)
+		CheckError(WError(W_FILENOTFOUND));
+
+	uint32_t side = (uint32_t)ceilf(sqrtf((float)m_numSystems));
+	for (uint32_t i = 0; i < m_numSystems; i++) {
+		WParticles* particles = m_app->ParticlesManager->CreateParticles(i % 2 == 0 ? W_DEFAULT_PARTICLES_ADDITIVE : W_DEFAULT_PARTICLES_ALPHA, m_maxParticles);
+		if (!particles) {
+			CheckError(WError(W_OUTOFMEMORY));
+			break;
+		}
+		// emit at the per-frame cap and never let a particle die, so that the
+		// particle count only depends on the frame index
+		WDefaultParticleBehavior* behavior = (WDefaultParticleBehavior*)particles->GetBehavior();
+		behavior->m_emissionFrequency = 1000000.0f;
+		behavior->m_particleLife = 3600.0f;
+		behavior->m_particleSpawnVelocity = WVector3(0.0f, 0.001f, 0.0f);
+		behavior->m_emissionRandomness = WVector3(4.0f, 4.0f, 4.0f);
+		behavior->m_emissionSize = 0.3f;
+		behavior->m_deathSize = 0.3f;
+		behavior->m_colorGradient = {
+			std::make_pair(WColor(Random(0.2f, 1.0f), Random(0.2f, 1.0f), Random(0.2f, 1.0f), 0.5f), 1.0f),
+			std::make_pair(WColor(1.0f, 1.0f, 1.0f, 0.5f), 0.0f),
+		};
+		particles->SetPosition(((float)(i % side) - (float)side / 2.0f) * 5.0f, 2.0f, ((float)(i / side) - (float)side / 2.0f) * 5.0f);
+		if (texture)
+			CheckError(particles->GetMaterials().SetTexture("diffuseTexture", texture));
+		m_particles.push_back(particles);
+	}
+
+	W_SAFE_REMOVEREF(texture);
+}
+
+void ParticlesScene::Update(float fDeltaTime) {
+	UNREFERENCED_PARAMETER(fDeltaTime);
+
+	float extent = 5.0f * ceilf(sqrtf((float)m_numSystems));
+	OrbitCamera(WVector3(0, 2, 0), extent * 0.75f, extent * 0.25f, 600);
+}
+
+void ParticlesScene::Cleanup() {
+	for (auto particles : m_particles)
+		particles->RemoveReference();
+	m_particles.clear();
+}
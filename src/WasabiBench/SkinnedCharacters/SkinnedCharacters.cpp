@@ -0,0 +1,71 @@
+#include "SkinnedCharacters/SkinnedCharacters.hpp"
+
+SkinnedCharactersScene::SkinnedCharactersScene(Wasabi* const app) : WBenchScene(app) {
+	m_numCharacters = Scaled(100);
+}
+
+std::vector<std::pair<std::string, double>> SkinnedCharactersScene::GetParameters() const {
+	return {
+		std::make_pair("characters", (double)m_numCharacters),
+	};
+}
+
+void SkinnedCharactersScene::Load() {
+	SeedRandom(6);
+
+	WSkeleton* animation = nullptr;
+	WGeometry* geometry = nullptr;
+	WFile file(m_app);
+	WError err = file.Open("media/dante.WSBI");
+	if (err)
+		err = file.LoadAsset<WSkeleton>("dante-animation", &animation, WSkeleton::LoadArgs());
+	if (err)
+		err = file.LoadAsset<WGeometry>("dante-geometry", &geometry, WGeometry::LoadArgs());
+	file.Close();
+	CheckError(err);
+
+	WImage* texture = m_app->ImageManager->CreateImage("media/dante.png");
+	if (!texture)
+		CheckError(WError(W_FILENOTFOUND));
+
+	if (animation && geometry && texture) {
+		uint32_t side = (uint32_t)ceilf(sqrtf((float)m_numCharacters));
+		for (uint32_t i = 0; i < m_numCharacters; i++) {
+			WObject* character = m_app->ObjectManager->CreateObject();
+			if (!character) {
+				CheckError(WError(W_OUTOFMEMORY));
+				break;
+			}
+			m_characters.push_back(character);
+			CheckError(character->SetGeometry(geometry));
+			CheckError(character->GetMaterials().SetTexture("diffuseTexture", texture));
+			character->SetPosition(((float)(i % side) - (float)side / 2.0f) * 4.0f, 0.0f, ((float)(i / side) - (float)side / 2.0f) * 4.0f);
+			character->Yaw(Random(0.0f, 360.0f));
+
+			// every character plays its own copy so that each one updates its own bones
+			WSkeleton* characterAnimation = new WSkeleton(m_app);
+			CheckError(characterAnimation->CopyFrom(animation));
+			CheckError(character->SetAnimation(characterAnimation));
+			characterAnimation->SetPlaySpeed(Random(15.0f, 25.0f));
+			characterAnimation->Loop();
+			characterAnimation->RemoveReference();
+		}
+	}
+
+	W_SAFE_REMOVEREF(animation);
+	W_SAFE_REMOVEREF(geometry);
+	W_SAFE_REMOVEREF(texture);
+}
+
+void SkinnedCharactersScene::Update(float fDeltaTime) {
+	UNREFERENCED_PARAMETER(fDeltaTime);
+
+	float extent = 4.0f * ceilf(sqrtf((float)m_numCharacters));
+	OrbitCamera(WVector3(0, 2, 0), extent * 0.6f, extent * 0.3f, 600);
+}
+
+void SkinnedCharactersScene::Cleanup() {
+	for (auto character : m_characters)
+		character->RemoveReference();
+	m_characters.clear();
+}
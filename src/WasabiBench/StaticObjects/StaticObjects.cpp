@@ -0,0 +1,51 @@
+#include "StaticObjects/StaticObjects.hpp"
+
+StaticObjectsScene::StaticObjectsScene(Wasabi* const app) : WBenchScene(app) {
+	m_numObjects = Scaled(10000);
+}
+
+std::vector<std::pair<std::string, double>> StaticObjectsScene::GetParameters() const {
+	return {
+		std::make_pair("objects", (double)m_numObjects),
+	};
+}
+
+void StaticObjectsScene::Load() {
+	SeedRandom(1);
+
+	WGeometry* cube = new WGeometry(m_app);
+	CheckError(cube->CreateCube(1.0f));
+
+	uint32_t side = (uint32_t)ceilf(sqrtf((float)m_numObjects));
+	float extent = 3.0f * (float)side;
+	for (uint32_t i = 0; i < m_numObjects; i++) {
+		WObject* object = m_app->ObjectManager->CreateObject();
+		if (!object) {
+			CheckError(WError(W_OUTOFMEMORY));
+			break;
+		}
+		CheckError(object->SetGeometry(cube));
+		object->SetPosition(
+			((float)(i % side) / (float)side - 0.5f) * extent,
+			Random(0.0f, 4.0f),
+			((float)(i / side) / (float)side - 0.5f) * extent);
+		object->Yaw(Random(0.0f, 360.0f));
+		m_objects.push_back(object);
+	}
+
+	cube->RemoveReference();
+}
+
+void StaticObjectsScene::Update(float fDeltaTime) {
+	UNREFERENCED_PARAMETER(fDeltaTime);
+
+	// circle inside the grid so that only part of it is in view
+	float extent = 3.0f * ceilf(sqrtf((float)m_numObjects));
+	OrbitCamera(WVector3(0, 0, 0), extent * 0.25f, 15.0f, 600);
+}
+
+void StaticObjectsScene::Cleanup() {
+	for (auto object : m_objects)
+		object->RemoveReference();
+	m_objects.clear();
+}
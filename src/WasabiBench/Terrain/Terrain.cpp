@@ -0,0 +1,43 @@
+#include "Terrain/Terrain.hpp"
+
+TerrainScene::TerrainScene(Wasabi* const app) : WBenchScene(app) {
+	m_size = 256;
+	m_numRings = 7;
+	m_terrain = nullptr;
+}
+
+std::vector<std::pair<std::string, double>> TerrainScene::GetParameters() const {
+	return {
+		std::make_pair("N", (double)m_size),
+		std::make_pair("rings", (double)m_numRings),
+	};
+}
+
+void TerrainScene::Load() {
+	SeedRandom(5);
+
+	m_terrain = m_app->TerrainManager->CreateTerrain(m_size, 1.0f, m_numRings);
+	if (!m_terrain)
+		CheckError(WError(W_OUTOFMEMORY));
+}
+
+void TerrainScene::Update(float fDeltaTime) {
+	UNREFERENCED_PARAMETER(fDeltaTime);
+
+	if (!m_terrain)
+		return;
+
+	// travel fast enough for the clipmap rings to move every frame
+	float t = (float)GetFrame();
+	WVector3 pos(t * 2.0f, 0.0f, 100.0f * sinf(t * 0.01f));
+	pos.y = m_terrain->GetHeight(WVector2(pos.x, pos.z));
+	m_terrain->SetViewpoint(pos);
+
+	WCamera* cam = m_app->CameraManager->GetDefaultCamera();
+	cam->SetPosition(pos + WVector3(0.0f, 20.0f, 0.0f));
+	cam->Point(pos + WVector3(50.0f, 0.0f, 100.0f * cosf(t * 0.01f)));
+}
+
+void TerrainScene::Cleanup() {
+	W_SAFE_REMOVEREF(m_terrain);
+}
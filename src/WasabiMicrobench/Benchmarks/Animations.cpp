@@ -0,0 +1,84 @@
+#include "Benchmarks.hpp"
+
+#include <Wasabi/Wasabi.hpp>
+
+namespace {
+	/** Bones of the synthetic skeleton, a binary tree */
+	const uint32_t NUM_BONES = 64;
+	/** Key frames of the synthetic skeleton's animation */
+	const uint32_t NUM_KEY_FRAMES = 30;
+
+	/** A pose of the synthetic skeleton, the caller deletes the returned base bone */
+	WBone* CreatePose(uint32_t frame) {
+		std::vector<WBone*> bones(NUM_BONES);
+		for (uint32_t i = 0; i < NUM_BONES; i++) {
+			bones[i] = new WBone();
+			bones[i]->SetIndex(i);
+			bones[i]->SetPosition(i % 2 ? 0.5f : -0.5f, 1.0f, 0.0f);
+			bones[i]->Yaw((float)(frame * 7 + i) * 0.1f);
+			bones[i]->Roll((float)(frame * 3 + i) * 0.05f);
+			if (i > 0) {
+				bones[(i - 1) / 2]->AddChild(bones[i]);
+				bones[i]->SetParent(bones[(i - 1) / 2]);
+			}
+		}
+		return bones[0];
+	}
+};
+
+void RunSkeletonBenchmarks(WMicrobenchHarness& harness, Wasabi* app) {
+	if (!harness.IsSelected("WSkeleton::Update (64 bones)"))
+		return;
+
+	// without an image manager the skeleton keeps its bone matrices in CPU memory
+	WSkeleton* animation = new WSkeleton(app);
+	WError err = WError(W_SUCCEEDED);
+	for (uint32_t i = 0; i < NUM_KEY_FRAMES && err; i++) {
+		WBone* pose = CreatePose(i);
+		err = animation->CreateKeyFrame(pose, 1.0f / 30.0f);
+		delete pose;
+	}
+	if (!err) {
+		harness.Skip("WSkeleton::Update (64 bones)", err.AsString());
+		animation->RemoveReference();
+		return;
+	}
+
+	animation->SetPlaySpeed(20.0f);
+	animation->Loop();
+
+	harness.Run("WSkeleton::Update (64 bones)", [animation](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+			animation->Update(1.0f / 60.0f);
+	});
+
+	animation->RemoveReference();
+}
+
+void RunAnimationBenchmarks(WMicrobenchHarness& harness, Wasabi* app) {
+	if (!harness.IsSelected("WSkeleton::Update (dante.WSBI)"))
+		return;
+
+	WSkeleton* animation = nullptr;
+	WFile file(app);
+	WError err = file.Open("media/dante.WSBI");
+	if (err)
+		err = file.LoadAsset<WSkeleton>("dante-animation", &animation, WSkeleton::LoadArgs());
+	file.Close();
+	if (!err || !animation) {
+		harness.Skip("WSkeleton::Update (dante.WSBI)", "media/dante.WSBI: " + err.AsString());
+		W_SAFE_REMOVEREF(animation);
+		return;
+	}
+
+	animation->SetPlaySpeed(20.0f);
+	animation->Loop();
+
+	// unlike the synthetic skeleton, this one writes its bone texture
+	harness.Run("WSkeleton::Update (dante.WSBI)", [animation](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+			animation->Update(1.0f / 60.0f);
+	});
+
+	animation->RemoveReference();
+}
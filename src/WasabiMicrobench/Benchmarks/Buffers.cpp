@@ -0,0 +1,127 @@
+#include "Benchmarks.hpp"
+
+#include <Wasabi/Core/WCore.hpp>
+#include <Wasabi/Memory/WBufferedBuffer.hpp>
+
+#include <cstring>
+
+namespace {
+	/** Size of an update, a typical material UBO */
+	const size_t UPDATE_SIZE = 256;
+	/** Number of updates between frame ring resets, well within the ring's initial size */
+	const uint64_t UPDATES_PER_FRAME = 4096;
+
+	/**
+	 * A host-visible buffer with its own memory, mapped and unmapped on every
+	 * update like WBufferedBuffer used to before buffers were persistently mapped.
+	 */
+	class MapPerUpdateBuffer {
+		VkDevice m_device;
+		VkBuffer m_buffer;
+		VkDeviceMemory m_memory;
+
+	public:
+		MapPerUpdateBuffer(Wasabi* app) : m_device(app->GetVulkanDevice()), m_buffer(VK_NULL_HANDLE), m_memory(VK_NULL_HANDLE) {
+			VkBufferCreateInfo createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			createInfo.size = UPDATE_SIZE;
+			createInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+			createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			if (vkCreateBuffer(m_device, &createInfo, nullptr, &m_buffer) != VK_SUCCESS)
+				return;
+
+			VkMemoryRequirements memReqs = {};
+			vkGetBufferMemoryRequirements(m_device, m_buffer, &memReqs);
+			VkMemoryAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocInfo.allocationSize = memReqs.size;
+			app->MemoryManager->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &allocInfo.memoryTypeIndex);
+			if (vkAllocateMemory(m_device, &allocInfo, nullptr, &m_memory) != VK_SUCCESS)
+				m_memory = VK_NULL_HANDLE;
+			else if (vkBindBufferMemory(m_device, m_buffer, m_memory, 0) != VK_SUCCESS) {
+				vkFreeMemory(m_device, m_memory, nullptr);
+				m_memory = VK_NULL_HANDLE;
+			}
+		}
+
+		~MapPerUpdateBuffer() {
+			if (m_buffer)
+				vkDestroyBuffer(m_device, m_buffer, nullptr);
+			if (m_memory)
+				vkFreeMemory(m_device, m_memory, nullptr);
+		}
+
+		bool Valid() const {
+			return m_memory != VK_NULL_HANDLE;
+		}
+
+		W_NOINLINE void Update(const void* data) {
+			void* mapped;
+			if (vkMapMemory(m_device, m_memory, 0, UPDATE_SIZE, 0, &mapped) == VK_SUCCESS) {
+				memcpy(mapped, data, UPDATE_SIZE);
+				vkUnmapMemory(m_device, m_memory);
+			}
+		}
+	};
+};
+
+void RunBufferBenchmarks(WMicrobenchHarness& harness, Wasabi* app) {
+	char data[UPDATE_SIZE] = {};
+
+	MapPerUpdateBuffer reference(app);
+	if (!reference.Valid())
+		harness.Skip("Buffer update (map per update)", "failed to create the buffer");
+	else {
+		harness.Run("Buffer update (map per update)", [&reference, &data](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; i++) {
+				data[0] = (char)i;
+				reference.Update(data);
+			}
+		});
+	}
+
+	WBufferedBuffer buffer;
+	if (buffer.Create(app, 1, UPDATE_SIZE, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, nullptr, W_MEMORY_HOST_VISIBLE) != VK_SUCCESS)
+		harness.Skip("Buffer update (persistent map)", "failed to create the buffer");
+	else {
+		// the persistent mapping must hand out the same memory every time
+		if (harness.IsSelected("Buffer update (persistent map)")) {
+			void* first = nullptr;
+			void* second = nullptr;
+			buffer.Map(app, 0, &first, W_MAP_WRITE);
+			memset(first, 0x5A, UPDATE_SIZE);
+			buffer.Unmap(app, 0);
+			buffer.Map(app, 0, &second, W_MAP_READ);
+			bool same = first == second && ((unsigned char*)second)[UPDATE_SIZE - 1] == 0x5A;
+			buffer.Unmap(app, 0);
+			harness.Check("Buffer update (persistent map): stable mapping", same);
+		}
+
+		harness.Run("Buffer update (persistent map)", [app, &buffer, &data](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; i++) {
+				void* mapped;
+				data[0] = (char)i;
+				if (buffer.Map(app, 0, &mapped, W_MAP_WRITE) == VK_SUCCESS) {
+					memcpy(mapped, data, UPDATE_SIZE);
+					buffer.Unmap(app, 0);
+				}
+			}
+		});
+	}
+	buffer.Destroy(app);
+
+	// no frame is in flight once the device is idle, so the ring can be reset as often as a frame would reset it
+	vkDeviceWaitIdle(app->GetVulkanDevice());
+	uint32_t bufferIndex = app->GetCurrentBufferingIndex();
+	harness.Run("Buffer update (frame ring)", [app, bufferIndex, &data](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WFrameAllocation allocation;
+			data[0] = (char)i;
+			if (app->MemoryManager->AllocateFrameMemory(UPDATE_SIZE, UPDATE_SIZE, bufferIndex, &allocation) == VK_SUCCESS)
+				memcpy(allocation.data, data, UPDATE_SIZE);
+			if (i % UPDATES_PER_FRAME == UPDATES_PER_FRAME - 1)
+				app->MemoryManager->ReleaseFrameResources(bufferIndex);
+		}
+		app->MemoryManager->ReleaseFrameResources(bufferIndex);
+	});
+}
@@ -0,0 +1,63 @@
+#include "Benchmarks.hpp"
+
+#include <Wasabi/Cameras/WCamera.hpp>
+
+namespace {
+	const uint32_t NUM_BOXES = 4096;
+};
+
+void RunCameraBenchmarks(WMicrobenchHarness& harness, Wasabi* app) {
+	WCamera* camera = new WCamera(app);
+	camera->SetPosition(0.0f, 10.0f, -50.0f);
+	camera->Point(0.0f, 0.0f, 0.0f);
+	camera->UpdateInternals();
+
+	// boxes spread around the camera, roughly a quarter of them in view
+	uint32_t state = 3;
+	auto random = [&state]() {
+		state = state * 1664525u + 1013904223u;
+		return (float)(state >> 8) / (float)(1u << 23) - 1.0f;
+	};
+	std::vector<WVector3> centers(NUM_BOXES), sizes(NUM_BOXES);
+	W_BOUNDING_BOXES boxes;
+	W_BOUNDING_SPHERES spheres;
+	for (uint32_t i = 0; i < NUM_BOXES; i++) {
+		centers[i] = WVector3(random() * 200.0f, random() * 20.0f, random() * 200.0f);
+		sizes[i] = WVector3(1.0f + random() * 0.5f, 1.0f + random() * 0.5f, 1.0f + random() * 0.5f);
+		boxes.Add(centers[i], sizes[i]);
+		spheres.Add(centers[i], WVec3Length(sizes[i]));
+	}
+	std::vector<uint32_t> visible;
+	std::vector<uint8_t> planeCache;
+
+	harness.Run("WCamera::CheckBoxInFrustum", [camera, &centers, &sizes](uint64_t iterations) {
+		uint32_t numVisible = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+			numVisible += camera->CheckBoxInFrustum(centers[i % NUM_BOXES], sizes[i % NUM_BOXES]) ? 1 : 0;
+		WDoNotOptimize(numVisible);
+	});
+
+	// the batch benchmarks cull all the boxes per call and report the time per box
+	harness.Run("WCamera::CheckBoxesInFrustum (per box)", [camera, &boxes, &visible](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i += NUM_BOXES) {
+			camera->CheckBoxesInFrustum(boxes, visible);
+			WDoNotOptimize(visible[0]);
+		}
+	});
+
+	harness.Run("WCamera::CheckBoxesInFrustum cached (per box)", [camera, &boxes, &visible, &planeCache](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i += NUM_BOXES) {
+			camera->CheckBoxesInFrustum(boxes, visible, &planeCache);
+			WDoNotOptimize(visible[0]);
+		}
+	});
+
+	harness.Run("WCamera::CheckSpheresInFrustum (per sphere)", [camera, &spheres, &visible](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i += NUM_BOXES) {
+			camera->CheckSpheresInFrustum(spheres, visible);
+			WDoNotOptimize(visible[0]);
+		}
+	});
+
+	camera->RemoveReference();
+}
@@ -0,0 +1,130 @@
+#include "Benchmarks.hpp"
+
+#include <Wasabi/Wasabi.hpp>
+
+namespace {
+	/** Objects whose materials are bound */
+	const uint32_t NUM_BIND_OBJECTS = 1000;
+	/** Binds recorded into a command buffer before it is reset */
+	const uint64_t BINDS_PER_COMMAND_BUFFER = 4096;
+
+	/** Descriptors of every type a set may need, enough for any material of the default effects */
+	std::vector<VkDescriptorPoolSize> SetSizes() {
+		return {
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 8 },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 8 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 4 },
+		};
+	}
+
+	/** Finds a valid material of an object */
+	WMaterial* FindMaterial(WObject* object) {
+		for (auto it : object->GetMaterials().m_materials)
+			if (it.first->Valid())
+				return it.first;
+		return nullptr;
+	}
+};
+
+void RunDescriptorBenchmarks(WMicrobenchHarness& harness, Wasabi* app) {
+	VkDevice device = app->GetVulkanDevice();
+	uint32_t numSets = app->GetEngineParam<uint32_t>("bufferingCount");
+
+	std::vector<WObject*> objects;
+	std::vector<WMaterial*> materials;
+	for (uint32_t i = 0; i < NUM_BIND_OBJECTS; i++) {
+		WObject* object = app->ObjectManager->CreateObject();
+		if (!object)
+			break;
+		objects.push_back(object);
+		WMaterial* material = FindMaterial(object);
+		if (material)
+			materials.push_back(material);
+	}
+
+	if (materials.size() < NUM_BIND_OBJECTS) {
+		harness.Skip("Descriptor sets (pool per material)", "failed to create the materials");
+		harness.Skip("Descriptor sets (shared pool)", "failed to create the materials");
+		harness.Skip("WMaterial::Bind (1000 materials)", "failed to create the materials");
+	} else {
+		VkDescriptorSetLayout layout = materials[0]->GetEffect()->GetDescriptorSetLayout(materials[0]->GetBindingSet());
+		std::vector<VkDescriptorSet> sets(numSets);
+
+		// a material used to create its own pool for its sets
+		harness.Run("Descriptor sets (pool per material)", [device, layout, numSets, &sets](uint64_t iterations) {
+			std::vector<VkDescriptorPoolSize> sizes = SetSizes();
+			for (auto& size : sizes)
+				size.descriptorCount *= numSets;
+			std::vector<VkDescriptorSetLayout> layouts(numSets, layout);
+			for (uint64_t i = 0; i < iterations; i++) {
+				VkDescriptorPoolCreateInfo poolInfo = {};
+				poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+				poolInfo.poolSizeCount = (uint32_t)sizes.size();
+				poolInfo.pPoolSizes = sizes.data();
+				poolInfo.maxSets = numSets;
+				VkDescriptorPool pool;
+				if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+					continue;
+				VkDescriptorSetAllocateInfo allocInfo = {};
+				allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+				allocInfo.descriptorPool = pool;
+				allocInfo.descriptorSetCount = numSets;
+				allocInfo.pSetLayouts = layouts.data();
+				vkAllocateDescriptorSets(device, &allocInfo, sets.data());
+				vkDestroyDescriptorPool(device, pool, nullptr);
+			}
+		});
+
+		// the sets are freed right away, as the deferred release would a few frames later
+		harness.Run("Descriptor sets (shared pool)", [app, device, layout, numSets, &sets](uint64_t iterations) {
+			std::vector<VkDescriptorPoolSize> sizes = SetSizes();
+			for (uint64_t i = 0; i < iterations; i++) {
+				VkDescriptorPool pool;
+				if (app->MaterialManager->AllocateDescriptorSets(layout, sizes, numSets, sets.data(), &pool) == VK_SUCCESS)
+					vkFreeDescriptorSets(device, pool, numSets, sets.data());
+			}
+		});
+
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = app->GetVulkanGraphicsQueueFamilyIndex();
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) == VK_SUCCESS) {
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = commandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+			if (vkAllocateCommandBuffers(device, &allocInfo, &cmdBuffer) != VK_SUCCESS)
+				cmdBuffer = VK_NULL_HANDLE;
+		}
+
+		if (!cmdBuffer)
+			harness.Skip("WMaterial::Bind (1000 materials)", "failed to create a command buffer");
+		else {
+			// the command buffer is never submitted, it only collects the binds
+			harness.Run("WMaterial::Bind (1000 materials)", [cmdBuffer, &materials](uint64_t iterations) {
+				VkCommandBufferBeginInfo beginInfo = {};
+				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+				vkBeginCommandBuffer(cmdBuffer, &beginInfo);
+				for (uint64_t i = 0; i < iterations; i++) {
+					materials[i % materials.size()]->Bind(cmdBuffer);
+					if (i % BINDS_PER_COMMAND_BUFFER == BINDS_PER_COMMAND_BUFFER - 1) {
+						vkEndCommandBuffer(cmdBuffer);
+						vkBeginCommandBuffer(cmdBuffer, &beginInfo);
+					}
+				}
+				vkEndCommandBuffer(cmdBuffer);
+			});
+		}
+		if (commandPool)
+			vkDestroyCommandPool(device, commandPool, nullptr);
+	}
+
+	for (auto object : objects)
+		object->RemoveReference();
+}
@@ -0,0 +1,228 @@
+#include "Benchmarks.hpp"
+
+#include <Wasabi/Core/WCore.hpp>
+#include <Wasabi/Geometries/WGeometry.hpp>
+#include <Wasabi/Geometries/WGeometryBVH.hpp>
+
+#include <cstddef>
+
+namespace {
+	const uint32_t GRID_SIZE = 128;
+	const uint32_t NUM_RAYS = 1024;
+	const uint32_t SPHERE_RESOLUTION = 64;
+
+	float Random(uint32_t& state) {
+		state = state * 1664525u + 1013904223u;
+		return (float)(state >> 8) / (float)(1u << 23) - 1.0f;
+	}
+
+	/** Rays from above a unit-sized region pointing down through it */
+	void CreateRays(float extent, std::vector<WVector3>& from, std::vector<WVector3>& to) {
+		uint32_t state = 4;
+		from.resize(NUM_RAYS);
+		to.resize(NUM_RAYS);
+		for (uint32_t i = 0; i < NUM_RAYS; i++) {
+			from[i] = WVector3(Random(state), 2.0f, Random(state)) * extent;
+			to[i] = WVector3(Random(state), -2.0f, Random(state)) * extent;
+		}
+	}
+
+	/** Closest (or any) hit of a ray by testing every triangle */
+	bool BruteForceIntersect(const std::vector<WVector3>& vertices, const std::vector<uint32_t>& indices,
+							 WVector3 origin, WVector3 direction, WGeometryBVH::HIT* hit) {
+		bool found = false;
+		for (uint32_t i = 0; i < indices.size() / 3; i++) {
+			float t, u, v;
+			if (WGeometryBVH::IntersectTriangle(origin, direction, vertices[indices[i * 3]], vertices[indices[i * 3 + 1]],
+												vertices[indices[i * 3 + 2]], &t, &u, &v) && (!found || t < hit->t)) {
+				found = true;
+				hit->triangle = i;
+				hit->t = t;
+				hit->u = u;
+				hit->v = v;
+			}
+		}
+		return found;
+	}
+
+	/**
+	 * Whether the BVH finds the same closest hits as brute force (up to ties
+	 * on shared edges, so only the distances are compared) and any-hit
+	 * queries hit whenever brute force does, on a triangle the ray really
+	 * hits.
+	 */
+	void CheckAgainstBruteForce(WMicrobenchHarness& harness, const std::string& name, const WGeometryBVH& bvh,
+								const std::vector<WVector3>& vertices, const std::vector<uint32_t>& indices,
+								const std::vector<WVector3>& from, const std::vector<WVector3>& to) {
+		bool closestMatches = true, anyMatches = true;
+		uint32_t numHits = 0;
+		for (uint32_t i = 0; i < from.size(); i++) {
+			WVector3 direction = to[i] - from[i];
+			WGeometryBVH::HIT expected, closest, any;
+			bool expectedHit = BruteForceIntersect(vertices, indices, from[i], direction, &expected);
+			bool closestHit = bvh.Intersect(from[i], direction, false, &closest);
+			bool anyHit = bvh.Intersect(from[i], direction, true, &any);
+			numHits += expectedHit ? 1 : 0;
+
+			closestMatches &= closestHit == expectedHit && (!expectedHit || fabsf(closest.t - expected.t) <= 1e-5f * fmaxf(1.0f, expected.t));
+			if (anyHit != expectedHit)
+				anyMatches = false;
+			else if (anyHit) {
+				WGeometryBVH::HIT check;
+				anyMatches &= any.triangle < indices.size() / 3 && WGeometryBVH::IntersectTriangle(from[i], direction,
+					vertices[indices[any.triangle * 3]], vertices[indices[any.triangle * 3 + 1]], vertices[indices[any.triangle * 3 + 2]],
+					&check.t, &check.u, &check.v) && fabsf(check.t - any.t) <= 1e-5f * fmaxf(1.0f, any.t);
+			}
+		}
+		// the rays cover more than the grid, so some of them must miss for the check to mean anything
+		harness.Check(name + ": closest hit matches brute force", closestMatches && numHits > 0 && numHits < from.size());
+		harness.Check(name + ": any hit matches brute force", anyMatches);
+	}
+};
+
+void RunGeometryBVHBenchmarks(WMicrobenchHarness& harness) {
+	// a bumpy grid of GRID_SIZE x GRID_SIZE quads
+	uint32_t state = 5;
+	std::vector<WVector3> vertices((GRID_SIZE + 1) * (GRID_SIZE + 1));
+	for (uint32_t z = 0; z <= GRID_SIZE; z++)
+		for (uint32_t x = 0; x <= GRID_SIZE; x++)
+			vertices[z * (GRID_SIZE + 1) + x] = WVector3((float)x / (float)GRID_SIZE * 2.0f - 1.0f, Random(state) * 0.05f, (float)z / (float)GRID_SIZE * 2.0f - 1.0f);
+	std::vector<uint32_t> indices;
+	for (uint32_t z = 0; z < GRID_SIZE; z++) {
+		for (uint32_t x = 0; x < GRID_SIZE; x++) {
+			uint32_t v = z * (GRID_SIZE + 1) + x;
+			indices.insert(indices.end(), { v, v + GRID_SIZE + 1, v + 1, v + 1, v + GRID_SIZE + 1, v + GRID_SIZE + 2 });
+		}
+	}
+	uint32_t numTriangles = (uint32_t)indices.size() / 3;
+
+	std::vector<WVector3> from, to;
+	CreateRays(1.0f, from, to);
+
+	WGeometryBVH bvh;
+	harness.Run("WGeometryBVH::Build (32k triangles)", [&bvh, &vertices, &indices, numTriangles](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+			bvh.Build(vertices.data(), sizeof(WVector3), 0, indices.data(), numTriangles);
+	});
+
+	if (!bvh.Valid())
+		bvh.Build(vertices.data(), sizeof(WVector3), 0, indices.data(), numTriangles);
+
+	if (harness.IsSelected("WGeometryBVH::Intersect (closest hit)")) {
+		std::vector<WVector3> checkFrom, checkTo;
+		CreateRays(1.25f, checkFrom, checkTo);
+		CheckAgainstBruteForce(harness, "WGeometryBVH::Intersect", bvh, vertices, indices, checkFrom, checkTo);
+
+		// a refit keeps the topology, the queries must still be exact once the grid is rippled and stretched
+		WGeometryBVH refitted;
+		refitted.Build(vertices.data(), sizeof(WVector3), 0, indices.data(), numTriangles);
+		std::vector<WVector3> moved = vertices;
+		for (auto& vertex : moved)
+			vertex = WVector3(vertex.x * 1.1f, vertex.y + 0.2f * sinf(vertex.x * 6.0f) * cosf(vertex.z * 4.0f), vertex.z * 0.9f);
+		refitted.Refit(moved.data(), sizeof(WVector3), 0);
+		CheckAgainstBruteForce(harness, "WGeometryBVH::Intersect after Refit", refitted, moved, indices, checkFrom, checkTo);
+	}
+
+	harness.Run("WGeometryBVH::Intersect (closest hit)", [&bvh, &from, &to](uint64_t iterations) {
+		WGeometryBVH::HIT hit;
+		uint32_t numHits = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+			numHits += bvh.Intersect(from[i % NUM_RAYS], to[i % NUM_RAYS] - from[i % NUM_RAYS], false, &hit) ? 1 : 0;
+		WDoNotOptimize(numHits);
+	});
+
+	harness.Run("WGeometryBVH::Intersect (any hit)", [&bvh, &from, &to](uint64_t iterations) {
+		WGeometryBVH::HIT hit;
+		uint32_t numHits = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+			numHits += bvh.Intersect(from[i % NUM_RAYS], to[i % NUM_RAYS] - from[i % NUM_RAYS], true, &hit) ? 1 : 0;
+		WDoNotOptimize(numHits);
+	});
+}
+
+void RunGeometryIntersectBenchmarks(WMicrobenchHarness& harness) {
+	// a UV sphere like WGeometry::CreateSphere() makes, but in CPU memory
+	struct VERTEX {
+		WVector3 position;
+		WVector2 uv;
+	};
+	std::vector<VERTEX> vertices;
+	for (uint32_t ring = 0; ring <= SPHERE_RESOLUTION; ring++) {
+		float phi = (float)ring / (float)SPHERE_RESOLUTION * W_PI;
+		for (uint32_t segment = 0; segment <= SPHERE_RESOLUTION; segment++) {
+			float theta = (float)segment / (float)SPHERE_RESOLUTION * 2.0f * W_PI;
+			VERTEX vertex;
+			vertex.position = WVector3(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+			vertex.uv = WVector2((float)segment / (float)SPHERE_RESOLUTION, (float)ring / (float)SPHERE_RESOLUTION);
+			vertices.push_back(vertex);
+		}
+	}
+	std::vector<uint32_t> indices;
+	for (uint32_t ring = 0; ring < SPHERE_RESOLUTION; ring++) {
+		for (uint32_t segment = 0; segment < SPHERE_RESOLUTION; segment++) {
+			uint32_t v = ring * (SPHERE_RESOLUTION + 1) + segment;
+			indices.insert(indices.end(), { v, v + 1, v + SPHERE_RESOLUTION + 1, v + 1, v + SPHERE_RESOLUTION + 2, v + SPHERE_RESOLUTION + 1 });
+		}
+	}
+	uint32_t numTriangles = (uint32_t)indices.size() / 3;
+	uint32_t uvOffset = (uint32_t)offsetof(VERTEX, uv);
+
+	WGeometryBVH bvh;
+	bvh.Build(vertices.data(), sizeof(VERTEX), 0, indices.data(), numTriangles);
+
+	std::vector<WVector3> from, to;
+	CreateRays(0.8f, from, to);
+
+	// the hierarchy and testing every triangle must report the same hits and UVs
+	if (harness.IsSelected("WGeometry::Intersect")) {
+		bool matches = true;
+		uint32_t numHits = 0;
+		for (uint32_t i = 0; i < NUM_RAYS; i++) {
+			WVector3 point, expectedPoint;
+			WVector2 uv, expectedUV;
+			bool hit = WGeometry::IntersectVertices(vertices.data(), sizeof(VERTEX), 0, uvOffset, indices.data(), numTriangles,
+													&bvh, from[i], to[i] - from[i], &point, &uv);
+			bool expectedHit = WGeometry::IntersectVertices(vertices.data(), sizeof(VERTEX), 0, uvOffset, indices.data(), numTriangles,
+															nullptr, from[i], to[i] - from[i], &expectedPoint, &expectedUV);
+			numHits += expectedHit ? 1 : 0;
+			matches &= hit == expectedHit && (!hit || (WVec3Length(point - expectedPoint) <= 1e-4f && WVec2Length(uv - expectedUV) <= 1e-3f));
+		}
+		harness.Check("WGeometry::Intersect matches brute force", matches && numHits > 0);
+	}
+
+	harness.Run("WGeometry::Intersect", [&vertices, &indices, &bvh, numTriangles, uvOffset, &from, &to](uint64_t iterations) {
+		WVector3 point;
+		WVector2 uv;
+		uint32_t numHits = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+			numHits += WGeometry::IntersectVertices(vertices.data(), sizeof(VERTEX), 0, uvOffset, indices.data(), numTriangles,
+													&bvh, from[i % NUM_RAYS], to[i % NUM_RAYS] - from[i % NUM_RAYS], &point, &uv) ? 1 : 0;
+		WDoNotOptimize(numHits);
+	});
+}
+
+void RunGeometryBenchmarks(WMicrobenchHarness& harness, Wasabi* app) {
+	WGeometry* sphere = new WGeometry(app);
+	WError err = sphere->CreateSphere(1.0f, SPHERE_RESOLUTION, SPHERE_RESOLUTION);
+	if (!err) {
+		harness.Skip("WGeometry::Intersect (device geometry)", err.AsString());
+		sphere->RemoveReference();
+		return;
+	}
+
+	std::vector<WVector3> from, to;
+	CreateRays(0.8f, from, to);
+
+	// the first query builds the geometry's BVH, keep it out of the measurement
+	sphere->Intersect(from[0], to[0]);
+
+	harness.Run("WGeometry::Intersect (device geometry)", [sphere, &from, &to](uint64_t iterations) {
+		WVector3 point;
+		uint32_t numHits = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+			numHits += sphere->Intersect(from[i % NUM_RAYS], to[i % NUM_RAYS], &point) ? 1 : 0;
+		WDoNotOptimize(numHits);
+	});
+
+	sphere->RemoveReference();
+}
@@ -0,0 +1,240 @@
+#include "Benchmarks.hpp"
+
+#include <Wasabi/Core/WCore.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <unordered_set>
+
+namespace {
+	const uint32_t NUM_ENTITIES = 100000;
+	/** Number of buckets of the reference manager */
+	const uint32_t REFERENCE_TABLE_SIZE = 512;
+
+	class BenchEntityManager;
+
+	/** Minimal managed entity, registers itself like the engine's entities do */
+	class BenchEntity : public WBase {
+		BenchEntityManager* m_manager;
+
+	public:
+		BenchEntity(Wasabi* const app, BenchEntityManager* manager, uint32_t ID);
+		~BenchEntity();
+
+		virtual std::string GetTypeName() const { return "BenchEntity"; }
+		virtual void SetID(uint32_t newID);
+		virtual void SetName(std::string newName);
+		virtual bool Valid() const { return true; }
+	};
+
+	class BenchEntityManager : public WManager<BenchEntity> {
+		virtual std::string GetTypeName() const { return "BenchEntity"; }
+
+	public:
+		BenchEntityManager(Wasabi* const app) : WManager<BenchEntity>(app) {}
+	};
+
+	BenchEntity::BenchEntity(Wasabi* const app, BenchEntityManager* manager, uint32_t ID) : WBase(app, ID) {
+		m_manager = manager;
+		m_manager->AddEntity(this);
+	}
+
+	BenchEntity::~BenchEntity() {
+		m_manager->RemoveEntity(this);
+	}
+
+	void BenchEntity::SetID(uint32_t newID) {
+		m_manager->RemoveEntity(this);
+		m_ID = newID;
+		m_manager->AddEntity(this);
+	}
+
+	void BenchEntity::SetName(std::string newName) {
+		std::string oldName = m_name;
+		m_name = newName;
+		m_manager->OnEntityNameChanged(this, oldName);
+	}
+
+	/**
+	 * The entity storage WManager had before the slot map, as a baseline: the
+	 * entities are hashed by ID into fixed buckets, and GetEntityByIndex()
+	 * walks the buckets.
+	 */
+	class ReferenceBucketManager {
+		std::vector<BenchEntity*> m_entities[REFERENCE_TABLE_SIZE];
+
+		static uint32_t Hash(uint32_t ID) {
+			return ID == 0 ? 0 : std::max(ID % REFERENCE_TABLE_SIZE, 1u);
+		}
+
+	public:
+		W_NOINLINE void AddEntity(BenchEntity* entity) {
+			m_entities[Hash(entity->GetID())].push_back(entity);
+		}
+
+		W_NOINLINE bool RemoveEntity(BenchEntity* entity) {
+			std::vector<BenchEntity*>& bucket = m_entities[Hash(entity->GetID())];
+			for (uint32_t i = 0; i < bucket.size(); i++) {
+				if (bucket[i] == entity) {
+					bucket.erase(bucket.begin() + i);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		W_NOINLINE BenchEntity* GetEntity(uint32_t ID) const {
+			uint32_t tableIndex = Hash(ID);
+			if (tableIndex)
+				for (uint32_t i = 0; i < m_entities[tableIndex].size(); i++)
+					if (m_entities[tableIndex][i]->GetID() == ID)
+						return m_entities[tableIndex][i];
+			return nullptr;
+		}
+
+		W_NOINLINE BenchEntity* GetEntityByIndex(uint32_t index) const {
+			for (uint32_t j = 0; j < REFERENCE_TABLE_SIZE; j++) {
+				if (index < m_entities[j].size())
+					return m_entities[j][index];
+				index -= static_cast<uint32_t>(m_entities[j].size());
+			}
+			return nullptr;
+		}
+
+		uint32_t GetEntitiesCount() const {
+			uint32_t size = 0;
+			for (uint32_t j = 0; j < REFERENCE_TABLE_SIZE; j++)
+				size += static_cast<uint32_t>(m_entities[j].size());
+			return size;
+		}
+	};
+
+	/** Silences std::cout (the managers log every addition and removal) while in scope */
+	class QuietScope {
+		std::streambuf* m_buffer;
+
+	public:
+		QuietScope() { m_buffer = std::cout.rdbuf(nullptr); }
+		~QuietScope() {
+			std::cout.rdbuf(m_buffer);
+			std::cout.clear();
+		}
+	};
+};
+
+void RunManagerBenchmarks(WMicrobenchHarness& harness, Wasabi* app) {
+	QuietScope quiet;
+
+	BenchEntityManager manager(app);
+	std::vector<BenchEntity*> entities(NUM_ENTITIES);
+	std::vector<std::string> names(NUM_ENTITIES);
+	std::vector<WManagerHandle> handles(NUM_ENTITIES);
+	ReferenceBucketManager reference;
+	for (uint32_t i = 0; i < NUM_ENTITIES; i++) {
+		entities[i] = new BenchEntity(app, &manager, i + 1);
+		names[i] = "entity" + std::to_string(i);
+		entities[i]->SetName(names[i]);
+		handles[i] = manager.GetHandle(entities[i]);
+		reference.AddEntity(entities[i]);
+	}
+
+	// removing entities moves other entities to new indices, iterating backwards (as the engine's
+	// update loops do) still visits every entity that stays registered exactly once
+	if (harness.IsSelected("WManager iterate")) {
+		std::unordered_set<BenchEntity*> visited;
+		bool once = true;
+		for (uint32_t i = manager.GetEntitiesCount(); i-- > 0;) {
+			BenchEntity* entity = manager.GetEntityByIndex(i);
+			once &= visited.insert(entity).second;
+			if (i % 3 == 0)
+				manager.RemoveEntity(entity);
+		}
+		uint32_t numRemaining = manager.GetEntitiesCount();
+		for (auto entity : manager)
+			once &= visited.find(entity) != visited.end();
+		harness.Check("WManager iterate: remove while iterating backwards", once && visited.size() == NUM_ENTITIES &&
+			numRemaining == NUM_ENTITIES - (NUM_ENTITIES + 2) / 3);
+
+		// register them again, with their names and new handles
+		for (uint32_t i = 0; i < NUM_ENTITIES; i++) {
+			if (manager.GetEntity(handles[i]) == entities[i])
+				continue;
+			manager.AddEntity(entities[i]);
+			manager.OnEntityNameChanged(entities[i], "");
+			handles[i] = manager.GetHandle(entities[i]);
+		}
+	}
+
+	harness.Run("WManager::GetEntity(ID)", [&manager](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			BenchEntity* entity = manager.GetEntity((uint32_t)((i * 7919) % NUM_ENTITIES) + 1);
+			WDoNotOptimize(entity);
+		}
+	});
+
+	harness.Run("WManager::GetEntity(ID) (bucket reference)", [&reference](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			BenchEntity* entity = reference.GetEntity((uint32_t)((i * 7919) % NUM_ENTITIES) + 1);
+			WDoNotOptimize(entity);
+		}
+	});
+
+	harness.Run("WManager::GetEntity(name)", [&manager, &names](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			BenchEntity* entity = manager.GetEntity(names[(i * 7919) % NUM_ENTITIES]);
+			WDoNotOptimize(entity);
+		}
+	});
+
+	harness.Run("WManager::GetEntity(handle)", [&manager, &handles](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			BenchEntity* entity = manager.GetEntity(handles[(i * 7919) % NUM_ENTITIES]);
+			WDoNotOptimize(entity);
+		}
+	});
+
+	// removing an entity forgets its name, so this runs after the lookups
+	harness.Run("WManager::AddEntity+RemoveEntity", [&manager, &entities](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			BenchEntity* entity = entities[(i * 7919) % NUM_ENTITIES];
+			manager.RemoveEntity(entity);
+			manager.AddEntity(entity);
+		}
+	});
+
+	harness.Run("WManager::AddEntity+RemoveEntity (bucket reference)", [&reference, &entities](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			BenchEntity* entity = entities[(i * 7919) % NUM_ENTITIES];
+			reference.RemoveEntity(entity);
+			reference.AddEntity(entity);
+		}
+	});
+
+	// one operation is a visit of a single entity
+	harness.Run("WManager iterate", [&manager](uint64_t iterations) {
+		uint64_t visited = 0;
+		while (visited < iterations) {
+			for (auto entity : manager) {
+				WDoNotOptimize(entity);
+				if (++visited == iterations)
+					break;
+			}
+		}
+	});
+
+	// the engine's loops used GetEntityByIndex(), which walked the buckets on every call
+	harness.Run("WManager iterate (bucket reference)", [&reference](uint64_t iterations) {
+		uint64_t visited = 0;
+		uint32_t numEntities = reference.GetEntitiesCount();
+		while (visited < iterations) {
+			for (uint32_t i = 0; i < numEntities; i++) {
+				WDoNotOptimize(reference.GetEntityByIndex(i));
+				if (++visited == iterations)
+					break;
+			}
+		}
+	});
+
+	for (auto entity : entities)
+		entity->RemoveReference();
+}
@@ -0,0 +1,93 @@
+#include "Benchmarks.hpp"
+
+#include <Wasabi/Wasabi.hpp>
+
+namespace {
+	/** Objects whose material collections are updated every frame */
+	const uint32_t NUM_FRAME_OBJECTS = 1000;
+	/** Variables set per frame, spread evenly over the objects */
+	const uint32_t SETS_PER_FRAME = 100000;
+};
+
+void RunMaterialBenchmarks(WMicrobenchHarness& harness, Wasabi* app) {
+	// an object gets a material for every effect of the renderer's object fragments
+	WObject* object = app->ObjectManager->CreateObject();
+	WMaterial* material = nullptr;
+	if (object) {
+		for (auto it : object->GetMaterials().m_materials) {
+			if (it.first->GetVariableHandle("color").Valid()) {
+				material = it.first;
+				break;
+			}
+		}
+	}
+	if (!material) {
+		harness.Skip("WMaterial::SetVariableData (name)", "no material with a color variable");
+		harness.Skip("WMaterial::SetVariableData (handle)", "no material with a color variable");
+		W_SAFE_REMOVEREF(object);
+		return;
+	}
+
+	harness.Run("WMaterial::SetVariableData (name)", [material](uint64_t iterations) {
+		WColor color(0.5f, 0.5f, 0.5f, 1.0f);
+		for (uint64_t i = 0; i < iterations; i++) {
+			color.r = (float)(i & 0xFF) / 255.0f;
+			material->SetVariableData("color", &color, sizeof(WColor));
+		}
+	});
+
+	WMaterialVariableHandle handle = material->GetVariableHandle("color");
+	harness.Run("WMaterial::SetVariableData (handle)", [material, &handle](uint64_t iterations) {
+		WColor color(0.5f, 0.5f, 0.5f, 1.0f);
+		for (uint64_t i = 0; i < iterations; i++) {
+			color.r = (float)(i & 0xFF) / 255.0f;
+			material->SetVariableData(handle, &color, sizeof(WColor));
+		}
+	});
+
+	// a frame's worth of variable sets through material collections, as a game updating its objects would
+	std::vector<WObject*> objects;
+	for (uint32_t i = 0; i < NUM_FRAME_OBJECTS; i++) {
+		WObject* frameObject = app->ObjectManager->CreateObject();
+		if (!frameObject)
+			break;
+		objects.push_back(frameObject);
+	}
+	if (objects.size() < NUM_FRAME_OBJECTS) {
+		harness.Skip("WMaterialCollection::SetVariable (100k/frame, name)", "failed to create the objects");
+		harness.Skip("WMaterialCollection::SetVariable (100k/frame, handle)", "failed to create the objects");
+	} else {
+		const uint32_t setsPerObject = SETS_PER_FRAME / NUM_FRAME_OBJECTS;
+		harness.Run("WMaterialCollection::SetVariable (100k/frame, name)", [&objects, setsPerObject](uint64_t iterations) {
+			WColor color(0.5f, 0.5f, 0.5f, 1.0f);
+			for (uint64_t i = 0; i < iterations; i++) {
+				for (auto frameObject : objects) {
+					for (uint32_t j = 0; j < setsPerObject; j++) {
+						color.r = (float)(j & 0xFF) / 255.0f;
+						frameObject->GetMaterials().SetVariable<WColor>("color", color);
+					}
+				}
+			}
+		});
+
+		// the handles are resolved once, like an object would when its materials are set
+		std::vector<WMaterialCollectionVariableHandle> handles;
+		for (auto frameObject : objects)
+			handles.push_back(frameObject->GetMaterials().GetVariableHandle("color"));
+		harness.Run("WMaterialCollection::SetVariable (100k/frame, handle)", [&objects, &handles, setsPerObject](uint64_t iterations) {
+			WColor color(0.5f, 0.5f, 0.5f, 1.0f);
+			for (uint64_t i = 0; i < iterations; i++) {
+				for (uint32_t o = 0; o < objects.size(); o++) {
+					for (uint32_t j = 0; j < setsPerObject; j++) {
+						color.r = (float)(j & 0xFF) / 255.0f;
+						objects[o]->GetMaterials().SetVariable<WColor>(handles[o], color);
+					}
+				}
+			}
+		});
+	}
+	for (auto frameObject : objects)
+		frameObject->RemoveReference();
+
+	object->RemoveReference();
+}
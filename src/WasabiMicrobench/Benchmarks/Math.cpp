@@ -0,0 +1,355 @@
+#include "Benchmarks.hpp"
+
+#include <Wasabi/Core/WMath.hpp>
+
+#include <algorithm>
+
+namespace {
+	const uint32_t NUM_MATRICES = 64;
+	const uint32_t NUM_VECTORS = 1024;
+	/** Maximum relative difference allowed between WMath and the reference */
+	const float TOLERANCE = 1e-5f;
+
+	/** Deterministic pseudo-random number in [-1, 1] */
+	float Random(uint32_t& state) {
+		state = state * 1664525u + 1013904223u;
+		return (float)(state >> 8) / (float)(1u << 23) - 1.0f;
+	}
+
+	/** Well-conditioned transformations (rotation, scaling and translation) */
+	std::vector<WMatrix> CreateMatrices(uint32_t count) {
+		uint32_t state = 1;
+		std::vector<WMatrix> matrices(count);
+		for (uint32_t i = 0; i < count; i++) {
+			matrices[i] =
+				WRotationMatrixAxis(WVec3Normalize(WVector3(Random(state), Random(state), Random(state) + 2.0f)), Random(state) * W_PI) *
+				WScalingMatrix(1.5f + Random(state), 1.5f + Random(state), 1.5f + Random(state)) *
+				WTranslationMatrix(Random(state) * 100.0f, Random(state) * 100.0f, Random(state) * 100.0f);
+		}
+		return matrices;
+	}
+
+	/*
+	 * Scalar implementations of the benchmarked functions, the same as WMath
+	 * without its SIMD paths. They are not inlined so that they are called like
+	 * the WMath functions, and they use mat[] directly since WMatrix::operator()
+	 * is not inlined outside of WMath.cpp.
+	 */
+
+	W_NOINLINE WMatrix ReferenceMultiply(const WMatrix a, const WMatrix b) {
+		WMatrix out;
+		for (uint32_t i = 0; i < 4; i++)
+			for (uint32_t j = 0; j < 4; j++) {
+				float fSum = 0.0f;
+				for (uint32_t k = 0; k < 4; k++)
+					fSum += a.mat[i * 4 + k] * b.mat[k * 4 + j];
+				out.mat[i * 4 + j] = fSum;
+			}
+		return out;
+	}
+
+	W_NOINLINE WMatrix ReferenceTranspose(const WMatrix m) {
+		WMatrix out;
+		for (uint32_t i = 0; i < 4; i++)
+			for (uint32_t j = 0; j < 4; j++)
+				out.mat[i * 4 + j] = m.mat[j * 4 + i];
+		return out;
+	}
+
+	W_NOINLINE WMatrix ReferenceInverse(const WMatrix m) {
+		WMatrix out;
+
+		float s0 = m.mat[0] * m.mat[5] - m.mat[4] * m.mat[1];
+		float s1 = m.mat[0] * m.mat[6] - m.mat[4] * m.mat[2];
+		float s2 = m.mat[0] * m.mat[7] - m.mat[4] * m.mat[3];
+		float s3 = m.mat[1] * m.mat[6] - m.mat[5] * m.mat[2];
+		float s4 = m.mat[1] * m.mat[7] - m.mat[5] * m.mat[3];
+		float s5 = m.mat[2] * m.mat[7] - m.mat[6] * m.mat[3];
+
+		float c5 = m.mat[10] * m.mat[15] - m.mat[14] * m.mat[11];
+		float c4 = m.mat[9] * m.mat[15] - m.mat[13] * m.mat[11];
+		float c3 = m.mat[9] * m.mat[14] - m.mat[13] * m.mat[10];
+		float c2 = m.mat[8] * m.mat[15] - m.mat[12] * m.mat[11];
+		float c1 = m.mat[8] * m.mat[14] - m.mat[12] * m.mat[10];
+		float c0 = m.mat[8] * m.mat[13] - m.mat[12] * m.mat[9];
+
+		float invdet = 1.0f / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+		out.mat[0] = (m.mat[5] * c5 - m.mat[6] * c4 + m.mat[7] * c3) * invdet;
+		out.mat[1] = (-m.mat[1] * c5 + m.mat[2] * c4 - m.mat[3] * c3) * invdet;
+		out.mat[2] = (m.mat[13] * s5 - m.mat[14] * s4 + m.mat[15] * s3) * invdet;
+		out.mat[3] = (-m.mat[9] * s5 + m.mat[10] * s4 - m.mat[11] * s3) * invdet;
+
+		out.mat[4] = (-m.mat[4] * c5 + m.mat[6] * c2 - m.mat[7] * c1) * invdet;
+		out.mat[5] = (m.mat[0] * c5 - m.mat[2] * c2 + m.mat[3] * c1) * invdet;
+		out.mat[6] = (-m.mat[12] * s5 + m.mat[14] * s2 - m.mat[15] * s1) * invdet;
+		out.mat[7] = (m.mat[8] * s5 - m.mat[10] * s2 + m.mat[11] * s1) * invdet;
+
+		out.mat[8] = (m.mat[4] * c4 - m.mat[5] * c2 + m.mat[7] * c0) * invdet;
+		out.mat[9] = (-m.mat[0] * c4 + m.mat[1] * c2 - m.mat[3] * c0) * invdet;
+		out.mat[10] = (m.mat[12] * s4 - m.mat[13] * s2 + m.mat[15] * s0) * invdet;
+		out.mat[11] = (-m.mat[8] * s4 + m.mat[9] * s2 - m.mat[11] * s0) * invdet;
+
+		out.mat[12] = (-m.mat[4] * c3 + m.mat[5] * c1 - m.mat[6] * c0) * invdet;
+		out.mat[13] = (m.mat[0] * c3 - m.mat[1] * c1 + m.mat[2] * c0) * invdet;
+		out.mat[14] = (-m.mat[12] * s3 + m.mat[13] * s1 - m.mat[14] * s0) * invdet;
+		out.mat[15] = (m.mat[8] * s3 - m.mat[9] * s1 + m.mat[10] * s0) * invdet;
+
+		return out;
+	}
+
+	W_NOINLINE WVector4 ReferenceTransform(const WVector4 v, const WMatrix m) {
+		WVector4 out;
+		out.x = v.x * m.mat[0] + v.y * m.mat[4] + v.z * m.mat[8] + v.w * m.mat[12];
+		out.y = v.x * m.mat[1] + v.y * m.mat[5] + v.z * m.mat[9] + v.w * m.mat[13];
+		out.z = v.x * m.mat[2] + v.y * m.mat[6] + v.z * m.mat[10] + v.w * m.mat[14];
+		out.w = v.x * m.mat[3] + v.y * m.mat[7] + v.z * m.mat[11] + v.w * m.mat[15];
+		return out;
+	}
+
+	W_NOINLINE WVector3 ReferenceTransformCoord(const WVector3 v, const WMatrix m) {
+		WVector4 out = ReferenceTransform(WVector4(v.x, v.y, v.z, 1), m);
+		return WVector3(out.x, out.y, out.z) / out.w;
+	}
+
+	W_NOINLINE WVector3 ReferenceTransformNormal(const WVector3 v, const WMatrix m) {
+		WVector4 out = ReferenceTransform(WVector4(v.x, v.y, v.z, 0), m);
+		return WVector3(out.x, out.y, out.z);
+	}
+
+	W_NOINLINE WQuaternion ReferenceQuatMultiply(const WQuaternion q1, const WQuaternion q2) {
+		return WQuaternion(
+			q1.w * q2.x + q1.x * q2.w + q1.y * q2.z - q1.z * q2.y,
+			q1.w * q2.y - q1.x * q2.z + q1.y * q2.w + q1.z * q2.x,
+			q1.w * q2.z + q1.x * q2.y - q1.y * q2.x + q1.z * q2.w,
+			q1.w * q2.w - q1.x * q2.x - q1.y * q2.y - q1.z * q2.z);
+	}
+
+	W_NOINLINE WVector3 ReferenceRotate(const WVector3 v, const WQuaternion q) {
+		WVector3 axis(q.x, q.y, q.z);
+		WVector3 t = WVector3(axis.y * v.z - axis.z * v.y, axis.z * v.x - axis.x * v.z, axis.x * v.y - axis.y * v.x);
+		t = t + t;
+		return v + q.w * t + WVector3(axis.y * t.z - axis.z * t.y, axis.z * t.x - axis.x * t.z, axis.x * t.y - axis.y * t.x);
+	}
+
+	/** Largest difference between the components of a and b, relative to b */
+	float Difference(const float* a, const float* b, uint32_t numComponents) {
+		float maxDiff = 0.0f;
+		for (uint32_t i = 0; i < numComponents; i++)
+			maxDiff = std::max(maxDiff, std::abs(a[i] - b[i]) / std::max(std::abs(b[i]), 1.0f));
+		return maxDiff;
+	}
+
+	/**
+	 * Runs a benchmark if its results are within TOLERANCE of the reference,
+	 * skips it otherwise.
+	 */
+	void RunChecked(WMicrobenchHarness& harness, const std::string& name, float difference, const std::function<void(uint64_t)>& body) {
+		if (difference <= TOLERANCE)
+			harness.Run(name, body);
+		else
+			harness.Skip(name, "differs from the scalar reference by " + std::to_string(difference));
+	}
+};
+
+void RunMathBenchmarks(WMicrobenchHarness& harness) {
+	std::vector<WMatrix> matrices = CreateMatrices(NUM_MATRICES);
+	uint32_t state = 2;
+	std::vector<WVector3> vectors(NUM_VECTORS);
+	std::vector<WVector4> vectors4(NUM_VECTORS);
+	std::vector<WQuaternion> quaternions(NUM_VECTORS);
+	for (uint32_t i = 0; i < NUM_VECTORS; i++) {
+		vectors[i] = WVector3(Random(state), Random(state), Random(state)) * 100.0f;
+		vectors4[i] = WVector4(vectors[i].x, vectors[i].y, vectors[i].z, 1.0f);
+		WVector4 q = WVec4Normalize(WVector4(Random(state), Random(state), Random(state), Random(state) + 2.0f));
+		quaternions[i] = WQuaternion(q.x, q.y, q.z, q.w);
+	}
+	std::vector<WVector3> outVectors(NUM_VECTORS);
+	std::vector<WVector4> outVectors4(NUM_VECTORS);
+	std::vector<WMatrix> outMatrices(NUM_MATRICES);
+
+	// rigid transformations (rotation and translation) for WMatrixInverseOrthonormal
+	std::vector<WMatrix> rigidMatrices(NUM_MATRICES);
+	for (uint32_t i = 0; i < NUM_MATRICES; i++) {
+		rigidMatrices[i] =
+			WRotationMatrixAxis(WVec3Normalize(WVector3(Random(state), Random(state), Random(state) + 2.0f)), Random(state) * W_PI) *
+			WTranslationMatrix(Random(state) * 100.0f, Random(state) * 100.0f, Random(state) * 100.0f);
+	}
+
+	float multiplyDiff = 0.0f, transposeDiff = 0.0f, inverseDiff = 0.0f, affineInverseDiff = 0.0f, orthonormalInverseDiff = 0.0f;
+	for (uint32_t i = 0; i < NUM_MATRICES; i++) {
+		const WMatrix& a = matrices[i];
+		const WMatrix& b = matrices[(i + 1) % NUM_MATRICES];
+		multiplyDiff = std::max(multiplyDiff, Difference((a * b).mat, ReferenceMultiply(a, b).mat, 16));
+		transposeDiff = std::max(transposeDiff, Difference(WMatrixTranspose(a).mat, ReferenceTranspose(a).mat, 16));
+		inverseDiff = std::max(inverseDiff, Difference(WMatrixInverse(a).mat, ReferenceInverse(a).mat, 16));
+		affineInverseDiff = std::max(affineInverseDiff, Difference(WMatrixInverseAffine(a).mat, ReferenceInverse(a).mat, 16));
+		orthonormalInverseDiff = std::max(orthonormalInverseDiff,
+			Difference(WMatrixInverseOrthonormal(rigidMatrices[i]).mat, ReferenceInverse(rigidMatrices[i]).mat, 16));
+	}
+	float coordDiff = 0.0f, normalDiff = 0.0f, vec4Diff = 0.0f, quatDiff = 0.0f, rotateDiff = 0.0f;
+	for (uint32_t i = 0; i < NUM_VECTORS; i++) {
+		const WMatrix& m = matrices[i % NUM_MATRICES];
+		coordDiff = std::max(coordDiff, Difference(WVec3TransformCoord(vectors[i], m).components, ReferenceTransformCoord(vectors[i], m).components, 3));
+		normalDiff = std::max(normalDiff, Difference(WVec3TransformNormal(vectors[i], m).components, ReferenceTransformNormal(vectors[i], m).components, 3));
+		vec4Diff = std::max(vec4Diff, Difference(WVec4Transform(vectors4[i], m).components, ReferenceTransform(vectors4[i], m).components, 4));
+		const WQuaternion& q1 = quaternions[i];
+		const WQuaternion& q2 = quaternions[(i + 1) % NUM_VECTORS];
+		quatDiff = std::max(quatDiff, Difference(WQuatMultiply(q1, q2).components, ReferenceQuatMultiply(q1, q2).components, 4));
+		rotateDiff = std::max(rotateDiff, Difference(WVec3Rotate(vectors[i], q1).components, ReferenceRotate(vectors[i], q1).components, 3));
+	}
+
+	RunChecked(harness, "WMatrix::operator*", multiplyDiff, [&matrices](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WMatrix result = matrices[i % NUM_MATRICES] * matrices[(i + 1) % NUM_MATRICES];
+			WDoNotOptimize(result);
+		}
+	});
+	harness.Run("WMatrix::operator* (scalar reference)", [&matrices](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WMatrix result = ReferenceMultiply(matrices[i % NUM_MATRICES], matrices[(i + 1) % NUM_MATRICES]);
+			WDoNotOptimize(result);
+		}
+	});
+	RunChecked(harness, "WMatrixMultiplyArray (per matrix)", multiplyDiff, [&matrices, &outMatrices](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i += NUM_MATRICES) {
+			WMatrixMultiplyArray(outMatrices.data(), matrices.data(), (uint32_t)std::min((uint64_t)NUM_MATRICES, iterations - i), matrices[0]);
+			WDoNotOptimize(outMatrices[0]);
+		}
+	});
+
+	RunChecked(harness, "WMatrixTranspose", transposeDiff, [&matrices](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WMatrix result = WMatrixTranspose(matrices[i % NUM_MATRICES]);
+			WDoNotOptimize(result);
+		}
+	});
+	harness.Run("WMatrixTranspose (scalar reference)", [&matrices](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WMatrix result = ReferenceTranspose(matrices[i % NUM_MATRICES]);
+			WDoNotOptimize(result);
+		}
+	});
+
+	RunChecked(harness, "WMatrixInverse", inverseDiff, [&matrices](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WMatrix result = WMatrixInverse(matrices[i % NUM_MATRICES]);
+			WDoNotOptimize(result);
+		}
+	});
+	harness.Run("WMatrixInverse (scalar reference)", [&matrices](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WMatrix result = ReferenceInverse(matrices[i % NUM_MATRICES]);
+			WDoNotOptimize(result);
+		}
+	});
+
+	RunChecked(harness, "WMatrixInverseAffine", affineInverseDiff, [&matrices](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WMatrix result = WMatrixInverseAffine(matrices[i % NUM_MATRICES]);
+			WDoNotOptimize(result);
+		}
+	});
+
+	RunChecked(harness, "WMatrixInverseOrthonormal", orthonormalInverseDiff, [&rigidMatrices](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WMatrix result = WMatrixInverseOrthonormal(rigidMatrices[i % NUM_MATRICES]);
+			WDoNotOptimize(result);
+		}
+	});
+
+	RunChecked(harness, "WVec3TransformCoord", coordDiff, [&matrices, &vectors](uint64_t iterations) {
+		const WMatrix& m = matrices[0];
+		for (uint64_t i = 0; i < iterations; i++) {
+			WVector3 result = WVec3TransformCoord(vectors[i % NUM_VECTORS], m);
+			WDoNotOptimize(result);
+		}
+	});
+	harness.Run("WVec3TransformCoord (scalar reference)", [&matrices, &vectors](uint64_t iterations) {
+		const WMatrix& m = matrices[0];
+		for (uint64_t i = 0; i < iterations; i++) {
+			WVector3 result = ReferenceTransformCoord(vectors[i % NUM_VECTORS], m);
+			WDoNotOptimize(result);
+		}
+	});
+	RunChecked(harness, "WVec3TransformCoordArray (per vector)", coordDiff, [&matrices, &vectors, &outVectors](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i += NUM_VECTORS) {
+			WVec3TransformCoordArray(outVectors.data(), vectors.data(), (uint32_t)std::min((uint64_t)NUM_VECTORS, iterations - i), matrices[0]);
+			WDoNotOptimize(outVectors[0]);
+		}
+	});
+
+	RunChecked(harness, "WVec3TransformNormal", normalDiff, [&matrices, &vectors](uint64_t iterations) {
+		const WMatrix& m = matrices[0];
+		for (uint64_t i = 0; i < iterations; i++) {
+			WVector3 result = WVec3TransformNormal(vectors[i % NUM_VECTORS], m);
+			WDoNotOptimize(result);
+		}
+	});
+	harness.Run("WVec3TransformNormal (scalar reference)", [&matrices, &vectors](uint64_t iterations) {
+		const WMatrix& m = matrices[0];
+		for (uint64_t i = 0; i < iterations; i++) {
+			WVector3 result = ReferenceTransformNormal(vectors[i % NUM_VECTORS], m);
+			WDoNotOptimize(result);
+		}
+	});
+	RunChecked(harness, "WVec3TransformNormalArray (per vector)", normalDiff, [&matrices, &vectors, &outVectors](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i += NUM_VECTORS) {
+			WVec3TransformNormalArray(outVectors.data(), vectors.data(), (uint32_t)std::min((uint64_t)NUM_VECTORS, iterations - i), matrices[0]);
+			WDoNotOptimize(outVectors[0]);
+		}
+	});
+
+	RunChecked(harness, "WVec4Transform", vec4Diff, [&matrices, &vectors4](uint64_t iterations) {
+		const WMatrix& m = matrices[0];
+		for (uint64_t i = 0; i < iterations; i++) {
+			WVector4 result = WVec4Transform(vectors4[i % NUM_VECTORS], m);
+			WDoNotOptimize(result);
+		}
+	});
+	harness.Run("WVec4Transform (scalar reference)", [&matrices, &vectors4](uint64_t iterations) {
+		const WMatrix& m = matrices[0];
+		for (uint64_t i = 0; i < iterations; i++) {
+			WVector4 result = ReferenceTransform(vectors4[i % NUM_VECTORS], m);
+			WDoNotOptimize(result);
+		}
+	});
+	RunChecked(harness, "WVec4TransformArray (per vector)", vec4Diff, [&matrices, &vectors4, &outVectors4](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i += NUM_VECTORS) {
+			WVec4TransformArray(outVectors4.data(), vectors4.data(), (uint32_t)std::min((uint64_t)NUM_VECTORS, iterations - i), matrices[0]);
+			WDoNotOptimize(outVectors4[0]);
+		}
+	});
+
+	RunChecked(harness, "WQuatMultiply", quatDiff, [&quaternions](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WQuaternion result = WQuatMultiply(quaternions[i % NUM_VECTORS], quaternions[(i + 1) % NUM_VECTORS]);
+			WDoNotOptimize(result);
+		}
+	});
+	harness.Run("WQuatMultiply (scalar reference)", [&quaternions](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WQuaternion result = ReferenceQuatMultiply(quaternions[i % NUM_VECTORS], quaternions[(i + 1) % NUM_VECTORS]);
+			WDoNotOptimize(result);
+		}
+	});
+
+	RunChecked(harness, "WVec3Rotate", rotateDiff, [&quaternions, &vectors](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WVector3 result = WVec3Rotate(vectors[i % NUM_VECTORS], quaternions[(i + 7) % NUM_VECTORS]);
+			WDoNotOptimize(result);
+		}
+	});
+	harness.Run("WVec3Rotate (scalar reference)", [&quaternions, &vectors](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WVector3 result = ReferenceRotate(vectors[i % NUM_VECTORS], quaternions[(i + 7) % NUM_VECTORS]);
+			WDoNotOptimize(result);
+		}
+	});
+	RunChecked(harness, "WVec3RotateArray (per vector)", rotateDiff, [&quaternions, &vectors, &outVectors](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i += NUM_VECTORS) {
+			WVec3RotateArray(outVectors.data(), vectors.data(), (uint32_t)std::min((uint64_t)NUM_VECTORS, iterations - i), quaternions[0]);
+			WDoNotOptimize(outVectors[0]);
+		}
+	});
+}
@@ -0,0 +1,162 @@
+#include "Benchmarks.hpp"
+
+#include <Wasabi/Core/WCore.hpp>
+#include <Wasabi/Memory/WVulkanMemoryManager.hpp>
+
+#include <algorithm>
+
+namespace {
+	/** Rounds of the stress test, every round creates 1.5 x NUM_BUFFERS buffers (~37k in total) */
+	const uint32_t NUM_ROUNDS = 24;
+	/** Buffers alive at once in a round of the stress test */
+	const uint32_t NUM_BUFFERS = 1024;
+	/** Images alive at once in a round of the stress test */
+	const uint32_t NUM_IMAGES = 128;
+	/** Maximum size of the stress test's buffers, which keeps a round's live buffers around 128 MB */
+	const uint32_t MAX_BUFFER_SIZE = 256 * 1024;
+	/** Big enough to get a dedicated allocation on any heap (pages are at most 256 MB) */
+	const VkDeviceSize DEDICATED_BUFFER_SIZE = 160 * 1024 * 1024;
+
+	uint32_t Random(uint32_t& state) {
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	}
+
+	VkBufferCreateInfo BufferCreateInfo(VkDeviceSize size) {
+		VkBufferCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		createInfo.size = size;
+		createInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		return createInfo;
+	}
+
+	VkImageCreateInfo ImageCreateInfo(uint32_t size) {
+		VkImageCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		createInfo.imageType = VK_IMAGE_TYPE_2D;
+		createInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+		createInfo.extent = { size, size, 1 };
+		createInfo.mipLevels = 1;
+		createInfo.arrayLayers = 1;
+		createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		createInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		return createInfo;
+	}
+
+	/** Whether any two of the allocations share bytes of the same device memory */
+	bool AllocationsOverlap(std::vector<WVulkanMemoryAllocation> allocations) {
+		std::sort(allocations.begin(), allocations.end(), [](const WVulkanMemoryAllocation& a, const WVulkanMemoryAllocation& b) {
+			if (a.memory != b.memory)
+				return (uintptr_t)a.memory < (uintptr_t)b.memory;
+			return a.offset < b.offset;
+		});
+		for (size_t i = 1; i < allocations.size(); i++) {
+			if (allocations[i].memory == allocations[i - 1].memory && allocations[i - 1].offset + allocations[i - 1].size > allocations[i].offset)
+				return true;
+		}
+		return false;
+	}
+
+	/** Frees everything released so far, the device must be idle */
+	void FreeReleasedResources(Wasabi* app) {
+		vkDeviceWaitIdle(app->GetVulkanDevice());
+		app->MemoryManager->ReleaseAllResources();
+	}
+};
+
+void RunMemoryBenchmarks(WMicrobenchHarness& harness, Wasabi* app) {
+	WVulkanMemoryManager* memoryManager = app->MemoryManager;
+	FreeReleasedResources(app);
+
+	// create and destroy a mix of buffers and images in rounds, re-creating half of them with other sizes
+	// in the middle of every round to fragment the pages, then check that every round leaves the pages as
+	// they were
+	if (harness.IsSelected("WVulkanMemoryManager stress")) {
+		WVulkanMemoryStats initialStats = memoryManager->GetMemoryStats();
+		uint32_t state = 7;
+		uint32_t roundMemoryObjects = 0;
+		bool created = true, overlap = false, emptied = true, grew = false, dedicated = false;
+		for (uint32_t round = 0; round < NUM_ROUNDS; round++) {
+			std::vector<WVulkanBuffer> buffers(NUM_BUFFERS);
+			std::vector<WVulkanImage> images(NUM_IMAGES);
+			for (uint32_t pass = 0; pass < 2; pass++) {
+				for (uint32_t i = pass; i < NUM_BUFFERS; i += pass + 1) {
+					if (pass > 0)
+						buffers[i].Destroy(app);
+					VkDeviceSize size = 256 + (VkDeviceSize)(Random(state) % MAX_BUFFER_SIZE);
+					VkMemoryPropertyFlags properties = i % 4 == 0 ?
+						VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+					created &= buffers[i].Create(app, BufferCreateInfo(size), properties) == VK_SUCCESS;
+				}
+				for (uint32_t i = pass; i < NUM_IMAGES; i += pass + 1) {
+					if (pass > 0)
+						images[i].Destroy(app);
+					created &= images[i].Create(app, ImageCreateInfo(16u << (Random(state) % 6)), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) == VK_SUCCESS;
+				}
+			}
+
+			// a device that can't fit the big buffer is not an error, the other resources still test the pages
+			WVulkanBuffer bigBuffer;
+			if (bigBuffer.Create(app, BufferCreateInfo(DEDICATED_BUFFER_SIZE), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) == VK_SUCCESS)
+				dedicated |= memoryManager->GetMemoryStats().numDedicatedAllocations > initialStats.numDedicatedAllocations;
+
+			std::vector<WVulkanMemoryAllocation> allocations;
+			for (auto& buffer : buffers)
+				allocations.push_back(buffer.mem);
+			for (auto& image : images)
+				allocations.push_back(image.mem);
+			if (bigBuffer.buf)
+				allocations.push_back(bigBuffer.mem);
+			overlap |= AllocationsOverlap(allocations);
+
+			for (auto& buffer : buffers)
+				buffer.Destroy(app);
+			for (auto& image : images)
+				image.Destroy(app);
+			bigBuffer.Destroy(app);
+			FreeReleasedResources(app);
+
+			// every page is empty again, and the pages kept around are reused by the next rounds
+			WVulkanMemoryStats stats = memoryManager->GetMemoryStats();
+			emptied &= stats.numAllocations == initialStats.numAllocations && stats.usedBytes == initialStats.usedBytes &&
+				stats.numDedicatedAllocations == initialStats.numDedicatedAllocations;
+			if (round == 0)
+				roundMemoryObjects = stats.numDeviceMemoryObjects;
+			grew |= stats.numDeviceMemoryObjects > roundMemoryObjects;
+		}
+
+		harness.Check("WVulkanMemoryManager stress: created", created);
+		harness.Check("WVulkanMemoryManager stress: no overlap", !overlap);
+		harness.Check("WVulkanMemoryManager stress: pages empty", emptied);
+		harness.Check("WVulkanMemoryManager stress: pages reused", !grew);
+		if (!dedicated)
+			printf("WVulkanMemoryManager stress: the device could not allocate a dedicated buffer, only pages were tested\n");
+	}
+
+	// one operation is a create and a destroy, the released memory is freed in batches like frames would
+	harness.Run("WVulkanBuffer::Create+Destroy (64 KB)", [app](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WVulkanBuffer buffer;
+			buffer.Create(app, BufferCreateInfo(64 * 1024), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			buffer.Destroy(app);
+			if (i % 256 == 255)
+				FreeReleasedResources(app);
+		}
+		FreeReleasedResources(app);
+	});
+
+	harness.Run("WVulkanImage::Create+Destroy (256x256)", [app](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			WVulkanImage image;
+			image.Create(app, ImageCreateInfo(256), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			image.Destroy(app);
+			if (i % 256 == 255)
+				FreeReleasedResources(app);
+		}
+		FreeReleasedResources(app);
+	});
+}
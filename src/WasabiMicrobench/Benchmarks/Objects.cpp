@@ -0,0 +1,132 @@
+#include "Benchmarks.hpp"
+
+#include <Wasabi/Wasabi.hpp>
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+	/** Objects spread around the camera, roughly a quarter of them in view */
+	const uint32_t NUM_OBJECTS = 10000;
+	/** Every UNCULLED_STRIDE-th object has frustum culling disabled */
+	const uint32_t UNCULLED_STRIDE = 97;
+	/** Objects moved per query by the "moving" benchmark */
+	const uint32_t NUM_MOVED = 100;
+
+	float Random(uint32_t& state) {
+		state = state * 1664525u + 1013904223u;
+		return (float)(state >> 8) / (float)(1u << 23) - 1.0f;
+	}
+
+	/** The objects a brute-force loop renders: the ones WObject::WillRender() would accept */
+	W_NOINLINE void BruteForceVisible(WCamera* camera, const std::vector<WObject*>& objects, const std::unordered_set<WObject*>& unculled, std::vector<WObject*>& visible) {
+		visible.clear();
+		for (auto object : objects) {
+			if (object->Valid() && (unculled.count(object) || object->InCameraView(camera)))
+				visible.push_back(object);
+		}
+	}
+};
+
+void RunObjectBenchmarks(WMicrobenchHarness& harness, Wasabi* app) {
+	WGeometry* cube = new WGeometry(app);
+	WError err = cube->CreateCube(2.0f);
+	if (!err) {
+		harness.Skip("WObjectManager::QueryFrustum (10k objects)", err.AsString());
+		harness.Skip("WObjectManager::QueryFrustum (10k objects, 100 moving)", err.AsString());
+		harness.Skip("WObject::InCameraView (10k objects, brute-force reference)", err.AsString());
+		cube->RemoveReference();
+		return;
+	}
+
+	WCamera* camera = new WCamera(app);
+	camera->SetPosition(0.0f, 10.0f, -50.0f);
+	camera->Point(0.0f, 0.0f, 0.0f);
+	camera->UpdateInternals();
+
+	uint32_t state = 9;
+	std::vector<WObject*> objects;
+	std::unordered_set<WObject*> unculled;
+	for (uint32_t i = 0; i < NUM_OBJECTS; i++) {
+		WObject* object = app->ObjectManager->CreateObject();
+		if (!object)
+			break;
+		object->SetGeometry(cube);
+		object->SetPosition(Random(state) * 200.0f, Random(state) * 20.0f, Random(state) * 200.0f);
+		if (i % UNCULLED_STRIDE == 0) {
+			object->DisableFrustumCulling();
+			object->DisableFrustumCulling();
+			unculled.insert(object);
+		}
+		objects.push_back(object);
+	}
+	if (objects.size() < NUM_OBJECTS) {
+		harness.Skip("WObjectManager::QueryFrustum (10k objects)", "failed to create the objects");
+		harness.Skip("WObjectManager::QueryFrustum (10k objects, 100 moving)", "failed to create the objects");
+		harness.Skip("WObject::InCameraView (10k objects, brute-force reference)", "failed to create the objects");
+		for (auto object : objects)
+			object->RemoveReference();
+		camera->RemoveReference();
+		cube->RemoveReference();
+		return;
+	}
+	// toggling culling back and forth must leave the object in the unculled list exactly once
+	objects[UNCULLED_STRIDE]->EnableFrustumCulling();
+	objects[UNCULLED_STRIDE]->EnableFrustumCulling();
+	objects[UNCULLED_STRIDE]->DisableFrustumCulling();
+	unculled.insert(objects[UNCULLED_STRIDE]);
+
+	// the spatial index and the brute-force loop must agree on the visible set
+	std::vector<WObject*> queried, bruteForce;
+	app->ObjectManager->QueryFrustum(camera, queried);
+	BruteForceVisible(camera, objects, unculled, bruteForce);
+	std::sort(queried.begin(), queried.end());
+	std::sort(bruteForce.begin(), bruteForce.end());
+	harness.Check("WObjectManager::QueryFrustum matches brute force", queried == bruteForce);
+
+	harness.Run("WObjectManager::QueryFrustum (10k objects)", [app, camera, &queried](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			app->ObjectManager->QueryFrustum(camera, queried);
+			WDoNotOptimize(queried.size());
+		}
+	});
+
+	// the moved objects are re-indexed by the next query
+	harness.Run("WObjectManager::QueryFrustum (10k objects, 100 moving)", [app, camera, &objects, &queried, &state](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			for (uint32_t j = 0; j < NUM_MOVED; j++) {
+				WObject* object = objects[(i * NUM_MOVED + j) % objects.size()];
+				object->SetPosition(object->GetPosition() + WVector3(Random(state), 0.0f, Random(state)));
+			}
+			app->ObjectManager->QueryFrustum(camera, queried);
+			WDoNotOptimize(queried.size());
+		}
+	});
+
+	harness.Run("WObject::InCameraView (10k objects, brute-force reference)", [camera, &objects, &unculled, &bruteForce](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			BruteForceVisible(camera, objects, unculled, bruteForce);
+			WDoNotOptimize(bruteForce.size());
+		}
+	});
+
+	// removing objects from the middle of the dirty and unculled lists keeps the rest indexed
+	for (uint32_t i = 0; i < objects.size(); i += 2)
+		objects[i]->SetPosition(objects[i]->GetPosition() + WVector3(1.0f, 0.0f, 0.0f));
+	for (uint32_t i = 0; i < objects.size(); i += 3) {
+		unculled.erase(objects[i]);
+		objects[i]->RemoveReference();
+		objects[i] = nullptr;
+	}
+	objects.erase(std::remove(objects.begin(), objects.end(), nullptr), objects.end());
+	app->ObjectManager->QueryFrustum(camera, queried);
+	BruteForceVisible(camera, objects, unculled, bruteForce);
+	std::sort(queried.begin(), queried.end());
+	std::sort(bruteForce.begin(), bruteForce.end());
+	harness.Check("WObjectManager::QueryFrustum matches brute force after removals", queried == bruteForce);
+
+	for (auto object : objects)
+		object->RemoveReference();
+	camera->RemoveReference();
+	cube->RemoveReference();
+}
@@ -0,0 +1,149 @@
+#include "Benchmarks.hpp"
+
+#include <Wasabi/Core/WJobSystem.hpp>
+#include <Wasabi/Renderers/Common/WSoftwareOcclusionCuller.hpp>
+
+namespace {
+	/** Occluder quads rasterized by the benchmark */
+	const uint32_t NUM_QUADS = 256;
+	/** Boxes tested by the benchmark */
+	const uint32_t NUM_BOXES = 4096;
+	/** Depth of the occluder quads of the checks */
+	const float OCCLUDER_DEPTH = 10.0f;
+
+	float Random(uint32_t& state) {
+		state = state * 1664525u + 1013904223u;
+		return (float)(state >> 8) / (float)(1u << 23) - 1.0f;
+	}
+
+	/** A view at the origin looking down +z, covering [-2z, 2z] x [-z, z] at depth z */
+	WMatrix CreateViewProjection() {
+		float aspect = (float)WSoftwareOcclusionCuller::DEFAULT_WIDTH / (float)WSoftwareOcclusionCuller::DEFAULT_HEIGHT;
+		return WPerspectiveProjMatrixFOV(90.0f, aspect, 1.0f, 1000.0f);
+	}
+
+	/** Adds an occluder quad facing the view, spanning [minX, maxX] x [minY, maxY] at depth z */
+	void AddQuad(WSoftwareOcclusionCuller& culler, float minX, float minY, float maxX, float maxY, float z) {
+		WVector3 positions[4] = {
+			WVector3(minX, minY, z),
+			WVector3(maxX, minY, z),
+			WVector3(maxX, maxY, z),
+			WVector3(minX, maxY, z),
+		};
+		uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+		culler.AddOccluder(positions, sizeof(WVector3), 4, indices, 6, WMatrix());
+	}
+
+	/** Checks the culler against boxes whose visibility is known */
+	void CheckOcclusion(WMicrobenchHarness& harness) {
+		WSoftwareOcclusionCuller culler(nullptr);
+		WMatrix viewProjection = CreateViewProjection();
+		const float z = OCCLUDER_DEPTH;
+
+		// nothing rasterized: every pixel is at the far plane and nothing is occluded
+		culler.BeginFrame(viewProjection);
+		culler.Rasterize();
+		bool empty = culler.GetDepth(0, 0) == 1.0f && culler.GetDepth(culler.GetWidth() - 1, culler.GetHeight() - 1) == 1.0f;
+		empty = empty && !culler.IsBoxOccluded(WVector3(-1.0f, -1.0f, 2.0f * z), WVector3(1.0f, 1.0f, 2.0f * z + 2.0f));
+		empty = empty && !culler.IsBoxOccluded(WVector3(-1.0f, -1.0f, 900.0f), WVector3(1.0f, 1.0f, 902.0f));
+		harness.Check("WSoftwareOcclusionCuller: empty buffer occludes nothing", empty);
+
+		// a quad covering the whole view (and more)
+		culler.BeginFrame(viewProjection);
+		AddQuad(culler, -10.0f * z, -10.0f * z, 10.0f * z, 10.0f * z, z);
+		culler.Rasterize();
+		harness.Check("WSoftwareOcclusionCuller: box behind a full-screen quad is occluded",
+			culler.IsBoxOccluded(WVector3(-1.0f, -1.0f, 2.0f * z), WVector3(1.0f, 1.0f, 2.0f * z + 2.0f)));
+		harness.Check("WSoftwareOcclusionCuller: box in front of a full-screen quad is visible",
+			!culler.IsBoxOccluded(WVector3(-1.0f, -1.0f, 0.5f * z), WVector3(1.0f, 1.0f, 0.5f * z + 1.0f)));
+		harness.Check("WSoftwareOcclusionCuller: box crossing a full-screen quad is visible",
+			!culler.IsBoxOccluded(WVector3(-1.0f, -1.0f, z - 1.0f), WVector3(1.0f, 1.0f, z + 1.0f)));
+		harness.Check("WSoftwareOcclusionCuller: box straddling the near plane is visible",
+			!culler.IsBoxOccluded(WVector3(-1.0f, -1.0f, -5.0f), WVector3(1.0f, 1.0f, 5.0f)));
+		harness.Check("WSoftwareOcclusionCuller: box behind the eye is visible",
+			!culler.IsBoxOccluded(WVector3(-1.0f, -1.0f, -2.0f * z - 2.0f), WVector3(1.0f, 1.0f, -2.0f * z)));
+
+		// a quad covering the left half of the view: boxes on the edges of the
+		// occluder and of the buffer are only occluded if all their pixels are
+		culler.BeginFrame(viewProjection);
+		AddQuad(culler, -10.0f * z, -10.0f * z, 0.0f, 10.0f * z, z);
+		culler.Rasterize();
+		const float behind = 2.0f * z, halfWidth = 2.0f * behind, halfHeight = behind;
+		bool edges = true;
+		// straddling the occluder's right edge
+		edges = edges && !culler.IsBoxOccluded(WVector3(-1.0f, -1.0f, behind), WVector3(1.0f, 1.0f, behind + 1.0f));
+		// on the right edge of the buffer, partly off-screen
+		edges = edges && !culler.IsBoxOccluded(WVector3(halfWidth - 1.0f, -1.0f, behind), WVector3(halfWidth + 1.0f, 1.0f, behind + 1.0f));
+		// in the corners of the buffer on the unoccluded side
+		edges = edges && !culler.IsBoxOccluded(WVector3(halfWidth - 1.0f, halfHeight - 1.0f, behind), WVector3(halfWidth + 1.0f, halfHeight + 1.0f, behind + 1.0f));
+		edges = edges && !culler.IsBoxOccluded(WVector3(halfWidth - 1.0f, -halfHeight - 1.0f, behind), WVector3(halfWidth + 1.0f, -halfHeight + 1.0f, behind + 1.0f));
+		// entirely outside the view (left to the frustum test)
+		edges = edges && !culler.IsBoxOccluded(WVector3(-3.0f * halfWidth, -1.0f, behind), WVector3(-2.0f * halfWidth, 1.0f, behind + 1.0f));
+		harness.Check("WSoftwareOcclusionCuller: boxes on the edges are visible", edges);
+		// on the left edge of the buffer, behind the occluder where it is on-screen
+		harness.Check("WSoftwareOcclusionCuller: partly off-screen box behind the quad is occluded",
+			culler.IsBoxOccluded(WVector3(-halfWidth - 1.0f, -1.0f, behind), WVector3(-halfWidth + 1.0f, 1.0f, behind + 1.0f)));
+	}
+};
+
+void RunSoftwareOcclusionBenchmarks(WMicrobenchHarness& harness) {
+	CheckOcclusion(harness);
+
+	// quads scattered over the view, and boxes scattered behind them
+	uint32_t state = 11;
+	std::vector<WVector3> quads(NUM_QUADS);
+	for (uint32_t i = 0; i < NUM_QUADS; i++)
+		quads[i] = WVector3(Random(state) * 2.0f * OCCLUDER_DEPTH, Random(state) * OCCLUDER_DEPTH, OCCLUDER_DEPTH * (1.0f + 0.5f * (Random(state) + 1.0f)));
+	std::vector<WVector3> boxMins(NUM_BOXES), boxMaxs(NUM_BOXES);
+	for (uint32_t i = 0; i < NUM_BOXES; i++) {
+		float z = OCCLUDER_DEPTH * (2.0f + Random(state) + 1.0f);
+		boxMins[i] = WVector3(Random(state) * 2.0f * z, Random(state) * z, z);
+		boxMaxs[i] = boxMins[i] + WVector3(1.0f, 1.0f, 1.0f);
+	}
+
+	WJobSystem jobSystem;
+	WSoftwareOcclusionCuller culler(nullptr);
+	WSoftwareOcclusionCuller jobCuller(&jobSystem);
+	WMatrix viewProjection = CreateViewProjection();
+	auto rasterize = [&viewProjection, &quads](WSoftwareOcclusionCuller& culler) {
+		culler.BeginFrame(viewProjection);
+		for (auto& quad : quads)
+			AddQuad(culler, quad.x - 2.0f, quad.y - 2.0f, quad.x + 2.0f, quad.y + 2.0f, quad.z);
+		culler.Rasterize();
+	};
+
+	// splitting the tile rows over the job system must not change the result
+	rasterize(culler);
+	rasterize(jobCuller);
+	bool sameDepth = culler.GetWidth() == jobCuller.GetWidth() && culler.GetHeight() == jobCuller.GetHeight();
+	for (uint32_t y = 0; y < culler.GetHeight() && sameDepth; y++)
+		for (uint32_t x = 0; x < culler.GetWidth() && sameDepth; x++)
+			sameDepth = culler.GetDepth(x, y) == jobCuller.GetDepth(x, y);
+	harness.Check("WSoftwareOcclusionCuller: job system rasterizes the same depth", sameDepth);
+	bool sameOcclusion = true;
+	for (uint32_t i = 0; i < NUM_BOXES; i++)
+		sameOcclusion &= culler.IsBoxOccluded(boxMins[i], boxMaxs[i]) == jobCuller.IsBoxOccluded(boxMins[i], boxMaxs[i]);
+	harness.Check("WSoftwareOcclusionCuller: job system occludes the same boxes", sameOcclusion);
+
+	harness.Run("WSoftwareOcclusionCuller::Rasterize (256 quads)", [&culler, &rasterize](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			rasterize(culler);
+			WDoNotOptimize(culler.GetDepth(0, 0));
+		}
+	});
+
+	harness.Run("WSoftwareOcclusionCuller::Rasterize (256 quads, job system)", [&jobCuller, &rasterize](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++) {
+			rasterize(jobCuller);
+			WDoNotOptimize(jobCuller.GetDepth(0, 0));
+		}
+	});
+
+	rasterize(culler);
+	harness.Run("WSoftwareOcclusionCuller::IsBoxOccluded", [&culler, &boxMins, &boxMaxs](uint64_t iterations) {
+		uint32_t numOccluded = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+			numOccluded += culler.IsBoxOccluded(boxMins[i % NUM_BOXES], boxMaxs[i % NUM_BOXES]) ? 1 : 0;
+		WDoNotOptimize(numOccluded);
+	});
+}
@@ -0,0 +1,37 @@
+#include "Benchmarks.hpp"
+
+#include <Wasabi/Particles/WParticles.hpp>
+
+namespace {
+	const uint32_t NUM_PARTICLES = 5000;
+};
+
+void RunParticlesBenchmarks(WMicrobenchHarness& harness, Wasabi* app) {
+	WCamera* camera = new WCamera(app);
+	camera->SetPosition(0.0f, 5.0f, -20.0f);
+	camera->Point(0.0f, 0.0f, 0.0f);
+	camera->UpdateInternals();
+
+	// a full system whose particles never die, so that every update processes
+	// all of them (emission is capped per update, fill it up first)
+	WDefaultParticleBehavior behavior(NUM_PARTICLES);
+	behavior.m_emissionFrequency = 1000000.0f;
+	behavior.m_particleLife = 1000000.0f;
+	float curTime = 0.0f;
+	std::vector<WParticlesInstance> buffer(NUM_PARTICLES);
+	WMatrix worldMatrix = WTranslationMatrix(0.0f, 1.0f, 0.0f);
+	while (behavior.UpdateAndCopyToBuffer(curTime, buffer.data(), NUM_PARTICLES, worldMatrix, camera) < NUM_PARTICLES)
+		curTime += 0.001f;
+
+	// one operation is the update of a single particle
+	harness.Run("WParticlesBehavior::UpdateAndCopyToBuffer", [&behavior, &curTime, &buffer, &worldMatrix, camera](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i += NUM_PARTICLES) {
+			curTime += 0.001f;
+			uint32_t numParticles = behavior.UpdateAndCopyToBuffer(curTime, buffer.data(), NUM_PARTICLES, worldMatrix, camera);
+			WDoNotOptimize(numParticles);
+		}
+		WDoNotOptimize(buffer[0]);
+	});
+
+	camera->RemoveReference();
+}
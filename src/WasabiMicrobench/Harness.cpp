@@ -0,0 +1,123 @@
+#include "Harness.hpp"
+
+#include <Wasabi/Core/WCPUProfiler.hpp>
+#include <Wasabi/Core/WUtilities.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+const void* volatile WMicrobench::g_sink = nullptr;
+
+WMicrobenchHarness::WMicrobenchHarness(uint32_t warmupSamples, uint32_t numSamples, double sampleTimeMs, std::string filter) {
+	m_warmupSamples = warmupSamples;
+	m_numSamples = std::max(numSamples, 1u);
+	m_sampleTimeNs = std::max(sampleTimeMs, 0.01) * 1000000.0;
+	m_filter = filter;
+	m_numFailedChecks = 0;
+}
+
+bool WMicrobenchHarness::IsSelected(const std::string& name) const {
+	return m_filter.length() == 0 || name.find(m_filter) != std::string::npos;
+}
+
+bool WMicrobenchHarness::Run(const std::string& name, const std::function<void(uint64_t)>& body) {
+	if (!IsSelected(name))
+		return false;
+
+	// grow the number of operations until a sample is long enough to time
+	// reliably, then scale it to the target sample time
+	uint64_t iterations = 1;
+	double elapsed = _Time(body, iterations);
+	while (elapsed < m_sampleTimeNs / 10.0 && iterations < (1ull << 40)) {
+		iterations *= 10;
+		elapsed = _Time(body, iterations);
+	}
+	iterations = std::max((uint64_t)((double)iterations * m_sampleTimeNs / std::max(elapsed, 1.0)), (uint64_t)1);
+
+	for (uint32_t i = 0; i < m_warmupSamples; i++)
+		_Time(body, iterations);
+
+	std::vector<double> samples(m_numSamples);
+	double total = 0.0;
+	for (uint32_t i = 0; i < m_numSamples; i++) {
+		samples[i] = _Time(body, iterations) / (double)iterations;
+		total += samples[i];
+	}
+	std::sort(samples.begin(), samples.end());
+
+	W_MICROBENCH_RESULT result = {};
+	result.name = name;
+	result.skipped = false;
+	result.iterations = iterations;
+	result.numSamples = m_numSamples;
+	result.meanNs = total / (double)m_numSamples;
+	result.minNs = samples.front();
+	result.medianNs = samples[samples.size() / 2];
+	result.p95Ns = samples[std::min((size_t)(0.95 * (double)samples.size()), samples.size() - 1)];
+	result.maxNs = samples.back();
+	m_results.push_back(result);
+
+	printf("%-48s %12.2f ns/op (min %.2f, median %.2f, p95 %.2f, max %.2f) x%llu\n", name.c_str(),
+		result.meanNs, result.minNs, result.medianNs, result.p95Ns, result.maxNs, (unsigned long long)iterations);
+	return true;
+}
+
+void WMicrobenchHarness::Skip(const std::string& name, const std::string& reason) {
+	if (!IsSelected(name))
+		return;
+
+	W_MICROBENCH_RESULT result = {};
+	result.name = name;
+	result.skipped = true;
+	result.skipReason = reason;
+	m_results.push_back(result);
+
+	printf("%-48s skipped: %s\n", name.c_str(), reason.c_str());
+}
+
+bool WMicrobenchHarness::Check(const std::string& name, bool passed) {
+	if (!passed)
+		m_numFailedChecks++;
+
+	printf("%-48s %s\n", name.c_str(), passed ? "passed" : "FAILED");
+	return passed;
+}
+
+uint32_t WMicrobenchHarness::GetNumFailedChecks() const {
+	return m_numFailedChecks;
+}
+
+const std::vector<W_MICROBENCH_RESULT>& WMicrobenchHarness::GetResults() const {
+	return m_results;
+}
+
+WError WMicrobenchHarness::WriteResults(std::string filename) const {
+	std::ofstream file(filename, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+		return WError(W_FILENOTFOUND);
+
+	file.precision(3);
+	file << std::fixed;
+	file << "{\n\t\"benchmarks\": [";
+	for (uint32_t i = 0; i < m_results.size(); i++) {
+		const W_MICROBENCH_RESULT& result = m_results[i];
+		file << (i > 0 ? ",\n" : "\n") << "\t\t{\"name\": \"" << WUtil::EscapeJSON(result.name) << "\", ";
+		if (result.skipped) {
+			file << "\"skipped\": \"" << WUtil::EscapeJSON(result.skipReason) << "\"}";
+			continue;
+		}
+		file << "\"iterations\": " << result.iterations << ", \"samples\": " << result.numSamples
+			<< ", \"meanNs\": " << result.meanNs << ", \"minNs\": " << result.minNs << ", \"medianNs\": " << result.medianNs
+			<< ", \"p95Ns\": " << result.p95Ns << ", \"maxNs\": " << result.maxNs << "}";
+	}
+	file << "\n\t]\n}\n";
+
+	return file.good() ? WError(W_SUCCEEDED) : WError(W_ERRORUNK);
+}
+
+double WMicrobenchHarness::_Time(const std::function<void(uint64_t)>& body, uint64_t iterations) {
+	uint64_t start = WCPUProfiler::Now();
+	body(iterations);
+	return (double)(WCPUProfiler::Now() - start);
+}
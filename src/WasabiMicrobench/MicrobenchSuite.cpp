@@ -0,0 +1,121 @@
+#include "MicrobenchSuite.hpp"
+#include "Benchmarks.hpp"
+
+#include <Wasabi/WindowAndInput/Headless/WHeadlessWindowAndInputComponent.hpp>
+
+namespace {
+	uint32_t GetEnvironmentInt(const char* name, uint32_t fallback) {
+		const char* value = getenv(name);
+		if (!value || atoi(value) <= 0)
+			return fallback;
+		return (uint32_t)atoi(value);
+	}
+};
+
+void SkipDeviceBenchmarks(WMicrobenchHarness& harness, const std::string& reason) {
+	harness.Skip("WVulkanMemoryManager stress", reason);
+	harness.Skip("WVulkanBuffer::Create+Destroy (64 KB)", reason);
+	harness.Skip("WVulkanImage::Create+Destroy (256x256)", reason);
+	harness.Skip("Buffer update (map per update)", reason);
+	harness.Skip("Buffer update (persistent map)", reason);
+	harness.Skip("Buffer update (frame ring)", reason);
+	harness.Skip("WGeometry::Intersect (device geometry)", reason);
+	// material variables live in the materials' uniform buffers, so these need
+	// a Vulkan device (a software ICD such as lavapipe will do on a CI machine)
+	harness.Skip("WMaterial::SetVariableData (name)", reason + " (needs a Vulkan device or a software ICD)");
+	harness.Skip("WMaterial::SetVariableData (handle)", reason + " (needs a Vulkan device or a software ICD)");
+	harness.Skip("WMaterialCollection::SetVariable (100k/frame, name)", reason);
+	harness.Skip("WMaterialCollection::SetVariable (100k/frame, handle)", reason);
+	harness.Skip("Descriptor sets (pool per material)", reason);
+	harness.Skip("Descriptor sets (shared pool)", reason);
+	harness.Skip("WMaterial::Bind (1000 materials)", reason);
+	harness.Skip("WObjectManager::QueryFrustum (10k objects)", reason);
+	harness.Skip("WObjectManager::QueryFrustum (10k objects, 100 moving)", reason);
+	harness.Skip("WObject::InCameraView (10k objects, brute-force reference)", reason);
+	harness.Skip("WSkeleton::Update (dante.WSBI)", reason);
+}
+
+WasabiMicrobenchmark::WasabiMicrobenchmark() : Wasabi() {
+	SetEngineParam<const char*>("appName", "WasabiMicrobench");
+	SetEngineParam<bool>("headless", true);
+	SetEngineParam<bool>("enableVulkanValidation", false);
+}
+
+WError WasabiMicrobenchmark::Setup() {
+	const char* filter = getenv("WASABI_MICROBENCH_FILTER");
+	WMicrobenchHarness harness(
+		3,
+		GetEnvironmentInt("WASABI_MICROBENCH_SAMPLES", 10),
+		(double)GetEnvironmentInt("WASABI_MICROBENCH_SAMPLE_MS", 10),
+		filter ? filter : "");
+
+	// the CPU benchmarks only need cameras, which need a window size and a
+	// camera manager, and animations, which register with the animation
+	// manager, create just those instead of starting the engine
+	WHeadlessWindowAndInputComponent* window = new WHeadlessWindowAndInputComponent(this);
+	window->Initialize(640, 480);
+	WindowAndInputComponent = window;
+	CameraManager = new WCameraManager(this);
+	AnimationManager = new WAnimationManager(this);
+
+	RunMathBenchmarks(harness);
+	RunManagerBenchmarks(harness, this);
+	RunCameraBenchmarks(harness, this);
+	RunGeometryBVHBenchmarks(harness);
+	RunGeometryIntersectBenchmarks(harness);
+	RunSoftwareOcclusionBenchmarks(harness);
+	RunParticlesBenchmarks(harness, this);
+	RunSkeletonBenchmarks(harness, this);
+
+	W_SAFE_DELETE(AnimationManager);
+	W_SAFE_DELETE(CameraManager);
+	W_SAFE_DELETE(WindowAndInputComponent);
+
+	if (GetEnvironmentInt("WASABI_MICROBENCH_CPU_ONLY", 0) != 0)
+		SkipDeviceBenchmarks(harness, "WASABI_MICROBENCH_CPU_ONLY is set");
+	else {
+		WError err = StartEngine(640, 480);
+		if (!err)
+			SkipDeviceBenchmarks(harness, "the engine failed to start: " + err.AsString());
+		else {
+			RunMemoryBenchmarks(harness, this);
+			RunBufferBenchmarks(harness, this);
+			RunGeometryBenchmarks(harness, this);
+			RunMaterialBenchmarks(harness, this);
+			RunDescriptorBenchmarks(harness, this);
+			RunObjectBenchmarks(harness, this);
+			RunAnimationBenchmarks(harness, this);
+		}
+	}
+
+	const char* output = getenv("WASABI_MICROBENCH_OUTPUT");
+	if (output) {
+		WError err = harness.WriteResults(output);
+		if (!err)
+			printf("Failed to write %s: %s\n", output, err.AsString().c_str());
+	}
+
+	if (harness.GetNumFailedChecks() > 0) {
+		printf("%u check(s) failed\n", harness.GetNumFailedChecks());
+		return WError(W_ERRORUNK);
+	}
+	return WError(W_SUCCEEDED);
+}
+
+bool WasabiMicrobenchmark::Loop(float fDeltaTime) {
+	UNREFERENCED_PARAMETER(fDeltaTime);
+
+	// everything ran in Setup()
+	return false;
+}
+
+void WasabiMicrobenchmark::Cleanup() {
+}
+
+WError WasabiMicrobenchmark::SetupRenderer() {
+	return WInitializeForwardRenderer(this);
+}
+
+Wasabi* WInitialize() {
+	return new WasabiMicrobenchmark();
+}